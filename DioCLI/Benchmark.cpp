@@ -0,0 +1,583 @@
+/*********************************************************************
+ *
+ *  file:  Benchmark.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Synthetic file trees and timing samples for the benchmark
+ *          command, which runs upload, search, download and resume
+ *          against the local mock service, and in-process cases timed
+ *          without it.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "Benchmark.h"
+
+#include "../Util/Util.h"
+#include "../Util/XString.h"
+#include "../Util/StringUtil.h"
+#include "../Util/FormatBuffer.h"
+#include "../Util/ClientLog.h"
+#include "../Util/Hasher/sha_ni.h"
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include "openssl/sha.h"
+
+#include <stdio.h>
+
+#ifdef WIN32
+    #include <direct.h>
+    #include <psapi.h>
+    #define BENCHMARK_PATH_SEPARATOR    _T("\\")
+#else
+    #include <unistd.h>
+    #include <sys/stat.h>
+    #include <sys/time.h>
+    #include <sys/resource.h>
+    #define BENCHMARK_PATH_SEPARATOR    _T("/")
+#endif
+
+using namespace boost::posix_time;
+using namespace BenchmarkTreeTypes;
+using namespace BenchmarkCaseTypes;
+
+// Seed of the file content - offset by the tree type.
+#define BENCHMARK_SEED                  0x2545F491
+
+///////////////////////////////////////////////////////////////////////
+// BenchmarkTree Constructor
+BenchmarkTree::BenchmarkTree() : m_szTreeName(_T("")), m_szRootDir(_T("")),
+                                 m_szOutputDir(_T("")), m_l64TotalBytes(0),
+                                 m_nRandomState(BENCHMARK_SEED)
+{
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Create the tree under the root directory, in a directory
+//!        named for the tree type, and its empty output directory
+//!        next to it.
+//! \param szRootDir: directory the tree is created in - created, and
+//!        removed with the tree, if it doesn't exist.
+//! \param nTreeType: small, large or deep (BenchmarkTreeTypes).
+//! \param nFiles: file count, 0 for the default of the type.
+//! \param l64FileSize: file size in bytes, 0 for the default.
+//! \return true if every file was written, false otherwise.
+bool BenchmarkTree::Create(const std::string& szRootDir, int nTreeType, int nFiles /*0*/,
+                           LONG64 l64FileSize /*0*/)
+{
+    Remove();
+
+    if ( (nTreeType < treeSmall) || (nTreeType >= LAST_TREE_TYPE) ) {
+        return false;
+    }
+
+    int nDirs = 1;
+    bool bNested = false;
+
+    switch (nTreeType) {
+        case treeSmall:
+            nFiles = (nFiles > 0) ? nFiles : BENCHMARK_SMALL_FILES;
+            l64FileSize = (l64FileSize > 0) ? l64FileSize : BENCHMARK_SMALL_FILE_SIZE;
+            nDirs = BENCHMARK_SMALL_DIRS;
+            break;
+        case treeLarge:
+            nFiles = (nFiles > 0) ? nFiles : BENCHMARK_LARGE_FILES;
+            l64FileSize = (l64FileSize > 0) ? l64FileSize : BENCHMARK_LARGE_FILE_SIZE;
+            break;
+        case treeDeep:
+            nFiles = (nFiles > 0) ? nFiles : BENCHMARK_DEEP_FILES;
+            l64FileSize = (l64FileSize > 0) ? l64FileSize : BENCHMARK_DEEP_FILE_SIZE;
+            nDirs = BENCHMARK_DEEP_LEVELS;
+            bNested = true;
+            break;
+    }
+
+    if (nDirs > nFiles) {
+        nDirs = nFiles;
+    }
+
+    m_szTreeName = BenchmarkTreeNames[nTreeType];
+    m_nRandomState = BENCHMARK_SEED + (unsigned int)nTreeType;
+
+    m_szRootDir = szRootDir + BENCHMARK_PATH_SEPARATOR + m_szTreeName;
+    m_szOutputDir = m_szRootDir + _T("_output");
+
+    if ( (false == AddDirectory(szRootDir)) || (false == AddDirectory(m_szRootDir)) ||
+         (false == AddDirectory(m_szOutputDir)) ) {
+        return false;
+    }
+
+    //-----------------------------------------------------------------
+    // Directories - siblings under the root, or each one nested in the
+    // one before it.  The large tree keeps its files in the root.
+    //-----------------------------------------------------------------
+    std::vector<std::string> listFileDirs;
+
+    if (nTreeType == treeLarge) {
+        listFileDirs.push_back(m_szRootDir);
+    }
+    else {
+        std::string szParentDir = m_szRootDir;
+        for (int nDir = 0; nDir < nDirs; nDir++) {
+            std::string szDir = szParentDir + BENCHMARK_PATH_SEPARATOR +
+                _format(_T("%s%02d"), bNested ? _T("level") : _T("dir"), nDir);
+
+            if (false == AddDirectory(szDir)) {
+                return false;
+            }
+
+            listFileDirs.push_back(szDir);
+            if (bNested) {
+                szParentDir = szDir;
+            }
+        }
+    }
+
+    for (int nIndex = 0; nIndex < nFiles; nIndex++) {
+        std::string szFilePath = listFileDirs[nIndex % listFileDirs.size()] +
+            BENCHMARK_PATH_SEPARATOR +
+            _format(_T("%s%s_%06d.dat"), BENCHMARK_FILE_PREFIX, m_szTreeName.c_str(), nIndex);
+
+        if (false == WriteFile(szFilePath, l64FileSize)) {
+            ClientLog(UI_COMP, LOG_ERROR, false, _T("Benchmark: %s could not be written."),
+                szFilePath.c_str());
+            return false;
+        }
+    }
+
+    return true;
+
+} // End Create
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Path of a file in the output directory - the file is
+//!        removed with the tree.
+std::string BenchmarkTree::AddOutputFile(const std::string& szFileName)
+{
+    std::string szFilePath = m_szOutputDir + BENCHMARK_PATH_SEPARATOR + szFileName;
+    m_listOutputFiles.push_back(szFilePath);
+
+    return szFilePath;
+
+} // End AddOutputFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Remove the files, then the directories, deepest first.
+void BenchmarkTree::Remove()
+{
+    for (int nIndex = 0; nIndex < (int)m_listFiles.size(); nIndex++) {
+        remove(m_listFiles[nIndex].c_str());
+    }
+
+    for (int nIndex = 0; nIndex < (int)m_listOutputFiles.size(); nIndex++) {
+        remove(m_listOutputFiles[nIndex].c_str());
+    }
+
+    for (int nIndex = (int)m_listDirs.size() - 1; nIndex >= 0; nIndex--) {
+        #ifdef WIN32
+            _rmdir(m_listDirs[nIndex].c_str());
+        #else
+            rmdir(m_listDirs[nIndex].c_str());
+        #endif
+    }
+
+    m_listFiles.clear();
+    m_listOutputFiles.clear();
+    m_listDirs.clear();
+    m_l64TotalBytes = 0;
+
+} // End Remove
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Create the directory if needed - only directories created
+//!        here are removed with the tree.
+bool BenchmarkTree::AddDirectory(const std::string& szDirectory)
+{
+    if (Util::IsDirectory(szDirectory.c_str())) {
+        return true;
+    }
+
+    #ifdef WIN32
+        int nResult = _mkdir(szDirectory.c_str());
+    #else
+        int nResult = mkdir(szDirectory.c_str(), 0777);
+    #endif
+
+    if (nResult != 0) {
+        ClientLog(UI_COMP, LOG_ERROR, false, _T("Benchmark: directory %s could not be created."),
+            szDirectory.c_str());
+        return false;
+    }
+
+    m_listDirs.push_back(szDirectory);
+    return true;
+
+} // End AddDirectory
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Write the file from the content generator (xorshift), so the
+//!        data doesn't compress or dedupe.
+bool BenchmarkTree::WriteFile(const std::string& szFilePath, LONG64 l64FileSize)
+{
+    FILE* pFile = fopen(szFilePath.c_str(), _T("wb"));
+    if (pFile == NULL) {
+        return false;
+    }
+
+    m_listFiles.push_back(szFilePath);
+
+    unsigned int nBuffer[BENCHMARK_WRITE_BUFFER_SIZE / sizeof(unsigned int)];
+    LONG64 l64Remaining = l64FileSize;
+    bool bSuccess = true;
+
+    while (l64Remaining > 0) {
+        for (int nIndex = 0; nIndex < (int)(sizeof(nBuffer) / sizeof(unsigned int)); nIndex++) {
+            m_nRandomState ^= m_nRandomState << 13;
+            m_nRandomState ^= m_nRandomState >> 17;
+            m_nRandomState ^= m_nRandomState << 5;
+            nBuffer[nIndex] = m_nRandomState;
+        }
+
+        size_t nBytes = (l64Remaining > (LONG64)sizeof(nBuffer)) ? sizeof(nBuffer) :
+                                                                  (size_t)l64Remaining;
+        if (fwrite(nBuffer, 1, nBytes, pFile) != nBytes) {
+            bSuccess = false;
+            break;
+        }
+
+        l64Remaining -= nBytes;
+    }
+
+    if (fclose(pFile) != 0) {
+        bSuccess = false;
+    }
+
+    if (bSuccess) {
+        m_l64TotalBytes += l64FileSize;
+    }
+
+    return bSuccess;
+
+} // End WriteFile
+
+///////////////////////////////////////////////////////////////////////
+// BenchmarkSample Constructor
+BenchmarkSample::BenchmarkSample() : m_l64WallMilliseconds(0), m_l64StartCPUMilliseconds(0),
+                                     m_l64CPUMilliseconds(0), m_l64PeakMemory(0)
+{
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Start timing the phase.
+void BenchmarkSample::Start()
+{
+    LONG64 l64PeakMemory = 0;
+    GetProcessUsage(m_l64StartCPUMilliseconds, l64PeakMemory);
+
+    m_l64WallMilliseconds = 0;
+    m_l64CPUMilliseconds = 0;
+    m_l64PeakMemory = 0;
+    m_tmStart = microsec_clock::universal_time();
+
+} // End Start
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Stop timing the phase.
+void BenchmarkSample::Stop()
+{
+    time_duration tdElapsed = microsec_clock::universal_time() - m_tmStart;
+    m_l64WallMilliseconds = tdElapsed.total_milliseconds();
+
+    LONG64 l64CPUMilliseconds = 0;
+    GetProcessUsage(l64CPUMilliseconds, m_l64PeakMemory);
+    m_l64CPUMilliseconds = l64CPUMilliseconds - m_l64StartCPUMilliseconds;
+
+} // End Stop
+
+///////////////////////////////////////////////////////////////////////
+//! \brief One line report of the phase.
+std::string BenchmarkSample::Format(const std::string& szPhase, int nFiles, LONG64 l64Bytes) const
+{
+    double dblSeconds = (double)m_l64WallMilliseconds / 1000.0;
+    if (dblSeconds <= 0) {
+        dblSeconds = 0.001;
+    }
+
+    std::string szReport = _format(_T("%-10s %7d files %10.1f files/s"), szPhase.c_str(),
+        nFiles, (double)nFiles / dblSeconds);
+
+    if (l64Bytes > 0) {
+        szReport += _format(_T(" %9.2f MB/s"), ((double)l64Bytes / 1048576.0) / dblSeconds);
+    }
+    else {
+        szReport += _format(_T(" %14s"), _T(""));
+    }
+
+    szReport += _format(_T("  wall %8.3f s  cpu %8.3f s  peak %7.1f MB"), dblSeconds,
+        (double)m_l64CPUMilliseconds / 1000.0, (double)m_l64PeakMemory / 1048576.0);
+
+    return szReport;
+
+} // End Format
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Tab separated record - tree, phase, files, bytes, wall ms,
+//!        CPU ms and peak memory bytes.
+std::string BenchmarkSample::FormatRecord(const std::string& szTree, const std::string& szPhase,
+                                          int nFiles, LONG64 l64Bytes) const
+{
+    std::string szFormat = _T("%s\t%s\t%d\t") DIOMEDE_LONG_FORMAT _T("\t")
+        DIOMEDE_LONG_FORMAT _T("\t") DIOMEDE_LONG_FORMAT _T("\t") DIOMEDE_LONG_FORMAT;
+
+    return _format(szFormat.c_str(), szTree.c_str(), szPhase.c_str(), nFiles, l64Bytes,
+        m_l64WallMilliseconds, m_l64CPUMilliseconds, m_l64PeakMemory);
+
+} // End FormatRecord
+
+///////////////////////////////////////////////////////////////////////
+//! \brief One line report of an in-process case.
+std::string BenchmarkSample::FormatCalls(const std::string& szVariant, int nCalls,
+                                         LONG64 l64Bytes) const
+{
+    double dblSeconds = (double)m_l64WallMilliseconds / 1000.0;
+    if (dblSeconds <= 0) {
+        dblSeconds = 0.001;
+    }
+
+    double dblNanoseconds = (nCalls > 0) ? (dblSeconds * 1000000000.0) / (double)nCalls : 0;
+
+    std::string szReport = _format(_T("%-10s %7d calls %10.1f ns/call"), szVariant.c_str(),
+        nCalls, dblNanoseconds);
+
+    if (l64Bytes > 0) {
+        szReport += _format(_T(" %9.2f MB/s"), ((double)l64Bytes / 1048576.0) / dblSeconds);
+    }
+    else {
+        szReport += _format(_T(" %14s"), _T(""));
+    }
+
+    szReport += _format(_T("  wall %8.3f s  cpu %8.3f s  peak %7.1f MB"), dblSeconds,
+        (double)m_l64CPUMilliseconds / 1000.0, (double)m_l64PeakMemory / 1048576.0);
+
+    return szReport;
+
+} // End FormatCalls
+
+///////////////////////////////////////////////////////////////////////
+//! \brief User plus system CPU time of the process, and its peak
+//!        resident memory (peak working set on Windows).
+//! \return true if successful, false otherwise.
+bool BenchmarkSample::GetProcessUsage(LONG64& l64CPUMilliseconds, LONG64& l64PeakMemory)
+{
+    l64CPUMilliseconds = 0;
+    l64PeakMemory = 0;
+
+    #ifdef WIN32
+        FILETIME ftCreation, ftExit, ftKernel, ftUser;
+        if (GetProcessTimes(GetCurrentProcess(), &ftCreation, &ftExit, &ftKernel, &ftUser) == FALSE) {
+            return false;
+        }
+
+        // FILETIME values are in 100 nanosecond units.
+        LONG64 l64Kernel = ((LONG64)ftKernel.dwHighDateTime << 32) | ftKernel.dwLowDateTime;
+        LONG64 l64User = ((LONG64)ftUser.dwHighDateTime << 32) | ftUser.dwLowDateTime;
+        l64CPUMilliseconds = (l64Kernel + l64User) / 10000;
+
+        PROCESS_MEMORY_COUNTERS memoryCounters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters))) {
+            l64PeakMemory = (LONG64)memoryCounters.PeakWorkingSetSize;
+        }
+    #else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return false;
+        }
+
+        l64CPUMilliseconds = ((LONG64)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+                             (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+
+        // Bytes on the Mac, kilobytes on Linux.
+        #if defined(__APPLE__)
+            l64PeakMemory = (LONG64)usage.ru_maxrss;
+        #else
+            l64PeakMemory = (LONG64)usage.ru_maxrss * 1024;
+        #endif
+    #endif
+
+    return true;
+
+} // End GetProcessUsage
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Run the in-process case.
+//! \return true if the case ran, false otherwise.
+bool BenchmarkCases::Run(int nCaseType, std::vector<std::string>& listReport, FILE* pReportFile)
+{
+    switch (nCaseType) {
+        case caseFormat:
+            return RunFormat(listReport, pReportFile);
+        case caseHash:
+            return RunHash(listReport, pReportFile);
+        default:
+            break;
+    }
+
+    return false;
+
+} // End Run
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Add a variant's results to the report and the report file.
+void BenchmarkCases::AddResult(const std::string& szCase, const std::string& szVariant,
+                               const BenchmarkSample& sample, int nCalls, LONG64 l64Bytes,
+                               std::vector<std::string>& listReport, FILE* pReportFile)
+{
+    listReport.push_back(_T("  ") + sample.FormatCalls(szVariant, nCalls, l64Bytes));
+
+    if (pReportFile != NULL) {
+        fprintf(pReportFile, _T("%s\n"), sample.FormatRecord(szCase, szVariant, nCalls,
+            l64Bytes).c_str());
+    }
+
+} // End AddResult
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Time the upload status line - the file name and its size -
+//!        built with _format and std::string, and with FormatBuffer.
+//!        The size changes on each call so the byte size is formatted
+//!        each time.
+//! \return true
+bool BenchmarkCases::RunFormat(std::vector<std::string>& listReport, FILE* pReportFile)
+{
+    std::string szCase = BenchmarkCaseNames[caseFormat];
+    std::string szFileName = BENCHMARK_FILE_PREFIX _T("small_000001.dat");
+    LONG64 l64FileSize = 12345678;
+
+    // Summed so the loops aren't optimized away.
+    volatile size_t nTotalLength = 0;
+    int nCall = 0;
+
+    listReport.push_back(_format(_T("%s case: upload status line"), szCase.c_str()));
+
+    BenchmarkSample sample;
+    sample.Start();
+    for (nCall = 0; nCall < BENCHMARK_FORMAT_CALLS; nCall++) {
+        std::string szBytes = _T("");
+        std::string szBytesSizeType = _T("");
+        StringUtil::FormatByteSize(l64FileSize + nCall, szBytes, szBytesSizeType);
+
+        std::string szUploadFile = _format(_T("%s (%s %s)... creating "), szFileName.c_str(),
+            szBytes.c_str(), szBytesSizeType.c_str());
+        nTotalLength += szUploadFile.length();
+    }
+    sample.Stop();
+
+    AddResult(szCase, _T("_format"), sample, BENCHMARK_FORMAT_CALLS, 0, listReport, pReportFile);
+
+    sample.Start();
+    for (nCall = 0; nCall < BENCHMARK_FORMAT_CALLS; nCall++) {
+        FixedFormatBuffer<32> szBytes;
+        const char* szBytesSizeType = _T("");
+        StringUtil::FormatByteSize(l64FileSize + nCall, szBytes, szBytesSizeType);
+
+        FixedFormatBuffer<256> szUploadFile;
+        szUploadFile << szFileName << _T(" (") << szBytes << _T(' ') << szBytesSizeType
+                     << _T(")... creating ");
+        nTotalLength += szUploadFile.length();
+    }
+    sample.Stop();
+
+    AddResult(szCase, _T("buffer"), sample, BENCHMARK_FORMAT_CALLS, 0, listReport, pReportFile);
+
+    return true;
+
+} // End RunFormat
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Time SHA-1 and SHA-256 over the same buffer - with the
+//!        Hasher functions, which use the SHA extensions when the CPU
+//!        has them, and with OpenSSL for comparison.
+//! \return true
+bool BenchmarkCases::RunHash(std::vector<std::string>& listReport, FILE* pReportFile)
+{
+    std::string szCase = BenchmarkCaseNames[caseHash];
+    LONG64 l64Bytes = (LONG64)BENCHMARK_HASH_BUFFER_SIZE * BENCHMARK_HASH_CALLS;
+
+    unsigned char* pBuffer = new unsigned char[BENCHMARK_HASH_BUFFER_SIZE];
+
+    // Same content generator as the trees.
+    unsigned int nRandomState = BENCHMARK_SEED;
+    for (int nIndex = 0; nIndex < BENCHMARK_HASH_BUFFER_SIZE; nIndex++) {
+        nRandomState ^= nRandomState << 13;
+        nRandomState ^= nRandomState >> 17;
+        nRandomState ^= nRandomState << 5;
+        pBuffer[nIndex] = (unsigned char)nRandomState;
+    }
+
+    // Summed so the loops aren't optimized away.
+    volatile unsigned int nTotal = 0;
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    int nCall = 0;
+
+    listReport.push_back(_format(_T("%s case: %d KB buffer, SHA extensions %s"), szCase.c_str(),
+        BENCHMARK_HASH_BUFFER_SIZE / 1024, sha_ni_available() ? _T("used") : _T("not used")));
+
+    BenchmarkSample sample;
+    sample.Start();
+    for (nCall = 0; nCall < BENCHMARK_HASH_CALLS; nCall++) {
+        sha1_ctx ctx[1];
+        sha1_begin(ctx);
+        sha1_hash(pBuffer, BENCHMARK_HASH_BUFFER_SIZE, ctx);
+        sha1_end(digest, ctx);
+        nTotal += digest[0];
+    }
+    sample.Stop();
+
+    AddResult(szCase, _T("sha1"), sample, BENCHMARK_HASH_CALLS, l64Bytes, listReport, pReportFile);
+
+    sample.Start();
+    for (nCall = 0; nCall < BENCHMARK_HASH_CALLS; nCall++) {
+        sha256_ctx ctx[1];
+        sha256_begin(ctx);
+        sha256_hash(pBuffer, BENCHMARK_HASH_BUFFER_SIZE, ctx);
+        sha256_end(digest, ctx);
+        nTotal += digest[0];
+    }
+    sample.Stop();
+
+    AddResult(szCase, _T("sha256"), sample, BENCHMARK_HASH_CALLS, l64Bytes, listReport, pReportFile);
+
+    sample.Start();
+    for (nCall = 0; nCall < BENCHMARK_HASH_CALLS; nCall++) {
+        SHA1(pBuffer, BENCHMARK_HASH_BUFFER_SIZE, digest);
+        nTotal += digest[0];
+    }
+    sample.Stop();
+
+    AddResult(szCase, _T("ssl-sha1"), sample, BENCHMARK_HASH_CALLS, l64Bytes, listReport,
+        pReportFile);
+
+    sample.Start();
+    for (nCall = 0; nCall < BENCHMARK_HASH_CALLS; nCall++) {
+        SHA256(pBuffer, BENCHMARK_HASH_BUFFER_SIZE, digest);
+        nTotal += digest[0];
+    }
+    sample.Stop();
+
+    AddResult(szCase, _T("ssl-sha256"), sample, BENCHMARK_HASH_CALLS, l64Bytes, listReport,
+        pReportFile);
+
+    delete [] pBuffer;
+    return true;
+
+} // End RunHash
+
+/** @} */
@@ -0,0 +1,245 @@
+/*********************************************************************
+ *
+ *  file:  Benchmark.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Synthetic file trees and timing samples for the benchmark
+ *          command, which runs upload, search, download and resume
+ *          against the local mock service, and in-process cases timed
+ *          without it.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------
+//! Default shape of each tree - file count, file size (bytes) and
+//! the directories the files are spread across.  The deep tree nests
+//! each directory in the previous one.
+//---------------------------------------------------------------------
+#define BENCHMARK_SMALL_FILES           1000
+#define BENCHMARK_SMALL_FILE_SIZE       4096
+#define BENCHMARK_SMALL_DIRS            10
+
+#define BENCHMARK_LARGE_FILES           4
+#define BENCHMARK_LARGE_FILE_SIZE       67108864
+
+#define BENCHMARK_DEEP_FILES            200
+#define BENCHMARK_DEEP_FILE_SIZE        16384
+#define BENCHMARK_DEEP_LEVELS           20
+
+#define BENCHMARK_FILE_PREFIX           _T("bm")
+#define BENCHMARK_WRITE_BUFFER_SIZE     65536
+
+//---------------------------------------------------------------------
+//! Calls timed by the format case.
+//---------------------------------------------------------------------
+#define BENCHMARK_FORMAT_CALLS          1000000
+
+//---------------------------------------------------------------------
+//! Buffer hashed by each call of the hash case, and the calls timed.
+//---------------------------------------------------------------------
+#define BENCHMARK_HASH_BUFFER_SIZE      (1024 * 1024)
+#define BENCHMARK_HASH_CALLS            256
+
+//---------------------------------------------------------------------
+//! Tree types - ordered as run by "benchmark /tree all".
+//---------------------------------------------------------------------
+namespace BenchmarkTreeTypes {
+    typedef enum BenchmarkTreeType {
+        treeSmall = 0,
+        treeLarge,
+        treeDeep,
+        LAST_TREE_TYPE
+    } BenchmarkTreeTypes;
+
+    static const std::string BenchmarkTreeNames[LAST_TREE_TYPE + 1] =
+    {
+        _T("small"),
+        _T("large"),
+        _T("deep"),
+        _T("")
+    };
+}
+
+//---------------------------------------------------------------------
+//! In-process cases - ordered as run by "benchmark /case all".
+//---------------------------------------------------------------------
+namespace BenchmarkCaseTypes {
+    typedef enum BenchmarkCaseType {
+        caseFormat = 0,
+        caseHash,
+        LAST_CASE_TYPE
+    } BenchmarkCaseTypes;
+
+    static const std::string BenchmarkCaseNames[LAST_CASE_TYPE + 1] =
+    {
+        _T("format"),
+        _T("hash"),
+        _T("")
+    };
+}
+
+///////////////////////////////////////////////////////////////////////
+//! \class BenchmarkTree
+//! \brief Creates and removes a tree of files with reproducible
+//!        content - the same type, count, size and seed always give
+//!        the same bytes.  File names are unique within the tree.
+class BenchmarkTree
+{
+private:
+    std::string                 m_szTreeName;
+    std::string                 m_szRootDir;
+    std::string                 m_szOutputDir;                  //! Downloads and reports
+    std::vector<std::string>    m_listDirs;                     //! Parents first
+    std::vector<std::string>    m_listFiles;                    //! Full paths
+    std::vector<std::string>    m_listOutputFiles;
+    LONG64                      m_l64TotalBytes;
+    unsigned int                m_nRandomState;
+
+public:
+    BenchmarkTree();
+    virtual ~BenchmarkTree() {}
+
+    //-----------------------------------------------------------------
+    //! \brief Create the tree and an empty output directory under the
+    //!        root directory.
+    //! \param nFiles, l64FileSize: 0 for the defaults of the type.
+    //! \return true if every file was written, false otherwise.
+    //-----------------------------------------------------------------
+    bool Create(const std::string& szRootDir, int nTreeType, int nFiles=0,
+                LONG64 l64FileSize=0);
+
+    //-----------------------------------------------------------------
+    //! \brief Path of a file in the output directory, which is removed
+    //!        along with the tree.
+    //-----------------------------------------------------------------
+    std::string AddOutputFile(const std::string& szFileName);
+
+    //-----------------------------------------------------------------
+    //! \brief Remove the files and directories created - nothing else
+    //!        under the root is touched.
+    //-----------------------------------------------------------------
+    void Remove();
+
+    //-----------------------------------------------------------------
+    // Getters
+    //-----------------------------------------------------------------
+    const std::string& GetRootDir() const { return m_szRootDir; }
+    const std::string& GetOutputDir() const { return m_szOutputDir; }
+    const std::string& GetTreeName() const { return m_szTreeName; }
+    const std::vector<std::string>& GetFiles() const { return m_listFiles; }
+    int GetFileCount() const { return (int)m_listFiles.size(); }
+    LONG64 GetTotalBytes() const { return m_l64TotalBytes; }
+
+private:
+    bool AddDirectory(const std::string& szDirectory);
+    bool WriteFile(const std::string& szFilePath, LONG64 l64FileSize);
+
+}; // End BenchmarkTree
+
+///////////////////////////////////////////////////////////////////////
+//! \class BenchmarkSample
+//! \brief Wall clock and process CPU time over a benchmark phase, and
+//!        the process peak resident memory at its end.
+//!
+//! Usage:
+//!      BenchmarkSample sample;
+//!      sample.Start();
+//!      ...phase...
+//!      sample.Stop();
+//!      szReport = sample.Format(_T("upload"), nFiles, l64Bytes);
+class BenchmarkSample
+{
+private:
+    boost::posix_time::ptime    m_tmStart;
+    LONG64                      m_l64WallMilliseconds;
+    LONG64                      m_l64StartCPUMilliseconds;
+    LONG64                      m_l64CPUMilliseconds;
+    LONG64                      m_l64PeakMemory;                //! Bytes
+
+public:
+    BenchmarkSample();
+    virtual ~BenchmarkSample() {}
+
+    void Start();
+    void Stop();
+
+    LONG64 GetWallMilliseconds() const { return m_l64WallMilliseconds; }
+    LONG64 GetCPUMilliseconds() const { return m_l64CPUMilliseconds; }
+    LONG64 GetPeakMemory() const { return m_l64PeakMemory; }
+
+    //-----------------------------------------------------------------
+    //! \brief One line report - files/s, MB/s, CPU time and peak
+    //!        memory.  Pass 0 bytes for phases that move no data.
+    //-----------------------------------------------------------------
+    std::string Format(const std::string& szPhase, int nFiles, LONG64 l64Bytes) const;
+
+    //-----------------------------------------------------------------
+    //! \brief Tab separated record of the same values, for comparing
+    //!        runs.
+    //-----------------------------------------------------------------
+    std::string FormatRecord(const std::string& szTree, const std::string& szPhase,
+                             int nFiles, LONG64 l64Bytes) const;
+
+    //-----------------------------------------------------------------
+    //! \brief One line report of an in-process case - time per call,
+    //!        MB/s when the calls process data, CPU time and peak
+    //!        memory.
+    //-----------------------------------------------------------------
+    std::string FormatCalls(const std::string& szVariant, int nCalls, LONG64 l64Bytes) const;
+
+    //-----------------------------------------------------------------
+    //! \brief User plus system CPU time of the process, and its peak
+    //!        resident memory.
+    //-----------------------------------------------------------------
+    static bool GetProcessUsage(LONG64& l64CPUMilliseconds, LONG64& l64PeakMemory);
+
+}; // End BenchmarkSample
+
+///////////////////////////////////////////////////////////////////////
+//! \class BenchmarkCases
+//! \brief In-process cases, timed without the mock service.  Each
+//!        case times the same work done each way the code can do it,
+//!        one report line per variant.
+class BenchmarkCases
+{
+public:
+    //-----------------------------------------------------------------
+    //! \brief Run the case (BenchmarkCaseTypes).  The results are added
+    //!        to the report, and written to the report file, if any.
+    //! \return true if the case ran, false otherwise.
+    //-----------------------------------------------------------------
+    static bool Run(int nCaseType, std::vector<std::string>& listReport, FILE* pReportFile);
+
+private:
+    static void AddResult(const std::string& szCase, const std::string& szVariant,
+                          const BenchmarkSample& sample, int nCalls, LONG64 l64Bytes,
+                          std::vector<std::string>& listReport, FILE* pReportFile);
+
+    static bool RunFormat(std::vector<std::string>& listReport, FILE* pReportFile);
+    static bool RunHash(std::vector<std::string>& listReport, FILE* pReportFile);
+
+}; // End BenchmarkCases
+
+/** @} */
+
+#endif // __BENCHMARK_H__
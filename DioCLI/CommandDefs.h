@@ -63,6 +63,7 @@ const string ARG_NO                     = _T("no");
 const string ARG_ALL                    = _T("all");
 
 const string ARG_OUTPUT                 = _T("output");
+const string ARG_FORMAT                 = _T("format");
 const string ARG_TEST_SWITCH            = _T("test");
 
 // Can be either filename, fileid, or hash value
@@ -127,12 +128,22 @@ const string CMD_UPLOAD_ALT1            = _T("up");
 const string CMD_UPLOAD_ALT2            = _T("u");
 const string ARG_RECURSE_SWITCH         = _T("s");
 const string ARG_PATHMETADATA_SWITCH    = _T("m");
+const string ARG_DELTA_SWITCH           = _T("delta");
+const string ARG_INCLUDE                = _T("include");
+const string ARG_EXCLUDE                = _T("exclude");
+const string ARG_EXCLUDE_DIRS           = _T("excludedirs");
+
+const string CMD_SYNC                   = _T("sync");
+
+const string CMD_WATCH                  = _T("watch");
+const string ARG_WATCH_DELAY            = _T("delay");
 
 const string CMD_RESUME                 = _T("resume");
 const string CMD_RESUME_ALT1            = _T("res");
 const string CMD_RESUME_ALT2            = _T("r");
 const string ARG_RESUME_LIST_SWITCH     = _T("list");
 const string ARG_RESUME_CLEAR_SWITCH    = _T("clear");
+const string ARG_RESUME_PARALLEL        = _T("parallel");
 const string ARG_RESUME_ALL             = _T("all");
 const string ARG_RESUME_COMPLETE        = _T("complete");
 const string ARG_RESUME_INCOMPLETE      = _T("incomplete");
@@ -141,6 +152,7 @@ const string CMD_DOWNLOAD               = _T("download");
 const string CMD_DOWNLOAD_ALT1          = _T("down");
 const string CMD_DOWNLOAD_ALT2          = _T("d");
 const string ARG_DIRECTORY              = _T("directory");
+const string ARG_SPARSE_SWITCH          = _T("sparse");
 
 const string CMD_GETUPLOADTOKEN         = _T("getuploadtoken");
 const string CMD_GETUPLOADTOKEN_ALT1    = _T("gettoken");
@@ -389,6 +401,17 @@ const string ARG_REM                    = _T("");
 const string CMD_ECHO                   = _T("echo");
 const string ARG_ECHO                   = _T("");
 
+//---------------------------------------------------------------------
+// Benchmark - runs against the local mock service.
+//---------------------------------------------------------------------
+const string CMD_BENCHMARK              = _T("benchmark");
+const string CMD_BENCHMARK_ALT1         = _T("bench");
+const string ARG_BENCHMARK_TREE         = _T("tree");
+const string ARG_BENCHMARK_FILES        = _T("files");
+const string ARG_BENCHMARK_SIZE         = _T("size");
+const string ARG_BENCHMARK_CASE         = _T("case");
+const string ARG_BENCHMARK_KEEP_SWITCH  = _T("keep");
+
 //---------------------------------------------------------------------
 // Help: Group headers
 //---------------------------------------------------------------------
@@ -420,6 +443,7 @@ namespace DioCLICommands {
 		,CMD_SESSIONTOKEN
 		,CMD_CHECKACCOUNT
         ,CMD_SUBSCRIBE
+		,CMD_BENCHMARK
 
 		,CMD_CREATEUSER
 		,CMD_CHANGEPASSWORD
@@ -432,6 +456,8 @@ namespace DioCLICommands {
 		,CMD_DELETEUSER
 
 		,CMD_UPLOAD
+		,CMD_SYNC
+		,CMD_WATCH
 		,CMD_RESUME
 		,CMD_DOWNLOAD
 		,CMD_GETUPLOADTOKEN
@@ -575,6 +601,10 @@ const AlTERNATE_COMMAND_SET DioAlternateCommands[] = {
     ,{ CMD_UPLOAD,                          CMD_UPLOAD_ALT1             }
     ,{ CMD_UPLOAD,                          CMD_UPLOAD_ALT2             }
 
+    ,{ CMD_SYNC,                            CMD_SYNC                    }
+
+    ,{ CMD_WATCH,                           CMD_WATCH                   }
+
     ,{ CMD_RESUME,                          CMD_RESUME                  }
     ,{ CMD_RESUME,                          CMD_RESUME_ALT1             }
     ,{ CMD_RESUME,                          CMD_RESUME_ALT2             }
@@ -695,6 +725,9 @@ const AlTERNATE_COMMAND_SET DioAlternateCommands[] = {
     ,{ CMD_SUBSCRIBE,                       CMD_SUBSCRIBE               }
     ,{ CMD_SUBSCRIBE,                       CMD_SUBSCRIBE_ALT1          }
 
+    ,{ CMD_BENCHMARK,                       CMD_BENCHMARK               }
+    ,{ CMD_BENCHMARK,                       CMD_BENCHMARK_ALT1          }
+
     ,{ CMD_SETBILLINGINFO,                  CMD_SETBILLINGINFO          }
     ,{ CMD_SETBILLINGINFO,                  CMD_SETBILLINGINFO_ALT1     }
 
@@ -790,6 +823,8 @@ const COMMAND_SET DioCLICommandList[] = {
 	,{ DioCLICommands::CMD_SETPRIMARYEMAILADDRESS,  CMD_SETPRIMARYEMAILADDRESS, DioCLIGroups::GROUP_USER	}
 
 	,{ DioCLICommands::CMD_UPLOAD,		    CMD_UPLOAD,             DioCLIGroups::GROUP_TRANSFER    }
+	,{ DioCLICommands::CMD_SYNC,		    CMD_SYNC,               DioCLIGroups::GROUP_TRANSFER    }
+	,{ DioCLICommands::CMD_WATCH,		    CMD_WATCH,              DioCLIGroups::GROUP_TRANSFER    }
 	,{ DioCLICommands::CMD_RESUME,		    CMD_RESUME,             DioCLIGroups::GROUP_TRANSFER    }
 	,{ DioCLICommands::CMD_DOWNLOAD,		CMD_DOWNLOAD,           DioCLIGroups::GROUP_TRANSFER    }
 	,{ DioCLICommands::CMD_GETUPLOADTOKEN,	CMD_GETUPLOADTOKEN,     DioCLIGroups::GROUP_TRANSFER    }
@@ -864,6 +899,7 @@ const COMMAND_SET DioCLICommandList[] = {
 	,{ DioCLICommands::CMD_SESSIONTOKEN,    CMD_SESSIONTOKEN,       DioCLIGroups::GROUP_CLIENT      }
 	,{ DioCLICommands::CMD_CHECKACCOUNT,	CMD_CHECKACCOUNT,       DioCLIGroups::GROUP_CLIENT      }
 	,{ DioCLICommands::CMD_SUBSCRIBE,	    CMD_SUBSCRIBE,          DioCLIGroups::GROUP_CLIENT      }
+	,{ DioCLICommands::CMD_BENCHMARK,	    CMD_BENCHMARK,          DioCLIGroups::GROUP_CLIENT      }
 
 	,{ DioCLICommands::CMD_LAST,		    CMD_LAST,               DioCLIGroups::GROUP_LAST		}
 };
@@ -34,6 +34,8 @@
 #include "../Util/ProfileManager.h"
 #include "../Util/StringUtil.h"
 #include "../Util/MessageTimer.h"
+#include "../Util/RecordWriter.h"
+#include "../Util/FormatBuffer.h"
 
 #include "CommandDefs.h"
 #include "DiomedePEM.h"
@@ -42,6 +44,13 @@
 #include "SimpleRedirect.h"
 #include "ResumeManager.h"
 #include "ResumeInfoData.h"
+#include "TransferMetrics.h"
+#include "RetryPolicy.h"
+#include "UploadManifest.h"
+#include "SyncState.h"
+#include "DirWatcher.h"
+#include "MockService.h"
+#include "Benchmark.h"
 
 #include <iostream>
 #include <fstream>
@@ -102,6 +111,7 @@ using namespace DIOMEDE_CONSOLE;
 using namespace EndTimerTypes;
 using namespace StringUtil;
 using namespace DiomedeResumeErrorCodes;
+using namespace RetryErrorTypes;
 
 using namespace DIOMEDE_PEM;
 
@@ -243,6 +253,10 @@ ConsoleControl::~ConsoleControl()
 
     m_listCommands.clear();
 
+    // The renderer must not draw to the upload or download timers
+    // once they're deleted.
+    m_progressRenderer.EndFile();
+
     if (m_pUploadInfo != NULL) {
         delete m_pUploadInfo;
         m_pUploadInfo = NULL;
@@ -1056,6 +1070,71 @@ void ConsoleControl::PrintResumeWarning(int nResumeResult, std::string szWarning
 
 } // End PrintResumeWarning
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to match an error message against the
+//          service errors.
+// Requires:
+//      szErrorMsg: error message.
+// Returns: index into ServiceErrorStrings, -1 if there's no match.
+int ConsoleControl::GetServiceErrorType(const std::string& szErrorMsg)
+{
+    // Convert the message to lower case for comparison.
+    std::string szTempErrorMsg = szErrorMsg;
+    for (int nChar = 0; nChar < (int)szTempErrorMsg.length(); nChar++) {
+        szTempErrorMsg[nChar] = (char)tolower((unsigned char)szTempErrorMsg[nChar]);
+    }
+
+    int nIndex = 0;
+
+    while ( ServiceErrorStrings[nIndex].length() > 0 ) {
+
+        if ( szTempErrorMsg.find(ServiceErrorStrings[nIndex]) != std::string::npos ) {
+            return nIndex;
+        }
+
+        nIndex ++;
+    }
+
+    return -1;
+
+} // End GetServiceErrorType
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to map a service error to its retry
+//          policy error class.
+// Requires:
+//      nServiceErrorType: index into ServiceErrorStrings.
+// Returns: RetryErrorClassType
+int ConsoleControl::GetRetryErrorClass(int nServiceErrorType)
+{
+    switch (nServiceErrorType) {
+        case ConsoleControl::SESSION_TOKEN_EXPIRES:
+        case ConsoleControl::INVALID_SESSION_TOKEN:
+            return retryErrorSession;
+        case ConsoleControl::GENERIC_SERVICE:
+            return retryErrorService;
+        case ConsoleControl::GSOAP_NO_DATA:
+        case ConsoleControl::GSOAP_HOST_NOT_FOUND:
+        case ConsoleControl::GSOAP_TCP_ERROR:
+        case ConsoleControl::WSA_HOST_UNREACHABLE:
+        case ConsoleControl::WSA_NETWORK_UNREACHABLE:
+        case ConsoleControl::GENERIC_NETWORK_IS_UNREACHABLE:
+        case ConsoleControl::GSOAP_EOF:
+            return retryErrorNetwork;
+        default:
+            break;
+    }
+
+    // Any other matched error was retried as a dropped connection
+    // before the retry policy, and still is.
+    if ( (nServiceErrorType >= 0) && (nServiceErrorType < LAST_SERVICE_TYPES_ENUM) ) {
+        return retryErrorNetwork;
+    }
+
+    return retryErrorNone;
+
+} // End GetRetryErrorClass
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Helper function to check the whether the error is
 //          of the types that allows us to retry.
@@ -1073,22 +1152,8 @@ bool ConsoleControl::CheckServiceErrorToRetry(std::string szErrorMsg, std::strin
     g_bSessionError = false;
     g_nSessionErrorType = -1;
 
-    // Convert the message to lower case for comparison.
-    char szMsgBuffer[MAX_PATH];
-    strcpy(szMsgBuffer, szErrorMsg.c_str());
-
-    _strlwr(szMsgBuffer);
-    std::string szTempErrorMsg = std::string(szMsgBuffer);
-
-    while ( ServiceErrorStrings[nIndex].length() > 0 ) {
-
-        if ( szTempErrorMsg.find(ServiceErrorStrings[nIndex]) != (size_t)-1 ) {
-            bCanRetry = true;
-            break;
-        }
-
-        nIndex ++;
-    }
+    nIndex = GetServiceErrorType(szErrorMsg);
+    bCanRetry = (nIndex >= 0);
 
     if (bCanRetry) {
         g_nSessionErrorType = nIndex;
@@ -1152,22 +1217,8 @@ bool ConsoleControl::CheckServiceErrorToResume(std::string szErrorMsg)
     g_bSessionError = false;
     g_nSessionErrorType = -1;
 
-    // Convert the message to lower case for comparison.
-    char szMsgBuffer[MAX_PATH];
-    strcpy(szMsgBuffer, szErrorMsg.c_str());
-
-    _strlwr(szMsgBuffer);
-    std::string szTempErrorMsg = std::string(szMsgBuffer);
-
-    while ( ServiceErrorStrings[nIndex].length() > 0 ) {
-
-        if ( szTempErrorMsg.find(ServiceErrorStrings[nIndex]) != (size_t)-1 ) {
-            bCanRetry = true;
-            break;
-        }
-
-        nIndex ++;
-    }
+    nIndex = GetServiceErrorType(szErrorMsg);
+    bCanRetry = (nIndex >= 0);
 
     bool bCanResume = false;
 
@@ -1374,6 +1425,43 @@ bool ConsoleControl::VerboseOutput(CmdLine* pCmdLine)
 
 } // End VerboseOutput
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to check the machine readable output
+//          format (/format:tsv or /format:jsonl) for the given command.
+// Requires:
+//      pCmdLine: pointer to the current command
+//      nFormat: returns the RecordFormatType - recordFormatNone if
+//               the argument is not set.
+// Returns: true if the argument is not set or is valid, false otherwise.
+bool ConsoleControl::GetOutputFormat(CmdLine* pCmdLine, int& nFormat)
+{
+    nFormat = RecordWriterTypes::recordFormatNone;
+
+    DiomedeValueArg<std::string>* pFormatArg = NULL;
+    try {
+        pFormatArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_FORMAT);
+    }
+    catch (CmdLineParseException &e) {
+        // catch any exceptions
+        cerr << "error: " << e.error() << " for arg " << pCmdLine->getCommandName() << endl;
+    }
+
+    if ( (pFormatArg == NULL) || (pFormatArg->isSet() == false) ) {
+        return true;
+    }
+
+    nFormat = RecordWriter::ParseFormat(pFormatArg->getValue());
+    if (nFormat == RecordWriterTypes::recordFormatInvalid) {
+        cerr << _T("Format ") << pFormatArg->getValue()
+             << _T(" is not valid - use tsv or jsonl.") << endl;
+        nFormat = RecordWriterTypes::recordFormatNone;
+        return false;
+    }
+
+    return true;
+
+} // End GetOutputFormat
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Helper function to check the config settings for
 //          the copy URL to clipboard value.
@@ -1481,44 +1569,6 @@ bool ConsoleControl::GetConfigOffset(LONG64& l64Offset)
 
 } // End GetConfigOffset
 
-///////////////////////////////////////////////////////////////////////
-// Purpose: Helper function to get the resume intervals.
-// Requires:
-//      listResumeIntervals: vector to hold the results.
-// Returns: true if successful, false otherise.
-bool ConsoleControl::GetConfigResumeIntervals(std::vector<int>& listResumeIntervals)
-{
-    std::string szSetting = _T("");
-
-    // Setup the default values for the intervals.
-    listResumeIntervals.clear();
-
-    int nResumeInterval1 = 5;
-    int nResumeInterval2 = 30;
-    int nResumeInterval3 = 300;
-    int nResumeInterval4 = 600;
-    int nResumeInterval5 = 3600;
-
-    UserProfileData* pProfileData =
-        ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
-    if (pProfileData) {
-        nResumeInterval1 = pProfileData->GetUserProfileInt(GEN_RESUME_INTERVAL_1, GEN_RESUME_INTERVAL_1_DF);
-        nResumeInterval2 = pProfileData->GetUserProfileInt(GEN_RESUME_INTERVAL_2, GEN_RESUME_INTERVAL_2_DF);
-        nResumeInterval3 = pProfileData->GetUserProfileInt(GEN_RESUME_INTERVAL_3, GEN_RESUME_INTERVAL_3_DF);
-        nResumeInterval4 = pProfileData->GetUserProfileInt(GEN_RESUME_INTERVAL_4, GEN_RESUME_INTERVAL_4_DF);
-        nResumeInterval5 = pProfileData->GetUserProfileInt(GEN_RESUME_INTERVAL_5, GEN_RESUME_INTERVAL_5_DF);
-    }
-
-    listResumeIntervals.push_back(nResumeInterval1);
-    listResumeIntervals.push_back(nResumeInterval2);
-    listResumeIntervals.push_back(nResumeInterval3);
-    listResumeIntervals.push_back(nResumeInterval4);
-    listResumeIntervals.push_back(nResumeInterval5);
-
-    return true;
-
-} // End GetConfigResumeIntervals
-
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Helper function to copy a given string to the clipboard.
 // Requires:
@@ -4765,12 +4815,16 @@ void ConsoleControl::ProcessSearchPaymentsCommand(CmdLine* pCmdLine,
 
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Process the upload file command using the SDK CPP lib.
+//          Also processes the sync command, which uploads the new and
+//          changed files of directory trees.
 // Requires:
 //      pCmdLine: current command line
 //      bCommandFinished: true if the command is finished, false otherwise.
+//      bSync: true for the sync command.
 // Returns: nothing
 void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
-                                                  bool& bCommandFinished)
+                                                  bool& bCommandFinished,
+                                                  bool bSync /*false*/)
 {
     // User must be logged in to upload a file.
     if (m_bConnected == false) {
@@ -4796,12 +4850,25 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
     DiomedeSwitchArg* pRecurseArg = NULL;
     DiomedeSwitchArg* pAddPathArg = NULL;
     DiomedeSwitchArg* pCreateMD5DigestArg = NULL;
+    DiomedeSwitchArg* pDeltaArg = NULL;
+    DiomedeValueArg<std::string>* pIncludeArg = NULL;
+    DiomedeValueArg<std::string>* pExcludeArg = NULL;
+    DiomedeValueArg<std::string>* pExcludeDirsArg = NULL;
 
     try {
         pFileArg = (DiomedeUnlabeledMultiArg<std::string>*)pCmdLine->getArg(ARG_FILENAME);
-        pRecurseArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_RECURSE_SWITCH);
         pAddPathArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_PATHMETADATA_SWITCH);
         pCreateMD5DigestArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_HASHMD5_SWITCH);
+
+        // Sync always recurses and compares with its own state.
+        if (bSync == false) {
+            pRecurseArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_RECURSE_SWITCH);
+            pDeltaArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_DELTA_SWITCH);
+        }
+
+        pIncludeArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_INCLUDE);
+        pExcludeArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_EXCLUDE);
+        pExcludeDirsArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_EXCLUDE_DIRS);
     }
     catch (CmdLineParseException &e) {
         // catch any exceptions
@@ -4814,7 +4881,7 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
     }
 
     // Recurse through sub-directories
-    bool bRecurseDirs = false;
+    bool bRecurseDirs = bSync;
     if (pRecurseArg && pRecurseArg->isSet()) {
         bRecurseDirs = true;
     }
@@ -4831,6 +4898,28 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
         bCreateMD5Digest = true;
     }
 
+    // Compare files against the manifest of their last upload.
+    bool bDelta = false;
+    if (pDeltaArg && pDeltaArg->isSet()) {
+        bDelta = true;
+    }
+
+    // Include and exclude patterns for the files enumerated.
+    std::string szIncludePatterns = _T("");
+    if (pIncludeArg && pIncludeArg->isSet()) {
+        szIncludePatterns = pIncludeArg->getValue();
+    }
+
+    std::string szExcludePatterns = _T("");
+    if (pExcludeArg && pExcludeArg->isSet()) {
+        szExcludePatterns = pExcludeArg->getValue();
+    }
+
+    std::string szExcludeDirPatterns = _T("");
+    if (pExcludeDirsArg && pExcludeDirsArg->isSet()) {
+        szExcludeDirPatterns = pExcludeDirsArg->getValue();
+    }
+
 	std::vector<std::string> listFiles = pFileArg->getValue();
 	if (listFiles.size() == 0) {
 
@@ -4862,61 +4951,10 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
     LONG64 l64TotalBytesUploaded = 0;
     int nTotalFilesUploaded = 0;
 
-    // To make sure there is no data leftover from a prior call.
-    if (m_pTaskCreateFile != NULL) {
-        delete m_pTaskCreateFile;
-        m_pTaskCreateFile = NULL;
-    }
-
-    if (m_pTaskSetFileMetaData != NULL) {
-        delete m_pTaskSetFileMetaData;
-        m_pTaskSetFileMetaData = NULL;
-    }
-
-    if (m_pTaskUpload != NULL) {
-        delete m_pTaskUpload;
-        m_pTaskUpload = NULL;
-    }
-
-    if (m_pUploadInfo != NULL) {
-        delete m_pUploadInfo;
-        m_pUploadInfo = NULL;
-    }
-
-    m_pUploadInfo = new UploadFileInfo();
-    if ( false == CheckThread(&m_pUploadInfo->m_commandThread, _T("Upload"))) {
-        delete m_pUploadInfo;
-        m_pUploadInfo = NULL;
+    if (false == BeginUploadSession(bAddPath)) {
         return;
     }
 
-    m_pUploadInfo->ClearAll();
-
-    // "Cache" of created metadata's to allow us to reuse metadata's created
-    // for a given path.
-    m_listMetaDataFullPaths.clear();
-    m_listMetaDataRelativePaths.clear();
-
-    //-----------------------------------------------------------------
-    // Setup our resume information - open/create our resume files for
-    // storing the progress of the upload.
-    //-----------------------------------------------------------------
-    m_pUploadInfo->m_resumeUploadInfoData.SetAddMetaData(bAddPath);
-
-    bool bIsFirstRun = false;
-    int nResumeResult = ResumeManager::Instance()->OpenResumeData(RESUME_UPLOAD_FILENAME, bIsFirstRun);
-    if (nResumeResult != 0) {
-        // If an error occurs, the files will be deleted - not a big issue
-        // since we'll assume loosing the data is not critical.
-        PrintResumeError(nResumeResult, _T("Error initializing resume"));
-    }
-
-    //-----------------------------------------------------------------
-    // Total time and bytes for the upload
-    //-----------------------------------------------------------------
-    m_tdTotalUpload = time_duration(0, 0, 0, 0);
-    m_l64TotalUploadedBytes = 0;
-
     std::string szParentDir = _T("");
     std::string szFileName = _T("");
 
@@ -4938,6 +4976,13 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
 
         szFilePath = listFiles[nIndex];
 
+        if ( bSync && (false == Util::IsDirectory(szFilePath.c_str())) ) {
+            std::string szStatusMsg = _format(_T("...Skipping %s:  Sync requires a directory."),
+                szFilePath.c_str());
+            PrintStatusMsg(szStatusMsg);
+            continue;
+        }
+
         // If the user has used wildcards as part of this path, we need to
         // enumerate the files once again.
         if (m_pFileEnumerator != NULL) {
@@ -4945,10 +4990,11 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
             m_pFileEnumerator = NULL;
         }
 
-        m_pFileEnumerator = new CEnum();
+        m_pFileEnumerator = new FileWalker();
         
 	    #ifdef WIN32
 	        m_pFileEnumerator->m_bNoCaseFiles = true;
+	        m_pFileEnumerator->m_bNoCaseDirs = true;
 	    #endif
 
 	    szParentDir = _T("");
@@ -4972,14 +5018,23 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
             szParentDir = szFilePath;
         }
 
-	    m_pFileEnumerator->m_szIncPatternFiles = szFileName;
+	    // The file name (or its wildcards) selects the files of its
+	    // directory - the include patterns apply to a directory upload.
+	    if (szFileName.length() > 0) {
+	        m_pFileEnumerator->m_szIncPatternFiles = szFileName;
+	    }
+	    else {
+	        m_pFileEnumerator->m_szIncPatternFiles = szIncludePatterns;
+	    }
+
+	    m_pFileEnumerator->m_szExcPatternFiles = szExcludePatterns;
+	    m_pFileEnumerator->m_szExcPatternDirs = szExcludeDirPatterns;
 	    m_pFileEnumerator->m_bRecursive = bRecurseDirs;
-	    m_pFileEnumerator->m_bFullPath = true;
 	    m_pFileEnumerator->m_pfnStatusFunc = &DisplayFileEnumStatus;
 	    m_pFileEnumerator->m_pUserData = this;
 
         /* REMOVE AFTER TESTING...
- 	    m_pFileEnumerator->EnumerateAll(szParentDir);
+ 	    m_pFileEnumerator->WalkAll(szParentDir);
  	    
  	    // If the user cancelled during the enumeration, quit now...
  	    if (m_pFileEnumerator->m_bCancelled) {
@@ -5017,21 +5072,38 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
             break;
         }
 
-	    std::list<std::basic_string<TCHAR> >* pListFiles = m_pFileEnumerator->GetFiles();
-	    std::list<std::basic_string<TCHAR> >::iterator iter = pListFiles->begin();
+	    FileWalkerEntryList& listWalkedFiles = m_pFileEnumerator->GetFiles();
+	    FileWalkerEntryList::iterator iter = listWalkedFiles.begin();
+
+        // Files uploaded by the previous syncs of the directory.
+        SyncState syncState;
+        int nSyncUnchangedFiles = 0;
+        int nSyncUploadedFiles = 0;
+
+        if (bSync) {
+            syncState.Load(szParentDir);
+
+            // Files copied or touched since the last sync are read and
+            // hashed several at a time, not one by one as checked.
+            syncState.HashTouchedFiles(listWalkedFiles);
+        }
 
 	    /*
         cout << "Parent Directory: " << szParentDir << endl;
         int nFileListIndex = 0;
-	    for(; iter != pListFiles->end(); ++iter, ++nFileListIndex) {
-		    cout << "[" << nFileListIndex << "]" << "  " <<  iter->c_str() << endl;
+	    for(; iter != listWalkedFiles.end(); ++iter, ++nFileListIndex) {
+		    cout << "[" << nFileListIndex << "]" << "  " <<  iter->szFilePath << endl;
 	    }
 	    return;
         */
 
         int nResult = 0;
 
-        if (pListFiles->size() == 0) {
+        if ( bSync && (listWalkedFiles.size() == 0) ) {
+            // Nothing left to sync - forget the files of the directory.
+            syncState.Save(true);
+        }
+        else if (listWalkedFiles.size() == 0) {
             ClientLog(UI_COMP, LOG_ERROR, false, _T("UploadFileBlocks for %s."),
                 szFilePath.c_str());
 
@@ -5048,35 +5120,41 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
                 m_pUploadInfo->m_resumeUploadInfoData.SetLastModified(tmLastModified);
             }
 
+            UploadManifest manifest;
+            if ( bDelta && IsUploadUnchanged(szFilePath, manifest) ) {
+                continue;
+            }
+
             nResult = UploadFileBlocks(bAddPath, bCreateMD5Digest);
 
             l64TotalBytesUploaded = m_l64TotalUploadedBytes;
             if (nResult == 0) {
                 nTotalFilesUploaded ++;
+
+                if (bDelta) {
+                    SaveUploadManifest(manifest);
+                }
             }
         }
         else {
             // Loop through the list of files
-	        for(; iter != pListFiles->end(); ++iter) {
+	        for(; iter != listWalkedFiles.end(); ++iter) {
 
-	            std::string szTmpFilePath = (*iter);
+	            std::string szTmpFilePath = iter->szFilePath;
 
-                ClientLog(UI_COMP, LOG_STATUS, false, _T("UploadFileBlocks for %s."),
+                CLIENTLOG_STATUS(UI_COMP, false, _T("UploadFileBlocks for %s."),
                     szTmpFilePath.c_str());
 
-	            m_l64TotalUploadedBytes = 0;
-
-                m_pUploadInfo->ClearAll();
-                ResumeManager::Instance()->ClearResumeMgrData();
+                PrepareFileUpload(*iter, szParentDir);
 
-                m_pUploadInfo->m_szFilePath = szTmpFilePath;
-                m_pUploadInfo->m_szParentDir = szParentDir;
-                m_pUploadInfo->m_resumeUploadInfoData.SetFilePath(szTmpFilePath);
+                UploadManifest manifest;
+                if ( bDelta && IsUploadUnchanged(szTmpFilePath, manifest) ) {
+                    continue;
+                }
 
-                time_t tmLastModified;
-                int nResult = Util::GetFileLastModifiedTime(szTmpFilePath.c_str(), tmLastModified);
-                if (nResult != -1) {
-                    m_pUploadInfo->m_resumeUploadInfoData.SetLastModified(tmLastModified);
+                if ( bSync && (syncState.Check(*iter) == SyncFileStatusTypes::syncFileUnchanged) ) {
+                    nSyncUnchangedFiles++;
+                    continue;
                 }
 
                 nResult = UploadFileBlocks(bAddPath, bCreateMD5Digest);
@@ -5084,6 +5162,22 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
                 l64TotalBytesUploaded += m_l64TotalUploadedBytes;
                 if (nResult == 0) {
                     nTotalFilesUploaded ++;
+
+                    if (bDelta) {
+                        SaveUploadManifest(manifest);
+                    }
+
+                    // Saved as we go, so an interrupted sync keeps most
+                    // of its uploads.
+                    if (bSync) {
+                        syncState.Update(*iter, m_pUploadInfo->m_l64FileID,
+                                         m_pUploadInfo->m_szHashMD5);
+
+                        nSyncUploadedFiles++;
+                        if ((nSyncUploadedFiles % SYNC_STATE_SAVE_INTERVAL) == 0) {
+                            syncState.Save(false);
+                        }
+                    }
                 }
                 else if (g_bSessionError == true) {
                     // If we still have an error, quit - it's unlikely at this point
@@ -5100,6 +5194,18 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
                     break;
                 }
 	        }
+
+            //---------------------------------------------------------
+            // Files no longer found are only dropped once every file
+            // has been checked.
+            //---------------------------------------------------------
+            if (bSync) {
+                syncState.Save(iter == listWalkedFiles.end());
+
+                std::string szStatusMsg = _format(_T("...%s:  %d of %d files unchanged since the last sync."),
+                    szParentDir.c_str(), nSyncUnchangedFiles, (int)listWalkedFiles.size());
+                PrintStatusMsg(szStatusMsg);
+            }
         }
 	}
 
@@ -5119,54 +5225,386 @@ void ConsoleControl::ProcessUploadCommand(CmdLine* pCmdLine,
 	}
 	*/
 
-	// Lots of casting here to eliminate truncation - calculate total seconds
-	// from the accumulated milliseconds.
-
-    //-----------------------------------------------------------------
-    // Calculate bandwidth
-    //-----------------------------------------------------------------
-	std::string szBandwidth = _T("");
-	std::string szBandwidthType = _T("");
+    PrintUploadSummary(l64TotalBytesUploaded, nTotalFilesUploaded);
 
-	StringUtil::FormatBandwidth(l64TotalBytesUploaded, m_tdTotalUpload, szBandwidth, szBandwidthType);
+} // End ProcessUploadCommand
 
-    //-----------------------------------------------------------------
-    // Format duration
-    //-----------------------------------------------------------------
-	std::string szDuration = _T("");
-	std::string szDurationType = _T("");
+///////////////////////////////////////////////////////////////////////
+// Purpose: Setup the upload information, resume data and totals shared
+//          by the files of an upload, sync or watch command.
+// Requires:
+//      bAddPathMetaData: true if the path metadata is added to the files.
+// Returns: true if successful, false otherwise.
+bool ConsoleControl::BeginUploadSession(bool bAddPathMetaData)
+{
+    // To make sure there is no data leftover from a prior call.
+    if (m_pTaskCreateFile != NULL) {
+        delete m_pTaskCreateFile;
+        m_pTaskCreateFile = NULL;
+    }
 
-	StringUtil::FormatDuration(m_tdTotalUpload, szDuration, szDurationType);
+    if (m_pTaskSetFileMetaData != NULL) {
+        delete m_pTaskSetFileMetaData;
+        m_pTaskSetFileMetaData = NULL;
+    }
 
-    //-----------------------------------------------------------------
-    // Format total bytes
-    //-----------------------------------------------------------------
-    std::string szBytes = _T("");
-    std::string szBytesSizeType = _T("");
-    StringUtil::FormatByteSize(l64TotalBytesUploaded, szBytes, szBytesSizeType);
+    if (m_pTaskUpload != NULL) {
+        delete m_pTaskUpload;
+        m_pTaskUpload = NULL;
+    }
 
-    //-----------------------------------------------------------------
-    //-----------------------------------------------------------------
-	std::string szFiles = (nTotalFilesUploaded == 1) ? _T("file") : _T("files");
+    m_progressRenderer.EndFile();
 
-    if (nTotalFilesUploaded > 0) {
-	    _tprintf(_T("Done. %d %s uploaded, %s %s, %s %s, %s %s.\n\r"),
-	        nTotalFilesUploaded, szFiles.c_str(), szBytes.c_str(), szBytesSizeType.c_str(),
-	        szDuration.c_str(), szDurationType.c_str(),
-	        szBandwidth.c_str(), szBandwidthType.c_str());
-	}
-	else {
-	    // No files uploaded - no bandwidth is shown.
-	    _tprintf(_T("Done. %d %s uploaded, %s %s.\n\r"),
-	        nTotalFilesUploaded, szFiles.c_str(), szBytes.c_str(), szBytesSizeType.c_str(),
-	        szDuration.c_str(), szDurationType.c_str());
-	}
+    if (m_pUploadInfo != NULL) {
+        delete m_pUploadInfo;
+        m_pUploadInfo = NULL;
+    }
 
-    if (!m_bSysCommandInput) {
-        PrintNewLine();
+    m_pUploadInfo = new UploadFileInfo();
+    if ( false == CheckThread(&m_pUploadInfo->m_commandThread, _T("Upload"))) {
+        delete m_pUploadInfo;
+        m_pUploadInfo = NULL;
+        return false;
     }
 
-} // End ProcessUploadCommand
+    m_pUploadInfo->ClearAll();
+
+    // "Cache" of created metadata's to allow us to reuse metadata's created
+    // for a given path.
+    m_listMetaDataFullPaths.clear();
+    m_listMetaDataRelativePaths.clear();
+
+    //-----------------------------------------------------------------
+    // Setup our resume information - open/create our resume files for
+    // storing the progress of the upload.
+    //-----------------------------------------------------------------
+    m_pUploadInfo->m_resumeUploadInfoData.SetAddMetaData(bAddPathMetaData);
+
+    bool bIsFirstRun = false;
+    int nResumeResult = ResumeManager::Instance()->OpenResumeData(RESUME_UPLOAD_FILENAME, bIsFirstRun);
+    if (nResumeResult != 0) {
+        // If an error occurs, the files will be deleted - not a big issue
+        // since we'll assume loosing the data is not critical.
+        PrintResumeError(nResumeResult, _T("Error initializing resume"));
+    }
+
+    //-----------------------------------------------------------------
+    // Total time and bytes for the upload
+    //-----------------------------------------------------------------
+    m_tdTotalUpload = time_duration(0, 0, 0, 0);
+    m_l64TotalUploadedBytes = 0;
+    m_progressRenderer.BeginSession();
+    BandwidthLimiter::Instance()->LoadSettings();
+
+    return true;
+
+} // End BeginUploadSession
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Setup the upload information of the next file - the size and
+//          last modified time were read when the file was found.
+// Requires:
+//      fileEntry: file to upload
+//      szParentDir: directory the relative path metadata starts from.
+// Returns: nothing
+void ConsoleControl::PrepareFileUpload(const FileWalkerEntry& fileEntry,
+                                       const std::string& szParentDir)
+{
+    m_l64TotalUploadedBytes = 0;
+
+    m_pUploadInfo->ClearAll();
+    ResumeManager::Instance()->ClearResumeMgrData();
+
+    m_pUploadInfo->m_szFilePath = fileEntry.szFilePath;
+    m_pUploadInfo->m_szParentDir = szParentDir;
+    m_pUploadInfo->m_resumeUploadInfoData.SetFilePath(fileEntry.szFilePath);
+
+    m_pUploadInfo->m_l64FileSize = fileEntry.l64FileSize;
+    m_pUploadInfo->m_resumeUploadInfoData.SetFileSize(fileEntry.l64FileSize);
+    m_pUploadInfo->m_resumeUploadInfoData.SetLastModified(fileEntry.tmLastModified);
+
+} // End PrepareFileUpload
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Print the files, bytes, duration and bandwidth of an upload,
+//          sync or watch command.
+// Requires:
+//      l64TotalBytesUploaded: bytes uploaded
+//      nTotalFilesUploaded: files uploaded
+// Returns: nothing
+void ConsoleControl::PrintUploadSummary(LONG64 l64TotalBytesUploaded,
+                                        int nTotalFilesUploaded)
+{
+	// Lots of casting here to eliminate truncation - calculate total seconds
+	// from the accumulated milliseconds.
+
+    //-----------------------------------------------------------------
+    // Calculate bandwidth
+    //-----------------------------------------------------------------
+	std::string szBandwidth = _T("");
+	std::string szBandwidthType = _T("");
+
+	StringUtil::FormatBandwidth(l64TotalBytesUploaded, m_tdTotalUpload, szBandwidth, szBandwidthType);
+
+    //-----------------------------------------------------------------
+    // Format duration
+    //-----------------------------------------------------------------
+	std::string szDuration = _T("");
+	std::string szDurationType = _T("");
+
+	StringUtil::FormatDuration(m_tdTotalUpload, szDuration, szDurationType);
+
+    //-----------------------------------------------------------------
+    // Format total bytes
+    //-----------------------------------------------------------------
+    std::string szBytes = _T("");
+    std::string szBytesSizeType = _T("");
+    StringUtil::FormatByteSize(l64TotalBytesUploaded, szBytes, szBytesSizeType);
+
+    //-----------------------------------------------------------------
+    //-----------------------------------------------------------------
+	std::string szFiles = (nTotalFilesUploaded == 1) ? _T("file") : _T("files");
+
+    if (nTotalFilesUploaded > 0) {
+	    _tprintf(_T("Done. %d %s uploaded, %s %s, %s %s, %s %s.\n\r"),
+	        nTotalFilesUploaded, szFiles.c_str(), szBytes.c_str(), szBytesSizeType.c_str(),
+	        szDuration.c_str(), szDurationType.c_str(),
+	        szBandwidth.c_str(), szBandwidthType.c_str());
+	}
+	else {
+	    // No files uploaded - no bandwidth is shown.
+	    _tprintf(_T("Done. %d %s uploaded, %s %s.\n\r"),
+	        nTotalFilesUploaded, szFiles.c_str(), szBytes.c_str(), szBytesSizeType.c_str(),
+	        szDuration.c_str(), szDurationType.c_str());
+	}
+
+    TransferMetrics::Instance()->WriteSummary();
+
+    if (!m_bSysCommandInput) {
+        PrintNewLine();
+    }
+
+} // End PrintUploadSummary
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Process the watch command - uploads the files written or
+//          moved into directories as they arrive, until CTRL+C.  The
+//          uploads are recorded in the sync state of each directory,
+//          so a later sync doesn't upload them again.
+// Requires:
+//      pCmdLine: current command line
+//      bCommandFinished: true if the command is finished, false otherwise.
+// Returns: nothing
+void ConsoleControl::ProcessWatchCommand(CmdLine* pCmdLine,
+                                         bool& bCommandFinished)
+{
+    // User must be logged in to upload a file.
+    if (m_bConnected == false) {
+        bCommandFinished = true;
+        LoggedInUserError(_T("Cannot watch directories"));
+	    ClientLog(UI_COMP, LOG_ERROR, false,
+	        _T("Watch directories: user not logged into service."));
+	    return;
+    }
+
+    bCommandFinished = false;
+
+    DiomedeUnlabeledMultiArg<std::string>* pFileArg = NULL;
+    DiomedeSwitchArg* pRecurseArg = NULL;
+    DiomedeSwitchArg* pAddPathArg = NULL;
+    DiomedeSwitchArg* pCreateMD5DigestArg = NULL;
+    DiomedeValueArg<std::string>* pDelayArg = NULL;
+    DiomedeValueArg<std::string>* pIncludeArg = NULL;
+    DiomedeValueArg<std::string>* pExcludeArg = NULL;
+    DiomedeValueArg<std::string>* pExcludeDirsArg = NULL;
+
+    try {
+        pFileArg = (DiomedeUnlabeledMultiArg<std::string>*)pCmdLine->getArg(ARG_FILENAME);
+        pRecurseArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_RECURSE_SWITCH);
+        pAddPathArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_PATHMETADATA_SWITCH);
+        pCreateMD5DigestArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_HASHMD5_SWITCH);
+        pDelayArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_WATCH_DELAY);
+        pIncludeArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_INCLUDE);
+        pExcludeArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_EXCLUDE);
+        pExcludeDirsArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_EXCLUDE_DIRS);
+    }
+    catch (CmdLineParseException &e) {
+        // catch any exceptions
+        cerr << "error: " << e.error() << " for arg " << CMD_WATCH << endl;
+    }
+
+    if ( pFileArg == NULL) {
+        bCommandFinished = true;
+        return;
+    }
+
+	std::vector<std::string> listFiles = pFileArg->getValue();
+	if (listFiles.size() == 0) {
+
+	    if (pFileArg->getRepromptCount() == 0) {
+	        m_szCommandPrompt = _T("Directories: ");
+	        pFileArg->incrementRepromptCount();
+	    }
+	    else if (pFileArg->getRepromptCount() < 2) {
+	        pFileArg->incrementRepromptCount();
+	    }
+	    else {
+            pCmdLine->getHelpVisitor()->visit();
+            bCommandFinished = true;
+	    }
+
+	    return;
+	}
+
+    bCommandFinished = true;
+
+    if (false == DirWatcher::IsSupported()) {
+        PrintStatusMsg(_T("Watch is not supported on this platform - use sync instead."));
+        return;
+    }
+
+    DirWatcher dirWatcher;
+
+    if (pDelayArg && pDelayArg->isSet()) {
+        dirWatcher.m_nDelay = atoi(pDelayArg->getValue().c_str()) * 1000;
+        if (dirWatcher.m_nDelay < 0) {
+            PrintStatusMsg(_T("Watch: the delay must be 0 seconds or more."));
+            return;
+        }
+    }
+
+    if (pIncludeArg && pIncludeArg->isSet()) {
+        dirWatcher.m_szIncPatternFiles = pIncludeArg->getValue();
+    }
+
+    if (pExcludeArg && pExcludeArg->isSet()) {
+        dirWatcher.m_szExcPatternFiles = pExcludeArg->getValue();
+    }
+
+    if (pExcludeDirsArg && pExcludeDirsArg->isSet()) {
+        dirWatcher.m_szExcPatternDirs = pExcludeDirsArg->getValue();
+    }
+
+    dirWatcher.m_bRecursive = (pRecurseArg && pRecurseArg->isSet());
+
+    bool bAddPath = (pAddPathArg && pAddPathArg->isSet());
+    bool bCreateMD5Digest = (pCreateMD5DigestArg && pCreateMD5DigestArg->isSet());
+
+    PrintNewLine();
+
+	for ( int nIndex = 0; static_cast<unsigned int>(nIndex) < listFiles.size(); nIndex++ ) {
+        std::string szDirectory = listFiles[nIndex];
+        std::string szStatusMsg = _T("");
+
+        if (false == Util::IsDirectory(szDirectory.c_str())) {
+            szStatusMsg = _format(_T("...Skipping %s:  Watch requires a directory."),
+                szDirectory.c_str());
+            PrintStatusMsg(szStatusMsg);
+        }
+        else if (false == dirWatcher.AddRoot(szDirectory)) {
+            szStatusMsg = _format(_T("...Skipping %s:  The directory could not be watched."),
+                szDirectory.c_str());
+            PrintStatusMsg(szStatusMsg);
+        }
+	}
+
+    if (dirWatcher.GetRootCount() == 0) {
+        return;
+    }
+
+    if (false == BeginUploadSession(bAddPath)) {
+        return;
+    }
+
+    // Make sure we can trap CTRL+C
+    SetConsoleControlHandler();
+
+    std::string szStatusMsg = _format(_T("...Watching %d %s - CTRL+C to stop."),
+        dirWatcher.GetRootCount(), (dirWatcher.GetRootCount() == 1) ? _T("directory") : _T("directories"));
+    PrintStatusMsg(szStatusMsg);
+
+    //-----------------------------------------------------------------
+    // Upload the files as the watcher returns them - the sync state of
+    // each directory is read on its first file.
+    //-----------------------------------------------------------------
+    LONG64 l64TotalBytesUploaded = 0;
+    int nTotalFilesUploaded = 0;
+    bool bStopped = false;
+
+    std::map<std::string, SyncState> listSyncStates;
+    DirWatcherEntryList listReadyFiles;
+
+    while ( (bStopped == false) && (g_bUsingCtrlKey == false) ) {
+
+        if (false == dirWatcher.WaitForFiles(listReadyFiles, DIRWATCHER_WAIT_INTERVAL)) {
+            PrintStatusMsg(_T("Watch: the directory events could not be read."));
+            break;
+        }
+
+        for (int nIndex = 0; nIndex < (int)listReadyFiles.size(); nIndex++) {
+            const DirWatcherEntry& watcherEntry = listReadyFiles[nIndex];
+
+            if (listSyncStates.find(watcherEntry.szRootDir) == listSyncStates.end()) {
+                listSyncStates[watcherEntry.szRootDir].Load(watcherEntry.szRootDir);
+            }
+
+            SyncState& syncState = listSyncStates[watcherEntry.szRootDir];
+
+            // Every file is returned after lost events - only those
+            // changed since their last upload are uploaded.
+            if ( watcherEntry.bRescan &&
+                 (syncState.Check(watcherEntry.fileEntry) == SyncFileStatusTypes::syncFileUnchanged) ) {
+                continue;
+            }
+
+            CLIENTLOG_STATUS(UI_COMP, false, _T("UploadFileBlocks for %s."),
+                watcherEntry.fileEntry.szFilePath.c_str());
+
+            PrepareFileUpload(watcherEntry.fileEntry, watcherEntry.szRootDir);
+
+            int nResult = UploadFileBlocks(bAddPath, bCreateMD5Digest);
+
+            l64TotalBytesUploaded += m_l64TotalUploadedBytes;
+            if (nResult == 0) {
+                nTotalFilesUploaded ++;
+
+                syncState.Update(watcherEntry.fileEntry, m_pUploadInfo->m_l64FileID,
+                                 m_pUploadInfo->m_szHashMD5);
+
+                if ((nTotalFilesUploaded % SYNC_STATE_SAVE_INTERVAL) == 0) {
+                    syncState.Save(false);
+                }
+            }
+            else if ( (g_bSessionError == true) ||
+                      (nResult == DIOMEDE_COMMAND_STOPPED_BY_USER) ||
+                      (nResult == DIOMEDE_CREATE_THREAD_ERROR) ) {
+                // As with upload - it's unlikely we can recover.
+                bStopped = true;
+                break;
+            }
+        }
+
+        // Saved once the files ready together are uploaded.
+        if (listReadyFiles.size() > 0) {
+            std::map<std::string, SyncState>::iterator iter = listSyncStates.begin();
+            for (; iter != listSyncStates.end(); ++iter) {
+                iter->second.Save(false);
+            }
+        }
+    }
+
+    // CTRL+C is how the watch ends - not a cancel.
+    g_bUsingCtrlKey = false;
+
+    if (dirWatcher.GetPendingCount() > 0) {
+        szStatusMsg = _format(_T("...%d files not uploaded - they were still being written."),
+            dirWatcher.GetPendingCount());
+        PrintStatusMsg(szStatusMsg);
+    }
+
+    PrintUploadSummary(l64TotalBytesUploaded, nTotalFilesUploaded);
+
+} // End ProcessWatchCommand
 
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Process the resume file command using the SDK CPP lib.
@@ -5191,12 +5629,14 @@ void ConsoleControl::ProcessResumeCommand(CmdLine* pCmdLine,
     DiomedeUnlabeledMultiArg<std::string>* pFileArg = NULL;
     DiomedeSwitchArg* pListArg = NULL;
     DiomedeSwitchArg* pClearListArg = NULL;
+    DiomedeValueArg<std::string>* pParallelArg = NULL;
     DiomedeValueArg<std::string>* pOutputArg = NULL;
 
     try {
         pFileArg = (DiomedeUnlabeledMultiArg<std::string>*)pCmdLine->getArg(ARG_FILENAME);
         pListArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_RESUME_LIST_SWITCH);
         pClearListArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_RESUME_CLEAR_SWITCH);
+        pParallelArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_RESUME_PARALLEL);
         pOutputArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_OUTPUT);
     }
     catch (CmdLineParseException &e) {
@@ -5303,6 +5743,8 @@ void ConsoleControl::ProcessResumeCommand(CmdLine* pCmdLine,
         m_pTaskUpload = NULL;
     }
 
+    m_progressRenderer.EndFile();
+
     if (m_pUploadInfo != NULL) {
         delete m_pUploadInfo;
         m_pUploadInfo = NULL;
@@ -5346,6 +5788,8 @@ void ConsoleControl::ProcessResumeCommand(CmdLine* pCmdLine,
 
     m_tdTotalUpload = time_duration(0, 0, 0, 0);
     m_l64TotalUploadedBytes = 0;
+    m_progressRenderer.BeginSession();
+    BandwidthLimiter::Instance()->LoadSettings();
 
     bool bAddPath = false;
     bool bCreateMD5Digest = false;
@@ -5359,7 +5803,28 @@ void ConsoleControl::ProcessResumeCommand(CmdLine* pCmdLine,
 
     PrintNewLine();
 
-	for (t_resumeUploadInfoList::iterator iter = listResumeUploadInfo.begin();
+    //-----------------------------------------------------------------
+    // With /parallel, the entries are spread over concurrent workers.
+    //-----------------------------------------------------------------
+    int nParallel = 1;
+    if (pParallelArg && pParallelArg->isSet()) {
+        nParallel = atoi(pParallelArg->getValue().c_str());
+    }
+
+    t_resumeUploadInfoList::iterator iterStart = listResumeUploadInfo.begin();
+
+    if (nParallel > 1) {
+        nResult = ResumeUploadsParallel(listResumeUploadInfo, nParallel, nTotalFilesUploaded,
+                                        l64TotalBytesUploaded);
+        if (nResult != 0) {
+            PrintStatusMsg(_T("Resume: failed to create the upload threads."));
+        }
+
+        // Nothing left for the serial loop below.
+        iterStart = listResumeUploadInfo.end();
+    }
+
+	for (t_resumeUploadInfoList::iterator iter = iterStart;
 	     iter != listResumeUploadInfo.end(); iter++) {
 
 		resumeUploadInfoData = *iter;
@@ -5375,6 +5840,13 @@ void ConsoleControl::ProcessResumeCommand(CmdLine* pCmdLine,
 		    continue;
 		}
 
+        // Make sure the part already uploaded is still valid.
+        if ( resumeUploadInfoData.HasResumeFileChanged() ) {
+            PrintStatusMsg(resumeUploadInfoData.GetFilePath() +
+                           _T(": file has changed.  Resume skipped."), true);
+            continue;
+        }
+
         szFilePath = resumeUploadInfoData.GetFilePath();
         l64FileID = resumeUploadInfoData.GetFileID();
 
@@ -5447,6 +5919,8 @@ void ConsoleControl::ProcessResumeCommand(CmdLine* pCmdLine,
 	        szDuration.c_str(), szDurationType.c_str());
 	}
 
+    TransferMetrics::Instance()->WriteSummary();
+
     if ( ( (int)listResumeUploadInfo.size() > 0)&& !m_bSysCommandInput ) {
         PrintNewLine();
     }
@@ -5908,8 +6382,14 @@ void ConsoleControl::UpdateUploadStatus(int nUploadStatus, LONG64 l64CurrentByte
     m_pUploadInfo->m_nUploadStatus = nUploadStatus;
     m_pUploadInfo->m_nBytesRead = static_cast<int>(m_l64TotalUploadedBytes - l64CurrentBytes);
 
-    std::string szUploadFile = _T("");
-    int nPercent = 0;
+    // Chunk latency is measured from the send to the send complete.
+    if (nUploadStatus == DIOMEDE::uploadSending) {
+        TransferMetrics::Instance()->ChunkStarted();
+    }
+
+    // Only formatted when the file status changes - chunk progress is
+    // drawn by the progress renderer.
+    FixedFormatBuffer<MAX_TIMER_TEXT> szUploadFile;
 
     // We'll only update the status when the send is complete.  Status is sent when
     // the "send" occurs as well, but here we'll track only the completed sent.
@@ -5919,14 +6399,14 @@ void ConsoleControl::UpdateUploadStatus(int nUploadStatus, LONG64 l64CurrentByte
 
     switch (nUploadStatus) {
         case DIOMEDE::uploadCreateFile:
-            szUploadFile = _format(_T("%s (%s %s)... creating "),
-                m_pUploadInfo->m_szFormattedFileName.c_str(), m_pUploadInfo->m_szFormattedBytes.c_str(),
-                m_pUploadInfo->m_szFormattedBytesType.c_str(), nPercent);
+            szUploadFile << m_pUploadInfo->m_szFormattedFileName << _T(" (")
+                         << m_pUploadInfo->m_szFormattedBytes << _T(' ')
+                         << m_pUploadInfo->m_szFormattedBytesType << _T(")... creating ");
 
             if (m_pUploadInfo->m_msgTimer.IsStarted() == false) {
-                m_pUploadInfo->m_msgTimer.Start(szUploadFile);
+                m_pUploadInfo->m_msgTimer.Start(szUploadFile.c_str());
             }
-            m_pUploadInfo->m_msgTimer.ContinueTime(szUploadFile);
+            m_pUploadInfo->m_msgTimer.ContinueTime(szUploadFile.c_str());
             g_bCanContinueTimer = true;
             break;
         case DIOMEDE::uploadCreateFileComplete:
@@ -5938,43 +6418,44 @@ void ConsoleControl::UpdateUploadStatus(int nUploadStatus, LONG64 l64CurrentByte
             break;
         case DIOMEDE::uploadStarted:
            {
-                // In the case of resume, we can calculate the percent completed so far.
-	            nPercent =  0;
-                if (m_l64TotalUploadedBytes > 0) {
-	                nPercent =  (m_l64TotalUploadedBytes == m_pUploadInfo->m_l64FileSize) ? 100 :
-	                    (int) (((float)m_l64TotalUploadedBytes/(float)m_pUploadInfo->m_l64FileSize) * 100);
-                }
-                szUploadFile = _format(_T("%s (%s %s)... %d%%"),
-                    m_pUploadInfo->m_szFormattedFileName.c_str(),
-                    m_pUploadInfo->m_szFormattedBytes.c_str(),
-                    m_pUploadInfo->m_szFormattedBytesType.c_str(), nPercent);
+                szUploadFile << m_pUploadInfo->m_szFormattedFileName << _T(" (")
+                             << m_pUploadInfo->m_szFormattedBytes << _T(' ')
+                             << m_pUploadInfo->m_szFormattedBytesType << _T(')');
 
                 // Restart the timer - if we're resuming mid-upload (and not via the
                 // "resume" command), the timer is merely paused and does not need
                 // restarting.
                 if ( m_pUploadInfo->m_msgTimer.IsPaused() == false ) {
                     m_pUploadInfo->m_msgTimer.SetShowProgress(true);
-                    m_pUploadInfo->m_msgTimer.Start(szUploadFile);
+                    m_pUploadInfo->m_msgTimer.Start(szUploadFile.c_str());
                 }
-                g_bCanContinueTimer = true;
+                else {
+                    m_pUploadInfo->m_msgTimer.ContinueTime(szUploadFile.c_str());
+                }
+
+                // Progress is drawn by the renderer from here on - in the case of
+                // resume, the percent includes the bytes uploaded so far.
+                m_progressRenderer.BeginFile(&m_pUploadInfo->m_msgTimer,
+                    m_pUploadInfo->m_l64FileSize, m_l64TotalUploadedBytes);
             }
             break;
 
         case DIOMEDE::uploadSendComplete:
            {
                 // To allow resume, the upload bytes must be updated on success only.
+                // The chunk is measured against this file's last send complete.
+                LONG64 l64ChunkBytes = l64CurrentBytes - m_pUploadInfo->m_l64SentBytes;
+                if (l64ChunkBytes < 0) {
+                    l64ChunkBytes = 0;
+                }
+                m_pUploadInfo->m_l64SentBytes = l64CurrentBytes;
                 m_l64TotalUploadedBytes = l64CurrentBytes;
-
-	            nPercent =  (m_l64TotalUploadedBytes == m_pUploadInfo->m_l64FileSize) ? 100 :
-	                (int) (((float)m_l64TotalUploadedBytes/(float)m_pUploadInfo->m_l64FileSize) * 100);
-
-                szUploadFile = _format(_T("%s (%s %s)... %d%%"),
-                    m_pUploadInfo->m_szFormattedFileName.c_str(),
-                    m_pUploadInfo->m_szFormattedBytes.c_str(),
-                    m_pUploadInfo->m_szFormattedBytesType.c_str(), nPercent);
+                TransferMetrics::Instance()->ChunkComplete(l64CurrentBytes);
+                m_progressRenderer.UpdateBytes(l64CurrentBytes);
 
                 m_pUploadInfo->m_resumeUploadInfoData.ResetNextResumeIntervalType();
                 m_pUploadInfo->m_resumeUploadInfoData.SetBytesRead(m_l64TotalUploadedBytes);
+                m_pUploadInfo->m_resumeUploadInfoData.UpdateFingerprints();
 
                 WriteResumeUploadData(m_pUploadInfo->m_resumeUploadInfoData, _T("Upload callback"));
 
@@ -5982,9 +6463,17 @@ void ConsoleControl::UpdateUploadStatus(int nUploadStatus, LONG64 l64CurrentByte
                 // the create file portion.  With resume, the file has already
                 // been created, so we need to start the timer here.
                 if (m_pUploadInfo->m_msgTimer.IsStarted() == false) {
-                    m_pUploadInfo->m_msgTimer.Start(szUploadFile);
+                    szUploadFile << m_pUploadInfo->m_szFormattedFileName << _T(" (")
+                                 << m_pUploadInfo->m_szFormattedBytes << _T(' ')
+                                 << m_pUploadInfo->m_szFormattedBytesType << _T(')');
+
+                    m_pUploadInfo->m_msgTimer.Start(szUploadFile.c_str());
+                    m_progressRenderer.BeginFile(&m_pUploadInfo->m_msgTimer,
+                        m_pUploadInfo->m_l64FileSize, l64CurrentBytes);
                 }
-                m_pUploadInfo->m_msgTimer.ContinueTime(szUploadFile);
+
+                // Holds up the next chunk when over the bandwidth limit.
+                BandwidthLimiter::Instance()->Throttle(m_uploadBandwidth, l64ChunkBytes);
             }
             break;
         default:
@@ -6071,7 +6560,7 @@ int ConsoleControl::RepeatLastUploadTask(DiomedeTask* pTask)
         m_szSessionToken = taskLogin.GetSessionToken();
         g_nSessionRetries = MAX_LOGIN_RETRIES;
 
-	    ClientLog(UI_COMP, LOG_STATUS, false,
+	    CLIENTLOG_STATUS(UI_COMP, false,
 	        _T("Repeat last command: new session token %s."), m_szSessionToken.c_str());
 
         UserProfileData* pProfileData =
@@ -6091,6 +6580,8 @@ int ConsoleControl::RepeatLastUploadTask(DiomedeTask* pTask)
     // has occurred.
     g_bCanContinueTimer = false;
 
+    TransferMetrics::Instance()->RecordRetry(_T("session"));
+
     pTask->ResetTask();
     pTask->SetSessionToken(m_szSessionToken);
 
@@ -6152,9 +6643,35 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
     }
 
     //-----------------------------------------------------------------
-    // In case of resume, set up the first and last start time values.
+    // The service stores every byte of the file, holes included, so
+    // sparse files are uploaded in full.  Note them in the log - the
+    // download /sparse option recreates the holes.  Only the file
+    // system is asked - the file isn't read an extra time to find
+    // zero blocks.
     //-----------------------------------------------------------------
-    time_t rawTime;
+    if (IsClientLogEnabled(UI_COMP, LOG_STATUS)) {
+        FileDataExtentList listExtents;
+        LONG64 l64DataBytes = 0;
+
+        if ( Util::GetFileDataExtents(m_pUploadInfo->m_szFilePath.c_str(), listExtents, l64DataBytes,
+                                      false) &&
+             (l64DataBytes < m_pUploadInfo->m_l64FileSize) ) {
+            #ifdef WIN32
+                ClientLog(UI_COMP, LOG_STATUS, false, _T("File %s is sparse: %I64d of %I64d bytes in %d extents."),
+                          m_pUploadInfo->m_szFilePath.c_str(), l64DataBytes, m_pUploadInfo->m_l64FileSize,
+                          (int)listExtents.size());
+            #else
+                ClientLog(UI_COMP, LOG_STATUS, false, _T("File %s is sparse: %lld of %lld bytes in %d extents."),
+                          m_pUploadInfo->m_szFilePath.c_str(), l64DataBytes, m_pUploadInfo->m_l64FileSize,
+                          (int)listExtents.size());
+            #endif
+        }
+    }
+
+    //-----------------------------------------------------------------
+    // In case of resume, set up the first and last start time values.
+    //-----------------------------------------------------------------
+    time_t rawTime;
     time ( &rawTime );
 
     if (m_pUploadInfo->m_resumeUploadInfoData.GetFirstStart() == 0) {
@@ -6191,6 +6708,18 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
                                                      m_pUploadInfo->m_resumeUploadInfoData);
     #endif
 
+    //----------------------------------------------------------------
+    // /md5: the digest is sent along with the file.  It's kept with
+    // the upload info, so sync and watch record it without reading
+    // the file again.
+    //----------------------------------------------------------------
+    if ( bCreateMD5Digest && (m_pUploadInfo->m_szHashMD5.length() == 0) ) {
+        unsigned char szDigest[MD5_DIGEST_LENGTH];
+        if (StringUtil::MakeFileMd5Digest((char*)m_pUploadInfo->m_szFilePath.c_str(), szDigest) == 0) {
+            StringUtil::ConvertDigestToString(m_pUploadInfo->m_szHashMD5, szDigest);
+        }
+    }
+
     //----------------------------------------------------------------
     // Setup the upload data structure - in the normal upload
     // scenario, the total upload bytes is 0.  When resuming,
@@ -6204,6 +6733,7 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
 
     uploadData.SetTotalUploadBytes(l64TotalUploadedBytes);
     uploadData.SetHashMD5(m_pUploadInfo->m_szHashMD5);
+    m_pUploadInfo->m_l64SentBytes = l64TotalUploadedBytes;
     uploadData.SetUploadCallback(&UploadStatus);
     uploadData.SetUploadUser(this);
 
@@ -6306,6 +6836,10 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
         //-----------------------------------------------------------------
     }
 
+    TransferMetrics::Instance()->BeginTransfer(TransferMetricsTypes::transferUpload,
+        m_pUploadInfo->m_szFilePath, m_pUploadInfo->m_l64FileID, m_pUploadInfo->m_l64FileSize,
+        l64TotalUploadedBytes);
+
     //-----------------------------------------------------------------
     // Process upload
     //-----------------------------------------------------------------
@@ -6322,11 +6856,8 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
 
     m_pUploadInfo->m_commandThread.Event(m_pTaskUpload);
 
+    // Progress is drawn by the renderer once the upload has started.
     while ( m_pTaskUpload->Status() != TaskStatusCompleted ) {
-        if (g_bCanContinueTimer) {
-            m_pUploadInfo->m_msgTimer.ContinueTime();
-        }
-
         if (false == PauseProcess() ) {
             m_pTaskUpload->CancelTask();
         }
@@ -6346,10 +6877,12 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
         while (m_pUploadInfo->m_nUploadStatus < DIOMEDE::uploadComplete) {
             // Waiting for status to change to complete - callback
             // into this object updates the upload status.
-            m_pUploadInfo->m_msgTimer.ContinueTime();
+            PauseProcess();
         }
     }
 
+    m_progressRenderer.EndFile();
+
     //-------------------------------------------------------------
     // Check results
     //-------------------------------------------------------------
@@ -6362,9 +6895,11 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
 
 	        bool bUserCancelled = false;
 	        int nResumeResult = ResumeCurrentUpload(m_pTaskUpload, bUserCancelled);
+	        m_progressRenderer.EndFile();
 
 	        if (nResumeResult != SOAP_OK) {
 	            // ResumeCurrentUpload will handle any errors that may occur.
+	            TransferMetrics::Instance()->EndTransfer(nResumeResult);
                 return nResumeResult;
 	        }
 	        else {
@@ -6381,10 +6916,13 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
 	        // will be caught in CreateFile...
 	        PrintServiceError(stderr, szErrorMsg);
 	        ClientLog(UI_COMP, LOG_ERROR, false,_T("Upload failed: (%d) %s"), nResult, szErrorMsg.c_str());
+	        TransferMetrics::Instance()->EndTransfer(nResult);
             return nResult;
         }
     }
 
+    TransferMetrics::Instance()->EndTransfer(nResult);
+
     // If an error has occurred, we'll return above without handling the
     // last "done".   Reset the text to get rid of the number of bytes
     // upload thus far...
@@ -6422,6 +6960,114 @@ int ConsoleControl::UploadFileBlocks(bool bAddPathMetaData /*false*/,
 
 } // End UploadFileBlocks
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Upload /delta - chunks the file and compares the chunks
+//          with the manifest saved by the previous upload of the path.
+//          The service stores whole files, so a changed file is still
+//          uploaded in full; the changed chunks are reported and logged.
+// Requires:
+//      szFilePath: file to upload
+//      manifest: set to the manifest of the file, to be saved once the
+//                upload completes.
+// Returns: true if the file is unchanged and the upload can be skipped,
+//          false otherwise.
+bool ConsoleControl::IsUploadUnchanged(const std::string& szFilePath, UploadManifest& manifest)
+{
+    if (manifest.Build(szFilePath) == false) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Upload delta: %s could not be read."),
+            szFilePath.c_str());
+        return false;
+    }
+
+    UploadManifest previousManifest;
+    if (previousManifest.Load(szFilePath) == false) {
+        return false;
+    }
+
+    int nChangedChunks = 0;
+    LONG64 l64ChangedBytes = 0;
+    t_manifestChunkList listChangedChunks;
+
+    manifest.Compare(previousManifest, nChangedChunks, l64ChangedBytes, &listChangedChunks);
+
+    std::string szFileName = _T("");
+    Util::GetFileName(szFilePath, szFileName);
+
+    //-----------------------------------------------------------------
+    // Same chunks in the same order - nothing to upload.  Reordered or
+    // repeated chunks have no new digests, so the changed count alone
+    // can't tell.
+    //-----------------------------------------------------------------
+    if (manifest.IsIdentical(previousManifest)) {
+
+        std::string szFileID = _T("");
+        StringUtil::InsertSeparator(previousManifest.GetFileID(), szFileID);
+
+        std::string szStatusMsg = _format(_T("...Skipping %s:  Unchanged since the last upload (file ID %s)."),
+            szFileName.c_str(), szFileID.c_str());
+        PrintStatusMsg(szStatusMsg);
+        return true;
+    }
+
+    //-----------------------------------------------------------------
+    // Report the changes.
+    //-----------------------------------------------------------------
+    std::string szChangedBytes = _T("");
+    std::string szChangedBytesType = _T("");
+    std::string szFileBytes = _T("");
+    std::string szFileBytesType = _T("");
+
+    StringUtil::FormatByteSize(l64ChangedBytes, szChangedBytes, szChangedBytesType);
+    StringUtil::FormatByteSize(manifest.GetFileSize(), szFileBytes, szFileBytesType);
+
+    std::string szStatusMsg = _format(_T("...%s:  %d of %d chunks changed (%s %s of %s %s)."),
+        szFileName.c_str(), nChangedChunks, manifest.GetChunkCount(),
+        szChangedBytes.c_str(), szChangedBytesType.c_str(),
+        szFileBytes.c_str(), szFileBytesType.c_str());
+    PrintStatusMsg(szStatusMsg);
+
+    if (IsClientLogEnabled(UI_COMP, LOG_STATUS)) {
+        std::string szOffset = _T("");
+        std::string szLength = _T("");
+
+        for (int nIndex = 0; nIndex < (int)listChangedChunks.size(); nIndex++) {
+            StringUtil::InsertSeparator(listChangedChunks[nIndex].l64Offset, szOffset);
+            StringUtil::InsertSeparator(listChangedChunks[nIndex].l64Length, szLength);
+
+            ClientLog(UI_COMP, LOG_STATUS, false, _T("Upload delta: %s changed at %s, %s bytes."),
+                szFilePath.c_str(), szOffset.c_str(), szLength.c_str());
+        }
+    }
+
+    return false;
+
+} // End IsUploadUnchanged
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Save the manifest of a completed upload for the next
+//          upload /delta of the same path.
+// Requires:
+//      manifest: manifest built by IsUploadUnchanged
+// Returns: nothing
+void ConsoleControl::SaveUploadManifest(UploadManifest& manifest)
+{
+    if (manifest.GetChunkCount() == 0) {
+        return;
+    }
+
+    // The file may have changed during the upload.
+    time_t tmLastModified = 0;
+    if ( (Util::GetFileLastModifiedTime(manifest.GetFilePath().c_str(), tmLastModified) == -1) ||
+         (tmLastModified != manifest.GetLastModified()) ||
+         (Util::GetFileLength64(manifest.GetFilePath().c_str()) != manifest.GetFileSize()) ) {
+        return;
+    }
+
+    manifest.SetFileID(m_pUploadInfo->m_l64FileID);
+    manifest.Save();
+
+} // End SaveUploadManifest
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Handles the initial file creation.  Helper function to
 //          ProcessUploadCommand.
@@ -6595,7 +7241,7 @@ int ConsoleControl::RepeatLastCreateFileTask(DiomedeTask* pTask)
         m_szSessionToken = taskLogin.GetSessionToken();
         g_nSessionRetries = MAX_LOGIN_RETRIES;
 
-	    ClientLog(UI_COMP, LOG_STATUS, false,
+	    CLIENTLOG_STATUS(UI_COMP, false,
 	        _T("Repeat last command: new session token %s."), m_szSessionToken.c_str());
 
         UserProfileData* pProfileData =
@@ -6654,9 +7300,19 @@ int ConsoleControl::ResumeCreateFile(DIOMEDE_CONSOLE::CreateFileTask* pTask, boo
     UploadImpl* pUploadImpl = pTask->GetUploadImpl();
     ResumeUploadInfoData* pResumeInfo = &m_pUploadInfo->m_resumeUploadInfoData;
 
-    // On the first run, the interval type is undefined.  Set it to the
-    // first interval (or the next if on re-entry).
-    ResumeInfoIntervalType nResumeInterval = pResumeInfo->GetNextResumeIntervalType();
+    // The original task ended with a connection error - the retry
+    // policy schedules the attempts from here.
+    RetryPolicy* pRetryPolicy = RetryPolicy::Instance();
+    pRetryPolicy->LoadPolicies();
+    pRetryPolicy->RecordFailure(retryErrorNetwork);
+
+    // Each error class has its own number of attempts - a session error
+    // after several dropped connections starts from its first attempt.
+    int nRetryClass = retryErrorNetwork;
+    int nClassAttempts[RETRY_ERROR_CLASSES] = { 0 };
+    int nAttempt = 0;
+    LONG64 l64DelayMs = 0;
+    bool bRetriesExhausted = false;
 
     int nResult = 0;
     BOOL bReturn = FALSE;
@@ -6676,9 +7332,17 @@ int ConsoleControl::ResumeCreateFile(DIOMEDE_CONSOLE::CreateFileTask* pTask, boo
 
     bool bContinue = false;
 
-    while (nResumeInterval < resumeIntervalDone) {
+    while (true) {
+        int nClassAttempt = (nRetryClass < RETRY_ERROR_CLASSES) ? nClassAttempts[nRetryClass] : 0;
+        if (false == pRetryPolicy->GetRetryDelay(nRetryClass, nClassAttempt, l64DelayMs)) {
+            bRetriesExhausted = true;
+            break;
+        }
+        nClassAttempts[nRetryClass] ++;
+        nAttempt ++;
+
         szErrorMsg = _T("");
-        bContinue = ResumeCountdown(nResumeInterval);
+        bContinue = ResumeCountdown(l64DelayMs);
 
         if (bContinue == false) {
             PrintStatusMsg(_T("Resume cancelled."), true);
@@ -6714,6 +7378,7 @@ int ConsoleControl::ResumeCreateFile(DIOMEDE_CONSOLE::CreateFileTask* pTask, boo
         if (nResult == SOAP_OK) {
             // We're done - break out to allow the upload process to
             // complete our upload tasks (e.g. add metadata, etc.)
+            pRetryPolicy->RecordSuccess();
             break;
         }
         else {
@@ -6723,21 +7388,24 @@ int ConsoleControl::ResumeCreateFile(DIOMEDE_CONSOLE::CreateFileTask* pTask, boo
 	        // Should we try to resume the upload?
 	        if ( CheckServiceErrorToResume(szErrorMsg) ) {
                 m_pUploadInfo->m_msgTimer.PauseTime(_T(""), EndTimerTypes::useNetworkConnectionError, false);
-                nResumeInterval = pResumeInfo->GetNextResumeIntervalType();
+                nRetryClass = retryErrorNetwork;
+                pRetryPolicy->RecordFailure(nRetryClass);
 	        }
 	        else if ( CheckServiceErrorToRetry(szErrorMsg, szFriendlyMsg)) {
 	            // Session expired so we'll need to relogin and then continue
 	            // where we left off.
+                nRetryClass = GetRetryErrorClass(g_nSessionErrorType);
                 g_bSessionError = true;
                 g_nSessionRetries --;
 
                 if (g_nSessionRetries >= 0) {
 	                nResult = RepeatLastCreateFileTask(pTask);
 	                if (nResult == SOAP_OK) {
+	                    pRetryPolicy->RecordSuccess();
 	                    return nResult;
 	                }
 	            }
-                nResumeInterval = pResumeInfo->GetNextResumeIntervalType();
+                pRetryPolicy->RecordFailure(nRetryClass);
             }
 	        else {
 	            // Recovery is not possible so we'll bail...
@@ -6750,7 +7418,7 @@ int ConsoleControl::ResumeCreateFile(DIOMEDE_CONSOLE::CreateFileTask* pTask, boo
 	}
 
 
-    if ( (nResult != SOAP_OK) && ( nResumeInterval == ResumeInfoIntervalTypes::resumeIntervalDone) ) {
+    if ( (nResult != SOAP_OK) && bRetriesExhausted ) {
         PrintStatusMsg(_T("Failed to resume."), true);
 
         /* We can print out the final error here if needed
@@ -6758,7 +7426,8 @@ int ConsoleControl::ResumeCreateFile(DIOMEDE_CONSOLE::CreateFileTask* pTask, boo
         */
 
         ClientLog(UI_COMP, LOG_ERROR, false,
-            _T("Create file failed - resumed all possible intervals: (%d) %s"), nResult, szErrorMsg.c_str());
+            _T("Create file failed - no retries left after %d attempts: (%d) %s"), nAttempt, nResult,
+            szErrorMsg.c_str());
     }
 
     commandThread.Stop();
@@ -6785,9 +7454,19 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
     ResumeUploadInfoData* pResumeInfo = &m_pUploadInfo->m_resumeUploadInfoData;
     pResumeInfo->SetFileID(pUploadImpl->GetFileID());
 
-    // On the first run, the interval type is undefined.  Set it to the
-    // first interval (or the next if on re-entry).
-    ResumeInfoIntervalType nResumeInterval = pResumeInfo->GetNextResumeIntervalType();
+    // The original task ended with a connection error - the retry
+    // policy schedules the attempts from here.
+    RetryPolicy* pRetryPolicy = RetryPolicy::Instance();
+    pRetryPolicy->LoadPolicies();
+    pRetryPolicy->RecordFailure(retryErrorNetwork);
+
+    // Each error class has its own number of attempts - a session error
+    // after several dropped connections starts from its first attempt.
+    int nRetryClass = retryErrorNetwork;
+    int nClassAttempts[RETRY_ERROR_CLASSES] = { 0 };
+    int nAttempt = 0;
+    LONG64 l64DelayMs = 0;
+    bool bRetriesExhausted = false;
 
     int nResult = 0;
     BOOL bReturn = FALSE;
@@ -6805,9 +7484,17 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
 
     bool bContinue = false;
 
-    while (nResumeInterval < resumeIntervalDone) {
+    while (true) {
+        int nClassAttempt = (nRetryClass < RETRY_ERROR_CLASSES) ? nClassAttempts[nRetryClass] : 0;
+        if (false == pRetryPolicy->GetRetryDelay(nRetryClass, nClassAttempt, l64DelayMs)) {
+            bRetriesExhausted = true;
+            break;
+        }
+        nClassAttempts[nRetryClass] ++;
+        nAttempt ++;
+
         szErrorMsg = _T("");
-        bContinue = ResumeCountdown(nResumeInterval);
+        bContinue = ResumeCountdown(l64DelayMs);
 
         if (bContinue == false) {
             PrintStatusMsg(_T("Resume cancelled."), true);
@@ -6821,6 +7508,8 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
             return nOriginalResult;
        }
 
+        TransferMetrics::Instance()->RecordResume(nAttempt, m_l64TotalUploadedBytes);
+
         pTask->ResetTask();
 
         bReturn = commandThread.Event(pTask);
@@ -6843,6 +7532,7 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
         if (nResult == SOAP_OK) {
             // We're done - break out to allow the upload process to
             // complete our upload tasks (e.g. add metadata, etc.)
+            pRetryPolicy->RecordSuccess();
             break;
         }
         else {
@@ -6855,21 +7545,24 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
 	        // Should we try to resume the upload?
 	        if ( CheckServiceErrorToResume(szErrorMsg) ) {
                 m_pUploadInfo->m_msgTimer.PauseTime(_T(""), EndTimerTypes::useNetworkConnectionError, false);
-                nResumeInterval = pResumeInfo->GetNextResumeIntervalType();
+                nRetryClass = retryErrorNetwork;
+                pRetryPolicy->RecordFailure(nRetryClass);
 	        }
 	        else if ( CheckServiceErrorToRetry(szErrorMsg, szFriendlyMsg)) {
 	            // Session expired so we'll need to relogin and then continue
 	            // where we left off.
+                nRetryClass = GetRetryErrorClass(g_nSessionErrorType);
                 g_bSessionError = true;
                 g_nSessionRetries --;
 
                 if (g_nSessionRetries >= 0) {
 	                nResult = RepeatLastUploadTask(pTask);
 	                if (nResult == SOAP_OK) {
+	                    pRetryPolicy->RecordSuccess();
 	                    return nResult;
 	                }
 	            }
-                nResumeInterval = pResumeInfo->GetNextResumeIntervalType();
+                pRetryPolicy->RecordFailure(nRetryClass);
             }
 	        else {
 	            // Recovery is not possible so we'll bail...
@@ -6881,7 +7574,7 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
 	}
 
 
-    if ( (nResult != SOAP_OK) && ( nResumeInterval == ResumeInfoIntervalTypes::resumeIntervalDone) ) {
+    if ( (nResult != SOAP_OK) && bRetriesExhausted ) {
         PrintStatusMsg(_T("Failed to resume."), true);
 
         /* We can print out the final error here if needed
@@ -6889,7 +7582,8 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
         */
 
         ClientLog(UI_COMP, LOG_ERROR, false,
-            _T("Upload failed - resumed all possible intervals: (%d) %s"), nResult, szErrorMsg.c_str());
+            _T("Upload failed - no retries left after %d attempts: (%d) %s"), nAttempt, nResult,
+            szErrorMsg.c_str());
     }
 
     commandThread.Stop();
@@ -6898,198 +7592,637 @@ int ConsoleControl::ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool
 } // End ResumeCurrentUpload
 
 ///////////////////////////////////////////////////////////////////////
-// Purpose: Helper function to ResumeCountdown to pad the output
-//          as needed.
-// Requires:
-//      szTimerText: string to output
+// Purpose: ResumeUploadWorker destructor - the upload data and task
+//          types are only complete here.
+// Requires: nothing
 // Returns: nothing
-void PrintText(const std::string& szTimerText)
+ConsoleControl::ResumeUploadWorker::~ResumeUploadWorker()
 {
-    std::string szPad = _T("");
-    static int nResumeTextLength = 0;
+    m_commandThread.Stop();
 
-    std::string szTempTimerText = szTimerText;
-    int nNewLength = (int)szTimerText.length();
+    if (m_pTaskUpload != NULL) {
+        delete m_pTaskUpload;
+        m_pTaskUpload = NULL;
+    }
 
-    if (nNewLength < nResumeTextLength) {
-        szPad = GetPadStr(nResumeTextLength - nNewLength );
+    if (m_pUploadData != NULL) {
+        delete m_pUploadData;
+        m_pUploadData = NULL;
     }
 
-    std::string szOutText = _format(_T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
-    fprintf(stdout, _T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
-    fflush(stdout);
+} // End ~ResumeUploadWorker
 
-    //ClientLog(UI_COMP, LOG_STATUS, false, _T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
+///////////////////////////////////////////////////////////////////////
+// Purpose: Upload status callback for resume /parallel workers.  Runs
+//          on the worker's upload thread - only the worker's own data
+//          and the (locked) resume manager are touched here.
+// Requires:
+//      pUploadUser: ResumeUploadWorker
+//      nUploadStatus: upload status
+//      l64CurrentBytes: total bytes uploaded so far
+// Returns: true to continue the upload
+bool ConsoleControl::ResumeWorkerUploadStatus(void* pUploadUser, int nUploadStatus,
+                                              LONG64 l64CurrentBytes)
+{
+    ResumeUploadWorker* pWorker = (ResumeUploadWorker*)pUploadUser;
+    if (pWorker == NULL) {
+        return true;
+    }
 
-    nResumeTextLength = nNewLength;
+    pWorker->m_nUploadStatus = nUploadStatus;
 
-} // End PrintText
+    // Chunk latency is measured from the send to the send complete.
+    if (nUploadStatus == DIOMEDE::uploadSending) {
+        TransferMetrics::Instance()->ChunkStarted(pWorker);
+    }
 
-///////////////////////////////////////////////////////////////////////
-// "Press Any Key" for Linux
-#ifndef WIN32
-struct termios origTermiosSettings;
+    if (nUploadStatus != DIOMEDE::uploadSendComplete) {
+        return true;
+    }
 
-///////////////////////////////////////////////////////////////////////
-// Purpose: Helper to reset the terminal back to its original settings.
-// Requires: nothing
-// Returns: nothing
-void ResetTerminalMode()
-{
-    tcsetattr(0, TCSANOW, &origTermiosSettings);
+    // To allow resume, the upload bytes must be updated on success only.
+    LONG64 l64ChunkBytes = l64CurrentBytes - pWorker->m_l64UploadedBytes;
+    if (l64ChunkBytes < 0) {
+        l64ChunkBytes = 0;
+    }
+    pWorker->m_l64UploadedBytes = l64CurrentBytes;
+    TransferMetrics::Instance()->ChunkComplete(l64CurrentBytes, false, pWorker);
 
-} // End ResetTerminalMode
+    pWorker->m_resumeUploadInfoData.ResetNextResumeIntervalType();
+    pWorker->m_resumeUploadInfoData.SetBytesRead(l64CurrentBytes);
+    pWorker->m_resumeUploadInfoData.UpdateFingerprints();
+
+    int nResumeResult = ResumeManager::Instance()->WriteResumeUploadData(RESUME_UPLOAD_FILENAME,
+        pWorker->m_resumeUploadInfoData);
+    if (nResumeResult != 0) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Resume parallel: write of upload data for %s failed (%d)."),
+            pWorker->m_resumeUploadInfoData.GetFilePath().c_str(), nResumeResult);
+    }
+
+    // Holds up the worker's next chunk when over the bandwidth limit.
+    BandwidthLimiter::Instance()->Throttle(pWorker->m_bandwidthBucket, l64ChunkBytes);
+
+    return true;
+
+} // End ResumeWorkerUploadStatus
 
 ///////////////////////////////////////////////////////////////////////
-// Purpose: Helper to turn off canonical mode.
-// Requires: nothing
+// Purpose: Starts (or restarts following a connection error) the upload
+//          of the worker's resume entry, continuing from the bytes
+//          uploaded so far.
+// Requires:
+//      pWorker: worker with the resume entry set.
 // Returns: nothing
-void SetConioicalTerminalMode()
+void ConsoleControl::StartResumeUploadWorker(ResumeUploadWorker* pWorker)
 {
-    struct termios newTermiosSettings;
-
-    tcgetattr( STDIN_FILENO, &origTermiosSettings);
-    memcpy(&newTermiosSettings, &origTermiosSettings, sizeof(newTermiosSettings));
+    ResumeUploadInfoData* pResumeInfo = &pWorker->m_resumeUploadInfoData;
 
-    newTermiosSettings.c_iflag&=~ICRNL;
-    newTermiosSettings.c_lflag&=~ICANON;
-    newTermiosSettings.c_lflag&=~ECHO;
-    newTermiosSettings.c_cc[VMIN ]=1;
-    newTermiosSettings.c_cc[VTIME]=0;
-    newTermiosSettings.c_cc[VINTR]=0xFF;
-    newTermiosSettings.c_cc[VSUSP]=0xFF;
-    newTermiosSettings.c_cc[VQUIT]=0xFF;
+    // The metrics are kept per worker - a restart continues the
+    // worker's transfer.
+    if (pWorker->m_bActive == false) {
+        pWorker->m_l64UploadedBytes = pResumeInfo->GetBytesRead();
 
-    tcsetattr( STDIN_FILENO, TCSANOW, &newTermiosSettings);
+        TransferMetrics::Instance()->BeginTransfer(TransferMetricsTypes::transferUpload,
+            pResumeInfo->GetFilePath(), pResumeInfo->GetFileID(), pResumeInfo->GetFileSize(),
+            pWorker->m_l64UploadedBytes, pWorker);
+    }
+    else if (pWorker->m_bWaitingToRetry) {
+        TransferMetrics::Instance()->RecordResume(pWorker->m_nRetryAttempts,
+            pWorker->m_l64UploadedBytes, pWorker);
+    }
 
-} // End SetConioicalTerminalMode
+    std::string szFileName = _T("");
+    Util::GetFileName(pResumeInfo->GetFilePath(), szFileName);
 
-///////////////////////////////////////////////////////////////////////
-// Purpose: Helper to wait for input from stdin
-// Requires: nothing
-// Returns: result from stdin trigger
-int kbhit (void)
-{
-  struct timeval tv;
-  fd_set rdfs;
+    // A fresh upload structure each time - the SDK keeps per-upload
+    // state in it.
+    if (pWorker->m_pUploadData != NULL) {
+        delete pWorker->m_pUploadData;
+    }
+    pWorker->m_pUploadData = new UploadImpl();
 
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
+    UploadImpl* pUploadData = pWorker->m_pUploadData;
+    pUploadData->SetFilePath(pResumeInfo->GetFilePath());
+    pUploadData->SetFileName(szFileName);
+    pUploadData->SetFileID(pResumeInfo->GetFileID());
+    pUploadData->SetTotalUploadBytes(pWorker->m_l64UploadedBytes);
 
-  FD_ZERO(&rdfs);
-  FD_SET (STDIN_FILENO, &rdfs);
+    // As with the serial resume, no hash is passed - the resume data
+    // doesn't keep one.
+    pUploadData->SetHashMD5(_T(""));
+    pUploadData->SetUploadCallback(&ResumeWorkerUploadStatus);
+    pUploadData->SetUploadUser(pWorker);
 
-  select(STDIN_FILENO+1, &rdfs, NULL, NULL, &tv);
-  return FD_ISSET(STDIN_FILENO, &rdfs);
+    UserProfileData* pProfileData =
+        ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
 
-} // end kbhit
+    if (pProfileData != NULL) {
+        int nChunkSize =
+            pProfileData->GetUserProfileInt(GEN_MAX_CHUNK_SIZE, GEN_MAX_CHUNK_SIZE_DF);
+        if (nChunkSize != GEN_MAX_CHUNK_SIZE_DF) {
+            pUploadData->SetMaxChunkSize(nChunkSize);
+        }
 
-///////////////////////////////////////////////////////////////////////
-// Purpose: Helper to read a single character from stdin
-// Requires: nothing
-// Returns: character read if successful, error otherwise
-int getch()
-{
-    int nResult;
-    unsigned char szChar;
+        nChunkSize = pProfileData->GetUserProfileInt(GEN_MIN_CHUNK_SIZE, GEN_MIN_CHUNK_SIZE_DF);
+        if (nChunkSize != GEN_MIN_CHUNK_SIZE_DF) {
+            pUploadData->SetMinChunkSize(nChunkSize);
+        }
 
-    if ( (nResult = read(STDIN_FILENO, &szChar, sizeof(szChar)) ) < 0) {
-        return nResult;
-    }
-    else {
-        return szChar;
+        bool bLogStatus =
+            (pProfileData->GetUserProfileInt(GEN_LOG_UPLOAD, GEN_LOG_UPLOAD_DF) != 0);
+        pUploadData->SetLogStatus(bLogStatus);
     }
-} // End getch
 
-#endif
+    pWorker->m_szSessionToken = m_szSessionToken;
+
+	if (pWorker->m_pTaskUpload == NULL) {
+	    pWorker->m_pTaskUpload = new DIOMEDE_CONSOLE::UploadTask(m_szSessionToken, pUploadData);
+	}
+	else {
+	    pWorker->m_pTaskUpload->ResetTask();
+	    pWorker->m_pTaskUpload->SetSessionToken(m_szSessionToken);
+	    pWorker->m_pTaskUpload->SetUploadImpl(pUploadData);
+	}
+
+    pWorker->m_nUploadStatus = 0;
+    pWorker->m_bActive = true;
+    pWorker->m_bWaitingToRetry = false;
+
+    pWorker->m_commandThread.Event(pWorker->m_pTaskUpload);
+
+} // End StartResumeUploadWorker
 
 ///////////////////////////////////////////////////////////////////////
-// Purpose: Handle the count down timer and UI for resuming tasks.
+// Purpose: Handles a worker whose upload task has completed.
 // Requires:
-//      nIntervalType: interval type (e.g. 5 sec, 10 sec).
-// Returns: true to continue, false to quit
-bool ConsoleControl::ResumeCountdown(ResumeInfoIntervalType nIntervalType)
+//      pWorker: worker with a completed upload task.
+//      nTotalFilesUploaded: incremented on success.
+//      l64TotalBytesUploaded: incremented by the bytes uploaded.
+// Returns: true if the worker is free for the next entry, false if
+//          it is waiting to resume the current entry.
+bool ConsoleControl::EndResumeUploadWorker(ResumeUploadWorker* pWorker, int& nTotalFilesUploaded,
+                                           LONG64& l64TotalBytesUploaded)
 {
-    int nHours = 0;
-    int nMinutes = 0;
-    int nSeconds = 0;
-    int nFractionalSeconds = 0;
+    ResumeUploadInfoData* pResumeInfo = &pWorker->m_resumeUploadInfoData;
+    int nResult = pWorker->m_pTaskUpload->GetResult();
+
+    std::string szFileName = _T("");
+    Util::GetFileName(pResumeInfo->GetFilePath(), szFileName);
+    if (szFileName.length() > 30) {
+        std::string szTrimmedName = _T("");
+        TrimFileName(30, szFileName, szTrimmedName);
+        szFileName = szTrimmedName;
+    }
 
-    int nTotalSeconds = 0;
-    int nTotalMinutes = 0;
-    int nTotalHours = 0;
+    #ifdef WIN32
+        std::string szFileID = _format(_T("%I64d"), pResumeInfo->GetFileID());
+    #else
+        std::string szFileID = _format(_T("%lld"), pResumeInfo->GetFileID());
+    #endif
 
-    std::vector<int> listResumeIntervals;
-    GetConfigResumeIntervals(listResumeIntervals);
+    if (nResult == SOAP_OK) {
+        std::string szBytes = _T("");
+        std::string szBytesSizeType = _T("");
+        StringUtil::FormatByteSize(pResumeInfo->GetFileSize(), szBytes, szBytesSizeType);
 
-    bool bContinueResume = true;
+        PrintStatusMsg(_format(_T("%s: %s (%s %s)... Done"), szFileID.c_str(), szFileName.c_str(),
+            szBytes.c_str(), szBytesSizeType.c_str()), false, false);
 
-    switch (nIntervalType) {
-        case resumeInterval1:
-            nTotalSeconds = listResumeIntervals[0];
-            break;
-        case resumeInterval2:
-            nTotalSeconds = listResumeIntervals[1];
-            break;
-        case resumeInterval3:
-            nTotalSeconds = listResumeIntervals[2];
-            break;
-        case resumeInterval4:
-            nTotalSeconds = listResumeIntervals[3];
-            break;
-        case resumeInterval5:
-            nTotalSeconds = listResumeIntervals[4];
-            break;
-        default:
-            bContinueResume = false;
-            break;
-    }
+        pResumeInfo->SetResumeIntervalType(resumeIntervalDone);
+        pResumeInfo->SetResumeInfoType(resumeDone);
+        WriteResumeUploadData(*pResumeInfo, _T("Resume parallel"));
 
-    if (bContinueResume == false) {
-        return false;
+        RetryPolicy::Instance()->RecordSuccess();
+        TransferMetrics::Instance()->EndTransfer(nResult, pWorker);
+
+        nTotalFilesUploaded ++;
+        l64TotalBytesUploaded += pWorker->m_l64UploadedBytes;
+
+        pWorker->m_bActive = false;
+        return true;
     }
 
-    nSeconds = nTotalSeconds % 60;
-    nTotalMinutes = nTotalSeconds / 60;
-    nMinutes = nTotalMinutes % 60;;
-    nTotalHours = nTotalMinutes / 60;
-    nHours = nTotalHours % 24;
+    std::string szErrorMsg = pWorker->m_pTaskUpload->GetServiceErrorMsg();
+    std::string szFriendlyMsg = _T("");
 
-    fflush(stdout);
+    if (CheckServiceErrorToResume(szErrorMsg)) {
+        // Wait for the retry policy's delay, then continue from the
+        // last chunk sent.  ResumeUploadsParallel restarts the worker.
+        RetryPolicy* pRetryPolicy = RetryPolicy::Instance();
+        pRetryPolicy->RecordFailure(retryErrorNetwork);
 
-    #ifdef WIN32
-        // For windows, we can use the windows console API's to
-        // any key capture via a task.  Linux, on the other
-        // hand, does not work well using this same type of mechanism.
-        // We'll hand the terminos functions here directly.
-        DIOMEDE_CONSOLE::PressAnyKeyTask taskPressAnyKey;
+        LONG64 l64DelayMs = 0;
+        if (pRetryPolicy->GetRetryDelay(retryErrorNetwork, pWorker->m_nRetryAttempts, l64DelayMs)) {
+            pWorker->m_nRetryAttempts ++;
 
-        DIOMEDE_CONSOLE::CommandThread commandThread;
-        if (false == CheckThread(&commandThread, _T("Resume"))) {
+            PrintStatusMsg(_format(_T("%s: %s... connection error, resuming in %d seconds"),
+                szFileID.c_str(), szFileName.c_str(), (int)((l64DelayMs + 999) / 1000)), false, false);
+
+            pWorker->m_tmRetry = microsec_clock::universal_time() + milliseconds((long)l64DelayMs);
+            pWorker->m_bWaitingToRetry = true;
             return false;
         }
+    }
+    else if (CheckServiceErrorToRetry(szErrorMsg, szFriendlyMsg)) {
+        // The workers share the session token - the first worker to
+        // see the error logs in again, the others pick up the new
+        // token.  Once the login retries are used up, stop handing out
+        // entries.  What's left remains in the resume list.
+        int nLoginResult = SOAP_OK;
 
-        BOOL bReturn = commandThread.Event(&taskPressAnyKey);
+        if (pWorker->m_szSessionToken == m_szSessionToken) {
+            g_nSessionRetries --;
+            nLoginResult = (g_nSessionRetries >= 0) ? LoginResumeUploadWorker(pWorker) : nResult;
+        }
 
-        if (bReturn == FALSE) {
+        if (nLoginResult == SOAP_OK) {
+            TransferMetrics::Instance()->RecordRetry(_T("session"), pWorker);
+            StartResumeUploadWorker(pWorker);
             return false;
         }
-    #endif
 
-    PrintNewLine();
+        g_bSessionError = true;
+    }
 
-    ptime tmFirstStart = not_a_date_time;
-    ptime tmLastStart = not_a_date_time;
+    PrintStatusMsg(_format(_T("%s: %s... Failed"), szFileID.c_str(), szFileName.c_str()),
+        false, false);
+    PrintServiceError(stderr, szErrorMsg, false, false);
+    ClientLog(UI_COMP, LOG_ERROR, false, _T("Resume parallel: upload of %s failed: (%d) %s"),
+        pResumeInfo->GetFilePath().c_str(), nResult, szErrorMsg.c_str());
 
-    tmFirstStart = boost::posix_time::microsec_clock::local_time();
-    tmLastStart = tmFirstStart;
+    TransferMetrics::Instance()->EndTransfer(nResult, pWorker);
 
-    time_duration countDownTime(nHours, nMinutes, nSeconds, nFractionalSeconds);
+    l64TotalBytesUploaded += pWorker->m_l64UploadedBytes;
 
-    LONG64 l64Seconds = 0;
-    std::string szDuration = _T("");
-    std::string szDurationType = _T("");
-    std::string szResumeOutput = _T("");
+    pWorker->m_bActive = false;
+    return true;
+
+} // End EndResumeUploadWorker
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Logs the user in again following a session error on one of
+//          the resume /parallel workers - the counterpart of the login
+//          in RepeatLastUploadTask.  The login runs on the worker's
+//          command thread.
+// Requires:
+//      pWorker: worker whose upload failed with the session error.
+// Returns: SOAP_OK if successful, service error otherwise.
+int ConsoleControl::LoginResumeUploadWorker(ResumeUploadWorker* pWorker)
+{
+    MessageTimer msgTimer;
+
+    std::string szLoginUserStart = _format(_T("Login user %s"), m_szUsername.c_str());
+    DIOMEDE_CONSOLE::LoginTask taskLogin(m_szUsername, m_szPlainTextPassword);
+
+    msgTimer.Start(szLoginUserStart);
+
+    if (pWorker->m_commandThread.Event(&taskLogin) == FALSE) {
+        msgTimer.EndTime(_T(""), EndTimerTypes::useNoTimeOrDone);
+        return DIOMEDE::DIOMEDE_CREATE_THREAD_ERROR;
+    }
+
+    while ( taskLogin.Status() != TaskStatusCompleted ) {
+        msgTimer.ContinueTime();
+        PauseProcess();
+    }
+
+    msgTimer.EndTime(_T(""), EndTimerTypes::useNoTimeOrDone);
+
+    int nResult = taskLogin.GetResult();
+    if (nResult != SOAP_OK) {
+        PrintServiceError(stderr, taskLogin.GetServiceErrorMsg(), false, false);
+        return nResult;
+    }
+
+    m_szSessionToken = taskLogin.GetSessionToken();
+    g_nSessionRetries = MAX_LOGIN_RETRIES;
+
+    CLIENTLOG_STATUS(UI_COMP, false,
+        _T("Resume parallel: new session token %s."), m_szSessionToken.c_str());
+
+    UserProfileData* pProfileData =
+        ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
+    if (pProfileData) {
+        pProfileData->SetUserProfileStr(GEN_SESSION_TOKEN, m_szSessionToken.c_str());
+        pProfileData->SetUserProfileLong(GEN_SESSION_TOKEN_EXPIRES, (long)UpdateSessionTokenExpiration());
+        pProfileData->SaveUserProfile();
+    }
+
+    return nResult;
+
+} // End LoginResumeUploadWorker
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Resumes the list of uploads on concurrent workers (resume
+//          /parallel:N).  Each worker continues its file from the bytes
+//          recorded in the resume data.
+// Requires:
+//      listResumeUploadInfo: resume entries
+//      nParallel: number of workers
+//      nTotalFilesUploaded: returned number of completed files
+//      l64TotalBytesUploaded: returned number of bytes uploaded
+// Returns: 0 if successful, error code otherwise
+int ConsoleControl::ResumeUploadsParallel(std::vector<ResumeUploadInfoData>& listResumeUploadInfo,
+                                          int nParallel, int& nTotalFilesUploaded,
+                                          LONG64& l64TotalBytesUploaded)
+{
+    ResumeUploadWorkerList listWorkers;
+    int nIndex = 0;
+
+    for (nIndex = 0; (nIndex < nParallel) && (nIndex < (int)listResumeUploadInfo.size()); nIndex++) {
+        ResumeUploadWorker* pWorker = new ResumeUploadWorker();
+        if (false == CheckThread(&pWorker->m_commandThread, _T("Upload"))) {
+            delete pWorker;
+            break;
+        }
+        listWorkers.push_back(pWorker);
+    }
+
+    if (listWorkers.size() == 0) {
+        return DIOMEDE::DIOMEDE_CREATE_THREAD_ERROR;
+    }
+
+    RetryPolicy* pRetryPolicy = RetryPolicy::Instance();
+    pRetryPolicy->LoadPolicies();
+
+    ptime tmStart = microsec_clock::universal_time();
+
+    int nNextEntry = 0;
+    int nActive = 0;
+    bool bCancelled = false;
+
+    while (true) {
+
+        //-------------------------------------------------------------
+        // Hand out the next entries and restart workers whose retry
+        // is due.  While the breaker is open, the retry policy holds
+        // the workers and releases them spread over the base delay.
+        //-------------------------------------------------------------
+        ptime tmNow = microsec_clock::universal_time();
+
+        for (nIndex = 0; nIndex < (int)listWorkers.size(); nIndex++) {
+            ResumeUploadWorker* pWorker = listWorkers[nIndex];
+
+            if (pWorker->m_bActive) {
+                if ( pWorker->m_bWaitingToRetry && (bCancelled == false) &&
+                     (tmNow >= pWorker->m_tmRetry) &&
+                     pRetryPolicy->CanAttempt(retryErrorNetwork, pWorker->m_tmRetry) ) {
+                    StartResumeUploadWorker(pWorker);
+                }
+                continue;
+            }
+
+            while ( (bCancelled == false) && (g_bSessionError == false) &&
+                    (nNextEntry < (int)listResumeUploadInfo.size()) ) {
+
+                ResumeUploadInfoData& resumeUploadInfoData = listResumeUploadInfo[nNextEntry];
+                nNextEntry ++;
+
+                // If by chance the file is finished uploading and it's still in our
+                // list, skip it...
+                if ( resumeUploadInfoData.GetFileSize() == resumeUploadInfoData.GetBytesRead()) {
+                    resumeUploadInfoData.SetResumeIntervalType(resumeIntervalDone);
+                    resumeUploadInfoData.SetResumeInfoType(ResumeInfoType(resumeDone | resumeUploads));
+
+                    WriteResumeUploadData(resumeUploadInfoData, _T("Process resume command"));
+                    continue;
+                }
+
+                // Make sure the part already uploaded is still valid.
+                if ( resumeUploadInfoData.HasResumeFileChanged() ) {
+                    PrintStatusMsg(resumeUploadInfoData.GetFilePath() +
+                                   _T(": file has changed.  Resume skipped."), true);
+                    continue;
+                }
+
+                pWorker->m_resumeUploadInfoData = resumeUploadInfoData;
+                pWorker->m_nRetryAttempts = 0;
+                StartResumeUploadWorker(pWorker);
+                nActive ++;
+                break;
+            }
+        }
+
+        if (nActive == 0) {
+            break;
+        }
+
+        if ( (false == PauseProcess()) && (bCancelled == false) ) {
+            bCancelled = true;
+
+            for (nIndex = 0; nIndex < (int)listWorkers.size(); nIndex++) {
+                ResumeUploadWorker* pWorker = listWorkers[nIndex];
+                if (pWorker->m_bActive && (pWorker->m_bWaitingToRetry == false)) {
+                    pWorker->m_pTaskUpload->CancelTask();
+                }
+            }
+        }
+
+        //-------------------------------------------------------------
+        // Collect the completed uploads.
+        //-------------------------------------------------------------
+        for (nIndex = 0; nIndex < (int)listWorkers.size(); nIndex++) {
+            ResumeUploadWorker* pWorker = listWorkers[nIndex];
+
+            if (pWorker->m_bActive == false) {
+                continue;
+            }
+
+            if (pWorker->m_bWaitingToRetry) {
+                if (bCancelled) {
+                    TransferMetrics::Instance()->EndTransfer(pWorker->m_pTaskUpload->GetResult(),
+                                                             pWorker);
+                    l64TotalBytesUploaded += pWorker->m_l64UploadedBytes;
+                    pWorker->m_bActive = false;
+                    nActive --;
+                }
+                continue;
+            }
+
+            if (pWorker->m_pTaskUpload->Status() != TaskStatusCompleted) {
+                continue;
+            }
+
+            if (EndResumeUploadWorker(pWorker, nTotalFilesUploaded, l64TotalBytesUploaded) ||
+                bCancelled) {
+                pWorker->m_bActive = false;
+                nActive --;
+            }
+        }
+    }
+
+    // Clear the control key usage bool now that the threads have quit.
+    g_bUsingCtrlKey = false;
+
+    m_tdTotalUpload += microsec_clock::universal_time() - tmStart;
+
+    for (nIndex = 0; nIndex < (int)listWorkers.size(); nIndex++) {
+        delete listWorkers[nIndex];
+    }
+    listWorkers.clear();
+
+    if (bCancelled) {
+        PrintStatusMsg(_T("Resume cancelled."), true, false);
+    }
+
+    return 0;
+
+} // End ResumeUploadsParallel
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to ResumeCountdown to pad the output
+//          as needed.
+// Requires:
+//      szTimerText: string to output
+// Returns: nothing
+void PrintText(const std::string& szTimerText)
+{
+    std::string szPad = _T("");
+    static int nResumeTextLength = 0;
+
+    std::string szTempTimerText = szTimerText;
+    int nNewLength = (int)szTimerText.length();
+
+    if (nNewLength < nResumeTextLength) {
+        szPad = GetPadStr(nResumeTextLength - nNewLength );
+    }
+
+    std::string szOutText = _format(_T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
+    fprintf(stdout, _T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
+    fflush(stdout);
+
+    //ClientLog(UI_COMP, LOG_STATUS, false, _T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
+
+    nResumeTextLength = nNewLength;
+
+} // End PrintText
+
+///////////////////////////////////////////////////////////////////////
+// "Press Any Key" for Linux
+#ifndef WIN32
+struct termios origTermiosSettings;
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper to reset the terminal back to its original settings.
+// Requires: nothing
+// Returns: nothing
+void ResetTerminalMode()
+{
+    tcsetattr(0, TCSANOW, &origTermiosSettings);
+
+} // End ResetTerminalMode
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper to turn off canonical mode.
+// Requires: nothing
+// Returns: nothing
+void SetConioicalTerminalMode()
+{
+    struct termios newTermiosSettings;
+
+    tcgetattr( STDIN_FILENO, &origTermiosSettings);
+    memcpy(&newTermiosSettings, &origTermiosSettings, sizeof(newTermiosSettings));
+
+    newTermiosSettings.c_iflag&=~ICRNL;
+    newTermiosSettings.c_lflag&=~ICANON;
+    newTermiosSettings.c_lflag&=~ECHO;
+    newTermiosSettings.c_cc[VMIN ]=1;
+    newTermiosSettings.c_cc[VTIME]=0;
+    newTermiosSettings.c_cc[VINTR]=0xFF;
+    newTermiosSettings.c_cc[VSUSP]=0xFF;
+    newTermiosSettings.c_cc[VQUIT]=0xFF;
+
+    tcsetattr( STDIN_FILENO, TCSANOW, &newTermiosSettings);
+
+} // End SetConioicalTerminalMode
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper to wait for input from stdin
+// Requires: nothing
+// Returns: result from stdin trigger
+int kbhit (void)
+{
+  struct timeval tv;
+  fd_set rdfs;
+
+  tv.tv_sec = 0;
+  tv.tv_usec = 0;
+
+  FD_ZERO(&rdfs);
+  FD_SET (STDIN_FILENO, &rdfs);
+
+  select(STDIN_FILENO+1, &rdfs, NULL, NULL, &tv);
+  return FD_ISSET(STDIN_FILENO, &rdfs);
+
+} // end kbhit
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper to read a single character from stdin
+// Requires: nothing
+// Returns: character read if successful, error otherwise
+int getch()
+{
+    int nResult;
+    unsigned char szChar;
+
+    if ( (nResult = read(STDIN_FILENO, &szChar, sizeof(szChar)) ) < 0) {
+        return nResult;
+    }
+    else {
+        return szChar;
+    }
+} // End getch
+
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Handle the count down timer and UI for resuming tasks.
+// Requires:
+//      l64DelayMs: time to count down, in milliseconds.
+// Returns: true to continue, false to quit
+bool ConsoleControl::ResumeCountdown(LONG64 l64DelayMs)
+{
+    if (l64DelayMs < 0) {
+        return false;
+    }
+
+    bool bContinueResume = true;
+
+    fflush(stdout);
+
+    #ifdef WIN32
+        // For windows, we can use the windows console API's to
+        // any key capture via a task.  Linux, on the other
+        // hand, does not work well using this same type of mechanism.
+        // We'll hand the terminos functions here directly.
+        DIOMEDE_CONSOLE::PressAnyKeyTask taskPressAnyKey;
+
+        DIOMEDE_CONSOLE::CommandThread commandThread;
+        if (false == CheckThread(&commandThread, _T("Resume"))) {
+            return false;
+        }
+
+        BOOL bReturn = commandThread.Event(&taskPressAnyKey);
+
+        if (bReturn == FALSE) {
+            return false;
+        }
+    #endif
+
+    PrintNewLine();
+
+    ptime tmFirstStart = not_a_date_time;
+    ptime tmLastStart = not_a_date_time;
+
+    tmFirstStart = boost::posix_time::microsec_clock::local_time();
+    tmLastStart = tmFirstStart;
+
+    time_duration countDownTime = milliseconds((long)l64DelayMs);
+
+    LONG64 l64Seconds = 0;
+    std::string szDuration = _T("");
+    std::string szDurationType = _T("");
+    std::string szResumeOutput = _T("");
 
     bContinueResume = false;
 
@@ -7304,6 +8437,12 @@ void ConsoleControl::ProcessSearchFilesCommand(CmdLine* pCmdLine, bool& bCommand
 
     bool bVerboseOutput = VerboseOutput(pCmdLine);
 
+    int nOutputFormat = RecordWriterTypes::recordFormatNone;
+    if (GetOutputFormat(pCmdLine, nOutputFormat) == false) {
+        return;
+    }
+    bool bShowProgress = (nOutputFormat == RecordWriterTypes::recordFormatNone);
+
     bool bArgIsSet = bVerboseOutput;
     bool bIsDeleted = bArgIsSet;
 
@@ -7316,6 +8455,12 @@ void ConsoleControl::ProcessSearchFilesCommand(CmdLine* pCmdLine, bool& bCommand
         bVerboseOutput = true;
     }
 
+    // Machine readable output has a single layout - one row per file.
+    if (bShowProgress == false) {
+        bIncludePhysicalFiles = false;
+        bVerboseOutput = false;
+    }
+
     SearchFileFilterImpl* pSearchFilter = new SearchFileFilterImpl;
     SetupSearchFilter(pCmdLine, pSearchFilter, bIsDeleted, bArgIsSet);
 
@@ -7364,7 +8509,8 @@ void ConsoleControl::ProcessSearchFilesCommand(CmdLine* pCmdLine, bool& bCommand
     // Process searchfiles
     //-----------------------------------------------------------------
 	DIOMEDE_CONSOLE::SearchFilesTask taskFiles(m_szSessionToken, pSearchFilter, bIncludePhysicalFiles);
-	int nResult = HandleTask(&taskFiles, _T("Searching"), _T(""), false, !bMaxPageSizeSet);
+	int nResult = HandleTask(&taskFiles, _T("Searching"), _T(""), false, !bMaxPageSizeSet,
+	                         bShowProgress);
 
     // Since we've turned off the task new lines, add one now...
     if (bMaxPageSizeSet) {
@@ -7420,7 +8566,10 @@ void ConsoleControl::ProcessSearchFilesCommand(CmdLine* pCmdLine, bool& bCommand
     LogicalPhysicalFilesInfoListImpl* pListLogicalPhysicalFiles =
                                          taskFiles.GetSearchFilesResultsPhysicalFiles();
 
-    if (bVerboseOutput) {
+    if (bShowProgress == false) {
+        WriteSearchFilesRecords(pListFileProperties, bIsDeleted, nOutputFormat);
+    }
+    else if (bVerboseOutput) {
         DisplaySearchFilesResultsVerbose(pListFileProperties, pListLogicalPhysicalFiles);
     }
     else {
@@ -7808,46 +8957,35 @@ void ConsoleControl::DisplaySearchFilesResults(class FilePropertiesListImpl* pLi
 {
     std::vector<void * >listFileProperties = pListFileProperties->GetFilePropertiesList();
 
-    std::string szFormattedDate = _T("");
-	std::vector<std::string> dateTime;
+    // Each row is formatted into these buffers (the date is output
+    // before the row color is set) - nothing is allocated per row.
+    FixedFormatBuffer<32> szFormattedDate;
+    FixedFormatBuffer<1024> szRow;
 
-    std::string szFileSize = _T("");
     std::string szFileSizeType = _T("");
     std::string szFilename = _T("");
-    std::string szPad = _T("");
 
     LONG64 l64TotalBytes = 0;
 
      // Run through the results to find the length we need for file IDs
     int nMaxFileIDLen = 0;
-    std::string szOutFileID = _T("");
+    FixedFormatBuffer<32> szOutFileID;
     int nFileIDLen = 0;
 
-    std::vector<std::string> listFileID;
-    std::string szIsDeleted = _T("d");
-    std::string szIsIncomplete = _T("i");
-
     for (int nIndex = 0; nIndex < (int)listFileProperties.size(); nIndex ++) {
         FilePropertiesImpl* pFileProperties = (FilePropertiesImpl*)listFileProperties[nIndex];
         if (pFileProperties == NULL) {
-            listFileID.push_back(_T(""));
             continue;
         }
 
 	    if ( (bShowDeleted == false) && ( pFileProperties->GetIsDeleted() )) {
 	        // Skip the deleted files if we're not showing them.
-            listFileID.push_back(_T(""));
 	        continue;
 	    }
 
-        #ifdef WIN32
-            szOutFileID = _format(_T("%I64d"), pFileProperties->GetFileID());
-        #else
-            szOutFileID = _format(_T("%lld"), pFileProperties->GetFileID());
-        #endif
+        szOutFileID.Reset();
+        szOutFileID.AppendInt(pFileProperties->GetFileID());
 
-        // Save the formatted string to use in the final output
-        listFileID.push_back(szOutFileID);
         nFileIDLen = (int)szOutFileID.length();
         nMaxFileIDLen = (nFileIDLen > nMaxFileIDLen) ? nFileIDLen : nMaxFileIDLen;
     }
@@ -7869,8 +9007,6 @@ void ConsoleControl::DisplaySearchFilesResults(class FilePropertiesListImpl* pLi
     #endif
     int nFileNameSpace = 62 - nDateTimeSpace - nDeletedSpace - nMaxFileIDLen;
 
-    std::string szDeleted = _T(" DELETED");
-
     //-----------------------------------------------------------------
     // cout << _T("12345678901234567890123456789012345678901234567890123456789012345678901234567890") << endl;
     // Display results
@@ -7890,20 +9026,15 @@ void ConsoleControl::DisplaySearchFilesResults(class FilePropertiesListImpl* pLi
 	    }
 
         if (bShowFileDate) {
-            szFormattedDate = _T("");
-            StringUtil::FormatDateAndTime(pFileProperties->GetLastModifiedDate(), szFormattedDate);
-
-            // We need to split the date + time into a date and a time string
-            // to allow us to allign them.
-	        int nCount = SplitString(szFormattedDate, dateTime, false);
-	        if (nCount < 2) {
-	            // Something is wrong with this entry - skip it....
+            // Date and time, 1 space between - a missing date means
+            // something is wrong with this entry - skip it....
+            szFormattedDate.Reset();
+            if (StringUtil::FormatDateAndTime(pFileProperties->GetLastModifiedDate(),
+                                              szFormattedDate) == false) {
 	            continue;
 	        }
 
-	        // Date and time, 1 space between, 3 spaces afterwards -
-	        // see below for file size.
-	        _tprintf(_T("%s %s"), dateTime[0].c_str(), dateTime[1].c_str());
+	        _tprintf(_T("%s"), szFormattedDate.c_str());
 	    }
 
         //-------------------------------------------------------------
@@ -7921,82 +9052,64 @@ void ConsoleControl::DisplaySearchFilesResults(class FilePropertiesListImpl* pLi
     	    PrintTextInColorOn(COLOR_INCOMPLETE, nOrigColors);
         }
 
+        szRow.Reset();
+
         //-------------------------------------------------------------
-	    // File size
+	    // File size - there's always 1 space between the file size and
+	    // the file size type.
         //-------------------------------------------------------------
-	    szFileSize = _T("");
-	    szFileSizeType = _T("");
+        const char* szSizeType = _T("");
 
         // Max the byte size in each category to 3 digits, e.g. 1000 KB = .97 MB
-        LONG64 l64FileSize = pFileProperties->GetFileSize();
-	    StringUtil::FormatByteSize(l64FileSize, szFileSize, szFileSizeType, 999);
-
-        // 12/27/3008: changed such that there's always 1 space between
-        // the file size and the file size type...
-        #if 0
-    	    szPad = _T("");
-	        if (szFileSizeType.length() < 2) {
-	            szPad = GetPadStr(2);
-	        }
-	        else if (szFileSizeType.length() < 3) {
-	            szPad = GetPadStr(1);
-	        }
-        #endif
+        StringUtil::FormatByteSize(pFileProperties->GetFileSize(), szRow, szSizeType, 999);
+        szRow << _T(' ') << szSizeType;
 
         int nFileIDPad = 3;
+        size_t nSizeTypeLen = strlen(szSizeType);
 
-	    szFileSize = szFileSize + _T(" ") + szFileSizeType;
-        if (szFileSizeType.length() < 2) {
-    	    _tprintf(_T("%11s"), szFileSize.c_str());
+        if (nSizeTypeLen < 2) {
+            szRow.AlignRight(0, 11);
         }
-        else if (szFileSizeType.length() < 3) {
-	        _tprintf(_T("%12s"), szFileSize.c_str());
+        else if (nSizeTypeLen < 3) {
+            szRow.AlignRight(0, 12);
 	        nFileIDPad --;
         }
+        else {
+            szRow.Reset();
+        }
 
         //-------------------------------------------------------------
 	    // File ID - 3 spaces + max width for all file IDs, right aligned
         //-------------------------------------------------------------
-        szOutFileID = listFileID[nIndex];
-        nFileIDLen = (int)szOutFileID.length();
-
-        szOutFileID = GetPadStr(nMaxFileIDLen - nFileIDLen + nFileIDPad) + szOutFileID;
+        size_t nFileIDStart = szRow.length();
+        szRow.AppendInt(pFileProperties->GetFileID());
+        szRow.AlignRight(nFileIDStart, nMaxFileIDLen + nFileIDPad);
 
         // We want to keep the file IDs lined up, so add the annotations for
         // deleted and incompleted at this point.
         int nFileNamePad = 3;
         if ( pFileProperties->GetIsDeleted() ) {
-            szOutFileID += szIsDeleted;
+            szRow << _T('d');
             nFileNamePad --;
         }
 
         if ( pFileProperties->GetIsCompleted() == false ) {
-            szOutFileID += szIsIncomplete;
+            szRow << _T('i');
             nFileNamePad --;
         }
 
-	    _tprintf(_T("%s"), szOutFileID.c_str());
 	    nCountDisplayed++;
 
         //-------------------------------------------------------------
 	    // File name, truncated with ... if needed.  Our total line length is
 	    // 79 - at 80, a console window set to 80 will wrap.
         //-------------------------------------------------------------
-	    szFilename = _T("");
 	    TrimFileName(nFileNameSpace, pFileProperties->GetFileName(), szFilename);
-	    szFilename = GetPadStr(nFileNamePad) + szFilename;
-	    _tprintf(_T("%-s"), szFilename.c_str());
+	    szRow.AppendRepeat(_T(' '), nFileNamePad);
+	    szRow << szFilename;
 
-        #if 0
-        // 12/27/08 Print file name, file ID, size, and size type in red.
-	    if (bShowDeleted) {
-            if ( pFileProperties->GetIsDeleted() ) {
-                PrintTextInColor(szDeleted, COLOR_DELETED);
-            }
-	    }
-	    #endif
+	    _tprintf(_T("%s"), szRow.c_str());
 
-        dateTime.clear();
         PrintNewLine();
 
         l64TotalBytes += pFileProperties->GetFileSize();
@@ -8052,6 +9165,59 @@ void ConsoleControl::DisplaySearchFilesResults(class FilePropertiesListImpl* pLi
 
 } // End DisplaySearchFilesResults
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to write the search file response in a
+//          machine readable format.  Unlike the console output, the
+//          results are written in a single pass with no column
+//          alignment or colors.
+// Requires:
+//      pListFileProperties: reference to the list of response objects.
+//      bShowDeleted: show whether or not the file has been deleted.
+//      nFormat: RecordFormatType
+// Returns: nothing
+void ConsoleControl::WriteSearchFilesRecords(FilePropertiesListImpl* pListFileProperties,
+                                             bool bShowDeleted, int nFormat)
+{
+    static const char* const SEARCH_FILES_COLUMNS[] = {
+        _T("file_id"), _T("name"), _T("size"), _T("created"), _T("modified"),
+        _T("last_access"), _T("md5"), _T("sha1"), _T("deleted"), _T("complete")
+    };
+
+    RecordWriter recordWriter(stdout, nFormat);
+    recordWriter.SetColumns(SEARCH_FILES_COLUMNS,
+        sizeof(SEARCH_FILES_COLUMNS) / sizeof(SEARCH_FILES_COLUMNS[0]));
+
+    std::vector<void * >listFileProperties = pListFileProperties->GetFilePropertiesList();
+
+    for (int nIndex = 0; nIndex < (int)listFileProperties.size(); nIndex ++) {
+        FilePropertiesImpl* pFileProperties = (FilePropertiesImpl*)listFileProperties[nIndex];
+        if (pFileProperties == NULL) {
+            continue;
+        }
+
+	    if ( (bShowDeleted == false) && ( pFileProperties->GetIsDeleted() )) {
+	        // Skip the deleted files if we're not showing them.
+	        continue;
+	    }
+
+        recordWriter.BeginRecord();
+        recordWriter.AddInt64(pFileProperties->GetFileID());
+        recordWriter.AddString(pFileProperties->GetFileName());
+        recordWriter.AddInt64(pFileProperties->GetFileSize());
+        recordWriter.AddDateTime(pFileProperties->GetCreatedDate());
+        recordWriter.AddDateTime(pFileProperties->GetLastModifiedDate());
+        recordWriter.AddDateTime(pFileProperties->GetLastAccess());
+        recordWriter.AddString(pFileProperties->GetHashMD5());
+        recordWriter.AddString(pFileProperties->GetHashSHA1());
+        recordWriter.AddBool(pFileProperties->GetIsDeleted());
+        recordWriter.AddBool(pFileProperties->GetIsCompleted());
+        recordWriter.EndRecord();
+    }
+
+    recordWriter.Finish();
+
+} // End WriteSearchFilesRecords
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Helper function for file search
 // Requires:
@@ -8900,10 +10066,12 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
 
     DiomedeUnlabeledValueArg<std::string>* pFileIDArg = NULL;
     DiomedeValueArg<std::string>* pDirArg = NULL;
+    DiomedeSwitchArg* pSparseArg = NULL;
 
     try {
         pFileIDArg = (DiomedeUnlabeledValueArg<std::string>*)pCmdLine->getArg(ARG_FILEINFO);
         pDirArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_DIRECTORY);
+        pSparseArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_SPARSE_SWITCH);
     }
     catch (CmdLineParseException &e) {
         // catch any exceptions
@@ -8979,6 +10147,8 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
         Util::GetWorkingDirectory(szDirectory);
     }
 
+    bool bMakeSparse = (pSparseArg && pSparseArg->isSet());
+
     //----------------------------------------------------------------
     // Setup the download data structure
     //----------------------------------------------------------------
@@ -9019,6 +10189,8 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
     PrintNewLine();
 
     // To make sure there is no data leftover from a prior call.
+    m_progressRenderer.EndFile();
+
     if (m_pDownloadInfo != NULL) {
         delete m_pDownloadInfo;
         m_pDownloadInfo = NULL;
@@ -9032,6 +10204,8 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
     }
 
     m_pDownloadInfo->ClearAll();
+    m_progressRenderer.BeginSession();
+    BandwidthLimiter::Instance()->LoadSettings();
 
     ResumeManager::Instance()->ClearResumeMgrData();
 
@@ -9039,14 +10213,14 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
     m_pDownloadInfo->m_szDownloadPath = szDirectory;
     m_pDownloadInfo->m_l64FileID = l64FileID;
 
+    TransferMetrics::Instance()->BeginTransfer(TransferMetricsTypes::transferDownload,
+        szFileID, l64FileID, 0);
+
 	DIOMEDE_CONSOLE::DownloadTask taskDownload(m_szSessionToken, &downloadData);
     m_pDownloadInfo->m_commandThread.Event(&taskDownload);
 
+    // Progress is drawn by the renderer once the download has started.
     while ( taskDownload.Status() != TaskStatusCompleted ) {
-        if (g_bCanContinueTimer) {
-            m_pDownloadInfo->m_msgTimer.ContinueTime();
-        }
-
         if (false == PauseProcess() ) {
             taskDownload.CancelTask();
         }
@@ -9067,10 +10241,12 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
         while (m_pDownloadInfo->m_nDownloadStatus < DIOMEDE::downloadComplete) {
             // Waiting for status to change to complete - callback
             // into this object updates the upload status.
-            m_pDownloadInfo->m_msgTimer.ContinueTime();
+            PauseProcess();
         }
     }
 
+    m_progressRenderer.EndFile();
+
     //-----------------------------------------------------------------
     // Check results
     //-----------------------------------------------------------------
@@ -9090,7 +10266,14 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
         std::string szStatusMsg = _format(_T("Saved: %s"), szDisplayString.c_str());
         PrintStatusMsg(szStatusMsg, true);
 
-        ClientLog(UI_COMP, LOG_STATUS, false, _T("%s"), szStatusMsg.c_str());
+        ClientLog(UI_COMP, LOG_STATUS, false, _T("%s"), szStatusMsg.c_str());
+
+        if (bMakeSparse) {
+            MakeDownloadSparse(szDirectory, szDisplayString);
+        }
+
+        TransferMetrics::Instance()->EndTransfer(nResult);
+        TransferMetrics::Instance()->WriteSummary();
         return;
     }
 
@@ -9110,6 +10293,7 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
         g_nSessionRetries --;
 
         if (g_nSessionRetries >= 0) {
+            TransferMetrics::Instance()->RecordRetry(_T("session"));
             nResult = RepeatLastDownloadTask(&taskDownload);
         }
 
@@ -9122,6 +10306,13 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
             PrintStatusMsg(szStatusMsg, true);
 
             ClientLog(UI_COMP, LOG_STATUS, false, _T("%s"), szStatusMsg.c_str());
+
+            if (bMakeSparse) {
+                MakeDownloadSparse(szDirectory, szDisplayString);
+            }
+
+            TransferMetrics::Instance()->EndTransfer(nResult);
+            TransferMetrics::Instance()->WriteSummary();
             return;
         }
         else {
@@ -9139,8 +10330,60 @@ void ConsoleControl::ProcessDownloadCommand(CmdLine* pCmdLine,
 
     ClientLog(UI_COMP, LOG_ERROR, false,_T("Download file failed."));
 
+    TransferMetrics::Instance()->EndTransfer(nResult);
+    TransferMetrics::Instance()->WriteSummary();
+
 } // End ProcessDownloadCommand
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Releases the zero blocks of a downloaded file, recreating
+//          the holes of a sparse file (download /sparse).
+// Requires:
+//      szDirectory: download directory
+//      szFileName: downloaded file
+// Returns: nothing
+void ConsoleControl::MakeDownloadSparse(const std::string& szDirectory,
+                                        const std::string& szFileName)
+{
+    std::string szSlash = _T("\\");
+    #ifndef WIN32
+        szSlash = _T("/");
+    #endif
+
+    std::string szTrimmedDir = _T("");
+    RemoveQuotesFromArgument(szDirectory, szTrimmedDir);
+
+    std::string szName = _T("");
+    if (false == Util::GetFileName(szFileName, szName)) {
+        szName = szFileName;
+    }
+
+    std::string szFilePath = szTrimmedDir;
+    if ( (szFilePath.length() > 0) &&
+         (szFilePath.substr(szFilePath.length() - 1) != szSlash) ) {
+        szFilePath += szSlash;
+    }
+    szFilePath += szName;
+
+    LONG64 l64HoleBytes = 0;
+    if (false == Util::MakeFileSparse(szFilePath.c_str(), l64HoleBytes)) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Unable to make %s sparse."), szFilePath.c_str());
+        return;
+    }
+
+    if (l64HoleBytes > 0) {
+        std::string szBytes = _T("");
+        std::string szBytesSizeType = _T("");
+        StringUtil::FormatByteSize(l64HoleBytes, szBytes, szBytesSizeType);
+
+        std::string szStatusMsg = _format(_T("Sparse: %s %s released"),
+            szBytes.c_str(), szBytesSizeType.c_str());
+        PrintStatusMsg(szStatusMsg, true);
+        ClientLog(UI_COMP, LOG_STATUS, false, _T("%s: %s"), szFilePath.c_str(), szStatusMsg.c_str());
+    }
+
+} // End MakeDownloadSparse
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Helper function to manage the message timing of tasks.
 // Requires:
@@ -9191,6 +10434,7 @@ int ConsoleControl::RepeatLastDownloadTask(DiomedeTask* pTask)
         //-------------------------------------------------------------
 
         DownloadFileInfo* pNewDownloadInfo = new DownloadFileInfo(*m_pDownloadInfo);
+        m_progressRenderer.EndFile();
         delete m_pDownloadInfo;
         m_pDownloadInfo = pNewDownloadInfo;
 
@@ -9310,42 +10554,48 @@ void ConsoleControl::UpdateDownloadStatus(int nDownloadStatus, LONG64 l64Current
         return;
     }
 
+    LONG64 l64ReceivedBytes = l64CurrentBytes - m_pDownloadInfo->m_l64CurrentBytes;
+
     m_pDownloadInfo->m_nDownloadStatus = nDownloadStatus;
     m_pDownloadInfo->m_l64CurrentBytes = l64CurrentBytes;
     m_pDownloadInfo->m_l64TotalBytes = lTotalBytes;
 
-    if (lTotalBytes > 0) {
-        StringUtil::FormatByteSize(m_pDownloadInfo->m_l64TotalBytes, m_pDownloadInfo->m_szFormattedBytes,
-            m_pDownloadInfo->m_szFormattedBytesType);
-    }
-
-    std::string szDownloadFile = _T("");
     bool bHandled = true;
-    int nPercent = 0;
 
     switch (nDownloadStatus) {
         case DIOMEDE::downloadReceiving:
             {
                 if (lTotalBytes > 0) {
-
-                    nPercent =  (l64CurrentBytes == lTotalBytes) ? 100 :
-                        (int) (((float)l64CurrentBytes/(float)lTotalBytes) * 100);
-
-                    szDownloadFile = _format(_T("%s (%s %s)... %d%%"),
-                        m_pDownloadInfo->m_szFormattedFileName.c_str(),
-                        m_pDownloadInfo->m_szFormattedBytes.c_str(),
-                        m_pDownloadInfo->m_szFormattedBytesType.c_str(), nPercent);
-                }
-                else {
-                    szDownloadFile = _T("Downloading");
+                    TransferMetrics::Instance()->SetTransferFileSize(lTotalBytes);
                 }
+                TransferMetrics::Instance()->ChunkComplete(l64CurrentBytes);
 
+                // The first status starts the timer - progress is then drawn
+                // by the renderer.
                 if (m_pDownloadInfo->m_msgTimer.IsStarted() == false) {
+                    std::string szDownloadFile = _T("Downloading");
+
+                    if (lTotalBytes > 0) {
+                        StringUtil::FormatByteSize(lTotalBytes, m_pDownloadInfo->m_szFormattedBytes,
+                            m_pDownloadInfo->m_szFormattedBytesType);
+
+                        szDownloadFile = _format(_T("%s (%s %s)"),
+                            m_pDownloadInfo->m_szFormattedFileName.c_str(),
+                            m_pDownloadInfo->m_szFormattedBytes.c_str(),
+                            m_pDownloadInfo->m_szFormattedBytesType.c_str());
+                    }
+
                     m_pDownloadInfo->m_msgTimer.Start(szDownloadFile);
+                    m_progressRenderer.BeginFile(&m_pDownloadInfo->m_msgTimer, lTotalBytes);
                 }
+                else if (lTotalBytes > 0) {
+                    m_progressRenderer.UpdateFileSize(lTotalBytes);
+                }
+
+                m_progressRenderer.UpdateBytes(l64CurrentBytes);
 
-                m_pDownloadInfo->m_msgTimer.ContinueTime(szDownloadFile);
-                g_bCanContinueTimer = true;
+                // Holds up the receive when over the bandwidth limit.
+                BandwidthLimiter::Instance()->Throttle(m_downloadBandwidth, l64ReceivedBytes);
             }
             break;
         default:
@@ -13589,6 +14839,12 @@ void ConsoleControl::ProcessGetMyProductsCommand(CmdLine* pCmdLine,
         cerr << "error: " << e.error() << " for arg " << CMD_GETMYPRODUCTS << endl;
     }
 
+    int nOutputFormat = RecordWriterTypes::recordFormatNone;
+    if (GetOutputFormat(pCmdLine, nOutputFormat) == false) {
+        return;
+    }
+    bool bShowProgress = (nOutputFormat == RecordWriterTypes::recordFormatNone);
+
     if (pOutputArg && pOutputArg->isSet()) {
         SimpleRedirect::Instance()->StartRedirect(pOutputArg->getValue() );
     }
@@ -13596,10 +14852,13 @@ void ConsoleControl::ProcessGetMyProductsCommand(CmdLine* pCmdLine,
     //-----------------------------------------------------------------
     // Process GetMyProducts
     //-----------------------------------------------------------------
-    PrintNewLine();
+    if (bShowProgress) {
+        PrintNewLine();
+    }
 
 	DIOMEDE_CONSOLE::GetMyProductsTask taskGetMyProducts(m_szSessionToken);
-	int nResult = HandleTask(&taskGetMyProducts, _T("Getting my products"), _T(""), false, false);
+	int nResult = HandleTask(&taskGetMyProducts, _T("Getting my products"), _T(""), false, false,
+	                         bShowProgress);
 
     //-----------------------------------------------------------------
     // Check GetMyProducts results
@@ -13617,7 +14876,8 @@ void ConsoleControl::ProcessGetMyProductsCommand(CmdLine* pCmdLine,
     // Process GetMyContracts
     //-----------------------------------------------------------------
 	DIOMEDE_CONSOLE::GetMyContractsTask taskGetMyContracts(m_szSessionToken);
-	nResult = HandleTask(&taskGetMyContracts, _T("Getting my contracts"), _T(""), false, false);
+	nResult = HandleTask(&taskGetMyContracts, _T("Getting my contracts"), _T(""), false, false,
+	                     bShowProgress);
 
     //-----------------------------------------------------------------
     // Check GetMyContracts results
@@ -13636,7 +14896,9 @@ void ConsoleControl::ProcessGetMyProductsCommand(CmdLine* pCmdLine,
     //-----------------------------------------------------------------
 
     // Since we've turned off the task new lines, add one now...
-    PrintNewLine();
+    if (bShowProgress) {
+        PrintNewLine();
+    }
 
     UserProductListImpl* pListUserProducts = taskGetMyProducts.GetUserProductResults();
     UserContractListImpl* pListUserContracts = taskGetMyContracts.GetUserContractResults();
@@ -13651,7 +14913,9 @@ void ConsoleControl::ProcessGetMyProductsCommand(CmdLine* pCmdLine,
     // Edge case to ensure we did get something back.
     if (listMyProducts.size() == 0) {
         std::string szStatusMsg = _T("Get my products: no rates returned.");
-        PrintStatusMsg(szStatusMsg);
+        if (bShowProgress) {
+            PrintStatusMsg(szStatusMsg);
+        }
 
         ClientLog(UI_COMP, LOG_ERROR, false, _T("%s"), szStatusMsg.c_str());
         /*
@@ -13674,6 +14938,12 @@ void ConsoleControl::ProcessGetMyProductsCommand(CmdLine* pCmdLine,
         GetStorageTypes(false);
     }
 
+    if (bShowProgress == false) {
+        WriteMyProductsRecords(pListUserProducts, pListUserContracts, nOutputFormat);
+        SimpleRedirect::Instance()->EndRedirect();
+        return;
+    }
+
     //-----------------------------------------------------------------
     // locale facet for formatting currency
     //-----------------------------------------------------------------
@@ -13929,6 +15199,129 @@ void ConsoleControl::ProcessGetMyProductsCommand(CmdLine* pCmdLine,
 
 } // End ProcessGetMyProductsCommand
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to write the user's products and contracts
+//          in a machine readable format - one row per product rate
+//          component and one row per contract component.
+// Requires:
+//      pListUserProducts: reference to the list of user products.
+//      pListUserContracts: reference to the list of user contracts.
+//      nFormat: RecordFormatType
+// Returns: nothing
+void ConsoleControl::WriteMyProductsRecords(UserProductListImpl* pListUserProducts,
+                                            UserContractListImpl* pListUserContracts,
+                                            int nFormat)
+{
+    static const char* const MY_PRODUCTS_COLUMNS[] = {
+        _T("type"), _T("id"), _T("name"), _T("storage_type"), _T("meter_type"),
+        _T("committed_gb"), _T("term"), _T("rate"), _T("min_monthly_fee"), _T("support_fee")
+    };
+
+    // Rates are sent with 4 digit precision - see the DiomedeMoneyPunct
+    // used for the console output.
+    const int nRatePrecision = 4;
+
+    RecordWriter recordWriter(stdout, nFormat);
+    recordWriter.SetColumns(MY_PRODUCTS_COLUMNS,
+        sizeof(MY_PRODUCTS_COLUMNS) / sizeof(MY_PRODUCTS_COLUMNS[0]));
+
+    std::string szStorageTypeName = _T("");
+    int nCompIndex = 0;
+
+    //-----------------------------------------------------------------
+    // Products
+    //-----------------------------------------------------------------
+    std::vector<void * > listMyProducts = pListUserProducts->GetUserProductList();
+
+    for (int nMyRateIndex = 0; nMyRateIndex < (int)listMyProducts.size(); nMyRateIndex ++) {
+
+        UserProductImpl* pUserProduct = (UserProductImpl*)listMyProducts[nMyRateIndex];
+        if (pUserProduct == NULL) {
+            ClientLog(UI_COMP, LOG_ERROR, false,_T("Get my products: NULL product set."));
+            continue;
+        }
+
+        ComponentListImpl* pProductComponents = pUserProduct->GetComponentList();
+        if (pProductComponents == NULL) {
+            ClientLog(UI_COMP, LOG_ERROR, false,_T("Get my products: NULL list of rate components."));
+            continue;
+        }
+
+        std::vector<void * > listProductComponents = pProductComponents->GetComponentList();
+
+        for (nCompIndex = 0; nCompIndex < (int)listProductComponents.size(); nCompIndex ++) {
+            ComponentImpl* pProductComponent = (ComponentImpl*)listProductComponents[nCompIndex];
+            if (pProductComponent == NULL) {
+                continue;
+            }
+
+            szStorageTypeName = _T("");
+            GetStorageTypeName(pProductComponent->GetStorageTypeID(), szStorageTypeName);
+
+            recordWriter.BeginRecord();
+            recordWriter.AddString(_T("product"));
+            recordWriter.AddInt64(pUserProduct->GetProductID());
+            recordWriter.AddString(pUserProduct->GetName());
+            recordWriter.AddString(szStorageTypeName);
+            recordWriter.AddString(pProductComponent->GetMeterType());
+            recordWriter.AddNull();
+            recordWriter.AddNull();
+            recordWriter.AddAmount(pProductComponent->GetRatePerGB(), nRatePrecision);
+            recordWriter.AddAmount(pUserProduct->GetMinMonthlyFee(), nRatePrecision);
+            recordWriter.AddAmount(pUserProduct->GetSupportFee(), nRatePrecision);
+            recordWriter.EndRecord();
+        }
+    }
+
+    //-----------------------------------------------------------------
+    // Contracts - the rate is per term for the whole contract.
+    //-----------------------------------------------------------------
+    std::vector<void * > listMyContracts = pListUserContracts->GetUserContractList();
+
+    for (int nMyContractIndex = 0; nMyContractIndex < (int)listMyContracts.size(); nMyContractIndex ++) {
+
+        UserContractImpl* pUserContract = (UserContractImpl*)listMyContracts[nMyContractIndex];
+        if (pUserContract == NULL) {
+            ClientLog(UI_COMP, LOG_ERROR, false,_T("Get my contracts: NULL contract."));
+            continue;
+        }
+
+        ContractComponentListImpl* pListContractComponents = pUserContract->GetContractComponentList();
+        if (pListContractComponents == NULL) {
+            ClientLog(UI_COMP, LOG_ERROR, false,_T("Get my contracts: NULL contract components."));
+            continue;
+        }
+
+        std::vector<void * > listContractComponents = pListContractComponents->GetContractComponentList();
+
+        for (nCompIndex = 0; nCompIndex < (int)listContractComponents.size(); nCompIndex++) {
+            ContractComponentImpl* pContractComponent = (ContractComponentImpl*)listContractComponents[nCompIndex];
+            if (pContractComponent == NULL) {
+                continue;
+            }
+
+            szStorageTypeName = _T("");
+            GetStorageTypeName(pContractComponent->GetStorageTypeID(), szStorageTypeName);
+
+            recordWriter.BeginRecord();
+            recordWriter.AddString(_T("contract"));
+            recordWriter.AddInt64(pUserContract->GetContractID());
+            recordWriter.AddNull();
+            recordWriter.AddString(szStorageTypeName);
+            recordWriter.AddString(pContractComponent->GetMeterType());
+            recordWriter.AddInt64(pContractComponent->GetCommittedGB());
+            recordWriter.AddInt64(pUserContract->GetTerm());
+            recordWriter.AddAmount(pUserContract->GetRatePerTerm(), nRatePrecision);
+            recordWriter.AddNull();
+            recordWriter.AddNull();
+            recordWriter.EndRecord();
+        }
+    }
+
+    recordWriter.Finish();
+
+} // End WriteMyProductsRecords
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Process the cancel product command.
 // Requires:
@@ -14709,6 +16102,12 @@ void ConsoleControl::ProcessSearchUploadLogCommand(CmdLine* pCmdLine,
         cerr << "error: " << e.error() << " for arg " << CMD_SEARCHUPLOADS << endl;
     }
 
+    int nOutputFormat = RecordWriterTypes::recordFormatNone;
+    if (GetOutputFormat(pCmdLine, nOutputFormat) == false) {
+        return;
+    }
+    bool bShowProgress = (nOutputFormat == RecordWriterTypes::recordFormatNone);
+
     SearchUploadLogFilterImpl* pSearchFilter = new SearchUploadLogFilterImpl;
 
     if (pFileIDArg && pFileIDArg->isSet()) {
@@ -14767,7 +16166,8 @@ void ConsoleControl::ProcessSearchUploadLogCommand(CmdLine* pCmdLine,
     // Process search
     //-----------------------------------------------------------------
 	DIOMEDE_CONSOLE::SearchUploadLogTask taskUploadLog(m_szSessionToken, pSearchFilter);
-	int nResult = HandleTask(&taskUploadLog, _T("Searching upload log"));
+	int nResult = HandleTask(&taskUploadLog, _T("Searching upload log"), _T(""), false, true,
+	                         bShowProgress);
 
     //-----------------------------------------------------------------
     // Cleanup
@@ -14803,6 +16203,12 @@ void ConsoleControl::ProcessSearchUploadLogCommand(CmdLine* pCmdLine,
     UploadLogListImpl* pListUploadLog = taskUploadLog.GetSearchUploadLogResults();
     std::vector<void * > listLogEntries = pListUploadLog->GetUploadLogList();
 
+    if (bShowProgress == false) {
+        WriteUploadLogRecords(pListUploadLog, nOutputFormat);
+        SimpleRedirect::Instance()->EndRedirect();
+        return;
+    }
+
     // If no entries found, output a message and return.
     if ((int)listLogEntries.size() == 0) {
         PrintStatusMsg(_T("Search upload log successful.  No matches found."));
@@ -14839,6 +16245,43 @@ void ConsoleControl::ProcessSearchUploadLogCommand(CmdLine* pCmdLine,
 
 } // End ProcessSearchUploadLogCommand
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to write the upload log entries in a
+//          machine readable format.
+// Requires:
+//      pListUploadLog: reference to the list of upload log entries.
+//      nFormat: RecordFormatType
+// Returns: nothing
+void ConsoleControl::WriteUploadLogRecords(UploadLogListImpl* pListUploadLog, int nFormat)
+{
+    static const char* const UPLOAD_LOG_COLUMNS[] = {
+        _T("file_id"), _T("upload_time"), _T("uploader_ip")
+    };
+
+    RecordWriter recordWriter(stdout, nFormat);
+    recordWriter.SetColumns(UPLOAD_LOG_COLUMNS,
+        sizeof(UPLOAD_LOG_COLUMNS) / sizeof(UPLOAD_LOG_COLUMNS[0]));
+
+    std::vector<void * > listLogEntries = pListUploadLog->GetUploadLogList();
+
+    for (int nIndex = 0; nIndex < (int)listLogEntries.size(); nIndex ++) {
+
+        UploadLogEntryImpl* pLogEntry = (UploadLogEntryImpl*)listLogEntries[nIndex];
+        if (pLogEntry == NULL) {
+            continue;
+        }
+
+        recordWriter.BeginRecord();
+        recordWriter.AddInt64(pLogEntry->GetFileID());
+        recordWriter.AddDateTime(pLogEntry->GetUploadTime());
+        recordWriter.AddString(pLogEntry->GetUploaderIP());
+        recordWriter.EndRecord();
+    }
+
+    recordWriter.Finish();
+
+} // End WriteUploadLogRecords
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Process the search download log command.  User must be
 //          logged into the Diomede service.
@@ -14884,6 +16327,12 @@ void ConsoleControl::ProcessSearchDownloadLogCommand(CmdLine* pCmdLine,
         cerr << "error: " << e.error() << " for arg " << CMD_SEARCHDOWNLOADS << endl;
     }
 
+    int nOutputFormat = RecordWriterTypes::recordFormatNone;
+    if (GetOutputFormat(pCmdLine, nOutputFormat) == false) {
+        return;
+    }
+    bool bShowProgress = (nOutputFormat == RecordWriterTypes::recordFormatNone);
+
     SearchDownloadLogFilterImpl* pSearchFilter = new SearchDownloadLogFilterImpl;
 
     if (pFileIDArg && pFileIDArg->isSet()) {
@@ -14945,7 +16394,8 @@ void ConsoleControl::ProcessSearchDownloadLogCommand(CmdLine* pCmdLine,
     // Process search
     //-----------------------------------------------------------------
 	DIOMEDE_CONSOLE::SearchDownloadLogTask taskDownloadLog(m_szSessionToken, pSearchFilter);
-	int nResult = HandleTask(&taskDownloadLog, _T("Searching download log"));
+	int nResult = HandleTask(&taskDownloadLog, _T("Searching download log"), _T(""), false, true,
+	                         bShowProgress);
 
     //-----------------------------------------------------------------
     // Cleanup
@@ -14981,6 +16431,12 @@ void ConsoleControl::ProcessSearchDownloadLogCommand(CmdLine* pCmdLine,
     DownloadLogListImpl* pListDownloadLog = taskDownloadLog.GetSearchDownloadLogResults();
     std::vector<void * > listLogEntries = pListDownloadLog->GetDownloadLogList();
 
+    if (bShowProgress == false) {
+        WriteDownloadLogRecords(pListDownloadLog, nOutputFormat);
+        SimpleRedirect::Instance()->EndRedirect();
+        return;
+    }
+
     // If no entries found, output a message and return.
     if ((int)listLogEntries.size() == 0) {
         PrintStatusMsg(_T("Search download log successful.  No matches found."));
@@ -15027,6 +16483,48 @@ void ConsoleControl::ProcessSearchDownloadLogCommand(CmdLine* pCmdLine,
 
 } // End ProcessSearchDownloadLogCommand
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to write the download log entries in a
+//          machine readable format.
+// Requires:
+//      pListDownloadLog: reference to the list of download log entries.
+//      nFormat: RecordFormatType
+// Returns: nothing
+void ConsoleControl::WriteDownloadLogRecords(DownloadLogListImpl* pListDownloadLog, int nFormat)
+{
+    static const char* const DOWNLOAD_LOG_COLUMNS[] = {
+        _T("file_id"), _T("start_byte"), _T("byte_count"), _T("start_time"),
+        _T("end_time"), _T("download_token"), _T("downloader_ip")
+    };
+
+    RecordWriter recordWriter(stdout, nFormat);
+    recordWriter.SetColumns(DOWNLOAD_LOG_COLUMNS,
+        sizeof(DOWNLOAD_LOG_COLUMNS) / sizeof(DOWNLOAD_LOG_COLUMNS[0]));
+
+    std::vector<void * > listLogEntries = pListDownloadLog->GetDownloadLogList();
+
+    for (int nIndex = 0; nIndex < (int)listLogEntries.size(); nIndex ++) {
+
+        DownloadLogEntryImpl* pLogEntry = (DownloadLogEntryImpl*)listLogEntries[nIndex];
+        if (pLogEntry == NULL) {
+            continue;
+        }
+
+        recordWriter.BeginRecord();
+        recordWriter.AddInt64(pLogEntry->GetFileID());
+        recordWriter.AddInt64(pLogEntry->GetStartByte());
+        recordWriter.AddInt64(pLogEntry->GetByteCount());
+        recordWriter.AddDateTime(pLogEntry->GetStartTime());
+        recordWriter.AddDateTime(pLogEntry->GetEndTime());
+        recordWriter.AddString(pLogEntry->GetDownloadeToken());
+        recordWriter.AddString(pLogEntry->GetDownloaderIP());
+        recordWriter.EndRecord();
+    }
+
+    recordWriter.Finish();
+
+} // End WriteDownloadLogRecords
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Process the search login log command.  User must be
 //          logged into the Diomede service.
@@ -15067,6 +16565,12 @@ void ConsoleControl::ProcessSearchLoginLogCommand(CmdLine* pCmdLine,
         cerr << "error: " << e.error() << " for arg " << CMD_SEARCHLOGINS << endl;
     }
 
+    int nOutputFormat = RecordWriterTypes::recordFormatNone;
+    if (GetOutputFormat(pCmdLine, nOutputFormat) == false) {
+        return;
+    }
+    bool bShowProgress = (nOutputFormat == RecordWriterTypes::recordFormatNone);
+
     SearchLoginLogFilterImpl* pSearchFilter = new SearchLoginLogFilterImpl;
 
     time_t epochSeconds;
@@ -15119,7 +16623,8 @@ void ConsoleControl::ProcessSearchLoginLogCommand(CmdLine* pCmdLine,
     // Process search
     //-----------------------------------------------------------------
 	DIOMEDE_CONSOLE::SearchLoginLogTask taskLoginLog(m_szSessionToken, pSearchFilter);
-	int nResult = HandleTask(&taskLoginLog, _T("Searching login log"));
+	int nResult = HandleTask(&taskLoginLog, _T("Searching login log"), _T(""), false, true,
+	                         bShowProgress);
 
     //-----------------------------------------------------------------
     // Cleanup
@@ -15155,6 +16660,12 @@ void ConsoleControl::ProcessSearchLoginLogCommand(CmdLine* pCmdLine,
     LoginLogListImpl* pLoginlLog = taskLoginLog.GetSearchLoginLogResults();
     std::vector<void * > listLogEntries = pLoginlLog->GetLoginLogList();
 
+    if (bShowProgress == false) {
+        WriteLoginLogRecords(pLoginlLog, nOutputFormat);
+        SimpleRedirect::Instance()->EndRedirect();
+        return;
+    }
+
     // If no entries found, output a message and return.
     if ((int)listLogEntries.size() == 0) {
         PrintStatusMsg(_T("Search login log successful.  No matches found."));
@@ -15182,6 +16693,43 @@ void ConsoleControl::ProcessSearchLoginLogCommand(CmdLine* pCmdLine,
 
 } // End ProcessSearchLoginLogCommand
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to write the login log entries in a
+//          machine readable format.
+// Requires:
+//      pListLoginLog: reference to the list of login log entries.
+//      nFormat: RecordFormatType
+// Returns: nothing
+void ConsoleControl::WriteLoginLogRecords(LoginLogListImpl* pListLoginLog, int nFormat)
+{
+    static const char* const LOGIN_LOG_COLUMNS[] = {
+        _T("login"), _T("login_date"), _T("login_ip")
+    };
+
+    RecordWriter recordWriter(stdout, nFormat);
+    recordWriter.SetColumns(LOGIN_LOG_COLUMNS,
+        sizeof(LOGIN_LOG_COLUMNS) / sizeof(LOGIN_LOG_COLUMNS[0]));
+
+    std::vector<void * > listLogEntries = pListLoginLog->GetLoginLogList();
+
+    for (int nIndex = 0; nIndex < (int)listLogEntries.size(); nIndex ++) {
+
+        LoginLogEntryImpl* pLogEntry = (LoginLogEntryImpl*)listLogEntries[nIndex];
+        if (pLogEntry == NULL) {
+            continue;
+        }
+
+        recordWriter.BeginRecord();
+        recordWriter.AddString(pLogEntry->GetUserID());
+        recordWriter.AddDateTime(pLogEntry->GetLoginDate());
+        recordWriter.AddString(pLogEntry->GetLoginIP());
+        recordWriter.EndRecord();
+    }
+
+    recordWriter.Finish();
+
+} // End WriteLoginLogRecords
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Process the search invoice log command.  User must be
 //          logged into the Diomede service.
@@ -15219,6 +16767,12 @@ void ConsoleControl::ProcessSearchInvoiceLogCommand(CmdLine* pCmdLine,
         cerr << "error: " << e.error() << " for arg " << CMD_SEARCHINVOICES << endl;
     }
 
+    int nOutputFormat = RecordWriterTypes::recordFormatNone;
+    if (GetOutputFormat(pCmdLine, nOutputFormat) == false) {
+        return;
+    }
+    bool bShowProgress = (nOutputFormat == RecordWriterTypes::recordFormatNone);
+
     bool bTestOutput = TestOutput(pCmdLine);
 
     SearchLogFilterImpl* pSearchFilter = new SearchLogFilterImpl;
@@ -15272,7 +16826,8 @@ void ConsoleControl::ProcessSearchInvoiceLogCommand(CmdLine* pCmdLine,
     // Process search
     //-----------------------------------------------------------------
 	DIOMEDE_CONSOLE::SearchInvoiceLogTask taskInvoiceLog(m_szSessionToken, pSearchFilter);
-	int nResult = HandleTask(&taskInvoiceLog, _T("Searching invoice log"));
+	int nResult = HandleTask(&taskInvoiceLog, _T("Searching invoice log"), _T(""), false, true,
+	                         bShowProgress);
 
     //-----------------------------------------------------------------
     // Cleanup
@@ -15317,7 +16872,12 @@ void ConsoleControl::ProcessSearchInvoiceLogCommand(CmdLine* pCmdLine,
 
     if ((int)listLogEntries.size() == 0) {
         if (bTestOutput == false) {
-            PrintStatusMsg(_T("Search invoice log successful.  No invoices found."));
+            if (bShowProgress) {
+                PrintStatusMsg(_T("Search invoice log successful.  No invoices found."));
+            }
+            else {
+                WriteInvoiceLogRecords(pListInvoiceLogEntries, nOutputFormat);
+            }
             SimpleRedirect::Instance()->EndRedirect();
             return;
         }
@@ -15328,6 +16888,17 @@ void ConsoleControl::ProcessSearchInvoiceLogCommand(CmdLine* pCmdLine,
         }
     }
 
+    if (bShowProgress == false) {
+        WriteInvoiceLogRecords(pListInvoiceLogEntries, nOutputFormat);
+
+        if (bCleanupTest) {
+            TestSearchInvoicesCleanup(pListInvoiceLogEntries, bCreateNewInvoice);
+        }
+
+        SimpleRedirect::Instance()->EndRedirect();
+        return;
+    }
+
     std::string szFormattedDate = _T("");
     std::string szStatus;
 
@@ -15407,19 +16978,79 @@ void ConsoleControl::ProcessSearchInvoiceLogCommand(CmdLine* pCmdLine,
            szStatus = _T("PAID");
         }
 
-        cout << setw(60) << right << _T("Status: ");
-        cout << setw(12) << right << szStatus << endl;
+        cout << setw(60) << right << _T("Status: ");
+        cout << setw(12) << right << szStatus << endl;
+
+        cout << endl;
+    }
+
+    if (bCleanupTest) {
+        TestSearchInvoicesCleanup(pListInvoiceLogEntries, bCreateNewInvoice);
+    }
+
+    SimpleRedirect::Instance()->EndRedirect();
+
+} // End ProcessSearchInvoiceLogCommand
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Helper function to write the invoices in a machine readable
+//          format - one row per invoice detail, with the invoice
+//          number, date, total and status repeated on each row.
+// Requires:
+//      pListInvoiceLogEntries: reference to the list of invoices.
+//      nFormat: RecordFormatType
+// Returns: nothing
+void ConsoleControl::WriteInvoiceLogRecords(InvoiceLogListImpl* pListInvoiceLogEntries, int nFormat)
+{
+    static const char* const INVOICE_LOG_COLUMNS[] = {
+        _T("invoice_number"), _T("invoice_date"), _T("item"), _T("amount"),
+        _T("total_amount"), _T("paid")
+    };
+
+    // Invoice amounts are sent with 2 digit precision.
+    const int nAmountPrecision = 2;
+
+    RecordWriter recordWriter(stdout, nFormat);
+    recordWriter.SetColumns(INVOICE_LOG_COLUMNS,
+        sizeof(INVOICE_LOG_COLUMNS) / sizeof(INVOICE_LOG_COLUMNS[0]));
+
+    std::vector<void * > listLogEntries = pListInvoiceLogEntries->GetInvoiceLogList();
+
+    for (int nIndex = 0; nIndex < (int)listLogEntries.size(); nIndex ++) {
+
+        InvoiceLogEntryImpl* pInvoiceLogEntry = (InvoiceLogEntryImpl*)listLogEntries[nIndex];
+        if (pInvoiceLogEntry == NULL) {
+            continue;
+        }
+
+        InvoiceDetailListImpl* pInvoiceDetails = pInvoiceLogEntry->GetInvoiceDetailList();
+        if (pInvoiceDetails == NULL) {
+            continue;
+        }
+
+        std::vector<void * > listInvoiceDetail = pInvoiceDetails->GetInvoiceDetailList();
 
-        cout << endl;
-    }
+        for (int nInvoiceIndex = 0; nInvoiceIndex < (int)listInvoiceDetail.size(); nInvoiceIndex++) {
 
-    if (bCleanupTest) {
-        TestSearchInvoicesCleanup(pListInvoiceLogEntries, bCreateNewInvoice);
+            InvoiceDetailImpl* pDetail = (InvoiceDetailImpl*)listInvoiceDetail[nInvoiceIndex];
+            if (pDetail == NULL) {
+                continue;
+            }
+
+            recordWriter.BeginRecord();
+            recordWriter.AddInt64(pInvoiceLogEntry->GetInvoiceNumber());
+            recordWriter.AddDateTime(pInvoiceLogEntry->GetInvoiceDate());
+            recordWriter.AddString(pDetail->GetItemDescription());
+            recordWriter.AddAmount(pDetail->GetAmount(), nAmountPrecision);
+            recordWriter.AddAmount(pInvoiceLogEntry->GetTotalAmount(), nAmountPrecision);
+            recordWriter.AddBool(pInvoiceLogEntry->GetIsPaid());
+            recordWriter.EndRecord();
+        }
     }
 
-    SimpleRedirect::Instance()->EndRedirect();
+    recordWriter.Finish();
 
-} // End ProcessSearchInvoiceLogCommand
+} // End WriteInvoiceLogRecords
 
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Helper function to test the search invoices output layout.
@@ -15524,74 +17155,555 @@ void ConsoleControl::ProcessSystemCommand(DioCLICommands::COMMAND_ID cmdID,
     std::string sysCommand = pCmdLine->getCommandName();
     bCommandFinished = true;
 
-    switch (cmdID) {
-		case DioCLICommands::CMD_CLS:
-            #ifdef WIN32
-                system(sysCommand.c_str());
-            #else
-                // 99% of non-windows terminals will accept ANSI X3.64 escape codes
-                // (not a real statistic)
-                printf("\x1b[2J\x1b[1;1H");     // clear screen, move cursor to top left
-                fflush(stdout);                 // stdout might be line-buffered
-            #endif
-            break;
-		case DioCLICommands::CMD_REM:
-		    // Ignored the remark commands
-		    break;
-		default:
-		    break;
+    switch (cmdID) {
+		case DioCLICommands::CMD_CLS:
+            #ifdef WIN32
+                system(sysCommand.c_str());
+            #else
+                // 99% of non-windows terminals will accept ANSI X3.64 escape codes
+                // (not a real statistic)
+                printf("\x1b[2J\x1b[1;1H");     // clear screen, move cursor to top left
+                fflush(stdout);                 // stdout might be line-buffered
+            #endif
+            break;
+		case DioCLICommands::CMD_REM:
+		    // Ignored the remark commands
+		    break;
+		default:
+		    break;
+    }
+
+} // End ProcessSystemCommand
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Handle the system ECHO command
+// Requires:
+//      pCmdLine: current command line
+//      bCommandFinished: true if the command is finished, false otherwise.
+// Returns: nothing
+void ConsoleControl::ProcessEchoSystemCommand(CmdLine* pCmdLine,
+                                              bool& bCommandFinished)
+{
+    std::string sysCommand = pCmdLine->getCommandName();
+    bCommandFinished = true;
+
+    // If no arguments, show the current status of echo.
+    // Otherwise, turns off or on echo.
+
+    // This is a bit redundant - either put the parameters back together or
+    // use the action stack as is...using the system command doesn't work
+    // within our console - any features of echo we need to implement we'll
+    // need to do ourselves..
+    // nReturn = system(m_actionStack.front().c_str());
+
+    // Get the list of arguments - this command is a multi-unlabeled argument.
+    DiomedeUnlabeledValueArg<std::string>* pEchoArg = NULL;
+
+    try {
+        pEchoArg = (DiomedeUnlabeledValueArg<std::string>*)pCmdLine->getArg(ARG_ECHO);
+    }
+    catch (CmdLineParseException &e) {
+        // catch any exceptions
+        cerr << "error: " << e.error() << " for arg " << CMD_ECHO << endl;
+    }
+
+    if (pEchoArg == NULL){
+        return;
+    }
+
+	std::string szEchoParam = pEchoArg->getValue();
+    bCommandFinished = true;
+
+	if (szEchoParam.length() == 0)  {
+	    std::string szParam = m_bEchoOn ? _T("on") : _T("off");
+	    std::cout << std::endl << "Echo is " << szParam << std::endl;
+	}
+	else {
+	    m_bEchoOn = (0==stricmp(szEchoParam.c_str(), _T("on")));
+	}
+
+} // End ProcessEchoSystemCommand
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Handle the benchmark command - creates the synthetic trees,
+//          then times upload, search, download and resume of each one
+//          against the local mock service, using the same command
+//          handlers as the console.  The in-process cases run last.
+// Requires:
+//      pCmdLine: current command line
+//      bCommandFinished: true if the command is finished, false otherwise.
+// Returns: nothing
+void ConsoleControl::ProcessBenchmarkCommand(CmdLine* pCmdLine,
+                                             bool& bCommandFinished)
+{
+    bCommandFinished = true;
+
+    DiomedeValueArg<std::string>* pTreeArg = NULL;
+    DiomedeValueArg<std::string>* pCaseArg = NULL;
+    DiomedeValueArg<std::string>* pFilesArg = NULL;
+    DiomedeValueArg<std::string>* pSizeArg = NULL;
+    DiomedeValueArg<std::string>* pDirectoryArg = NULL;
+    DiomedeValueArg<std::string>* pOutputArg = NULL;
+    DiomedeSwitchArg* pKeepArg = NULL;
+
+    try {
+        pTreeArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_BENCHMARK_TREE);
+        pCaseArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_BENCHMARK_CASE);
+        pFilesArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_BENCHMARK_FILES);
+        pSizeArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_BENCHMARK_SIZE);
+        pDirectoryArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_DIRECTORY);
+        pOutputArg = (DiomedeValueArg<std::string>*)pCmdLine->getArg(ARG_OUTPUT);
+        pKeepArg = (DiomedeSwitchArg*)pCmdLine->getArg(ARG_BENCHMARK_KEEP_SWITCH);
+    }
+    catch (CmdLineParseException &e) {
+        // catch any exceptions
+        cerr << "error: " << e.error() << " for arg " << CMD_BENCHMARK << endl;
+    }
+
+    //-----------------------------------------------------------------
+    // Trees and cases to run - all of them unless one or the other is
+    // named.  Naming only a tree skips the cases, and the reverse.
+    //-----------------------------------------------------------------
+    bool bTreeSet = (pTreeArg && pTreeArg->isSet());
+    bool bCaseSet = (pCaseArg && pCaseArg->isSet());
+
+    int nFirstTree = BenchmarkTreeTypes::treeSmall;
+    int nLastTree = BenchmarkTreeTypes::LAST_TREE_TYPE - 1;
+
+    if (bCaseSet && !bTreeSet) {
+        nLastTree = nFirstTree - 1;
+    }
+    else if (bTreeSet && (pTreeArg->getValue() != ARG_ALL)) {
+        for (int nTreeType = 0; nTreeType < BenchmarkTreeTypes::LAST_TREE_TYPE; nTreeType++) {
+            if (pTreeArg->getValue() == BenchmarkTreeTypes::BenchmarkTreeNames[nTreeType]) {
+                nFirstTree = nLastTree = nTreeType;
+                break;
+            }
+        }
+    }
+
+    int nFirstCase = BenchmarkCaseTypes::caseFormat;
+    int nLastCase = BenchmarkCaseTypes::LAST_CASE_TYPE - 1;
+
+    if (bTreeSet && !bCaseSet) {
+        nLastCase = nFirstCase - 1;
+    }
+    else if (bCaseSet && (pCaseArg->getValue() != ARG_ALL)) {
+        for (int nCaseType = 0; nCaseType < BenchmarkCaseTypes::LAST_CASE_TYPE; nCaseType++) {
+            if (pCaseArg->getValue() == BenchmarkCaseTypes::BenchmarkCaseNames[nCaseType]) {
+                nFirstCase = nLastCase = nCaseType;
+                break;
+            }
+        }
+    }
+
+    bool bRunTrees = (nFirstTree <= nLastTree);
+
+    int nFiles = 0;
+    if (pFilesArg && pFilesArg->isSet()) {
+        nFiles = atoi(pFilesArg->getValue().c_str());
+        if (nFiles <= 0) {
+            PrintStatusMsg(_T("Benchmark: the file count must be greater than 0."));
+            return;
+        }
+    }
+
+    LONG64 l64FileSize = 0;
+    if (pSizeArg && pSizeArg->isSet()) {
+        l64FileSize = atoi64(pSizeArg->getValue().c_str()) * 1024;
+        if (l64FileSize <= 0) {
+            PrintStatusMsg(_T("Benchmark: the file size must be greater than 0."));
+            return;
+        }
+    }
+
+    std::string szSlash = _T("\\");
+    #ifndef WIN32
+        szSlash = _T("/");
+    #endif
+
+    std::string szWorkDir = ResumeManager::Instance()->GetAppDataDir() + CMD_BENCHMARK;
+    if (pDirectoryArg && pDirectoryArg->isSet()) {
+        RemoveQuotesFromArgument(pDirectoryArg->getValue(), szWorkDir);
+    }
+
+    FILE* pReportFile = NULL;
+    if (pOutputArg && pOutputArg->isSet()) {
+        std::string szReportFile = _T("");
+        RemoveQuotesFromArgument(pOutputArg->getValue(), szReportFile);
+
+        pReportFile = fopen(szReportFile.c_str(), _T("a"));
+        if (pReportFile == NULL) {
+            PrintStatusMsg(_format(_T("Benchmark: %s could not be opened."),
+                szReportFile.c_str()));
+            return;
+        }
+    }
+
+    bool bKeep = (pKeepArg && pKeepArg->isSet());
+
+    //-----------------------------------------------------------------
+    // Create the trees first - the first one creates the work
+    // directory, which holds the mock store.
+    //-----------------------------------------------------------------
+    BenchmarkTree benchmarkTrees[BenchmarkTreeTypes::LAST_TREE_TYPE];
+    bool bSuccess = true;
+
+    PrintNewLine();
+
+    for (int nTreeType = nFirstTree; nTreeType <= nLastTree; nTreeType++) {
+        PrintStatusMsg(_format(_T("Benchmark: creating the %s tree..."),
+            BenchmarkTreeTypes::BenchmarkTreeNames[nTreeType].c_str()), false, false);
+
+        if (false == benchmarkTrees[nTreeType].Create(szWorkDir, nTreeType, nFiles,
+                                                      l64FileSize)) {
+            PrintStatusMsg(_format(_T("Benchmark: the %s tree could not be created in %s."),
+                BenchmarkTreeTypes::BenchmarkTreeNames[nTreeType].c_str(),
+                szWorkDir.c_str()), false, true, true);
+            bSuccess = false;
+            break;
+        }
+    }
+
+    //-----------------------------------------------------------------
+    // Log in to a mock store of our own - the current session and the
+    // mock settings are restored when done.  The resume data goes to
+    // the work directory too, so the uploads and resumes leave nothing
+    // in the user's resume files.
+    //-----------------------------------------------------------------
+    bool bConnected = m_bConnected;
+    std::string szSessionToken = m_szSessionToken;
+    std::string szAppDataDir = ResumeManager::Instance()->GetAppDataDir();
+    bool bOwnResumeData = false;
+
+    if (bSuccess && bRunTrees) {
+        ResumeManager::Instance()->CloseOpenFiles();
+        ResumeManager::Instance()->ClearResumeMgrData();
+        ResumeManager::Instance()->SetAppDataDir(szWorkDir + szSlash);
+        bOwnResumeData = true;
+
+        MockService::Instance()->LoadSettings(szWorkDir + szSlash + _T("store"));
+        MockService::Instance()->ClearStore();
+
+        int nResult = SOAP_FAULT;
+        std::string szMockSessionToken = _T("");
+        MockUserManager mockUserManager;
+
+        for (int nRetry = 0; (nRetry <= MAX_LOGIN_RETRIES) && (nResult != SOAP_OK); nRetry++) {
+            nResult = mockUserManager.LoginUser(CMD_BENCHMARK, _T(""), szMockSessionToken);
+        }
+
+        if ( (false == MockService::Instance()->IsEnabled()) || (nResult != SOAP_OK) ) {
+            PrintStatusMsg(_T("Benchmark: login to the mock service failed."));
+            bSuccess = false;
+        }
+        else {
+            m_szSessionToken = szMockSessionToken;
+            m_bConnected = true;
+        }
+    }
+
+    std::vector<std::string> listReport;
+    for (int nTreeType = nFirstTree; bSuccess && (nTreeType <= nLastTree); nTreeType++) {
+        bSuccess = RunBenchmarkTree(benchmarkTrees[nTreeType], listReport, pReportFile);
+    }
+
+    m_bConnected = bConnected;
+    m_szSessionToken = szSessionToken;
+
+    //-----------------------------------------------------------------
+    // Cleanup - the store is in the work directory, which the first
+    // tree removes last.
+    //-----------------------------------------------------------------
+    if (bRunTrees) {
+        if (bKeep == false) {
+            if (bOwnResumeData) {
+                ResumeManager::Instance()->ClearResumeFiles(
+                    ResumeInfoType(resumeTypeUndefined | resumeUploads));
+                ResumeManager::Instance()->ClearResumeFiles(
+                    ResumeInfoType(resumeTypeUndefined | resumeDownloads));
+            }
+
+            MockService::Instance()->ClearStore(true);
+            for (int nTreeType = nLastTree; nTreeType >= nFirstTree; nTreeType--) {
+                benchmarkTrees[nTreeType].Remove();
+            }
+        }
+        else {
+            PrintStatusMsg(_format(_T("Benchmark: the trees, the mock store and the resume data ")
+                _T("were kept in %s."), szWorkDir.c_str()), true, false, true);
+        }
+
+        if (bOwnResumeData) {
+            ResumeManager::Instance()->CloseOpenFiles();
+            ResumeManager::Instance()->ClearResumeMgrData();
+            ResumeManager::Instance()->SetAppDataDir(szAppDataDir);
+        }
+
+        MockService::Instance()->LoadSettings();
+    }
+
+    //-----------------------------------------------------------------
+    // In-process cases - no trees or mock service needed.
+    //-----------------------------------------------------------------
+    for (int nCaseType = nFirstCase; nCaseType <= nLastCase; nCaseType++) {
+        PrintStatusMsg(_format(_T("Benchmark: running the %s case..."),
+            BenchmarkCaseTypes::BenchmarkCaseNames[nCaseType].c_str()), false, false);
+
+        bSuccess = BenchmarkCases::Run(nCaseType, listReport, pReportFile) && bSuccess;
+    }
+
+    if (pReportFile != NULL) {
+        fclose(pReportFile);
+    }
+
+    if (listReport.size() > 0) {
+        PrintNewLine();
+        for (int nIndex = 0; nIndex < (int)listReport.size(); nIndex++) {
+            PrintStatusMsg(listReport[nIndex], false, false, true);
+        }
+        PrintNewLine();
+    }
+
+    ClientLog(UI_COMP, bSuccess ? LOG_STATUS : LOG_ERROR, false, _T("Benchmark %s."),
+        bSuccess ? _T("successful") : _T("failed"));
+
+} // End ProcessBenchmarkCommand
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Time each phase of one tree.  The phase results are added
+//          to the report, and written to the report file, if any.
+// Requires:
+//      benchmarkTree: created tree
+//      listReport: report lines, added to
+//      pReportFile: tab separated results file, NULL for none
+// Returns: true if all the phases ran, false otherwise.
+bool ConsoleControl::RunBenchmarkTree(BenchmarkTree& benchmarkTree,
+                                      std::vector<std::string>& listReport,
+                                      FILE* pReportFile)
+{
+    std::string szTreeName = benchmarkTree.GetTreeName();
+    std::string szPrefix = BENCHMARK_FILE_PREFIX + szTreeName + _T("_");
+    std::string szFlag = Arg::flagStartString();
+
+    std::string szQuotedArg = _T("");
+    std::vector<BenchmarkSample> listSamples;
+    std::vector<std::string> listPhases;
+    std::vector<int> listFileCounts;
+    std::vector<LONG64> listByteCounts;
+
+    listReport.push_back(_format(_T("%s tree: %d files, %0.1f MB"), szTreeName.c_str(),
+        benchmarkTree.GetFileCount(), (double)benchmarkTree.GetTotalBytes() / 1048576.0));
+
+    //-----------------------------------------------------------------
+    // Upload - the whole tree in one command.
+    //-----------------------------------------------------------------
+    BenchmarkSample sample;
+    AddQuotesToArgument(benchmarkTree.GetRootDir(), szQuotedArg);
+
+    sample.Start();
+    bool bSuccess = RunBenchmarkCommand(CMD_UPLOAD + _T(" ") + szQuotedArg + _T(" ") +
+                                        szFlag + ARG_RECURSE_SWITCH);
+    sample.Stop();
+
+    listSamples.push_back(sample);
+    listPhases.push_back(CMD_UPLOAD);
+    listFileCounts.push_back(benchmarkTree.GetFileCount());
+    listByteCounts.push_back(benchmarkTree.GetTotalBytes());
+
+    //-----------------------------------------------------------------
+    // Files stored by the upload - the failures injected by the mock
+    // leave the others to the resume phase.
+    //-----------------------------------------------------------------
+    std::vector<MockStoredFile> listStoredFiles;
+    MockService::Instance()->GetFiles(listStoredFiles);
+
+    std::map<std::string, LONG64> mapCompleteFiles;
+    for (int nIndex = 0; nIndex < (int)listStoredFiles.size(); nIndex++) {
+        MockStoredFile& storedFile = listStoredFiles[nIndex];
+        if ( (storedFile.bDeleted == false) &&
+             (storedFile.l64StoredBytes == storedFile.l64FileSize) &&
+             (storedFile.szFileName.find(szPrefix) == 0) ) {
+            mapCompleteFiles[storedFile.szFileName] = storedFile.l64FileID;
+        }
+    }
+
+    //-----------------------------------------------------------------
+    // Resume - the resume list, then the files the upload missed.
+    //-----------------------------------------------------------------
+    std::string szResumeCommand = CMD_RESUME;
+    int nResumeFiles = 0;
+    LONG64 l64ResumeBytes = 0;
+
+    const std::vector<std::string>& listTreeFiles = benchmarkTree.GetFiles();
+    for (int nIndex = 0; nIndex < (int)listTreeFiles.size(); nIndex++) {
+        std::string szFileName = _T("");
+        Util::GetFileName(listTreeFiles[nIndex], szFileName);
+
+        if (mapCompleteFiles.find(szFileName) == mapCompleteFiles.end()) {
+            AddQuotesToArgument(listTreeFiles[nIndex], szQuotedArg);
+            szResumeCommand += _T(" ") + szQuotedArg;
+
+            nResumeFiles++;
+            l64ResumeBytes += Util::GetFileLength64(listTreeFiles[nIndex].c_str());
+        }
+    }
+
+    AddQuotesToArgument(benchmarkTree.AddOutputFile(_T("resume.txt")), szQuotedArg);
+
+    sample.Start();
+    bSuccess = RunBenchmarkCommand(CMD_RESUME + _T(" ") + szFlag + ARG_RESUME_LIST_SWITCH +
+                                   _T(" ") + szFlag + ARG_OUTPUT + _T(" ") + szQuotedArg) &&
+               bSuccess;
+    if (nResumeFiles > 0) {
+        bSuccess = RunBenchmarkCommand(szResumeCommand) && bSuccess;
+    }
+    sample.Stop();
+
+    listSamples.push_back(sample);
+    listPhases.push_back(CMD_RESUME);
+    listFileCounts.push_back(nResumeFiles);
+    listByteCounts.push_back(l64ResumeBytes);
+
+    //-----------------------------------------------------------------
+    // Search - one page holding the whole tree, to a file.
+    //-----------------------------------------------------------------
+    AddQuotesToArgument(benchmarkTree.AddOutputFile(_T("search.txt")), szQuotedArg);
+
+    sample.Start();
+    bSuccess = RunBenchmarkCommand(CMD_SEARCHFILES + _T(" ") + szFlag + ARG_FILENAME + _T(" ") +
+                                   szPrefix + _T("*") + _T(" ") +
+                                   szFlag + ARG_RESULT_PAGE_SIZE + _T(" ") +
+                                   _format(_T("%d"), benchmarkTree.GetFileCount()) + _T(" ") +
+                                   szFlag + ARG_OUTPUT + _T(" ") + szQuotedArg) && bSuccess;
+    sample.Stop();
+
+    listSamples.push_back(sample);
+    listPhases.push_back(CMD_SEARCHFILES);
+    listFileCounts.push_back(benchmarkTree.GetFileCount());
+    listByteCounts.push_back(0);
+
+    //-----------------------------------------------------------------
+    // Download - each stored file of the tree, by file ID.
+    //-----------------------------------------------------------------
+    listStoredFiles.clear();
+    MockService::Instance()->GetFiles(listStoredFiles);
+
+    std::vector<MockStoredFile> listDownloadFiles;
+    for (int nIndex = 0; nIndex < (int)listStoredFiles.size(); nIndex++) {
+        MockStoredFile& storedFile = listStoredFiles[nIndex];
+        if ( (storedFile.bDeleted == false) &&
+             (storedFile.l64StoredBytes == storedFile.l64FileSize) &&
+             (storedFile.szFileName.find(szPrefix) == 0) ) {
+            listDownloadFiles.push_back(storedFile);
+        }
+    }
+
+    AddQuotesToArgument(benchmarkTree.GetOutputDir(), szQuotedArg);
+    int nDownloadFiles = 0;
+    LONG64 l64DownloadBytes = 0;
+
+    sample.Start();
+    for (int nIndex = 0; nIndex < (int)listDownloadFiles.size(); nIndex++) {
+        MockStoredFile& storedFile = listDownloadFiles[nIndex];
+        std::string szFilePath = benchmarkTree.AddOutputFile(storedFile.szFileName);
+
+        bSuccess = RunBenchmarkCommand(CMD_DOWNLOAD + _T(" ") +
+                                       _format(DIOMEDE_LONG_FORMAT, storedFile.l64FileID) +
+                                       _T(" ") + szFlag + ARG_DIRECTORY + _T(" ") +
+                                       szQuotedArg) && bSuccess;
+
+        if (Util::GetFileLength64(szFilePath.c_str()) == storedFile.l64FileSize) {
+            nDownloadFiles++;
+            l64DownloadBytes += storedFile.l64FileSize;
+        }
+    }
+    sample.Stop();
+
+    listSamples.push_back(sample);
+    listPhases.push_back(CMD_DOWNLOAD);
+    listFileCounts.push_back(nDownloadFiles);
+    listByteCounts.push_back(l64DownloadBytes);
+
+    //-----------------------------------------------------------------
+    // Report
+    //-----------------------------------------------------------------
+    for (int nIndex = 0; nIndex < (int)listSamples.size(); nIndex++) {
+        listReport.push_back(_T("  ") + listSamples[nIndex].Format(listPhases[nIndex],
+            listFileCounts[nIndex], listByteCounts[nIndex]));
+
+        if (pReportFile != NULL) {
+            fprintf(pReportFile, _T("%s\n"), listSamples[nIndex].FormatRecord(szTreeName,
+                listPhases[nIndex], listFileCounts[nIndex], listByteCounts[nIndex]).c_str());
+        }
+    }
+
+    if ( (int)listDownloadFiles.size() < benchmarkTree.GetFileCount() ) {
+        listReport.push_back(_format(_T("  %d of %d files were not stored by the mock service."),
+            benchmarkTree.GetFileCount() - (int)listDownloadFiles.size(),
+            benchmarkTree.GetFileCount()));
     }
 
-} // End ProcessSystemCommand
+    return bSuccess;
+
+} // End RunBenchmarkTree
 
 ///////////////////////////////////////////////////////////////////////
-// Purpose: Handle the system ECHO command
+// Purpose: Run a command line through the console command handlers,
+//          as for a command entered by the user.
 // Requires:
-//      pCmdLine: current command line
-//      bCommandFinished: true if the command is finished, false otherwise.
-// Returns: nothing
-void ConsoleControl::ProcessEchoSystemCommand(CmdLine* pCmdLine,
-                                              bool& bCommandFinished)
+//      szCommandLine: command and arguments
+// Returns: true if the command was parsed and finished, false otherwise.
+bool ConsoleControl::RunBenchmarkCommand(const std::string& szCommandLine)
 {
-    std::string sysCommand = pCmdLine->getCommandName();
-    bCommandFinished = true;
-
-    // If no arguments, show the current status of echo.
-    // Otherwise, turns off or on echo.
-
-    // This is a bit redundant - either put the parameters back together or
-    // use the action stack as is...using the system command doesn't work
-    // within our console - any features of echo we need to implement we'll
-    // need to do ourselves..
-    // nReturn = system(m_actionStack.front().c_str());
-
-    // Get the list of arguments - this command is a multi-unlabeled argument.
-    DiomedeUnlabeledValueArg<std::string>* pEchoArg = NULL;
+    std::vector<std::string> actionItems;
 
     try {
-        pEchoArg = (DiomedeUnlabeledValueArg<std::string>*)pCmdLine->getArg(ARG_ECHO);
+        if (SplitString(szCommandLine, actionItems, false) == 0) {
+            return false;
+        }
     }
-    catch (CmdLineParseException &e) {
-        // catch any exceptions
-        cerr << "error: " << e.error() << " for arg " << CMD_ECHO << endl;
+    catch (ArgException &e) {
+        UnknownCommandError(szCommandLine, e);
+        return false;
     }
 
-    if (pEchoArg == NULL){
-        return;
+    std::string szCommand = AltCommandStrToCommandStr(actionItems[0]);
+    DioCLICommands::COMMAND_ID cmdID = CommandStrToCommandID(szCommand);
+
+    CommandMap::iterator cmdIter = m_listCommands.find(cmdID);
+    if (cmdIter == m_listCommands.end()) {
+        CmdLineParseException e(_T("Unknown command."), szCommand);
+        UnknownCommandError(szCommandLine, e);
+        return false;
     }
 
-	std::string szEchoParam = pEchoArg->getValue();
-    bCommandFinished = true;
+    CmdLine* pCmdLine = (*cmdIter).second;
+    bool bParseSuccess = false;
+    bool bCommandFinished = true;
 
-	if (szEchoParam.length() == 0)  {
-	    std::string szParam = m_bEchoOn ? _T("on") : _T("off");
-	    std::cout << std::endl << "Echo is " << szParam << std::endl;
-	}
-	else {
-	    m_bEchoOn = (0==stricmp(szEchoParam.c_str(), _T("on")));
-	}
+    pCmdLine->parse((int)actionItems.size(), actionItems, bParseSuccess);
 
-} // End ProcessEchoSystemCommand
+    if (bParseSuccess) {
+        std::string szTaskFriendlyName = g_szTaskFriendlyName;
+        g_szTaskFriendlyName = pCmdLine->getCommandName();
+
+        ProcessCommand(cmdID, (int)actionItems.size(), pCmdLine, bCommandFinished);
+
+        g_szTaskFriendlyName = szTaskFriendlyName;
+    }
+    else {
+        CmdLineParseException e(_T("Argument error."), szCommand);
+        ParseCommandError(pCmdLine, e);
+    }
+
+    pCmdLine->resetArgs();
+    pCmdLine->resetValues();
+    pCmdLine->resetRepromptCount();
+
+    return (bParseSuccess && bCommandFinished);
+
+} // End RunBenchmarkCommand
 
 ///////////////////////////////////////////////////////////////////////
 // Purpose: Helper function to manage the message timing of tasks.
@@ -16685,6 +18797,36 @@ void ConsoleControl::SetupCommands()
         pCmdLine->add( pSwitchArg );
         pCmdLine->deleteOnExit( pSwitchArg );
 
+	    pSwitchArg = new DiomedeSwitchArg(ARG_DELTA_SWITCH,
+	        ARG_DELTA_SWITCH, "Skip files unchanged since their last upload.", false);
+        pCmdLine->add( pSwitchArg );
+        pCmdLine->deleteOnExit( pSwitchArg );
+
+        // File and directory name patterns - keep their case.
+        pValueArg = new DiomedeValueArg<std::string>(ARG_INCLUDE,
+            ARG_INCLUDE,
+            _T("Upload only the files of a directory matching the patterns (separated by ;)."),
+            false, _T(""), _T("file patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_EXCLUDE,
+            ARG_EXCLUDE,
+            _T("Skip the files matching the patterns (separated by ;)."),
+            false, _T(""), _T("file patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_EXCLUDE_DIRS,
+            ARG_EXCLUDE_DIRS,
+            _T("Skip the subdirectories matching the patterns (separated by ;), and their contents."),
+            false, _T(""), _T("directory patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
         // IMPORTANT: UnlabeledMultiArg's must be the last
         // argument added to a command - otherwise, for example,
         // the above switches are not parsed correctly.
@@ -16702,6 +18844,128 @@ void ConsoleControl::SetupCommands()
         GetAltCommandStrs(CMD_UPLOAD, pCmdLine->getAltCommmandList());
         m_listCommands.insert(std::make_pair(DioCLICommands::CMD_UPLOAD, pCmdLine));
 
+        //-------------------------------------------------------------
+        // Sync
+        // Example usage: >sync /home/user/documents /exclude=*.tmp
+        //-------------------------------------------------------------
+        pCmdLine = new CmdLine(CMD_SYNC,
+            _T("Upload the files of directories new or changed since their last sync."), ' ',
+            m_bRedirectedInput, m_szAppVersion.c_str());
+        pCmdLine->setOutput(&m_stdOut);
+
+	    pSwitchArg = new DiomedeSwitchArg(ARG_PATHMETADATA_SWITCH,
+	        ARG_PATHMETADATA_SWITCH, "Add the full and relative path as metadata", false);
+        pCmdLine->add( pSwitchArg );
+        pCmdLine->deleteOnExit( pSwitchArg );
+
+	    pSwitchArg = new DiomedeSwitchArg(ARG_HASHMD5_SWITCH,
+	        ARG_HASHMD5_SWITCH, "Create the MD5 digest used for the upload.", false);
+        pCmdLine->add( pSwitchArg );
+        pCmdLine->deleteOnExit( pSwitchArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_INCLUDE,
+            ARG_INCLUDE,
+            _T("Sync only the files matching the patterns (separated by ;)."),
+            false, _T(""), _T("file patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_EXCLUDE,
+            ARG_EXCLUDE,
+            _T("Skip the files matching the patterns (separated by ;)."),
+            false, _T(""), _T("file patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_EXCLUDE_DIRS,
+            ARG_EXCLUDE_DIRS,
+            _T("Skip the subdirectories matching the patterns (separated by ;), and their contents."),
+            false, _T(""), _T("directory patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        // Must be the last argument - see upload.
+        pMultiArg = new DiomedeUnlabeledMultiArg<std::string>(pCmdLine,
+            ARG_FILENAME,
+            _T("List of directories to sync with Diomede."),
+            true, _T(""), _T("sync directories"));
+        pMultiArg->useLowerCase(false);
+        pCmdLine->add( pMultiArg );
+        pCmdLine->deleteOnExit( pMultiArg );
+
+        GetAltCommandStrs(CMD_SYNC, pCmdLine->getAltCommmandList());
+        m_listCommands.insert(std::make_pair(DioCLICommands::CMD_SYNC, pCmdLine));
+
+        //-------------------------------------------------------------
+        // Watch
+        // Example usage: >watch /home/user/dropbox -s /delay=5
+        //-------------------------------------------------------------
+        pCmdLine = new CmdLine(CMD_WATCH,
+            _T("Upload the files written or moved into directories as they arrive (Linux only)."), ' ',
+            m_bRedirectedInput, m_szAppVersion.c_str());
+        pCmdLine->setOutput(&m_stdOut);
+
+	    pSwitchArg = new DiomedeSwitchArg(ARG_RECURSE_SWITCH,
+	        ARG_RECURSE_SWITCH, "Watch the subdirectories as well", false);
+        pCmdLine->add( pSwitchArg );
+        pCmdLine->deleteOnExit( pSwitchArg );
+
+	    pSwitchArg = new DiomedeSwitchArg(ARG_PATHMETADATA_SWITCH,
+	        ARG_PATHMETADATA_SWITCH, "Add the full and relative path as metadata", false);
+        pCmdLine->add( pSwitchArg );
+        pCmdLine->deleteOnExit( pSwitchArg );
+
+	    pSwitchArg = new DiomedeSwitchArg(ARG_HASHMD5_SWITCH,
+	        ARG_HASHMD5_SWITCH, "Create the MD5 digest used for the upload.", false);
+        pCmdLine->add( pSwitchArg );
+        pCmdLine->deleteOnExit( pSwitchArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_WATCH_DELAY,
+            ARG_WATCH_DELAY,
+            _T("Seconds a file must be left alone before it is uploaded (default 2)."),
+            false, _T(""), _T("seconds"));
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_INCLUDE,
+            ARG_INCLUDE,
+            _T("Upload only the files matching the patterns (separated by ;)."),
+            false, _T(""), _T("file patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_EXCLUDE,
+            ARG_EXCLUDE,
+            _T("Skip the files matching the patterns (separated by ;)."),
+            false, _T(""), _T("file patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        pValueArg = new DiomedeValueArg<std::string>(ARG_EXCLUDE_DIRS,
+            ARG_EXCLUDE_DIRS,
+            _T("Skip the subdirectories matching the patterns (separated by ;), and their contents."),
+            false, _T(""), _T("directory patterns"));
+        pValueArg->useLowerCase(false);
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
+        // Must be the last argument - see upload.
+        pMultiArg = new DiomedeUnlabeledMultiArg<std::string>(pCmdLine,
+            ARG_FILENAME,
+            _T("List of directories to watch."),
+            true, _T(""), _T("watch directories"));
+        pMultiArg->useLowerCase(false);
+        pCmdLine->add( pMultiArg );
+        pCmdLine->deleteOnExit( pMultiArg );
+
+        GetAltCommandStrs(CMD_WATCH, pCmdLine->getAltCommmandList());
+        m_listCommands.insert(std::make_pair(DioCLICommands::CMD_WATCH, pCmdLine));
+
         //-------------------------------------------------------------
         // Resume
         // Example usage: >resume file1.txt
@@ -16721,6 +18985,13 @@ void ConsoleControl::SetupCommands()
         pCmdLine->add( pSwitchArg );
         pCmdLine->deleteOnExit( pSwitchArg );
 
+        pValueArg = new DiomedeValueArg<std::string>(ARG_RESUME_PARALLEL,
+            ARG_RESUME_PARALLEL,
+            _T("Number of files to resume at the same time."), false, _T(""),
+            _T("number of uploads"));
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
         pValueArg = new DiomedeValueArg<std::string>(ARG_OUTPUT,
             ARG_OUTPUT,
             _T("Direct resume list to a file."), false, _T(""),
@@ -16776,6 +19047,11 @@ void ConsoleControl::SetupCommands()
         pCmdLine->add( pValueArg );
         pCmdLine->deleteOnExit( pValueArg );
 
+	    pSwitchArg = new DiomedeSwitchArg(ARG_SPARSE_SWITCH,
+	        ARG_SPARSE_SWITCH, "Release zero blocks to recreate a sparse file.", false);
+        pCmdLine->add( pSwitchArg );
+        pCmdLine->deleteOnExit( pSwitchArg );
+
         GetAltCommandStrs(CMD_DOWNLOAD, pCmdLine->getAltCommmandList());
         m_listCommands.insert(std::make_pair(DioCLICommands::CMD_DOWNLOAD, pCmdLine));
 
@@ -17046,6 +19322,13 @@ void ConsoleControl::SetupCommands()
         pCmdLine->add( pValueArg );
         pCmdLine->deleteOnExit( pValueArg );
 
+        pValueArg = new DiomedeValueArg<std::string>(ARG_FORMAT,
+            ARG_FORMAT,
+            _T("Output results as tab separated values (tsv) or JSON lines (jsonl)."),
+            false, _T(""), _T("tsv|jsonl"));
+        pCmdLine->add( pValueArg );
+        pCmdLine->deleteOnExit( pValueArg );
+
         GetAltCommandStrs(CMD_GETMYPRODUCTS, pCmdLine->getAltCommmandList());
         m_listCommands.insert(std::make_pair(DioCLICommands::CMD_GETMYPRODUCTS, pCmdLine));
 
@@ -17171,6 +19454,13 @@ void ConsoleControl::SetupCommands()
         //-------------------------------------------------------------
         SetupSearchInvoiceLogCommand();
 
+        //-------------------------------------------------------------
+        // Benchmark
+        // Example usage (times the small tree against the mock)
+        //    >benchmark /tree=small
+        //-------------------------------------------------------------
+        SetupBenchmarkCommand();
+
        //-------------------------------------------------------------
         // System command: cls
         //-------------------------------------------------------------
@@ -17532,6 +19822,13 @@ void ConsoleControl::SetupSearchFilesCommand()
     pCmdLine->add( pValueArg );
     pCmdLine->deleteOnExit( pValueArg );
 
+    pValueArg = new DiomedeValueArg<std::string>(ARG_FORMAT,
+        ARG_FORMAT,
+        _T("Output results as tab separated values (tsv) or JSON lines (jsonl)."),
+        false, _T(""), _T("tsv|jsonl"));
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
     pSwitchArg = new DiomedeSwitchArg(ARG_VERBOSE_SWITCH,
         ARG_VERBOSE_SWITCH, "Specify verbose output", false);
     pCmdLine->add( pSwitchArg );
@@ -17802,6 +20099,13 @@ void ConsoleControl::SetupSearchUploadsCommand()
     pCmdLine->add( pValueArg );
     pCmdLine->deleteOnExit( pValueArg );
 
+    pValueArg = new DiomedeValueArg<std::string>(ARG_FORMAT,
+        ARG_FORMAT,
+        _T("Output results as tab separated values (tsv) or JSON lines (jsonl)."),
+        false, _T(""), _T("tsv|jsonl"));
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
     GetAltCommandStrs(CMD_SEARCHUPLOADS, pCmdLine->getAltCommmandList());
     m_listCommands.insert(std::make_pair(DioCLICommands::CMD_SEARCHUPLOADS, pCmdLine));
 
@@ -17878,6 +20182,13 @@ void ConsoleControl::SetupSearchDownloadsCommand()
     pCmdLine->add( pValueArg );
     pCmdLine->deleteOnExit( pValueArg );
 
+    pValueArg = new DiomedeValueArg<std::string>(ARG_FORMAT,
+        ARG_FORMAT,
+        _T("Output results as tab separated values (tsv) or JSON lines (jsonl)."),
+        false, _T(""), _T("tsv|jsonl"));
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
     GetAltCommandStrs(CMD_SEARCHDOWNLOADS, pCmdLine->getAltCommmandList());
     m_listCommands.insert(std::make_pair(DioCLICommands::CMD_SEARCHDOWNLOADS, pCmdLine));
 
@@ -17940,6 +20251,13 @@ void ConsoleControl::SetupSearchLoginsCommand()
     pCmdLine->add( pValueArg );
     pCmdLine->deleteOnExit( pValueArg );
 
+    pValueArg = new DiomedeValueArg<std::string>(ARG_FORMAT,
+        ARG_FORMAT,
+        _T("Output results as tab separated values (tsv) or JSON lines (jsonl)."),
+        false, _T(""), _T("tsv|jsonl"));
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
     GetAltCommandStrs(CMD_SEARCHLOGINS, pCmdLine->getAltCommmandList());
     m_listCommands.insert(std::make_pair(DioCLICommands::CMD_SEARCHLOGINS, pCmdLine));
 
@@ -17996,6 +20314,13 @@ void ConsoleControl::SetupSearchInvoiceLogCommand()
     pCmdLine->add( pValueArg );
     pCmdLine->deleteOnExit( pValueArg );
 
+    pValueArg = new DiomedeValueArg<std::string>(ARG_FORMAT,
+        ARG_FORMAT,
+        _T("Output results as tab separated values (tsv) or JSON lines (jsonl)."),
+        false, _T(""), _T("tsv|jsonl"));
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
     DiomedeSwitchArg* pSwitchArg = new DiomedeSwitchArg(ARG_TEST_SWITCH,
         ARG_TEST_SWITCH, "Specify test input and output", false);
     pCmdLine->add( pSwitchArg );
@@ -18006,6 +20331,94 @@ void ConsoleControl::SetupSearchInvoiceLogCommand()
 
 } // End SetupSearchInvoiceLogCommand
 
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Helper function to setup the benchmark command.
+// Requires: nothing
+// Returns: nothing
+void ConsoleControl::SetupBenchmarkCommand()
+{
+    DiomedeValueArg<std::string>* pValueArg = NULL;
+
+    CmdLine* pCmdLine = new CmdLine(CMD_BENCHMARK,
+        _T("Time upload, search, download and resume against the local mock service, and in-process cases."), ' ',
+        m_bRedirectedInput, m_szAppVersion.c_str());
+    pCmdLine->setOutput(&m_stdOut);
+
+    // Allowed values for the tree argument
+    std::vector<std::string> allowedTreeArgs;
+    for (int nTreeType = 0; nTreeType < BenchmarkTreeTypes::LAST_TREE_TYPE; nTreeType++) {
+        allowedTreeArgs.push_back(BenchmarkTreeTypes::BenchmarkTreeNames[nTreeType]);
+    }
+    allowedTreeArgs.push_back(ARG_ALL);
+
+    ValuesConstraint<std::string>* pAllowedTreeVals =
+        new ValuesConstraint<std::string>( allowedTreeArgs );
+
+    pValueArg = new DiomedeValueArg<std::string>(ARG_BENCHMARK_TREE,
+        ARG_BENCHMARK_TREE,
+        _T("Tree to run - many small files, a few large files, or a deep directory tree (default all)."),
+        false, _T(""), pAllowedTreeVals);
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
+    // Allowed values for the case argument
+    std::vector<std::string> allowedCaseArgs;
+    for (int nCaseType = 0; nCaseType < BenchmarkCaseTypes::LAST_CASE_TYPE; nCaseType++) {
+        allowedCaseArgs.push_back(BenchmarkCaseTypes::BenchmarkCaseNames[nCaseType]);
+    }
+    allowedCaseArgs.push_back(ARG_ALL);
+
+    ValuesConstraint<std::string>* pAllowedCaseVals =
+        new ValuesConstraint<std::string>( allowedCaseArgs );
+
+    pValueArg = new DiomedeValueArg<std::string>(ARG_BENCHMARK_CASE,
+        ARG_BENCHMARK_CASE,
+        _T("In-process case to run - _format against FormatBuffer, or SHA-1 and SHA-256 throughput (default all)."),
+        false, _T(""), pAllowedCaseVals);
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
+    pValueArg = new DiomedeValueArg<std::string>(ARG_BENCHMARK_FILES,
+        ARG_BENCHMARK_FILES,
+        _T("Number of files in each tree, instead of the tree default."), false, _T(""),
+        _T("file count"));
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
+    pValueArg = new DiomedeValueArg<std::string>(ARG_BENCHMARK_SIZE,
+        ARG_BENCHMARK_SIZE,
+        _T("Size of each file in KB, instead of the tree default."), false, _T(""),
+        _T("file size"));
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
+    pValueArg = new DiomedeValueArg<std::string>(ARG_DIRECTORY,
+        ARG_DIRECTORY,
+        _T("Directory for the trees and the mock store (default the application data directory)."),
+        false, _T(""), _T("work directory"));
+    pValueArg->useLowerCase(false);
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
+    pValueArg = new DiomedeValueArg<std::string>(ARG_OUTPUT,
+        ARG_OUTPUT,
+        _T("Append the results to a file as tab separated values."), false, _T(""),
+        _T("output filename"));
+    pValueArg->useLowerCase(false);
+    pCmdLine->add( pValueArg );
+    pCmdLine->deleteOnExit( pValueArg );
+
+    DiomedeSwitchArg* pSwitchArg = new DiomedeSwitchArg(ARG_BENCHMARK_KEEP_SWITCH,
+        ARG_BENCHMARK_KEEP_SWITCH, "Keep the trees and the mock store when done.", false);
+    pCmdLine->add( pSwitchArg );
+    pCmdLine->deleteOnExit( pSwitchArg );
+
+    GetAltCommandStrs(CMD_BENCHMARK, pCmdLine->getAltCommmandList());
+    m_listCommands.insert(std::make_pair(DioCLICommands::CMD_BENCHMARK, pCmdLine));
+
+} // End SetupBenchmarkCommand
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose:
 //      Helper function to setup the set billing data and subscribe
@@ -18948,6 +21361,17 @@ bool ConsoleControl::StartDioCLI(int argc, char** argv,
         m_bEnableLogging = (pProfileData->GetUserProfileInt(GEN_ENABLE_LOGGING,
                                                             GEN_ENABLE_LOGGING_DF) == 1);
     	EnableLoggingToFile(m_bEnableLogging);
+
+        // Transfer metrics are written only when a metrics file is set.
+        std::string szMetricsFile = pProfileData->GetUserProfileStr(GEN_METRICS_FILE,
+                                                                    GEN_METRICS_FILE_DF);
+        if (szMetricsFile.length() > 0) {
+            std::string szMetricsFormat = pProfileData->GetUserProfileStr(GEN_METRICS_FORMAT,
+                                                                          GEN_METRICS_FORMAT_DF);
+            int nFormat = (_stricmp(szMetricsFormat.c_str(), _T("csv")) == 0) ?
+                TransferMetricsTypes::metricsFormatCSV : TransferMetricsTypes::metricsFormatJSONL;
+            TransferMetrics::Instance()->Open(szMetricsFile, nFormat);
+        }
     }
 
 	//-----------------------------------------------------------------
@@ -19118,6 +21542,9 @@ bool ConsoleControl::CommonStartDioCLI( const std::string dcfFilename, const boo
     	return false;
     }
 
+    // Requests go to the local mock service when it's enabled.
+    MockService::Instance()->LoadSettings();
+
 	return true;
 
 } // End CommonStartDioCLI
@@ -19151,6 +21578,10 @@ void ConsoleControl::CommonStopDioCLI()
 
     ProfileManager::Instance()->Shutdown();
     ResumeManager::Instance()->Shutdown();
+    TransferMetrics::Instance()->Shutdown();
+    RetryPolicy::Instance()->Shutdown();
+    BandwidthLimiter::Instance()->Shutdown();
+    MockService::Instance()->Shutdown();
 
 } // End CommonStopDioCLI
 
@@ -19682,6 +22113,13 @@ ConsoleControl::ACTION_REQUEST ConsoleControl::ProcessActionStack()
 			    m_nCurrentNumArgs = (int)actionItems.size();
 			    m_currentCmdID = cmdID;
 
+			    // Make it plain that nothing reaches the service - once per
+			    // command, not on each reprompt.
+			    if (MockService::Instance()->IsEnabled() && (m_bIncompleteCommand == false)) {
+			        PrintStatusMsg(_T("Mock service enabled - requests are served from ") +
+			            MockService::Instance()->GetStoreDir(), false, false, true);
+			    }
+
 			    ProcessCommand(m_currentCmdID, m_nCurrentNumArgs, pCmdLine, bCommandFinished);
 			}
 		}
@@ -19817,6 +22255,9 @@ bool ConsoleControl::ProcessCommand(DioCLICommands::COMMAND_ID cmdID, int nNumAr
 	    case DioCLICommands::CMD_SUBSCRIBE:
 		    ProcessSubscribeUserCommand(pCmdLine, bCommandFinished);
 		    break;
+	    case DioCLICommands::CMD_BENCHMARK:
+		    ProcessBenchmarkCommand(pCmdLine, bCommandFinished);
+		    break;
 	    case DioCLICommands::CMD_SETBILLINGINFO:
 		    ProcessSetBillingDataCommand(pCmdLine, bCommandFinished);
 		    break;
@@ -19832,6 +22273,12 @@ bool ConsoleControl::ProcessCommand(DioCLICommands::COMMAND_ID cmdID, int nNumAr
 	    case DioCLICommands::CMD_UPLOAD:
 		    ProcessUploadCommand(pCmdLine, bCommandFinished);
 		    break;
+	    case DioCLICommands::CMD_SYNC:
+		    ProcessUploadCommand(pCmdLine, bCommandFinished, true);
+		    break;
+	    case DioCLICommands::CMD_WATCH:
+		    ProcessWatchCommand(pCmdLine, bCommandFinished);
+		    break;
 	    case DioCLICommands::CMD_RESUME:
 		    ProcessResumeCommand(pCmdLine, bCommandFinished);
 		    break;
@@ -20149,6 +22596,24 @@ void ConsoleControl::EnableLoggingToFile(const bool bNewSetting)
 	if (!bSuccess) {
 		return;
 	}
+
+	// Optionally buffer the log output and write it from a background
+	// thread - keeps verbose logging off the upload callbacks.
+	UserProfileData* pProfileData =
+	    ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
+
+	int nBufferSize = 0;
+	if (pProfileData != NULL) {
+	    nBufferSize = pProfileData->GetUserProfileInt(GEN_LOG_BUFFER_SIZE, GEN_LOG_BUFFER_SIZE_DF);
+	}
+
+	if (nBufferSize > 0) {
+	    int nFlushInterval = pProfileData->GetUserProfileInt(GEN_LOG_FLUSH_INTERVAL,
+	                                                         GEN_LOG_FLUSH_INTERVAL_DF);
+	    bool bCompress = (pProfileData->GetUserProfileInt(GEN_LOG_COMPRESS, GEN_LOG_COMPRESS_DF) != 0);
+	    m_fileLogger.EnableBuffering( nBufferSize, (ULONG)nFlushInterval, bCompress );
+	}
+
     RegisterLogObserver( &m_fileLogger );
     m_fileLogger.SetLogObserverType();
 
@@ -20166,6 +22631,9 @@ void ConsoleControl::EnableLoggingToConsole(const bool bNewSetting)
 {
 	m_bEnableStdLogging = bNewSetting;
 
+	// The client log filter asks IsIgnored, which depends on the setting.
+	RefreshClientLogFilter();
+
 } // End EnableLoggingToConsole
 
 ///////////////////////////////////////////////////////////////////////
@@ -20187,6 +22655,24 @@ void ConsoleControl::LogMessageCallback(const std::string& pMessage, int nLen)
 
 } // End LogMessageCallback
 
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Whether the console ignores the event - everything is ignored
+//      while logging to the console is turned off.
+// Requires:
+//      nComponent: normalized component index
+//      nEvent: event type (e.g. LOG_STATUS)
+// Returns: true if the event is ignored, false otherwise
+bool ConsoleControl::IsIgnored(int nComponent, int nEvent)
+{
+    if (m_bEnableStdLogging == false) {
+        return true;
+    }
+
+    return LogObserver::IsIgnored(nComponent, nEvent);
+
+} // End IsIgnored
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose:
 //      Sets the log observer type.
@@ -22,7 +22,7 @@
 #include "stdafx.h"
 #include "CommandDefs.h"
 #include "ResumeInfoData.h"
-#include "Enum.h"
+#include "FileWalker.h"
 
 #include "../Include/tclap/CmdLine.h"
 #include "DiomedeCmdLine.h"
@@ -36,6 +36,8 @@
 #include "../Util/ClientLog.h"
 #include "../Util/FileLogger.h"
 #include "../Util/MessageTimer.h"
+#include "../Util/ProgressRenderer.h"
+#include "../Util/BandwidthLimiter.h"
 
 #include "../Include/DiomedeStorage.h"
 #include "../Util/UserProfileData.h"
@@ -71,7 +73,7 @@ protected:
                    m_szParentDir(_T("")), m_szFileName(_T("")),
                    m_l64FileID(0), m_l64FileSize(0),
                    m_szHashMD5(_T("")), m_nBytesRead(0), m_nCurrentBlock(0), m_nUploadStatus(0),
-                   m_szFormattedFileName(_T("")),
+                   m_l64SentBytes(0), m_szFormattedFileName(_T("")),
                    m_szFormattedBytes(_T("")), m_szFormattedBytesType(_T(""))
         {
         	m_commandThread.SetThreadType(ThreadTypeHomogeneous);
@@ -96,6 +98,7 @@ protected:
             m_nBytesRead = uploadFileInfo.m_nBytesRead;
             m_nCurrentBlock = uploadFileInfo.m_nCurrentBlock;
             m_nUploadStatus = uploadFileInfo.m_nUploadStatus;
+            m_l64SentBytes = uploadFileInfo.m_l64SentBytes;
 
             m_szFormattedFileName = uploadFileInfo.m_szFormattedFileName;
             m_szFormattedBytes = uploadFileInfo.m_szFormattedBytes;
@@ -122,6 +125,7 @@ protected:
         int                         m_nBytesRead;
         UINT                        m_nCurrentBlock;
         int                         m_nUploadStatus;
+        LONG64                      m_l64SentBytes;             //! As of the last send complete
 
         std::string                 m_szFormattedFileName;
         std::string                 m_szFormattedBytes;
@@ -145,6 +149,7 @@ protected:
             m_nBytesRead = uploadFileInfo.m_nBytesRead;
             m_nCurrentBlock = uploadFileInfo.m_nCurrentBlock;
             m_nUploadStatus = uploadFileInfo.m_nUploadStatus;
+            m_l64SentBytes = uploadFileInfo.m_l64SentBytes;
 
             m_szFormattedFileName = uploadFileInfo.m_szFormattedFileName;
             m_szFormattedBytes = uploadFileInfo.m_szFormattedBytes;
@@ -171,6 +176,7 @@ protected:
             m_nBytesRead = 0;
             m_nCurrentBlock = 0;
             m_nUploadStatus = 0;
+            m_l64SentBytes = 0;
 
             m_szFormattedFileName = _T("");
             m_szFormattedBytes = _T("");
@@ -178,6 +184,43 @@ protected:
         }
     };
 
+    //-----------------------------------------------------------------
+    //! \brief Worker used by resume /parallel - each worker uploads one
+    //!        resumable file at a time on its own command thread.
+    //-----------------------------------------------------------------
+    struct ResumeUploadWorker {
+        ResumeUploadWorker() : m_commandThread(), m_pUploadData(NULL), m_pTaskUpload(NULL),
+                   m_szSessionToken(_T("")), m_bActive(false), m_bWaitingToRetry(false), m_nRetryAttempts(0),
+                   m_nUploadStatus(0), m_l64UploadedBytes(0)
+        {
+        	m_commandThread.SetThreadType(ThreadTypeHomogeneous);
+            m_commandThread.Start();
+        };
+
+        // Deletes the upload data and task - defined with the SDK types.
+		~ResumeUploadWorker();
+
+        CommandThread               m_commandThread;
+        class UploadImpl*           m_pUploadData;
+        DIOMEDE_CONSOLE::UploadTask* m_pTaskUpload;
+        std::string                 m_szSessionToken;           //! Token the task was started with.
+        ResumeUploadInfoData        m_resumeUploadInfoData;
+
+        bool                        m_bActive;                  //! Owns a resume entry.
+        bool                        m_bWaitingToRetry;          //! Waiting for m_tmRetry.
+        ptime                       m_tmRetry;
+        int                         m_nRetryAttempts;           //! For the current entry.
+        TokenBucket                 m_bandwidthBucket;          //! Per transfer limit.
+
+        //-------------------------------------------------------------
+        // Updated from the upload thread via ResumeWorkerUploadStatus.
+        //-------------------------------------------------------------
+        volatile int                m_nUploadStatus;
+        volatile LONG64             m_l64UploadedBytes;
+    };
+
+    typedef std::vector<ResumeUploadWorker*> ResumeUploadWorkerList;
+
     //-----------------------------------------------------------------
     //! \brief Download file structure used for interacting with the CPPSDK
     //-----------------------------------------------------------------
@@ -390,6 +433,10 @@ protected:
 	LONG64                  m_l64TotalUploadMilliseconds;
 	time_duration           m_tdTotalUpload;
 
+	ProgressRenderer        m_progressRenderer;         ///< Upload and download progress.
+	TokenBucket             m_uploadBandwidth;          ///< Per transfer bandwidth limits,
+	TokenBucket             m_downloadBandwidth;        ///< used on the transfer threads.
+
 	UploadFileInfo*         m_pUploadInfo;              ///< Allocated task on the heap to
 	DIOMEDE_CONSOLE::UploadTask* m_pTaskUpload;         ///< reuse the same thread for the
 	DIOMEDE_CONSOLE::CreateFileTask* m_pTaskCreateFile; ///< entire upload.
@@ -398,7 +445,7 @@ protected:
 	DownloadFileInfo*       m_pDownloadInfo;
 	DisplayFileInfo*        m_pDisplayFileInfo;
 	DisplayFileEnumInfo*    m_pDisplayFileEnumInfo;
-	CEnum*                  m_pFileEnumerator;              ///< Allocated on the heap to allow us
+	FileWalker*             m_pFileEnumerator;              ///< Allocated on the heap to allow us
 	                                                        ///< to stop the enumeration if 
 	                                                        ///< requested by the user.
 
@@ -506,6 +553,8 @@ private:
 	void PrintResumeWarning(int nResumeResult, std::string szWarningMsg,
         bool bPrintNewLineBefore=true, bool bPrintNewLineAfter=false);
 
+    int GetServiceErrorType(const std::string& szErrorMsg);
+    int GetRetryErrorClass(int nServiceErrorType);
     bool CheckServiceErrorToRetry(std::string szErrorMsg, std::string& szFriendlyErrorMsg);
     bool CheckServiceErrorToResume(std::string szErrorMsg);
 
@@ -519,12 +568,12 @@ private:
 	//-----------------------------------------------------------------
     bool UseClipboard(CmdLine* pCmdLine);
 	bool VerboseOutput(CmdLine* pCmdLine);
+	bool GetOutputFormat(CmdLine* pCmdLine, int& nFormat);
 
     bool GetConfigClipboard(bool& bCopyToClipboard);
 	bool GetConfigVerbose(bool& bVerbose);
 	bool GetConfigPageSize(LONG64& l64PageSize);
 	bool GetConfigOffset(LONG64& l64Offset);
-	bool GetConfigResumeIntervals(std::vector<int>& listResumeIntervals);
 
 	bool CopyStringToClipboard(string szClipboardText);
 	bool TestOutput(CmdLine* pCmdLine);
@@ -611,7 +660,8 @@ private:
 	//! \ingroup files
     // @{
 	//-----------------------------------------------------------------
-	void ProcessUploadCommand(CmdLine* pCmdLine, bool& bCommandFinished);
+	void ProcessUploadCommand(CmdLine* pCmdLine, bool& bCommandFinished, bool bSync=false);
+	void ProcessWatchCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 	void ProcessResumeCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 	bool DisplayResumeUploadList(ResumeInfoType nResumeInfoType);
 	bool DisplayResumeUploadListVerbose(ResumeInfoType nResumeInfoType);
@@ -619,15 +669,34 @@ private:
 	int RepeatLastUploadTask(DiomedeTask* pTask);
 	int UploadFileBlocks(bool bAddPathMetaData=false, bool bCreateMD5Digest=false,
 	                     LONG64 l64TotalUploadedBytes=0);
+	bool IsUploadUnchanged(const std::string& szFilePath, class UploadManifest& manifest);
+	void SaveUploadManifest(class UploadManifest& manifest);
+	bool BeginUploadSession(bool bAddPathMetaData);
+	void PrepareFileUpload(const FileWalkerEntry& fileEntry, const std::string& szParentDir);
+	void PrintUploadSummary(LONG64 l64TotalBytesUploaded, int nTotalFilesUploaded);
 
 	int CreateFile(class UploadImpl* pUploadData);
 	int RepeatLastCreateFileTask(DiomedeTask* pTask);
 	int ResumeCreateFile(DIOMEDE_CONSOLE::CreateFileTask* pTask, bool& bUserCancelled);
 
 	int ResumeCurrentUpload(DIOMEDE_CONSOLE::UploadTask* pTask, bool& bUserCancelled);
-	bool ResumeCountdown(ResumeInfoIntervalType nIntervalType);
+	bool ResumeCountdown(LONG64 l64DelayMs);
+
+	int ResumeUploadsParallel(std::vector<ResumeUploadInfoData>& listResumeUploadInfo,
+	                          int nParallel, int& nTotalFilesUploaded,
+	                          LONG64& l64TotalBytesUploaded);
+	void StartResumeUploadWorker(ResumeUploadWorker* pWorker);
+	bool EndResumeUploadWorker(ResumeUploadWorker* pWorker, int& nTotalFilesUploaded,
+	                           LONG64& l64TotalBytesUploaded);
+	int LoginResumeUploadWorker(ResumeUploadWorker* pWorker);
 
 public:
+    //-----------------------------------------------------------------
+    // Upload status for resume /parallel workers - called on the
+    // worker's upload thread.
+    //-----------------------------------------------------------------
+    static bool ResumeWorkerUploadStatus(void* pUploadUser, int nUploadStatus, LONG64 l64CurrentBytes);
+
     void UpdateUploadStatus(int nUploadStatus, LONG64 l64CurrentBytes);
     static bool UploadStatus(void* pUploadUser, int nUploadStatus, LONG64 l64CurrentBytes)
     {
@@ -666,6 +735,8 @@ private:
 	void DisplaySearchFilesResultsVerbose(class FilePropertiesListImpl* pListFileProperties,
 	                                      class LogicalPhysicalFilesInfoListImpl* pListLogicalPhysicalFiles,
 	                                      bool bMaxPageSize=false);
+	void WriteSearchFilesRecords(class FilePropertiesListImpl* pListFileProperties,
+	                             bool bShowDeleted, int nFormat);
 
     //-----------------------------------------------------------------
     // Search helper function
@@ -705,6 +776,7 @@ private:
     //-----------------------------------------------------------------
 	void ProcessDownloadCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 	int RepeatLastDownloadTask(DiomedeTask* pTask);
+	void MakeDownloadSparse(const std::string& szDirectory, const std::string& szFileName);
 
 public:
     // Download URL status
@@ -883,6 +955,9 @@ public:
 	bool PurchaseProduct(const std::vector<std::string>& listRateIDs, int& nResult);
 
 	void ProcessGetMyProductsCommand(CmdLine* pCmdLine, bool& bCommandFinished);
+	void WriteMyProductsRecords(class UserProductListImpl* pListUserProducts,
+	                            class UserContractListImpl* pListUserContracts,
+	                            int nFormat);
 	void ProcessCancelProductCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 
 	void ProcessGetAllContractsCommand(CmdLine* pCmdLine, bool& bCommandFinished);
@@ -897,6 +972,11 @@ public:
 	void ProcessSearchDownloadLogCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 	void ProcessSearchLoginLogCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 
+	void WriteUploadLogRecords(class UploadLogListImpl* pListUploadLog, int nFormat);
+	void WriteDownloadLogRecords(class DownloadLogListImpl* pListDownloadLog, int nFormat);
+	void WriteLoginLogRecords(class LoginLogListImpl* pListLoginLog, int nFormat);
+	void WriteInvoiceLogRecords(class InvoiceLogListImpl* pListInvoiceLogEntries, int nFormat);
+
 	void ProcessSearchInvoiceLogCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 	void TestSearchInvoicesData(InvoiceLogListImpl* pListInvoiceLogEntries,
 	                            bool& bCreateNewInvoice);
@@ -911,6 +991,15 @@ public:
 
 	void ProcessEchoSystemCommand(CmdLine* pCmdLine, bool& bCommandFinished);
 
+	//-----------------------------------------------------------------
+	// Benchmark - upload, search, download and resume of synthetic
+	// trees against the local mock service.
+	//-----------------------------------------------------------------
+	void ProcessBenchmarkCommand(CmdLine* pCmdLine, bool& bCommandFinished);
+	bool RunBenchmarkTree(class BenchmarkTree& benchmarkTree, std::vector<std::string>& listReport,
+	                      FILE* pReportFile);
+	bool RunBenchmarkCommand(const std::string& szCommandLine);
+
 	//-----------------------------------------------------------------
 	// Helper functions (which may move to it's own utility class).
 	//-----------------------------------------------------------------
@@ -957,6 +1046,7 @@ public:
     void SetupSearchDownloadsCommand();
     void SetupSearchLoginsCommand();
     void SetupSearchInvoiceLogCommand();
+    void SetupBenchmarkCommand();
 
 	//-----------------------------------------------------------------
 	//-----------------------------------------------------------------
@@ -1073,6 +1163,7 @@ public:
 	// Callbacks
 	//-----------------------------------------------------------------
 	virtual void LogMessageCallback(const string& pMessage, int nLength);
+	virtual bool IsIgnored(int nComponent, int nEvent);
 	virtual void SetLogObserverType();
 
 }; // End ConsoleControl
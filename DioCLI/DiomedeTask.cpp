@@ -169,6 +169,51 @@ void DiomedeTask::GetSoapError(struct soap* soap, std::string szOptErrorMsg /*_T
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
 
+/////////////////////////////////////////////////////////////////////////////
+// DiomedeTaskExecutor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Whether the continuations of a task run - the Diomede tasks
+//      return TRUE on a service error, so their result is checked.
+// Requires:
+//      pTask: task run
+//      bReturn: value returned by Task()
+// Returns: true if successful, false otherwise
+bool DiomedeTaskExecutor::TaskSucceeded(CTask* pTask, BOOL bReturn)
+{
+    if (bReturn == FALSE) {
+        return false;
+    }
+
+    DiomedeTask* pDiomedeTask = dynamic_cast<DiomedeTask*>(pTask);
+    if (pDiomedeTask == NULL) {
+        return true;
+    }
+
+    return (pDiomedeTask->GetResult() == SOAP_OK);
+
+} // End TaskSucceeded
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Ask a running task to stop - only the transfers can be
+//      cancelled, the other tasks run to the end.
+// Requires:
+//      pTask: running task
+// Returns: nothing
+void DiomedeTaskExecutor::CancelRunningTask(CTask* pTask)
+{
+    DiomedeTask* pDiomedeTask = dynamic_cast<DiomedeTask*>(pTask);
+    if (pDiomedeTask != NULL) {
+        pDiomedeTask->CancelTask();
+    }
+
+} // End CancelRunningTask
+
+/////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////
+
 /////////////////////////////////////////////////////////////////////////////
 // PressAnyKeyTask
 
@@ -290,7 +335,7 @@ BOOL PressAnyKeyTask::Task()
 // Returns: TRUE if successful, FALSE otherwise
 BOOL EnumerateFilesTask::Task()
 {
-    m_pFileEnumerator->EnumerateAll(m_szParentDirectory);
+    m_pFileEnumerator->WalkAll(m_szParentDirectory);
 
     // Always return true - otherwise, the thread quits (in our current
     // implementation).
@@ -324,10 +369,10 @@ BOOL LoginTask::Task()
             return TRUE;
         }
 
-        m_nResult = m_pUserManager->LoginUser(m_szUsername, m_szPassword, m_szSessionToken);
+        m_nResult = m_pServiceUserManager->LoginUser(m_szUsername, m_szPassword, m_szSessionToken);
 
 	    if (m_nResult != SOAP_OK) {
-	        m_szServiceErrorMsg = m_pUserManager->GetErrorMsg();
+	        m_szServiceErrorMsg = m_pServiceUserManager->GetErrorMsg();
 	    }
 
     }
@@ -357,10 +402,10 @@ BOOL LogoutTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pUserManager->LogoutUser(m_szSessionToken);
+    m_nResult = m_pServiceUserManager->LogoutUser(m_szSessionToken);
 
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pUserManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceUserManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -406,7 +451,7 @@ BOOL CreateUserTask::Task()
          m_nResult = m_pStorageProxy->__sds__CreateUser(m_pCreateUserRequest, *m_pCreateUserResponse);
     }
     else if (m_pCreateUser != NULL) {
-        if (false == CreateUserManager() ) {
+        if (false == CreateSDKUserManager() ) {
             return TRUE;
         }
 
@@ -439,7 +484,7 @@ DeleteUserTask::DeleteUserTask( std::string szSessionToken )
 // Returns: TRUE if successful, FALSE otherwise
 BOOL DeleteUserTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -473,7 +518,7 @@ ChangePasswordTask::ChangePasswordTask(std::string szSessionToken, std::string s
 // Returns: TRUE if successful, FALSE otherwise
 BOOL ChangePasswordTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -505,7 +550,7 @@ ResetPasswordTask::ResetPasswordTask(std::string szUsername)
 // Returns: TRUE if successful, FALSE otherwise
 BOOL ResetPasswordTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -537,7 +582,7 @@ SetUserInfoTask::SetUserInfoTask( std::string szSessionToken, UserInfoImpl* pUse
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SetUserInfoTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -569,7 +614,7 @@ GetUserInfoTask::GetUserInfoTask( std::string szSessionToken, UserInfoImpl* pUse
 // Returns: TRUE if successful, FALSE otherwise
 BOOL GetUserInfoTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -601,7 +646,7 @@ DeleteUserInfoTask::DeleteUserInfoTask( std::string szSessionToken, int userInfo
 // Returns: TRUE if successful, FALSE otherwise
 BOOL DeleteUserInfoTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -633,7 +678,7 @@ GetEmailAddressesTask::GetEmailAddressesTask( std::string szSessionToken)
 // Returns: TRUE if successful, FALSE otherwise
 BOOL GetEmailAddressesTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -665,7 +710,7 @@ AddEmailAddressTask::AddEmailAddressTask( std::string szSessionToken, std::strin
 // Returns: TRUE if successful, FALSE otherwise
 BOOL AddEmailAddressTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -697,7 +742,7 @@ DeleteEmailAddressTask::DeleteEmailAddressTask( std::string szSessionToken, std:
 // Returns: TRUE if successful, FALSE otherwise
 BOOL DeleteEmailAddressTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -730,7 +775,7 @@ SetPrimaryEmailAddressTask::SetPrimaryEmailAddressTask( std::string szSessionTok
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SetPrimaryEmailAddressTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -785,7 +830,7 @@ BOOL CreateFileTask::Task()
     return TRUE;
     */
 
-    ClientLog(UI_COMP, LOG_STATUS, false, _T("CreateFileTask::Task --- start "));
+    CLIENTLOG_STATUS(UI_COMP, false, _T("CreateFileTask::Task --- start "));
 
     if (m_pCreateFileRequest != NULL) {
         m_nResult = m_pTransferProxy->__tds__CreateFile(m_pCreateFileRequest, m_pCreateFileResponse);
@@ -800,7 +845,7 @@ BOOL CreateFileTask::Task()
             return TRUE;
         }
 
-        m_nResult = m_pFileManager->CreateFile(m_szSessionToken, m_pUpload);
+        m_nResult = m_pServiceFileManager->CreateFile(m_szSessionToken, m_pUpload);
 
         /*
         while (m_pUpload->m_nUploadStatus != DIOMEDE::uploadComplete) {
@@ -813,11 +858,11 @@ BOOL CreateFileTask::Task()
             m_l64FileID = m_pUpload->GetFileID();
         }
         else {
-            m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+            m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
         }
     }
 
-    ClientLog(UI_COMP, LOG_STATUS, false, _T("CreateFileTask::Task --- end "));
+    CLIENTLOG_STATUS(UI_COMP, false, _T("CreateFileTask::Task --- end "));
 
     // Always return true - otherwise, the thread quits (in our current
     // implementation).
@@ -863,7 +908,7 @@ BOOL UploadTask::Task()
     return TRUE;
     */
 
-    ClientLog(UI_COMP, LOG_STATUS, false, _T("UploadTask::Task --- start "));
+    CLIENTLOG_STATUS(UI_COMP, false, _T("UploadTask::Task --- start "));
 
     if (m_pUploadRequest != NULL) {
         m_nResult = m_pTransferProxy->__tds__Upload(m_pUploadRequest, *m_pUploadResponse);
@@ -873,7 +918,7 @@ BOOL UploadTask::Task()
             return TRUE;
         }
 
-        m_nResult = m_pFileManager->Upload(m_szSessionToken, m_pUpload);
+        m_nResult = m_pServiceFileManager->Upload(m_szSessionToken, m_pUpload);
 
         /*
         while (m_pUpload->m_nUploadStatus != DIOMEDE::uploadComplete) {
@@ -886,7 +931,7 @@ BOOL UploadTask::Task()
             m_l64FileID = m_pUpload->GetFileID();
         }
         else {
-            m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+            m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
         }
     }
     else {
@@ -894,7 +939,7 @@ BOOL UploadTask::Task()
         return TRUE;
     }
 
-    ClientLog(UI_COMP, LOG_STATUS, false, _T("UploadTask::Task --- end "));
+    CLIENTLOG_STATUS(UI_COMP, false, _T("UploadTask::Task --- end "));
 
     // Always return true - otherwise, the thread quits (in our current
     // implementation).
@@ -909,13 +954,13 @@ BOOL UploadTask::Task()
 // Returns: 0 if successful, error code otherwise.
 int UploadTask::CancelTask()
 {
-     if (m_pFileManager == NULL) {
+    if (m_pServiceFileManager == NULL) {
         return DIOMEDE::DIOMEDE_NULL_OBJECT_RECEIVED;
     }
 
     // Since CancelTask's job is to set "stop" flags,
     // re-calling isn't harmful.
-    FileManager::CancelTask(m_pFileManager);
+    m_pServiceFileManager->CancelTask();
     return 0;
 
 } // End CancelTask
@@ -952,13 +997,13 @@ BOOL DownloadTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->Download(m_szSessionToken, m_pDownload);
+    m_nResult = m_pServiceFileManager->Download(m_szSessionToken, m_pDownload);
 
     if (m_nResult == SOAP_OK) {
         m_szDownloadURL = m_pDownload->GetDownloadURL();
     }
     else {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -974,13 +1019,13 @@ BOOL DownloadTask::Task()
 // Returns: 0 if successful, error code otherwise.
 int DownloadTask::CancelTask()
 {
-    if (m_pFileManager == NULL) {
+    if (m_pServiceFileManager == NULL) {
         return DIOMEDE::DIOMEDE_NULL_OBJECT_RECEIVED;
     }
 
     // Since CancelTask's job is to set "stop" flags,
     // re-calling isn't harmful.
-    FileManager::CancelTask(m_pFileManager);
+    m_pServiceFileManager->CancelTask();
     return 0;
 
 } // End CancelTask
@@ -1011,7 +1056,7 @@ BOOL DisplayFileTask::Task()
         return TRUE;
     }
 
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1065,7 +1110,7 @@ GetUploadTokenTask::GetUploadTokenTask( std::string szSessionToken, class Upload
 // Returns: TRUE if successful, FALSE otherwise
 BOOL GetUploadTokenTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1127,7 +1172,7 @@ BOOL GetDownloadURLTask::Task()
     }
     else if (m_pDownloadURL != NULL) {
 
-        if (false == CreateFileManager() ) {
+        if (false == CreateSDKFileManager() ) {
             return TRUE;
         }
 
@@ -1199,14 +1244,16 @@ BOOL SearchFilesTask::Task()
             return TRUE;
         }
 
-        m_nResult = m_pFileManager->SearchFiles(m_szSessionToken, m_pSearchFilter,
+        m_nResult = m_pServiceFileManager->SearchFiles(m_szSessionToken, m_pSearchFilter,
                                             &m_listFileProperties);
         if (m_nResult != SOAP_OK) {
-            m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+            m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
             return TRUE;
         }
 
-        if (m_bAddPhysicalFileInfo == false) {
+        // Files in the mock store have no physical file information -
+        // there's no SDK file manager to ask.
+        if ((m_bAddPhysicalFileInfo == false) || (m_pFileManager == NULL)) {
              return TRUE;
         }
 
@@ -1263,7 +1310,7 @@ SearchFilesTotalTask::SearchFilesTotalTask(std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SearchFilesTotalTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1296,7 +1343,7 @@ SearchFilesTotalLog::SearchFilesTotalLog(std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SearchFilesTotalLog::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1334,9 +1381,9 @@ BOOL RenameFileTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->RenameFile(m_szSessionToken, m_l64FileID, m_szNewFileName);
+    m_nResult = m_pServiceFileManager->RenameFile(m_szSessionToken, m_l64FileID, m_szNewFileName);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1365,9 +1412,9 @@ BOOL DeleteFileTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->DeleteFile(m_szSessionToken, m_l64FileID);
+    m_nResult = m_pServiceFileManager->DeleteFile(m_szSessionToken, m_l64FileID);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1396,9 +1443,9 @@ BOOL UndeleteFileTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->UndeleteFile(m_szSessionToken, m_l64FileID);
+    m_nResult = m_pServiceFileManager->UndeleteFile(m_szSessionToken, m_l64FileID);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1427,9 +1474,9 @@ BOOL CreateMetaDataTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->CreateMetaData(m_szSessionToken, m_pMetaDataInfo);
+    m_nResult = m_pServiceFileManager->CreateMetaData(m_szSessionToken, m_pMetaDataInfo);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1460,9 +1507,9 @@ BOOL CreateFileMetaDataTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->CreateFileMetaData(m_szSessionToken, m_l64FileID, m_pMetaDataInfo);
+    m_nResult = m_pServiceFileManager->CreateFileMetaData(m_szSessionToken, m_l64FileID, m_pMetaDataInfo);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1492,9 +1539,9 @@ BOOL SetFileMetaDataTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->SetFileMetaData(m_szSessionToken, m_l64FileID, m_nMetaDataID);
+    m_nResult = m_pServiceFileManager->SetFileMetaData(m_szSessionToken, m_l64FileID, m_nMetaDataID);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1525,9 +1572,9 @@ BOOL DeleteFileMetaDataTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->DeleteFileMetaData(m_szSessionToken, m_l64FileID, m_nMetaDataID);
+    m_nResult = m_pServiceFileManager->DeleteFileMetaData(m_szSessionToken, m_l64FileID, m_nMetaDataID);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1552,7 +1599,7 @@ DeleteMetaDataTask::DeleteMetaDataTask( std::string szSessionToken, int nMetaDat
 // Returns: TRUE if successful, FALSE otherwise
 BOOL DeleteMetaDataTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1587,9 +1634,9 @@ BOOL GetFileMetaDataTask::Task()
         return TRUE;
     }
 
-    m_nResult = m_pFileManager->GetFileMetaData(m_szSessionToken, m_l64FileID, &m_listMetaData);
+    m_nResult = m_pServiceFileManager->GetFileMetaData(m_szSessionToken, m_l64FileID, &m_listMetaData);
     if (m_nResult != SOAP_OK) {
-        m_szServiceErrorMsg = m_pFileManager->GetErrorMsg();
+        m_szServiceErrorMsg = m_pServiceFileManager->GetErrorMsg();
     }
 
     // Always return true - otherwise, the thread quits (in our current
@@ -1614,7 +1661,7 @@ GetMetaDataTask::GetMetaDataTask( std::string szSessionToken, MetaDataInfoImpl*
 // Returns: TRUE if successful, FALSE otherwise
 BOOL GetMetaDataTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1645,7 +1692,7 @@ EditMetaDataTask::EditMetaDataTask( std::string szSessionToken, MetaDataInfoImpl
 // Returns: TRUE if successful, FALSE otherwise
 BOOL EditMetaDataTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1677,7 +1724,7 @@ ReplicateFileTask::ReplicateFileTask( std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL ReplicateFileTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1708,7 +1755,7 @@ UnReplicateFileTask::UnReplicateFileTask( std::string szSessionToken, LONG64 l64
 // Returns: TRUE if successful, FALSE otherwise
 BOOL UnReplicateFileTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1755,7 +1802,7 @@ BOOL GetStorageTypesTask::Task()
         m_bDestroyList = true;
     }
 
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1788,7 +1835,7 @@ GetPhysicalFilesTask::GetPhysicalFilesTask( std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL GetPhysicalFilesTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1829,7 +1876,7 @@ CreateReplicationPolicyTask::CreateReplicationPolicyTask( std::string szSessionT
 // Returns: TRUE if successful, FALSE otherwise
 BOOL CreateReplicationPolicyTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1859,7 +1906,7 @@ GetReplicationPoliciesTask::GetReplicationPoliciesTask( std::string szSessionTok
 // Returns: TRUE if successful, FALSE otherwise
 BOOL GetReplicationPoliciesTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1891,7 +1938,7 @@ EditReplicationPolicyTask::EditReplicationPolicyTask( std::string szSessionToken
 // Returns: TRUE if successful, FALSE otherwise
 BOOL EditReplicationPolicyTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1923,7 +1970,7 @@ DeleteReplicationPolicyTask::DeleteReplicationPolicyTask( std::string szSessionT
 // Returns: TRUE if successful, FALSE otherwise
 BOOL DeleteReplicationPolicyTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1956,7 +2003,7 @@ SetReplicationPolicyTask::SetReplicationPolicyTask(std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SetReplicationPolicyTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -1989,7 +2036,7 @@ SetDefaultReplicationPolicyTask::SetDefaultReplicationPolicyTask( std::string sz
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SetDefaultReplicationPolicyTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -2021,7 +2068,7 @@ GetDefaultReplicationPolicyTask::GetDefaultReplicationPolicyTask( std::string sz
 // Returns: TRUE if successful, FALSE otherwise
 BOOL GetDefaultReplicationPolicyTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -2053,7 +2100,7 @@ SearchUploadLogTask::SearchUploadLogTask( std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SearchUploadLogTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -2086,7 +2133,7 @@ SearchDownloadLogTask::SearchDownloadLogTask( std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SearchDownloadLogTask::Task()
 {
-    if (false == CreateFileManager() ) {
+    if (false == CreateSDKFileManager() ) {
         return TRUE;
     }
 
@@ -2119,7 +2166,7 @@ SearchLoginLogTask::SearchLoginLogTask( std::string szSessionToken,
 // Returns: TRUE if successful, FALSE otherwise
 BOOL SearchLoginLogTask::Task()
 {
-    if (false == CreateUserManager() ) {
+    if (false == CreateSDKUserManager() ) {
         return TRUE;
     }
 
@@ -19,10 +19,12 @@
 #include "stdafx.h"
 
 #include "../Util/Thread.h"
+#include "../Util/TaskExecutor.h"
 #include "../Include/DiomedeStorage.h"
 #include "../CPPSDK.Lib/ServiceAttribs.h"
 #include "IDiomedeLib.h"
-#include "Enum.h"
+#include "FileWalker.h"
+#include "MockService.h"
 
 #include <queue>
 #include <sys/stat.h>
@@ -87,12 +89,12 @@ public:
 class EnumerateFilesTask : public CTask
 {
 protected:
-    CEnum*                              m_pFileEnumerator; 
+    FileWalker*                         m_pFileEnumerator;
     std::string                         m_szParentDirectory;
     bool                                m_bStop;
 
 public:
-	EnumerateFilesTask(CEnum* pFileEnumerator, std::string szParentDirectory) 
+	EnumerateFilesTask(FileWalker* pFileEnumerator, std::string szParentDirectory)
 	    : m_pFileEnumerator(pFileEnumerator), m_szParentDirectory(szParentDirectory), 
 	      m_bStop(false) {};
 
@@ -152,6 +154,127 @@ public:
 
 }; // End DiomedeTask
 
+/////////////////////////////////////////////////////////////////////////////
+// DiomedeTaskExecutor
+// Shared pool for the Diomede tasks - a DiomedeTask succeeds when its
+// result is SOAP_OK, and is cancelled with CancelTask.
+class DiomedeTaskExecutor : public TaskExecutor
+{
+
+public:
+	DiomedeTaskExecutor(int nWorkers=EXECUTOR_DEFAULT_WORKERS)
+	    : TaskExecutor(nWorkers) {};
+
+	virtual ~DiomedeTaskExecutor() { Shutdown(); }
+
+protected:
+	virtual bool TaskSucceeded(CTask* pTask, BOOL bReturn);
+	virtual void CancelRunningTask(CTask* pTask);
+
+}; // End DiomedeTaskExecutor
+
+/////////////////////////////////////////////////////////////////////////////
+// SDKUserManager
+// The requests the mock can serve, made on the SDK user manager - the
+// task owns the SDK manager.
+class SDKUserManager : public ServiceUserManager
+{
+
+private:
+    DIOMEDE::UserManager*       m_pUserManager;
+
+public:
+	SDKUserManager(DIOMEDE::UserManager* pUserManager)
+	    : m_pUserManager(pUserManager) {};
+
+	virtual ~SDKUserManager() {};
+
+    std::string GetErrorMsg() { return m_pUserManager->GetErrorMsg(); }
+
+    int LoginUser(std::string szUsername, std::string szPassword,
+                  std::string& szSessionToken) {
+        return m_pUserManager->LoginUser(szUsername, szPassword, szSessionToken);
+    }
+
+    int LogoutUser(std::string szSessionToken) {
+        return m_pUserManager->LogoutUser(szSessionToken);
+    }
+
+}; // End SDKUserManager
+
+/////////////////////////////////////////////////////////////////////////////
+// SDKFileManager
+// The requests the mock can serve, made on the SDK file manager - the
+// task owns the SDK manager.
+class SDKFileManager : public ServiceFileManager
+{
+
+private:
+    DIOMEDE::FileManager*       m_pFileManager;
+
+public:
+	SDKFileManager(DIOMEDE::FileManager* pFileManager)
+	    : m_pFileManager(pFileManager) {};
+
+	virtual ~SDKFileManager() {};
+
+    std::string GetErrorMsg() { return m_pFileManager->GetErrorMsg(); }
+
+    void CancelTask() { DIOMEDE::FileManager::CancelTask(m_pFileManager); }
+
+    int CreateFile(std::string szSessionToken, UploadImpl* pUpload) {
+        return m_pFileManager->CreateFile(szSessionToken, pUpload);
+    }
+
+    int Upload(std::string szSessionToken, UploadImpl* pUpload) {
+        return m_pFileManager->Upload(szSessionToken, pUpload);
+    }
+
+    int Download(std::string szSessionToken, DownloadImpl* pDownload) {
+        return m_pFileManager->Download(szSessionToken, pDownload);
+    }
+
+    int SearchFiles(std::string szSessionToken, SearchFileFilterImpl* pSearchFilter,
+                    FilePropertiesListImpl* pListFileProperties) {
+        return m_pFileManager->SearchFiles(szSessionToken, pSearchFilter, pListFileProperties);
+    }
+
+    int RenameFile(std::string szSessionToken, LONG64 l64FileID, std::string szNewFileName) {
+        return m_pFileManager->RenameFile(szSessionToken, l64FileID, szNewFileName);
+    }
+
+    int DeleteFile(std::string szSessionToken, LONG64 l64FileID) {
+        return m_pFileManager->DeleteFile(szSessionToken, l64FileID);
+    }
+
+    int UndeleteFile(std::string szSessionToken, LONG64 l64FileID) {
+        return m_pFileManager->UndeleteFile(szSessionToken, l64FileID);
+    }
+
+    int CreateMetaData(std::string szSessionToken, MetaDataInfoImpl* pMetaDataInfo) {
+        return m_pFileManager->CreateMetaData(szSessionToken, pMetaDataInfo);
+    }
+
+    int CreateFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                           MetaDataInfoImpl* pMetaDataInfo) {
+        return m_pFileManager->CreateFileMetaData(szSessionToken, l64FileID, pMetaDataInfo);
+    }
+
+    int SetFileMetaData(std::string szSessionToken, LONG64 l64FileID, int nMetaDataID) {
+        return m_pFileManager->SetFileMetaData(szSessionToken, l64FileID, nMetaDataID);
+    }
+
+    int DeleteFileMetaData(std::string szSessionToken, LONG64 l64FileID, int nMetaDataID) {
+        return m_pFileManager->DeleteFileMetaData(szSessionToken, l64FileID, nMetaDataID);
+    }
+
+    int GetFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                        MetaDataListImpl* pListMetaData) {
+        return m_pFileManager->GetFileMetaData(szSessionToken, l64FileID, pListMetaData);
+    }
+
+}; // End SDKFileManager
+
 /////////////////////////////////////////////////////////////////////////////
 // DiomedeServiceTask
 class DiomedeServiceTask : public DiomedeTask
@@ -164,13 +287,20 @@ protected:
     DIOMEDE::ProductManager*            m_pProductManager;
     DIOMEDE::PurchasingManager*         m_pPurchasingManager;
 
+    // The requests the mock can serve go to these - see
+    // CreateUserManager and CreateFileManager.
+    ServiceUserManager*                 m_pServiceUserManager;
+    ServiceFileManager*                 m_pServiceFileManager;
+
 protected:
 	DiomedeServiceTask(std::string szSessionToken)
 	    :  m_pStorageProxy(NULL),
 	       m_pUserManager(NULL),
 	       m_pFileManager(NULL),
 	       m_pProductManager(NULL),
-	       m_pPurchasingManager(NULL)
+	       m_pPurchasingManager(NULL),
+	       m_pServiceUserManager(NULL),
+	       m_pServiceFileManager(NULL)
 	{
 	    m_szSessionToken = szSessionToken;
 	}
@@ -180,21 +310,85 @@ protected:
 	       m_pUserManager(NULL),
 	       m_pFileManager(NULL),
 	       m_pProductManager(NULL),
-	       m_pPurchasingManager(NULL)
+	       m_pPurchasingManager(NULL),
+	       m_pServiceUserManager(NULL),
+	       m_pServiceFileManager(NULL)
 	{
 	    m_szSessionToken = _T("");
 	}
 
-	virtual ~DiomedeServiceTask() {};
+	virtual ~DiomedeServiceTask()
+	{
+        if (m_pServiceUserManager != NULL) {
+            delete m_pServiceUserManager;
+            m_pServiceUserManager = NULL;
+        }
+
+        if (m_pServiceFileManager != NULL) {
+            delete m_pServiceFileManager;
+            m_pServiceFileManager = NULL;
+        }
+	};
 
 protected:
 
     //-----------------------------------------------------------------
+    // Manager for the requests the mock can serve - the mock when
+    // it's enabled, the SDK user manager otherwise.
     //-----------------------------------------------------------------
     bool CreateUserManager()
     {
         m_nResult = 0;
 
+        if (m_pServiceUserManager != NULL) {
+            return true;
+        }
+
+        if (MockService::Instance()->IsEnabled()) {
+            m_pServiceUserManager = new MockUserManager;
+            return true;
+        }
+
+        if (false == CreateSDKUserManager() ) {
+            return false;
+        }
+
+        m_pServiceUserManager = new SDKUserManager(m_pUserManager);
+        return true;
+    }
+
+    //-----------------------------------------------------------------
+    // Manager for the requests the mock can serve - the mock when
+    // it's enabled, the SDK file manager otherwise.
+    //-----------------------------------------------------------------
+    bool CreateFileManager()
+    {
+        m_nResult = 0;
+
+        if (m_pServiceFileManager != NULL) {
+            return true;
+        }
+
+        if (MockService::Instance()->IsEnabled()) {
+            m_pServiceFileManager = new MockFileManager;
+            return true;
+        }
+
+        if (false == CreateSDKFileManager() ) {
+            return false;
+        }
+
+        m_pServiceFileManager = new SDKFileManager(m_pFileManager);
+        return true;
+    }
+
+    //-----------------------------------------------------------------
+    // The SDK user manager, for the requests the mock can't serve.
+    //-----------------------------------------------------------------
+    bool CreateSDKUserManager()
+    {
+        m_nResult = 0;
+
         if (m_pUserManager != NULL) {
             return true;
         }
@@ -212,8 +406,9 @@ protected:
     }
 
     //-----------------------------------------------------------------
+    // The SDK file manager, for the requests the mock can't serve.
     //-----------------------------------------------------------------
-    bool CreateFileManager()
+    bool CreateSDKFileManager()
     {
         m_nResult = 0;
 
@@ -290,34 +485,65 @@ class DiomedeTransferTask : public DiomedeTask
 protected:
     DiomedeTransferService*     m_pTransferProxy;
     DIOMEDE::FileManager*       m_pFileManager;
+    ServiceFileManager*         m_pServiceFileManager;       // See CreateFileManager
 
 protected:
 	DiomedeTransferTask(std::string szSessionToken)
 	    :  m_pTransferProxy(NULL),
-	       m_pFileManager(NULL)
+	       m_pFileManager(NULL),
+	       m_pServiceFileManager(NULL)
 	{
 	    m_szSessionToken = szSessionToken;
 	}
 
 	DiomedeTransferTask(DiomedeTransferService* pTransferProxy)
 	    :  m_pTransferProxy(pTransferProxy),
-	       m_pFileManager(NULL)
+	       m_pFileManager(NULL),
+	       m_pServiceFileManager(NULL)
 	{
 	    m_szSessionToken = _T("");
 	}
 
 	virtual ~DiomedeTransferTask()
 	{
+        if (m_pServiceFileManager != NULL) {
+            delete m_pServiceFileManager;
+            m_pServiceFileManager = NULL;
+        }
+
         if (m_pFileManager != NULL) {
             m_pFileManager->DestroyInstance();
             m_pFileManager = NULL;
         }
 	};
 
+    // The mock file manager when it's enabled, the SDK file manager
+    // otherwise.
     bool CreateFileManager()
     {
         m_nResult = 0;
 
+        if (m_pServiceFileManager != NULL) {
+            return true;
+        }
+
+        if (MockService::Instance()->IsEnabled()) {
+            m_pServiceFileManager = new MockFileManager;
+            return true;
+        }
+
+        if (false == CreateSDKFileManager() ) {
+            return false;
+        }
+
+        m_pServiceFileManager = new SDKFileManager(m_pFileManager);
+        return true;
+    }
+
+    bool CreateSDKFileManager()
+    {
+        m_nResult = 0;
+
         if (m_pFileManager != NULL) {
             return true;
         }
@@ -0,0 +1,511 @@
+/*********************************************************************
+ *
+ *  file:  DirWatcher.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Watches directories for files written or moved into them,
+ *          used by the watch command to upload them as they arrive.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "DirWatcher.h"
+
+#include "../Util/ClientLog.h"
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+    #include <sys/inotify.h>
+    #include <sys/stat.h>
+    #include <dirent.h>
+    #include <poll.h>
+    #include <errno.h>
+    #include <string.h>
+    #include <unistd.h>
+
+    #define DIRWATCHER_HAVE_INOTIFY
+    #define DIRWATCHER_PATH_SEPARATOR   _T("/")
+
+    // Files closed after writing, and the entries moved, created or
+    // deleted - only the directories created matter.
+    #define DIRWATCHER_EVENTS           (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | \
+                                         IN_CREATE | IN_DELETE | IN_ONLYDIR | IN_DONT_FOLLOW)
+
+    #define DIRWATCHER_EVENT_BUFFER     65536
+#endif
+
+using namespace boost::posix_time;
+
+///////////////////////////////////////////////////////////////////////
+// DirWatcher Constructor
+DirWatcher::DirWatcher() : m_szIncPatternFiles(_T("")), m_szExcPatternFiles(_T("")),
+                           m_szExcPatternDirs(_T("")), m_bRecursive(false),
+                           m_bNoCaseFiles(false), m_bNoCaseDirs(false),
+                           m_nDelay(DIRWATCHER_DEFAULT_DELAY), m_nWatchFd(-1)
+{
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+// DirWatcher Destructor
+DirWatcher::~DirWatcher()
+{
+    Close();
+
+} // End Destructor
+
+///////////////////////////////////////////////////////////////////////
+bool DirWatcher::IsSupported()
+{
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    return true;
+#else
+    return false;
+#endif
+
+} // End IsSupported
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Watch the directory tree - the patterns are compiled here,
+//!        so they must be set before the first directory is added.
+//! \param szRootDir: directory to watch.
+//! \return true if successful, false otherwise.
+bool DirWatcher::AddRoot(std::string szRootDir)
+{
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    if (szRootDir.empty() || (false == Open())) {
+        return false;
+    }
+
+    // Remove the last separator - the root directory keeps its own.
+    if ( (szRootDir.length() > 1) &&
+         (szRootDir.substr(szRootDir.length() - 1) == DIRWATCHER_PATH_SEPARATOR) ) {
+        szRootDir.erase(szRootDir.length() - 1);
+    }
+
+    m_incFilesMatcher.Compile(m_szIncPatternFiles, m_bNoCaseFiles);
+    m_excFilesMatcher.Compile(m_szExcPatternFiles, m_bNoCaseFiles);
+    m_excDirsMatcher.Compile(m_szExcPatternDirs, m_bNoCaseDirs);
+
+    int nWatches = (int)m_mapWatchedDirs.size();
+
+    m_listRoots.push_back(szRootDir);
+    WatchTree(szRootDir, (int)m_listRoots.size() - 1, false);
+
+    // The root itself couldn't be watched.
+    if ((int)m_mapWatchedDirs.size() == nWatches) {
+        m_listRoots.pop_back();
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+
+} // End AddRoot
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Wait for events, at most until the next pending file is
+//!        due, then return the files left alone for the delay.
+//! \param listFiles: replaced by the files ready for upload.
+//! \param nTimeout: longest wait in milliseconds.
+//! \return true if successful, false otherwise.
+bool DirWatcher::WaitForFiles(DirWatcherEntryList& listFiles, int nTimeout)
+{
+    listFiles.clear();
+
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    if (m_nWatchFd == -1) {
+        return false;
+    }
+
+    ptime tmNow = microsec_clock::universal_time();
+    int nWait = nTimeout;
+
+    PendingFileMap::iterator iter = m_mapPendingFiles.begin();
+    for (; iter != m_mapPendingFiles.end(); ++iter) {
+        LONG64 l64Due = (LONG64)m_nDelay -
+                        (tmNow - iter->second.tmLastEvent).total_milliseconds();
+        if (l64Due < nWait) {
+            nWait = (l64Due > 0) ? (int)l64Due : 0;
+        }
+    }
+
+    struct pollfd pollData;
+    pollData.fd = m_nWatchFd;
+    pollData.events = POLLIN;
+    pollData.revents = 0;
+
+    int nResult = poll(&pollData, 1, nWait);
+    if (nResult < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+
+        ClientLog(UI_COMP, LOG_ERROR, false, _T("Directory watcher: poll failed (%d)."), errno);
+        return false;
+    }
+
+    if ( (nResult > 0) && (false == ReadEvents()) ) {
+        return false;
+    }
+
+    //-----------------------------------------------------------------
+    // Files left alone for the delay, oldest first.
+    //-----------------------------------------------------------------
+    tmNow = microsec_clock::universal_time();
+    std::vector<std::pair<ptime, std::string> > listReady;
+
+    for (iter = m_mapPendingFiles.begin(); iter != m_mapPendingFiles.end(); ++iter) {
+        if ((tmNow - iter->second.tmLastEvent).total_milliseconds() >= m_nDelay) {
+            listReady.push_back(std::make_pair(iter->second.tmLastEvent, iter->first));
+        }
+    }
+
+    std::sort(listReady.begin(), listReady.end());
+
+    for (int nIndex = 0; nIndex < (int)listReady.size(); nIndex++) {
+        iter = m_mapPendingFiles.find(listReady[nIndex].second);
+        int nRoot = iter->second.nRoot;
+
+        // Removed, or replaced by something other than a file, since
+        // the event.
+        struct stat theStats;
+        if ( (lstat(listReady[nIndex].second.c_str(), &theStats) != 0) ||
+             (false == S_ISREG(theStats.st_mode)) ) {
+            m_mapPendingFiles.erase(iter);
+            continue;
+        }
+
+        // Still being written - a file copied into a new directory has
+        // no event until it is closed.  Held for another delay.
+        if ( ((LONG64)theStats.st_size != iter->second.l64FileSize) ||
+             (theStats.st_mtime != iter->second.tmLastModified) ) {
+            iter->second.tmLastEvent = tmNow;
+            iter->second.l64FileSize = (LONG64)theStats.st_size;
+            iter->second.tmLastModified = theStats.st_mtime;
+            continue;
+        }
+
+        bool bRescan = iter->second.bRescan;
+        m_mapPendingFiles.erase(iter);
+
+        DirWatcherEntry watcherEntry;
+        watcherEntry.szRootDir = m_listRoots[nRoot];
+        watcherEntry.fileEntry.szFilePath = listReady[nIndex].second;
+        watcherEntry.fileEntry.l64FileSize = (LONG64)theStats.st_size;
+        watcherEntry.fileEntry.tmLastModified = theStats.st_mtime;
+        watcherEntry.fileEntry.ul64FileIndex = (UINT64)theStats.st_ino;
+        watcherEntry.bRescan = bRescan;
+
+        listFiles.push_back(watcherEntry);
+    }
+
+    return true;
+#else
+    return false;
+#endif
+
+} // End WaitForFiles
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Open the event queue on first use.
+bool DirWatcher::Open()
+{
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    if (m_nWatchFd != -1) {
+        return true;
+    }
+
+    m_nWatchFd = inotify_init();
+    if (m_nWatchFd == -1) {
+        ClientLog(UI_COMP, LOG_ERROR, false, _T("Directory watcher: inotify_init failed (%d)."),
+            errno);
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+
+} // End Open
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Close the event queue - which removes all of its watches.
+void DirWatcher::Close()
+{
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    if (m_nWatchFd != -1) {
+        close(m_nWatchFd);
+        m_nWatchFd = -1;
+    }
+#endif
+
+    m_listRoots.clear();
+    m_mapWatchedDirs.clear();
+    m_mapPendingFiles.clear();
+
+} // End Close
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Watch the directory and, if recursive, its subdirectories.
+//!        Each directory is watched before it is read, so no file
+//!        added meanwhile is missed.
+//! \param szDirPath: directory to watch.
+//! \param nRoot: index of the watched directory it belongs to.
+//! \param bQueueFiles: true to queue the files already there - for a
+//!        directory created or moved into the tree.
+//! \param bRescan: true if the tree is read again after lost events.
+void DirWatcher::WatchTree(const std::string& szDirPath, int nRoot, bool bQueueFiles,
+                           bool bRescan /*false*/)
+{
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    std::vector<std::string> listDirs;
+    listDirs.push_back(szDirPath);
+
+    while (listDirs.empty() == false) {
+        std::string szPath = listDirs.back();
+        listDirs.pop_back();
+
+        int nWatch = inotify_add_watch(m_nWatchFd, szPath.c_str(), DIRWATCHER_EVENTS);
+        if (nWatch == -1) {
+            // ENOSPC - fs.inotify.max_user_watches is too low for the tree.
+            ClientLog(UI_COMP, LOG_WARNING, false,
+                _T("Directory watcher: directory %s could not be watched (%d)."),
+                szPath.c_str(), errno);
+            continue;
+        }
+
+        WatchedDir watchedDir;
+        watchedDir.szPath = szPath;
+        watchedDir.nRoot = nRoot;
+        m_mapWatchedDirs[nWatch] = watchedDir;
+
+        if ( (m_bRecursive == false) && (bQueueFiles == false) ) {
+            continue;
+        }
+
+        DIR* pOpenDir = opendir(szPath.c_str());
+        if (pOpenDir == NULL) {
+            continue;
+        }
+
+        std::string szParentPath = szPath + DIRWATCHER_PATH_SEPARATOR;
+        dirent* pFileData = NULL;
+
+        while ((pFileData = readdir(pOpenDir)) != NULL) {
+            const char* szFileName = pFileData->d_name;
+
+            if ( (strcmp(szFileName, _T(".")) == 0) || (strcmp(szFileName, _T("..")) == 0) ) {
+                continue;
+            }
+
+            struct stat theStats;
+            if (lstat((szParentPath + szFileName).c_str(), &theStats) != 0) {
+                continue;
+            }
+
+            if (S_ISDIR(theStats.st_mode)) {
+                if ( m_bRecursive && IncludeDirectory(szFileName) ) {
+                    listDirs.push_back(szParentPath + szFileName);
+                }
+            }
+            else if ( bQueueFiles && S_ISREG(theStats.st_mode) && IncludeFile(szFileName) ) {
+                QueueFile(szParentPath + szFileName, nRoot, bRescan);
+            }
+        }
+
+        closedir(pOpenDir);
+    }
+#endif
+
+} // End WatchTree
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Read the queued events - directories are watched or dropped
+//!        as they come and go, files are queued until left alone.
+//! \return true if successful, false otherwise.
+bool DirWatcher::ReadEvents()
+{
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    char szBuffer[DIRWATCHER_EVENT_BUFFER]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    ssize_t nLength = read(m_nWatchFd, szBuffer, sizeof(szBuffer));
+    if (nLength < 0) {
+        if ( (errno == EINTR) || (errno == EAGAIN) ) {
+            return true;
+        }
+
+        ClientLog(UI_COMP, LOG_ERROR, false, _T("Directory watcher: read failed (%d)."), errno);
+        return false;
+    }
+
+    const struct inotify_event* pEvent = NULL;
+    bool bOverflow = false;
+
+    for (char* pNext = szBuffer; pNext < szBuffer + nLength;
+         pNext += sizeof(struct inotify_event) + pEvent->len) {
+
+        pEvent = (const struct inotify_event*)pNext;
+
+        if (pEvent->mask & IN_Q_OVERFLOW) {
+            bOverflow = true;
+            continue;
+        }
+
+        WatchedDirMap::iterator iter = m_mapWatchedDirs.find(pEvent->wd);
+        if (iter == m_mapWatchedDirs.end()) {
+            continue;
+        }
+
+        // Removed with its directory, or by RemoveTree.
+        if (pEvent->mask & IN_IGNORED) {
+            m_mapWatchedDirs.erase(iter);
+            continue;
+        }
+
+        if (pEvent->len == 0) {
+            continue;
+        }
+
+        std::string szPath = iter->second.szPath + DIRWATCHER_PATH_SEPARATOR + pEvent->name;
+        int nRoot = iter->second.nRoot;
+
+        if (pEvent->mask & IN_ISDIR) {
+            if (pEvent->mask & (IN_CREATE | IN_MOVED_TO)) {
+                if ( m_bRecursive && IncludeDirectory(pEvent->name) ) {
+                    WatchTree(szPath, nRoot, true);
+                }
+            }
+            else if (pEvent->mask & IN_MOVED_FROM) {
+                RemoveTree(szPath);
+            }
+            continue;
+        }
+
+        if (pEvent->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+            if (IncludeFile(pEvent->name)) {
+                QueueFile(szPath, nRoot);
+            }
+        }
+        else if (pEvent->mask & (IN_MOVED_FROM | IN_DELETE)) {
+            m_mapPendingFiles.erase(szPath);
+        }
+    }
+
+    //-----------------------------------------------------------------
+    // Events were lost - read the trees again, watching any directory
+    // missed, and queue every file.  The caller skips those unchanged.
+    //-----------------------------------------------------------------
+    if (bOverflow) {
+        ClientLog(UI_COMP, LOG_WARNING, false,
+            _T("Directory watcher: events were lost - reading the directories again."));
+
+        for (int nRoot = 0; nRoot < (int)m_listRoots.size(); nRoot++) {
+            WatchTree(m_listRoots[nRoot], nRoot, true, true);
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+
+} // End ReadEvents
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Queue the file, or restart its delay if already queued.
+//!        The size and last modified time are kept, to check the file
+//!        is no longer being written when it is due.
+void DirWatcher::QueueFile(const std::string& szFilePath, int nRoot, bool bRescan /*false*/)
+{
+    PendingFile pendingFile;
+    pendingFile.nRoot = nRoot;
+    pendingFile.tmLastEvent = microsec_clock::universal_time();
+    pendingFile.l64FileSize = 0;
+    pendingFile.tmLastModified = 0;
+    pendingFile.bRescan = bRescan;
+
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    struct stat theStats;
+    if (lstat(szFilePath.c_str(), &theStats) == 0) {
+        pendingFile.l64FileSize = (LONG64)theStats.st_size;
+        pendingFile.tmLastModified = theStats.st_mtime;
+    }
+#endif
+
+    // A file with an event of its own is uploaded, rescanned or not.
+    PendingFileMap::iterator iter = m_mapPendingFiles.find(szFilePath);
+    if (iter != m_mapPendingFiles.end()) {
+        pendingFile.bRescan = (iter->second.bRescan && bRescan);
+    }
+
+    m_mapPendingFiles[szFilePath] = pendingFile;
+
+} // End QueueFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Stop watching a directory moved out of its place, and the
+//!        directories below it - a directory moved within the tree is
+//!        watched again under its new path.
+void DirWatcher::RemoveTree(const std::string& szDirPath)
+{
+#ifdef DIRWATCHER_HAVE_INOTIFY
+    std::string szPrefix = szDirPath + DIRWATCHER_PATH_SEPARATOR;
+
+    WatchedDirMap::iterator iter = m_mapWatchedDirs.begin();
+    while (iter != m_mapWatchedDirs.end()) {
+        const std::string& szPath = iter->second.szPath;
+
+        if ( (szPath == szDirPath) || (szPath.compare(0, szPrefix.length(), szPrefix) == 0) ) {
+            inotify_rm_watch(m_nWatchFd, iter->first);
+            m_mapWatchedDirs.erase(iter++);
+        }
+        else {
+            ++iter;
+        }
+    }
+
+    PendingFileMap::iterator pendingIter = m_mapPendingFiles.lower_bound(szPrefix);
+    while ( (pendingIter != m_mapPendingFiles.end()) &&
+            (pendingIter->first.compare(0, szPrefix.length(), szPrefix) == 0) ) {
+        m_mapPendingFiles.erase(pendingIter++);
+    }
+#endif
+
+} // End RemoveTree
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Check the file name against the include and exclude
+//!        patterns - as the file walker does.
+bool DirWatcher::IncludeFile(const std::string& szFileName)
+{
+    if (m_excFilesMatcher.Match(szFileName)) {
+        return false;
+    }
+
+    return ( m_incFilesMatcher.IsEmpty() || m_incFilesMatcher.Match(szFileName) );
+
+} // End IncludeFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Check the directory name against the exclude patterns.
+bool DirWatcher::IncludeDirectory(const std::string& szDirName)
+{
+    return (false == m_excDirsMatcher.Match(szDirName));
+
+} // End IncludeDirectory
+
+/** @} */
@@ -0,0 +1,166 @@
+/*********************************************************************
+ *
+ *  file:  DirWatcher.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Watches directories for files written or moved into them,
+ *          used by the watch command to upload them as they arrive.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __DIR_WATCHER_H__
+#define __DIR_WATCHER_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+#include "FileWalker.h"
+#include "GlobMatcher.h"
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+
+//---------------------------------------------------------------------
+//! Milliseconds a file must be left alone before it is returned, and
+//! the longest wait for events - so the caller can check for CTRL+C.
+//---------------------------------------------------------------------
+#define DIRWATCHER_DEFAULT_DELAY        2000
+#define DIRWATCHER_WAIT_INTERVAL        250
+
+///////////////////////////////////////////////////////////////////////
+//! \struct DirWatcherEntry
+//! \brief File ready for upload, and the watched directory it was
+//!        found under.
+struct DirWatcherEntry
+{
+    std::string                 szRootDir;
+    FileWalkerEntry             fileEntry;
+    bool                        bRescan;                        //! Found by the rescan after lost
+                                                                //! events - may be unchanged.
+};
+
+typedef std::vector<DirWatcherEntry> DirWatcherEntryList;
+
+///////////////////////////////////////////////////////////////////////
+//! \class DirWatcher
+//! \brief Reports the files closed after writing or moved into the
+//!        watched directories, once they have been left alone for the
+//!        delay.
+//!
+//! Usage:
+//!      DirWatcher dirWatcher;
+//!      dirWatcher.m_bRecursive = true;
+//!      dirWatcher.AddRoot(szDirectory);
+//!      while (...) {
+//!          dirWatcher.WaitForFiles(listFiles, DIRWATCHER_WAIT_INTERVAL);
+//!          ...upload listFiles...
+//!      }
+//!
+//! Uses inotify on Linux - the tree is read once when it is added,
+//! after that only the events are read.  Each file event restarts the
+//! delay of the file, so a file written and closed several times, or
+//! written under a temporary name and renamed, is returned once.  A
+//! file whose size or last modified time changed during the delay is
+//! held for another delay.  A directory created or moved into the
+//! tree is watched in turn, and the files already in it are returned
+//! as well.  When the event queue overflows, the trees are read again
+//! and all of their files returned, marked as rescanned.  Not
+//! supported on other platforms.
+class DirWatcher
+{
+public:
+    _stl_string                 m_szIncPatternFiles;            //! ';' separated
+    _stl_string                 m_szExcPatternFiles;
+    _stl_string                 m_szExcPatternDirs;             //! Directory names
+    bool                        m_bRecursive;
+    bool                        m_bNoCaseFiles;
+    bool                        m_bNoCaseDirs;
+    int                         m_nDelay;                       //! Milliseconds
+
+private:
+    struct WatchedDir
+    {
+        std::string             szPath;
+        int                     nRoot;
+    };
+
+    struct PendingFile
+    {
+        int                             nRoot;
+        boost::posix_time::ptime        tmLastEvent;
+        LONG64                          l64FileSize;            //! As of the last event
+        time_t                          tmLastModified;
+        bool                            bRescan;
+    };
+
+    typedef std::map<int, WatchedDir> WatchedDirMap;            //! By watch descriptor
+    typedef std::map<std::string, PendingFile> PendingFileMap;  //! By path
+
+    int                         m_nWatchFd;
+    std::vector<std::string>    m_listRoots;
+    WatchedDirMap               m_mapWatchedDirs;
+    PendingFileMap              m_mapPendingFiles;
+    GlobMatcher                 m_incFilesMatcher;
+    GlobMatcher                 m_excFilesMatcher;
+    GlobMatcher                 m_excDirsMatcher;
+
+public:
+    DirWatcher();
+    virtual ~DirWatcher();
+
+    //! false if the platform has no directory events.
+    static bool IsSupported();
+
+    //-----------------------------------------------------------------
+    //! \brief Watch the directory, and its subdirectories if
+    //!        recursive - the files already there are not returned.
+    //! \return true if successful, false otherwise.
+    //-----------------------------------------------------------------
+    bool AddRoot(std::string szRootDir);
+
+    //-----------------------------------------------------------------
+    //! \brief Wait for events, then return the files left alone for
+    //!        the delay, oldest first.
+    //! \param listFiles: replaced by the files ready for upload.
+    //! \param nTimeout: longest wait in milliseconds.
+    //! \return true if successful, false if the events could no longer
+    //!         be read.
+    //-----------------------------------------------------------------
+    bool WaitForFiles(DirWatcherEntryList& listFiles, int nTimeout);
+
+    int GetRootCount() const { return (int)m_listRoots.size(); }
+    int GetWatchCount() const { return (int)m_mapWatchedDirs.size(); }
+    int GetPendingCount() const { return (int)m_mapPendingFiles.size(); }
+
+private:
+    // Not implemented
+    DirWatcher(const DirWatcher&);
+    DirWatcher& operator=(const DirWatcher&);
+
+    bool Open();
+    void Close();
+
+    void WatchTree(const std::string& szDirPath, int nRoot, bool bQueueFiles,
+                   bool bRescan=false);
+    bool ReadEvents();
+    void QueueFile(const std::string& szFilePath, int nRoot, bool bRescan=false);
+    void RemoveTree(const std::string& szDirPath);
+
+    bool IncludeFile(const std::string& szFileName);
+    bool IncludeDirectory(const std::string& szDirName);
+
+}; // End DirWatcher
+
+#endif // __DIR_WATCHER_H__
+
+/** @} */
@@ -0,0 +1,656 @@
+/*********************************************************************
+ *
+ *  file:  FileWalker.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Parallel directory walker used to enumerate the files to
+ *          upload - replaces the recursive CEnum enumeration.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "FileWalker.h"
+
+#include "../Util/TaskExecutor.h"
+
+#include "../Util/ClientLog.h"
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include <algorithm>
+
+#ifdef WIN32
+    #include <locale.h>
+    #define FILEWALKER_PATH_SEPARATOR   _T("\\")
+#else
+    #include <fcntl.h>
+    #include <string.h>
+    #include <unistd.h>
+    #define FILEWALKER_PATH_SEPARATOR   _T("/")
+
+    // The entry type isn't filled in by every platform (cygwin) - and
+    // even then, some file systems leave it DT_UNKNOWN.
+    #if defined(DT_DIR) && defined(DT_UNKNOWN) && !defined(__CYGWIN__)
+        #define FILEWALKER_HAVE_D_TYPE
+    #endif
+
+    #if defined(AT_SYMLINK_NOFOLLOW)
+        #define FILEWALKER_HAVE_FSTATAT
+    #endif
+
+    #if defined(FILEWALKER_HAVE_FSTATAT) && defined(O_DIRECTORY) && defined(O_NOFOLLOW)
+        #define FILEWALKER_HAVE_OPENAT
+    #endif
+#endif
+
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+///////////////////////////////////////////////////////////////////////
+//! \class FileWalkerTask
+//! \brief Runs one walker worker on an executor thread.
+class FileWalkerTask : public CTask
+{
+protected:
+    FileWalker*                 m_pFileWalker;
+    int                         m_nWorker;
+
+public:
+    FileWalkerTask(FileWalker* pFileWalker, int nWorker)
+        : m_pFileWalker(pFileWalker), m_nWorker(nWorker) {};
+
+    virtual ~FileWalkerTask() {};
+
+    virtual BOOL Task() {
+        m_pFileWalker->RunWorker(m_nWorker);
+        return TRUE;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Order of the files within a directory.
+static bool CompareEntryPaths(const FileWalkerEntry& firstEntry,
+                              const FileWalkerEntry& secondEntry)
+{
+    return firstEntry.szFilePath < secondEntry.szFilePath;
+}
+
+///////////////////////////////////////////////////////////////////////
+// FileWalker Constructor
+FileWalker::FileWalker() : m_szIncPatternFiles(_T("")), m_szExcPatternFiles(_T("")),
+                           m_szExcPatternDirs(_T("")), m_bRecursive(false),
+                           m_bNoCaseFiles(false), m_bNoCaseDirs(false),
+                           m_nThreads(FILEWALKER_DEFAULT_THREADS),
+                           m_pfnStatusFunc(NULL), m_pUserData(NULL), m_bCancelled(false),
+                           m_nPendingDirs(0), m_nFileCount(0)
+{
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+// FileWalker Destructor
+FileWalker::~FileWalker()
+{
+    ClearQueues();
+
+} // End Destructor
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Walk the directory with the worker threads - the calling
+//!        thread is the first worker.
+//! \param szPath: directory to walk.
+void FileWalker::WalkAll(std::string szPath)
+{
+    m_listFiles.clear();
+    m_listDirectories.clear();
+    ClearQueues();
+
+    m_nPendingDirs = 0;
+    m_nFileCount = 0;
+
+    if (szPath.empty()) {
+        return;
+    }
+
+    // Remove the last separator - the root directory keeps its own.
+    if ( (szPath.length() > 1) &&
+         (szPath.substr(szPath.length() - 1) == FILEWALKER_PATH_SEPARATOR) ) {
+        szPath.erase(szPath.length() - 1);
+    }
+
+    #ifdef WIN32
+        // The case folding of the patterns and names uses the locale.
+        if ( (m_bNoCaseFiles || m_bNoCaseDirs) && (_tsetlocale(LC_ALL, _T("")) == NULL) ) {
+            return;
+        }
+    #endif
+
+    m_incFilesMatcher.Compile(m_szIncPatternFiles, m_bNoCaseFiles);
+    m_excFilesMatcher.Compile(m_szExcPatternFiles, m_bNoCaseFiles);
+    m_excDirsMatcher.Compile(m_szExcPatternDirs, m_bNoCaseDirs);
+
+    //-----------------------------------------------------------------
+    // A single directory isn't worth the threads.
+    //-----------------------------------------------------------------
+    int nThreads = 1;
+    if (m_bRecursive) {
+        nThreads = (m_nThreads < 1) ? 1 :
+                   ( (m_nThreads > FILEWALKER_MAX_THREADS) ? FILEWALKER_MAX_THREADS : m_nThreads );
+    }
+
+    for (int nWorker = 0; nWorker < nThreads; nWorker++) {
+        m_listQueues.push_back(new WalkQueue());
+    }
+
+    AddDirectory(0, szPath, _T(""), -1);
+
+    std::vector<FileWalkerTask*> listTasks;
+    TaskExecutor* pExecutor = NULL;
+
+    if (nThreads > 1) {
+        pExecutor = new TaskExecutor(nThreads - 1);
+
+        for (int nWorker = 1; nWorker < nThreads; nWorker++) {
+            FileWalkerTask* pTask = new FileWalkerTask(this, nWorker);
+
+            if (pExecutor->Submit(pTask) == false) {
+                // The other workers pick up the slack.
+                delete pTask;
+                continue;
+            }
+
+            listTasks.push_back(pTask);
+        }
+    }
+
+    RunWorker(0);
+
+    if (pExecutor != NULL) {
+        pExecutor->WaitAll();
+        delete pExecutor;
+    }
+
+    for (int nIndex = 0; nIndex < (int)listTasks.size(); nIndex++) {
+        delete listTasks[nIndex];
+    }
+
+    if (m_bCancelled == false) {
+        CollectFiles(0);
+    }
+
+    #ifdef FILEWALKER_HAVE_OPENAT
+        // A cancelled walk leaves subdirectories unopened.
+        for (int nIndex = 0; nIndex < (int)m_listDirectories.size(); nIndex++) {
+            if (m_listDirectories[nIndex].nDirFd >= 0) {
+                close(m_listDirectories[nIndex].nDirFd);
+            }
+        }
+    #endif
+
+    m_listDirectories.clear();
+    ClearQueues();
+
+} // End WalkAll
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Scan directories until none are queued or being scanned by
+//!        the other workers.
+//! \param nWorker: index of the worker's queue.
+void FileWalker::RunWorker(int nWorker)
+{
+    int nUnreportedFiles = 0;
+
+    while (m_bCancelled == false) {
+        int nDirectory = -1;
+
+        if (NextDirectory(nWorker, nDirectory)) {
+            ScanDirectory(nWorker, nDirectory);
+
+            Lock<CCriticalSection> lock(m_lock);
+            nUnreportedFiles += (int)m_listDirectories[nDirectory].listFiles.size();
+            m_nPendingDirs--;
+        }
+        else {
+            {
+                Lock<CCriticalSection> lock(m_lock);
+                if (m_nPendingDirs == 0) {
+                    break;
+                }
+            }
+
+            // Another worker is scanning - its subdirectories may yet
+            // be stolen.
+            Sleep(1);
+        }
+
+        if (nUnreportedFiles >= FILEWALKER_STATUS_INTERVAL) {
+            UpdateStatus(nUnreportedFiles);
+            nUnreportedFiles = 0;
+        }
+    }
+
+    if (nUnreportedFiles > 0) {
+        UpdateStatus(nUnreportedFiles);
+    }
+
+} // End RunWorker
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Add a directory to the walk and to the worker's queue.
+//! \param nParent: index of the directory it was found in, -1 for the
+//!        root.
+//! \return index of the directory.
+int FileWalker::AddDirectory(int nWorker, const std::string& szPath, const std::string& szName,
+                             int nParent)
+{
+    int nDirectory = 0;
+
+    {
+        Lock<CCriticalSection> lock(m_lock);
+
+        WalkDirectory walkDirectory;
+        walkDirectory.szPath = szPath;
+        walkDirectory.szName = szName;
+        walkDirectory.nParent = nParent;
+        walkDirectory.nDirFd = -1;
+        walkDirectory.nDirFdRefs = 0;
+
+        // The parent's descriptor stays open until this one is opened.
+        if ( (nParent >= 0) && (m_listDirectories[nParent].nDirFd >= 0) ) {
+            m_listDirectories[nParent].nDirFdRefs++;
+        }
+
+        m_listDirectories.push_back(walkDirectory);
+        nDirectory = (int)m_listDirectories.size() - 1;
+        m_nPendingDirs++;
+    }
+
+    WalkQueue* pQueue = m_listQueues[nWorker];
+    Lock<CCriticalSection> lock(pQueue->lock);
+    pQueue->listDirs.push_back(nDirectory);
+
+    return nDirectory;
+
+} // End AddDirectory
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Next directory to scan - the newest in the worker's own
+//!        queue, else the oldest in another worker's queue.
+//! \return true if a directory was found, false otherwise.
+bool FileWalker::NextDirectory(int nWorker, int& nDirectory)
+{
+    int nQueues = (int)m_listQueues.size();
+
+    for (int nIndex = 0; nIndex < nQueues; nIndex++) {
+        WalkQueue* pQueue = m_listQueues[(nWorker + nIndex) % nQueues];
+        Lock<CCriticalSection> lock(pQueue->lock);
+
+        if (pQueue->listDirs.empty()) {
+            continue;
+        }
+
+        if (nIndex == 0) {
+            nDirectory = pQueue->listDirs.back();
+            pQueue->listDirs.pop_back();
+        }
+        else {
+            nDirectory = pQueue->listDirs.front();
+            pQueue->listDirs.pop_front();
+        }
+
+        return true;
+    }
+
+    return false;
+
+} // End NextDirectory
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Read the entries of the directory - files matching the
+//!        include patterns are added with their size and last modified
+//!        time, subdirectories are queued when recursive.
+//! \param nWorker: queue for the subdirectories.
+//! \param nDirectory: index of the directory.
+void FileWalker::ScanDirectory(int nWorker, int nDirectory)
+{
+    WalkDirectory* pDirectory = NULL;
+    {
+        // References to the nodes survive additions by other workers.
+        Lock<CCriticalSection> lock(m_lock);
+        pDirectory = &m_listDirectories[nDirectory];
+    }
+
+    std::string szParentPath = pDirectory->szPath;
+    if (szParentPath.substr(szParentPath.length() - 1) != FILEWALKER_PATH_SEPARATOR) {
+        szParentPath += FILEWALKER_PATH_SEPARATOR;
+    }
+
+#ifdef WIN32
+    //-----------------------------------------------------------------
+    // The find data has the size and times - no stat needed.
+    //-----------------------------------------------------------------
+    WIN32_FIND_DATA findFileData;
+
+    // FindFirstFileEx handles network shares.
+    HANDLE hFind = FindFirstFileEx((szParentPath + _T("*")).c_str(), FindExInfoStandard,
+                                   &findFileData, FindExSearchNameMatch, NULL, 0);
+
+    if (hFind == INVALID_HANDLE_VALUE) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("File walker: directory %s could not be read."),
+            pDirectory->szPath.c_str());
+        return;
+    }
+
+    do {
+        std::string szFileName = findFileData.cFileName;
+
+        if (findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if ( m_bRecursive && szFileName.compare(_T(".")) && szFileName.compare(_T("..")) &&
+                 IncludeDirectory(szFileName) ) {
+                pDirectory->listSubDirs.push_back(
+                    AddDirectory(nWorker, szParentPath + szFileName, szFileName,
+                                 nDirectory));
+            }
+            continue;
+        }
+
+        if (false == IncludeFile(szFileName)) {
+            continue;
+        }
+
+        // File times are 100 nanosecond intervals since 1601.
+        LONG64 l64WriteTime = ((LONG64)findFileData.ftLastWriteTime.dwHighDateTime << 32) |
+                              findFileData.ftLastWriteTime.dwLowDateTime;
+
+        FileWalkerEntry fileEntry;
+        fileEntry.szFilePath = szParentPath + szFileName;
+        fileEntry.l64FileSize = ((LONG64)findFileData.nFileSizeHigh << 32) |
+                                findFileData.nFileSizeLow;
+        fileEntry.tmLastModified = (time_t)((l64WriteTime - 116444736000000000LL) / 10000000);
+        fileEntry.ul64FileIndex = 0;
+
+        pDirectory->listFiles.push_back(fileEntry);
+
+    } while ( (m_bCancelled == false) && (FindNextFile(hFind, &findFileData) != 0) );
+
+    FindClose(hFind);
+#else
+    #ifdef FILEWALKER_HAVE_OPENAT
+        DIR* pOpenDir = NULL;
+        int nOpenFd = OpenDirectory(nDirectory);
+
+        if (nOpenFd >= 0) {
+            pOpenDir = fdopendir(nOpenFd);
+            if (pOpenDir == NULL) {
+                close(nOpenFd);
+            }
+        }
+    #else
+        DIR* pOpenDir = opendir(pDirectory->szPath.c_str());
+    #endif
+
+    if (pOpenDir == NULL) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("File walker: directory %s could not be read."),
+            pDirectory->szPath.c_str());
+        return;
+    }
+
+    #ifdef FILEWALKER_HAVE_FSTATAT
+        int nDirFd = dirfd(pOpenDir);
+    #endif
+
+    #ifdef FILEWALKER_HAVE_OPENAT
+        // Held for the subdirectories - the scan holds one reference, so
+        // it isn't closed while they're still being queued.  Should the
+        // dup fail, they're opened by path.
+        if (m_bRecursive) {
+            Lock<CCriticalSection> lock(m_lock);
+            pDirectory->nDirFd = dup(nDirFd);
+            pDirectory->nDirFdRefs = 1;
+        }
+    #endif
+
+    dirent* pFileData = NULL;
+
+    while ( (m_bCancelled == false) && ((pFileData = readdir(pOpenDir)) != NULL) ) {
+        const char* szFileName = pFileData->d_name;
+
+        if ( (strcmp(szFileName, _T(".")) == 0) || (strcmp(szFileName, _T("..")) == 0) ) {
+            continue;
+        }
+
+        bool bIsDirectory = false;
+        bool bIsFile = false;
+        bool bHaveStats = false;
+        struct stat theStats;
+
+        //-------------------------------------------------------------
+        // The entry type saves a stat of each directory, and of the
+        // files the include patterns skip.  Links, devices and the
+        // like are skipped either way.
+        //-------------------------------------------------------------
+        #ifdef FILEWALKER_HAVE_D_TYPE
+            if (pFileData->d_type == DT_DIR) {
+                bIsDirectory = true;
+            }
+            else if (pFileData->d_type == DT_REG) {
+                bIsFile = true;
+            }
+            else if (pFileData->d_type != DT_UNKNOWN) {
+                continue;
+            }
+        #endif
+
+        if ( (bIsDirectory == false) && (bIsFile == false) ) {
+            #ifdef FILEWALKER_HAVE_FSTATAT
+                bHaveStats = (fstatat(nDirFd, szFileName, &theStats, AT_SYMLINK_NOFOLLOW) == 0);
+            #else
+                bHaveStats = (lstat((szParentPath + szFileName).c_str(), &theStats) == 0);
+            #endif
+
+            if (bHaveStats == false) {
+                continue;
+            }
+
+            bIsDirectory = S_ISDIR(theStats.st_mode);
+            bIsFile = S_ISREG(theStats.st_mode);
+        }
+
+        if (bIsDirectory) {
+            if ( m_bRecursive && IncludeDirectory(szFileName) ) {
+                pDirectory->listSubDirs.push_back(
+                    AddDirectory(nWorker, szParentPath + szFileName, szFileName,
+                                 nDirectory));
+            }
+            continue;
+        }
+
+        if ( (bIsFile == false) || (false == IncludeFile(szFileName)) ) {
+            continue;
+        }
+
+        if (bHaveStats == false) {
+            #ifdef FILEWALKER_HAVE_FSTATAT
+                bHaveStats = (fstatat(nDirFd, szFileName, &theStats, AT_SYMLINK_NOFOLLOW) == 0);
+            #else
+                bHaveStats = (lstat((szParentPath + szFileName).c_str(), &theStats) == 0);
+            #endif
+
+            // Removed since the directory was read.
+            if (bHaveStats == false) {
+                continue;
+            }
+        }
+
+        FileWalkerEntry fileEntry;
+        fileEntry.szFilePath = szParentPath + szFileName;
+        fileEntry.l64FileSize = (LONG64)theStats.st_size;
+        fileEntry.tmLastModified = theStats.st_mtime;
+        fileEntry.ul64FileIndex = (UINT64)theStats.st_ino;
+
+        pDirectory->listFiles.push_back(fileEntry);
+    }
+
+    closedir(pOpenDir);
+
+    #ifdef FILEWALKER_HAVE_OPENAT
+        if (m_bRecursive) {
+            ReleaseDirFd(nDirectory);
+        }
+    #endif
+#endif
+
+    std::sort(pDirectory->listFiles.begin(), pDirectory->listFiles.end(), CompareEntryPaths);
+
+} // End ScanDirectory
+
+#ifdef FILEWALKER_HAVE_OPENAT
+///////////////////////////////////////////////////////////////////////
+//! \brief Open the directory relative to its parent's descriptor, so
+//!        the path isn't resolved again from the root - the root, and
+//!        a directory whose parent couldn't be held, by path.
+//! \return the open descriptor, -1 on failure.
+int FileWalker::OpenDirectory(int nDirectory)
+{
+    std::string szPath = _T("");
+    std::string szName = _T("");
+    int nParent = -1;
+    int nParentFd = -1;
+
+    {
+        Lock<CCriticalSection> lock(m_lock);
+        WalkDirectory& walkDirectory = m_listDirectories[nDirectory];
+
+        szPath = walkDirectory.szPath;
+        szName = walkDirectory.szName;
+        nParent = walkDirectory.nParent;
+
+        if (nParent >= 0) {
+            nParentFd = m_listDirectories[nParent].nDirFd;
+        }
+    }
+
+    if (nParentFd < 0) {
+        return open(szPath.c_str(), O_RDONLY | O_DIRECTORY);
+    }
+
+    // The walk skips links - one swapped in since the parent was read
+    // isn't followed either.
+    int nDirFd = openat(nParentFd, szName.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    ReleaseDirFd(nParent);
+
+    return nDirFd;
+
+} // End OpenDirectory
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Drop a reference to the held descriptor of the directory,
+//!        closing it with the last.
+void FileWalker::ReleaseDirFd(int nDirectory)
+{
+    Lock<CCriticalSection> lock(m_lock);
+    WalkDirectory& walkDirectory = m_listDirectories[nDirectory];
+
+    if (walkDirectory.nDirFd < 0) {
+        return;
+    }
+
+    if (--walkDirectory.nDirFdRefs == 0) {
+        close(walkDirectory.nDirFd);
+        walkDirectory.nDirFd = -1;
+    }
+
+} // End ReleaseDirFd
+#endif
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Add to the count of files found and pass it to the status
+//!        callback - one caller at a time.
+void FileWalker::UpdateStatus(int nFiles)
+{
+    Lock<CCriticalSection> lock(m_lock);
+    m_nFileCount += nFiles;
+
+    if (m_pfnStatusFunc != NULL) {
+        m_pfnStatusFunc(m_pUserData, m_nFileCount);
+    }
+
+} // End UpdateStatus
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Check the file name against the include and exclude
+//!        patterns.
+//! \return true if no include pattern is set or one matches, and no
+//!         exclude pattern matches - false otherwise.
+bool FileWalker::IncludeFile(const std::string& szFileName)
+{
+    if (m_excFilesMatcher.Match(szFileName)) {
+        return false;
+    }
+
+    return ( m_incFilesMatcher.IsEmpty() || m_incFilesMatcher.Match(szFileName) );
+
+} // End IncludeFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Check the directory name against the exclude patterns -
+//!        checked before the directory is queued, so an excluded
+//!        directory is never opened.
+//! \return true if the directory is walked, false otherwise.
+bool FileWalker::IncludeDirectory(const std::string& szDirName)
+{
+    return (false == m_excDirsMatcher.Match(szDirName));
+
+} // End IncludeDirectory
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Gather the files in walk order - the files of each directory,
+//!        then each subdirectory by name.
+//! \param nDirectory: index of the directory to start from.
+void FileWalker::CollectFiles(int nDirectory)
+{
+    std::vector<int> listStack;
+    listStack.push_back(nDirectory);
+
+    while (listStack.empty() == false) {
+        WalkDirectory& walkDirectory = m_listDirectories[listStack.back()];
+        listStack.pop_back();
+
+        m_listFiles.insert(m_listFiles.end(), walkDirectory.listFiles.begin(),
+                           walkDirectory.listFiles.end());
+
+        // Sort by name, then stack in reverse so the first is next.
+        std::vector<std::pair<std::string, int> > listSubDirs;
+        for (int nIndex = 0; nIndex < (int)walkDirectory.listSubDirs.size(); nIndex++) {
+            int nSubDir = walkDirectory.listSubDirs[nIndex];
+            listSubDirs.push_back(std::make_pair(m_listDirectories[nSubDir].szName, nSubDir));
+        }
+
+        std::sort(listSubDirs.begin(), listSubDirs.end());
+
+        for (int nIndex = (int)listSubDirs.size() - 1; nIndex >= 0; nIndex--) {
+            listStack.push_back(listSubDirs[nIndex].second);
+        }
+    }
+
+} // End CollectFiles
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Delete the worker queues.
+void FileWalker::ClearQueues()
+{
+    for (int nIndex = 0; nIndex < (int)m_listQueues.size(); nIndex++) {
+        delete m_listQueues[nIndex];
+    }
+
+    m_listQueues.clear();
+
+} // End ClearQueues
+
+/** @} */
@@ -0,0 +1,169 @@
+/*********************************************************************
+ *
+ *  file:  FileWalker.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Parallel directory walker used to enumerate the files to
+ *          upload - replaces the recursive CEnum enumeration.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __FILE_WALKER_H__
+#define __FILE_WALKER_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+#include "../Util/CriticalSection.h"
+#include "Enum.h"
+#include "GlobMatcher.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+
+//---------------------------------------------------------------------
+//! Worker threads walking the subdirectories, and how often (in files)
+//! the status callback is called.
+//---------------------------------------------------------------------
+#define FILEWALKER_DEFAULT_THREADS      4
+#define FILEWALKER_MAX_THREADS          16
+#define FILEWALKER_STATUS_INTERVAL      50
+
+///////////////////////////////////////////////////////////////////////
+//! \struct FileWalkerEntry
+//! \brief File found by the walker - the size, last modified time and
+//!        inode are read during the walk, so the upload needn't stat
+//!        the file again.
+struct FileWalkerEntry
+{
+    std::string                 szFilePath;
+    LONG64                      l64FileSize;
+    time_t                      tmLastModified;
+    UINT64                      ul64FileIndex;                  //! Inode, 0 on Windows
+};
+
+typedef std::vector<FileWalkerEntry> FileWalkerEntryList;
+
+///////////////////////////////////////////////////////////////////////
+//! \class FileWalker
+//! \brief Enumerates the files of a directory, and optionally its
+//!        subdirectories, with a pool of worker threads.
+//!
+//! Usage:
+//!      FileWalker fileWalker;
+//!      fileWalker.m_szIncPatternFiles = _T("*.doc");
+//!      fileWalker.m_bRecursive = true;
+//!      fileWalker.WalkAll(szDirectory);
+//!      FileWalkerEntryList& listFiles = fileWalker.GetFiles();
+//!
+//! Each worker scans directories from its own queue and queues the
+//! subdirectories it finds there; an idle worker steals the oldest
+//! directory queued by another, so one wide or deep branch is shared
+//! out.  On Linux the entry type comes from the directory entry where
+//! the file system fills it in, and files are stat'ed relative to the
+//! open directory.  Subdirectories are opened relative to their
+//! parent's descriptor, which is held until each has been opened.  The
+//! results are returned in the order CEnum used:
+//! the files of each directory by name, then its subdirectories by
+//! name.  As with CEnum, symbolic links are skipped on Linux.
+//!
+//! The patterns are compiled once per walk.  A directory matching the
+//! exclude patterns is never opened, so its whole subtree is pruned;
+//! exclude patterns take precedence over include patterns.
+class FileWalker
+{
+public:
+    _stl_string                 m_szIncPatternFiles;            //! ';' separated
+    _stl_string                 m_szExcPatternFiles;
+    _stl_string                 m_szExcPatternDirs;             //! Directory names
+    bool                        m_bRecursive;
+    bool                        m_bNoCaseFiles;
+    bool                        m_bNoCaseDirs;
+    int                         m_nThreads;
+
+    EnumStatusFunc              m_pfnStatusFunc;
+    void*                       m_pUserData;
+    volatile bool               m_bCancelled;
+
+private:
+    //-----------------------------------------------------------------
+    //! Directory scanned by the walk - nodes are only added while
+    //! walking, so the indexes and references stay valid.
+    //-----------------------------------------------------------------
+    struct WalkDirectory
+    {
+        std::string             szPath;
+        std::string             szName;
+        int                     nParent;                //! -1 for the root
+        FileWalkerEntryList     listFiles;
+        std::vector<int>        listSubDirs;
+        int                     nDirFd;                 //! Held for the subdirectories,
+        int                     nDirFdRefs;             //! -1 when closed (not WIN32)
+    };
+
+    struct WalkQueue
+    {
+        std::deque<int>                     listDirs;
+        DIOMEDE_CRITICAL::CCriticalSection  lock;
+    };
+
+    std::deque<WalkDirectory>   m_listDirectories;
+    std::vector<WalkQueue*>     m_listQueues;
+    GlobMatcher                 m_incFilesMatcher;
+    GlobMatcher                 m_excFilesMatcher;
+    GlobMatcher                 m_excDirsMatcher;
+    FileWalkerEntryList         m_listFiles;
+
+    int                         m_nPendingDirs;                 //! Queued or being scanned
+    int                         m_nFileCount;                   //! Reported to the callback
+
+    DIOMEDE_CRITICAL::CCriticalSection  m_lock;
+
+public:
+    FileWalker();
+    virtual ~FileWalker();
+
+    //-----------------------------------------------------------------
+    //! \brief Walk the directory - the files found replace those of a
+    //!        previous walk.
+    //-----------------------------------------------------------------
+    void WalkAll(std::string szPath);
+
+    //-----------------------------------------------------------------
+    //! \brief Run by each worker thread until the walk is done.
+    //-----------------------------------------------------------------
+    void RunWorker(int nWorker);
+
+    FileWalkerEntryList& GetFiles() { return m_listFiles; }
+
+private:
+    // Not implemented
+    FileWalker(const FileWalker&);
+    FileWalker& operator=(const FileWalker&);
+
+    int AddDirectory(int nWorker, const std::string& szPath, const std::string& szName,
+                     int nParent);
+    bool NextDirectory(int nWorker, int& nDirectory);
+    void ScanDirectory(int nWorker, int nDirectory);
+    int OpenDirectory(int nDirectory);
+    void ReleaseDirFd(int nDirectory);
+    void UpdateStatus(int nFiles);
+
+    bool IncludeFile(const std::string& szFileName);
+    bool IncludeDirectory(const std::string& szDirName);
+    void CollectFiles(int nDirectory);
+    void ClearQueues();
+
+}; // End FileWalker
+
+#endif // __FILE_WALKER_H__
+
+/** @} */
@@ -0,0 +1,231 @@
+/*********************************************************************
+ *
+ *  file:  GlobMatcher.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: File and directory name patterns compiled once for the
+ *          include and exclude checks of the file walker.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "GlobMatcher.h"
+
+#include <ctype.h>
+
+///////////////////////////////////////////////////////////////////////
+// GlobMatcher Constructor
+GlobMatcher::GlobMatcher() : m_bMatchAll(false), m_bNoCase(false)
+{
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Compile the patterns - empty patterns are ignored.
+//! \param szPatterns: patterns separated by ';'
+//! \param bNoCase: true to ignore the case of the names.
+void GlobMatcher::Compile(const std::string& szPatterns, bool bNoCase)
+{
+    Clear();
+    m_bNoCase = bNoCase;
+
+    std::string::size_type nStart = 0;
+    while (nStart <= szPatterns.length()) {
+        std::string::size_type nEnd = szPatterns.find(GLOB_PATTERN_SEPARATOR, nStart);
+        if (nEnd == std::string::npos) {
+            nEnd = szPatterns.length();
+        }
+
+        if (nEnd > nStart) {
+            AddPattern(FoldCase(szPatterns.substr(nStart, nEnd - nStart)));
+        }
+
+        nStart = nEnd + 1;
+    }
+
+} // End Compile
+
+///////////////////////////////////////////////////////////////////////
+void GlobMatcher::Clear()
+{
+    m_setNames.clear();
+    m_listPatterns.clear();
+    m_bMatchAll = false;
+
+} // End Clear
+
+///////////////////////////////////////////////////////////////////////
+bool GlobMatcher::IsEmpty() const
+{
+    return ( (m_bMatchAll == false) && m_setNames.empty() && m_listPatterns.empty() );
+
+} // End IsEmpty
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Match a name against the patterns - the cheapest checks
+//!        first.
+//! \return true if at least one pattern matches, false otherwise.
+bool GlobMatcher::Match(const std::string& szName) const
+{
+    if (m_bMatchAll) {
+        return true;
+    }
+
+    std::string szFoldedName;
+    const std::string* pName = &szName;
+
+    if (m_bNoCase) {
+        szFoldedName = FoldCase(szName);
+        pName = &szFoldedName;
+    }
+
+    if ( (m_setNames.empty() == false) && (m_setNames.find(*pName) != m_setNames.end()) ) {
+        return true;
+    }
+
+    std::string::size_type nNameLength = pName->length();
+
+    for (int nIndex = 0; nIndex < (int)m_listPatterns.size(); nIndex++) {
+        const GlobPattern& globPattern = m_listPatterns[nIndex];
+
+        std::string::size_type nPrefixLength = globPattern.szPrefix.length();
+        std::string::size_type nSuffixLength = globPattern.szSuffix.length();
+
+        if (nNameLength < nPrefixLength + nSuffixLength) {
+            continue;
+        }
+
+        if ( pName->compare(0, nPrefixLength, globPattern.szPrefix) ||
+             pName->compare(nNameLength - nSuffixLength, nSuffixLength, globPattern.szSuffix) ) {
+            continue;
+        }
+
+        if (globPattern.nType == patternOneStar) {
+            return true;
+        }
+
+        // The middle starts and ends with a wildcard.
+        const char* szMiddle = globPattern.szMiddle.c_str();
+        const char* szNameStart = pName->c_str();
+
+        if (MatchPattern(szMiddle, szMiddle + globPattern.szMiddle.length(),
+                         szNameStart + nPrefixLength,
+                         szNameStart + nNameLength - nSuffixLength)) {
+            return true;
+        }
+    }
+
+    return false;
+
+} // End Match
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Sort a (case folded) pattern by the check that decides it.
+void GlobMatcher::AddPattern(const std::string& szPattern)
+{
+    // "**" matches as "*" does.
+    std::string szCompiled = _T("");
+    for (int nIndex = 0; nIndex < (int)szPattern.length(); nIndex++) {
+        if ( (szPattern[nIndex] == _T('*')) && (szCompiled.empty() == false) &&
+             (szCompiled[szCompiled.length() - 1] == _T('*')) ) {
+            continue;
+        }
+        szCompiled += szPattern[nIndex];
+    }
+
+    if (szCompiled == _T("*")) {
+        m_bMatchAll = true;
+        return;
+    }
+
+    std::string::size_type nFirst = szCompiled.find_first_of(_T("*?"));
+    if (nFirst == std::string::npos) {
+        m_setNames.insert(szCompiled);
+        return;
+    }
+
+    std::string::size_type nLast = szCompiled.find_last_of(_T("*?"));
+
+    GlobPattern globPattern;
+    globPattern.szPrefix = szCompiled.substr(0, nFirst);
+    globPattern.szSuffix = szCompiled.substr(nLast + 1);
+
+    if ( (nFirst == nLast) && (szCompiled[nFirst] == _T('*')) ) {
+        globPattern.nType = patternOneStar;
+        globPattern.szMiddle = _T("");
+    }
+    else {
+        globPattern.nType = patternGeneral;
+        globPattern.szMiddle = szCompiled.substr(nFirst, nLast - nFirst + 1);
+    }
+
+    m_listPatterns.push_back(globPattern);
+
+} // End AddPattern
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Case fold the name when the case is ignored.
+std::string GlobMatcher::FoldCase(const std::string& szName) const
+{
+    if (m_bNoCase == false) {
+        return szName;
+    }
+
+    std::string szFoldedName = szName;
+    for (int nIndex = 0; nIndex < (int)szFoldedName.length(); nIndex++) {
+        szFoldedName[nIndex] = (char)tolower((unsigned char)szFoldedName[nIndex]);
+    }
+
+    return szFoldedName;
+
+} // End FoldCase
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Match the name against the pattern - a mismatch after a '*'
+//!        retries from the next character covered by that '*' only,
+//!        so the match never backtracks further.
+//! \return true if the whole name matches, false otherwise.
+bool GlobMatcher::MatchPattern(const char* szPattern, const char* szPatternEnd,
+                               const char* szName, const char* szNameEnd)
+{
+    const char* szStar = NULL;
+    const char* szStarName = NULL;
+
+    while (szName < szNameEnd) {
+        if ( (szPattern < szPatternEnd) && (*szPattern == _T('*')) ) {
+            szStar = ++szPattern;
+            szStarName = szName;
+            continue;
+        }
+
+        if ( (szPattern < szPatternEnd) &&
+             ( (*szPattern == _T('?')) || (*szPattern == *szName) ) ) {
+            ++szPattern;
+            ++szName;
+            continue;
+        }
+
+        if (szStar == NULL) {
+            return false;
+        }
+
+        szPattern = szStar;
+        szName = ++szStarName;
+    }
+
+    while ( (szPattern < szPatternEnd) && (*szPattern == _T('*')) ) {
+        ++szPattern;
+    }
+
+    return (szPattern == szPatternEnd);
+
+} // End MatchPattern
+
+/** @} */
@@ -0,0 +1,103 @@
+/*********************************************************************
+ *
+ *  file:  GlobMatcher.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: File and directory name patterns compiled once for the
+ *          include and exclude checks of the file walker.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __GLOB_MATCHER_H__
+#define __GLOB_MATCHER_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+
+#include <string>
+#include <vector>
+#include <set>
+
+//---------------------------------------------------------------------
+//! Separator of the patterns in a pattern list, e.g. "*.doc;*.txt".
+//---------------------------------------------------------------------
+#define GLOB_PATTERN_SEPARATOR          _T(';')
+
+///////////////////////////////////////////////////////////////////////
+//! \class GlobMatcher
+//! \brief Matches names against a list of '*' and '?' patterns.
+//!
+//! Usage:
+//!      GlobMatcher matcher;
+//!      matcher.Compile(_T("*.doc;*.txt;readme"), true);
+//!      if (matcher.Match(szFileName)) ...
+//!
+//! Each pattern is case folded once when compiled and sorted by the
+//! cheapest check that decides it: names without wildcards are looked
+//! up in a set, patterns with a single '*' compare the literal prefix
+//! and suffix, and only the remaining patterns run the full match -
+//! once their literal prefix and suffix have been checked.  A name is
+//! case folded once per Match, whatever the number of patterns.
+class GlobMatcher
+{
+private:
+    typedef enum GlobPatternType {
+        patternOneStar = 0,                                     //! "abc*", "*abc", "a*c"
+        patternGeneral
+    } GlobPatternType;
+
+    struct GlobPattern
+    {
+        int                     nType;
+        std::string             szPrefix;                       //! Before the first wildcard
+        std::string             szSuffix;                       //! After the last wildcard
+        std::string             szMiddle;                       //! The rest - general only
+    };
+
+    std::set<std::string>       m_setNames;                     //! Patterns without wildcards
+    std::vector<GlobPattern>    m_listPatterns;
+    bool                        m_bMatchAll;                    //! A "*" pattern
+    bool                        m_bNoCase;
+
+public:
+    GlobMatcher();
+    virtual ~GlobMatcher() {}
+
+    //-----------------------------------------------------------------
+    //! \brief Compile the patterns - they replace those compiled
+    //!        before.
+    //! \param szPatterns: patterns separated by ';'
+    //! \param bNoCase: true to ignore the case of the names.
+    //-----------------------------------------------------------------
+    void Compile(const std::string& szPatterns, bool bNoCase);
+
+    void Clear();
+    bool IsEmpty() const;
+
+    //-----------------------------------------------------------------
+    //! \brief Match a name against the patterns.
+    //! \return true if at least one pattern matches, false otherwise
+    //!         (and if there are no patterns).
+    //-----------------------------------------------------------------
+    bool Match(const std::string& szName) const;
+
+private:
+    void AddPattern(const std::string& szPattern);
+    std::string FoldCase(const std::string& szName) const;
+
+    static bool MatchPattern(const char* szPattern, const char* szPatternEnd,
+                             const char* szName, const char* szNameEnd);
+
+}; // End GlobMatcher
+
+#endif // __GLOB_MATCHER_H__
+
+/** @} */
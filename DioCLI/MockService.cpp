@@ -0,0 +1,1288 @@
+/*********************************************************************
+ *
+ *  file:  MockService.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Local mock of the storage and transfer services - login,
+ *          create, upload, download, search, and metadata against a
+ *          local directory, with configurable latency, bandwidth and
+ *          failures.  Used to measure client throughput offline.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "MockService.h"
+#include "ResumeManager.h"
+
+#include "../Include/DiomedeStorage.h"
+#include "../Util/Thread.h"
+#include "../Util/Util.h"
+#include "../Util/StringUtil.h"
+#include "../Util/XString.h"
+#include "../Util/ClientLog.h"
+#include "../Util/UserProfileData.h"
+#include "../Util/ProfileManager.h"
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <ctype.h>
+
+#ifdef WIN32
+    #include <direct.h>
+    #define MOCK_FSEEK64(pFile, l64Offset)      _fseeki64(pFile, l64Offset, SEEK_SET)
+    #define MOCK_PATH_SEPARATOR                 _T("\\")
+#else
+    #include <unistd.h>
+    #include <sys/stat.h>
+    #define MOCK_FSEEK64(pFile, l64Offset)      fseeko(pFile, (off_t)l64Offset, SEEK_SET)
+    #define MOCK_PATH_SEPARATOR                 _T("/")
+#endif
+
+using namespace boost::posix_time;
+
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Case insensitive match of a name against a pattern with *
+//!        and ? wildcards.
+static bool MatchMockFileName(const char* szPattern, const char* szName)
+{
+    while (*szPattern) {
+        if (*szPattern == _T('*')) {
+            szPattern++;
+            for (;;) {
+                if (MatchMockFileName(szPattern, szName)) {
+                    return true;
+                }
+                if (*szName == 0) {
+                    return false;
+                }
+                szName++;
+            }
+        }
+
+        if (*szName == 0) {
+            return false;
+        }
+
+        if ( (*szPattern != _T('?')) &&
+             (tolower((unsigned char)*szPattern) != tolower((unsigned char)*szName)) ) {
+            return false;
+        }
+
+        szPattern++;
+        szName++;
+    }
+
+    return (*szName == 0);
+
+} // End MatchMockFileName
+
+///////////////////////////////////////////////////////////////////////
+MockService* MockService::m_pMockService = NULL;
+
+///////////////////////////////////////////////////////////////////////
+// MockService Constructor
+MockService::MockService() : m_bEnabled(false), m_szStoreDir(_T("")), m_nLatency(0),
+                             m_l64Bandwidth(0), m_nFailureRate(0), m_l64NextFileID(1),
+                             m_nNextMetaDataID(1)
+{
+    // Only used for failures and session tokens - nothing security
+    // related.
+    m_nRandomState = (unsigned int)time(NULL) ^ (unsigned int)(size_t)this;
+    if (m_nRandomState == 0) {
+        m_nRandomState = 0x2545F491;
+    }
+
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+// MockService Destructor
+MockService::~MockService()
+{
+} // End Destructor
+
+///////////////////////////////////////////////////////////////////////
+//! MockService Instance
+MockService* MockService::Instance()
+{
+	if (m_pMockService == NULL) {
+	    m_pMockService = new MockService;
+	}
+
+	return m_pMockService;
+
+} // End Instance
+
+///////////////////////////////////////////////////////////////////////
+//! MockService Shutdown
+void MockService::Shutdown()
+{
+	if ( this == m_pMockService )
+		m_pMockService = NULL;
+
+	delete this;
+
+} // End Shutdown
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns a random value from 0 to nRange - 1 (xorshift).
+//!        Called with the lock held.
+unsigned int MockService::GetRandom(unsigned int nRange)
+{
+    if (nRange == 0) {
+        return 0;
+    }
+
+    m_nRandomState ^= m_nRandomState << 13;
+    m_nRandomState ^= m_nRandomState >> 17;
+    m_nRandomState ^= m_nRandomState << 5;
+
+    return m_nRandomState % nRange;
+
+} // End GetRandom
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Read the settings from the user profile.  Called at startup
+//!        - the store index is read when the mock is enabled.
+//! \param szStoreDir: store to use instead of the profile setting, which
+//!        also enables the mock.  Empty to use the profile.
+void MockService::LoadSettings(const std::string& szStoreDir /*_T("")*/)
+{
+    bool bEnabled = (GEN_MOCK_SERVICE_DF != 0);
+    std::string szMockStoreDir = GEN_MOCK_SERVICE_DIR_DF;
+    int nLatency = GEN_MOCK_LATENCY_DF;
+    int nBandwidth = GEN_MOCK_BANDWIDTH_DF;
+    int nFailureRate = GEN_MOCK_FAILURE_RATE_DF;
+    std::string szFailureErrors = GEN_MOCK_FAILURE_ERRORS_DF;
+
+    UserProfileData* pProfileData =
+        ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
+    if (pProfileData) {
+        bEnabled = (pProfileData->GetUserProfileInt(GEN_MOCK_SERVICE, GEN_MOCK_SERVICE_DF) != 0);
+        szMockStoreDir = pProfileData->GetUserProfileStr(GEN_MOCK_SERVICE_DIR,
+                                                            GEN_MOCK_SERVICE_DIR_DF);
+        nLatency = pProfileData->GetUserProfileInt(GEN_MOCK_LATENCY, GEN_MOCK_LATENCY_DF);
+        nBandwidth = pProfileData->GetUserProfileInt(GEN_MOCK_BANDWIDTH, GEN_MOCK_BANDWIDTH_DF);
+        nFailureRate = pProfileData->GetUserProfileInt(GEN_MOCK_FAILURE_RATE,
+                                                       GEN_MOCK_FAILURE_RATE_DF);
+        szFailureErrors = pProfileData->GetUserProfileStr(GEN_MOCK_FAILURE_ERRORS,
+                                                          GEN_MOCK_FAILURE_ERRORS_DF);
+    }
+
+    if (szStoreDir.length() > 0) {
+        szMockStoreDir = szStoreDir;
+        bEnabled = true;
+    }
+
+    if (bEnabled == false) {
+        m_bEnabled = false;
+        return;
+    }
+
+    if (szMockStoreDir.length() == 0) {
+        szMockStoreDir = ResumeManager::Instance()->GetAppDataDir() + _T("mock");
+    }
+
+    if (false == Util::IsDirectory(szMockStoreDir.c_str())) {
+        #ifdef WIN32
+            _mkdir(szMockStoreDir.c_str());
+        #else
+            mkdir(szMockStoreDir.c_str(), 0777);
+        #endif
+    }
+
+    if (false == Util::IsDirectory(szMockStoreDir.c_str())) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Mock service directory %s could not be created."),
+            szMockStoreDir.c_str());
+        m_bEnabled = false;
+        return;
+    }
+
+    std::vector<std::string> listErrors;
+    std::vector<std::string> listFailureErrors;
+    StringUtil::SplitString(szFailureErrors, _T(","), listErrors, false);
+
+    for (int nIndex = 0; nIndex < (int)listErrors.size(); nIndex++) {
+        std::string szError = listErrors[nIndex];
+        size_t nStart = szError.find_first_not_of(_T(" \t"));
+        if (nStart == std::string::npos) {
+            continue;
+        }
+        size_t nEnd = szError.find_last_not_of(_T(" \t"));
+        listFailureErrors.push_back(szError.substr(nStart, nEnd - nStart + 1));
+    }
+
+    if (listFailureErrors.size() == 0) {
+        listFailureErrors.push_back(_T("an error has occurred"));
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    m_szStoreDir = szMockStoreDir + MOCK_PATH_SEPARATOR;
+    m_nLatency = (nLatency > 0) ? nLatency : 0;
+    m_l64Bandwidth = (nBandwidth > 0) ? (LONG64)nBandwidth * 1024 : 0;
+    m_nFailureRate = (nFailureRate < 0) ? 0 : ( (nFailureRate > 100) ? 100 : nFailureRate);
+    m_listFailureErrors = listFailureErrors;
+    m_linkBucket.Reset();
+
+    LoadIndex();
+    m_bEnabled = true;
+
+    ClientLog(UI_COMP, LOG_STATUS, false,
+        _T("Mock service in %s: latency %d ms, bandwidth %d KB/s, failures %d%%, %d files."),
+        m_szStoreDir.c_str(), m_nLatency, (int)(m_l64Bandwidth / 1024), m_nFailureRate,
+        (int)m_mapFiles.size());
+
+} // End LoadSettings
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Get the directory of the mock store.
+// Requires: nothing
+// Returns: store directory, with the trailing separator
+std::string MockService::GetStoreDir()
+{
+    Lock<CCriticalSection> lock(m_lock);
+    return m_szStoreDir;
+
+} // End GetStoreDir
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Read the store index.  Called with the lock held.
+//! \return true if the index was read, false otherwise.
+//
+//! Index file - fields separated by tabs:
+//!     Ver: 1
+//!     <next file ID> <next metadata ID>
+//!     M <metadata ID> <created> <name> <value>
+//!     F <file ID> <file size> <created> <last access> <deleted>
+//!       <MD5> <metadata IDs separated by commas> <file name>
+bool MockService::LoadIndex()
+{
+    m_mapFiles.clear();
+    m_mapMetaData.clear();
+    m_l64NextFileID = 1;
+    m_nNextMetaDataID = 1;
+
+    FILE* pFile = fopen((m_szStoreDir + MOCK_INDEX_FILE).c_str(), _T("rt"));
+    if (pFile == NULL) {
+        return false;
+    }
+
+    int nVersion = 0;
+    long lNextMetaDataID = 0;
+    char szNextFileID[32];
+
+    if ( (fscanf(pFile, _T("Ver: %d "), &nVersion) != 1) || (nVersion != MOCK_INDEX_FILE_VER) ||
+         (fscanf(pFile, _T("%31s %ld "), szNextFileID, &lNextMetaDataID) != 2) ) {
+        fclose(pFile);
+        return false;
+    }
+
+    m_l64NextFileID = atoi64(szNextFileID);
+    m_nNextMetaDataID = (int)lNextMetaDataID;
+
+    std::string szLine = _T("");
+    char szBuffer[1024];
+
+    while (fgets(szBuffer, sizeof(szBuffer), pFile) != NULL) {
+        szLine += szBuffer;
+        if ( (szLine.length() == 0) || (szLine[szLine.length() - 1] != _T('\n')) ) {
+            continue;
+        }
+
+        szLine.erase(szLine.length() - 1);
+
+        std::vector<std::string> listFields;
+        StringUtil::SplitString(szLine, _T("\t"), listFields, true);
+        szLine = _T("");
+
+        if ( (listFields.size() == 5) && (listFields[0] == _T("M")) ) {
+            MockMetaData metaData;
+            metaData.nMetaDataID = atoi(listFields[1].c_str());
+            metaData.tmCreated = (time_t)atol(listFields[2].c_str());
+            metaData.szName = listFields[3];
+            metaData.szValue = listFields[4];
+            m_mapMetaData[metaData.nMetaDataID] = metaData;
+        }
+        else if ( (listFields.size() == 9) && (listFields[0] == _T("F")) ) {
+            MockStoredFile storedFile;
+            storedFile.l64FileID = atoi64(listFields[1].c_str());
+            storedFile.l64FileSize = atoi64(listFields[2].c_str());
+            storedFile.tmCreated = (time_t)atol(listFields[3].c_str());
+            storedFile.tmLastAccess = (time_t)atol(listFields[4].c_str());
+            storedFile.bDeleted = (atoi(listFields[5].c_str()) != 0);
+            storedFile.szHashMD5 = listFields[6];
+            storedFile.szFileName = listFields[8];
+
+            std::vector<std::string> listIDs;
+            StringUtil::SplitString(listFields[7], _T(","), listIDs, false);
+            for (int nIndex = 0; nIndex < (int)listIDs.size(); nIndex++) {
+                storedFile.listMetaDataIDs.push_back(atoi(listIDs[nIndex].c_str()));
+            }
+
+            // The data file holds what was received, including uploads
+            // interrupted since the index was written.
+            LONG64 l64StoredBytes =
+                Util::GetFileLength64(GetDataFileName(storedFile.l64FileID).c_str());
+            storedFile.l64StoredBytes = (l64StoredBytes > 0) ? l64StoredBytes : 0;
+
+            m_mapFiles[storedFile.l64FileID] = storedFile;
+        }
+    }
+
+    fclose(pFile);
+    return true;
+
+} // End LoadIndex
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Write the store index.  Called with the lock held.
+//! \return true if successful, false otherwise.
+bool MockService::SaveIndex()
+{
+    std::string szIndexFile = m_szStoreDir + MOCK_INDEX_FILE;
+
+    FILE* pFile = fopen(szIndexFile.c_str(), _T("wt"));
+    if (pFile == NULL) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Mock service index %s could not be created."),
+            szIndexFile.c_str());
+        return false;
+    }
+
+    fprintf(pFile, _T("Ver: %d\n") DIOMEDE_LONG_FORMAT _T(" %d\n"), MOCK_INDEX_FILE_VER,
+            m_l64NextFileID, m_nNextMetaDataID);
+
+    std::map<int, MockMetaData>::iterator iterMetaData;
+    for (iterMetaData = m_mapMetaData.begin(); iterMetaData != m_mapMetaData.end(); iterMetaData++) {
+        const MockMetaData& metaData = iterMetaData->second;
+        fprintf(pFile, _T("M\t%d\t%ld\t%s\t%s\n"), metaData.nMetaDataID, (long)metaData.tmCreated,
+                metaData.szName.c_str(), metaData.szValue.c_str());
+    }
+
+    std::map<LONG64, MockStoredFile>::iterator iterFile;
+    for (iterFile = m_mapFiles.begin(); iterFile != m_mapFiles.end(); iterFile++) {
+        const MockStoredFile& storedFile = iterFile->second;
+
+        std::string szMetaDataIDs = _T("");
+        for (int nIndex = 0; nIndex < (int)storedFile.listMetaDataIDs.size(); nIndex++) {
+            if (nIndex > 0) {
+                szMetaDataIDs += _T(",");
+            }
+            szMetaDataIDs += _format(_T("%d"), storedFile.listMetaDataIDs[nIndex]);
+        }
+
+        fprintf(pFile, _T("F\t") DIOMEDE_LONG_FORMAT _T("\t") DIOMEDE_LONG_FORMAT
+                _T("\t%ld\t%ld\t%d\t%s\t%s\t%s\n"),
+                storedFile.l64FileID, storedFile.l64FileSize, (long)storedFile.tmCreated,
+                (long)storedFile.tmLastAccess, storedFile.bDeleted ? 1 : 0,
+                storedFile.szHashMD5.c_str(), szMetaDataIDs.c_str(),
+                storedFile.szFileName.c_str());
+    }
+
+    bool bSuccess = (ferror(pFile) == 0);
+    fclose(pFile);
+
+    return bSuccess;
+
+} // End SaveIndex
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Wait for the latency, then check the session and inject a
+//!        failure.
+//! \param szSessionToken: session token, empty to skip the check.
+//! \param szErrorMsg: set to the error on failure.
+//! \return true if the request can continue, false otherwise.
+bool MockService::BeginRequest(const std::string& szSessionToken, std::string& szErrorMsg)
+{
+    int nLatency = 0;
+    {
+        Lock<CCriticalSection> lock(m_lock);
+        nLatency = m_nLatency;
+    }
+
+    if (nLatency > 0) {
+        Sleep((unsigned int)nLatency);
+    }
+
+    if ( (szSessionToken.length() > 0) &&
+         (szSessionToken.compare(0, strlen(MOCK_SESSION_PREFIX), MOCK_SESSION_PREFIX) != 0) ) {
+        szErrorMsg = _T("Invalid session token.");
+        return false;
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    if ( (m_nFailureRate > 0) && ((int)GetRandom(100) < m_nFailureRate) ) {
+        szErrorMsg = m_listFailureErrors[GetRandom((unsigned int)m_listFailureErrors.size())];
+        return false;
+    }
+
+    return true;
+
+} // End BeginRequest
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Wait for the latency and the mock link to carry a chunk,
+//!        then inject a failure.  Transfers share the link in the order
+//!        they reserve it, as with the bandwidth limiter.
+//! \param l64Bytes: chunk size
+//! \param szErrorMsg: set to the error on failure.
+//! \return true if the chunk was carried, false otherwise.
+bool MockService::TransferChunk(LONG64 l64Bytes, std::string& szErrorMsg)
+{
+    LONG64 l64WaitMs = 0;
+    {
+        Lock<CCriticalSection> lock(m_lock);
+        l64WaitMs = m_nLatency;
+        if (m_l64Bandwidth > 0) {
+            l64WaitMs += m_linkBucket.Reserve(l64Bytes, m_l64Bandwidth,
+                                              microsec_clock::universal_time());
+        }
+    }
+
+    if (l64WaitMs > 0) {
+        Sleep((unsigned int)l64WaitMs);
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    if ( (m_nFailureRate > 0) && ((int)GetRandom(100) < m_nFailureRate) ) {
+        szErrorMsg = m_listFailureErrors[GetRandom((unsigned int)m_listFailureErrors.size())];
+        return false;
+    }
+
+    return true;
+
+} // End TransferChunk
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns a new session token.
+std::string MockService::NewSessionToken()
+{
+    Lock<CCriticalSection> lock(m_lock);
+    return _format(_T("%s%08x%08x"), MOCK_SESSION_PREFIX, GetRandom(0xFFFFFFFF),
+                   (unsigned int)time(NULL));
+
+} // End NewSessionToken
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns the data file name with path of a stored file.
+std::string MockService::GetDataFileName(LONG64 l64FileID)
+{
+    return m_szStoreDir + _format(DIOMEDE_LONG_FORMAT _T(".dat"), l64FileID);
+
+} // End GetDataFileName
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Copy of a stored file.
+//! \return true if the file exists, false otherwise.
+bool MockService::GetFile(LONG64 l64FileID, MockStoredFile& storedFile)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    std::map<LONG64, MockStoredFile>::iterator iter = m_mapFiles.find(l64FileID);
+    if (iter == m_mapFiles.end()) {
+        return false;
+    }
+
+    storedFile = iter->second;
+    return true;
+
+} // End GetFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Add a new, empty file to the store.
+//! \return the new file ID.
+LONG64 MockService::AddFile(const std::string& szFileName, LONG64 l64FileSize)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    MockStoredFile storedFile;
+    storedFile.l64FileID = m_l64NextFileID++;
+    storedFile.szFileName = szFileName;
+    storedFile.szHashMD5 = _T("");
+    storedFile.l64FileSize = l64FileSize;
+    storedFile.l64StoredBytes = 0;
+    storedFile.tmCreated = time(NULL);
+    storedFile.tmLastAccess = storedFile.tmCreated;
+    storedFile.bDeleted = false;
+
+    m_mapFiles[storedFile.l64FileID] = storedFile;
+
+    // Start with an empty data file.
+    FILE* pFile = fopen(GetDataFileName(storedFile.l64FileID).c_str(), _T("wb"));
+    if (pFile) {
+        fclose(pFile);
+    }
+
+    SaveIndex();
+    return storedFile.l64FileID;
+
+} // End AddFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Replace a stored file's entry.
+//! \param storedFile: updated entry
+//! \param bSave: write the index - upload progress is kept in memory
+//!        (the data file holds it across restarts).
+void MockService::UpdateFile(const MockStoredFile& storedFile, bool bSave)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    m_mapFiles[storedFile.l64FileID] = storedFile;
+
+    if (bSave) {
+        SaveIndex();
+    }
+
+} // End UpdateFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Copy of all stored files, in file ID order.
+void MockService::GetFiles(std::vector<MockStoredFile>& listFiles)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    listFiles.clear();
+
+    std::map<LONG64, MockStoredFile>::iterator iter;
+    for (iter = m_mapFiles.begin(); iter != m_mapFiles.end(); iter++) {
+        listFiles.push_back(iter->second);
+    }
+
+} // End GetFiles
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Delete every stored file and the index, leaving the store
+//!        empty (benchmark runs start and end with this).
+//! \param bRemoveStoreDir: also remove the (then empty) store directory
+//!        - the mock is disabled until the settings are loaded again.
+void MockService::ClearStore(bool bRemoveStoreDir /*false*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    std::map<LONG64, MockStoredFile>::iterator iter;
+    for (iter = m_mapFiles.begin(); iter != m_mapFiles.end(); iter++) {
+        remove(GetDataFileName(iter->first).c_str());
+    }
+
+    remove((m_szStoreDir + MOCK_INDEX_FILE).c_str());
+
+    m_mapFiles.clear();
+    m_mapMetaData.clear();
+    m_l64NextFileID = 1;
+    m_nNextMetaDataID = 1;
+
+    if (bRemoveStoreDir) {
+        #ifdef WIN32
+            _rmdir(m_szStoreDir.c_str());
+        #else
+            rmdir(m_szStoreDir.c_str());
+        #endif
+        m_bEnabled = false;
+    }
+
+} // End ClearStore
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Add a metadata entry to the store.
+//! \return the new metadata ID.
+int MockService::AddMetaData(const std::string& szName, const std::string& szValue)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    MockMetaData metaData;
+    metaData.nMetaDataID = m_nNextMetaDataID++;
+    metaData.szName = szName;
+    metaData.szValue = szValue;
+    metaData.tmCreated = time(NULL);
+
+    m_mapMetaData[metaData.nMetaDataID] = metaData;
+
+    SaveIndex();
+    return metaData.nMetaDataID;
+
+} // End AddMetaData
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Copy of a metadata entry.
+//! \return true if the entry exists, false otherwise.
+bool MockService::GetMetaData(int nMetaDataID, MockMetaData& metaData)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    std::map<int, MockMetaData>::iterator iter = m_mapMetaData.find(nMetaDataID);
+    if (iter == m_mapMetaData.end()) {
+        return false;
+    }
+
+    metaData = iter->second;
+    return true;
+
+} // End GetMetaData
+
+///////////////////////////////////////////////////////////////////////
+// MockUserManager
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Log in - any user name and password is accepted.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockUserManager::LoginUser(std::string szUsername, std::string szPassword,
+                               std::string& szSessionToken)
+{
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(_T(""), m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    szSessionToken = pMockService->NewSessionToken();
+    return SOAP_OK;
+
+} // End LoginUser
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Log out.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockUserManager::LogoutUser(std::string szSessionToken)
+{
+    if (false == MockService::Instance()->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    return SOAP_OK;
+
+} // End LogoutUser
+
+///////////////////////////////////////////////////////////////////////
+// MockFileManager
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Look up a stored file, setting the error if it's missing.
+//! \return SOAP_OK if found, SOAP_FAULT otherwise.
+int MockFileManager::GetStoredFile(LONG64 l64FileID, MockStoredFile& storedFile)
+{
+    if (false == MockService::Instance()->GetFile(l64FileID, storedFile)) {
+        m_szErrorMsg = _format(_T("File ID ") DIOMEDE_LONG_FORMAT _T(" not found."), l64FileID);
+        return SOAP_FAULT;
+    }
+
+    return SOAP_OK;
+
+} // End GetStoredFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Create the file - sets the new file ID in the upload data.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::CreateFile(std::string szSessionToken, UploadImpl* pUpload)
+{
+    UploadFileFunc pfnCallback = pUpload->GetUploadCallback();
+    void* pUploadUser = pUpload->GetUploadUser();
+
+    if (pfnCallback) {
+        pfnCallback(pUploadUser, DIOMEDE::uploadCreateFile, 0);
+    }
+
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    LONG64 l64FileSize = Util::GetFileLength64(pUpload->GetFilePath().c_str());
+    if (l64FileSize < 0) {
+        m_szErrorMsg = _format(_T("File %s not found."), pUpload->GetFilePath().c_str());
+        return SOAP_FAULT;
+    }
+
+    pUpload->SetFileID(pMockService->AddFile(pUpload->GetFileName(), l64FileSize));
+
+    if (pfnCallback) {
+        pfnCallback(pUploadUser, DIOMEDE::uploadCreateFileComplete, 0);
+    }
+
+    return SOAP_OK;
+
+} // End CreateFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Upload the file in chunks, starting from the upload data's
+//!        total upload bytes (non-zero on resume).  Progress is
+//!        reported through the upload callback as the SDK does.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::Upload(std::string szSessionToken, UploadImpl* pUpload)
+{
+    UploadFileFunc pfnCallback = pUpload->GetUploadCallback();
+    void* pUploadUser = pUpload->GetUploadUser();
+
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(pUpload->GetFileID(), storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    LONG64 l64Offset = pUpload->GetTotalUploadBytes();
+    if ( (l64Offset < 0) || (l64Offset > storedFile.l64StoredBytes) ) {
+        m_szErrorMsg = _format(_T("Upload offset ") DIOMEDE_LONG_FORMAT _T(" is past the ")
+                               DIOMEDE_LONG_FORMAT _T(" bytes received."),
+                               l64Offset, storedFile.l64StoredBytes);
+        return SOAP_FAULT;
+    }
+
+    FILE* pSourceFile = fopen(pUpload->GetFilePath().c_str(), _T("rb"));
+    FILE* pDataFile = fopen(pMockService->GetDataFileName(storedFile.l64FileID).c_str(), _T("r+b"));
+
+    if ( (pSourceFile == NULL) || (pDataFile == NULL) ||
+         (MOCK_FSEEK64(pSourceFile, l64Offset) != 0) || (MOCK_FSEEK64(pDataFile, l64Offset) != 0) ) {
+        if (pSourceFile) {
+            fclose(pSourceFile);
+        }
+        if (pDataFile) {
+            fclose(pDataFile);
+        }
+        m_szErrorMsg = _format(_T("File %s could not be read."), pUpload->GetFilePath().c_str());
+        return SOAP_FAULT;
+    }
+
+    LONG64 l64ChunkSize = pUpload->GetMaxChunkSize();
+    if (l64ChunkSize <= 0) {
+        l64ChunkSize = MOCK_DEFAULT_CHUNK_SIZE;
+    }
+
+    char* pBuffer = new char[(size_t)l64ChunkSize];
+
+    if (pfnCallback) {
+        pfnCallback(pUploadUser, DIOMEDE::uploadStarted, l64Offset);
+    }
+
+    nResult = SOAP_OK;
+
+    for (;;) {
+        if (m_bCancel) {
+            m_szErrorMsg = _T("Upload cancelled.");
+            nResult = SOAP_FAULT;
+            break;
+        }
+
+        if (pfnCallback) {
+            pfnCallback(pUploadUser, DIOMEDE::uploadSending, l64Offset);
+        }
+
+        size_t nRead = fread(pBuffer, 1, (size_t)l64ChunkSize, pSourceFile);
+        if (nRead == 0) {
+            if (ferror(pSourceFile)) {
+                m_szErrorMsg = _format(_T("File %s could not be read."),
+                                       pUpload->GetFilePath().c_str());
+                nResult = SOAP_FAULT;
+            }
+            break;
+        }
+
+        if (false == pMockService->TransferChunk((LONG64)nRead, m_szErrorMsg)) {
+            nResult = SOAP_FAULT;
+            break;
+        }
+
+        if (fwrite(pBuffer, 1, nRead, pDataFile) != nRead) {
+            m_szErrorMsg = _T("An error has occurred writing the mock store.");
+            nResult = SOAP_FAULT;
+            break;
+        }
+
+        l64Offset += nRead;
+        storedFile.l64StoredBytes = l64Offset;
+        pMockService->UpdateFile(storedFile, false);
+
+        if ( pfnCallback && (false == pfnCallback(pUploadUser, DIOMEDE::uploadSendComplete,
+                                                  l64Offset)) ) {
+            m_bCancel = true;
+        }
+    }
+
+    delete [] pBuffer;
+    fclose(pSourceFile);
+
+    // The received bytes must be on disk before the client records them.
+    fflush(pDataFile);
+    fclose(pDataFile);
+
+    if (nResult != SOAP_OK) {
+        if (pfnCallback) {
+            pfnCallback(pUploadUser, m_bCancel ? DIOMEDE::uploadCancelled : DIOMEDE::uploadError,
+                        l64Offset);
+        }
+        pMockService->UpdateFile(storedFile, true);
+        return nResult;
+    }
+
+    storedFile.l64FileSize = l64Offset;
+    storedFile.szHashMD5 = pUpload->GetHashMD5();
+    storedFile.tmLastAccess = time(NULL);
+    pMockService->UpdateFile(storedFile, true);
+
+    if (pfnCallback) {
+        pfnCallback(pUploadUser, DIOMEDE::uploadComplete, l64Offset);
+    }
+
+    return SOAP_OK;
+
+} // End Upload
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Download the file to the download path, reporting progress
+//!        through the download callbacks as the SDK does.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::Download(std::string szSessionToken, DownloadImpl* pDownload)
+{
+    DownloadFileFunc pfnCallback = pDownload->GetDownloadCallback();
+    DownloadURLFunc pfnURLCallback = pDownload->GetDownloadURLCallback();
+    void* pDownloadUser = pDownload->GetDownloadUser();
+
+    MockService* pMockService = MockService::Instance();
+
+    if (pfnCallback) {
+        pfnCallback(pDownloadUser, DIOMEDE::downloadStarted, 0, 0);
+    }
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(pDownload->GetFileID(), storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    if ( storedFile.bDeleted || (storedFile.l64StoredBytes < storedFile.l64FileSize) ) {
+        m_szErrorMsg = _format(_T("File ID ") DIOMEDE_LONG_FORMAT _T(" is not available."),
+                               storedFile.l64FileID);
+        return SOAP_FAULT;
+    }
+
+    std::string szDataFile = pMockService->GetDataFileName(storedFile.l64FileID);
+    std::string szDownloadURL = _T("file://") + szDataFile;
+
+    pDownload->SetDownloadURL(szDownloadURL);
+    pDownload->SetDownloadFileName(storedFile.szFileName);
+
+    if (pfnURLCallback) {
+        pfnURLCallback(pDownloadUser, DIOMEDE::downloadGetDownloadURLComplete, szDownloadURL,
+                       storedFile.szFileName);
+    }
+
+    std::string szDownloadPath = pDownload->GetDownloadPath();
+    if ( (szDownloadPath.length() > 0) &&
+         (szDownloadPath.find_last_of(_T("/\\")) != szDownloadPath.length() - 1) ) {
+        szDownloadPath += MOCK_PATH_SEPARATOR;
+    }
+    szDownloadPath += storedFile.szFileName;
+
+    FILE* pDataFile = fopen(szDataFile.c_str(), _T("rb"));
+    FILE* pTargetFile = fopen(szDownloadPath.c_str(), _T("wb"));
+
+    if ( (pDataFile == NULL) || (pTargetFile == NULL) ) {
+        if (pDataFile) {
+            fclose(pDataFile);
+        }
+        if (pTargetFile) {
+            fclose(pTargetFile);
+        }
+        m_szErrorMsg = _format(_T("File %s could not be created."), szDownloadPath.c_str());
+        return SOAP_FAULT;
+    }
+
+    char* pBuffer = new char[MOCK_DEFAULT_CHUNK_SIZE];
+    LONG64 l64Received = 0;
+
+    for (;;) {
+        if ( m_bCancel || pDownload->GetCancelDownload() ) {
+            m_bCancel = true;
+            m_szErrorMsg = _T("Download cancelled.");
+            nResult = SOAP_FAULT;
+            break;
+        }
+
+        size_t nRead = fread(pBuffer, 1, MOCK_DEFAULT_CHUNK_SIZE, pDataFile);
+        if (nRead == 0) {
+            break;
+        }
+
+        if (false == pMockService->TransferChunk((LONG64)nRead, m_szErrorMsg)) {
+            nResult = SOAP_FAULT;
+            break;
+        }
+
+        if (fwrite(pBuffer, 1, nRead, pTargetFile) != nRead) {
+            m_szErrorMsg = _format(_T("File %s could not be written."), szDownloadPath.c_str());
+            nResult = SOAP_FAULT;
+            break;
+        }
+
+        l64Received += nRead;
+
+        if (pfnCallback) {
+            pfnCallback(pDownloadUser, DIOMEDE::downloadReceiving, l64Received,
+                        storedFile.l64FileSize);
+        }
+    }
+
+    delete [] pBuffer;
+    fclose(pDataFile);
+    fclose(pTargetFile);
+
+    if (nResult != SOAP_OK) {
+        if (pfnCallback) {
+            pfnCallback(pDownloadUser,
+                        m_bCancel ? DIOMEDE::downloadCancelled : DIOMEDE::downloadError,
+                        l64Received, storedFile.l64FileSize);
+        }
+        return nResult;
+    }
+
+    storedFile.tmLastAccess = time(NULL);
+    pMockService->UpdateFile(storedFile, true);
+
+    if (pfnCallback) {
+        pfnCallback(pDownloadUser, DIOMEDE::downloadComplete, l64Received, storedFile.l64FileSize);
+    }
+
+    return SOAP_OK;
+
+} // End Download
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Search the stored files.  File names match with * and ?
+//!        wildcards; the other filter values match as the service
+//!        does.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::SearchFiles(std::string szSessionToken, SearchFileFilterImpl* pSearchFilter,
+                                 FilePropertiesListImpl* pListFileProperties)
+{
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    std::vector<MockStoredFile> listFiles;
+    pMockService->GetFiles(listFiles);
+
+    LONG64 l64FileID = pSearchFilter->GetFileID();
+    std::string szFileName = pSearchFilter->GetFileName();
+    std::string szHashMD5 = pSearchFilter->GetHashMD5();
+    LONG64 l64MinSize = pSearchFilter->GetMinSize();
+    LONG64 l64MaxSize = pSearchFilter->GetMaxSize();
+    time_t tmDateStart = pSearchFilter->GetDateStart();
+    time_t tmDateEnd = pSearchFilter->GetDateEnd();
+    int nIsDeleted = pSearchFilter->GetIsDeleted();
+    int nIsCompleted = pSearchFilter->GetIsCompleted();
+    std::string szMetaDataName = pSearchFilter->GetMetaDataName();
+    std::string szMetaDataValue = pSearchFilter->GetMetaDataValue();
+
+    LONG64 l64Offset = pSearchFilter->GetOffset();
+    LONG64 l64PageSize = pSearchFilter->GetPageSize();
+    LONG64 l64Matches = 0;
+
+    for (int nIndex = 0; nIndex < (int)listFiles.size(); nIndex++) {
+        const MockStoredFile& storedFile = listFiles[nIndex];
+        bool bCompleted = (storedFile.l64StoredBytes >= storedFile.l64FileSize);
+
+        if ( ( (l64FileID > 0) && (storedFile.l64FileID != l64FileID) ) ||
+             ( (szFileName.length() > 0) &&
+               (false == MatchMockFileName(szFileName.c_str(), storedFile.szFileName.c_str())) ) ||
+             ( (szHashMD5.length() > 0) && (stricmp(szHashMD5.c_str(),
+                                                    storedFile.szHashMD5.c_str()) != 0) ) ||
+             ( (l64MinSize > 0) && (storedFile.l64FileSize < l64MinSize) ) ||
+             ( (l64MaxSize > 0) && (storedFile.l64FileSize > l64MaxSize) ) ||
+             ( (tmDateStart > 0) && (storedFile.tmCreated < tmDateStart) ) ||
+             ( (tmDateEnd > 0) && (storedFile.tmCreated > tmDateEnd) ) ||
+             ( (nIsDeleted == DIOMEDE::boolTrue) && (storedFile.bDeleted == false) ) ||
+             ( (nIsDeleted == DIOMEDE::boolFalse) && storedFile.bDeleted ) ||
+             ( (nIsCompleted == DIOMEDE::boolTrue) && (bCompleted == false) ) ||
+             ( (nIsCompleted == DIOMEDE::boolFalse) && bCompleted ) ) {
+            continue;
+        }
+
+        if ( (szMetaDataName.length() > 0) || (szMetaDataValue.length() > 0) ) {
+            bool bMetaDataFound = false;
+            for (int nMetaIndex = 0; nMetaIndex < (int)storedFile.listMetaDataIDs.size();
+                 nMetaIndex++) {
+                MockMetaData metaData;
+                if ( pMockService->GetMetaData(storedFile.listMetaDataIDs[nMetaIndex], metaData) &&
+                     ( (szMetaDataName.length() == 0) || (metaData.szName == szMetaDataName) ) &&
+                     ( (szMetaDataValue.length() == 0) || (metaData.szValue == szMetaDataValue) ) ) {
+                    bMetaDataFound = true;
+                    break;
+                }
+            }
+            if (bMetaDataFound == false) {
+                continue;
+            }
+        }
+
+        l64Matches ++;
+        if (l64Matches <= l64Offset) {
+            continue;
+        }
+        if ( (l64PageSize > 0) && (l64Matches > l64Offset + l64PageSize) ) {
+            break;
+        }
+
+        FilePropertiesImpl* pFileProperties = new FilePropertiesImpl;
+        pFileProperties->SetFileID(storedFile.l64FileID);
+        pFileProperties->SetFileName(storedFile.szFileName);
+        pFileProperties->SetHashMD5(storedFile.szHashMD5);
+        pFileProperties->SetFileSize(storedFile.l64FileSize);
+        pFileProperties->SetLastModifiedDate(storedFile.tmCreated);
+        pFileProperties->SetLastAccess(storedFile.tmLastAccess);
+        pFileProperties->SetIsDeleted(storedFile.bDeleted);
+        pFileProperties->SetIsCompleted(bCompleted);
+
+        pListFileProperties->AddFilePropertyEntry(pFileProperties);
+    }
+
+    return SOAP_OK;
+
+} // End SearchFiles
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Rename a stored file.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::RenameFile(std::string szSessionToken, LONG64 l64FileID,
+                                std::string szNewFileName)
+{
+    if (false == MockService::Instance()->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(l64FileID, storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    storedFile.szFileName = szNewFileName;
+    MockService::Instance()->UpdateFile(storedFile, true);
+
+    return SOAP_OK;
+
+} // End RenameFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Mark a stored file deleted - the data is kept for undelete.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::DeleteFile(std::string szSessionToken, LONG64 l64FileID)
+{
+    if (false == MockService::Instance()->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(l64FileID, storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    storedFile.bDeleted = true;
+    MockService::Instance()->UpdateFile(storedFile, true);
+
+    return SOAP_OK;
+
+} // End DeleteFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Undelete a stored file.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::UndeleteFile(std::string szSessionToken, LONG64 l64FileID)
+{
+    if (false == MockService::Instance()->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(l64FileID, storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    storedFile.bDeleted = false;
+    MockService::Instance()->UpdateFile(storedFile, true);
+
+    return SOAP_OK;
+
+} // End UndeleteFile
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Create a metadata entry - sets the new metadata ID.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::CreateMetaData(std::string szSessionToken, MetaDataInfoImpl* pMetaDataInfo)
+{
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    pMetaDataInfo->SetMetaDataID(pMockService->AddMetaData(pMetaDataInfo->GetMetaDataName(),
+                                                           pMetaDataInfo->GetMetaDataValue()));
+    return SOAP_OK;
+
+} // End CreateMetaData
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Create a metadata entry and add it to a stored file - sets
+//!        the new metadata ID.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::CreateFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                                        MetaDataInfoImpl* pMetaDataInfo)
+{
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(l64FileID, storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    int nMetaDataID = pMockService->AddMetaData(pMetaDataInfo->GetMetaDataName(),
+                                                pMetaDataInfo->GetMetaDataValue());
+    pMetaDataInfo->SetMetaDataID(nMetaDataID);
+
+    storedFile.listMetaDataIDs.push_back(nMetaDataID);
+    pMockService->UpdateFile(storedFile, true);
+
+    return SOAP_OK;
+
+} // End CreateFileMetaData
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Add an existing metadata entry to a stored file.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::SetFileMetaData(std::string szSessionToken, LONG64 l64FileID, int nMetaDataID)
+{
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(l64FileID, storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    MockMetaData metaData;
+    if (false == pMockService->GetMetaData(nMetaDataID, metaData)) {
+        m_szErrorMsg = _format(_T("Metadata ID %d not found."), nMetaDataID);
+        return SOAP_FAULT;
+    }
+
+    for (int nIndex = 0; nIndex < (int)storedFile.listMetaDataIDs.size(); nIndex++) {
+        if (storedFile.listMetaDataIDs[nIndex] == nMetaDataID) {
+            return SOAP_OK;
+        }
+    }
+
+    storedFile.listMetaDataIDs.push_back(nMetaDataID);
+    pMockService->UpdateFile(storedFile, true);
+
+    return SOAP_OK;
+
+} // End SetFileMetaData
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Remove a metadata entry from a stored file.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::DeleteFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                                        int nMetaDataID)
+{
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(l64FileID, storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    std::vector<int>::iterator iter = storedFile.listMetaDataIDs.begin();
+    while (iter != storedFile.listMetaDataIDs.end()) {
+        if (*iter == nMetaDataID) {
+            storedFile.listMetaDataIDs.erase(iter);
+            pMockService->UpdateFile(storedFile, true);
+            return SOAP_OK;
+        }
+        iter++;
+    }
+
+    m_szErrorMsg = _format(_T("Metadata ID %d not found."), nMetaDataID);
+    return SOAP_FAULT;
+
+} // End DeleteFileMetaData
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Metadata of a stored file.
+//! \return SOAP_OK if successful, SOAP_FAULT otherwise.
+int MockFileManager::GetFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                                     MetaDataListImpl* pListMetaData)
+{
+    MockService* pMockService = MockService::Instance();
+
+    if (false == pMockService->BeginRequest(szSessionToken, m_szErrorMsg)) {
+        return SOAP_FAULT;
+    }
+
+    MockStoredFile storedFile;
+    int nResult = GetStoredFile(l64FileID, storedFile);
+    if (nResult != SOAP_OK) {
+        return nResult;
+    }
+
+    for (int nIndex = 0; nIndex < (int)storedFile.listMetaDataIDs.size(); nIndex++) {
+        MockMetaData metaData;
+        if (false == pMockService->GetMetaData(storedFile.listMetaDataIDs[nIndex], metaData)) {
+            continue;
+        }
+
+        MetaDataInfoImpl* pMetaDataInfo = new MetaDataInfoImpl;
+        pMetaDataInfo->SetMetaDataID(metaData.nMetaDataID);
+        pMetaDataInfo->SetMetaDataName(metaData.szName);
+        pMetaDataInfo->SetMetaDataValue(metaData.szValue);
+        pMetaDataInfo->SetCreatedDate(metaData.tmCreated);
+
+        pListMetaData->AddMetaDataInfo(pMetaDataInfo);
+    }
+
+    return SOAP_OK;
+
+} // End GetFileMetaData
+
+/** @} */
@@ -0,0 +1,313 @@
+/*********************************************************************
+ *
+ *  file:  MockService.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Local mock of the storage and transfer services - login,
+ *          create, upload, download, search, and metadata against a
+ *          local directory, with configurable latency, bandwidth and
+ *          failures.  Used to measure client throughput offline.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __MOCK_SERVICE_H__
+#define __MOCK_SERVICE_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+#include "../Util/CriticalSection.h"
+#include "../Util/BandwidthLimiter.h"
+#include "IDiomedeLib.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+//---------------------------------------------------------------------
+//! Session tokens handed out by the mock start with this prefix -
+//! any other token is rejected as an invalid session.
+//---------------------------------------------------------------------
+#define MOCK_SESSION_PREFIX             _T("mock-")
+
+//---------------------------------------------------------------------
+//! Chunk size used when the upload doesn't set one, and the index
+//! file name and version.
+//---------------------------------------------------------------------
+#define MOCK_DEFAULT_CHUNK_SIZE         1048576
+#define MOCK_INDEX_FILE                 _T("mockindex.txt")
+#define MOCK_INDEX_FILE_VER             1
+
+///////////////////////////////////////////////////////////////////////
+//! \struct MockMetaData
+//! \brief Metadata entry of the mock store.
+struct MockMetaData
+{
+    int                         nMetaDataID;
+    std::string                 szName;
+    std::string                 szValue;
+    time_t                      tmCreated;
+};
+
+///////////////////////////////////////////////////////////////////////
+//! \struct MockStoredFile
+//! \brief File of the mock store - the data is kept in
+//!        <mock directory>/<file ID>.dat.
+struct MockStoredFile
+{
+    LONG64                      l64FileID;
+    std::string                 szFileName;
+    std::string                 szHashMD5;
+    LONG64                      l64FileSize;                    //! Expected size
+    LONG64                      l64StoredBytes;                 //! Received so far
+    time_t                      tmCreated;
+    time_t                      tmLastAccess;
+    bool                        bDeleted;
+    std::vector<int>            listMetaDataIDs;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// MockService Class
+//
+// Usage:
+//      MockService::Instance()->LoadSettings();            // Startup
+//
+//      // Task - instead of the SDK file manager:
+//      if (MockService::Instance()->IsEnabled()) {
+//          MockFileManager mockFileManager;
+//          nResult = mockFileManager.Upload(szSessionToken, pUpload);
+//      }
+//
+// Holds the settings and the store shared by the mock managers.
+// Every request waits for the latency and may fail with one of the
+// configured errors; transfers then pay the latency again per chunk
+// and share the mock link bandwidth, and each chunk may fail.  Error
+// messages use the service error text, so the retry and resume paths
+// behave as they would against the service.
+
+class MockService
+{
+protected:
+    static MockService*         m_pMockService;
+
+private:
+    volatile bool               m_bEnabled;
+
+    //-----------------------------------------------------------------
+    //! Guarded by m_lock.
+    //-----------------------------------------------------------------
+    std::string                 m_szStoreDir;
+    int                         m_nLatency;                     //! Milliseconds
+    LONG64                      m_l64Bandwidth;                 //! Bytes per second
+    int                         m_nFailureRate;                 //! Percent
+    std::vector<std::string>    m_listFailureErrors;
+
+    std::map<LONG64, MockStoredFile>    m_mapFiles;
+    std::map<int, MockMetaData>         m_mapMetaData;
+    LONG64                      m_l64NextFileID;
+    int                         m_nNextMetaDataID;
+
+    TokenBucket                 m_linkBucket;
+    unsigned int                m_nRandomState;
+
+    DIOMEDE_CRITICAL::CCriticalSection  m_lock;
+
+public:
+    static MockService* Instance();
+    virtual ~MockService();
+
+	// Cleanup the mock service.
+	void Shutdown();
+
+private:
+    MockService();
+
+    // Not implemented
+    MockService(const MockService&);
+    MockService& operator=(const MockService&);
+
+    unsigned int GetRandom(unsigned int nRange);
+    bool LoadIndex();
+    bool SaveIndex();
+
+public:
+	//-----------------------------------------------------------------
+	//! \brief Read the settings from the user profile and load the
+	//!        store index when the mock is enabled.
+	//! \param szStoreDir: store to use instead of the profile setting -
+	//!        enables the mock regardless of the profile (benchmark).
+	//-----------------------------------------------------------------
+    void LoadSettings(const std::string& szStoreDir=_T(""));
+    bool IsEnabled() { return m_bEnabled; }
+
+	//-----------------------------------------------------------------
+	//! \brief Directory of the mock store, with the trailing separator.
+	//-----------------------------------------------------------------
+    std::string GetStoreDir();
+
+	//-----------------------------------------------------------------
+	//! \name Used by the mock managers.
+	//! @{
+	//-----------------------------------------------------------------
+
+	//-----------------------------------------------------------------
+	//! \brief Wait for the latency, then check the session and inject
+	//!        a failure.
+	//! \param szSessionToken: session token, empty to skip the check.
+	//! \param szErrorMsg: set to the error on failure.
+	//! \return true if the request can continue, false otherwise.
+	//-----------------------------------------------------------------
+    bool BeginRequest(const std::string& szSessionToken, std::string& szErrorMsg);
+
+	//-----------------------------------------------------------------
+	//! \brief Wait for the latency and the link to carry a chunk, then
+	//!        inject a failure.
+	//! \return true if the chunk was carried, false otherwise.
+	//-----------------------------------------------------------------
+    bool TransferChunk(LONG64 l64Bytes, std::string& szErrorMsg);
+
+    std::string NewSessionToken();
+    std::string GetDataFileName(LONG64 l64FileID);
+
+    bool GetFile(LONG64 l64FileID, MockStoredFile& storedFile);
+    LONG64 AddFile(const std::string& szFileName, LONG64 l64FileSize);
+    void UpdateFile(const MockStoredFile& storedFile, bool bSave);
+    void GetFiles(std::vector<MockStoredFile>& listFiles);
+    void ClearStore(bool bRemoveStoreDir=false);
+
+    int AddMetaData(const std::string& szName, const std::string& szValue);
+    bool GetMetaData(int nMetaDataID, MockMetaData& metaData);
+	//! @}
+};
+
+///////////////////////////////////////////////////////////////////////
+//! \class ServiceUserManager
+//! \brief The user requests the mock can serve - made on the mock
+//!        when it's enabled, on the SDK user manager otherwise.
+class ServiceUserManager
+{
+public:
+    virtual ~ServiceUserManager() {};
+
+    virtual std::string GetErrorMsg() = 0;
+
+    virtual int LoginUser(std::string szUsername, std::string szPassword,
+                          std::string& szSessionToken) = 0;
+    virtual int LogoutUser(std::string szSessionToken) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////
+//! \class ServiceFileManager
+//! \brief The file, transfer, search and metadata requests the mock
+//!        can serve - made on the mock when it's enabled, on the SDK
+//!        file manager otherwise.
+class ServiceFileManager
+{
+public:
+    virtual ~ServiceFileManager() {};
+
+    virtual std::string GetErrorMsg() = 0;
+
+	//-----------------------------------------------------------------
+	//! \brief Stop the transfer in progress.
+	//-----------------------------------------------------------------
+    virtual void CancelTask() = 0;
+
+    virtual int CreateFile(std::string szSessionToken, UploadImpl* pUpload) = 0;
+    virtual int Upload(std::string szSessionToken, UploadImpl* pUpload) = 0;
+    virtual int Download(std::string szSessionToken, DownloadImpl* pDownload) = 0;
+
+    virtual int SearchFiles(std::string szSessionToken, SearchFileFilterImpl* pSearchFilter,
+                            FilePropertiesListImpl* pListFileProperties) = 0;
+
+    virtual int RenameFile(std::string szSessionToken, LONG64 l64FileID,
+                           std::string szNewFileName) = 0;
+    virtual int DeleteFile(std::string szSessionToken, LONG64 l64FileID) = 0;
+    virtual int UndeleteFile(std::string szSessionToken, LONG64 l64FileID) = 0;
+
+    virtual int CreateMetaData(std::string szSessionToken, MetaDataInfoImpl* pMetaDataInfo) = 0;
+    virtual int CreateFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                                   MetaDataInfoImpl* pMetaDataInfo) = 0;
+    virtual int SetFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                                int nMetaDataID) = 0;
+    virtual int DeleteFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                                   int nMetaDataID) = 0;
+    virtual int GetFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                                MetaDataListImpl* pListMetaData) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////
+//! \class MockUserManager
+//! \brief Stands in for DIOMEDE::UserManager - any user name and
+//!        password logs in.
+class MockUserManager : public ServiceUserManager
+{
+private:
+    std::string                 m_szErrorMsg;
+
+public:
+    MockUserManager() : m_szErrorMsg(_T("")) {};
+    virtual ~MockUserManager() {};
+
+    std::string GetErrorMsg() { return m_szErrorMsg; }
+
+    int LoginUser(std::string szUsername, std::string szPassword,
+                  std::string& szSessionToken);
+    int LogoutUser(std::string szSessionToken);
+};
+
+///////////////////////////////////////////////////////////////////////
+//! \class MockFileManager
+//! \brief Stands in for DIOMEDE::FileManager for the file, transfer,
+//!        search and metadata requests.  The calls match those made
+//!        on the SDK file manager.
+class MockFileManager : public ServiceFileManager
+{
+private:
+    std::string                 m_szErrorMsg;
+    volatile bool               m_bCancel;
+
+public:
+    MockFileManager() : m_szErrorMsg(_T("")), m_bCancel(false) {};
+    virtual ~MockFileManager() {};
+
+    std::string GetErrorMsg() { return m_szErrorMsg; }
+
+	//-----------------------------------------------------------------
+	//! \brief Stop the transfer in progress after the current chunk.
+	//-----------------------------------------------------------------
+    void CancelTask() { m_bCancel = true; }
+
+    int CreateFile(std::string szSessionToken, UploadImpl* pUpload);
+    int Upload(std::string szSessionToken, UploadImpl* pUpload);
+    int Download(std::string szSessionToken, DownloadImpl* pDownload);
+
+    int SearchFiles(std::string szSessionToken, SearchFileFilterImpl* pSearchFilter,
+                    FilePropertiesListImpl* pListFileProperties);
+
+    int RenameFile(std::string szSessionToken, LONG64 l64FileID, std::string szNewFileName);
+    int DeleteFile(std::string szSessionToken, LONG64 l64FileID);
+    int UndeleteFile(std::string szSessionToken, LONG64 l64FileID);
+
+    int CreateMetaData(std::string szSessionToken, MetaDataInfoImpl* pMetaDataInfo);
+    int CreateFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                           MetaDataInfoImpl* pMetaDataInfo);
+    int SetFileMetaData(std::string szSessionToken, LONG64 l64FileID, int nMetaDataID);
+    int DeleteFileMetaData(std::string szSessionToken, LONG64 l64FileID, int nMetaDataID);
+    int GetFileMetaData(std::string szSessionToken, LONG64 l64FileID,
+                        MetaDataListImpl* pListMetaData);
+
+private:
+    int GetStoredFile(LONG64 l64FileID, MockStoredFile& storedFile);
+};
+
+#endif // __MOCK_SERVICE_H__
+
+/** @} */
@@ -23,6 +23,7 @@
 
 #include "../Util/Util.h"
 #include "../Util/ClientLog.h"
+#include "../Util/Crc32Util.h"
 #include "../Include/ErrorCodes/UIErrors.h"
 
 #include "UserProfileData.h"
@@ -85,7 +86,11 @@ ResumeUploadInfoData::ResumeUploadInfoData() : ResumeInfoData(resumeUploads),
                                                m_bAddMetaData(false),
                                                m_bCreateMD5Digest(false),
                                                m_tmLastModifiedTime(0),
-                                               m_l64BytesRead(0)
+                                               m_l64BytesRead(0),
+                                               m_l64SegmentSize(0),
+                                               m_nFingerprintVerifyType(-1),
+                                               m_bFingerprintsDisabled(false),
+                                               m_bLegacyRecord(false)
 {
 
 } // End constructor
@@ -95,7 +100,11 @@ ResumeUploadInfoData::ResumeUploadInfoData() : ResumeInfoData(resumeUploads),
 //! \param szSerilizedData: searialized resume upload data
 //
 ResumeUploadInfoData::ResumeUploadInfoData(const std::string szSerilizedData)
-                                           : ResumeInfoData(resumeUploads)
+                                           : ResumeInfoData(resumeUploads),
+                                             m_l64SegmentSize(0),
+                                             m_nFingerprintVerifyType(-1),
+                                             m_bFingerprintsDisabled(false),
+                                             m_bLegacyRecord(false)
 {
 	Deserialize(szSerilizedData);
 
@@ -115,6 +124,13 @@ void ResumeUploadInfoData::operator =( const ResumeUploadInfoData &srcResumeInfo
 	m_tmLastModifiedTime	= srcResumeInfo.m_tmLastModifiedTime;
 	m_l64BytesRead			= srcResumeInfo.m_l64BytesRead;
 
+	m_l64SegmentSize        = srcResumeInfo.m_l64SegmentSize;
+	m_listWindowCrc         = srcResumeInfo.m_listWindowCrc;
+	m_listSegmentCrc        = srcResumeInfo.m_listSegmentCrc;
+	m_nFingerprintVerifyType= srcResumeInfo.m_nFingerprintVerifyType;
+	m_bFingerprintsDisabled = srcResumeInfo.m_bFingerprintsDisabled;
+	m_bLegacyRecord         = srcResumeInfo.m_bLegacyRecord;
+
 } // End assignment operator
 
 ///////////////////////////////////////////////////////////////////////
@@ -172,6 +188,44 @@ bool ResumeUploadInfoData::Deserialize( std::vector<std::string> listResumeData,
 	m_tmFirstStart		= atol(listResumeData[nIndex++].c_str());
 	m_tmLastStart		= atol(listResumeData[nIndex++].c_str());
 
+	ResetFingerprints();
+
+	// Records written before fingerprints were added end here - the
+	// record has no room for them, so none are kept.  Neither are they
+	// for records with whole segment CRCs only, whose last field is a
+	// single CRC.
+	size_t nCrcsWidth = RESUME_FINGERPRINT_SEGMENTS * RESUME_CRC_WIDTH;
+
+	m_bLegacyRecord = (listResumeData.size() <= nIndex + 3) ||
+	                  (listResumeData[nIndex + 2].length() != nCrcsWidth);
+	if (m_bLegacyRecord) {
+	    m_bFingerprintsDisabled = true;
+	    return true;
+	}
+
+	// The fields are padded to their full width - the numbers stop at
+	// the pad.
+	m_l64SegmentSize    = atoi64(listResumeData[nIndex++].c_str());
+
+	for (int nList = 0; nList < 2; nList++) {
+	    std::vector<unsigned int>& listCrc = (nList == 0) ? m_listWindowCrc : m_listSegmentCrc;
+	    std::string szCrcs = listResumeData[nIndex++];
+
+	    for (size_t nPos = 0; nPos + RESUME_CRC_WIDTH <= szCrcs.length();
+	         nPos += RESUME_CRC_WIDTH) {
+	        if (szCrcs[nPos] == *RESUME_PAD.c_str()) {
+	            break;
+	        }
+	        listCrc.push_back((unsigned int)strtoul(
+	            szCrcs.substr(nPos, RESUME_CRC_WIDTH).c_str(), NULL, 16));
+	    }
+	}
+
+	// The fingerprints were written along with the bytes read.
+	if ( (m_l64SegmentSize == 0) && (m_l64BytesRead > 0) ) {
+	    m_bFingerprintsDisabled = true;
+	}
+
 	return true;
 
 } // End Deserialize
@@ -226,6 +280,27 @@ std::string ResumeUploadInfoData::Serialize(bool bEncrypt, unsigned long i1, uns
 	StringUtil::AppendIntToString(szOutput, (long)m_tmFirstStart, *DATUM_SEP.c_str());
 	StringUtil::AppendIntToString(szOutput, (long)m_tmLastStart, *DATUM_SEP.c_str());
 
+	// Fingerprints - the record is rewritten in place as the upload
+	// progresses, so each field is padded to its full width.
+	if (m_bLegacyRecord == false) {
+	    int nSegmentSizeLen = StringUtil::AppendIntToString(szOutput, m_l64SegmentSize, 0);
+	    szPadStr = StringUtil::GetPadStr(RESUME_SEGMENT_SIZE_WIDTH - nSegmentSizeLen, RESUME_PAD);
+	    szOutput.append(szPadStr + *DATUM_SEP.c_str());
+
+	    char szCrc[RESUME_CRC_WIDTH + 1];
+	    for (int nList = 0; nList < 2; nList++) {
+	        std::vector<unsigned int>& listCrc = (nList == 0) ? m_listWindowCrc : m_listSegmentCrc;
+
+	        for (size_t nSegment = 0; nSegment < listCrc.size(); nSegment++) {
+	            sprintf(szCrc, _T("%08X"), listCrc[nSegment]);
+	            szOutput.append(szCrc);
+	        }
+	        szPadStr = StringUtil::GetPadStr((int)(RESUME_FINGERPRINT_SEGMENTS - listCrc.size()) *
+	                                         RESUME_CRC_WIDTH, RESUME_PAD);
+	        szOutput.append(szPadStr + *DATUM_SEP.c_str());
+	    }
+	}
+
 	if (bEncrypt) {
 		szOutput = StringUtil::EncryptString(i1, i2, szOutput);
 	}
@@ -304,25 +379,267 @@ bool ResumeUploadInfoData::Deserialize(const std::string szSerializedData, bool
 } // End Deserialize
 
 ///////////////////////////////////////////////////////////////////////
-// \brief Has the file changed since the last time?
-//! \return Returns true if the last modified dates are different,
-//!         false otherwise.
+// \brief Has the file changed since the last time?  When fingerprints
+//!        are available, the part of the file uploaded thus far is
+//!        checked against them - the last modified time is only used
+//!        for uploads without fingerprints.
+//! \return Returns true if the file has changed, false otherwise.
 bool ResumeUploadInfoData::HasResumeFileChanged()
 {
-    time_t tmLastModified;
-    int nResult = Util::GetFileLastModifiedTime(m_szFilePath.c_str(), tmLastModified);
-    if (tmLastModified != m_tmLastModifiedTime) {
+    LONG64 l64FileSize = Util::GetFileLength64(m_szFilePath.c_str());
+    if (l64FileSize != m_l64FileSize) {
         return true;
     }
 
-    LONG64 l64FileSize = Util::GetFileLength64(m_szFilePath.c_str());
-    if (l64FileSize != m_l64FileSize) {
+    time_t tmLastModified = 0;
+    int nResult = Util::GetFileLastModifiedTime(m_szFilePath.c_str(), tmLastModified);
+
+    ResumeVerifyType nVerifyType = GetResumeVerifyType();
+
+    if ( (nVerifyType == resumeVerifyNone) || (HasFingerprints() == false) ) {
+        return (tmLastModified != m_tmLastModifiedTime);
+    }
+
+    if (VerifyFingerprints(nVerifyType == resumeVerifyFull) == false) {
+        ClientLog(UI_COMP, LOG_WARNING, false,
+            _T("Resume: uploaded data for %s no longer matches the file."), m_szFilePath.c_str());
         return true;
     }
 
+    // The uploaded data is unchanged - a restored or touched time stamp
+    // is taken as the new last modified time.
+    if (nResult != -1) {
+        m_tmLastModifiedTime = tmLastModified;
+    }
+
 	return false;
 
-} // End Deserialize
+} // End HasResumeFileChanged
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Are fingerprints available for all of the bytes uploaded?
+//! \return true if the fingerprints cover the bytes read, false otherwise.
+bool ResumeUploadInfoData::HasFingerprints()
+{
+    return ( (m_bFingerprintsDisabled == false) && (m_l64SegmentSize > 0) &&
+             (m_listWindowCrc.size() > 0) &&
+             ((int)m_listWindowCrc.size() == GetUploadedWindows()) );
+
+} // End HasFingerprints
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Segments whose window has been uploaded thus far.
+//! \return the number of windows, 0 before the segment size is set.
+int ResumeUploadInfoData::GetUploadedWindows()
+{
+    if ( (m_l64SegmentSize <= 0) || (m_l64BytesRead < RESUME_WINDOW_SIZE) ) {
+        return 0;
+    }
+
+    LONG64 l64Windows = ((m_l64BytesRead - RESUME_WINDOW_SIZE) / m_l64SegmentSize) + 1;
+    return (l64Windows > RESUME_FINGERPRINT_SEGMENTS) ? RESUME_FINGERPRINT_SEGMENTS :
+                                                       (int)l64Windows;
+
+} // End GetUploadedWindows
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Segments uploaded completely thus far.
+//! \return the number of segments, 0 before the segment size is set.
+int ResumeUploadInfoData::GetCompleteSegments()
+{
+    if (m_l64SegmentSize <= 0) {
+        return 0;
+    }
+
+    LONG64 l64Segments = m_l64BytesRead / m_l64SegmentSize;
+    return (l64Segments > RESUME_FINGERPRINT_SEGMENTS) ? RESUME_FINGERPRINT_SEGMENTS :
+                                                        (int)l64Segments;
+
+} // End GetCompleteSegments
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Clear the fingerprints.
+//
+void ResumeUploadInfoData::ResetFingerprints()
+{
+    m_l64SegmentSize = 0;
+    m_listWindowCrc.clear();
+    m_listSegmentCrc.clear();
+
+} // End ResetFingerprints
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Extend the fingerprints to cover the bytes uploaded thus
+//!        far.  The file is only read once a window, or with
+//!        ResumeVerify full a segment, has been uploaded completely -
+//!        most send complete callbacks read nothing.
+//
+void ResumeUploadInfoData::UpdateFingerprints()
+{
+    if (m_bFingerprintsDisabled) {
+        return;
+    }
+
+    // The upload restarted - start over.
+    if ( ((int)m_listWindowCrc.size() > GetUploadedWindows()) ||
+         ((int)m_listSegmentCrc.size() > GetCompleteSegments()) ) {
+        ResetFingerprints();
+    }
+
+    //-----------------------------------------------------------------
+    // Segment size: the file is covered by at most
+    // RESUME_FINGERPRINT_SEGMENTS segments.
+    //-----------------------------------------------------------------
+    if (m_l64SegmentSize == 0) {
+        if (m_l64FileSize <= 0) {
+            m_bFingerprintsDisabled = true;
+            return;
+        }
+
+        LONG64 l64SegmentSize = (m_l64FileSize + RESUME_FINGERPRINT_SEGMENTS - 1) /
+                                RESUME_FINGERPRINT_SEGMENTS;
+        if (l64SegmentSize < RESUME_MIN_SEGMENT_SIZE) {
+            l64SegmentSize = RESUME_MIN_SEGMENT_SIZE;
+        }
+        m_l64SegmentSize = ((l64SegmentSize + RESUME_SEGMENT_ALIGNMENT - 1) /
+                           RESUME_SEGMENT_ALIGNMENT) * RESUME_SEGMENT_ALIGNMENT;
+    }
+
+    int nWindows = GetUploadedWindows();
+    int nSegments = GetCompleteSegments();
+
+    if (m_nFingerprintVerifyType < 0) {
+        m_nFingerprintVerifyType = (int)GetResumeVerifyType();
+    }
+
+    // Whole segment CRCs are only kept for full verification.
+    if (m_nFingerprintVerifyType != resumeVerifyFull) {
+        nSegments = (int)m_listSegmentCrc.size();
+    }
+
+    if ( ((int)m_listWindowCrc.size() == nWindows) &&
+         ((int)m_listSegmentCrc.size() == nSegments) ) {
+        return;
+    }
+
+    FILE* pFile = fopen(m_szFilePath.c_str(), _T("rb"));
+    bool bSuccess = (pFile != NULL);
+
+    while ( bSuccess && ((int)m_listWindowCrc.size() < nWindows) ) {
+        unsigned int nCrc = 0;
+        bSuccess = Crc32Util::FileRange(pFile, m_listWindowCrc.size() * m_l64SegmentSize,
+                                        RESUME_WINDOW_SIZE, nCrc);
+        if (bSuccess) {
+            m_listWindowCrc.push_back(nCrc);
+        }
+    }
+
+    // A complete segment's window is already summed - the rest of the
+    // segment extends it.
+    while ( bSuccess && ((int)m_listSegmentCrc.size() < nSegments) ) {
+        LONG64 l64Start = m_listSegmentCrc.size() * m_l64SegmentSize;
+        unsigned int nCrc = m_listWindowCrc[m_listSegmentCrc.size()];
+
+        bSuccess = Crc32Util::FileRange(pFile, l64Start + RESUME_WINDOW_SIZE,
+                                        m_l64SegmentSize - RESUME_WINDOW_SIZE, nCrc);
+        if (bSuccess) {
+            m_listSegmentCrc.push_back(nCrc);
+        }
+    }
+
+    if (pFile) {
+        fclose(pFile);
+    }
+
+    // Without fingerprints, resume falls back to the last modified time.
+    if (bSuccess == false) {
+        ClientLog(UI_COMP, LOG_WARNING, false,
+            _T("Resume: fingerprints for %s could not be updated."), m_szFilePath.c_str());
+        ResetFingerprints();
+        m_bFingerprintsDisabled = true;
+    }
+
+} // End UpdateFingerprints
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Check the part of the file uploaded thus far against the
+//!        fingerprints.
+//! \param bFull: true to check every complete segment - when their
+//!              CRCs were kept - and every window past them, false to
+//!              check the windows of the first and last segments and
+//!              RESUME_SAMPLED_SEGMENTS between.
+//! \return true if the data matches, false otherwise.
+bool ResumeUploadInfoData::VerifyFingerprints(bool bFull)
+{
+    FILE* pFile = fopen(m_szFilePath.c_str(), _T("rb"));
+    if (pFile == NULL) {
+        return false;
+    }
+
+    bool bMatch = true;
+    int nFirstWindow = 0;
+
+    if ( bFull && ((int)m_listSegmentCrc.size() == GetCompleteSegments()) ) {
+        for (int nSegment = 0; bMatch && (nSegment < (int)m_listSegmentCrc.size()); nSegment++) {
+            unsigned int nCrc = 0;
+            bMatch = Crc32Util::FileRange(pFile, nSegment * m_l64SegmentSize, m_l64SegmentSize,
+                                          nCrc) &&
+                     (nCrc == m_listSegmentCrc[nSegment]);
+        }
+
+        nFirstWindow = (int)m_listSegmentCrc.size();
+    }
+
+    //-----------------------------------------------------------------
+    // Windows not covered above - all of them, or sampled evenly from
+    // the first to the last.
+    //-----------------------------------------------------------------
+    int nWindows = (int)m_listWindowCrc.size() - nFirstWindow;
+
+    int nChecks = nWindows;
+    if ( (bFull == false) && (nWindows > RESUME_SAMPLED_SEGMENTS + 2) ) {
+        nChecks = RESUME_SAMPLED_SEGMENTS + 2;
+    }
+
+    for (int nCheck = 0; bMatch && (nCheck < nChecks); nCheck++) {
+        int nWindow = nFirstWindow + nCheck;
+        if (nChecks < nWindows) {
+            nWindow = nFirstWindow + (nCheck * (nWindows - 1)) / (nChecks - 1);
+        }
+
+        unsigned int nCrc = 0;
+        bMatch = Crc32Util::FileRange(pFile, nWindow * m_l64SegmentSize, RESUME_WINDOW_SIZE, nCrc) &&
+                 (nCrc == m_listWindowCrc[nWindow]);
+    }
+
+    fclose(pFile);
+    return bMatch;
+
+} // End VerifyFingerprints
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Verification setting from the configuration file.
+//! \return the verification type, sampled if not set.
+ResumeVerifyType ResumeUploadInfoData::GetResumeVerifyType()
+{
+    std::string szVerify = GEN_RESUME_VERIFY_DF;
+
+    UserProfileData* pProfileData =
+        ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
+    if (pProfileData) {
+        szVerify = pProfileData->GetUserProfileStr(GEN_RESUME_VERIFY, GEN_RESUME_VERIFY_DF);
+    }
+
+    if (0 == stricmp(szVerify.c_str(), _T("none"))) {
+        return resumeVerifyNone;
+    }
+    if (0 == stricmp(szVerify.c_str(), _T("full"))) {
+        return resumeVerifyFull;
+    }
+
+    return resumeVerifySampled;
+
+} // End GetResumeVerifyType
 
 ///////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////
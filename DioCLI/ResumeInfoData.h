@@ -22,6 +22,7 @@
 #include "StringUtil.h"
 
 #include <string>
+#include <vector>
 #ifdef WIN32
 #include <io.h>
 #endif
@@ -40,23 +41,33 @@ namespace ResumeInfoTypes {
                  } ResumeInfoType;
 }
 
+//! Retry delays are scheduled by RetryPolicy - the interval type is
+//! kept in the resume data to mark completed entries.
 namespace ResumeInfoIntervalTypes {
     typedef enum { resumeIntervalUndefined = 0,
-                   resumeInterval1,                     //! Defaults to 5 seconds.
-                   resumeInterval2,                     //! Defaults to 30 seconds.
-                   resumeInterval3,                     //! Defaults to 5 minutes.
-                   resumeInterval4,                     //! Defaults to 10 seconds.
-                   resumeInterval5,                     //! Defaults to 1 hour.
+                   resumeInterval1,
+                   resumeInterval2,
+                   resumeInterval3,
+                   resumeInterval4,
+                   resumeInterval5,
                    resumeIntervalDone
                  } ResumeInfoIntervalType;
 }
 
+namespace ResumeVerifyTypes {
+    typedef enum { resumeVerifyNone = 0,                //! Last modified time only
+                   resumeVerifySampled,                 //! Windows of a few segments
+                   resumeVerifyFull                     //! Every segment
+                 } ResumeVerifyType;
+}
+
 //---------------------------------------------------------------------
 //---------------------------------------------------------------------
 
 using namespace StringUtil;
 using namespace ResumeInfoTypes;
 using namespace ResumeInfoIntervalTypes;
+using namespace ResumeVerifyTypes;
 
 using namespace boost::posix_time;
 using namespace boost::gregorian;
@@ -66,6 +77,21 @@ const std::string DATUM_SEP     = _T("|");
 const std::string VERSION_ID	= _T("2");
 const std::string RESUME_PAD    = _T("*");
 
+//---------------------------------------------------------------------
+// Resume fingerprints: the uploaded part of a file is split into at
+// most RESUME_FINGERPRINT_SEGMENTS segments.  Each segment has the
+// CRC32 of its first RESUME_WINDOW_SIZE bytes, and - with ResumeVerify
+// full - of the whole segment.  Records are rewritten in place, so the
+// fingerprint fields are always serialized at their full width.
+//---------------------------------------------------------------------
+#define RESUME_FINGERPRINT_SEGMENTS     32
+#define RESUME_MIN_SEGMENT_SIZE         1048576
+#define RESUME_SEGMENT_ALIGNMENT        65536
+#define RESUME_WINDOW_SIZE              65536
+#define RESUME_SAMPLED_SEGMENTS         4
+#define RESUME_SEGMENT_SIZE_WIDTH       20
+#define RESUME_CRC_WIDTH                8
+
 ///////////////////////////////////////////////////////////////////////
 // ResumeInfoData
 class ResumeInfoData
@@ -216,6 +242,9 @@ public:
 //! -# time of first attempt (to retain order)
 //! -# time of last attempt
 //! -# time of next attempt
+//! -# fingerprint segment size
+//! -# CRC32 of the window at the start of each segment uploaded thus far
+//! -# CRC32 of each complete segment uploaded thus far (ResumeVerify full)
 class ResumeUploadInfoData : public ResumeInfoData
 {
 private:
@@ -228,9 +257,28 @@ private:
 
     LONG64                      m_l64BytesRead;                 //! Bytes uploaded thus far
 
+    LONG64                      m_l64SegmentSize;               //! Fingerprint segment size, 0 if
+                                                                //! not yet started.
+    std::vector<unsigned int>   m_listWindowCrc;                //! CRC32 of the window at the start
+                                                                //! of each segment.
+    std::vector<unsigned int>   m_listSegmentCrc;               //! CRC32 of each complete segment,
+                                                                //! with ResumeVerify full.
+    int                         m_nFingerprintVerifyType;       //! ResumeVerify the fingerprints
+                                                                //! are kept for, -1 until read
+                                                                //! (not serialized).
+    bool                        m_bFingerprintsDisabled;        //! Fingerprints can't be kept for
+                                                                //! this upload (not serialized).
+    bool                        m_bLegacyRecord;                //! Record read without fingerprint
+                                                                //! fields - none are written.
+
 protected:
 	virtual bool Deserialize( std::vector<std::string>listResumeData, unsigned int nStartIndex );
 
+    void ResetFingerprints();
+    bool VerifyFingerprints(bool bFull);
+    int GetUploadedWindows();
+    int GetCompleteSegments();
+
 public:
     ResumeUploadInfoData(void);
     ResumeUploadInfoData(const std::string szSerializedData);
@@ -247,6 +295,17 @@ public:
     //! Has the file changed since the last time?
     bool HasResumeFileChanged();
 
+    //! Extend the fingerprints to cover the bytes uploaded thus far - the
+    //! file is read once a window or, with ResumeVerify full, a segment
+    //! is complete.
+    void UpdateFingerprints();
+
+    //! Are fingerprints available for all of the bytes uploaded?
+    bool HasFingerprints();
+
+    //! Verification setting from the configuration file.
+    static ResumeVerifyType GetResumeVerifyType();
+
     //-----------------------------------------------------------------
     // Getters and setters
     //-----------------------------------------------------------------
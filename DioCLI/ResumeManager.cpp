@@ -59,6 +59,9 @@ using namespace DiomedeResumeErrorCodes;
 using namespace boost::algorithm;
 using namespace boost::posix_time;
 
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
 // Used to place interprocess mutexes around writing
 // the files - added to prevent errors that can occur
 // when multiple instances of DioCLI are running.
@@ -493,7 +496,7 @@ int ResumeManager::ReadResumeIndex( std::string szResumeFileName )
         }
         else {
             m_listResumeIndexInfo.push_back(resumeIndexInfo);
-            ClientLog(UI_COMP, LOG_STATUS, false, _T("ReadResumeIndex: position %d, size %d"),
+            CLIENTLOG_STATUS(UI_COMP, false, _T("ReadResumeIndex: position %d, size %d"),
                 resumeIndexInfo.nPosition, resumeIndexInfo.nSize);
         }
     }
@@ -568,7 +571,7 @@ int ResumeManager::WriteResumeIndex(std::string szResumeFileName)
 
         #if 1
             fprintf(m_pResumeIndexFile, _T("%d,%d\n"), resumeIndexInfo.nPosition, resumeIndexInfo.nSize);
-            ClientLog(UI_COMP, LOG_STATUS, false, _T("WriteResumeIndex: position %d, size %d"),
+            CLIENTLOG_STATUS(UI_COMP, false, _T("WriteResumeIndex: position %d, size %d"),
                 resumeIndexInfo.nPosition, resumeIndexInfo.nSize);
         #else
             // For writing to a binary file - we may want to go this route later.
@@ -600,6 +603,8 @@ int ResumeManager::WriteResumeIndex(std::string szResumeFileName)
 //!
 int ResumeManager::ClearResumeMgrData()
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     ClearBuffer();
     m_szResumeFileName = _T("");
 
@@ -653,6 +658,8 @@ int ResumeManager::CloseOpenFiles(std::string szResumeFileName)
 //!
 int ResumeManager::OpenResumeData( std::string szResumeFileName, bool& bIsFirstRun )
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     LockResources(_T("Resume open resume data error"));
 
     ClearResumeMgrData();
@@ -730,6 +737,8 @@ int ResumeManager::OpenResumeData( std::string szResumeFileName, bool& bIsFirstR
 //!
 int ResumeManager::ClearResumeFiles(const ResumeInfoType resumeInfoType)
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     LockResources(_T("Resume clear resume files error"));
 
     std::string szResumeFileName = _T("");
@@ -903,6 +912,8 @@ int ResumeManager::ClearResumeInfo(const ResumeInfoType resumeInfoType,
                                    std::string szResumeFileName,
                                    ResumeUploadInfoData& resumeUploadInfo)
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     LockResources(_T("Resume clear resume info error"));
     ResetErrorCodes();
 
@@ -1096,6 +1107,69 @@ int ResumeManager::ClearResumeInfo(const ResumeInfoType resumeInfoType,
 int ResumeManager::ReadResumeUploadData( ResumeUploadInfoData& resumeUploadInfo,
                                          bool bAddNewEntries /*false*/)
 {
+	std::string szFilePath = resumeUploadInfo.GetFilePath();
+
+	// The records for this path are read under the locks - checking them
+	// against the file reads the file, so it's done once the locks are
+	// released.
+	t_resumeUploadInfoList listCandidates;
+
+	int nResult = ReadResumeUploadCandidates(szFilePath, listCandidates);
+	if (nResult != 0) {
+	    return nResult;
+	}
+
+	bool bFoundMatch = false;
+
+	// Check the file size and modified date as well - with fingerprints,
+	// the data uploaded thus far is checked instead of the date.
+	for (int nCandidate = 0; nCandidate < (int)listCandidates.size(); nCandidate++) {
+	    if ( listCandidates[nCandidate].HasResumeFileChanged() == false ) {
+	        resumeUploadInfo = listCandidates[nCandidate];
+	        bFoundMatch = true;
+	        break;
+	    }
+	}
+
+	if ( (bFoundMatch == false) && (bAddNewEntries == true) ) {
+	    // Add the resume data as a new entry
+        time_t tmLastModified;
+
+        if (-1 != Util::GetFileLastModifiedTime(szFilePath.c_str(), tmLastModified)) {
+            resumeUploadInfo.SetLastModified(tmLastModified);
+        }
+
+	    resumeUploadInfo.SetFileSize(Util::GetFileLength64(szFilePath.c_str()));
+
+        bFoundMatch = true;
+	}
+
+    if (bFoundMatch == false) {
+
+        #if defined(__APPLE__)
+            ClientLog(UI_COMP, LOG_ERROR, false,
+                _T("Resume read upload data error - found match is false - returning No match found for resume data. "));
+        #endif
+        nResult = RESUME_NO_MATCHES_FOUND;
+    }
+
+	return nResult;
+
+} // End ReadResumeUploadData
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Reads the upload records for a file path from the resume
+//!        info data file.
+//! \param szFilePath: file path to match
+//! \param listCandidates: records for the path, with their resume
+//!                       index set, in index order
+//! \return 0 if successful, error otherwise
+//!
+int ResumeManager::ReadResumeUploadCandidates( const std::string& szFilePath,
+                                               t_resumeUploadInfoList& listCandidates )
+{
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     LockResources(_T("Resume read upload data error"));
     ResetErrorCodes();
 
@@ -1108,8 +1182,6 @@ int ResumeManager::ReadResumeUploadData( ResumeUploadInfoData& resumeUploadInfo,
 	int nNumBytesRead = 0;
 	std::string szData = _T("");
 
-	std::string szFilePath = resumeUploadInfo.GetFilePath();
-
 	if (szFilePath.length() == 0) {
         UnlockResources();
 
@@ -1121,8 +1193,6 @@ int ResumeManager::ReadResumeUploadData( ResumeUploadInfoData& resumeUploadInfo,
 	}
 
 	int nResult = 0;
-	bool bFoundMatch = false;
-	LONG64 l64FileSize = 0;
 
 	ResumeIndexStruct resumeIndexInfo;
 
@@ -1186,67 +1256,21 @@ int ResumeManager::ReadResumeUploadData( ResumeUploadInfoData& resumeUploadInfo,
 		    continue;
 		}
 
-        bFoundMatch = false;
-        l64FileSize = 0;
-
 		// Is this the path we want?  This logic falls apart if there are multiple
-		// entries with file path/name - if the file path, size, and last modified
-		// time all match, we'll take this hit.
+		// entries with file path/name - the first whose file size and last
+		// modified time (or fingerprints) match is taken.
 		if ( 0 == stricmp(tmpResumeUploadData.GetFilePath().c_str(), szFilePath.c_str())) {
-
-		    // Check the file size and modified date as well...
-		    l64FileSize = Util::GetFileLength64(szFilePath.c_str());
-		    if (l64FileSize == tmpResumeUploadData.GetFileSize()) {
-
-		        // And lastly, check the last modified date.
-                time_t tmLastModified;
-
-                if ( -1 != Util::GetFileLastModifiedTime(szFilePath.c_str(), tmLastModified) ) {
-
-                    if ( tmLastModified == tmpResumeUploadData.GetLastModified() ) {
-
-		                resumeUploadInfo = tmpResumeUploadData;
-		                resumeUploadInfo.SetResumeIndex(nIndex);
-		                bFoundMatch = true;
-                    }
-                }
-		    }
-		}
-
-		if (bFoundMatch == true) {
-		    break;
+		    tmpResumeUploadData.SetResumeIndex(nIndex);
+		    listCandidates.push_back(tmpResumeUploadData);
 		}
 	}
 
-	if ( (bFoundMatch == false) && (bAddNewEntries == true) ) {
-	    // Add the resume data as a new entry
-        time_t tmLastModified;
-
-        if (-1 != Util::GetFileLastModifiedTime(szFilePath.c_str(), tmLastModified)) {
-            resumeUploadInfo.SetLastModified(tmLastModified);
-        }
-
-	    l64FileSize = Util::GetFileLength64(szFilePath.c_str());
-	    resumeUploadInfo.SetFileSize(l64FileSize);
-
-        bFoundMatch = true;
-	}
-
     fflush(m_pResumeFile);
 
-    if (bFoundMatch == false) {
-
-        #if defined(__APPLE__)
-            ClientLog(UI_COMP, LOG_ERROR, false,
-                _T("Resume read upload data error - found match is false - returning No match found for resume data. "));
-        #endif
-        nResult = RESUME_NO_MATCHES_FOUND;
-    }
-
     UnlockResources();
 	return nResult;
 
-} // End ReadResumeUploadData
+} // End ReadResumeUploadCandidates
 
 ///////////////////////////////////////////////////////////////////////
 //! \brief Reads a the resume info record from the resume info data
@@ -1260,6 +1284,8 @@ int ResumeManager::ReadResumeUploadData( ResumeUploadInfoData& resumeUploadInfo,
 int ResumeManager::ReadResumeUploadDataByFileID( ResumeUploadInfoData* pResumeUploadInfo,
                                                  bool bAddNewEntries /*false*/)
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     LockResources(_T("Resume read upload data by file ID error"));
 
     ResetErrorCodes();
@@ -1329,6 +1355,8 @@ int ResumeManager::ReadResumeUploadDataByFileID( ResumeUploadInfoData* pResumeUp
 int ResumeManager::WriteResumeUploadData( std::string szResumeFileName,
                                           ResumeUploadInfoData& resumeUploadInfo )
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     // If there's no file ID assigned yet, ignore the request.
     if (resumeUploadInfo.GetFileID() == 0) {
         return RESUME_NO_FILEID;
@@ -1506,7 +1534,7 @@ int ResumeManager::WriteResumeUploadData( std::string szResumeFileName,
     }
     */
 
-    ClientLog(UI_COMP, LOG_STATUS, false, _T("Resume data[%d] (%d) (%d): %s"),
+    CLIENTLOG_STATUS(UI_COMP, false, _T("Resume data[%d] (%d) (%d): %s"),
         nCurrentIndex, nOutputLength, nSize, szOutput.c_str());
 
     fflush(m_pResumeFile);
@@ -1522,6 +1550,8 @@ int ResumeManager::WriteResumeUploadData( std::string szResumeFileName,
 //!
 int ResumeManager::GetResumeUploadRecordCount()
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
 	return (int)m_listResumeIndexInfo.size()-1;
 
 } // End GetResumeUploadRecordCount
@@ -1539,6 +1569,8 @@ int ResumeManager::ReadResumeDownloadData( std::string szResumeFileName,
                                            ResumeDownloadInfoData& resumeDownloadInfo,
                                            bool bAddNewEntries /*false*/)
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     // Data file should be opened...
     if (m_pResumeFile == NULL) {
         return RESUME_OPEN_FILE_ERROR;
@@ -1563,6 +1595,8 @@ int ResumeManager::ReadResumeDownloadData( std::string szResumeFileName,
 int ResumeManager::WriteResumeDownloadData( std::string szResumeFileName,
                                             ResumeDownloadInfoData& resumeDownloadInfo )
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     int nResult = 0;
 
     //! TBD
@@ -1578,6 +1612,8 @@ int ResumeManager::WriteResumeDownloadData( std::string szResumeFileName,
 //!
 int ResumeManager::GetResumeDownloadRecordCount()
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
 	return (int)m_listResumeIndexInfo.size()-1;
 
 } // End GetResumeDownloadRecordCount
@@ -1855,8 +1891,10 @@ void ResumeManager::ApplyToEachResumeDownloadInfo( int (*ResumeListFunction )(Re
 // Public Methods
 
 /////////////////////////////////////////////////////////////////////////////
-t_resumeUploadInfoList& ResumeManager::GetResumeUploadInfoList()
+t_resumeUploadInfoList ResumeManager::GetResumeUploadInfoList()
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     if (m_listResumeUploadInfo.size() == 0) {
         // Load the list - we assume the user wants the data from
         // storage.
@@ -1874,9 +1912,11 @@ t_resumeUploadInfoList& ResumeManager::GetResumeUploadInfoList()
 //! \param bAddNewEntries: Add any entries which are not found in
 //!                        the current resume list.
 //
-t_resumeUploadInfoList& ResumeManager::GetResumeUploadInfoList(const std::vector<std::string>& listFiles,
-                                                               bool bAddNewEntries /*false*/)
+t_resumeUploadInfoList ResumeManager::GetResumeUploadInfoList(const std::vector<std::string>& listFiles,
+                                                              bool bAddNewEntries /*false*/)
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     m_listResumeUploadInfo.clear();
 
     // Empty list - return all the entries...
@@ -1905,6 +1945,8 @@ t_resumeUploadInfoList& ResumeManager::GetResumeUploadInfoList(const std::vector
 /////////////////////////////////////////////////////////////////////////////
 t_resumeDownloadInfoList& ResumeManager::GetResumeDownloadInfoList()
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     if (m_listResumeDownloadInfo.size() == 0) {
         // Load the list - we assume the user wants the data from
         // storage.
@@ -1919,6 +1961,8 @@ t_resumeDownloadInfoList& ResumeManager::GetResumeDownloadInfoList()
 t_resumeDownloadInfoList& ResumeManager::GetResumeDownloadInfoList(const std::vector<std::string>& listFiles,
                                                                    bool bAddNewEntries /*false*/)
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
 	return m_listResumeDownloadInfo;
 
 } // End GetResumeDownloadInfoList
@@ -1931,6 +1975,8 @@ t_resumeDownloadInfoList& ResumeManager::GetResumeDownloadInfoList(const std::ve
 //!
 int ResumeManager::Load( const ResumeInfoType resumeInfoType )
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     LockResources(_T("Resume load error"));
 
     // Open the .dat and .idx file.
@@ -1990,6 +2036,8 @@ int ResumeManager::Load( const ResumeInfoType resumeInfoType )
 ///////////////////////////////////////////////////////////////////////
 bool ResumeManager::Save( const ResumeInfoType resumeInfoType)
 {
+    Lock<CCriticalSection> lock(m_resumeLock);
+
     LockResources(_T("Resume save error"));
 
     // Open the .dat and .idx file.
@@ -2236,7 +2284,7 @@ bool ResumeManager::ResumeInfoFileReadString(std::string& szIn, bool bConsumeNew
 
     LockResources(_T("Resume file read string error"));
 
-	char szValue[1024];
+	char szValue[2048];
 	int nLength = 0;
 
 	int nNumBytesRead = _ftscanf(m_pResumeFile, _T("%d,"), &nLength);
@@ -23,6 +23,7 @@
 #include "stdafx.h"
 #include "ResumeInfoData.h"
 #include "ResumeNamedMutex.h"
+#include "../Util/CriticalSection.h"
 
 #include <string>
 #include <sstream>
@@ -162,6 +163,10 @@ private:
 
     int                         m_nLastError;                   //! Last file I/O error
 
+    DIOMEDE_CRITICAL::CCriticalSection  m_resumeLock;           //! Serializes resume file access
+                                                                //! between upload threads (e.g.
+                                                                //! resume /parallel).
+
 public:
     static ResumeManager* Instance();
     virtual ~ResumeManager();
@@ -192,6 +197,9 @@ private:
     int WriteResumeIndex( std::string szResumeFileName);
     int CloseOpenFiles(std::string szResumeFileName=_T(""));
 
+    int ReadResumeUploadCandidates( const std::string& szFilePath,
+                                    t_resumeUploadInfoList& listCandidates );
+
 public:
     int ClearResumeMgrData();
     int OpenResumeData( std::string szResumeFileName, bool& bIsFirstRun );
@@ -293,9 +301,13 @@ public:
     //! Memory access to resume data
     //-----------------------------------------------------------------
 
-	t_resumeUploadInfoList& GetResumeUploadInfoList();
-	t_resumeUploadInfoList& GetResumeUploadInfoList(const std::vector<std::string>& listFiles,
-                                                    bool bAddNewEntries=false );
+    //-----------------------------------------------------------------
+    //! The upload lists are copied under the resume lock - the resume
+    //! /parallel workers update the entries while the caller iterates.
+    //-----------------------------------------------------------------
+	t_resumeUploadInfoList GetResumeUploadInfoList();
+	t_resumeUploadInfoList GetResumeUploadInfoList(const std::vector<std::string>& listFiles,
+                                                   bool bAddNewEntries=false );
 
 	t_resumeDownloadInfoList& GetResumeDownloadInfoList();
 	t_resumeDownloadInfoList& GetResumeDownloadInfoList(const std::vector<std::string>& listFiles,
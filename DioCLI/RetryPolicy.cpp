@@ -0,0 +1,427 @@
+/*********************************************************************
+ *
+ *  file:  RetryPolicy.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Singleton class that schedules retries of failed transfers
+ *          per error class - exponential backoff with jitter, a limit
+ *          on attempts, and a circuit breaker shared by all transfers.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "RetryPolicy.h"
+
+#include "../Util/ClientLog.h"
+#include "../Util/UserProfileData.h"
+#include "../Util/ProfileManager.h"
+
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace RetryErrorTypes;
+using namespace boost::posix_time;
+
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+static const char* g_szRetryErrorClass[] = { _T("network"), _T("session"), _T("service") };
+
+///////////////////////////////////////////////////////////////////////
+RetryPolicy* RetryPolicy::m_pRetryPolicy = NULL;
+
+///////////////////////////////////////////////////////////////////////
+// RetryPolicy Constructor
+RetryPolicy::RetryPolicy() : m_bResumeIntervalsChecked(false)
+{
+    // Seed from the time and this object's address - only used to
+    // spread retries, not for anything security related.
+    m_nRandomState = (unsigned int)time(NULL) ^ (unsigned int)(size_t)this;
+    if (m_nRandomState == 0) {
+        m_nRandomState = 0x2545F491;
+    }
+
+    for (int nIndex = 0; nIndex < RETRY_ERROR_CLASSES; nIndex++) {
+        m_breakers[nIndex].nFailures = 0;
+        m_breakers[nIndex].bProbing = false;
+        m_breakers[nIndex].tmOpenUntil = not_a_date_time;
+    }
+
+    LoadPolicies();
+
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+// RetryPolicy Destructor
+RetryPolicy::~RetryPolicy()
+{
+} // End Destructor
+
+///////////////////////////////////////////////////////////////////////
+//! RetryPolicy Instance
+RetryPolicy* RetryPolicy::Instance()
+{
+	if (m_pRetryPolicy == NULL) {
+	    m_pRetryPolicy = new RetryPolicy;
+	}
+
+	return m_pRetryPolicy;
+
+} // End Instance
+
+///////////////////////////////////////////////////////////////////////
+//! RetryPolicy Shutdown
+void RetryPolicy::Shutdown()
+{
+	if ( this == m_pRetryPolicy )
+		m_pRetryPolicy = NULL;
+
+	delete this;
+
+} // End Shutdown
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Parse a policy setting - base delay, maximum delay, jitter,
+//!        maximum attempts, breaker threshold and breaker open time,
+//!        separated by commas.  Missing or invalid values keep the
+//!        value already in the policy.
+//! \param szPolicy: setting value, e.g. "5,3600,50,10,8,60"
+//! \param policy: policy to update.
+void RetryPolicy::ParsePolicy(const std::string& szPolicy, RetryClassPolicy& policy)
+{
+    int nValues[6] = { policy.nBaseDelay, policy.nMaxDelay, policy.nJitter,
+                       policy.nMaxAttempts, policy.nBreakerThreshold, policy.nBreakerOpenTime };
+
+    int nFields = sscanf(szPolicy.c_str(), _T("%d,%d,%d,%d,%d,%d"), &nValues[0], &nValues[1],
+                         &nValues[2], &nValues[3], &nValues[4], &nValues[5]);
+
+    if (nFields <= 0) {
+        return;
+    }
+
+    if (nValues[0] > 0) {
+        policy.nBaseDelay = nValues[0];
+    }
+    if (nValues[1] > 0) {
+        policy.nMaxDelay = nValues[1];
+    }
+    if ( (nValues[2] >= 0) && (nValues[2] <= 100) ) {
+        policy.nJitter = nValues[2];
+    }
+    if (nValues[3] >= 0) {
+        policy.nMaxAttempts = nValues[3];
+    }
+    if (nValues[4] >= 0) {
+        policy.nBreakerThreshold = nValues[4];
+    }
+    if (nValues[5] >= 0) {
+        policy.nBreakerOpenTime = nValues[5];
+    }
+
+    if (policy.nMaxDelay < policy.nBaseDelay) {
+        policy.nMaxDelay = policy.nBaseDelay;
+    }
+
+} // End ParsePolicy
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Carry the ResumeInterval1-5 settings, used before the retry
+//!        policies, over to RetryNetwork - the first interval becomes
+//!        the base delay, the largest the maximum delay.  Done once,
+//!        and only when RetryNetwork is not set - otherwise the old
+//!        settings are logged as ignored.
+//! \param pProfileData: user profile, saved when RetryNetwork is set.
+void RetryPolicy::MigrateResumeIntervals(UserProfileData* pProfileData)
+{
+    if (m_bResumeIntervalsChecked) {
+        return;
+    }
+    m_bResumeIntervalsChecked = true;
+
+    const char* szIntervalNames[] = { GEN_RESUME_INTERVAL_1, GEN_RESUME_INTERVAL_2,
+                                      GEN_RESUME_INTERVAL_3, GEN_RESUME_INTERVAL_4,
+                                      GEN_RESUME_INTERVAL_5 };
+
+    int nBaseDelay = 0;
+    int nMaxDelay = 0;
+    bool bFound = false;
+
+    for (int nIndex = 0; nIndex < 5; nIndex++) {
+        std::string szInterval = pProfileData->GetUserProfileStr(szIntervalNames[nIndex], _T(""));
+        int nInterval = atoi(szInterval.c_str());
+
+        if ( (szInterval.length() == 0) || (nInterval <= 0) ) {
+            continue;
+        }
+
+        bFound = true;
+        if (nIndex == 0) {
+            nBaseDelay = nInterval;
+        }
+        if (nInterval > nMaxDelay) {
+            nMaxDelay = nInterval;
+        }
+    }
+
+    if (bFound == false) {
+        return;
+    }
+
+    if (pProfileData->GetUserProfileStr(GEN_RETRY_NETWORK, _T("")).length() > 0) {
+        ClientLog(UI_COMP, LOG_WARNING, false,
+            _T("Retry policy: the ResumeInterval settings are no longer used - %s is set."),
+            GEN_RETRY_NETWORK);
+        return;
+    }
+
+    // Missing fields keep the defaults - see ParsePolicy.
+    char szPolicy[64];
+    if (nBaseDelay > 0) {
+        sprintf(szPolicy, _T("%d,%d"), nBaseDelay, nMaxDelay);
+    }
+    else {
+        sprintf(szPolicy, _T("0,%d"), nMaxDelay);
+    }
+
+    pProfileData->SetUserProfileStr(GEN_RETRY_NETWORK, szPolicy);
+    pProfileData->SaveUserProfile();
+
+    ClientLog(UI_COMP, LOG_WARNING, false,
+        _T("Retry policy: the ResumeInterval settings are no longer used - %s set to %s from them."),
+        GEN_RETRY_NETWORK, szPolicy);
+
+} // End MigrateResumeIntervals
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Read the policies from the user profile.  Called at the
+//!        start of each resume so setting changes take effect
+//!        without a restart - breaker state is kept.
+void RetryPolicy::LoadPolicies()
+{
+    RetryClassPolicy policies[RETRY_ERROR_CLASSES];
+    memset(policies, 0, sizeof(policies));
+
+    ParsePolicy(GEN_RETRY_NETWORK_DF, policies[retryErrorNetwork]);
+    ParsePolicy(GEN_RETRY_SESSION_DF, policies[retryErrorSession]);
+    ParsePolicy(GEN_RETRY_SERVICE_DF, policies[retryErrorService]);
+
+    UserProfileData* pProfileData =
+        ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
+    if (pProfileData) {
+        MigrateResumeIntervals(pProfileData);
+
+        ParsePolicy(pProfileData->GetUserProfileStr(GEN_RETRY_NETWORK, GEN_RETRY_NETWORK_DF),
+                    policies[retryErrorNetwork]);
+        ParsePolicy(pProfileData->GetUserProfileStr(GEN_RETRY_SESSION, GEN_RETRY_SESSION_DF),
+                    policies[retryErrorSession]);
+        ParsePolicy(pProfileData->GetUserProfileStr(GEN_RETRY_SERVICE, GEN_RETRY_SERVICE_DF),
+                    policies[retryErrorService]);
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    for (int nIndex = 0; nIndex < RETRY_ERROR_CLASSES; nIndex++) {
+        m_policies[nIndex] = policies[nIndex];
+    }
+
+} // End LoadPolicies
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns a random value from 0 to l64Range - 1 (xorshift).
+//!        Called with the lock held.
+LONG64 RetryPolicy::GetRandom(LONG64 l64Range)
+{
+    if (l64Range <= 0) {
+        return 0;
+    }
+
+    m_nRandomState ^= m_nRandomState << 13;
+    m_nRandomState ^= m_nRandomState >> 17;
+    m_nRandomState ^= m_nRandomState << 5;
+
+    return (LONG64)m_nRandomState % l64Range;
+
+} // End GetRandom
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns true if retries of the class are held by the breaker
+//!        - it is open, or half open with a probe in progress.  Called
+//!        with the lock held.
+bool RetryPolicy::IsBreakerOpen(int nErrorClass, const ptime& tmNow)
+{
+    const RetryBreakerState& breaker = m_breakers[nErrorClass];
+    int nThreshold = m_policies[nErrorClass].nBreakerThreshold;
+
+    if ( (nThreshold <= 0) || (breaker.nFailures < nThreshold) ) {
+        return false;
+    }
+
+    return (breaker.tmOpenUntil.is_not_a_date_time() == false) && (tmNow < breaker.tmOpenUntil);
+
+} // End IsBreakerOpen
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Delay before the next attempt of a failed transfer.
+//! \param nErrorClass: RetryErrorClassType of the last failure.
+//! \param nAttempt: number of retries made so far.
+//! \param l64DelayMs: set to the delay in milliseconds.
+//! \return true if the transfer can be retried, false otherwise.
+bool RetryPolicy::GetRetryDelay(int nErrorClass, int nAttempt, LONG64& l64DelayMs)
+{
+    l64DelayMs = 0;
+
+    if ( (nErrorClass < 0) || (nErrorClass >= RETRY_ERROR_CLASSES) ) {
+        return false;
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    const RetryClassPolicy& policy = m_policies[nErrorClass];
+    if (nAttempt >= policy.nMaxAttempts) {
+        return false;
+    }
+
+    // Double from the base delay, stopping at the cap.
+    LONG64 l64MaxDelayMs = (LONG64)policy.nMaxDelay * 1000;
+    l64DelayMs = (LONG64)policy.nBaseDelay * 1000;
+
+    for (int nIndex = 0; (nIndex < nAttempt) && (l64DelayMs < l64MaxDelayMs); nIndex++) {
+        l64DelayMs *= 2;
+    }
+
+    if (l64DelayMs > l64MaxDelayMs) {
+        l64DelayMs = l64MaxDelayMs;
+    }
+
+    l64DelayMs -= GetRandom((l64DelayMs * policy.nJitter) / 100 + 1);
+
+    // While the breaker is open, wait it out - spread over the base
+    // delay so the held transfers don't all return at once.
+    ptime tmNow = microsec_clock::universal_time();
+    if (IsBreakerOpen(nErrorClass, tmNow) && (m_breakers[nErrorClass].bProbing == false)) {
+        LONG64 l64OpenMs = (m_breakers[nErrorClass].tmOpenUntil - tmNow).total_milliseconds() +
+                           GetRandom((LONG64)policy.nBaseDelay * 1000 + 1);
+        if (l64OpenMs > l64DelayMs) {
+            l64DelayMs = l64OpenMs;
+        }
+    }
+
+    return true;
+
+} // End GetRetryDelay
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Check a retry that has come due against the breaker.  The
+//!        first retry after the open time passes is the probe - the
+//!        others wait for its result.
+//! \param nErrorClass: RetryErrorClassType of the last failure.
+//! \param tmRetry: set to the next time to check when held.
+//! \return true if the retry can start now, false otherwise.
+bool RetryPolicy::CanAttempt(int nErrorClass, ptime& tmRetry)
+{
+    if ( (nErrorClass < 0) || (nErrorClass >= RETRY_ERROR_CLASSES) ) {
+        return true;
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    const RetryClassPolicy& policy = m_policies[nErrorClass];
+    RetryBreakerState& breaker = m_breakers[nErrorClass];
+    ptime tmNow = microsec_clock::universal_time();
+
+    if ( (policy.nBreakerThreshold <= 0) || (breaker.nFailures < policy.nBreakerThreshold) ) {
+        return true;
+    }
+
+    LONG64 l64SpreadMs = GetRandom((LONG64)policy.nBaseDelay * 1000 + 1);
+
+    if (IsBreakerOpen(nErrorClass, tmNow)) {
+        if (breaker.bProbing) {
+            tmRetry = tmNow + milliseconds(l64SpreadMs);
+        }
+        else {
+            tmRetry = breaker.tmOpenUntil + milliseconds(l64SpreadMs);
+        }
+        return false;
+    }
+
+    // Half open - let this one through.  If no result arrives within
+    // the open time, another probe is allowed.
+    breaker.bProbing = true;
+    breaker.tmOpenUntil = tmNow + seconds(policy.nBreakerOpenTime);
+
+    ClientLog(UI_COMP, LOG_STATUS, false, _T("Retry policy: %s breaker half open - probing."),
+        g_szRetryErrorClass[nErrorClass]);
+
+    return true;
+
+} // End CanAttempt
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Records a failed attempt - opens the class breaker once the
+//!        consecutive failures reach the threshold.
+//! \param nErrorClass: RetryErrorClassType of the failure.
+void RetryPolicy::RecordFailure(int nErrorClass)
+{
+    if ( (nErrorClass < 0) || (nErrorClass >= RETRY_ERROR_CLASSES) ) {
+        return;
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    const RetryClassPolicy& policy = m_policies[nErrorClass];
+    RetryBreakerState& breaker = m_breakers[nErrorClass];
+
+    breaker.nFailures ++;
+
+    if ( (policy.nBreakerThreshold <= 0) || (breaker.nFailures < policy.nBreakerThreshold) ) {
+        return;
+    }
+
+    if ( (breaker.nFailures == policy.nBreakerThreshold) || breaker.bProbing ) {
+        ClientLog(UI_COMP, LOG_WARNING, false,
+            _T("Retry policy: %s breaker open for %d seconds after %d failures."),
+            g_szRetryErrorClass[nErrorClass], policy.nBreakerOpenTime, breaker.nFailures);
+    }
+
+    breaker.bProbing = false;
+    breaker.tmOpenUntil = microsec_clock::universal_time() + seconds(policy.nBreakerOpenTime);
+
+} // End RecordFailure
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Records a successful transfer - the service is reachable,
+//!        so all breakers close.
+void RetryPolicy::RecordSuccess()
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    for (int nIndex = 0; nIndex < RETRY_ERROR_CLASSES; nIndex++) {
+        RetryBreakerState& breaker = m_breakers[nIndex];
+
+        if ( (m_policies[nIndex].nBreakerThreshold > 0) &&
+             (breaker.nFailures >= m_policies[nIndex].nBreakerThreshold) ) {
+            ClientLog(UI_COMP, LOG_STATUS, false, _T("Retry policy: %s breaker closed."),
+                g_szRetryErrorClass[nIndex]);
+        }
+
+        breaker.nFailures = 0;
+        breaker.bProbing = false;
+        breaker.tmOpenUntil = not_a_date_time;
+    }
+
+} // End RecordSuccess
+
+/** @} */
@@ -0,0 +1,163 @@
+/*********************************************************************
+ *
+ *  file:  RetryPolicy.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Singleton class that schedules retries of failed transfers
+ *          per error class - exponential backoff with jitter, a limit
+ *          on attempts, and a circuit breaker shared by all transfers.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __RETRY_POLICY_H__
+#define __RETRY_POLICY_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+#include "../Util/CriticalSection.h"
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include <string>
+
+class UserProfileData;
+
+//---------------------------------------------------------------------
+//! Error classes - each has its own policy and circuit breaker.
+//---------------------------------------------------------------------
+namespace RetryErrorTypes {
+    typedef enum RetryErrorClass {
+        retryErrorNetwork = 0,              //! Connection dropped - resume.
+        retryErrorSession,                  //! Session expired - login, then retry.
+        retryErrorService,                  //! Generic service error.
+        retryErrorNone                      //! Not retryable.
+    } RetryErrorClassType;
+}
+
+#define RETRY_ERROR_CLASSES             3
+
+///////////////////////////////////////////////////////////////////////
+//! \struct RetryClassPolicy
+//! \brief Retry settings of an error class.  Times are in seconds.
+struct RetryClassPolicy
+{
+    int                         nBaseDelay;                     //! First retry
+    int                         nMaxDelay;                      //! Backoff cap
+    int                         nJitter;                        //! Percent of the delay
+    int                         nMaxAttempts;
+    int                         nBreakerThreshold;              //! 0 = no breaker
+    int                         nBreakerOpenTime;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// RetryPolicy Class
+//
+// Usage:
+//      // Transfer failed:
+//      pRetryPolicy->RecordFailure(nErrorClass);
+//      if (pRetryPolicy->GetRetryDelay(nErrorClass, nAttempt, l64DelayMs)) {
+//          tmRetry = now + milliseconds(l64DelayMs);
+//          nAttempt ++;
+//      }
+//
+//      // Retry is due:
+//      if (pRetryPolicy->CanAttempt(nErrorClass, tmRetry)) {
+//          ...restart the transfer...
+//      }
+//
+//      // Transfer succeeded:
+//      pRetryPolicy->RecordSuccess();
+//
+// The delay doubles with each attempt up to the cap, less a random
+// part (the jitter) so transfers that failed together don't retry
+// together.  Once the consecutive failures of a class reach the
+// breaker threshold, the breaker opens - retries of that class are
+// held until the open time passes, then a single transfer is let
+// through to probe the service.  The others follow, spread over the
+// base delay, after the probe succeeds.
+
+class RetryPolicy
+{
+protected:
+    static RetryPolicy*         m_pRetryPolicy;
+
+private:
+    //-----------------------------------------------------------------
+    //! Circuit breaker of an error class.
+    //-----------------------------------------------------------------
+    struct RetryBreakerState
+    {
+        int                         nFailures;                  //! Consecutive
+        bool                        bProbing;                   //! Probe in progress
+        boost::posix_time::ptime    tmOpenUntil;                //! Or probe timeout
+    };
+
+    RetryClassPolicy            m_policies[RETRY_ERROR_CLASSES];
+    RetryBreakerState           m_breakers[RETRY_ERROR_CLASSES];
+    unsigned int                m_nRandomState;
+    bool                        m_bResumeIntervalsChecked;
+
+    DIOMEDE_CRITICAL::CCriticalSection  m_lock;
+
+public:
+    static RetryPolicy* Instance();
+    virtual ~RetryPolicy();
+
+	// Cleanup the retry policy.
+	void Shutdown();
+
+private:
+    RetryPolicy();
+
+    static void ParsePolicy(const std::string& szPolicy, RetryClassPolicy& policy);
+    void MigrateResumeIntervals(UserProfileData* pProfileData);
+    LONG64 GetRandom(LONG64 l64Range);
+    bool IsBreakerOpen(int nErrorClass, const boost::posix_time::ptime& tmNow);
+
+public:
+	//-----------------------------------------------------------------
+	//! \brief Read the policies from the user profile.
+	//-----------------------------------------------------------------
+    void LoadPolicies();
+
+    const RetryClassPolicy& GetPolicy(int nErrorClass) {
+        return m_policies[nErrorClass];
+    }
+
+	//-----------------------------------------------------------------
+	//! \brief Delay before the next attempt of a failed transfer.
+	//! \param nErrorClass: RetryErrorClassType of the last failure.
+	//! \param nAttempt: number of retries made so far.
+	//! \param l64DelayMs: set to the delay in milliseconds.
+	//! \return true if the transfer can be retried, false otherwise.
+	//-----------------------------------------------------------------
+    bool GetRetryDelay(int nErrorClass, int nAttempt, LONG64& l64DelayMs);
+
+	//-----------------------------------------------------------------
+	//! \brief Check a retry that has come due against the breaker.
+	//! \param nErrorClass: RetryErrorClassType of the last failure.
+	//! \param tmRetry: set to the next time to check when held.
+	//! \return true if the retry can start now, false otherwise.
+	//-----------------------------------------------------------------
+    bool CanAttempt(int nErrorClass, boost::posix_time::ptime& tmRetry);
+
+	//-----------------------------------------------------------------
+	//! \name Transfer results - any success closes the breakers.
+	//! @{
+	//-----------------------------------------------------------------
+    void RecordFailure(int nErrorClass);
+    void RecordSuccess();
+	//! @}
+};
+
+#endif // __RETRY_POLICY_H__
+
+/** @} */
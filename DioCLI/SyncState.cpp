@@ -0,0 +1,458 @@
+/*********************************************************************
+ *
+ *  file:  SyncState.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Local state of the files uploaded by the sync command,
+ *          used to upload only the new and changed files of a tree.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "SyncState.h"
+#include "ResumeManager.h"
+
+#include "../Util/Util.h"
+#include "../Util/StringUtil.h"
+#include "../Util/ClientLog.h"
+#include "../Util/FileHashBatch.h"
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include "openssl/md5.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <fstream>
+#include <sstream>
+
+#ifndef WIN32
+    #include <sys/stat.h>
+#endif
+
+using namespace SyncFileStatusTypes;
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Current size, last modified time and inode of a file.
+//! \return true if the file could be read, false otherwise.
+static bool GetSyncFileInfo(const std::string& szFilePath, LONG64& l64FileSize,
+                            time_t& tmLastModified, UINT64& ul64FileIndex)
+{
+#ifdef WIN32
+    l64FileSize = Util::GetFileLength64(szFilePath.c_str());
+    ul64FileIndex = 0;
+
+    return ( (l64FileSize >= 0) &&
+             (Util::GetFileLastModifiedTime(szFilePath.c_str(), tmLastModified) != -1) );
+#else
+    struct stat theStats;
+    if (stat(szFilePath.c_str(), &theStats) != 0) {
+        return false;
+    }
+
+    l64FileSize = (LONG64)theStats.st_size;
+    tmLastModified = theStats.st_mtime;
+    ul64FileIndex = (UINT64)theStats.st_ino;
+
+    return true;
+#endif
+
+} // End GetSyncFileInfo
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Last modified time to record - a file modified in the second
+//!        it's recorded could change again without changing its time,
+//!        so the time is left unset and the next sync compares the
+//!        digest instead.
+static time_t GetRecordedTime(time_t tmLastModified)
+{
+    if (tmLastModified >= time(NULL)) {
+        return 0;
+    }
+
+    return tmLastModified;
+
+} // End GetRecordedTime
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Constructor
+//
+SyncState::SyncState() : m_szRootDir(_T("")), m_bModified(false)
+{
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Saved state file for the given tree - named from the MD5 of
+//!        the path to keep the name valid on every platform.
+//! \param szRootDir: root directory of the tree
+//! \return the state file name with path.
+std::string SyncState::GetStateFileName(const std::string& szRootDir)
+{
+    unsigned char szDigest[MD5_DIGEST_LENGTH];
+    StringUtil::MakeStringMd5Digest((char*)szRootDir.c_str(), szDigest);
+
+    std::string szName = _T("");
+    StringUtil::ConvertDigestToString(szName, szDigest);
+
+    return ResumeManager::Instance()->GetAppDataDir() + SYNC_STATE_FILE_PREFIX + szName +
+           SYNC_STATE_FILE_EXT;
+
+} // End GetStateFileName
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Read the saved state of the tree.
+//! \param szRootDir: root directory of the tree
+//! \return true if the state was read, false otherwise.
+//
+//! State file:
+//!     Ver: 1
+//!     <root directory>
+//!     <size>\t<last modified>\t<inode>\t<file ID>\t<MD5>\t<relative path>
+bool SyncState::Load(const std::string& szRootDir)
+{
+    // "dir" and "dir/" share their state.
+    m_szRootDir = szRootDir;
+    if ( (m_szRootDir.length() > 1) &&
+         ( (m_szRootDir[m_szRootDir.length() - 1] == _T('/')) ||
+           (m_szRootDir[m_szRootDir.length() - 1] == _T('\\')) ) ) {
+        m_szRootDir.erase(m_szRootDir.length() - 1);
+    }
+
+    m_mapEntries.clear();
+    m_bModified = false;
+
+    std::ifstream stateFile(GetStateFileName(m_szRootDir).c_str());
+    if (stateFile.is_open() == false) {
+        return false;
+    }
+
+    std::string szVersion = _T("");
+    int nVersion = 0;
+    stateFile >> szVersion >> nVersion;
+    if ( (szVersion != _T("Ver:")) || (nVersion != SYNC_STATE_FILE_VER) ) {
+        return false;
+    }
+
+    // Rest of the version line, then the root directory.
+    std::string szLine = _T("");
+    std::getline(stateFile, szLine);
+    std::getline(stateFile, szLine);
+
+    if (szLine != m_szRootDir) {
+        return false;
+    }
+
+    while (std::getline(stateFile, szLine)) {
+        // The path is last - it's the rest of the line.
+        std::string::size_type nPathStart = 0;
+        for (int nField = 0; (nField < 5) && (nPathStart != std::string::npos); nField++) {
+            nPathStart = szLine.find(_T('\t'), nPathStart);
+            if (nPathStart != std::string::npos) {
+                nPathStart++;
+            }
+        }
+
+        if ( (nPathStart == std::string::npos) || (nPathStart >= szLine.length()) ) {
+            ClientLog(UI_COMP, LOG_WARNING, false, _T("Sync state for %s is damaged."),
+                m_szRootDir.c_str());
+            m_mapEntries.clear();
+            return false;
+        }
+
+        std::istringstream fieldStream(szLine.substr(0, nPathStart));
+
+        SyncStateEntry stateEntry;
+        long lLastModified = 0;
+        LONG64 l64FileIndex = 0;
+        fieldStream >> stateEntry.l64FileSize >> lLastModified >> l64FileIndex
+                    >> stateEntry.l64FileID >> stateEntry.szHashMD5;
+
+        if (fieldStream.fail()) {
+            ClientLog(UI_COMP, LOG_WARNING, false, _T("Sync state for %s is damaged."),
+                m_szRootDir.c_str());
+            m_mapEntries.clear();
+            return false;
+        }
+
+        stateEntry.tmLastModified = (time_t)lLastModified;
+        stateEntry.ul64FileIndex = (UINT64)l64FileIndex;
+        stateEntry.bFound = false;
+
+        if (stateEntry.szHashMD5 == _T("-")) {
+            stateEntry.szHashMD5 = _T("");
+        }
+
+        m_mapEntries[szLine.substr(nPathStart)] = stateEntry;
+    }
+
+    return true;
+
+} // End Load
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Write the state to a temporary file, then replace the saved
+//!        state with it - an interrupted save leaves the previous
+//!        state intact.
+//! \param bRemoveMissing: true to drop the files not found by the walk.
+//! \return true if successful, false otherwise.
+bool SyncState::Save(bool bRemoveMissing)
+{
+    if (bRemoveMissing) {
+        SyncStateEntryMap::iterator iter = m_mapEntries.begin();
+        while (iter != m_mapEntries.end()) {
+            if (iter->second.bFound == false) {
+                m_mapEntries.erase(iter++);
+                m_bModified = true;
+            }
+            else {
+                ++iter;
+            }
+        }
+    }
+
+    if (m_bModified == false) {
+        return true;
+    }
+
+    std::string szStateFile = GetStateFileName(m_szRootDir);
+    std::string szTempFile = szStateFile + _T(".tmp");
+
+    FILE* pFile = fopen(szTempFile.c_str(), _T("wt"));
+    if (pFile == NULL) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Sync state %s could not be created."),
+            szTempFile.c_str());
+        return false;
+    }
+
+    fprintf(pFile, _T("Ver: %d\n%s\n"), SYNC_STATE_FILE_VER, m_szRootDir.c_str());
+
+    SyncStateEntryMap::iterator iter = m_mapEntries.begin();
+    for (; iter != m_mapEntries.end(); ++iter) {
+        const SyncStateEntry& stateEntry = iter->second;
+        std::string szHashMD5 = stateEntry.szHashMD5.empty() ? _T("-") : stateEntry.szHashMD5;
+
+        fprintf(pFile, DIOMEDE_LONG_FORMAT _T("\t%ld\t") DIOMEDE_LONG_FORMAT _T("\t")
+                DIOMEDE_LONG_FORMAT _T("\t%s\t%s\n"),
+                stateEntry.l64FileSize, (long)stateEntry.tmLastModified,
+                (LONG64)stateEntry.ul64FileIndex, stateEntry.l64FileID,
+                szHashMD5.c_str(), iter->first.c_str());
+    }
+
+    bool bSuccess = (ferror(pFile) == 0);
+    if (fclose(pFile) != 0) {
+        bSuccess = false;
+    }
+
+    if (bSuccess) {
+        #ifdef WIN32
+            // rename doesn't replace an existing file.
+            remove(szStateFile.c_str());
+        #endif
+        bSuccess = (rename(szTempFile.c_str(), szStateFile.c_str()) == 0);
+    }
+
+    if (bSuccess == false) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Sync state %s could not be saved."),
+            szStateFile.c_str());
+        remove(szTempFile.c_str());
+        return false;
+    }
+
+    m_bModified = false;
+    return true;
+
+} // End Save
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Compare a walked file with its state - the file is marked as
+//!        found.
+//! \param fileEntry: file found by the walk
+//! \return one of SyncFileStatusTypes.
+int SyncState::Check(const FileWalkerEntry& fileEntry)
+{
+    SyncStateEntryMap::iterator iter = m_mapEntries.find(GetRelativePath(fileEntry.szFilePath));
+    if (iter == m_mapEntries.end()) {
+        return syncFileNew;
+    }
+
+    SyncStateEntry& stateEntry = iter->second;
+    stateEntry.bFound = true;
+
+    if (stateEntry.l64FileSize != fileEntry.l64FileSize) {
+        return syncFileChanged;
+    }
+
+    if (IsTouched(stateEntry, fileEntry) == false) {
+        return syncFileUnchanged;
+    }
+
+    //-----------------------------------------------------------------
+    // Same size, but touched or replaced - reading the file is still
+    // cheaper than uploading it.
+    //-----------------------------------------------------------------
+    std::string szHashMD5 = _T("");
+    bool bHashed = false;
+
+    std::map<std::string, std::string>::iterator hashIter = m_mapTouchedHashes.find(fileEntry.szFilePath);
+    if (hashIter != m_mapTouchedHashes.end()) {
+        szHashMD5 = hashIter->second;
+        bHashed = true;
+        m_mapTouchedHashes.erase(hashIter);
+    }
+    else if (stateEntry.szHashMD5.empty() == false) {
+        bHashed = GetFileHash(fileEntry.szFilePath, szHashMD5);
+    }
+
+    if ( stateEntry.szHashMD5.empty() || (bHashed == false) ||
+         (szHashMD5 != stateEntry.szHashMD5) ) {
+        return syncFileChanged;
+    }
+
+    stateEntry.tmLastModified = GetRecordedTime(fileEntry.tmLastModified);
+    stateEntry.ul64FileIndex = fileEntry.ul64FileIndex;
+    m_bModified = true;
+
+    return syncFileUnchanged;
+
+} // End Check
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Hash the files Check would hash, several at a time - when
+//!        a tree is copied or touched, each of its files would
+//!        otherwise be opened and hashed in turn as it's checked.
+//! \param listFiles: files found by the walk
+void SyncState::HashTouchedFiles(const FileWalkerEntryList& listFiles)
+{
+    FileHashEntryList listHashFiles;
+
+    FileWalkerEntryList::const_iterator fileIter = listFiles.begin();
+    for (; fileIter != listFiles.end(); ++fileIter) {
+        SyncStateEntryMap::const_iterator iter = m_mapEntries.find(GetRelativePath(fileIter->szFilePath));
+        if ( (iter == m_mapEntries.end()) || iter->second.szHashMD5.empty() ||
+             (iter->second.l64FileSize != fileIter->l64FileSize) ||
+             (IsTouched(iter->second, *fileIter) == false) ) {
+            continue;
+        }
+
+        FileHashEntry hashEntry;
+        hashEntry.szFilePath = fileIter->szFilePath;
+        hashEntry.nResult = 0;
+        listHashFiles.push_back(hashEntry);
+    }
+
+    if (listHashFiles.size() < SYNC_STATE_MIN_HASH_BATCH) {
+        return;
+    }
+
+    FileHashBatch hashBatch;
+    hashBatch.HashFiles(listHashFiles);
+
+    for (int nIndex = 0; nIndex < (int)listHashFiles.size(); nIndex++) {
+        FileHashEntry& hashEntry = listHashFiles[nIndex];
+        if (hashEntry.nResult != 0) {
+            continue;
+        }
+
+        std::string szHashMD5 = _T("");
+        StringUtil::ConvertDigestToString(szHashMD5, hashEntry.digest);
+        m_mapTouchedHashes[hashEntry.szFilePath] = szHashMD5;
+    }
+
+} // End HashTouchedFiles
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Record a completed upload along with the MD5 digest of the
+//!        file.
+//! \param fileEntry: file found by the walk
+//! \param l64FileID: file ID of the upload
+//! \param szHashMD5: digest computed for the upload (/md5), empty if
+//!                  none - then the file is hashed.
+void SyncState::Update(const FileWalkerEntry& fileEntry, LONG64 l64FileID,
+                       const std::string& szHashMD5 /*""*/)
+{
+    std::string szRelativePath = GetRelativePath(fileEntry.szFilePath);
+
+    LONG64 l64FileSize = 0;
+    time_t tmLastModified = 0;
+    UINT64 ul64FileIndex = 0;
+
+    SyncStateEntry stateEntry;
+    stateEntry.szHashMD5 = szHashMD5;
+
+    // The file may have changed during the upload.
+    if ( (GetSyncFileInfo(fileEntry.szFilePath, l64FileSize, tmLastModified, ul64FileIndex) == false) ||
+         (l64FileSize != fileEntry.l64FileSize) || (tmLastModified != fileEntry.tmLastModified) ||
+         ( (stateEntry.szHashMD5.length() == 0) &&
+           (GetFileHash(fileEntry.szFilePath, stateEntry.szHashMD5) == false) ) ) {
+
+        if (m_mapEntries.erase(szRelativePath) > 0) {
+            m_bModified = true;
+        }
+        return;
+    }
+
+    stateEntry.l64FileSize = l64FileSize;
+    stateEntry.tmLastModified = GetRecordedTime(tmLastModified);
+    stateEntry.ul64FileIndex = ul64FileIndex;
+    stateEntry.l64FileID = l64FileID;
+    stateEntry.bFound = true;
+
+    m_mapEntries[szRelativePath] = stateEntry;
+    m_bModified = true;
+
+} // End Update
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Path of a walked file relative to the root directory.
+std::string SyncState::GetRelativePath(const std::string& szFilePath) const
+{
+    if ( (szFilePath.length() > m_szRootDir.length()) &&
+         (szFilePath.compare(0, m_szRootDir.length(), m_szRootDir) == 0) ) {
+
+        std::string::size_type nStart = m_szRootDir.length();
+        if ( (szFilePath[nStart] == _T('/')) || (szFilePath[nStart] == _T('\\')) ) {
+            nStart++;
+        }
+
+        return szFilePath.substr(nStart);
+    }
+
+    return szFilePath;
+
+} // End GetRelativePath
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Whether a file of the same size as its state was touched or
+//!        replaced since - an inode of 0 is unknown, and matches any.
+bool SyncState::IsTouched(const SyncStateEntry& stateEntry, const FileWalkerEntry& fileEntry)
+{
+    bool bSameIndex = ( (stateEntry.ul64FileIndex == 0) || (fileEntry.ul64FileIndex == 0) ||
+                        (stateEntry.ul64FileIndex == fileEntry.ul64FileIndex) );
+
+    return ( (bSameIndex == false) || (stateEntry.tmLastModified != fileEntry.tmLastModified) );
+
+} // End IsTouched
+
+///////////////////////////////////////////////////////////////////////
+//! \brief MD5 digest of a file as a hex string.
+//! \return true if the file could be read, false otherwise.
+bool SyncState::GetFileHash(const std::string& szFilePath, std::string& szHashMD5)
+{
+    unsigned char szDigest[MD5_DIGEST_LENGTH];
+    if (StringUtil::MakeFileMd5Digest((char*)szFilePath.c_str(), szDigest) != 0) {
+        return false;
+    }
+
+    StringUtil::ConvertDigestToString(szHashMD5, szDigest);
+    return true;
+
+} // End GetFileHash
+
+/** @} */
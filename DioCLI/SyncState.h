@@ -0,0 +1,156 @@
+/*********************************************************************
+ *
+ *  file:  SyncState.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Local state of the files uploaded by the sync command,
+ *          used to upload only the new and changed files of a tree.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __SYNC_STATE_H__
+#define __SYNC_STATE_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+#include "FileWalker.h"
+
+#include <string>
+#include <map>
+
+#define SYNC_STATE_FILE_VER             1
+#define SYNC_STATE_FILE_PREFIX          _T("syncstate_")
+#define SYNC_STATE_FILE_EXT             _T(".db")
+
+//---------------------------------------------------------------------
+//! Uploads between saves of the state - an interrupted sync loses at
+//! most this many entries, which are uploaded again.
+//---------------------------------------------------------------------
+#define SYNC_STATE_SAVE_INTERVAL        50
+
+//---------------------------------------------------------------------
+//! Touched files hashed together rather than one at a time as they're
+//! checked - below this, starting the readers costs more than it saves.
+//---------------------------------------------------------------------
+#define SYNC_STATE_MIN_HASH_BATCH       256
+
+//---------------------------------------------------------------------
+//! Result of checking a walked file against the state.
+//---------------------------------------------------------------------
+namespace SyncFileStatusTypes {
+    typedef enum SyncFileStatusType {
+        syncFileNew = 0,
+        syncFileChanged,
+        syncFileUnchanged
+    } SyncFileStatusTypes;
+}
+
+///////////////////////////////////////////////////////////////////////
+//! \struct SyncStateEntry
+//! \brief State of an uploaded file.
+struct SyncStateEntry
+{
+    LONG64                      l64FileSize;
+    time_t                      tmLastModified;
+    UINT64                      ul64FileIndex;                  //! Inode, 0 if unknown
+    LONG64                      l64FileID;
+    std::string                 szHashMD5;
+    bool                        bFound;                         //! Found by the current walk
+};
+
+typedef std::map<std::string, SyncStateEntry> SyncStateEntryMap;
+
+///////////////////////////////////////////////////////////////////////
+//! \class SyncState
+//! \brief Size, last modified time, inode, MD5 digest and file ID of
+//!        each file uploaded from a directory tree.  The state of each
+//!        tree is saved in the application data directory, keyed by
+//!        the path relative to the tree.
+//!
+//! Usage:
+//!      SyncState syncState;
+//!      syncState.Load(szRootDir);
+//!      if (syncState.Check(fileEntry) != syncFileUnchanged) {
+//!          ...upload...
+//!          syncState.Update(fileEntry, l64FileID, szHashMD5);
+//!      }
+//!      syncState.Save(true);
+//!
+//! A file is unchanged when its size, last modified time and inode
+//! match the state.  When only the time or inode differ (a copy or a
+//! touch), the file is hashed and compared with the saved digest
+//! instead of being uploaded again - HashTouchedFiles hashes a tree's
+//! worth of these up front.
+class SyncState
+{
+private:
+    std::string                 m_szRootDir;
+    SyncStateEntryMap           m_mapEntries;
+    bool                        m_bModified;
+
+    //! Digests from HashTouchedFiles, by file path, until checked.
+    std::map<std::string, std::string>  m_mapTouchedHashes;
+
+public:
+    SyncState();
+    virtual ~SyncState() {}
+
+    //-----------------------------------------------------------------
+    //! \brief Read the saved state of the tree.
+    //! \return true if the state was read, false if there is none (or
+    //!         it couldn't be read) - every file is then new.
+    //-----------------------------------------------------------------
+    bool Load(const std::string& szRootDir);
+
+    //-----------------------------------------------------------------
+    //! \brief Write the state, replacing the saved state of the tree.
+    //! \param bRemoveMissing: true once the walk and the uploads are
+    //!        complete - drops the files the walk no longer found.
+    //! \return true if successful, false otherwise.
+    //-----------------------------------------------------------------
+    bool Save(bool bRemoveMissing);
+
+    //-----------------------------------------------------------------
+    //! \brief Compare a walked file with its state.
+    //! \return one of SyncFileStatusTypes.
+    //-----------------------------------------------------------------
+    int Check(const FileWalkerEntry& fileEntry);
+
+    //-----------------------------------------------------------------
+    //! \brief Hash the walked files Check would hash - those with the
+    //!        size of their state but another time or inode - reading
+    //!        several at once.  Check then uses these digests.
+    //-----------------------------------------------------------------
+    void HashTouchedFiles(const FileWalkerEntryList& listFiles);
+
+    //-----------------------------------------------------------------
+    //! \brief Record a completed upload - skipped if the file changed
+    //!        during the upload, so the next sync uploads it again.
+    //!        The file is only hashed when no digest is passed in.
+    //-----------------------------------------------------------------
+    void Update(const FileWalkerEntry& fileEntry, LONG64 l64FileID,
+                const std::string& szHashMD5=_T(""));
+
+    int GetEntryCount() const { return (int)m_mapEntries.size(); }
+
+    //! Saved state file for the given tree.
+    static std::string GetStateFileName(const std::string& szRootDir);
+
+private:
+    std::string GetRelativePath(const std::string& szFilePath) const;
+    static bool IsTouched(const SyncStateEntry& stateEntry, const FileWalkerEntry& fileEntry);
+    static bool GetFileHash(const std::string& szFilePath, std::string& szHashMD5);
+
+}; // End SyncState
+
+#endif // __SYNC_STATE_H__
+
+/** @} */
@@ -0,0 +1,639 @@
+/*********************************************************************
+ *
+ *  file:  TransferMetrics.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Singleton class that records per-chunk and per-file
+ *          transfer metrics (latency, throughput, retries and
+ *          resume events) to a JSON lines or CSV file.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "TransferMetrics.h"
+
+#include "../Util/ClientLog.h"
+#include "../Util/XString.h"
+
+#include "../Include/ErrorCodes/UIErrors.h"
+
+using namespace TransferMetricsTypes;
+using namespace boost::posix_time;
+
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+static const char* g_szDirection[] = { _T("upload"), _T("download") };
+
+//---------------------------------------------------------------------
+// Helpers for quoting strings in either format.
+//---------------------------------------------------------------------
+static std::string QuoteJSON(const std::string& szValue)
+{
+    std::string szQuoted = _T("\"");
+
+    for (int nIndex = 0; nIndex < (int)szValue.length(); nIndex++) {
+        char ch = szValue[nIndex];
+        switch (ch) {
+            case '"':   szQuoted += _T("\\\"");   break;
+            case '\\':  szQuoted += _T("\\\\");   break;
+            case '\n':  szQuoted += _T("\\n");    break;
+            case '\r':  szQuoted += _T("\\r");    break;
+            case '\t':  szQuoted += _T("\\t");    break;
+            default:
+                if ((unsigned char)ch < 0x20) {
+                    szQuoted += _format(_T("\\u%04x"), (int)(unsigned char)ch);
+                }
+                else {
+                    szQuoted += ch;
+                }
+                break;
+        }
+    }
+
+    szQuoted += _T("\"");
+    return szQuoted;
+}
+
+static std::string QuoteCSV(const std::string& szValue)
+{
+    std::string szQuoted = _T("\"");
+
+    for (int nIndex = 0; nIndex < (int)szValue.length(); nIndex++) {
+        if (szValue[nIndex] == '"') {
+            szQuoted += _T("\"\"");
+        }
+        else {
+            szQuoted += szValue[nIndex];
+        }
+    }
+
+    szQuoted += _T("\"");
+    return szQuoted;
+}
+
+static std::string FormatLong64(LONG64 l64Value)
+{
+    return _format(DIOMEDE_LONG_FORMAT, l64Value);
+}
+
+///////////////////////////////////////////////////////////////////////
+TransferMetrics* TransferMetrics::m_pTransferMetrics = NULL;
+
+///////////////////////////////////////////////////////////////////////
+// TransferMetrics Constructor
+TransferMetrics::TransferMetrics() : m_pMetricsFile(NULL), m_nFormat(metricsFormatJSONL)
+{
+    ClearTotals();
+
+} // End Constructor
+
+///////////////////////////////////////////////////////////////////////
+// TransferMetrics Destructor
+TransferMetrics::~TransferMetrics()
+{
+    Close();
+
+} // End Destructor
+
+///////////////////////////////////////////////////////////////////////
+//! TransferMetrics Instance
+TransferMetrics* TransferMetrics::Instance()
+{
+	if (m_pTransferMetrics == NULL) {
+	    m_pTransferMetrics = new TransferMetrics;
+	}
+
+	return m_pTransferMetrics;
+
+} // End Instance
+
+///////////////////////////////////////////////////////////////////////
+//! TransferMetrics Shutdown
+void TransferMetrics::Shutdown()
+{
+	if ( this == m_pTransferMetrics )
+		m_pTransferMetrics = NULL;
+
+	delete this;
+
+} // End Shutdown
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Resets the totals and histograms.
+void TransferMetrics::ClearTotals()
+{
+    m_nTotalFiles = 0;
+    m_nTotalFailed = 0;
+    m_nTotalChunks = 0;
+    m_nTotalRetries = 0;
+    m_nTotalResumes = 0;
+    m_l64TotalBytes = 0;
+    m_l64TotalMilliseconds = 0;
+
+    for (int nIndex = 0; nIndex < METRICS_HISTOGRAM_BUCKETS; nIndex++) {
+        m_chunkLatency[nIndex] = 0;
+        m_fileThroughput[nIndex] = 0;
+    }
+
+} // End ClearTotals
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns the milliseconds between two times.
+LONG64 TransferMetrics::GetElapsedMilliseconds(const ptime& tmStart, const ptime& tmEnd)
+{
+    if (tmStart.is_not_a_date_time() || tmEnd.is_not_a_date_time()) {
+        return 0;
+    }
+
+    time_duration tdElapsed = tmEnd - tmStart;
+    return (LONG64)tdElapsed.total_milliseconds();
+
+} // End GetElapsedMilliseconds
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns the histogram bucket for a value - bucket 0 holds
+//!        values below 1, bucket n values below 2^n.
+int TransferMetrics::GetBucket(LONG64 l64Value)
+{
+    int nBucket = 0;
+    while ( (l64Value > 0) && (nBucket < METRICS_HISTOGRAM_BUCKETS - 1) ) {
+        l64Value >>= 1;
+        nBucket ++;
+    }
+    return nBucket;
+
+} // End GetBucket
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Open (append) the metrics file.
+//! \param szMetricsFile: full path of the metrics file.
+//! \param nFormat: MetricsFormatType
+//! \return true if successful, false otherwise.
+bool TransferMetrics::Open(const std::string& szMetricsFile, int nFormat)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if (m_pMetricsFile != NULL) {
+        fclose(m_pMetricsFile);
+        m_pMetricsFile = NULL;
+    }
+
+    if (szMetricsFile.length() == 0) {
+        return false;
+    }
+
+    m_pMetricsFile = fopen(szMetricsFile.c_str(), _T("a"));
+    if (m_pMetricsFile == NULL) {
+        ClientLog(UI_COMP, LOG_ERROR, false, _T("Failed to open metrics file %s."),
+            szMetricsFile.c_str());
+        return false;
+    }
+
+    m_nFormat = (nFormat == metricsFormatCSV) ? metricsFormatCSV : metricsFormatJSONL;
+
+    // New CSV files start with the column names.
+    fseek(m_pMetricsFile, 0, SEEK_END);
+    if ( (m_nFormat == metricsFormatCSV) && (ftell(m_pMetricsFile) == 0) ) {
+        fputs(_T("time,event,direction,file_id,file,offset,bytes,ms,kbps,result,detail\n"),
+              m_pMetricsFile);
+    }
+
+    return true;
+
+} // End Open
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Close the metrics file.
+void TransferMetrics::Close()
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if (m_pMetricsFile != NULL) {
+        fclose(m_pMetricsFile);
+        m_pMetricsFile = NULL;
+    }
+
+} // End Close
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Returns the transfer in progress for a key.
+//! \param pTransfer: transfer key, NULL for a serial transfer.
+//! \return the transfer, NULL if none was begun.  Requires m_lock.
+TransferMetrics::TransferState* TransferMetrics::FindTransfer(const void* pTransfer)
+{
+    TransferStateMap::iterator iter = m_mapTransfers.find(pTransfer);
+    if (iter == m_mapTransfers.end()) {
+        return NULL;
+    }
+    return &iter->second;
+
+} // End FindTransfer
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Formats the fields common to every transfer record.
+//! \param transfer: transfer the record is for.
+//! \param szEvent: event name.
+//! \return the start of the record.
+std::string TransferMetrics::FormatRecordStart(const TransferState& transfer,
+                                               const std::string& szEvent)
+{
+    static const ptime tmEpoch(boost::gregorian::date(1970, 1, 1));
+    LONG64 l64Now = GetElapsedMilliseconds(tmEpoch, microsec_clock::universal_time());
+
+    if (m_nFormat == metricsFormatCSV) {
+        return FormatLong64(l64Now) + _T(",") + szEvent + _T(",") +
+               g_szDirection[transfer.m_nDirection] + _T(",") +
+               FormatLong64(transfer.m_l64FileID) + _T(",") + QuoteCSV(transfer.m_szFilePath);
+    }
+
+    return _T("{\"time\":") + FormatLong64(l64Now) +
+           _T(",\"event\":") + QuoteJSON(szEvent) +
+           _T(",\"direction\":") + QuoteJSON(g_szDirection[transfer.m_nDirection]) +
+           _T(",\"file_id\":") + FormatLong64(transfer.m_l64FileID) +
+           _T(",\"file\":") + QuoteJSON(transfer.m_szFilePath);
+
+} // End FormatRecordStart
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Writes a record built by the event functions.  Requires
+//!        m_lock.
+void TransferMetrics::WriteRecord(const std::string& szRecord)
+{
+    if (m_pMetricsFile == NULL) {
+        return;
+    }
+
+    fputs(szRecord.c_str(), m_pMetricsFile);
+    fputs(_T("\n"), m_pMetricsFile);
+
+} // End WriteRecord
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Start tracking a file transfer.
+//! \param nDirection: TransferDirectionType
+//! \param szFilePath: file uploaded or downloaded.
+//! \param l64FileID: file ID, 0 if not yet known.
+//! \param l64FileSize: file size, 0 if not yet known.
+//! \param l64StartBytes: bytes already transferred (e.g. on resume).
+//! \param pTransfer: transfer key, NULL for a serial transfer.
+void TransferMetrics::BeginTransfer(int nDirection, const std::string& szFilePath,
+                                    LONG64 l64FileID, LONG64 l64FileSize,
+                                    LONG64 l64StartBytes /*0*/, const void* pTransfer /*NULL*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if (m_pMetricsFile == NULL) {
+        return;
+    }
+
+    TransferState& transfer = m_mapTransfers[pTransfer];
+
+    transfer.m_nDirection = (nDirection == transferDownload) ? transferDownload : transferUpload;
+    transfer.m_szFilePath = szFilePath;
+    transfer.m_l64FileID = l64FileID;
+    transfer.m_l64FileSize = l64FileSize;
+    transfer.m_l64StartBytes = l64StartBytes;
+    transfer.m_l64LastBytes = l64StartBytes;
+    transfer.m_l64MinChunkBytes = (transfer.m_nDirection == transferDownload) ?
+                                  METRICS_MIN_DOWNLOAD_CHUNK : 0;
+    transfer.m_nChunks = 0;
+    transfer.m_nRetries = 0;
+    transfer.m_nResumes = 0;
+
+    transfer.m_tmTransferStart = microsec_clock::universal_time();
+    transfer.m_tmChunkStart = transfer.m_tmTransferStart;
+
+    std::string szRecord = FormatRecordStart(transfer, _T("start"));
+    if (m_nFormat == metricsFormatCSV) {
+        szRecord += _T(",") + FormatLong64(l64StartBytes) + _T(",") + FormatLong64(l64FileSize) +
+                    _T(",,,,");
+    }
+    else {
+        szRecord += _T(",\"offset\":") + FormatLong64(l64StartBytes) +
+                    _T(",\"size\":") + FormatLong64(l64FileSize) + _T("}");
+    }
+
+    WriteRecord(szRecord);
+
+} // End BeginTransfer
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Updates the file size once known (e.g. download).
+void TransferMetrics::SetTransferFileSize(LONG64 l64FileSize, const void* pTransfer /*NULL*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    TransferState* pState = FindTransfer(pTransfer);
+    if (pState != NULL) {
+        pState->m_l64FileSize = l64FileSize;
+    }
+
+} // End SetTransferFileSize
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Marks the start of a chunk send - if not called, chunk
+//!        latency is measured from the previous chunk.
+void TransferMetrics::ChunkStarted(const void* pTransfer /*NULL*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    TransferState* pState = FindTransfer(pTransfer);
+    if (pState == NULL) {
+        return;
+    }
+
+    pState->m_tmChunkStart = microsec_clock::universal_time();
+
+} // End ChunkStarted
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Records a completed chunk.
+//! \param l64CurrentBytes: total bytes transferred so far.
+//! \param bForce: write the record even if the chunk is below the
+//!        minimum chunk size.
+//! \param pTransfer: transfer key, NULL for a serial transfer.
+void TransferMetrics::ChunkComplete(LONG64 l64CurrentBytes, bool bForce /*false*/,
+                                    const void* pTransfer /*NULL*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    TransferState* pState = FindTransfer(pTransfer);
+    if (pState == NULL) {
+        return;
+    }
+
+    RecordChunk(*pState, l64CurrentBytes, bForce);
+
+} // End ChunkComplete
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Writes a chunk record and counts the chunk.  Requires
+//!        m_lock.
+void TransferMetrics::RecordChunk(TransferState& transfer, LONG64 l64CurrentBytes, bool bForce)
+{
+    LONG64 l64ChunkBytes = l64CurrentBytes - transfer.m_l64LastBytes;
+    if ( (l64ChunkBytes <= 0) || ( (l64ChunkBytes < transfer.m_l64MinChunkBytes) && !bForce) ) {
+        return;
+    }
+
+    ptime tmNow = microsec_clock::universal_time();
+    LONG64 l64Milliseconds = GetElapsedMilliseconds(transfer.m_tmChunkStart, tmNow);
+    LONG64 l64KBps = (l64Milliseconds > 0) ? ((l64ChunkBytes * 1000) / l64Milliseconds) / 1024 : 0;
+
+    std::string szRecord = FormatRecordStart(transfer, _T("chunk"));
+    if (m_nFormat == metricsFormatCSV) {
+        szRecord += _T(",") + FormatLong64(transfer.m_l64LastBytes) + _T(",") +
+                    FormatLong64(l64ChunkBytes) + _T(",") + FormatLong64(l64Milliseconds) +
+                    _T(",") + FormatLong64(l64KBps) + _T(",,");
+    }
+    else {
+        szRecord += _T(",\"offset\":") + FormatLong64(transfer.m_l64LastBytes) +
+                    _T(",\"bytes\":") + FormatLong64(l64ChunkBytes) +
+                    _T(",\"ms\":") + FormatLong64(l64Milliseconds) +
+                    _T(",\"kbps\":") + FormatLong64(l64KBps) + _T("}");
+    }
+
+    WriteRecord(szRecord);
+
+    m_chunkLatency[GetBucket(l64Milliseconds)] ++;
+    transfer.m_nChunks ++;
+    transfer.m_l64LastBytes = l64CurrentBytes;
+    transfer.m_tmChunkStart = tmNow;
+
+} // End RecordChunk
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Records a retry of a transfer (e.g. after the session
+//!        expired).
+//! \param szReason: short description of the retry.
+//! \param pTransfer: transfer key, NULL for a serial transfer.
+void TransferMetrics::RecordRetry(const std::string& szReason, const void* pTransfer /*NULL*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    TransferState* pState = FindTransfer(pTransfer);
+    if (pState == NULL) {
+        return;
+    }
+
+    std::string szRecord = FormatRecordStart(*pState, _T("retry"));
+    if (m_nFormat == metricsFormatCSV) {
+        szRecord += _T(",") + FormatLong64(pState->m_l64LastBytes) + _T(",,,,,") +
+                    QuoteCSV(szReason);
+    }
+    else {
+        szRecord += _T(",\"offset\":") + FormatLong64(pState->m_l64LastBytes) +
+                    _T(",\"detail\":") + QuoteJSON(szReason) + _T("}");
+    }
+
+    WriteRecord(szRecord);
+    pState->m_nRetries ++;
+
+} // End RecordRetry
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Records a resume of a transfer following a connection
+//!        error.
+//! \param nResumeInterval: retry attempt (1 for the first).
+//! \param l64CurrentBytes: bytes transferred when resumed.
+//! \param pTransfer: transfer key, NULL for a serial transfer.
+void TransferMetrics::RecordResume(int nResumeInterval, LONG64 l64CurrentBytes,
+                                   const void* pTransfer /*NULL*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    TransferState* pState = FindTransfer(pTransfer);
+    if (pState == NULL) {
+        return;
+    }
+
+    std::string szInterval = _format(_T("attempt %d"), nResumeInterval);
+
+    std::string szRecord = FormatRecordStart(*pState, _T("resume"));
+    if (m_nFormat == metricsFormatCSV) {
+        szRecord += _T(",") + FormatLong64(l64CurrentBytes) + _T(",,,,,") + QuoteCSV(szInterval);
+    }
+    else {
+        szRecord += _T(",\"offset\":") + FormatLong64(l64CurrentBytes) +
+                    _T(",\"detail\":") + QuoteJSON(szInterval) + _T("}");
+    }
+
+    WriteRecord(szRecord);
+    pState->m_nResumes ++;
+
+    // The next chunk is timed from the resume.
+    pState->m_l64LastBytes = l64CurrentBytes;
+    pState->m_tmChunkStart = microsec_clock::universal_time();
+
+} // End RecordResume
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Records the end of a transfer.
+//! \param nResult: 0 if successful, error otherwise.
+//! \param pTransfer: transfer key, NULL for a serial transfer.
+void TransferMetrics::EndTransfer(int nResult, const void* pTransfer /*NULL*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    TransferState* pState = FindTransfer(pTransfer);
+    if (pState == NULL) {
+        return;
+    }
+
+    TransferState& transfer = *pState;
+
+    // Pick up any remaining partial chunk.
+    if (nResult == 0) {
+        LONG64 l64FinalBytes = (transfer.m_l64FileSize > transfer.m_l64LastBytes) ?
+                               transfer.m_l64FileSize : transfer.m_l64LastBytes;
+        RecordChunk(transfer, l64FinalBytes, true);
+    }
+
+    LONG64 l64Milliseconds = GetElapsedMilliseconds(transfer.m_tmTransferStart,
+                                                    microsec_clock::universal_time());
+    LONG64 l64Bytes = transfer.m_l64LastBytes - transfer.m_l64StartBytes;
+    LONG64 l64KBps = (l64Milliseconds > 0) ? ((l64Bytes * 1000) / l64Milliseconds) / 1024 : 0;
+
+    std::string szRecord = FormatRecordStart(transfer, _T("end"));
+    if (m_nFormat == metricsFormatCSV) {
+        szRecord += _T(",") + FormatLong64(transfer.m_l64StartBytes) + _T(",") +
+                    FormatLong64(l64Bytes) + _T(",") + FormatLong64(l64Milliseconds) +
+                    _T(",") + FormatLong64(l64KBps) + _T(",") + _format(_T("%d"), nResult) +
+                    _T(",") + QuoteCSV(_format(_T("chunks %d retries %d resumes %d"),
+                                               transfer.m_nChunks, transfer.m_nRetries,
+                                               transfer.m_nResumes));
+    }
+    else {
+        szRecord += _T(",\"offset\":") + FormatLong64(transfer.m_l64StartBytes) +
+                    _T(",\"bytes\":") + FormatLong64(l64Bytes) +
+                    _T(",\"ms\":") + FormatLong64(l64Milliseconds) +
+                    _T(",\"kbps\":") + FormatLong64(l64KBps) +
+                    _format(_T(",\"result\":%d,\"chunks\":%d,\"retries\":%d,\"resumes\":%d}"),
+                            nResult, transfer.m_nChunks, transfer.m_nRetries,
+                            transfer.m_nResumes);
+    }
+
+    WriteRecord(szRecord);
+    fflush(m_pMetricsFile);
+
+    m_nTotalFiles ++;
+    if (nResult != 0) {
+        m_nTotalFailed ++;
+    }
+    else {
+        m_fileThroughput[GetBucket(l64KBps)] ++;
+    }
+
+    m_nTotalChunks += transfer.m_nChunks;
+    m_nTotalRetries += transfer.m_nRetries;
+    m_nTotalResumes += transfer.m_nResumes;
+    m_l64TotalBytes += l64Bytes;
+    m_l64TotalMilliseconds += l64Milliseconds;
+
+    m_mapTransfers.erase(pTransfer);
+
+} // End EndTransfer
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Write the totals and histograms gathered since the last
+//!        summary to the metrics file and the log.
+void TransferMetrics::WriteSummary()
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if ( (m_pMetricsFile == NULL) || (m_nTotalFiles == 0) ) {
+        return;
+    }
+
+    static const ptime tmEpoch(boost::gregorian::date(1970, 1, 1));
+    std::string szNow = FormatLong64(GetElapsedMilliseconds(tmEpoch, microsec_clock::universal_time()));
+
+    LONG64 l64KBps = (m_l64TotalMilliseconds > 0) ?
+        ((m_l64TotalBytes * 1000) / m_l64TotalMilliseconds) / 1024 : 0;
+
+    std::string szTotals = _format(_T("files %d failed %d chunks %d retries %d resumes %d"),
+        m_nTotalFiles, m_nTotalFailed, m_nTotalChunks, m_nTotalRetries, m_nTotalResumes);
+
+    CLIENTLOG_PERFORMANCE(UI_COMP, false, _T("Transfer summary: %s, %s bytes, %s ms, %s KB/s"),
+        szTotals.c_str(), FormatLong64(m_l64TotalBytes).c_str(),
+        FormatLong64(m_l64TotalMilliseconds).c_str(), FormatLong64(l64KBps).c_str());
+
+    std::string szRecord = _T("");
+    std::string szLatency = _T("");
+    std::string szThroughput = _T("");
+    int nIndex = 0;
+
+    if (m_nFormat == metricsFormatCSV) {
+        szRecord = szNow + _T(",summary,,,,,") + FormatLong64(m_l64TotalBytes) + _T(",") +
+                   FormatLong64(m_l64TotalMilliseconds) + _T(",") + FormatLong64(l64KBps) +
+                   _T(",,") + QuoteCSV(szTotals);
+        WriteRecord(szRecord);
+
+        // One row per non-empty bucket - the offset column holds the
+        // bucket's upper bound, the bytes column the count.
+        for (nIndex = 0; nIndex < METRICS_HISTOGRAM_BUCKETS; nIndex++) {
+            if (m_chunkLatency[nIndex] > 0) {
+                WriteRecord(szNow + _T(",chunk_latency_ms,,,,") +
+                    FormatLong64((LONG64)1 << nIndex) + _format(_T(",%d,,,,"), m_chunkLatency[nIndex]));
+            }
+        }
+        for (nIndex = 0; nIndex < METRICS_HISTOGRAM_BUCKETS; nIndex++) {
+            if (m_fileThroughput[nIndex] > 0) {
+                WriteRecord(szNow + _T(",file_kbps,,,,") +
+                    FormatLong64((LONG64)1 << nIndex) + _format(_T(",%d,,,,"), m_fileThroughput[nIndex]));
+            }
+        }
+    }
+    else {
+        for (nIndex = 0; nIndex < METRICS_HISTOGRAM_BUCKETS; nIndex++) {
+            if (m_chunkLatency[nIndex] > 0) {
+                if (szLatency.length() > 0) {
+                    szLatency += _T(",");
+                }
+                szLatency += _T("\"<") + FormatLong64((LONG64)1 << nIndex) +
+                             _format(_T("\":%d"), m_chunkLatency[nIndex]);
+            }
+            if (m_fileThroughput[nIndex] > 0) {
+                if (szThroughput.length() > 0) {
+                    szThroughput += _T(",");
+                }
+                szThroughput += _T("\"<") + FormatLong64((LONG64)1 << nIndex) +
+                                _format(_T("\":%d"), m_fileThroughput[nIndex]);
+            }
+        }
+
+        szRecord = _T("{\"time\":") + szNow + _T(",\"event\":\"summary\"") +
+                   _format(_T(",\"files\":%d,\"failed\":%d,\"chunks\":%d,\"retries\":%d,\"resumes\":%d"),
+                           m_nTotalFiles, m_nTotalFailed, m_nTotalChunks, m_nTotalRetries,
+                           m_nTotalResumes) +
+                   _T(",\"bytes\":") + FormatLong64(m_l64TotalBytes) +
+                   _T(",\"ms\":") + FormatLong64(m_l64TotalMilliseconds) +
+                   _T(",\"kbps\":") + FormatLong64(l64KBps) +
+                   _T(",\"chunk_latency_ms\":{") + szLatency + _T("}") +
+                   _T(",\"file_kbps\":{") + szThroughput + _T("}}");
+        WriteRecord(szRecord);
+    }
+
+    // Mirror the chunk latency histogram to the log.
+    for (nIndex = 0; nIndex < METRICS_HISTOGRAM_BUCKETS; nIndex++) {
+        if (m_chunkLatency[nIndex] > 0) {
+            CLIENTLOG_PERFORMANCE(UI_COMP, true, _T("  chunk latency < %s ms: %d"),
+                FormatLong64((LONG64)1 << nIndex).c_str(), m_chunkLatency[nIndex]);
+        }
+    }
+
+    fflush(m_pMetricsFile);
+    ClearTotals();
+
+} // End WriteSummary
+
+/** @} */
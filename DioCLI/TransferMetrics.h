@@ -0,0 +1,167 @@
+/*********************************************************************
+ *
+ *  file:  TransferMetrics.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Singleton class that records per-chunk and per-file
+ *          transfer metrics (latency, throughput, retries and
+ *          resume events) to a JSON lines or CSV file.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __TRANSFER_METRICS_H__
+#define __TRANSFER_METRICS_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+#include "../Util/CriticalSection.h"
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include <map>
+#include <string>
+
+//---------------------------------------------------------------------
+//! Metrics file formats.
+//---------------------------------------------------------------------
+namespace TransferMetricsTypes {
+    typedef enum MetricsFormat {
+        metricsFormatJSONL = 0,
+        metricsFormatCSV
+    } MetricsFormatType;
+
+    typedef enum TransferDirection {
+        transferUpload = 0,
+        transferDownload
+    } TransferDirectionType;
+}
+
+//---------------------------------------------------------------------
+//! Histogram buckets are powers of 2 - chunk latency in milliseconds
+//! and file throughput in KB/s.  The last bucket holds everything
+//! above.
+//---------------------------------------------------------------------
+#define METRICS_HISTOGRAM_BUCKETS       20
+
+//---------------------------------------------------------------------
+//! Download progress is reported in small increments - samples are
+//! combined until at least this many bytes have been received.
+//---------------------------------------------------------------------
+#define METRICS_MIN_DOWNLOAD_CHUNK      524288
+
+/////////////////////////////////////////////////////////////////////////////
+// TransferMetrics Class
+
+class TransferMetrics
+{
+protected:
+    static TransferMetrics*     m_pTransferMetrics;
+
+private:
+    FILE*                       m_pMetricsFile;
+    int                         m_nFormat;                      //! MetricsFormatType
+
+    //-----------------------------------------------------------------
+    //! Transfers in progress, by key - serial transfers use the NULL
+    //! key, parallel transfers their worker, so concurrent transfers
+    //! each keep their own numbers.
+    //-----------------------------------------------------------------
+    struct TransferState
+    {
+        int                         m_nDirection;               //! TransferDirectionType
+        std::string                 m_szFilePath;
+        LONG64                      m_l64FileID;
+        LONG64                      m_l64FileSize;
+        LONG64                      m_l64StartBytes;            //! Non-zero on resume
+        LONG64                      m_l64LastBytes;
+        LONG64                      m_l64MinChunkBytes;
+        int                         m_nChunks;
+        int                         m_nRetries;
+        int                         m_nResumes;
+        boost::posix_time::ptime    m_tmTransferStart;
+        boost::posix_time::ptime    m_tmChunkStart;
+    };
+
+    typedef std::map<const void*, TransferState> TransferStateMap;
+    TransferStateMap            m_mapTransfers;
+
+    //-----------------------------------------------------------------
+    //! Totals since the last summary
+    //-----------------------------------------------------------------
+    int                         m_nTotalFiles;
+    int                         m_nTotalFailed;
+    int                         m_nTotalChunks;
+    int                         m_nTotalRetries;
+    int                         m_nTotalResumes;
+    LONG64                      m_l64TotalBytes;
+    LONG64                      m_l64TotalMilliseconds;
+    int                         m_chunkLatency[METRICS_HISTOGRAM_BUCKETS];
+    int                         m_fileThroughput[METRICS_HISTOGRAM_BUCKETS];
+
+    DIOMEDE_CRITICAL::CCriticalSection  m_lock;
+
+public:
+    static TransferMetrics* Instance();
+    virtual ~TransferMetrics();
+
+	// Cleanup the metrics manager.
+	void Shutdown();
+
+private:
+    TransferMetrics();
+
+    void ClearTotals();
+    LONG64 GetElapsedMilliseconds(const boost::posix_time::ptime& tmStart,
+                                  const boost::posix_time::ptime& tmEnd);
+    static int GetBucket(LONG64 l64Value);
+
+    TransferState* FindTransfer(const void* pTransfer);
+    std::string FormatRecordStart(const TransferState& transfer, const std::string& szEvent);
+    void WriteRecord(const std::string& szRecord);
+    void RecordChunk(TransferState& transfer, LONG64 l64CurrentBytes, bool bForce);
+
+public:
+	//-----------------------------------------------------------------
+	//! \brief Open (append) the metrics file.
+	//! \param szMetricsFile: full path of the metrics file.
+	//! \param nFormat: MetricsFormatType
+	//! \return true if successful, false otherwise.
+	//-----------------------------------------------------------------
+    bool Open(const std::string& szMetricsFile, int nFormat);
+    void Close();
+    bool IsEnabled() { return (m_pMetricsFile != NULL); }
+
+	//-----------------------------------------------------------------
+	//! \name Transfer events - no-ops when metrics are disabled.
+	//!       pTransfer keys the transfer - NULL for a serial transfer,
+	//!       the worker for one of several running at once.
+	//! @{
+	//-----------------------------------------------------------------
+    void BeginTransfer(int nDirection, const std::string& szFilePath, LONG64 l64FileID,
+                       LONG64 l64FileSize, LONG64 l64StartBytes=0, const void* pTransfer=NULL);
+    void SetTransferFileSize(LONG64 l64FileSize, const void* pTransfer=NULL);
+    void ChunkStarted(const void* pTransfer=NULL);
+    void ChunkComplete(LONG64 l64CurrentBytes, bool bForce=false, const void* pTransfer=NULL);
+    void RecordRetry(const std::string& szReason, const void* pTransfer=NULL);
+    void RecordResume(int nResumeInterval, LONG64 l64CurrentBytes, const void* pTransfer=NULL);
+    void EndTransfer(int nResult, const void* pTransfer=NULL);
+	//! @}
+
+	//-----------------------------------------------------------------
+	//! \brief Write the totals and histograms gathered since the last
+	//!        summary to the metrics file and the log.
+	//-----------------------------------------------------------------
+    void WriteSummary();
+};
+
+#endif // __TRANSFER_METRICS_H__
+
+/** @} */
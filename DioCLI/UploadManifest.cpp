@@ -0,0 +1,362 @@
+/*********************************************************************
+ *
+ *  file:  UploadManifest.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Content defined chunk manifest of an uploaded file, used
+ *          by upload /delta to find the changes since the previous
+ *          upload of the same path.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#include "stdafx.h"
+#include "UploadManifest.h"
+#include "ResumeManager.h"
+
+#include "../Util/Util.h"
+#include "../Util/StringUtil.h"
+#include "../Util/ClientLog.h"
+#include "../Util/FileReader.h"
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include "openssl/md5.h"
+
+#include <stdio.h>
+#include <fstream>
+#include <set>
+
+// Boundary when the top MANIFEST_AVG_CHUNK_BITS bits of the hash are 0.
+#define MANIFEST_CHUNK_MASK             ( ((((UINT64)1) << MANIFEST_AVG_CHUNK_BITS) - 1) << \
+                                          (64 - MANIFEST_AVG_CHUNK_BITS) )
+
+// The hash only depends on the last 64 bytes - hashing starts this far
+// before the minimum chunk size.
+#define MANIFEST_HASH_WINDOW            64
+
+//---------------------------------------------------------------------
+// Gear table - fixed pseudo random values (splitmix64 with a constant
+// seed) so boundaries are the same from run to run.  Built during
+// static initialization.
+//---------------------------------------------------------------------
+class ManifestGearTable
+{
+public:
+    UINT64          m_ul64Table[256];
+
+    ManifestGearTable() {
+        UINT64 ul64State = 0x4469F6D656D6564ULL;
+        for (int nIndex = 0; nIndex < 256; nIndex++) {
+            UINT64 ul64Value = (ul64State += 0x9E3779B97F4A7C15ULL);
+            ul64Value = (ul64Value ^ (ul64Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            ul64Value = (ul64Value ^ (ul64Value >> 27)) * 0x94D049BB133111EBULL;
+            m_ul64Table[nIndex] = ul64Value ^ (ul64Value >> 31);
+        }
+    }
+};
+
+static const ManifestGearTable g_manifestGearTable;
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Add a chunk to the list.
+static void AddManifestChunk(t_manifestChunkList& listChunks, MD5_CTX& md5State,
+                             LONG64 l64Offset, LONG64 l64Length)
+{
+    unsigned char szDigest[MD5_DIGEST_LENGTH];
+    MD5_Final(szDigest, &md5State);
+
+    ManifestChunk chunk;
+    chunk.l64Offset = l64Offset;
+    chunk.l64Length = l64Length;
+    StringUtil::ConvertDigestToString(chunk.szDigest, szDigest);
+
+    listChunks.push_back(chunk);
+
+} // End AddManifestChunk
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Constructor
+//
+UploadManifest::UploadManifest() : m_szFilePath(_T("")), m_l64FileSize(0),
+                                   m_tmLastModified(0), m_l64FileID(0)
+{
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Chunk the file and digest each chunk.
+//! \param szFilePath: file to chunk
+//! \return true if successful, false if the file could not be read.
+bool UploadManifest::Build(const std::string& szFilePath)
+{
+    m_szFilePath = szFilePath;
+    m_l64FileSize = 0;
+    m_tmLastModified = 0;
+    m_l64FileID = 0;
+    m_listChunks.clear();
+
+    Util::GetFileLastModifiedTime(szFilePath.c_str(), m_tmLastModified);
+
+    //-----------------------------------------------------------------
+    // Read a buffer at a time - files large enough to flush the page
+    // cache are read around it.
+    //-----------------------------------------------------------------
+    FileReader fileReader;
+    if (fileReader.Open(szFilePath) == false) {
+        return false;
+    }
+
+    const unsigned char* pBuffer = NULL;
+    const UINT64* pGear = g_manifestGearTable.m_ul64Table;
+
+    MD5_CTX md5State;
+    MD5_Init(&md5State);
+
+    UINT64 ul64Hash = 0;
+    LONG64 l64Position = 0;                 // File offset of pBuffer[0]
+    LONG64 l64ChunkStart = 0;
+    size_t nRead = 0;
+
+    while (fileReader.Next(pBuffer, nRead) && (nRead > 0)) {
+        size_t nDigestStart = 0;
+        size_t nIndex = 0;
+
+        while (nIndex < nRead) {
+            LONG64 l64ChunkLength = l64Position + (LONG64)nIndex - l64ChunkStart;
+
+            // Skip ahead - no boundary is possible before the minimum size.
+            LONG64 l64Skip = (MANIFEST_MIN_CHUNK_SIZE - MANIFEST_HASH_WINDOW) - l64ChunkLength;
+            if (l64Skip > 0) {
+                nIndex += (l64Skip < (LONG64)(nRead - nIndex)) ? (size_t)l64Skip : nRead - nIndex;
+                continue;
+            }
+
+            ul64Hash = (ul64Hash << 1) + pGear[pBuffer[nIndex]];
+            nIndex++;
+            l64ChunkLength++;
+
+            if ( (l64ChunkLength >= MANIFEST_MIN_CHUNK_SIZE) &&
+                 ( ((ul64Hash & MANIFEST_CHUNK_MASK) == 0) ||
+                   (l64ChunkLength >= MANIFEST_MAX_CHUNK_SIZE) ) ) {
+
+                MD5_Update(&md5State, pBuffer + nDigestStart, nIndex - nDigestStart);
+                AddManifestChunk(m_listChunks, md5State, l64ChunkStart, l64ChunkLength);
+
+                MD5_Init(&md5State);
+                nDigestStart = nIndex;
+                l64ChunkStart += l64ChunkLength;
+                ul64Hash = 0;
+            }
+        }
+
+        MD5_Update(&md5State, pBuffer + nDigestStart, nRead - nDigestStart);
+        l64Position += nRead;
+    }
+
+    bool bSuccess = (fileReader.GetError() == 0);
+
+    if (l64Position > l64ChunkStart) {
+        AddManifestChunk(m_listChunks, md5State, l64ChunkStart, l64Position - l64ChunkStart);
+    }
+
+    m_l64FileSize = l64Position;
+
+    return bSuccess;
+
+} // End Build
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Chunks of this manifest not found in the previous one.
+//! \param previousManifest: manifest of the previous upload
+//! \param nChangedChunks: set to the number of new chunks
+//! \param l64ChangedBytes: set to the total size of the new chunks
+//! \param pChangedChunks: optional list for the new chunks
+void UploadManifest::Compare(const UploadManifest& previousManifest, int& nChangedChunks,
+                             LONG64& l64ChangedBytes, t_manifestChunkList* pChangedChunks /*NULL*/) const
+{
+    nChangedChunks = 0;
+    l64ChangedBytes = 0;
+
+    std::set<std::string> setDigests;
+    const t_manifestChunkList& listPrevious = previousManifest.GetChunks();
+
+    for (int nIndex = 0; nIndex < (int)listPrevious.size(); nIndex++) {
+        setDigests.insert(listPrevious[nIndex].szDigest);
+    }
+
+    for (int nIndex = 0; nIndex < (int)m_listChunks.size(); nIndex++) {
+        const ManifestChunk& chunk = m_listChunks[nIndex];
+        if (setDigests.find(chunk.szDigest) != setDigests.end()) {
+            continue;
+        }
+
+        nChangedChunks ++;
+        l64ChangedBytes += chunk.l64Length;
+        if (pChangedChunks) {
+            pChangedChunks->push_back(chunk);
+        }
+    }
+
+} // End Compare
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Compare the chunk lists position by position - Compare
+//!        only finds chunks that are new, so reordered or repeated
+//!        chunks are caught here.
+//! \param previousManifest: manifest of the previous upload
+//! \return true if the file size and every chunk match, false
+//!         otherwise.
+bool UploadManifest::IsIdentical(const UploadManifest& previousManifest) const
+{
+    const t_manifestChunkList& listPrevious = previousManifest.GetChunks();
+
+    if ( (m_l64FileSize != previousManifest.GetFileSize()) ||
+         (m_listChunks.size() != listPrevious.size()) ) {
+        return false;
+    }
+
+    for (int nIndex = 0; nIndex < (int)m_listChunks.size(); nIndex++) {
+        const ManifestChunk& chunk = m_listChunks[nIndex];
+        const ManifestChunk& previousChunk = listPrevious[nIndex];
+
+        if ( (chunk.l64Offset != previousChunk.l64Offset) ||
+             (chunk.l64Length != previousChunk.l64Length) ||
+             (chunk.szDigest != previousChunk.szDigest) ) {
+            return false;
+        }
+    }
+
+    return true;
+
+} // End IsIdentical
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Saved manifest file for the given path - named from the MD5
+//!        of the path to keep the name valid on every platform.
+//! \param szFilePath: uploaded file
+//! \return the manifest file name with path.
+std::string UploadManifest::GetManifestFileName(const std::string& szFilePath)
+{
+    unsigned char szDigest[MD5_DIGEST_LENGTH];
+    StringUtil::MakeStringMd5Digest((char*)szFilePath.c_str(), szDigest);
+
+    std::string szName = _T("");
+    StringUtil::ConvertDigestToString(szName, szDigest);
+
+    return ResumeManager::Instance()->GetAppDataDir() + MANIFEST_FILE_PREFIX + szName +
+           MANIFEST_FILE_EXT;
+
+} // End GetManifestFileName
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Read the saved manifest for the file path.
+//! \param szFilePath: uploaded file
+//! \return true if a manifest for the path was read, false otherwise.
+//
+//! Manifest file:
+//!     Ver: 1
+//!     <file path>
+//!     <file size> <last modified> <file ID> <number of chunks>
+//!     <offset> <length> <digest>      (per chunk)
+bool UploadManifest::Load(const std::string& szFilePath)
+{
+    m_listChunks.clear();
+
+    std::ifstream manifestFile(GetManifestFileName(szFilePath).c_str());
+    if (manifestFile.is_open() == false) {
+        return false;
+    }
+
+    std::string szVersion = _T("");
+    int nVersion = 0;
+    manifestFile >> szVersion >> nVersion;
+    if ( (szVersion != _T("Ver:")) || (nVersion != MANIFEST_FILE_VER) ) {
+        return false;
+    }
+
+    // Rest of the version line, then the path.
+    std::string szLine = _T("");
+    std::getline(manifestFile, szLine);
+    std::getline(manifestFile, m_szFilePath);
+
+    if (m_szFilePath != szFilePath) {
+        return false;
+    }
+
+    long lLastModified = 0;
+    int nChunks = 0;
+    manifestFile >> m_l64FileSize >> lLastModified >> m_l64FileID >> nChunks;
+    m_tmLastModified = (time_t)lLastModified;
+
+    for (int nIndex = 0; (nIndex < nChunks) && manifestFile.good(); nIndex++) {
+        ManifestChunk chunk;
+        manifestFile >> chunk.l64Offset >> chunk.l64Length >> chunk.szDigest;
+        m_listChunks.push_back(chunk);
+    }
+
+    if ( manifestFile.fail() || ((int)m_listChunks.size() != nChunks) ) {
+        m_listChunks.clear();
+        return false;
+    }
+
+    return true;
+
+} // End Load
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Write the manifest, replacing any previous manifest for
+//!        the file path.  Written to a temporary file first, so an
+//!        interrupted write leaves the previous manifest.
+//! \return true if successful, false otherwise.
+bool UploadManifest::Save()
+{
+    std::string szManifestFile = GetManifestFileName(m_szFilePath);
+    std::string szTempFile = szManifestFile + _T(".tmp");
+
+    FILE* pFile = fopen(szTempFile.c_str(), _T("wt"));
+    if (pFile == NULL) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Upload manifest %s could not be created."),
+            szTempFile.c_str());
+        return false;
+    }
+
+    fprintf(pFile, _T("Ver: %d\n%s\n"), MANIFEST_FILE_VER, m_szFilePath.c_str());
+    fprintf(pFile, DIOMEDE_LONG_FORMAT _T(" %ld ") DIOMEDE_LONG_FORMAT _T(" %d\n"),
+            m_l64FileSize, (long)m_tmLastModified, m_l64FileID, (int)m_listChunks.size());
+
+    for (int nIndex = 0; nIndex < (int)m_listChunks.size(); nIndex++) {
+        const ManifestChunk& chunk = m_listChunks[nIndex];
+        fprintf(pFile, DIOMEDE_LONG_FORMAT _T(" ") DIOMEDE_LONG_FORMAT _T(" %s\n"),
+                chunk.l64Offset, chunk.l64Length, chunk.szDigest.c_str());
+    }
+
+    bool bSuccess = (ferror(pFile) == 0);
+    if (fclose(pFile) != 0) {
+        bSuccess = false;
+    }
+
+    if (bSuccess) {
+        #ifdef WIN32
+            // rename doesn't replace an existing file.
+            remove(szManifestFile.c_str());
+        #endif
+        bSuccess = (rename(szTempFile.c_str(), szManifestFile.c_str()) == 0);
+    }
+
+    if (bSuccess == false) {
+        ClientLog(UI_COMP, LOG_WARNING, false, _T("Upload manifest %s could not be saved."),
+            szManifestFile.c_str());
+        remove(szTempFile.c_str());
+    }
+
+    return bSuccess;
+
+} // End Save
+
+/** @} */
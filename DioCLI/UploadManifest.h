@@ -0,0 +1,124 @@
+/*********************************************************************
+ *
+ *  file:  UploadManifest.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Content defined chunk manifest of an uploaded file, used
+ *          by upload /delta to find the changes since the previous
+ *          upload of the same path.
+ *
+ *********************************************************************/
+
+//! \ingroup consolecontrol
+//! @{
+
+#ifndef __UPLOAD_MANIFEST_H__
+#define __UPLOAD_MANIFEST_H__
+
+#include "stdafx.h"
+#include "../Include/types.h"
+
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------
+//! Chunk boundaries are placed where a rolling (gear) hash of the
+//! preceding bytes matches a mask, so an insert or delete only moves
+//! the boundaries near the change.  Sizes in bytes - the mask gives
+//! the average (2^20 = 1 MB).
+//---------------------------------------------------------------------
+#define MANIFEST_MIN_CHUNK_SIZE         262144
+#define MANIFEST_MAX_CHUNK_SIZE         4194304
+#define MANIFEST_AVG_CHUNK_BITS         20
+
+#define MANIFEST_FILE_VER               1
+#define MANIFEST_FILE_PREFIX            _T("manifest_")
+#define MANIFEST_FILE_EXT               _T(".mft")
+
+///////////////////////////////////////////////////////////////////////
+//! \struct ManifestChunk
+//! \brief Offset, length and MD5 digest of a chunk.
+struct ManifestChunk
+{
+    LONG64                      l64Offset;
+    LONG64                      l64Length;
+    std::string                 szDigest;
+};
+
+typedef std::vector<ManifestChunk> t_manifestChunkList;
+
+///////////////////////////////////////////////////////////////////////
+//! \class UploadManifest
+//! \brief Chunk list of a file along with the file ID it was uploaded
+//!        as.  Manifests are saved in the application data directory,
+//!        one per uploaded path.
+//!
+//! Usage:
+//!      UploadManifest previous, current;
+//!      previous.Load(szFilePath);
+//!      current.Build(szFilePath);
+//!      if (current.IsIdentical(previous)) ...skip...
+//!      current.Compare(previous, nChangedChunks, l64ChangedBytes);
+//!      ...upload...
+//!      current.SetFileID(l64FileID);
+//!      current.Save();
+class UploadManifest
+{
+private:
+    std::string                 m_szFilePath;
+    LONG64                      m_l64FileSize;
+    time_t                      m_tmLastModified;
+    LONG64                      m_l64FileID;                    //! 0 until uploaded
+    t_manifestChunkList         m_listChunks;
+
+public:
+    UploadManifest();
+    virtual ~UploadManifest() {}
+
+    //-----------------------------------------------------------------
+    //! Chunk the file and digest each chunk.
+    //-----------------------------------------------------------------
+    bool Build(const std::string& szFilePath);
+
+    //-----------------------------------------------------------------
+    //! Read/write the saved manifest for the file path.
+    //-----------------------------------------------------------------
+    bool Load(const std::string& szFilePath);
+    bool Save();
+
+    //-----------------------------------------------------------------
+    //! Chunks of this manifest not found in the previous one.
+    //-----------------------------------------------------------------
+    void Compare(const UploadManifest& previousManifest, int& nChangedChunks,
+                 LONG64& l64ChangedBytes, t_manifestChunkList* pChangedChunks=NULL) const;
+
+    //! Same chunks in the same order as the previous manifest?
+    bool IsIdentical(const UploadManifest& previousManifest) const;
+
+    //! Saved manifest file for the given path.
+    static std::string GetManifestFileName(const std::string& szFilePath);
+
+    //-----------------------------------------------------------------
+    // Getters and setters
+    //-----------------------------------------------------------------
+    const std::string& GetFilePath() const { return m_szFilePath; }
+    LONG64 GetFileSize() const { return m_l64FileSize; }
+    time_t GetLastModified() const { return m_tmLastModified; }
+    int GetChunkCount() const { return (int)m_listChunks.size(); }
+    const t_manifestChunkList& GetChunks() const { return m_listChunks; }
+
+    LONG64 GetFileID() const { return m_l64FileID; }
+    void SetFileID(const LONG64& l64FileID) {
+        m_l64FileID = l64FileID;
+    }
+
+}; // End UploadManifest
+
+/** @} */
+
+#endif // __UPLOAD_MANIFEST_H__
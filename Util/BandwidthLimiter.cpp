@@ -0,0 +1,359 @@
+/*********************************************************************
+ *
+ *  file:  BandwidthLimiter.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Token bucket bandwidth limits for uploads and downloads -
+ *          a limit for all transfers together, a limit per transfer,
+ *          and time of day schedules from the user profile.
+ *
+ *********************************************************************/
+
+#include "Stdafx.h"
+#include "BandwidthLimiter.h"
+#include "Thread.h"
+#include "ClientLog.h"
+#include "UserProfileData.h"
+#include "ProfileManager.h"
+
+#include "../Include/ErrorCodes/UIErrors.h"
+
+#include <stdio.h>
+
+using namespace boost::posix_time;
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+#define MINUTES_PER_DAY                 1440
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: TokenBucket constructor
+TokenBucket::TokenBucket() : m_dblTokens(0), m_tmLast(not_a_date_time)
+{
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Forget the transfer history - the next reservation starts
+//          with a full bucket.
+// Requires: nothing
+// Returns: nothing
+void TokenBucket::Reset()
+{
+    m_dblTokens = 0;
+    m_tmLast = not_a_date_time;
+
+} // End Reset
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Reserve bytes from the bucket.
+// Requires:
+//      l64Bytes: bytes transferred
+//      l64Rate: limit in bytes per second, 0 for no limit.
+//      tmNow: current (universal) time
+// Returns: milliseconds to wait before the bytes are allowed.
+LONG64 TokenBucket::Reserve(LONG64 l64Bytes, LONG64 l64Rate, const ptime& tmNow)
+{
+    if (l64Rate <= 0) {
+        Reset();
+        return 0;
+    }
+
+    double dblBurst = (double)l64Rate * BANDWIDTH_BURST_TIME / 1000.0;
+
+    if (m_tmLast.is_not_a_date_time()) {
+        m_dblTokens = dblBurst;
+    }
+    else {
+        LONG64 l64ElapsedMs = (tmNow - m_tmLast).total_milliseconds();
+        if (l64ElapsedMs > 0) {
+            m_dblTokens += (double)l64ElapsedMs * l64Rate / 1000.0;
+        }
+        if (m_dblTokens > dblBurst) {
+            m_dblTokens = dblBurst;
+        }
+    }
+
+    m_tmLast = tmNow;
+    m_dblTokens -= (double)l64Bytes;
+
+    if (m_dblTokens >= 0) {
+        return 0;
+    }
+
+    return (LONG64)(-m_dblTokens * 1000.0 / l64Rate);
+
+} // End Reserve
+
+///////////////////////////////////////////////////////////////////////
+BandwidthLimiter* BandwidthLimiter::m_pBandwidthLimiter = NULL;
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: BandwidthLimiter constructor
+BandwidthLimiter::BandwidthLimiter() : m_l64DefaultTotalRate(0), m_l64DefaultTransferRate(0),
+                                       m_bEnabled(false), m_l64TotalRate(0), m_l64TransferRate(0),
+                                       m_tmNextCheck(not_a_date_time)
+{
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: BandwidthLimiter destructor
+BandwidthLimiter::~BandwidthLimiter()
+{
+} // End destructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Returns the limiter, created on first use.
+BandwidthLimiter* BandwidthLimiter::Instance()
+{
+	if (m_pBandwidthLimiter == NULL) {
+	    m_pBandwidthLimiter = new BandwidthLimiter;
+	}
+
+	return m_pBandwidthLimiter;
+
+} // End Instance
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Cleanup the limiter.
+void BandwidthLimiter::Shutdown()
+{
+	if ( this == m_pBandwidthLimiter )
+		m_pBandwidthLimiter = NULL;
+
+	delete this;
+
+} // End Shutdown
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Parse the bandwidth schedule.
+// Requires:
+//      szSchedule: windows separated by commas, each
+//                  HH:MM-HH:MM=total[/transfer] in KB per second,
+//                  e.g. "08:00-18:00=512/128,18:00-08:00=0"
+//      listWindows: set to the parsed windows.
+// Returns: true if the whole schedule was valid, false otherwise
+//          (valid windows are still returned).
+bool BandwidthLimiter::ParseSchedule(const std::string& szSchedule,
+                                     std::vector<BandwidthWindow>& listWindows)
+{
+    listWindows.clear();
+    bool bValid = true;
+
+    size_t nStart = 0;
+    while (nStart < szSchedule.length()) {
+        size_t nEnd = szSchedule.find(_T(','), nStart);
+        if (nEnd == std::string::npos) {
+            nEnd = szSchedule.length();
+        }
+
+        std::string szWindow = szSchedule.substr(nStart, nEnd - nStart);
+        nStart = nEnd + 1;
+
+        if (szWindow.find_first_not_of(_T(" \t")) == std::string::npos) {
+            continue;
+        }
+
+        int nStartHour = 0, nStartMinute = 0, nEndHour = 0, nEndMinute = 0;
+        int nTotalRate = 0, nTransferRate = 0;
+
+        int nFields = sscanf(szWindow.c_str(), _T(" %d:%d-%d:%d=%d/%d"), &nStartHour, &nStartMinute,
+                             &nEndHour, &nEndMinute, &nTotalRate, &nTransferRate);
+
+        if ( (nFields < 5) || (nStartHour < 0) || (nStartHour > 24) || (nEndHour < 0) ||
+             (nEndHour > 24) || (nStartMinute < 0) || (nStartMinute > 59) ||
+             (nEndMinute < 0) || (nEndMinute > 59) || (nTotalRate < 0) || (nTransferRate < 0) ) {
+            ClientLog(UI_COMP, LOG_WARNING, false, _T("Bandwidth schedule: ignoring \"%s\"."),
+                szWindow.c_str());
+            bValid = false;
+            continue;
+        }
+
+        BandwidthWindow window;
+        window.nStart = (nStartHour * 60 + nStartMinute) % MINUTES_PER_DAY;
+        window.nEnd = (nEndHour * 60 + nEndMinute) % MINUTES_PER_DAY;
+        window.l64TotalRate = (LONG64)nTotalRate * 1024;
+        window.l64TransferRate = (LONG64)nTransferRate * 1024;
+
+        listWindows.push_back(window);
+    }
+
+    return bValid;
+
+} // End ParseSchedule
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Read the limits and schedule from the user profile - called
+//          at the start of each transfer command.
+// Requires: nothing
+// Returns: nothing
+void BandwidthLimiter::LoadSettings()
+{
+    LONG64 l64TotalRate = 0;
+    LONG64 l64TransferRate = 0;
+    std::vector<BandwidthWindow> listWindows;
+
+    UserProfileData* pProfileData =
+        ProfileManager::Instance()->GetProfile( _T("Diomede"), "", "" );
+    if (pProfileData) {
+        l64TotalRate = (LONG64)pProfileData->GetUserProfileInt(GEN_BANDWIDTH_LIMIT,
+                                                               GEN_BANDWIDTH_LIMIT_DF) * 1024;
+        l64TransferRate = (LONG64)pProfileData->GetUserProfileInt(GEN_TRANSFER_BANDWIDTH_LIMIT,
+                                                                  GEN_TRANSFER_BANDWIDTH_LIMIT_DF) * 1024;
+        ParseSchedule(pProfileData->GetUserProfileStr(GEN_BANDWIDTH_SCHEDULE, GEN_BANDWIDTH_SCHEDULE_DF),
+                      listWindows);
+    }
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    m_l64DefaultTotalRate = (l64TotalRate > 0) ? l64TotalRate : 0;
+    m_l64DefaultTransferRate = (l64TransferRate > 0) ? l64TransferRate : 0;
+    m_listWindows = listWindows;
+
+    m_bEnabled = (m_l64DefaultTotalRate > 0) || (m_l64DefaultTransferRate > 0) ||
+                 (m_listWindows.size() > 0);
+
+    UpdateLimits(true);
+
+} // End LoadSettings
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Pick the limits for the time of day - called with the
+//          lock held.
+// Requires:
+//      bForce: true to check now, false to check only when due.
+// Returns: nothing
+void BandwidthLimiter::UpdateLimits(bool bForce)
+{
+    ptime tmNow = microsec_clock::universal_time();
+
+    if ( (bForce == false) && (m_tmNextCheck.is_not_a_date_time() == false) &&
+         (tmNow < m_tmNextCheck) ) {
+        return;
+    }
+
+    m_tmNextCheck = tmNow + seconds(BANDWIDTH_SCHEDULE_CHECK);
+
+    LONG64 l64TotalRate = m_l64DefaultTotalRate;
+    LONG64 l64TransferRate = m_l64DefaultTransferRate;
+
+    if (m_listWindows.size() > 0) {
+        time_duration tdLocal = second_clock::local_time().time_of_day();
+        int nMinute = (int)(tdLocal.hours() * 60 + tdLocal.minutes());
+
+        for (int nIndex = 0; nIndex < (int)m_listWindows.size(); nIndex++) {
+            const BandwidthWindow& window = m_listWindows[nIndex];
+
+            bool bInWindow = (window.nStart <= window.nEnd) ?
+                ( (nMinute >= window.nStart) && (nMinute < window.nEnd) ) :
+                ( (nMinute >= window.nStart) || (nMinute < window.nEnd) );
+
+            if (bInWindow) {
+                l64TotalRate = window.l64TotalRate;
+                l64TransferRate = window.l64TransferRate;
+                break;
+            }
+        }
+    }
+
+    if ( (l64TotalRate != m_l64TotalRate) || (l64TransferRate != m_l64TransferRate) ) {
+        ClientLog(UI_COMP, LOG_STATUS, false,
+            _T("Bandwidth limit: total ") DIOMEDE_LONG_FORMAT _T(" B/s, per transfer ")
+            DIOMEDE_LONG_FORMAT _T(" B/s (0 = none)."), l64TotalRate, l64TransferRate);
+    }
+
+    m_l64TotalRate = l64TotalRate;
+    m_l64TransferRate = l64TransferRate;
+
+} // End UpdateLimits
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Current limits.
+// Requires:
+//      l64TotalRate: set to the limit for all transfers (bytes/sec).
+//      l64TransferRate: set to the limit per transfer (bytes/sec).
+// Returns: nothing
+void BandwidthLimiter::GetLimits(LONG64& l64TotalRate, LONG64& l64TransferRate)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    UpdateLimits(false);
+
+    l64TotalRate = m_l64TotalRate;
+    l64TransferRate = m_l64TransferRate;
+
+} // End GetLimits
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Check whether a limit is in effect now - the settings may
+//          have been reloaded, or the schedule moved to a window
+//          without limits.
+// Requires: nothing
+// Returns: true if a limit is in effect, false otherwise.
+bool BandwidthLimiter::IsLimited()
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if (m_bEnabled == false) {
+        return false;
+    }
+
+    UpdateLimits(false);
+
+    return (m_l64TotalRate > 0) || (m_l64TransferRate > 0);
+
+} // End IsLimited
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait on the calling transfer thread until the bytes just
+//          transferred are within the limits.
+// Requires:
+//      transferBucket: the transfer's own bucket.
+//      l64Bytes: bytes transferred since the last call.
+// Returns: nothing
+void BandwidthLimiter::Throttle(TokenBucket& transferBucket, LONG64 l64Bytes)
+{
+    // Unlocked check so transfers without limits never take the lock -
+    // m_bEnabled is checked again below, under the lock.
+    if ( (m_bEnabled == false) || (l64Bytes <= 0) ) {
+        return;
+    }
+
+    LONG64 l64WaitMs = 0;
+
+    {
+        Lock<CCriticalSection> lock(m_lock);
+
+        if (m_bEnabled == false) {
+            return;
+        }
+
+        UpdateLimits(false);
+
+        ptime tmNow = microsec_clock::universal_time();
+        LONG64 l64TotalWaitMs = m_totalBucket.Reserve(l64Bytes, m_l64TotalRate, tmNow);
+
+        l64WaitMs = transferBucket.Reserve(l64Bytes, m_l64TransferRate, tmNow);
+        if (l64TotalWaitMs > l64WaitMs) {
+            l64WaitMs = l64TotalWaitMs;
+        }
+    }
+
+    // Sleep in slices - the wait is cut short once no limit is in
+    // effect.  A rate that is changed, rather than lifted, applies from
+    // the next chunk.
+    while (l64WaitMs > 0) {
+        LONG64 l64SliceMs = (l64WaitMs < BANDWIDTH_SLEEP_SLICE) ? l64WaitMs : BANDWIDTH_SLEEP_SLICE;
+        Sleep((unsigned int)l64SliceMs);
+        l64WaitMs -= l64SliceMs;
+
+        if ( (l64WaitMs > 0) && (IsLimited() == false) ) {
+            break;
+        }
+    }
+
+} // End Throttle
@@ -0,0 +1,150 @@
+/*********************************************************************
+ *
+ *  file:  BandwidthLimiter.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Token bucket bandwidth limits for uploads and downloads -
+ *          a limit for all transfers together, a limit per transfer,
+ *          and time of day schedules from the user profile.
+ *
+ *********************************************************************/
+
+#ifndef __BANDWIDTH_LIMITER_H__
+#define __BANDWIDTH_LIMITER_H__
+
+#include "Stdafx.h"
+#include "types.h"
+#include "CriticalSection.h"
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------
+// Bytes a transfer can send at once after being idle (as milliseconds
+// at the limit), the longest single sleep, and how often the schedule
+// is checked (seconds).
+//---------------------------------------------------------------------
+#define BANDWIDTH_BURST_TIME            1000
+#define BANDWIDTH_SLEEP_SLICE           250
+#define BANDWIDTH_SCHEDULE_CHECK        30
+
+///////////////////////////////////////////////////////////////////////
+// TokenBucket Class
+//
+// Bytes are reserved as they are transferred - the bucket may go
+// into debt, and the debt is the time the caller waits.  Since each
+// caller waits for its own reservation, transfers sharing a bucket
+// are paced in the order they reserved, each getting an equal share
+// when they transfer equal sized chunks.
+
+class TokenBucket
+{
+private:
+    double                      m_dblTokens;
+    boost::posix_time::ptime    m_tmLast;
+
+public:
+    TokenBucket();
+
+    //-----------------------------------------------------------------
+    // Reserve bytes at the given rate (bytes per second, 0 for no
+    // limit).  Returns the milliseconds to wait before continuing.
+    //-----------------------------------------------------------------
+    LONG64 Reserve(LONG64 l64Bytes, LONG64 l64Rate, const boost::posix_time::ptime& tmNow);
+    void Reset();
+};
+
+///////////////////////////////////////////////////////////////////////
+// BandwidthLimiter Class
+//
+// Usage:
+//      BandwidthLimiter::Instance()->LoadSettings();       // Command start
+//
+//      // Transfer callback, after each chunk:
+//      BandwidthLimiter::Instance()->Throttle(transferBucket, l64ChunkBytes);
+//
+// Throttle sleeps on the calling (transfer) thread until both the
+// total and the transfer's own bucket allow the bytes, which delays
+// the next chunk.  Nothing is locked or timed when no limits are set.
+
+class BandwidthLimiter
+{
+protected:
+    static BandwidthLimiter*    m_pBandwidthLimiter;
+
+private:
+    //-----------------------------------------------------------------
+    // Time of day window - minutes since midnight, the end may be
+    // before the start to span midnight.  Rates in bytes per second.
+    //-----------------------------------------------------------------
+    struct BandwidthWindow
+    {
+        int                     nStart;
+        int                     nEnd;
+        LONG64                  l64TotalRate;
+        LONG64                  l64TransferRate;
+    };
+
+    std::vector<BandwidthWindow> m_listWindows;
+    LONG64                      m_l64DefaultTotalRate;
+    LONG64                      m_l64DefaultTransferRate;
+
+    volatile bool               m_bEnabled;                 // Any limit set - written under
+                                                            // m_lock, read without it only to
+                                                            // skip the lock when not limited
+
+    //-----------------------------------------------------------------
+    // Guarded by m_lock.
+    //-----------------------------------------------------------------
+    LONG64                      m_l64TotalRate;             // Current limits
+    LONG64                      m_l64TransferRate;
+    boost::posix_time::ptime    m_tmNextCheck;
+    TokenBucket                 m_totalBucket;
+
+    DIOMEDE_CRITICAL::CCriticalSection  m_lock;
+
+public:
+    static BandwidthLimiter* Instance();
+    virtual ~BandwidthLimiter();
+
+	// Cleanup the limiter.
+	void Shutdown();
+
+private:
+    BandwidthLimiter();
+
+    // Not implemented
+    BandwidthLimiter(const BandwidthLimiter&);
+    BandwidthLimiter& operator=(const BandwidthLimiter&);
+
+    void UpdateLimits(bool bForce);
+    bool IsLimited();
+    static bool ParseSchedule(const std::string& szSchedule,
+                              std::vector<BandwidthWindow>& listWindows);
+
+public:
+    //-----------------------------------------------------------------
+    // Read the limits and schedule from the user profile.
+    //-----------------------------------------------------------------
+    void LoadSettings();
+    bool IsEnabled() { return m_bEnabled; }
+
+    //-----------------------------------------------------------------
+    // Current limits in bytes per second, 0 for no limit.
+    //-----------------------------------------------------------------
+    void GetLimits(LONG64& l64TotalRate, LONG64& l64TransferRate);
+
+    //-----------------------------------------------------------------
+    // Transfer path - wait until the bytes are allowed.
+    //-----------------------------------------------------------------
+    void Throttle(TokenBucket& transferBucket, LONG64 l64Bytes);
+};
+
+#endif // __BANDWIDTH_LIMITER_H__
@@ -33,6 +33,18 @@ using DIOMEDE_CRITICAL::Lock;
 
 #define HEADER_PADDING 100  //this is extra for the time, comp, event stamp
 
+// Components with a cached filter - normalized indexes run up to and
+// including ERROR_TOTAL_COMPONENTS.
+#define CLIENT_LOG_FILTER_SLOTS     ((int)(ERROR_TOTAL_COMPONENTS) + 1)
+
+// The cached filter is written under the observers lock and read without
+// it - aligned long reads and writes are atomic on the platforms built.
+#ifdef WIN32
+    #define CLIENT_LOG_ATOMIC_SET(p, lValue)    InterlockedExchange((volatile LONG*)(p), lValue)
+#else
+    #define CLIENT_LOG_ATOMIC_SET(p, lValue)    __sync_lock_test_and_set(p, lValue)
+#endif
+
 static const char* g_Events[] = { _T("DF"),  _T("ST"),  _T("EX"),  _T("ER"),  _T("WA"),  _T("SC"),  _T("PE"),  _T("SE") };
 
 ///////////////////////////////////////////////////////////////////////
@@ -41,13 +53,17 @@ public:
 	Logger();
 	~Logger();
 
-	void EnableLogging(bool bOn) { m_bEnableLogging = bOn; }
+	void EnableLogging(bool bOn) {
+		m_bEnableLogging = bOn;
+		RefreshFilter();
+	}
 	bool LoggingEnabled() const { return m_bEnableLogging; }
 
 	bool SetDefaultLoggingEvents(int eventMask) {
 		if ( eventMask & LOG_DEFAULT)
 			return false;
 		m_iDefaultLoggingEvents = eventMask;
+		RefreshFilter();
 		return true;
 	}
 
@@ -58,6 +74,7 @@ public:
 	bool RegisterLogObserver(ILogObserver* pLogObserver) {
         Lock<CCriticalSection> lock(m_observersLock);
 		m_observers.push_back(pLogObserver);
+		RefreshFilter();
 		return true;
 	}
 
@@ -70,6 +87,7 @@ public:
     		ILogObserver* tmpObserver = (*lit);
 			if (pLogObserver->GetLogObserverType() == tmpObserver->GetLogObserverType()) {
 		        m_observers.erase(lit);
+				RefreshFilter();
 				return true;
 			}
 		}
@@ -80,7 +98,9 @@ public:
 		return m_logLevels[componentIndex];
 	}
 
+	bool IsLogged(int nComponentNdx, int nEvent);
 	void LogMessage(int nComponentNdx, int nEvent, const string& message, int len);
+	void RefreshFilter();
 
 private:
 	int                                 m_iObservers;
@@ -93,6 +113,9 @@ private:
 	bool                                m_bEnableLogging;
 	int                                 m_iDefaultLoggingEvents;
 	unsigned int                        m_logLevels[ERROR_TOTAL_COMPONENTS];
+
+	// Per component, the events at least one observer accepts.
+	volatile long                       m_lFilterEvents[CLIENT_LOG_FILTER_SLOTS];
 };
 
 ///////////////////////////////////////////////////////////////////////
@@ -123,6 +146,9 @@ Logger::Logger()
     for(i=0; i < (unsigned int)ERROR_TOTAL_COMPONENTS; i++) {
         m_logLevels[i]=0;
     }
+    for(i=0; i < (unsigned int)CLIENT_LOG_FILTER_SLOTS; i++) {
+        m_lFilterEvents[i]=0;
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -167,6 +193,31 @@ bool UnRegisterLogObserver(LogObserver* pLogObserver)
 
 } // End UnRegisterLogObserver
 
+///////////////////////////////////////////////////////////////////////
+bool Logger::IsLogged( int nComponentIndex, int nEvent )
+{
+ 	int nTmpIndex = GetNormalizedIndex(nComponentIndex);
+
+    // The cached filter answers without the lock - only components
+    // outside it walk the observers.
+    if ( (nTmpIndex >= 0) && (nTmpIndex < CLIENT_LOG_FILTER_SLOTS) ) {
+        return ( (m_lFilterEvents[nTmpIndex] & nEvent) != 0 );
+    }
+
+    Lock<CCriticalSection> lock(m_observersLock);
+
+    LogObserverList::iterator lit;
+    for (lit = m_observers.begin(); lit != m_observers.end(); lit++) {
+		ILogObserver* observer = (ILogObserver*)(*lit);
+		if ( !observer->IsIgnored( nTmpIndex, nEvent)) {
+			return true;
+		}
+	}
+
+	return false;
+
+} // End IsLogged
+
 ///////////////////////////////////////////////////////////////////////
 void Logger::LogMessage( int nComponentIndex, int nEvent, const string& msg, int len )
 {
@@ -184,6 +235,37 @@ void Logger::LogMessage( int nComponentIndex, int nEvent, const string& msg, int
 
 } // End LogMessage
 
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Rebuild the cached filter from the observers - called whenever the
+//      observers, the logging levels or an observer's own filtering
+//      change.  The cache is a superset: LogMessage still asks each
+//      observer.
+//	Requires: nothing
+//	Returns: nothing
+//
+void Logger::RefreshFilter()
+{
+    Lock<CCriticalSection> lock(m_observersLock);
+
+    for (int nIndex = 0; nIndex < CLIENT_LOG_FILTER_SLOTS; nIndex++) {
+        long lEvents = 0;
+
+        for (int nBit = DEFAULT_BIT; nBit <= SECURITY_BIT; nBit++) {
+            LogObserverList::iterator lit;
+            for (lit = m_observers.begin(); lit != m_observers.end(); lit++) {
+                if ( !(*lit)->IsIgnored(nIndex, 1 << nBit)) {
+                    lEvents |= (1 << nBit);
+                    break;
+                }
+            }
+        }
+
+        CLIENT_LOG_ATOMIC_SET(&m_lFilterEvents[nIndex], lEvents);
+    }
+
+} // End RefreshFilter
+
 ///////////////////////////////////////////////////////////////////////
 bool Logger::SetComponentLogging(int nComponentIndex, int eventMask)
 {
@@ -204,6 +286,7 @@ bool Logger::SetComponentLogging(int nComponentIndex, int eventMask)
         m_logLevels[nTmpIndex] = eventMask;
     }
 
+    RefreshFilter();
     return true;
 
 } // End SetComponentLogging
@@ -240,6 +323,13 @@ void EnableLogging(bool bOn)
 
 } // End EnableLogging
 
+///////////////////////////////////////////////////////////////////////
+void RefreshClientLogFilter()
+{
+	g_theLogger.ptr()->RefreshFilter();
+
+} // End RefreshClientLogFilter
+
 ///////////////////////////////////////////////////////////////////////
 bool SetDefaultLoggingEvents(int eventMask)
 {
@@ -327,6 +417,14 @@ static void GetEventName(int nEvent, CLogEvent* pLogEvent)
 
 size_t kMaxLineLen = 1024;
 
+///////////////////////////////////////////////////////////////////////
+bool IsClientLogEnabled(const int component, const int nEvent)
+{
+    int componentIndex = ((ULONG)component)>>24;
+	return g_theLogger.ptr()->IsLogged(componentIndex, nEvent);
+
+} // End IsClientLogEnabled
+
 ///////////////////////////////////////////////////////////////////////
 int FormatClientLog(char* buffer, int nCount, const char* format, ...)
 {
@@ -350,13 +448,19 @@ void ClientLog( const int component, const int nEvent, const bool continuation,
 	GetLocalTime(&systime);
 	*/
 
+    int componentIndex = ((ULONG)component)>>24;
+
+    // Nothing to do if no observer wants this event - bail out before
+    // any of the time stamp, name and message formatting.
+    if ( !g_theLogger.ptr()->IsLogged(componentIndex, nEvent)) {
+        return;
+    }
+
     // Replacing the above with Boost date_time - note that second_clock is only precise
     // up to seconds, not milleseconds...using microsec_clock to achieve a higher
     // precision.
     ptime tmNow = microsec_clock::local_time();
 
-    int componentIndex = ((ULONG)component)>>24;
-
     // Setup the component name and even name - in STL/UNICODE environments, the
     // strings need to be static and global.
     CLogEvent logEvent;
@@ -498,13 +602,19 @@ void ClientLog(	const char *file,
 	GetLocalTime(&systime);
 	*/
 
+    int componentIndex = ((ULONG)component)>>24;
+
+    // Nothing to do if no observer wants this event - bail out before
+    // any of the time stamp, name and message formatting.
+    if ( !g_theLogger.ptr()->IsLogged(componentIndex, nEvent)) {
+        return;
+    }
+
     // Replacing the above with Boost date_time - note that second_clock is only precise
     // up to seconds, not milleseconds...using microsec_clock to achieve a higher
     // precision.
     ptime tmNow = microsec_clock::local_time();
 
-    int componentIndex = ((ULONG)component)>>24;
-
     // Setup the component name and even name - in STL/UNICODE environments, the
     // strings need to be static and global.
     CLogEvent logEvent;
@@ -119,6 +119,66 @@ ErrorType ClientLogError(ErrorType err,
 						 const char* prefixString,
 						 ...);
 
+/////////////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Quick check made before a message is formatted - the time stamp,
+//      component and event names and the message itself are only built
+//      if at least one registered observer accepts the event.  Answered
+//      from a cached filter, without taking a lock.
+//	Requires:
+//      component: component (e.g. UI_COMP)
+//		event: event type (e.g. LOG_STATUS)
+//	Returns:
+//      true if the event would be logged, false otherwise.
+//
+bool IsClientLogEnabled(const int component, const int event);
+
+/////////////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Rebuild the cached filter used by IsClientLogEnabled - observers
+//      call this when the events they ignore change.  Registering an
+//      observer and changing the logging levels rebuild it already.
+//	Requires: nothing
+//	Returns: nothing
+//
+void RefreshClientLogFilter();
+
+//////////////////////////////////////////////////////////////////////
+// Compile time log filtering - events not included in
+// CLIENT_LOG_COMPILED_EVENTS are removed from the build by the CLIENTLOG
+// macros, along with the evaluation of their arguments.  Events that are
+// compiled in are checked with IsClientLogEnabled before any arguments
+// are evaluated.  To override, define on the compiler command line, e.g.
+//      -DCLIENT_LOG_COMPILED_EVENTS="(LOG_ERROR|LOG_WARNING|LOG_EXCEPTION)"
+
+#ifndef CLIENT_LOG_COMPILED_EVENTS
+	#define CLIENT_LOG_COMPILED_EVENTS  (LOG_ALL)
+#endif
+
+#define CLIENT_LOG_COMPILED(event)      (((event) & (CLIENT_LOG_COMPILED_EVENTS)) != 0)
+
+    // eg CLIENTLOG_STATUS(UI_COMP, false, _T("Uploading %s."), szFile.c_str());
+#define CLIENTLOG(component, event, continuation, ...)                      \
+    do {                                                                    \
+        if ( CLIENT_LOG_COMPILED(event) &&                                  \
+             IsClientLogEnabled((component), (event)) ) {                   \
+            ClientLog((component), (event), (continuation), __VA_ARGS__);   \
+        }                                                                   \
+    } while (0)
+
+#define CLIENTLOG_STATUS(component, continuation, ...)      \
+    CLIENTLOG(component, LOG_STATUS, continuation, __VA_ARGS__)
+#define CLIENTLOG_EXCEPTION(component, continuation, ...)   \
+    CLIENTLOG(component, LOG_EXCEPTION, continuation, __VA_ARGS__)
+#define CLIENTLOG_ERROR(component, continuation, ...)       \
+    CLIENTLOG(component, LOG_ERROR, continuation, __VA_ARGS__)
+#define CLIENTLOG_WARNING(component, continuation, ...)     \
+    CLIENTLOG(component, LOG_WARNING, continuation, __VA_ARGS__)
+#define CLIENTLOG_STATECHANGE(component, continuation, ...) \
+    CLIENTLOG(component, LOG_STATECHANGE, continuation, __VA_ARGS__)
+#define CLIENTLOG_PERFORMANCE(component, continuation, ...) \
+    CLIENTLOG(component, LOG_PERFORMANCE, continuation, __VA_ARGS__)
+
 /////////////////////////////////////////////////////////////////////////////
 // Purpose:
 //      Toggles logging for all components
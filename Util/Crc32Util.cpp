@@ -0,0 +1,348 @@
+/*********************************************************************
+ *
+ *  file:  Crc32Util.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Incremental CRC32 (IEEE 802.3, as used by zlib) for
+ *          checksumming file data as it is read.
+ *
+ *********************************************************************/
+
+#include "Crc32Util.h"
+
+#include <stdio.h>
+
+//---------------------------------------------------------------------
+// 64 bit file positioning.
+//---------------------------------------------------------------------
+#ifdef WIN32
+    #define CRC32_FSEEK64(pFile, l64Offset)     _fseeki64(pFile, l64Offset, SEEK_SET)
+#else
+    #define CRC32_FSEEK64(pFile, l64Offset)     fseeko(pFile, (off_t)l64Offset, SEEK_SET)
+#endif
+
+// Size of the buffer used to read file ranges.
+#define CRC32_READ_BUFFER_SIZE          65536
+
+//---------------------------------------------------------------------
+// Carry-less multiply folding (PCLMULQDQ) on x86 compilers that can
+// build it without -mpclmul - used only when the CPU has it.  Define
+// CRC32_NO_PCLMUL to leave it out.
+//---------------------------------------------------------------------
+#if !defined(CRC32_NO_PCLMUL)
+    #if defined(_MSC_VER) && (_MSC_VER >= 1500) && (defined(_M_IX86) || defined(_M_X64))
+        #define CRC32_HAVE_PCLMUL
+        #define CRC32_PCLMUL_TARGET
+        #include <intrin.h>
+        #include <emmintrin.h>
+        #include <wmmintrin.h>
+    #elif (defined(__i386__) || defined(__x86_64__)) && \
+          ( defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 4)) )
+        #define CRC32_HAVE_PCLMUL
+        #define CRC32_PCLMUL_TARGET     __attribute__((target("sse2,pclmul")))
+        #include <cpuid.h>
+        #include <emmintrin.h>
+        #include <wmmintrin.h>
+    #endif
+#endif
+
+// Bytes below which the folding isn't worth its setup.
+#define CRC32_PCLMUL_MIN_LENGTH         64
+
+//---------------------------------------------------------------------
+// Tables for the reflected polynomial 0xEDB88320, sliced 16 ways -
+// m_nTable[0] is the classic byte table, m_nTable[n] advances a byte
+// through n more zero bytes.  Built during static initialization,
+// before any threads are started, along with the CPU check.
+//---------------------------------------------------------------------
+class Crc32Table
+{
+public:
+    unsigned int    m_nTable[16][256];
+    bool            m_bPclmul;
+
+    Crc32Table() {
+        for (unsigned int nIndex = 0; nIndex < 256; nIndex++) {
+            unsigned int nValue = nIndex;
+            for (int nBit = 0; nBit < 8; nBit++) {
+                nValue = (nValue & 1) ? (0xEDB88320 ^ (nValue >> 1)) : (nValue >> 1);
+            }
+            m_nTable[0][nIndex] = nValue;
+        }
+
+        for (unsigned int nIndex = 0; nIndex < 256; nIndex++) {
+            for (int nSlice = 1; nSlice < 16; nSlice++) {
+                unsigned int nValue = m_nTable[nSlice - 1][nIndex];
+                m_nTable[nSlice][nIndex] = m_nTable[0][nValue & 0xFF] ^ (nValue >> 8);
+            }
+        }
+
+        m_bPclmul = HasPclmul();
+    }
+
+private:
+    static bool HasPclmul() {
+        #if defined(CRC32_HAVE_PCLMUL) && defined(_MSC_VER)
+            int nCpuInfo[4];
+            __cpuid(nCpuInfo, 1);
+            return ( (nCpuInfo[2] & (1 << 1)) != 0 ) && ( (nCpuInfo[3] & (1 << 26)) != 0 );
+        #elif defined(CRC32_HAVE_PCLMUL)
+            unsigned int nEax = 0, nEbx = 0, nEcx = 0, nEdx = 0;
+            if (__get_cpuid(1, &nEax, &nEbx, &nEcx, &nEdx) == 0) {
+                return false;
+            }
+            return ( (nEcx & (1 << 1)) != 0 ) && ( (nEdx & (1 << 26)) != 0 );
+        #else
+            return false;
+        #endif
+    }
+};
+
+static const Crc32Table g_crc32Table;
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Extend the (inverted) CRC one byte at a time.
+static unsigned int UpdateBytes(unsigned int nCrc, const unsigned char* pBuffer, size_t nLength)
+{
+    const unsigned int* pTable = g_crc32Table.m_nTable[0];
+
+    while (nLength--) {
+        nCrc = pTable[(nCrc ^ *pBuffer++) & 0xFF] ^ (nCrc >> 8);
+    }
+
+    return nCrc;
+
+} // End UpdateBytes
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Extend the (inverted) CRC 16 bytes at a time - the words
+//          are assembled byte by byte, so any alignment and byte order
+//          will do.
+static unsigned int UpdateSliced(unsigned int nCrc, const unsigned char* pBuffer, size_t nLength)
+{
+    const unsigned int (*pTable)[256] = g_crc32Table.m_nTable;
+
+    while (nLength >= 16) {
+        unsigned int nWord0 = nCrc ^ ( (unsigned int)pBuffer[0] |
+                                       ((unsigned int)pBuffer[1] << 8) |
+                                       ((unsigned int)pBuffer[2] << 16) |
+                                       ((unsigned int)pBuffer[3] << 24) );
+
+        nCrc = pTable[15][nWord0 & 0xFF] ^
+               pTable[14][(nWord0 >> 8) & 0xFF] ^
+               pTable[13][(nWord0 >> 16) & 0xFF] ^
+               pTable[12][nWord0 >> 24] ^
+               pTable[11][pBuffer[4]] ^
+               pTable[10][pBuffer[5]] ^
+               pTable[9][pBuffer[6]] ^
+               pTable[8][pBuffer[7]] ^
+               pTable[7][pBuffer[8]] ^
+               pTable[6][pBuffer[9]] ^
+               pTable[5][pBuffer[10]] ^
+               pTable[4][pBuffer[11]] ^
+               pTable[3][pBuffer[12]] ^
+               pTable[2][pBuffer[13]] ^
+               pTable[1][pBuffer[14]] ^
+               pTable[0][pBuffer[15]];
+
+        pBuffer += 16;
+        nLength -= 16;
+    }
+
+    return UpdateBytes(nCrc, pBuffer, nLength);
+
+} // End UpdateSliced
+
+#ifdef CRC32_HAVE_PCLMUL
+//---------------------------------------------------------------------
+// Folding constants for the reflected polynomial, as 32 bit halves of
+// the 64 bit values (low half first): x^(4*128+32), x^(4*128-32) mod P,
+// then x^(128+32), x^(128-32), then x^64, and the Barrett constants
+// P' and mu.
+//---------------------------------------------------------------------
+static const unsigned int g_nFoldBy4[4] = { 0x54442bd4, 0x00000001, 0xc6e41596, 0x00000001 };
+static const unsigned int g_nFoldBy1[4] = { 0x751997d0, 0x00000001, 0xccaa009e, 0x00000000 };
+static const unsigned int g_nFold64[4]  = { 0x63cd6124, 0x00000001, 0x00000000, 0x00000000 };
+static const unsigned int g_nBarrett[4] = { 0xdb710641, 0x00000001, 0xf7011641, 0x00000001 };
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Extend the (inverted) CRC by folding 64 bytes at a time
+//          with carry-less multiplies, then reduce to 32 bits.
+// Requires:
+//      nLength: a multiple of 16, at least 64.
+CRC32_PCLMUL_TARGET
+static unsigned int UpdatePclmul(unsigned int nCrc, const unsigned char* pBuffer, size_t nLength)
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)nCrc));
+    x0 = _mm_loadu_si128((const __m128i*)g_nFoldBy4);
+
+    pBuffer += 64;
+    nLength -= 64;
+
+    // Four lanes of 128 bits, each folded 512 bits ahead.
+    while (nLength >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(pBuffer + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(pBuffer + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(pBuffer + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(pBuffer + 0x30)));
+
+        pBuffer += 64;
+        nLength -= 64;
+    }
+
+    // Fold the four lanes into one.
+    x0 = _mm_loadu_si128((const __m128i*)g_nFoldBy1);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // The 16 byte blocks left.
+    while (nLength >= 16) {
+        x2 = _mm_loadu_si128((const __m128i*)pBuffer);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        pBuffer += 16;
+        nLength -= 16;
+    }
+
+    // 128 bits to 64.
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadu_si128((const __m128i*)g_nFold64);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    x0 = _mm_loadu_si128((const __m128i*)g_nBarrett);
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+
+} // End UpdatePclmul
+#endif // CRC32_HAVE_PCLMUL
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Extend a CRC32 with the given bytes - folds with PCLMULQDQ
+//          when the CPU has it, otherwise 16 bytes per table step.
+// Requires:
+//      nCrc: CRC32 of the preceding bytes, 0 to start.
+//      pBuffer: data
+//      nLength: number of bytes
+// Returns: the CRC32 including the given bytes.
+unsigned int Crc32Util::Update(unsigned int nCrc, const unsigned char* pBuffer, size_t nLength)
+{
+    nCrc = ~nCrc;
+
+    #ifdef CRC32_HAVE_PCLMUL
+        if ( g_crc32Table.m_bPclmul && (nLength >= CRC32_PCLMUL_MIN_LENGTH) ) {
+            size_t nFolded = nLength & ~(size_t)15;
+            nCrc = UpdatePclmul(nCrc, pBuffer, nFolded);
+            pBuffer += nFolded;
+            nLength -= nFolded;
+        }
+    #endif
+
+    nCrc = UpdateSliced(nCrc, pBuffer, nLength);
+
+    return ~nCrc;
+
+} // End Update
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Extend a CRC32 without the hardware path - for checking it.
+// Requires:
+//      nCrc: CRC32 of the preceding bytes, 0 to start.
+//      pBuffer: data
+//      nLength: number of bytes
+// Returns: the CRC32 including the given bytes.
+unsigned int Crc32Util::UpdatePortable(unsigned int nCrc, const unsigned char* pBuffer, size_t nLength)
+{
+    return ~UpdateSliced(~nCrc, pBuffer, nLength);
+
+} // End UpdatePortable
+
+///////////////////////////////////////////////////////////////////////
+bool Crc32Util::IsAccelerated()
+{
+    return g_crc32Table.m_bPclmul;
+
+} // End IsAccelerated
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: CRC32 of a range of a file.
+// Requires:
+//      pFile: file opened for binary reading
+//      l64Offset: start of the range
+//      l64Length: number of bytes
+//      nCrc: CRC32 to extend (0 to start), set to the result.
+// Returns: true if successful, false if the range could not be read.
+bool Crc32Util::FileRange(FILE* pFile, LONG64 l64Offset, LONG64 l64Length, unsigned int& nCrc)
+{
+    if ( (pFile == NULL) || (CRC32_FSEEK64(pFile, l64Offset) != 0) ) {
+        return false;
+    }
+
+    unsigned char* pBuffer = new unsigned char[CRC32_READ_BUFFER_SIZE];
+    bool bSuccess = true;
+
+    while (l64Length > 0) {
+        size_t nRead = (l64Length > CRC32_READ_BUFFER_SIZE) ? CRC32_READ_BUFFER_SIZE :
+                                                              (size_t)l64Length;
+        if (fread(pBuffer, 1, nRead, pFile) != nRead) {
+            bSuccess = false;
+            break;
+        }
+
+        nCrc = Update(nCrc, pBuffer, nRead);
+        l64Length -= nRead;
+    }
+
+    delete [] pBuffer;
+    return bSuccess;
+
+} // End FileRange
@@ -0,0 +1,55 @@
+/*********************************************************************
+ *
+ *  file:  Crc32Util.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Incremental CRC32 (IEEE 802.3, as used by zlib) for
+ *          checksumming file data as it is read.
+ *
+ *********************************************************************/
+
+#ifndef __CRC32_UTIL_H__
+#define __CRC32_UTIL_H__
+
+#include "Stdafx.h"
+#include "types.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+///////////////////////////////////////////////////////////////////////
+// Usage:
+//      unsigned int nCrc = 0;
+//      nCrc = Crc32Util::Update(nCrc, pBuffer1, nLength1);
+//      nCrc = Crc32Util::Update(nCrc, pBuffer2, nLength2);
+//
+// The result is the same as a single Update over both buffers, so a
+// checksum can be extended as more of a file becomes available.
+//
+// Update folds 64 bytes at a time with PCLMULQDQ when the CPU has it,
+// and otherwise looks up 16 bytes at a time in sliced tables - either
+// way several times the speed of a byte at a time.
+
+namespace Crc32Util
+{
+    unsigned int Update(unsigned int nCrc, const unsigned char* pBuffer, size_t nLength);
+
+    //-----------------------------------------------------------------
+    // Update without the PCLMULQDQ path, and whether Update takes it.
+    //-----------------------------------------------------------------
+    unsigned int UpdatePortable(unsigned int nCrc, const unsigned char* pBuffer, size_t nLength);
+    bool IsAccelerated();
+
+    //-----------------------------------------------------------------
+    // CRC32 of nLength bytes of the file starting at l64Offset.
+    // Returns false if the bytes could not be read.
+    //-----------------------------------------------------------------
+    bool FileRange(FILE* pFile, LONG64 l64Offset, LONG64 l64Length, unsigned int& nCrc);
+}
+
+#endif // __CRC32_UTIL_H__
@@ -0,0 +1,225 @@
+/*********************************************************************
+ *
+ *  file:  FileHashBatch.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: MD5 digests of a batch of files - several files are read at
+ *          once and hashed side by side in SIMD lanes.
+ *
+ *********************************************************************/
+
+#include "Stdafx.h"
+#include "FileHashBatch.h"
+#include "FileReader.h"
+
+#include "openssl/md5.h"
+
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////
+// Reads a file whole, or hashes it as it's read if it's larger than
+// FILE_HASH_MAX_BUFFERED_SIZE, then queues itself as read.
+class FileReadTask : public CTask
+{
+public:
+    int                         m_nFile;
+    std::string                 m_szFilePath;
+    CTaskQueue*                 m_pReadQueue;
+
+    int                         m_nResult;          // 0, or errno
+    bool                        m_bHashed;          // m_digest set by the reader
+    std::vector<unsigned char>  m_listBuffer;       // The file, if not hashed
+    unsigned char               m_digest[MD5_MULTI_BUFFER_DIGEST_SIZE];
+
+    FileReadTask(int nFile, const std::string& szFilePath, CTaskQueue* pReadQueue)
+        : m_nFile(nFile), m_szFilePath(szFilePath), m_pReadQueue(pReadQueue),
+          m_nResult(0), m_bHashed(false) { memset(m_digest, 0, sizeof(m_digest)); };
+    virtual ~FileReadTask() {};
+
+    virtual BOOL Task();
+
+    // The file's memory, once hashed - the task itself stays until the
+    // executor is done with it.
+    void FreeBuffer() { std::vector<unsigned char>().swap(m_listBuffer); }
+
+private:
+    int ReadFile();
+};
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Read the file, and queue the task as read.
+// Requires: nothing
+// Returns: TRUE
+BOOL FileReadTask::Task()
+{
+    m_nResult = ReadFile();
+    if (m_nResult != 0) {
+        FreeBuffer();
+    }
+
+    // The queue holds every pending file, so this never waits.
+    m_pReadQueue->Push((LPVOID)this, TaskPriorityNormal, QUEUE_WAIT_INFINITE);
+    return TRUE;
+
+} // End Task
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Read the file whole, or hash it as it's read.
+// Requires: nothing
+// Returns: 0 if the file was read, errno otherwise.
+int FileReadTask::ReadFile()
+{
+    FileReader fileReader;
+    if (fileReader.Open(m_szFilePath) == false) {
+        return fileReader.GetError();
+    }
+
+    //-----------------------------------------------------------------
+    // Keep the file if it's small enough to read whole - one that grows
+    // past that while it's read is hashed from there on.
+    //-----------------------------------------------------------------
+    MD5_CTX md5State;
+    bool bHashing = (fileReader.GetFileSize() > FILE_HASH_MAX_BUFFERED_SIZE);
+    if (bHashing) {
+        MD5_Init(&md5State);
+    }
+    else {
+        m_listBuffer.reserve((size_t)fileReader.GetFileSize());
+    }
+
+    const unsigned char* pData = NULL;
+    size_t nLength = 0;
+
+    while (fileReader.Next(pData, nLength) && (nLength > 0)) {
+        if ( (bHashing == false) &&
+             (m_listBuffer.size() + nLength > FILE_HASH_MAX_BUFFERED_SIZE) ) {
+            MD5_Init(&md5State);
+            if (m_listBuffer.empty() == false) {
+                MD5_Update(&md5State, &m_listBuffer[0], m_listBuffer.size());
+            }
+            FreeBuffer();
+            bHashing = true;
+        }
+
+        if (bHashing) {
+            MD5_Update(&md5State, pData, nLength);
+        }
+        else {
+            m_listBuffer.insert(m_listBuffer.end(), pData, pData + nLength);
+        }
+    }
+
+    if (fileReader.GetError() != 0) {
+        return fileReader.GetError();
+    }
+
+    if (bHashing) {
+        MD5_Final(m_digest, &md5State);
+        m_bHashed = true;
+    }
+
+    return 0;
+
+} // End ReadFile
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: FileHashBatch constructor - starts the readers.
+// Requires:
+//      nReaders: number of reader threads, at most EXECUTOR_MAX_WORKERS.
+FileHashBatch::FileHashBatch(int nReaders /*FILE_HASH_DEFAULT_READERS*/)
+    : m_executor(nReaders),
+      m_readQueue(FILE_HASH_MAX_PENDING)
+{
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Hash the files - up to FILE_HASH_MAX_PENDING are read ahead
+//          while the calling thread hashes those already read.
+// Requires:
+//      listFiles: files to hash - the digest and result of each are set.
+// Returns: nothing
+void FileHashBatch::HashFiles(FileHashEntryList& listFiles)
+{
+    size_t nFiles = listFiles.size();
+    size_t nNext = 0;
+    size_t nDone = 0;
+    int nPending = 0;
+
+    std::vector<FileReadTask*> listTasks;
+    listTasks.reserve(nFiles);
+
+    Md5MultiBuffer md5Lanes;
+    std::vector<Md5MultiBufferResult> listResults;
+
+    while (nDone < nFiles) {
+
+        // Keep the readers ahead of the hashing.
+        while ( (nPending < FILE_HASH_MAX_PENDING) && (nNext < nFiles) ) {
+            FileReadTask* pTask = new FileReadTask((int)nNext, listFiles[nNext].szFilePath,
+                                                   &m_readQueue);
+            listTasks.push_back(pTask);
+
+            if (m_executor.Submit(pTask) == false) {
+                // No readers - read it here.
+                pTask->Task();
+            }
+
+            nPending++;
+            nNext++;
+        }
+
+        //-------------------------------------------------------------
+        // Fill the free lanes with the files read so far - wait for a
+        // read only when no lane has work.
+        //-------------------------------------------------------------
+        while ( md5Lanes.HasFreeLane() && (nPending > 0) ) {
+            LPVOID lpvTask = NULL;
+            DWORD dwTimeout = md5Lanes.IsIdle() ? QUEUE_WAIT_INFINITE : 0;
+            if (m_readQueue.Pop(&lpvTask, dwTimeout) == FALSE) {
+                break;
+            }
+
+            nPending--;
+
+            FileReadTask* pTask = (FileReadTask*)lpvTask;
+            FileHashEntry& fileEntry = listFiles[pTask->m_nFile];
+            fileEntry.nResult = pTask->m_nResult;
+
+            if ( (pTask->m_nResult != 0) || pTask->m_bHashed ) {
+                memcpy(fileEntry.digest, pTask->m_digest, sizeof(fileEntry.digest));
+                nDone++;
+                continue;
+            }
+
+            const unsigned char* pBuffer = pTask->m_listBuffer.empty() ? NULL : &pTask->m_listBuffer[0];
+            md5Lanes.Add(pTask->m_nFile, pBuffer, pTask->m_listBuffer.size());
+        }
+
+        if (md5Lanes.IsIdle()) {
+            continue;
+        }
+
+        listResults.clear();
+        md5Lanes.Run(listResults);
+
+        for (int nResult = 0; nResult < (int)listResults.size(); nResult++) {
+            int nFile = listResults[nResult].nJob;
+            memcpy(listFiles[nFile].digest, listResults[nResult].digest, sizeof(listFiles[nFile].digest));
+            listTasks[nFile]->FreeBuffer();
+            nDone++;
+        }
+    }
+
+    // The readers are done with the tasks once none are outstanding.
+    m_executor.WaitAll();
+
+    for (int nTask = 0; nTask < (int)listTasks.size(); nTask++) {
+        delete listTasks[nTask];
+    }
+
+} // End HashFiles
@@ -0,0 +1,84 @@
+/*********************************************************************
+ *
+ *  file:  FileHashBatch.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: MD5 digests of a batch of files - several files are read at
+ *          once and hashed side by side in SIMD lanes.
+ *
+ *********************************************************************/
+
+#ifndef __FILE_HASH_BATCH_H__
+#define __FILE_HASH_BATCH_H__
+
+#include "Stdafx.h"
+#include "TaskExecutor.h"
+#include "Md5MultiBuffer.h"
+
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------
+// Threads reading files, files read ahead of the hashing, and the
+// largest file read whole - a larger one is hashed by its reader as
+// it's read.
+//---------------------------------------------------------------------
+#define FILE_HASH_DEFAULT_READERS       8
+#define FILE_HASH_MAX_PENDING           64
+#define FILE_HASH_MAX_BUFFERED_SIZE     (256 * 1024)
+
+//---------------------------------------------------------------------
+// File to hash, and its digest once hashed - nResult is 0 if the file
+// was read, errno otherwise.
+//---------------------------------------------------------------------
+struct FileHashEntry
+{
+    std::string                 szFilePath;
+    int                         nResult;
+    unsigned char               digest[MD5_MULTI_BUFFER_DIGEST_SIZE];
+};
+
+typedef std::vector<FileHashEntry> FileHashEntryList;
+
+///////////////////////////////////////////////////////////////////////
+// FileHashBatch Class
+//
+// Usage:
+//      FileHashEntryList listFiles;
+//      ...add the files...
+//
+//      FileHashBatch hashBatch;
+//      hashBatch.HashFiles(listFiles);
+//
+// The readers keep several opens and reads in flight, so a tree of
+// small files isn't hashed at the pace of one file's I/O at a time; the
+// calling thread hashes the files as they arrive, up to
+// MD5_MULTI_BUFFER_LANES at once.
+
+class FileHashBatch
+{
+private:
+    TaskExecutor                m_executor;
+    CTaskQueue                  m_readQueue;        // Files read, in the order read
+
+public:
+    FileHashBatch(int nReaders=FILE_HASH_DEFAULT_READERS);
+    virtual ~FileHashBatch() {}
+
+    //-----------------------------------------------------------------
+    // Set the digest and result of each file.
+    //-----------------------------------------------------------------
+    void HashFiles(FileHashEntryList& listFiles);
+
+private:
+    // Not implemented
+    FileHashBatch(const FileHashBatch&);
+    FileHashBatch& operator=(const FileHashBatch&);
+};
+
+#endif // __FILE_HASH_BATCH_H__
@@ -14,6 +14,7 @@
 
 #include "Stdafx.h"
 #include "FileLogger.h"
+#include "Thread.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -25,12 +26,37 @@
 #define getcwd _getcwd
 
 #else
+#include <zlib.h>
 #define DIR_SEPARATOR '/'
 #endif
 
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+/////////////////////////////////////////////////////////////////////////////
+// Interval driven thread used to write the buffered log output.
+class FileLoggerThread : public CThread
+{
+public:
+    FileLoggerThread(FileLogger* pFileLogger) : m_pFileLogger(pFileLogger) {}
+    virtual ~FileLoggerThread() {}
+
+    // Called when a time interval has elapsed.
+	virtual BOOL OnTask() {
+	    m_pFileLogger->BackgroundFlush();
+	    return TRUE;
+	}
+
+private:
+    FileLogger*     m_pFileLogger;
+};
+
 /////////////////////////////////////////////////////////////////////////////
 FileLogger::FileLogger()
-: m_logFile(0),m_iFiles(0),m_logFilenames(0),m_iMaxLogFileSize(0),m_iCurFile(0)
+: m_logFile(0),m_iFiles(0),m_logFilenames(0),m_iMaxLogFileSize(0),m_iCurFile(0),
+  m_l64FileBytes(0),m_bBuffered(false),m_bCompressRotated(false),m_iBufferSize(0),
+  m_iBuffers(0),m_pActiveBuffer(0),m_pFlushThread(0),m_iCompressingFile(-1),
+  m_bCompressOverrun(false)
 {
 }
 
@@ -58,6 +84,8 @@ bool FileLogger::Init( int nNumberOfLogFiles, const char* szDirectory, int nMaxL
 	struct stat lastModified;
 	bool bFirstFile = true;
 
+	memset(&lastModified, 0, sizeof(lastModified));
+
     for (nIndex = 0; nIndex < m_iFiles; nIndex++) {
         sprintf(m_logFilenames[nIndex], _T("%s%cLog%d.txt"),
                  szTheDirectory,
@@ -87,12 +115,17 @@ bool FileLogger::Init( int nNumberOfLogFiles, const char* szDirectory, int nMaxL
 	}
 	
 	bool bTruncate = false;
+	m_l64FileBytes = 0;
+
 	if (!bFirstFile) {
 		// we found at least one log file
 		if (m_iMaxLogFileSize && (lastModified.st_size > m_iMaxLogFileSize)) {
 			m_iCurFile = (m_iCurFile + 1) % m_iFiles;
 			bTruncate = true;
 		}
+		else {
+		    m_l64FileBytes = lastModified.st_size;
+		}
 	}
 
 	if (bTruncate) {
@@ -109,6 +142,8 @@ bool FileLogger::Init( int nNumberOfLogFiles, const char* szDirectory, int nMaxL
 /////////////////////////////////////////////////////////////////////////////
 FileLogger::~FileLogger()
 {
+    DisableBuffering();
+
 	if (m_logFile) {
 		fclose(m_logFile);
 		m_logFile = 0;
@@ -121,33 +156,340 @@ FileLogger::~FileLogger()
 	}
 }
 
+/////////////////////////////////////////////////////////////////////////////
+bool FileLogger::EnableBuffering( int nBufferSize, ULONG ulFlushInterval,
+                                  bool bCompressRotated )
+{
+    if (m_bBuffered) {
+        return true;
+    }
+
+    if ( (nBufferSize <= 0) || (m_logFile == 0) ) {
+        return false;
+    }
+
+    m_iBufferSize = nBufferSize;
+    m_bCompressRotated = bCompressRotated;
+
+    // Start with the active buffer and one spare - more are added, up
+    // to FILE_LOGGER_MAX_BUFFERS, if the background thread falls behind.
+    for (int nIndex = 0; nIndex < 2; nIndex++) {
+        FileLogBuffer* pBuffer = new FileLogBuffer;
+        pBuffer->m_pData = new char[m_iBufferSize];
+        pBuffer->m_nUsed = 0;
+        pBuffer->m_bRotateAfter = false;
+        m_freeBuffers.push_back(pBuffer);
+        m_iBuffers++;
+    }
+
+    m_pActiveBuffer = m_freeBuffers.front();
+    m_freeBuffers.pop_front();
+
+    m_pFlushThread = new FileLoggerThread(this);
+    if (m_pFlushThread->GetErrorFlags() != NO_ERRORS) {
+        delete m_pFlushThread;
+        m_pFlushThread = 0;
+        DisableBuffering();
+        return false;
+    }
+
+    m_bBuffered = true;
+    m_pFlushThread->SetThreadType(ThreadTypeIntervalDriven, ulFlushInterval);
+
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void FileLogger::DisableBuffering()
+{
+    if (m_pFlushThread) {
+        m_pFlushThread->Stop();
+        delete m_pFlushThread;
+        m_pFlushThread = 0;
+    }
+
+    Lock<CCriticalSection> lock(m_bufferLock);
+    m_bBuffered = false;
+
+    // Write out whatever is left before releasing the buffers.
+    if (m_pActiveBuffer) {
+        m_pendingBuffers.push_back(m_pActiveBuffer);
+        m_pActiveBuffer = 0;
+    }
+
+    WriteBuffers(m_pendingBuffers);
+    m_freeBuffers.splice(m_freeBuffers.end(), m_pendingBuffers);
+
+    while (m_freeBuffers.size() > 0) {
+        FileLogBuffer* pBuffer = m_freeBuffers.front();
+        m_freeBuffers.pop_front();
+        delete [] pBuffer->m_pData;
+        delete pBuffer;
+    }
+
+    m_iBuffers = 0;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 void FileLogger::LogMessageCallback(const string& szMessage, int len)
 {
-	if (m_logFile) {
+    if (m_logFile == 0) {
+        return;
+    }
+
+    int nLen = (int)szMessage.length();
+
+    if (m_bBuffered) {
+        Lock<CCriticalSection> lock(m_bufferLock);
+        if (m_pActiveBuffer == 0) {
+            // Buffering was turned off while we waited.
+            return;
+        }
+
+        // The rotation point is decided here, from the bytes handed to
+        // the current file, and carried out by the background thread.
+        if (m_iMaxLogFileSize && (m_l64FileBytes > 0) &&
+            (m_l64FileBytes + nLen > m_iMaxLogFileSize)) {
+            m_pActiveBuffer->m_bRotateAfter = true;
+            QueueActiveBuffer();
+            m_l64FileBytes = 0;
+        }
+
+        if (m_pActiveBuffer->m_nUsed + nLen > m_iBufferSize) {
+            QueueActiveBuffer();
+        }
+
+        if (nLen > m_iBufferSize) {
+            nLen = m_iBufferSize;
+        }
 
-		fputs( (char*)szMessage.c_str(), m_logFile );
-		fflush( m_logFile );
+        memcpy(m_pActiveBuffer->m_pData + m_pActiveBuffer->m_nUsed, szMessage.data(), nLen);
+        m_pActiveBuffer->m_nUsed += nLen;
+        m_l64FileBytes += nLen;
 
-		// Now check to see if the file exceeds the maximum file size
-		// first lock the logging mutex so only one thread can write to
-		// file at a time
-		if (m_iMaxLogFileSize && ftell(m_logFile)>m_iMaxLogFileSize) {
+        return;
+    }
 
-			// Time to switch to the next log file
-			fclose(m_logFile);
-            m_iCurFile = (m_iCurFile + 1) % m_iFiles;
+    Lock<CCriticalSection> lock(m_fileLock);
 
-            if ((m_logFile = _tfopen(m_logFilenames[m_iCurFile], _T("wt"))) == NULL) {
-		        // Error opening log file
+    fputs( (char*)szMessage.c_str(), m_logFile );
+    fflush( m_logFile );
+    m_l64FileBytes += nLen;
+
+    // Now check to see if the file exceeds the maximum file size
+    if (m_iMaxLogFileSize && (m_l64FileBytes > m_iMaxLogFileSize)) {
+        RotateLogFile();
+        m_l64FileBytes = 0;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Move the active buffer onto the pending list and pick up a free one.
+// If every buffer is waiting to be written, they're written here.
+// Requires m_bufferLock.
+bool FileLogger::QueueActiveBuffer()
+{
+    m_pendingBuffers.push_back(m_pActiveBuffer);
+    m_pActiveBuffer = 0;
+
+    if (m_freeBuffers.size() == 0) {
+        if (m_iBuffers < FILE_LOGGER_MAX_BUFFERS) {
+            FileLogBuffer* pBuffer = new FileLogBuffer;
+            pBuffer->m_pData = new char[m_iBufferSize];
+            pBuffer->m_nUsed = 0;
+            pBuffer->m_bRotateAfter = false;
+            m_freeBuffers.push_back(pBuffer);
+            m_iBuffers++;
+        }
+        else {
+            std::list<FileLogBuffer*> buffers;
+            buffers.swap(m_pendingBuffers);
+            WriteBuffers(buffers);
+            m_freeBuffers.splice(m_freeBuffers.end(), buffers);
+        }
+    }
+
+    m_pActiveBuffer = m_freeBuffers.front();
+    m_freeBuffers.pop_front();
+
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Write the buffers in order, rotating where marked.  The buffers are
+// reset but left on the list for the caller to return.
+void FileLogger::WriteBuffers( std::list<FileLogBuffer*>& buffers )
+{
+    Lock<CCriticalSection> lock(m_fileLock);
+
+    std::list<FileLogBuffer*>::iterator lit;
+    for (lit = buffers.begin(); lit != buffers.end(); lit++) {
+        FileLogBuffer* pBuffer = (*lit);
+
+        if (m_logFile && (pBuffer->m_nUsed > 0)) {
+            fwrite(pBuffer->m_pData, 1, pBuffer->m_nUsed, m_logFile);
+        }
+
+        if (pBuffer->m_bRotateAfter) {
+            RotateLogFile();
+        }
+
+        pBuffer->m_nUsed = 0;
+        pBuffer->m_bRotateAfter = false;
+    }
+
+    if (m_logFile) {
+        fflush(m_logFile);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void FileLogger::BackgroundFlush()
+{
+    std::list<FileLogBuffer*> buffers;
+
+    // The file lock is taken before the buffer lock is released so that
+    // a caller forced to write inline can't get ahead of these buffers.
+    m_bufferLock.Lock();
+
+    if (m_pActiveBuffer && (m_pActiveBuffer->m_nUsed > 0)) {
+        QueueActiveBuffer();
+    }
+
+    m_fileLock.Lock();
+    buffers.swap(m_pendingBuffers);
+    m_bufferLock.Unlock();
+
+    WriteBuffers(buffers);
+
+    std::list<int> rotatedFiles;
+    rotatedFiles.swap(m_rotatedFiles);
+
+    m_fileLock.Unlock();
+
+    if (buffers.size() > 0) {
+        Lock<CCriticalSection> lock(m_bufferLock);
+        m_freeBuffers.splice(m_freeBuffers.end(), buffers);
+    }
+
+    // No lock is held here, so logging callers aren't held up by the
+    // compression.
+    rotatedFiles.sort();
+    rotatedFiles.unique();
+
+    if (rotatedFiles.size() > 0) {
+        Lock<CCriticalSection> lock(m_compressLock);
+
+        while (rotatedFiles.size() > 0) {
+            CompressLogFile(rotatedFiles.front());
+            rotatedFiles.pop_front();
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void FileLogger::Flush()
+{
+    if (m_bBuffered) {
+        BackgroundFlush();
+        return;
+    }
+
+    Lock<CCriticalSection> lock(m_fileLock);
+    if (m_logFile) {
+        fflush(m_logFile);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Switch to the next log file.  Requires m_fileLock.
+void FileLogger::RotateLogFile()
+{
+    int nRotatedFile = m_iCurFile;
+
+    if (m_logFile) {
+        fclose(m_logFile);
+    }
+    m_iCurFile = (m_iCurFile + 1) % m_iFiles;
+
+    if (m_iCurFile == m_iCompressingFile) {
+        m_bCompressOverrun = true;
+    }
+
+    if ((m_logFile = _tfopen(m_logFilenames[m_iCurFile], _T("wt"))) == NULL) {
+        // Error opening log file
 #ifdef WIN32
-				OutputDebugString(_T("Error opening rollover log file.\n"));
+        OutputDebugString(_T("Error opening rollover log file.\n"));
 #endif
+    }
+
+    // Compressed later by the background thread.
+    if (m_bCompressRotated && (nRotatedFile != m_iCurFile)) {
+        m_rotatedFiles.push_back(nRotatedFile);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Compress a rotated log file to <name>.gz and remove the original.
+// Requires m_compressLock - the file is read without m_fileLock, so
+// a rotation back onto it while it's read discards the copy instead.
+void FileLogger::CompressLogFile( int nFileIndex )
+{
+#ifndef WIN32
+    {
+        // Several rotations may have wrapped back around to the active
+        // file, which is skipped.
+        Lock<CCriticalSection> lock(m_fileLock);
+        if (nFileIndex == m_iCurFile) {
+            return;
+        }
+
+        m_iCompressingFile = nFileIndex;
+        m_bCompressOverrun = false;
+    }
+
+    string szSource = m_logFilenames[nFileIndex];
+    string szTarget = szSource + _T(".gz");
+
+    FILE* pSource = fopen(szSource.c_str(), _T("rb"));
+    gzFile gzTarget = NULL;
+    bool bSuccess = false;
+
+    if (pSource != NULL) {
+        gzTarget = gzopen(szTarget.c_str(), _T("wb"));
+    }
+
+    if (gzTarget != NULL) {
+        char szBuffer[16384];
+        size_t nRead = 0;
+        bSuccess = true;
+
+        while ((nRead = fread(szBuffer, 1, sizeof(szBuffer), pSource)) > 0) {
+            if (gzwrite(gzTarget, szBuffer, (unsigned)nRead) != (int)nRead) {
+                bSuccess = false;
+                break;
             }
         }
 
-	}
-}
+        if (gzclose(gzTarget) != Z_OK) {
+            bSuccess = false;
+        }
+    }
+
+    if (pSource != NULL) {
+        fclose(pSource);
+    }
 
+    Lock<CCriticalSection> lock(m_fileLock);
 
+    if (bSuccess && !m_bCompressOverrun) {
+        remove(szSource.c_str());
+    }
+    else if (gzTarget != NULL) {
+        remove(szTarget.c_str());
+    }
+
+    m_iCompressingFile = -1;
+#endif
+}
 
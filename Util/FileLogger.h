@@ -23,6 +23,23 @@
 */
 
 #include "ClientLog.h"
+#include "CriticalSection.h"
+
+#include <list>
+
+class FileLoggerThread;
+
+// Default buffered mode settings.
+#define FILE_LOGGER_MAX_BUFFERS         4
+
+/////////////////////////////////////////////////////////////////////////////
+// A block of log output waiting to be written.  m_bRotateAfter marks the
+// last block belonging to the current log file.
+struct FileLogBuffer {
+    char*           m_pData;
+    int             m_nUsed;
+    bool            m_bRotateAfter;
+};
 
 class FileLogger : public LogObserver {
 public:
@@ -40,6 +57,15 @@ public:
 	// (effectively turning off log rotation)
 	bool Init( int files, const char* directory, int maxLogFileSize );
 
+	// Switch to buffered mode: messages are appended to an in-memory
+	// buffer of bufferSize bytes and a background thread writes them,
+	// rotates the log files and optionally compresses the rotated file
+	// every flushInterval milliseconds.  A full buffer is handed off to
+	// the background thread; the caller only writes to the file itself
+	// if all buffers are waiting to be written.
+	// Must be called after Init and before the logger is registered.
+	bool EnableBuffering( int bufferSize, ULONG flushInterval, bool compressRotated );
+
 	// log the message to the currently active log file
 	// log files are rotated once the max file size is reached
 	virtual void LogMessageCallback(const string& szMessage, int len);
@@ -49,14 +75,50 @@ public:
 	    m_nLogObserverType = FILE_LOGGER_TYPE;
 	}
 
-    void Flush() { if (m_logFile) fflush(m_logFile); }
+    // Write any buffered messages and flush the active log file.
+    void Flush();
+
+    // Called periodically from the background thread in buffered mode.
+    void BackgroundFlush();
 
 private:
+    void RotateLogFile();
+    void CompressLogFile( int nFileIndex );
+    bool QueueActiveBuffer();
+    void WriteBuffers( std::list<FileLogBuffer*>& buffers );
+    void DisableBuffering();
+
 	FILE*           m_logFile;
 	int             m_iFiles;
 	char**          m_logFilenames;
 	int             m_iMaxLogFileSize;
 	int             m_iCurFile;
+
+	// Bytes written (or queued) to the active log file - tracked here
+	// rather than queried from the file.
+	LONG64          m_l64FileBytes;
+
+	// Buffered mode
+	bool                                m_bBuffered;
+	bool                                m_bCompressRotated;
+	int                                 m_iBufferSize;
+	int                                 m_iBuffers;
+	FileLogBuffer*                      m_pActiveBuffer;
+	std::list<FileLogBuffer*>           m_pendingBuffers;
+	std::list<FileLogBuffer*>           m_freeBuffers;
+	FileLoggerThread*                   m_pFlushThread;
+	std::list<int>                      m_rotatedFiles;
+
+	// The rotated file being compressed, and whether a rotation has
+	// reopened it since - both under m_fileLock.
+	int                                 m_iCompressingFile;
+	bool                                m_bCompressOverrun;
+
+	// Lock ordering: m_bufferLock is always taken before m_fileLock, and
+	// m_compressLock before m_fileLock.
+	DIOMEDE_CRITICAL::CCriticalSection  m_bufferLock;
+	DIOMEDE_CRITICAL::CCriticalSection  m_fileLock;
+	DIOMEDE_CRITICAL::CCriticalSection  m_compressLock;
 };
 
 #endif // __FILE_LOGGER_H__
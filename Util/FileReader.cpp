@@ -0,0 +1,700 @@
+/*********************************************************************
+ *
+ *  file:  FileReader.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Sequential reads of a whole file - buffered, memory mapped,
+ *          or direct from the device with read-ahead - for hashing and
+ *          uploading.
+ *
+ *********************************************************************/
+
+#include "Stdafx.h"
+#include "FileReader.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Mode FileReadModeAuto picks for a file of the size - never
+//          mapped, the files hashed and uploaded may be truncated
+//          while they're read.
+// Requires:
+//      l64FileSize: size of the file
+// Returns: the mode to read the file with
+static FileReadMode_t GetAutoMode(LONG64 l64FileSize)
+{
+    if (l64FileSize >= FILE_READER_DIRECT_MIN_SIZE) {
+        return FileReadModeDirect;
+    }
+    return FileReadModeBuffered;
+
+} // End GetAutoMode
+
+#ifdef WIN32
+///////////////////////////////////////////////////////////////////////
+// Purpose: The errno closest to the last Windows error.
+// Requires: nothing
+// Returns: errno value
+static int GetLastErrno()
+{
+    switch (GetLastError()) {
+        case ERROR_FILE_NOT_FOUND:
+        case ERROR_PATH_NOT_FOUND:
+            return ENOENT;
+        case ERROR_ACCESS_DENIED:
+        case ERROR_SHARING_VIOLATION:
+            return EACCES;
+        case ERROR_NOT_ENOUGH_MEMORY:
+        case ERROR_OUTOFMEMORY:
+            return ENOMEM;
+        default:
+            return EIO;
+    }
+
+} // End GetLastErrno
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: FileReader constructor
+// Requires: nothing
+FileReader::FileReader() : m_eMode(FileReadModeAuto), m_l64FileSize(0), m_l64Offset(0),
+                           m_nError(0), m_pWindow(NULL), m_nWindowSize(0),
+                           m_nBufferSize(0), m_nBuffer(0), m_bReadPending(false),
+                           m_bReadAsync(false), m_nReadResult(0), m_bDropCache(false)
+{
+#ifdef WIN32
+    m_hFile = INVALID_HANDLE_VALUE;
+    m_hMapping = NULL;
+    memset(&m_overlapped, 0, sizeof(m_overlapped));
+#else
+    m_nFile = -1;
+    memset(&m_aioRead, 0, sizeof(m_aioRead));
+#endif
+
+    m_pBuffers[0] = NULL;
+    m_pBuffers[1] = NULL;
+
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Name of a read mode, for logging.
+// Requires:
+//      eMode: read mode
+// Returns: "buffered", "mapped", "direct" or "auto"
+const char* FileReader::GetModeName(FileReadMode_t eMode)
+{
+    switch (eMode) {
+        case FileReadModeBuffered:
+            return "buffered";
+        case FileReadModeMapped:
+            return "mapped";
+        case FileReadModeDirect:
+            return "direct";
+        default:
+            return "auto";
+    }
+
+} // End GetModeName
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Open the file to read from the start.
+// Requires:
+//      szFilePath: file to read
+//      eMode: how to read it
+// Returns: true if the file was opened, false otherwise - GetError
+//          gives the errno.
+bool FileReader::Open(const std::string& szFilePath, FileReadMode_t eMode /*FileReadModeAuto*/)
+{
+    Close();
+    m_nError = 0;
+
+#ifdef WIN32
+    m_hFile = ::CreateFileA(szFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_hFile == INVALID_HANDLE_VALUE) {
+        m_nError = GetLastErrno();
+        return false;
+    }
+
+    LARGE_INTEGER liFileSize;
+    if (::GetFileSizeEx(m_hFile, &liFileSize) == FALSE) {
+        m_nError = GetLastErrno();
+        Close();
+        return false;
+    }
+    m_l64FileSize = liFileSize.QuadPart;
+#else
+    m_nFile = open(szFilePath.c_str(), O_RDONLY);
+    if (m_nFile < 0) {
+        m_nError = errno;
+        return false;
+    }
+
+    struct stat fileStats;
+    if (fstat(m_nFile, &fileStats) != 0) {
+        m_nError = errno;
+        Close();
+        return false;
+    }
+    m_l64FileSize = fileStats.st_size;
+#endif
+
+    m_eMode = (eMode == FileReadModeAuto) ? GetAutoMode(m_l64FileSize) : eMode;
+
+    // Nothing to map in an empty file.
+    if ( (m_eMode == FileReadModeMapped) && (m_l64FileSize == 0) ) {
+        m_eMode = FileReadModeBuffered;
+    }
+
+    if (m_eMode == FileReadModeDirect) {
+        if (OpenDirect(szFilePath)) {
+            return true;
+        }
+        if (m_nError != 0) {
+            Close();
+            return false;
+        }
+
+        // Buffered, without leaving the file in the cache.
+        m_eMode = FileReadModeBuffered;
+        m_bDropCache = true;
+    }
+
+    if (m_eMode == FileReadModeBuffered) {
+        // A small file is read with a single read.
+        size_t nBufferSize = FILE_READER_BUFFER_SIZE;
+        if (m_l64FileSize < FILE_READER_BUFFER_SIZE) {
+            nBufferSize = (size_t)m_l64FileSize + 1;
+        }
+
+        if (AllocateBuffers(1, nBufferSize) == false) {
+            Close();
+            return false;
+        }
+
+    #if !defined(WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(m_nFile, 0, 0, POSIX_FADV_SEQUENTIAL);
+    #endif
+    }
+
+    return true;
+
+} // End Open
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Set the file up for direct reads, and start reading it.
+// Requires:
+//      szFilePath: the file opened
+// Returns: true if direct reads were started.  false with GetError 0
+//          if the file can't be read around the cache, false with
+//          GetError set otherwise.
+bool FileReader::OpenDirect(const std::string& szFilePath)
+{
+#ifdef WIN32
+    //-----------------------------------------------------------------
+    // Unbuffered reads need their own handle - the file is opened
+    // again, and the first handle kept if that fails.
+    //-----------------------------------------------------------------
+    HANDLE hDirect = ::CreateFileA(szFilePath.c_str(), GENERIC_READ,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                                   FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, NULL);
+    if (hDirect == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    ::CloseHandle(m_hFile);
+    m_hFile = hDirect;
+
+    m_overlapped.hEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (m_overlapped.hEvent == NULL) {
+        m_nError = GetLastErrno();
+        return false;
+    }
+#else
+    (void)szFilePath;
+
+    #if defined(O_DIRECT)
+        int nFlags = fcntl(m_nFile, F_GETFL);
+        if ( (nFlags < 0) || (fcntl(m_nFile, F_SETFL, nFlags | O_DIRECT) != 0) ) {
+            return false;
+        }
+    #elif defined(F_NOCACHE)
+        if (fcntl(m_nFile, F_NOCACHE, 1) != 0) {
+            return false;
+        }
+    #else
+        return false;
+    #endif
+#endif
+
+    if (AllocateBuffers(2, FILE_READER_BUFFER_SIZE) == false) {
+        return false;
+    }
+
+    StartRead(0);
+    return true;
+
+} // End OpenDirect
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Close the file, waiting for any read ahead to finish.
+// Requires: nothing
+// Returns: nothing
+void FileReader::Close()
+{
+    if (m_bReadPending) {
+    #ifdef WIN32
+        if (m_bReadAsync) {
+            DWORD dwRead = 0;
+            ::CancelIo(m_hFile);
+            ::GetOverlappedResult(m_hFile, &m_overlapped, &dwRead, TRUE);
+        }
+    #else
+        FinishRead();
+    #endif
+        m_bReadPending = false;
+    }
+
+    UnmapWindow();
+    FreeBuffers();
+
+#ifdef WIN32
+    if (m_overlapped.hEvent != NULL) {
+        ::CloseHandle(m_overlapped.hEvent);
+    }
+    memset(&m_overlapped, 0, sizeof(m_overlapped));
+
+    if (m_hMapping != NULL) {
+        ::CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+    if (m_hFile != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(m_hFile);
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_nFile >= 0) {
+        close(m_nFile);
+        m_nFile = -1;
+    }
+#endif
+
+    m_eMode = FileReadModeAuto;
+    m_l64FileSize = 0;
+    m_l64Offset = 0;
+    m_bDropCache = false;
+
+} // End Close
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: The next part of the file.
+// Requires:
+//      pData: set to the data, valid until the next call
+//      nLength: set to the size of the data, 0 at the end of the file
+// Returns: true if successful, false if a read failed - GetError
+//          gives the errno.
+bool FileReader::Next(const unsigned char*& pData, size_t& nLength)
+{
+    pData = NULL;
+    nLength = 0;
+
+    if (m_nError != 0) {
+        return false;
+    }
+
+    switch (m_eMode) {
+        case FileReadModeBuffered:
+            return NextBuffered(pData, nLength);
+        case FileReadModeMapped:
+            return NextMapped(pData, nLength);
+        case FileReadModeDirect:
+            return NextDirect(pData, nLength);
+        default:
+            // Not open
+            m_nError = EBADF;
+            return false;
+    }
+
+} // End Next
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Read the next part of the file into the buffer.
+// Requires:
+//      pData: set to the data
+//      nLength: set to the size of the data, 0 at the end of the file
+// Returns: true if successful, false otherwise.
+bool FileReader::NextBuffered(const unsigned char*& pData, size_t& nLength)
+{
+#ifdef WIN32
+    DWORD dwRead = 0;
+    if (::ReadFile(m_hFile, m_pBuffers[0], (DWORD)m_nBufferSize, &dwRead, NULL) == FALSE) {
+        m_nError = GetLastErrno();
+        return false;
+    }
+    long nRead = (long)dwRead;
+#else
+    long nRead = 0;
+    do {
+        nRead = (long)read(m_nFile, m_pBuffers[0], m_nBufferSize);
+    } while ( (nRead < 0) && (errno == EINTR) );
+
+    if (nRead < 0) {
+        m_nError = errno;
+        return false;
+    }
+
+    //-----------------------------------------------------------------
+    // Drop the buffer's worth returned last time - the caller is done
+    // with it, and it wasn't to stay in the cache.
+    //-----------------------------------------------------------------
+    #if defined(POSIX_FADV_DONTNEED)
+        if (m_bDropCache && (m_l64Offset > 0)) {
+            LONG64 l64Drop = (m_l64Offset > (LONG64)m_nBufferSize) ?
+                             m_l64Offset - (LONG64)m_nBufferSize : 0;
+            posix_fadvise(m_nFile, (off_t)l64Drop, (off_t)(m_l64Offset - l64Drop),
+                          POSIX_FADV_DONTNEED);
+        }
+    #endif
+#endif
+
+    pData = m_pBuffers[0];
+    nLength = (size_t)nRead;
+    m_l64Offset += nRead;
+
+    return true;
+
+} // End NextBuffered
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Map the next window of the file, unmapping the last one.
+// Requires:
+//      pData: set to the window
+//      nLength: set to the size of the window, 0 at the end of the file
+// Returns: true if successful, false otherwise.
+bool FileReader::NextMapped(const unsigned char*& pData, size_t& nLength)
+{
+    UnmapWindow();
+
+    if (m_l64Offset >= m_l64FileSize) {
+        return true;
+    }
+
+    size_t nWindowSize = FILE_READER_MAP_WINDOW_SIZE;
+    if (m_l64FileSize - m_l64Offset < FILE_READER_MAP_WINDOW_SIZE) {
+        nWindowSize = (size_t)(m_l64FileSize - m_l64Offset);
+    }
+
+#ifdef WIN32
+    if (m_hMapping == NULL) {
+        m_hMapping = ::CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (m_hMapping != NULL) {
+        m_pWindow = (unsigned char*)::MapViewOfFile(m_hMapping, FILE_MAP_READ,
+                                                    (DWORD)(m_l64Offset >> 32),
+                                                    (DWORD)(m_l64Offset & 0xFFFFFFFF),
+                                                    nWindowSize);
+    }
+    int nMapError = (m_pWindow == NULL) ? GetLastErrno() : 0;
+#else
+    void* pWindow = mmap(NULL, nWindowSize, PROT_READ, MAP_SHARED, m_nFile, (off_t)m_l64Offset);
+    int nMapError = (pWindow == MAP_FAILED) ? errno : 0;
+
+    if (nMapError == 0) {
+        m_pWindow = (unsigned char*)pWindow;
+    #if defined(MADV_SEQUENTIAL)
+        madvise(pWindow, nWindowSize, MADV_SEQUENTIAL);
+    #endif
+    }
+#endif
+
+    if (nMapError != 0) {
+        // A file that can't be mapped at all is read instead.
+        if (m_l64Offset == 0) {
+            m_eMode = FileReadModeBuffered;
+            if (AllocateBuffers(1, FILE_READER_BUFFER_SIZE) == false) {
+                return false;
+            }
+            return NextBuffered(pData, nLength);
+        }
+
+        m_nError = nMapError;
+        return false;
+    }
+
+    m_nWindowSize = nWindowSize;
+    m_l64Offset += nWindowSize;
+
+    pData = m_pWindow;
+    nLength = nWindowSize;
+
+    return true;
+
+} // End NextMapped
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait for the read ahead, start the read after it, and return
+//          the data read.
+// Requires:
+//      pData: set to the buffer read into
+//      nLength: set to the size read, 0 at the end of the file
+// Returns: true if successful, false otherwise.
+bool FileReader::NextDirect(const unsigned char*& pData, size_t& nLength)
+{
+    if (m_bReadPending == false) {
+        // The last read came up short - the end of the file.
+        return true;
+    }
+
+    long nRead = FinishRead();
+    if (nRead < 0) {
+    #ifndef WIN32
+        if (m_nError == EINVAL) {
+            // The file system turned down the direct read.
+            m_nError = 0;
+            FallBackToBuffered();
+            return NextBuffered(pData, nLength);
+        }
+    #endif
+        return false;
+    }
+
+    int nBuffer = m_nBuffer;
+    m_l64Offset += nRead;
+
+    if ((size_t)nRead == m_nBufferSize) {
+        m_nBuffer = 1 - m_nBuffer;
+        StartRead(m_l64Offset);
+    }
+
+    pData = m_pBuffers[nBuffer];
+    nLength = (size_t)nRead;
+
+    return true;
+
+} // End NextDirect
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Start reading the current buffer's worth at the offset -
+//          synchronously if it can't be queued.
+// Requires:
+//      l64Offset: offset to read from, a multiple of the alignment
+// Returns: nothing
+void FileReader::StartRead(LONG64 l64Offset)
+{
+    unsigned char* pBuffer = m_pBuffers[m_nBuffer];
+
+    m_bReadPending = true;
+    m_bReadAsync = false;
+    m_nReadResult = 0;
+
+#ifdef WIN32
+    m_overlapped.Offset = (DWORD)(l64Offset & 0xFFFFFFFF);
+    m_overlapped.OffsetHigh = (DWORD)(l64Offset >> 32);
+    ::ResetEvent(m_overlapped.hEvent);
+
+    DWORD dwRead = 0;
+    if (::ReadFile(m_hFile, pBuffer, (DWORD)m_nBufferSize, &dwRead, &m_overlapped)) {
+        m_nReadResult = (long)dwRead;
+    }
+    else if (GetLastError() == ERROR_IO_PENDING) {
+        m_bReadAsync = true;
+    }
+    else if (GetLastError() == ERROR_HANDLE_EOF) {
+        m_nReadResult = 0;
+    }
+    else {
+        m_nReadResult = -GetLastErrno();
+    }
+#else
+    memset(&m_aioRead, 0, sizeof(m_aioRead));
+    m_aioRead.aio_fildes = m_nFile;
+    m_aioRead.aio_buf = pBuffer;
+    m_aioRead.aio_nbytes = m_nBufferSize;
+    m_aioRead.aio_offset = (off_t)l64Offset;
+    m_aioRead.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+    if (aio_read(&m_aioRead) == 0) {
+        m_bReadAsync = true;
+        return;
+    }
+
+    do {
+        m_nReadResult = (long)pread(m_nFile, pBuffer, m_nBufferSize, (off_t)l64Offset);
+    } while ( (m_nReadResult < 0) && (errno == EINTR) );
+
+    if (m_nReadResult < 0) {
+        m_nReadResult = -errno;
+    }
+#endif
+
+} // End StartRead
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait for the pending read.
+// Requires: a read is pending
+// Returns: the number of bytes read, or -1 with GetError set.
+long FileReader::FinishRead()
+{
+    long nRead = m_nReadResult;
+
+    if (m_bReadAsync) {
+    #ifdef WIN32
+        DWORD dwRead = 0;
+        if (::GetOverlappedResult(m_hFile, &m_overlapped, &dwRead, TRUE)) {
+            nRead = (long)dwRead;
+        }
+        else if (GetLastError() == ERROR_HANDLE_EOF) {
+            nRead = 0;
+        }
+        else {
+            nRead = -GetLastErrno();
+        }
+    #else
+        const struct aiocb* listReads[1] = { &m_aioRead };
+        int nStatus = aio_error(&m_aioRead);
+        while (nStatus == EINPROGRESS) {
+            aio_suspend(listReads, 1, NULL);
+            nStatus = aio_error(&m_aioRead);
+        }
+
+        nRead = (long)aio_return(&m_aioRead);
+        if (nRead < 0) {
+            nRead = -nStatus;
+        }
+    #endif
+    }
+
+    m_bReadPending = false;
+    m_bReadAsync = false;
+
+    if (nRead < 0) {
+        m_nError = (int)-nRead;
+        return -1;
+    }
+
+    return nRead;
+
+} // End FinishRead
+
+#ifndef WIN32
+///////////////////////////////////////////////////////////////////////
+// Purpose: Carry on with buffered reads from the current offset, where
+//          direct reads were turned down.
+// Requires: no read is pending
+// Returns: nothing
+void FileReader::FallBackToBuffered()
+{
+    m_eMode = FileReadModeBuffered;
+    m_bDropCache = true;
+    m_nBuffer = 0;
+
+#if defined(O_DIRECT)
+    int nFlags = fcntl(m_nFile, F_GETFL);
+    if (nFlags >= 0) {
+        fcntl(m_nFile, F_SETFL, nFlags & ~O_DIRECT);
+    }
+#endif
+
+    lseek(m_nFile, (off_t)m_l64Offset, SEEK_SET);
+
+} // End FallBackToBuffered
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Unmap the current window, if any.
+// Requires: nothing
+// Returns: nothing
+void FileReader::UnmapWindow()
+{
+    if (m_pWindow == NULL) {
+        return;
+    }
+
+#ifdef WIN32
+    ::UnmapViewOfFile(m_pWindow);
+#else
+    munmap(m_pWindow, m_nWindowSize);
+#endif
+
+    m_pWindow = NULL;
+    m_nWindowSize = 0;
+
+} // End UnmapWindow
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Allocate the read buffers, aligned for direct reads.
+// Requires:
+//      nBuffers: 1 or 2
+//      nBufferSize: size of each buffer
+// Returns: true if successful, false otherwise with GetError ENOMEM.
+bool FileReader::AllocateBuffers(int nBuffers, size_t nBufferSize)
+{
+    FreeBuffers();
+
+    // Whole alignment units, so a direct read is never short of one.
+    nBufferSize = (nBufferSize + FILE_READER_ALIGNMENT - 1) & ~((size_t)FILE_READER_ALIGNMENT - 1);
+
+    for (int nBuffer = 0; nBuffer < nBuffers; nBuffer++) {
+    #ifdef WIN32
+        // Pages are aligned well past any sector size.
+        m_pBuffers[nBuffer] = (unsigned char*)::VirtualAlloc(NULL, nBufferSize,
+                                                             MEM_COMMIT | MEM_RESERVE,
+                                                             PAGE_READWRITE);
+    #else
+        void* pBuffer = NULL;
+        if (posix_memalign(&pBuffer, FILE_READER_ALIGNMENT, nBufferSize) != 0) {
+            pBuffer = NULL;
+        }
+        m_pBuffers[nBuffer] = (unsigned char*)pBuffer;
+    #endif
+
+        if (m_pBuffers[nBuffer] == NULL) {
+            FreeBuffers();
+            m_nError = ENOMEM;
+            return false;
+        }
+    }
+
+    m_nBufferSize = nBufferSize;
+    m_nBuffer = 0;
+
+    return true;
+
+} // End AllocateBuffers
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Free the read buffers.
+// Requires: no read is pending
+// Returns: nothing
+void FileReader::FreeBuffers()
+{
+    for (int nBuffer = 0; nBuffer < 2; nBuffer++) {
+        if (m_pBuffers[nBuffer] == NULL) {
+            continue;
+        }
+
+    #ifdef WIN32
+        ::VirtualFree(m_pBuffers[nBuffer], 0, MEM_RELEASE);
+    #else
+        free(m_pBuffers[nBuffer]);
+    #endif
+        m_pBuffers[nBuffer] = NULL;
+    }
+
+    m_nBufferSize = 0;
+    m_nBuffer = 0;
+
+} // End FreeBuffers
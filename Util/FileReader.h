@@ -0,0 +1,161 @@
+/*********************************************************************
+ *
+ *  file:  FileReader.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Sequential reads of a whole file - buffered, memory mapped,
+ *          or direct from the device with read-ahead - for hashing and
+ *          uploading.
+ *
+ *********************************************************************/
+
+#ifndef __FILE_READER_H__
+#define __FILE_READER_H__
+
+#include "Stdafx.h"
+#include "types.h"
+
+#include <stddef.h>
+#include <string>
+
+#ifndef WIN32
+#include <aio.h>
+#endif
+
+//---------------------------------------------------------------------
+// How the file is read.  FileReadModeAuto picks by the file's size.
+//---------------------------------------------------------------------
+typedef enum {
+    FileReadModeAuto = 0,
+    FileReadModeBuffered,                   // read() through the page cache
+    FileReadModeMapped,                     // Mapped a window at a time
+    FileReadModeDirect                      // Around the page cache, read ahead
+} FileReadMode_t;
+
+//---------------------------------------------------------------------
+// Size of each read, and of each mapped window.  FileReadModeAuto reads
+// files of at least FILE_READER_DIRECT_MIN_SIZE around the page cache -
+// a file that large would only push everything else out of it - and
+// smaller files buffered.  It never maps a file.
+//---------------------------------------------------------------------
+#define FILE_READER_BUFFER_SIZE         (1024 * 1024)
+#define FILE_READER_MAP_WINDOW_SIZE     (64 * 1024 * 1024)
+#define FILE_READER_DIRECT_MIN_SIZE     ((LONG64)1024 * 1024 * 1024)
+
+// Alignment of direct reads - of the buffers, offsets and sizes.
+#define FILE_READER_ALIGNMENT           4096
+
+///////////////////////////////////////////////////////////////////////
+// FileReader Class
+//
+// Usage:
+//      FileReader fileReader;
+//      if (fileReader.Open(szFilePath) == false) {
+//          ...fileReader.GetError()...
+//      }
+//
+//      const unsigned char* pData = NULL;
+//      size_t nLength = 0;
+//
+//      while (fileReader.Next(pData, nLength) && (nLength > 0)) {
+//          ...use the nLength bytes at pData...
+//      }
+//      if (fileReader.GetError() != 0) {
+//          ...the read failed...
+//      }
+//
+// The data returned by Next stays valid until the next call to Next or
+// Close.  A direct read starts the read of the next buffer before
+// returning the current one, so the device keeps busy while the caller
+// uses the data.  Direct reads fall back to buffered reads, dropping
+// the pages read from the cache, where the file system won't read
+// around the cache; a mapping that fails falls back the same way.
+//
+// A mapped file that's truncated while it's read faults the process
+// (SIGBUS), so files are only mapped when FileReadModeMapped is asked
+// for - only for files that can't be written meanwhile.
+
+class FileReader
+{
+private:
+#ifdef WIN32
+    HANDLE                      m_hFile;
+    HANDLE                      m_hMapping;
+    OVERLAPPED                  m_overlapped;       // Read ahead
+#else
+    int                         m_nFile;
+    struct aiocb                m_aioRead;          // Read ahead
+#endif
+
+    FileReadMode_t              m_eMode;
+    LONG64                      m_l64FileSize;      // As opened
+    LONG64                      m_l64Offset;        // Of the next data returned
+    int                         m_nError;           // 0, or errno
+
+    unsigned char*              m_pWindow;          // Mapped
+    size_t                      m_nWindowSize;
+
+    unsigned char*              m_pBuffers[2];      // Aligned for direct reads
+    size_t                      m_nBufferSize;
+    int                         m_nBuffer;          // Being read into
+
+    bool                        m_bReadPending;     // Into m_pBuffers[m_nBuffer]
+    bool                        m_bReadAsync;       // Otherwise done, with m_nReadResult
+    long                        m_nReadResult;
+    bool                        m_bDropCache;
+
+public:
+    FileReader();
+    virtual ~FileReader() { Close(); }
+
+    //-----------------------------------------------------------------
+    // Open the file to read from the start.
+    // Returns false if the file could not be opened - GetError gives
+    // the errno.
+    //-----------------------------------------------------------------
+    bool Open(const std::string& szFilePath, FileReadMode_t eMode=FileReadModeAuto);
+
+    //-----------------------------------------------------------------
+    // The next part of the file, nLength 0 at the end of the file.
+    // Returns false if a read failed - GetError gives the errno.
+    //-----------------------------------------------------------------
+    bool Next(const unsigned char*& pData, size_t& nLength);
+
+    void Close();
+
+    LONG64 GetFileSize() const { return m_l64FileSize; }
+    FileReadMode_t GetMode() const { return m_eMode; }
+    int GetError() const { return m_nError; }
+
+    //-----------------------------------------------------------------
+    // Name of the mode - "buffered", "mapped" or "direct".
+    //-----------------------------------------------------------------
+    static const char* GetModeName(FileReadMode_t eMode);
+
+private:
+    // Not implemented
+    FileReader(const FileReader&);
+    FileReader& operator=(const FileReader&);
+
+    bool OpenDirect(const std::string& szFilePath);
+    bool AllocateBuffers(int nBuffers, size_t nBufferSize);
+    void FreeBuffers();
+
+    bool NextBuffered(const unsigned char*& pData, size_t& nLength);
+    bool NextMapped(const unsigned char*& pData, size_t& nLength);
+    bool NextDirect(const unsigned char*& pData, size_t& nLength);
+
+    void StartRead(LONG64 l64Offset);
+    long FinishRead();
+    void UnmapWindow();
+#ifndef WIN32
+    void FallBackToBuffered();
+#endif
+};
+
+#endif // __FILE_READER_H__
@@ -0,0 +1,312 @@
+/*********************************************************************
+ *
+ *  file:  FormatBuffer.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Type safe, single pass text formatting into a caller
+ *          provided (or reused) buffer.
+ *
+ *********************************************************************/
+
+#include "FormatBuffer.h"
+
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Constructor
+// Requires:
+//      pBuffer: caller's buffer
+//      nSize: size of the buffer, including room for the null terminator.
+// Returns: nothing
+FormatBuffer::FormatBuffer(char* pBuffer, size_t nSize)
+    : m_pBuffer(pBuffer), m_nSize(nSize), m_nLength(0), m_bTruncated(false)
+{
+    if ( (m_pBuffer == NULL) || (m_nSize == 0) ) {
+        m_pBuffer = NULL;
+        m_nSize = 0;
+        m_bTruncated = true;
+        return;
+    }
+
+    m_pBuffer[0] = '\0';
+
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Shorten the text to the given length.
+// Requires:
+//      nLength: new length - ignored if longer than the current text.
+// Returns: nothing
+void FormatBuffer::Truncate(size_t nLength)
+{
+    if (nLength < m_nLength) {
+        m_nLength = nLength;
+        m_pBuffer[m_nLength] = '\0';
+    }
+
+} // End Truncate
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append text.
+// Requires:
+//      szValue: text to append
+//      nLength: number of characters to append
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::Append(const char* szValue, size_t nLength)
+{
+    if (m_nSize == 0) {
+        return *this;
+    }
+
+    size_t nAvailable = m_nSize - 1 - m_nLength;
+    if (nLength > nAvailable) {
+        nLength = nAvailable;
+        m_bTruncated = true;
+    }
+
+    if (nLength > 0) {
+        memcpy(m_pBuffer + m_nLength, szValue, nLength);
+        m_nLength += nLength;
+    }
+    m_pBuffer[m_nLength] = '\0';
+
+    return *this;
+
+} // End Append
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append null terminated text.
+// Requires:
+//      szValue: text to append - NULL is ignored.
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::Append(const char* szValue)
+{
+    if (szValue == NULL) {
+        return *this;
+    }
+
+    return Append(szValue, strlen(szValue));
+
+} // End Append
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append a single character.
+// Requires:
+//      cValue: character to append
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::Append(char cValue)
+{
+    if ( (m_nSize == 0) || (m_nLength + 1 >= m_nSize) ) {
+        m_bTruncated = true;
+        return *this;
+    }
+
+    m_pBuffer[m_nLength++] = cValue;
+    m_pBuffer[m_nLength] = '\0';
+
+    return *this;
+
+} // End Append
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append a character repeatedly (e.g. padding).
+// Requires:
+//      cValue: character to append
+//      nCount: number of times to append the character
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::AppendRepeat(char cValue, int nCount)
+{
+    if ( (m_nSize == 0) || (nCount <= 0) ) {
+        return *this;
+    }
+
+    size_t nAvailable = m_nSize - 1 - m_nLength;
+    size_t nLength = (size_t)nCount;
+    if (nLength > nAvailable) {
+        nLength = nAvailable;
+        m_bTruncated = true;
+    }
+
+    memset(m_pBuffer + m_nLength, cValue, nLength);
+    m_nLength += nLength;
+    m_pBuffer[m_nLength] = '\0';
+
+    return *this;
+
+} // End AppendRepeat
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append a signed integer in decimal.
+// Requires:
+//      l64Value: value to append
+//      nMinDigits: zero pad to this number of digits
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::AppendInt(LONG64 l64Value, int nMinDigits /*1*/)
+{
+    if (l64Value < 0) {
+        Append('-');
+        return AppendUInt((ULONG64)0 - (ULONG64)l64Value, nMinDigits);
+    }
+
+    return AppendUInt((ULONG64)l64Value, nMinDigits);
+
+} // End AppendInt
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append an unsigned integer in decimal.
+// Requires:
+//      ul64Value: value to append
+//      nMinDigits: zero pad to this number of digits
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::AppendUInt(ULONG64 ul64Value, int nMinDigits /*1*/)
+{
+    // Digits are generated from the right.
+    char szDigits[24];
+    int nDigits = (int)sizeof(szDigits);
+
+    do {
+        szDigits[--nDigits] = (char)('0' + (int)(ul64Value % 10));
+        ul64Value /= 10;
+    } while (ul64Value > 0);
+
+    int nCount = (int)sizeof(szDigits) - nDigits;
+    if (nMinDigits > nCount) {
+        AppendRepeat('0', nMinDigits - nCount);
+    }
+
+    return Append(szDigits + nDigits, (size_t)nCount);
+
+} // End AppendUInt
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append an integer with thousands separators.
+// Requires:
+//      l64Value: value to append
+//      cSeparator: separator character
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::AppendGrouped(LONG64 l64Value, char cSeparator /*','*/)
+{
+    ULONG64 ul64Value = (ULONG64)l64Value;
+    if (l64Value < 0) {
+        Append('-');
+        ul64Value = (ULONG64)0 - ul64Value;
+    }
+
+    // 20 digits plus 6 separators.
+    char szDigits[32];
+    int nDigits = (int)sizeof(szDigits);
+    int nGroup = 0;
+
+    do {
+        if (nGroup == 3) {
+            szDigits[--nDigits] = cSeparator;
+            nGroup = 0;
+        }
+        szDigits[--nDigits] = (char)('0' + (int)(ul64Value % 10));
+        ul64Value /= 10;
+        nGroup ++;
+    } while (ul64Value > 0);
+
+    return Append(szDigits + nDigits, sizeof(szDigits) - nDigits);
+
+} // End AppendGrouped
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Append a floating point value with a fixed number of
+//          decimal places, rounded half away from zero.
+// Requires:
+//      dblValue: value to append
+//      nPrecision: number of decimal places (0 to 9)
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::AppendFixed(double dblValue, int nPrecision)
+{
+    if (nPrecision < 0) {
+        nPrecision = 0;
+    }
+    else if (nPrecision > 9) {
+        nPrecision = 9;
+    }
+
+    ULONG64 ul64Scale = 1;
+    for (int nIndex = 0; nIndex < nPrecision; nIndex++) {
+        ul64Scale *= 10;
+    }
+
+    if (dblValue < 0) {
+        Append('-');
+        dblValue = -dblValue;
+    }
+
+    ULONG64 ul64Value = (ULONG64)((dblValue * (double)ul64Scale) + 0.5);
+
+    AppendUInt(ul64Value / ul64Scale);
+    if (nPrecision > 0) {
+        Append('.');
+        AppendUInt(ul64Value % ul64Scale, nPrecision);
+    }
+
+    return *this;
+
+} // End AppendFixed
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Right align the text appended since nStart in a field
+//          of nWidth characters (e.g. %11s).
+// Requires:
+//      nStart: start of the field - typically length() before the
+//              field was appended.
+//      nWidth: field width
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::AlignRight(size_t nStart, int nWidth)
+{
+    if ( (nStart > m_nLength) || (nWidth <= 0) ) {
+        return *this;
+    }
+
+    size_t nFieldLength = m_nLength - nStart;
+    if (nFieldLength >= (size_t)nWidth) {
+        return *this;
+    }
+
+    size_t nPad = (size_t)nWidth - nFieldLength;
+    size_t nAvailable = m_nSize - 1 - m_nLength;
+    if (nPad > nAvailable) {
+        nPad = nAvailable;
+        m_bTruncated = true;
+    }
+
+    memmove(m_pBuffer + nStart + nPad, m_pBuffer + nStart, nFieldLength);
+    memset(m_pBuffer + nStart, ' ', nPad);
+    m_nLength += nPad;
+    m_pBuffer[m_nLength] = '\0';
+
+    return *this;
+
+} // End AlignRight
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Left align the text appended since nStart in a field
+//          of nWidth characters (e.g. %-11s).
+// Requires:
+//      nStart: start of the field
+//      nWidth: field width
+// Returns: reference to this buffer.
+FormatBuffer& FormatBuffer::AlignLeft(size_t nStart, int nWidth)
+{
+    if ( (nStart > m_nLength) || (nWidth <= 0) ) {
+        return *this;
+    }
+
+    size_t nFieldLength = m_nLength - nStart;
+    if (nFieldLength < (size_t)nWidth) {
+        AppendRepeat(' ', nWidth - (int)nFieldLength);
+    }
+
+    return *this;
+
+} // End AlignLeft
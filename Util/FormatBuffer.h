@@ -0,0 +1,138 @@
+/*********************************************************************
+ *
+ *  file:  FormatBuffer.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Type safe, single pass text formatting into a caller
+ *          provided (or reused) buffer - a replacement for _format
+ *          in code that runs per progress update or per output row.
+ *
+ *********************************************************************/
+
+#ifndef __FORMAT_BUFFER_H__
+#define __FORMAT_BUFFER_H__
+
+#include "Stdafx.h"
+#include "types.h"
+
+#include <stddef.h>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////
+// FormatBuffer Class
+//
+// Appends text and numbers to a fixed buffer which is always null
+// terminated.  Output that does not fit is truncated (see
+// IsTruncated) - nothing is ever allocated.
+//
+// Usage:
+//      FixedFormatBuffer<128> szText;
+//      szText << _T("Uploading ") << szFileName << _T("... ") << nPercent << _T('%');
+//      _tprintf(_T("%s"), szText.c_str());
+//
+// equivalent to
+//      _format(_T("Uploading %s... %d%%"), szFileName.c_str(), nPercent);
+
+class FormatBuffer
+{
+private:
+    char*           m_pBuffer;
+    size_t          m_nSize;                    // Includes the null terminator
+    size_t          m_nLength;
+    bool            m_bTruncated;
+
+public:
+    //-----------------------------------------------------------------
+    // pBuffer: caller's buffer, nSize: size of the buffer including
+    //          room for the null terminator.
+    //-----------------------------------------------------------------
+    FormatBuffer(char* pBuffer, size_t nSize);
+
+    inline void Reset() {
+        m_nLength = 0;
+        m_bTruncated = false;
+        if (m_nSize > 0) {
+            m_pBuffer[0] = '\0';
+        }
+    }
+
+    inline const char* c_str() const { return m_pBuffer; }
+    inline size_t length() const { return m_nLength; }
+    inline size_t capacity() const { return (m_nSize > 0) ? m_nSize - 1 : 0; }
+    inline bool IsTruncated() const { return m_bTruncated; }
+
+    // Shorten the text to the given length.
+    void Truncate(size_t nLength);
+
+    //-----------------------------------------------------------------
+    // Text
+    //-----------------------------------------------------------------
+    FormatBuffer& Append(const char* szValue, size_t nLength);
+    FormatBuffer& Append(const char* szValue);
+    FormatBuffer& Append(char cValue);
+    FormatBuffer& AppendRepeat(char cValue, int nCount);
+
+    //-----------------------------------------------------------------
+    // Numbers
+    //      AppendInt: nMinDigits pads with zeroes, e.g. %02d
+    //      AppendGrouped: thousands separators, e.g. 1,234,567
+    //      AppendFixed: nPrecision decimal places, e.g. %.3lf
+    //-----------------------------------------------------------------
+    FormatBuffer& AppendInt(LONG64 l64Value, int nMinDigits=1);
+    FormatBuffer& AppendUInt(ULONG64 ul64Value, int nMinDigits=1);
+    FormatBuffer& AppendGrouped(LONG64 l64Value, char cSeparator=',');
+    FormatBuffer& AppendFixed(double dblValue, int nPrecision);
+
+    //-----------------------------------------------------------------
+    // Field padding - pads the text appended since nStart with spaces
+    // to nWidth characters, e.g. %11s (right) or %-11s (left).
+    //-----------------------------------------------------------------
+    FormatBuffer& AlignRight(size_t nStart, int nWidth);
+    FormatBuffer& AlignLeft(size_t nStart, int nWidth);
+
+    //-----------------------------------------------------------------
+    // Stream style appends.
+    //-----------------------------------------------------------------
+    inline FormatBuffer& operator<<(const char* szValue) { return Append(szValue); }
+    inline FormatBuffer& operator<<(const std::string& szValue) {
+        return Append(szValue.data(), szValue.length());
+    }
+    inline FormatBuffer& operator<<(const FormatBuffer& szValue) {
+        return Append(szValue.c_str(), szValue.length());
+    }
+    inline FormatBuffer& operator<<(char cValue) { return Append(cValue); }
+    inline FormatBuffer& operator<<(int nValue) { return AppendInt(nValue); }
+    inline FormatBuffer& operator<<(unsigned int nValue) { return AppendUInt(nValue); }
+    inline FormatBuffer& operator<<(long lValue) { return AppendInt(lValue); }
+    inline FormatBuffer& operator<<(unsigned long ulValue) { return AppendUInt(ulValue); }
+    inline FormatBuffer& operator<<(long long llValue) { return AppendInt(llValue); }
+    inline FormatBuffer& operator<<(unsigned long long ullValue) { return AppendUInt(ullValue); }
+
+private:
+    // Not implemented - the buffer is owned by the caller.
+    FormatBuffer(const FormatBuffer&);
+    FormatBuffer& operator=(const FormatBuffer&);
+};
+
+///////////////////////////////////////////////////////////////////////
+// FixedFormatBuffer Class
+//
+// FormatBuffer with its own storage - typically declared on the
+// stack, or as a member to be reused across calls.
+
+template <int nSize>
+class FixedFormatBuffer : public FormatBuffer
+{
+private:
+    char            m_szStorage[nSize];
+
+public:
+    FixedFormatBuffer() : FormatBuffer(m_szStorage, nSize) {}
+};
+
+#endif // __FORMAT_BUFFER_H__
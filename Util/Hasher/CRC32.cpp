@@ -1,5 +1,6 @@
 #include "../Stdafx.h"
-#include "Crc32.h"
+#include "CRC32.h"
+#include "../Crc32Util.h"
 #include <iostream>
 #include <fstream>
 #include <assert.h>
@@ -173,15 +174,20 @@ DWORD CCrc32Static::FileCrc32Streams(LPCTSTR szFilename, DWORD &dwCrc32)
 
 		if(file.is_open())
 		{
-			char buffer[MAX_BUFFER_SIZE];
-			int nLoop, nCount;
-			nCount = file.read(buffer, sizeof(buffer)).gcount();
+			// Diomede: whole buffers through Crc32Util, which folds or
+			// slices them, rather than a byte at a time.
+			char* buffer = new char[CRC32_BUFFER_SIZE];
+			unsigned int nCrc = 0;
+			int nCount;
+			nCount = file.read(buffer, CRC32_BUFFER_SIZE).gcount();
 			while(nCount)
 			{
-				for(nLoop = 0; nLoop < nCount; nLoop++)
-					CalcCrc32(buffer[nLoop], dwCrc32);
-				nCount = file.read(buffer, sizeof(buffer)).gcount();
+				nCrc = Crc32Util::Update(nCrc, (const unsigned char*)buffer, (size_t)nCount);
+				nCount = file.read(buffer, CRC32_BUFFER_SIZE).gcount();
 			}
+			delete [] buffer;
+
+			dwCrc32 = ~(DWORD)nCrc;
 
 			file.close();
 		}
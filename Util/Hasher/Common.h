@@ -20,6 +20,10 @@ typedef LONG64 QWORD, *LPQWORD;
 // Read 4K of data at a time (used in the C++ streams, Win32 I/O, and assembly functions)
 #define MAX_BUFFER_SIZE	4096
 
+// Diomede: read 64K at a time for the CRC32 of a file - the CRC itself
+// is no longer the bottleneck.
+#define CRC32_BUFFER_SIZE	65536
+
 // Map a "view" size of 10MB (used in the filemap function)
 #define MAX_VIEW_SIZE	10485760
 
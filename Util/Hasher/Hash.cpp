@@ -4,14 +4,13 @@
 #include "../Stdafx.h"
 #include "../StringUtil.h"
 #include "../XString.h"
+#include "../FileReader.h"
 #include "types.h"
 
 #include "Hash.h"
 
-#undef SUPPORT_CRC32
-
 #if SUPPORT_CRC32
-	#include "crc32.h" 
+	#include "CRC32.h" 
 #endif
 #if SUPPORT_GOSTHASH
 	#include "gosthash.h" 
@@ -59,19 +58,19 @@ std::string CHash::DoHash()
 	if (hashAlgo == CRC32)
 	{
 #if SUPPORT_CRC32
-		DWORD crc32r;
+		DWORD crc32r = 0;
 		CCrc32Static crc32;
 
 		if (hashOperation == STRING_HASH)
 		{
-			crc32.StringCrc32((LPCSTR)hashString, crc32r);
+			crc32.StringCrc32(hashString.c_str(), crc32r);
 		}
 		if (hashOperation == FILE_HASH)
 		{
-			crc32.FileCrc32Streams((LPCSTR)hashFile, crc32r);
+			crc32.FileCrc32Streams(hashFile.c_str(), crc32r);
 		}
 
-		retHash.Format(_T("%08x"), crc32r);
+		retHash = _format(_T("%08x"), (unsigned int)crc32r);
 #endif
 	}
 
@@ -460,7 +459,26 @@ std::string CHash::MD5Hash()
 	{
 		if (hashFile.length() == 0) return _T("");
 
-	    if (md5file((char*)hashFile.c_str(), 0, &m_md5))
+		// Diomede: read through FileReader rather than md5file's 2 KB freads.
+		FileReader fileReader;
+		bool bRead = fileReader.Open(hashFile);
+
+		if (bRead)
+		{
+			const unsigned char* pData = NULL;
+			size_t nLength = 0;
+
+			MD5Init(&m_md5);
+			while (fileReader.Next(pData, nLength) && (nLength > 0))
+			{
+				MD5Update(&m_md5, (unsigned char*)pData, (unsigned int)nLength);
+			}
+			MD5Final(&m_md5);
+
+			bRead = (fileReader.GetError() == 0);
+		}
+
+		if (bRead)
 		{
 			for (int i = 0; i < 16; i++)
 			{
@@ -493,12 +511,6 @@ std::string CHash::SHA1Hash()
 	// The outputted hash
 	std::string outHash;
 #if SUPPORT_SHA1
-	// Common variables
-	FILE *fileToHash = NULL;
-	unsigned char fileBuf[SIZE_OF_BUFFER];
-	unsigned long lenRead = 0;
-
-
 	// Temporary working buffers
 	unsigned char* tempOut = new unsigned char[256];
 
@@ -521,18 +533,18 @@ std::string CHash::SHA1Hash()
 		if (hashFile.length() == 0) return _T("");
 		sha1_begin(&m_sha1);
 
-		fileToHash = fopen(hashFile, "rb");
-	
-		do
+		// Diomede: read through FileReader rather than SIZE_OF_BUFFER freads.
+		FileReader fileReader;
+		if (fileReader.Open(hashFile))
 		{
-			lenRead = fread(fileBuf, 1, SIZE_OF_BUFFER, fileToHash);
-			if(lenRead != 0)
+			const unsigned char* pData = NULL;
+			size_t nLength = 0;
+
+			while (fileReader.Next(pData, nLength) && (nLength > 0))
 			{
-				sha1_hash(fileBuf, lenRead, &m_sha1);
+				sha1_hash(pData, (unsigned int)nLength, &m_sha1);
 			}
-		} while (lenRead == SIZE_OF_BUFFER);
-
-		fclose(fileToHash); fileToHash = NULL;
+		}
 
 		sha1_end(tempOut, &m_sha1);
 	}
@@ -567,12 +579,6 @@ std::string CHash::SHA2Hash()
 	// The outputted hash
 	std::string  outHash;
 #if SUPPORT_SHA2
-	// Common variables
-	FILE *fileToHash = NULL;
-	unsigned char fileBuf[SIZE_OF_BUFFER];
-	unsigned long lenRead = 0;
-
-
 	// Temporary working buffers
 	unsigned char* tempOut = new unsigned char[256];
 
@@ -598,18 +604,18 @@ std::string CHash::SHA2Hash()
 		if (hashFile.length() == 0) return _T("");
 		sha2_begin(sha2Strength, &sha);
 
-		fileToHash = fopen(hashFile, "rb");
-	
-		do
+		// Diomede: read through FileReader rather than SIZE_OF_BUFFER freads.
+		FileReader fileReader;
+		if (fileReader.Open(hashFile))
 		{
-			lenRead = fread(fileBuf, 1, SIZE_OF_BUFFER, fileToHash);
-			if(lenRead != 0)
+			const unsigned char* pData = NULL;
+			size_t nLength = 0;
+
+			while (fileReader.Next(pData, nLength) && (nLength > 0))
 			{
-				sha2_hash(fileBuf, lenRead, &sha);
+				sha2_hash(pData, nLength, &sha);
 			}
-		} while (lenRead == SIZE_OF_BUFFER);
-
-		fclose(fileToHash); fileToHash = NULL;
+		}
 
 		sha2_end(tempOut, &sha);
 	}
@@ -6,7 +6,7 @@
 
 // Choose which algorithms you want
 // Put 1s to support algorithms, else 0 to not support
-#define        SUPPORT_CRC32          0
+#define        SUPPORT_CRC32          1
 #define        SUPPORT_GOSTHASH       0
 #define        SUPPORT_MD2            0
 #define        SUPPORT_MD4            0
@@ -44,6 +44,7 @@
 
 #include "../Stdafx.h"
 #include "sha1.h"
+#include "sha_ni.h"     /* Diomede: SHA-NI block function */
 
 /*
     To obtain the highest speed on processors with 32-bit words, this code 
@@ -193,6 +194,16 @@ void sha1_hash(const unsigned char data[], unsigned int len, sha1_ctx ctx[1])
 
     while(len >= space)     /* tranfer whole blocks while possible  */
     {
+        /* Diomede: with the buffer empty, the SHA extensions compile   */
+        /* the whole blocks straight from the data                      */
+        if(pos == 0 && sha_ni_available())
+        {
+            unsigned int blocks = len / SHA1_BLOCK_SIZE;
+            sha1_compile_ni(ctx->hash, sp, blocks);
+            sp += blocks * SHA1_BLOCK_SIZE; len -= blocks * SHA1_BLOCK_SIZE;
+            break;
+        }
+
         memcpy(((unsigned char*)ctx->wbuf) + pos, sp, space);
         sp += space; len -= space; space = SHA1_BLOCK_SIZE; pos = 0; 
         sha1_compile(ctx);
@@ -87,6 +87,7 @@
 
 #include "../Stdafx.h"
 #include "sha2.h"
+#include "sha_ni.h"     /* Diomede: SHA-NI block function */
 
 /*  1. PLATFORM SPECIFIC INCLUDES */
 
@@ -294,6 +295,16 @@ void sha256_hash(const unsigned char data[], unsigned long len, sha256_ctx ctx[1
 
     while(len >= space)     /* tranfer whole blocks while possible  */
     {
+        /* Diomede: with the buffer empty, the SHA extensions compile   */
+        /* the whole blocks straight from the data                      */
+        if(pos == 0 && sha_ni_available())
+        {
+            unsigned long blocks = len / SHA256_BLOCK_SIZE;
+            sha256_compile_ni(ctx->hash, sp, blocks);
+            sp += blocks * SHA256_BLOCK_SIZE; len -= blocks * SHA256_BLOCK_SIZE;
+            break;
+        }
+
         memcpy(((unsigned char*)ctx->wbuf) + pos, sp, space);
         sp += space; len -= space; space = SHA256_BLOCK_SIZE; pos = 0; 
 		bsw_32(ctx->wbuf, SHA256_BLOCK_SIZE >> 2)
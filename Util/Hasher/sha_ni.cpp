@@ -0,0 +1,393 @@
+/*********************************************************************
+ *
+ *  file:  sha_ni.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: SHA-1 and SHA-256 block functions using the x86 SHA
+ *          extensions (SHA-NI).  The round structure follows Intel's
+ *          "Intel SHA Extensions" white paper (2013).
+ *
+ *          There is no AVX2 path.  SHA-1 and SHA-256 chain each block
+ *          on the one before it, so AVX2 can only speed up the message
+ *          schedule of a single stream - about 20 percent over the
+ *          scalar rounds, against the 7 to 8 times of SHA-NI - and
+ *          only hand-scheduled assembly gets that.  The wide registers
+ *          pay off hashing several streams at once, which sha1_hash
+ *          and sha256_hash, taking one stream each, can't use.
+ *
+ *********************************************************************/
+
+#include "../Stdafx.h"
+#include "sha_ni.h"
+
+#include <string.h>
+
+//---------------------------------------------------------------------
+// Built on x86 compilers that can generate the SHA instructions
+// without -msha - used only when the CPU has them.  Define SHA_NO_SHANI
+// to leave them out.
+//---------------------------------------------------------------------
+#if !defined(SHA_NO_SHANI)
+    #if defined(_MSC_VER) && (_MSC_VER >= 1900) && (defined(_M_IX86) || defined(_M_X64))
+        #define SHA_HAVE_SHANI
+        #define SHA_SHANI_TARGET
+        #include <intrin.h>
+        #include <immintrin.h>
+    #elif (defined(__i386__) || defined(__x86_64__)) && \
+          ( defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)) )
+        #define SHA_HAVE_SHANI
+        #define SHA_SHANI_TARGET        __attribute__((target("sha,sse4.1,ssse3")))
+        #include <cpuid.h>
+        #include <immintrin.h>
+    #endif
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Check for the SHA extensions, and the SSSE3 and SSE4.1
+//          instructions used alongside them.
+// Requires: nothing
+// Returns: true if the SHA-NI paths can run
+static bool HasShaNi()
+{
+    #if defined(SHA_HAVE_SHANI) && defined(_MSC_VER)
+        int nCpuInfo[4];
+        __cpuid(nCpuInfo, 0);
+        if (nCpuInfo[0] < 7) {
+            return false;
+        }
+        __cpuid(nCpuInfo, 1);
+        if ( ((nCpuInfo[2] & (1 << 9)) == 0) || ((nCpuInfo[2] & (1 << 19)) == 0) ) {
+            return false;
+        }
+        __cpuidex(nCpuInfo, 7, 0);
+        return ( (nCpuInfo[1] & (1 << 29)) != 0 );
+    #elif defined(SHA_HAVE_SHANI)
+        unsigned int nEax = 0, nEbx = 0, nEcx = 0, nEdx = 0;
+        if (__get_cpuid_max(0, NULL) < 7) {
+            return false;
+        }
+        __cpuid(1, nEax, nEbx, nEcx, nEdx);
+        if ( ((nEcx & (1 << 9)) == 0) || ((nEcx & (1 << 19)) == 0) ) {
+            return false;
+        }
+        __cpuid_count(7, 0, nEax, nEbx, nEcx, nEdx);
+        return ( (nEbx & (1 << 29)) != 0 );
+    #else
+        return false;
+    #endif
+} // End HasShaNi
+
+#ifdef SHA_HAVE_SHANI
+
+//---------------------------------------------------------------------
+// Four SHA-1 rounds from round 12 on - the message words are kept four
+// to a register, msg1 and msg2 building the next ones as they go.
+// Those built past round 79 are never used, and are dropped by the
+// compiler.
+//---------------------------------------------------------------------
+#define SHA1_NI_ROUNDS(eCur, eNext, msgCur, msgNext, msgAfter, msgPrev, nFunc)  \
+    eCur = _mm_sha1nexte_epu32(eCur, msgCur);                                   \
+    eNext = abcd;                                                               \
+    msgNext = _mm_sha1msg2_epu32(msgNext, msgCur);                              \
+    abcd = _mm_sha1rnds4_epu32(abcd, eCur, nFunc);                              \
+    msgPrev = _mm_sha1msg1_epu32(msgPrev, msgCur);                              \
+    msgAfter = _mm_xor_si128(msgAfter, msgCur)
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Compile whole SHA-1 blocks into the hash.
+// Requires: hash - the five hash words
+//           data - nBlocks 64 byte blocks, in their original byte order
+//           nBlocks - number of blocks
+// Returns: nothing
+SHA_SHANI_TARGET
+void sha1_compile_ni(sha1_32t hash[5], const unsigned char data[], unsigned long nBlocks)
+{
+    const __m128i mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)hash), 0x1B);
+    __m128i e0 = _mm_set_epi32((int)hash[4], 0, 0, 0);
+    __m128i e1, abcdSave, eSave;
+    __m128i msg0, msg1, msg2, msg3;
+
+    while (nBlocks--) {
+        abcdSave = abcd;
+        eSave = e0;
+
+        // Rounds 0-15 load the block as they go.
+        msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 0);
+
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 0);     // 16-19
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg3, msg0, 1);     // 20-23
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg0, msg1, 1);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 1);
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 1);
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg3, msg0, 1);
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg0, msg1, 2);     // 40-43
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 2);
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 2);
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg3, msg0, 2);
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg0, msg1, 2);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 3);     // 60-63
+        SHA1_NI_ROUNDS(e0, e1, msg0, msg1, msg2, msg3, 3);
+        SHA1_NI_ROUNDS(e1, e0, msg1, msg2, msg3, msg0, 3);
+        SHA1_NI_ROUNDS(e0, e1, msg2, msg3, msg0, msg1, 3);
+        SHA1_NI_ROUNDS(e1, e0, msg3, msg0, msg1, msg2, 3);     // 76-79
+
+        e0 = _mm_sha1nexte_epu32(e0, eSave);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+
+        data += SHA1_BLOCK_SIZE;
+    }
+
+    _mm_storeu_si128((__m128i*)hash, _mm_shuffle_epi32(abcd, 0x1B));
+    hash[4] = (sha1_32t)_mm_extract_epi32(e0, 3);
+} // End sha1_compile_ni
+
+//---------------------------------------------------------------------
+// SHA-256 round constants, four to a 128 bit load.
+//---------------------------------------------------------------------
+static const sha2_32t g_nSha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+//---------------------------------------------------------------------
+// Four SHA-256 rounds, two per sha256rnds2.  From round 12 to 59,
+// msg1 and msg2 build the message words four ahead, finishing those
+// of the next rounds.
+//---------------------------------------------------------------------
+#define SHA256_NI_ROUNDS(msgCur, nRound)                                        \
+    msg = _mm_add_epi32(msgCur, _mm_loadu_si128((const __m128i*)&g_nSha256K[nRound])); \
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);                              \
+    msg = _mm_shuffle_epi32(msg, 0x0E);                                         \
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, msg)
+
+#define SHA256_NI_SCHEDULE(msgCur, msgNext, msgPrev)                            \
+    msgNext = _mm_add_epi32(msgNext, _mm_alignr_epi8(msgCur, msgPrev, 4));      \
+    msgNext = _mm_sha256msg2_epu32(msgNext, msgCur);                            \
+    msgPrev = _mm_sha256msg1_epu32(msgPrev, msgCur)
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Compile whole SHA-256 blocks into the hash.
+// Requires: hash - the eight hash words
+//           data - nBlocks 64 byte blocks, in their original byte order
+//           nBlocks - number of blocks
+// Returns: nothing
+SHA_SHANI_TARGET
+void sha256_compile_ni(sha2_32t hash[8], const unsigned char data[], unsigned long nBlocks)
+{
+    const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+    // The rounds work on the state as ABEF and CDGH.
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&hash[0]), 0xB1);
+    __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&hash[4]), 0x1B);
+    __m128i abef = _mm_alignr_epi8(tmp, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);
+
+    __m128i abefSave, cdghSave, msg;
+    __m128i msg0, msg1, msg2, msg3;
+
+    while (nBlocks--) {
+        abefSave = abef;
+        cdghSave = cdgh;
+
+        msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+        SHA256_NI_ROUNDS(msg0, 0);
+
+        msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+        SHA256_NI_ROUNDS(msg1, 4);
+        msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+        msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+        SHA256_NI_ROUNDS(msg2, 8);
+        msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+        msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+        SHA256_NI_ROUNDS(msg3, 12);
+        SHA256_NI_SCHEDULE(msg3, msg0, msg2);
+
+        SHA256_NI_ROUNDS(msg0, 16);  SHA256_NI_SCHEDULE(msg0, msg1, msg3);
+        SHA256_NI_ROUNDS(msg1, 20);  SHA256_NI_SCHEDULE(msg1, msg2, msg0);
+        SHA256_NI_ROUNDS(msg2, 24);  SHA256_NI_SCHEDULE(msg2, msg3, msg1);
+        SHA256_NI_ROUNDS(msg3, 28);  SHA256_NI_SCHEDULE(msg3, msg0, msg2);
+        SHA256_NI_ROUNDS(msg0, 32);  SHA256_NI_SCHEDULE(msg0, msg1, msg3);
+        SHA256_NI_ROUNDS(msg1, 36);  SHA256_NI_SCHEDULE(msg1, msg2, msg0);
+        SHA256_NI_ROUNDS(msg2, 40);  SHA256_NI_SCHEDULE(msg2, msg3, msg1);
+        SHA256_NI_ROUNDS(msg3, 44);  SHA256_NI_SCHEDULE(msg3, msg0, msg2);
+        SHA256_NI_ROUNDS(msg0, 48);  SHA256_NI_SCHEDULE(msg0, msg1, msg3);
+        SHA256_NI_ROUNDS(msg1, 52);  SHA256_NI_SCHEDULE(msg1, msg2, msg0);
+        SHA256_NI_ROUNDS(msg2, 56);  SHA256_NI_SCHEDULE(msg2, msg3, msg1);
+        SHA256_NI_ROUNDS(msg3, 60);
+
+        abef = _mm_add_epi32(abef, abefSave);
+        cdgh = _mm_add_epi32(cdgh, cdghSave);
+
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    // Back to ABCD and EFGH.
+    tmp = _mm_shuffle_epi32(abef, 0x1B);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i*)&hash[0], _mm_blend_epi16(tmp, cdgh, 0xF0));
+    _mm_storeu_si128((__m128i*)&hash[4], _mm_alignr_epi8(cdgh, tmp, 8));
+} // End sha256_compile_ni
+
+#else // SHA_HAVE_SHANI
+
+//---------------------------------------------------------------------
+// Never called - sha_ni_available always returns zero.
+//---------------------------------------------------------------------
+void sha1_compile_ni(sha1_32t hash[5], const unsigned char data[], unsigned long nBlocks)
+{
+}
+
+void sha256_compile_ni(sha2_32t hash[8], const unsigned char data[], unsigned long nBlocks)
+{
+}
+
+#endif // SHA_HAVE_SHANI
+
+//---------------------------------------------------------------------
+// FIPS 180-2 test vectors - the one and two block messages of
+// appendices A and B, and the empty message - with the hash words
+// each gives.
+//---------------------------------------------------------------------
+#define SHA_NI_TEST_VECTORS     3
+
+static const char* g_szShaNiTestMessages[SHA_NI_TEST_VECTORS] =
+{
+    "abc",
+    "",
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+};
+
+static const sha1_32t g_nSha1TestHashes[SHA_NI_TEST_VECTORS][5] =
+{
+    { 0xa9993e36, 0x4706816a, 0xba3e2571, 0x7850c26c, 0x9cd0d89d },
+    { 0xda39a3ee, 0x5e6b4b0d, 0x3255bfef, 0x95601890, 0xafd80709 },
+    { 0x84983e44, 0x1c3bd26e, 0xbaae4aa1, 0xf95129e5, 0xe54670f1 }
+};
+
+static const sha2_32t g_nSha256TestHashes[SHA_NI_TEST_VECTORS][8] =
+{
+    { 0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223,
+      0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad },
+    { 0xe3b0c442, 0x98fc1c14, 0x9afbf4c8, 0x996fb924,
+      0x27ae41e4, 0x649b934c, 0xa495991b, 0x7852b855 },
+    { 0x248d6a61, 0xd20638b8, 0xe5c02693, 0x0c3e6039,
+      0xa33ce459, 0x64ff2167, 0xf6ecedd4, 0x19db06c1 }
+};
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Pad a test message to whole blocks - SHA-1 and SHA-256 pad
+//          the same way.
+// Requires: szMessage - the message, at most 55 bytes past a block
+//           blocks - receives the padded message
+// Returns: the number of blocks
+static unsigned long PadTestMessage(const char* szMessage, unsigned char blocks[128])
+{
+    unsigned long nLength = (unsigned long)strlen(szMessage);
+    unsigned long nBlocks = (nLength + 9 + 63) / 64;
+    unsigned long nBits = nLength * 8;
+
+    memset(blocks, 0, 128);
+    memcpy(blocks, szMessage, nLength);
+    blocks[nLength] = 0x80;
+
+    for (int nByte = 0; nByte < 4; nByte++) {
+        blocks[(nBlocks * 64) - 1 - nByte] = (unsigned char)(nBits >> (nByte * 8));
+    }
+
+    return nBlocks;
+} // End PadTestMessage
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Hash the test vectors with the SHA-NI block functions, to
+//          catch a CPU, or a compiler, that gets them wrong.
+// Requires: nothing - only call once HasShaNi returns true
+// Returns: true if every vector gave its hash
+static bool ShaNiSelfTest()
+{
+    static const sha1_32t nSha1Initial[5] =
+        { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    static const sha2_32t nSha256Initial[8] =
+        { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+    unsigned char blocks[128];
+
+    for (int nVector = 0; nVector < SHA_NI_TEST_VECTORS; nVector++) {
+        unsigned long nBlocks = PadTestMessage(g_szShaNiTestMessages[nVector], blocks);
+
+        sha1_32t nSha1Hash[5];
+        memcpy(nSha1Hash, nSha1Initial, sizeof(nSha1Hash));
+        sha1_compile_ni(nSha1Hash, blocks, nBlocks);
+
+        if (memcmp(nSha1Hash, g_nSha1TestHashes[nVector], sizeof(nSha1Hash)) != 0) {
+            return false;
+        }
+
+        sha2_32t nSha256Hash[8];
+        memcpy(nSha256Hash, nSha256Initial, sizeof(nSha256Hash));
+        sha256_compile_ni(nSha256Hash, blocks, nBlocks);
+
+        if (memcmp(nSha256Hash, g_nSha256TestHashes[nVector], sizeof(nSha256Hash)) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+} // End ShaNiSelfTest
+
+// Checked during static initialization, before any threads are started.
+// A failed self test leaves sha1_hash and sha256_hash on the portable
+// block functions.
+static const bool g_bShaNi = HasShaNi() && ShaNiSelfTest();
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Whether sha1_compile_ni and sha256_compile_ni can be used.
+// Requires: nothing
+// Returns: non-zero if they can
+int sha_ni_available(void)
+{
+    return g_bShaNi ? 1 : 0;
+} // End sha_ni_available
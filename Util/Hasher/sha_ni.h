@@ -0,0 +1,42 @@
+/*********************************************************************
+ *
+ *  file:  sha_ni.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: SHA-1 and SHA-256 block functions using the x86 SHA
+ *          extensions (SHA-NI) - sha1_hash and sha256_hash hand whole
+ *          blocks to them when sha_ni_available says the CPU has them.
+ *
+ *********************************************************************/
+
+#ifndef __SHA_NI_H__
+#define __SHA_NI_H__
+
+#include "sha1.h"
+#include "sha2.h"
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/* Non-zero when the SHA-NI paths were built and the CPU can run them - */
+/* checked once, during static initialization.                         */
+int sha_ni_available(void);
+
+/* Compile nBlocks 64 byte blocks of the original byte stream into the  */
+/* hash - no byte swapping is needed first.  Only call these when       */
+/* sha_ni_available returns non-zero.                                  */
+void sha1_compile_ni(sha1_32t hash[5], const unsigned char data[], unsigned long nBlocks);
+void sha256_compile_ni(sha2_32t hash[8], const unsigned char data[], unsigned long nBlocks);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // __SHA_NI_H__
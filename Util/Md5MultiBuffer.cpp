@@ -0,0 +1,577 @@
+/*********************************************************************
+ *
+ *  file:  Md5MultiBuffer.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: MD5 of several independent buffers at once, one buffer per
+ *          SIMD lane - for hashing many small files.
+ *
+ *********************************************************************/
+
+#include "Md5MultiBuffer.h"
+
+#include <string.h>
+
+//---------------------------------------------------------------------
+// SSE2 is part of every x64 CPU, and of the x86 builds targeting it.
+// AVX2 is built on compilers that can generate it without -mavx2, and
+// used only when the CPU and the OS have it.  Define MD5_NO_SIMD to
+// leave both out.
+//---------------------------------------------------------------------
+#if !defined(MD5_NO_SIMD)
+    #if defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+        #define MD5_HAVE_SSE2
+        #include <emmintrin.h>
+        #if (_MSC_VER >= 1700)
+            #define MD5_HAVE_AVX2
+            #define MD5_AVX2_TARGET
+            #include <intrin.h>
+            #include <immintrin.h>
+        #endif
+    #elif defined(__SSE2__)
+        #define MD5_HAVE_SSE2
+        #include <emmintrin.h>
+        #if defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7))
+            #define MD5_HAVE_AVX2
+            #define MD5_AVX2_TARGET     __attribute__((target("avx2")))
+            #include <cpuid.h>
+            #include <immintrin.h>
+        #endif
+    #endif
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Check for AVX2, and that the OS saves the YMM registers.
+// Requires: nothing
+// Returns: true if the AVX2 steps can run
+static bool HasAvx2()
+{
+    #if defined(MD5_HAVE_AVX2) && defined(_MSC_VER)
+        int nCpuInfo[4];
+        __cpuid(nCpuInfo, 0);
+        if (nCpuInfo[0] < 7) {
+            return false;
+        }
+        __cpuid(nCpuInfo, 1);
+        if ( ((nCpuInfo[2] & (1 << 27)) == 0) || ((nCpuInfo[2] & (1 << 28)) == 0) ) {
+            return false;
+        }
+        if ((_xgetbv(0) & 6) != 6) {
+            return false;
+        }
+        __cpuidex(nCpuInfo, 7, 0);
+        return ( (nCpuInfo[1] & (1 << 5)) != 0 );
+    #elif defined(MD5_HAVE_AVX2)
+        unsigned int nEax = 0, nEbx = 0, nEcx = 0, nEdx = 0;
+        if (__get_cpuid_max(0, NULL) < 7) {
+            return false;
+        }
+        __cpuid(1, nEax, nEbx, nEcx, nEdx);
+        if ( ((nEcx & (1 << 27)) == 0) || ((nEcx & (1 << 28)) == 0) ) {
+            return false;
+        }
+        unsigned int nXcr0 = 0, nXcr0High = 0;
+        __asm__ __volatile__ ("xgetbv" : "=a" (nXcr0), "=d" (nXcr0High) : "c" (0));
+        if ((nXcr0 & 6) != 6) {
+            return false;
+        }
+        __cpuid_count(7, 0, nEax, nEbx, nEcx, nEdx);
+        return ( (nEbx & (1 << 5)) != 0 );
+    #else
+        return false;
+    #endif
+} // End HasAvx2
+
+// Checked during static initialization, before any threads are started.
+static const bool g_bAvx2 = HasAvx2();
+
+//---------------------------------------------------------------------
+// The 64 MD5 steps, on whatever V_ADD, V_XOR... stand for where they
+// are expanded - w[] holds the block's 16 words.
+//---------------------------------------------------------------------
+#define MD5_F(b, c, d)      V_XOR(d, V_AND(b, V_XOR(c, d)))
+#define MD5_G(b, c, d)      V_XOR(c, V_AND(d, V_XOR(b, c)))
+#define MD5_H(b, c, d)      V_XOR(b, V_XOR(c, d))
+#define MD5_I(b, c, d)      V_XOR(c, V_OR(b, V_NOT(d)))
+
+#define MD5_STEP(f, a, b, c, d, k, s, t)                                        \
+    a = V_ADD(a, V_ADD(f(b, c, d), V_ADD(w[k], V_SET1(t))));                    \
+    a = V_ADD(b, V_ROTL(a, s))
+
+#define MD5_ALL_STEPS(a, b, c, d)                                               \
+    MD5_STEP(MD5_F, a, b, c, d,  0,  7, 0xd76aa478);                            \
+    MD5_STEP(MD5_F, d, a, b, c,  1, 12, 0xe8c7b756);                            \
+    MD5_STEP(MD5_F, c, d, a, b,  2, 17, 0x242070db);                            \
+    MD5_STEP(MD5_F, b, c, d, a,  3, 22, 0xc1bdceee);                            \
+    MD5_STEP(MD5_F, a, b, c, d,  4,  7, 0xf57c0faf);                            \
+    MD5_STEP(MD5_F, d, a, b, c,  5, 12, 0x4787c62a);                            \
+    MD5_STEP(MD5_F, c, d, a, b,  6, 17, 0xa8304613);                            \
+    MD5_STEP(MD5_F, b, c, d, a,  7, 22, 0xfd469501);                            \
+    MD5_STEP(MD5_F, a, b, c, d,  8,  7, 0x698098d8);                            \
+    MD5_STEP(MD5_F, d, a, b, c,  9, 12, 0x8b44f7af);                            \
+    MD5_STEP(MD5_F, c, d, a, b, 10, 17, 0xffff5bb1);                            \
+    MD5_STEP(MD5_F, b, c, d, a, 11, 22, 0x895cd7be);                            \
+    MD5_STEP(MD5_F, a, b, c, d, 12,  7, 0x6b901122);                            \
+    MD5_STEP(MD5_F, d, a, b, c, 13, 12, 0xfd987193);                            \
+    MD5_STEP(MD5_F, c, d, a, b, 14, 17, 0xa679438e);                            \
+    MD5_STEP(MD5_F, b, c, d, a, 15, 22, 0x49b40821);                            \
+    MD5_STEP(MD5_G, a, b, c, d,  1,  5, 0xf61e2562);                            \
+    MD5_STEP(MD5_G, d, a, b, c,  6,  9, 0xc040b340);                            \
+    MD5_STEP(MD5_G, c, d, a, b, 11, 14, 0x265e5a51);                            \
+    MD5_STEP(MD5_G, b, c, d, a,  0, 20, 0xe9b6c7aa);                            \
+    MD5_STEP(MD5_G, a, b, c, d,  5,  5, 0xd62f105d);                            \
+    MD5_STEP(MD5_G, d, a, b, c, 10,  9, 0x02441453);                            \
+    MD5_STEP(MD5_G, c, d, a, b, 15, 14, 0xd8a1e681);                            \
+    MD5_STEP(MD5_G, b, c, d, a,  4, 20, 0xe7d3fbc8);                            \
+    MD5_STEP(MD5_G, a, b, c, d,  9,  5, 0x21e1cde6);                            \
+    MD5_STEP(MD5_G, d, a, b, c, 14,  9, 0xc33707d6);                            \
+    MD5_STEP(MD5_G, c, d, a, b,  3, 14, 0xf4d50d87);                            \
+    MD5_STEP(MD5_G, b, c, d, a,  8, 20, 0x455a14ed);                            \
+    MD5_STEP(MD5_G, a, b, c, d, 13,  5, 0xa9e3e905);                            \
+    MD5_STEP(MD5_G, d, a, b, c,  2,  9, 0xfcefa3f8);                            \
+    MD5_STEP(MD5_G, c, d, a, b,  7, 14, 0x676f02d9);                            \
+    MD5_STEP(MD5_G, b, c, d, a, 12, 20, 0x8d2a4c8a);                            \
+    MD5_STEP(MD5_H, a, b, c, d,  5,  4, 0xfffa3942);                            \
+    MD5_STEP(MD5_H, d, a, b, c,  8, 11, 0x8771f681);                            \
+    MD5_STEP(MD5_H, c, d, a, b, 11, 16, 0x6d9d6122);                            \
+    MD5_STEP(MD5_H, b, c, d, a, 14, 23, 0xfde5380c);                            \
+    MD5_STEP(MD5_H, a, b, c, d,  1,  4, 0xa4beea44);                            \
+    MD5_STEP(MD5_H, d, a, b, c,  4, 11, 0x4bdecfa9);                            \
+    MD5_STEP(MD5_H, c, d, a, b,  7, 16, 0xf6bb4b60);                            \
+    MD5_STEP(MD5_H, b, c, d, a, 10, 23, 0xbebfbc70);                            \
+    MD5_STEP(MD5_H, a, b, c, d, 13,  4, 0x289b7ec6);                            \
+    MD5_STEP(MD5_H, d, a, b, c,  0, 11, 0xeaa127fa);                            \
+    MD5_STEP(MD5_H, c, d, a, b,  3, 16, 0xd4ef3085);                            \
+    MD5_STEP(MD5_H, b, c, d, a,  6, 23, 0x04881d05);                            \
+    MD5_STEP(MD5_H, a, b, c, d,  9,  4, 0xd9d4d039);                            \
+    MD5_STEP(MD5_H, d, a, b, c, 12, 11, 0xe6db99e5);                            \
+    MD5_STEP(MD5_H, c, d, a, b, 15, 16, 0x1fa27cf8);                            \
+    MD5_STEP(MD5_H, b, c, d, a,  2, 23, 0xc4ac5665);                            \
+    MD5_STEP(MD5_I, a, b, c, d,  0,  6, 0xf4292244);                            \
+    MD5_STEP(MD5_I, d, a, b, c,  7, 10, 0x432aff97);                            \
+    MD5_STEP(MD5_I, c, d, a, b, 14, 15, 0xab9423a7);                            \
+    MD5_STEP(MD5_I, b, c, d, a,  5, 21, 0xfc93a039);                            \
+    MD5_STEP(MD5_I, a, b, c, d, 12,  6, 0x655b59c3);                            \
+    MD5_STEP(MD5_I, d, a, b, c,  3, 10, 0x8f0ccc92);                            \
+    MD5_STEP(MD5_I, c, d, a, b, 10, 15, 0xffeff47d);                            \
+    MD5_STEP(MD5_I, b, c, d, a,  1, 21, 0x85845dd1);                            \
+    MD5_STEP(MD5_I, a, b, c, d,  8,  6, 0x6fa87e4f);                            \
+    MD5_STEP(MD5_I, d, a, b, c, 15, 10, 0xfe2ce6e0);                            \
+    MD5_STEP(MD5_I, c, d, a, b,  6, 15, 0xa3014314);                            \
+    MD5_STEP(MD5_I, b, c, d, a, 13, 21, 0x4e0811a1);                            \
+    MD5_STEP(MD5_I, a, b, c, d,  4,  6, 0xf7537e82);                            \
+    MD5_STEP(MD5_I, d, a, b, c, 11, 10, 0xbd3af235);                            \
+    MD5_STEP(MD5_I, c, d, a, b,  2, 15, 0x2ad7d2bb);                            \
+    MD5_STEP(MD5_I, b, c, d, a,  9, 21, 0xeb86d391)
+
+typedef unsigned int Md5State_t[MD5_MULTI_BUFFER_LANES];
+
+#ifndef MD5_HAVE_SSE2
+///////////////////////////////////////////////////////////////////////
+// Purpose: Hash nBlocks blocks of each lane, one lane at a time.
+// Requires:
+//      nState: A, B, C and D of each lane
+//      pBlocks: nBlocks contiguous blocks for each lane
+//      nFirst, nLanes: the lanes to hash
+static void CompileScalar(Md5State_t nState[4], const unsigned char* pBlocks[],
+                          int nFirst, int nLanes, size_t nBlocks)
+{
+    #define V_ADD(x, y)     ((x) + (y))
+    #define V_XOR(x, y)     ((x) ^ (y))
+    #define V_AND(x, y)     ((x) & (y))
+    #define V_OR(x, y)      ((x) | (y))
+    #define V_NOT(x)        (~(x))
+    #define V_ROTL(x, s)    (((x) << (s)) | ((x) >> (32 - (s))))
+    #define V_SET1(t)       ((unsigned int)(t))
+
+    for (int nLane = nFirst; nLane < nFirst + nLanes; nLane++) {
+        unsigned int a = nState[0][nLane], b = nState[1][nLane];
+        unsigned int c = nState[2][nLane], d = nState[3][nLane];
+        const unsigned char* pBlock = pBlocks[nLane];
+
+        for (size_t nBlock = 0; nBlock < nBlocks; nBlock++, pBlock += 64) {
+            unsigned int w[16];
+            for (int nWord = 0; nWord < 16; nWord++) {
+                const unsigned char* p = pBlock + (nWord * 4);
+                w[nWord] = (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+                           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+            }
+
+            unsigned int aa = a, bb = b, cc = c, dd = d;
+            MD5_ALL_STEPS(a, b, c, d);
+            a += aa; b += bb; c += cc; d += dd;
+        }
+
+        nState[0][nLane] = a; nState[1][nLane] = b;
+        nState[2][nLane] = c; nState[3][nLane] = d;
+    }
+
+    #undef V_ADD
+    #undef V_XOR
+    #undef V_AND
+    #undef V_OR
+    #undef V_NOT
+    #undef V_ROTL
+    #undef V_SET1
+} // End CompileScalar
+#endif // MD5_HAVE_SSE2
+
+#ifdef MD5_HAVE_SSE2
+///////////////////////////////////////////////////////////////////////
+// Purpose: Hash nBlocks blocks of four lanes, a lane per 32 bit word.
+// Requires:
+//      nState: A, B, C and D of each lane
+//      pBlocks: nBlocks contiguous blocks for each lane
+//      nFirst: the first of the four lanes
+static void CompileSse2(Md5State_t nState[4], const unsigned char* pBlocks[],
+                        int nFirst, size_t nBlocks)
+{
+    #define V_ADD(x, y)     _mm_add_epi32(x, y)
+    #define V_XOR(x, y)     _mm_xor_si128(x, y)
+    #define V_AND(x, y)     _mm_and_si128(x, y)
+    #define V_OR(x, y)      _mm_or_si128(x, y)
+    #define V_NOT(x)        _mm_xor_si128(x, allOnes)
+    #define V_ROTL(x, s)    _mm_or_si128(_mm_slli_epi32(x, s), _mm_srli_epi32(x, 32 - (s)))
+    #define V_SET1(t)       _mm_set1_epi32((int)(t))
+
+    const __m128i allOnes = _mm_set1_epi32(-1);
+    const unsigned char* p0 = pBlocks[nFirst];
+    const unsigned char* p1 = pBlocks[nFirst + 1];
+    const unsigned char* p2 = pBlocks[nFirst + 2];
+    const unsigned char* p3 = pBlocks[nFirst + 3];
+
+    __m128i a = _mm_loadu_si128((const __m128i*)&nState[0][nFirst]);
+    __m128i b = _mm_loadu_si128((const __m128i*)&nState[1][nFirst]);
+    __m128i c = _mm_loadu_si128((const __m128i*)&nState[2][nFirst]);
+    __m128i d = _mm_loadu_si128((const __m128i*)&nState[3][nFirst]);
+
+    for (size_t nBlock = 0; nBlock < nBlocks; nBlock++) {
+        __m128i w[16];
+
+        // Four words of each lane, transposed to a word of every lane.
+        for (int nWord = 0; nWord < 16; nWord += 4) {
+            __m128i r0 = _mm_loadu_si128((const __m128i*)(p0 + (nWord * 4)));
+            __m128i r1 = _mm_loadu_si128((const __m128i*)(p1 + (nWord * 4)));
+            __m128i r2 = _mm_loadu_si128((const __m128i*)(p2 + (nWord * 4)));
+            __m128i r3 = _mm_loadu_si128((const __m128i*)(p3 + (nWord * 4)));
+
+            __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+            __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+            __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+            w[nWord]     = _mm_unpacklo_epi64(t0, t2);
+            w[nWord + 1] = _mm_unpackhi_epi64(t0, t2);
+            w[nWord + 2] = _mm_unpacklo_epi64(t1, t3);
+            w[nWord + 3] = _mm_unpackhi_epi64(t1, t3);
+        }
+
+        __m128i aa = a, bb = b, cc = c, dd = d;
+        MD5_ALL_STEPS(a, b, c, d);
+        a = _mm_add_epi32(a, aa); b = _mm_add_epi32(b, bb);
+        c = _mm_add_epi32(c, cc); d = _mm_add_epi32(d, dd);
+
+        p0 += 64; p1 += 64; p2 += 64; p3 += 64;
+    }
+
+    _mm_storeu_si128((__m128i*)&nState[0][nFirst], a);
+    _mm_storeu_si128((__m128i*)&nState[1][nFirst], b);
+    _mm_storeu_si128((__m128i*)&nState[2][nFirst], c);
+    _mm_storeu_si128((__m128i*)&nState[3][nFirst], d);
+
+    #undef V_ADD
+    #undef V_XOR
+    #undef V_AND
+    #undef V_OR
+    #undef V_NOT
+    #undef V_ROTL
+    #undef V_SET1
+} // End CompileSse2
+#endif // MD5_HAVE_SSE2
+
+#ifdef MD5_HAVE_AVX2
+///////////////////////////////////////////////////////////////////////
+// Purpose: Hash nBlocks blocks of all eight lanes, a lane per 32 bit
+//          word.
+// Requires:
+//      nState: A, B, C and D of each lane
+//      pBlocks: nBlocks contiguous blocks for each lane
+MD5_AVX2_TARGET
+static void CompileAvx2(Md5State_t nState[4], const unsigned char* pBlocks[], size_t nBlocks)
+{
+    #define V_ADD(x, y)     _mm256_add_epi32(x, y)
+    #define V_XOR(x, y)     _mm256_xor_si256(x, y)
+    #define V_AND(x, y)     _mm256_and_si256(x, y)
+    #define V_OR(x, y)      _mm256_or_si256(x, y)
+    #define V_NOT(x)        _mm256_xor_si256(x, allOnes)
+    #define V_ROTL(x, s)    _mm256_or_si256(_mm256_slli_epi32(x, s), _mm256_srli_epi32(x, 32 - (s)))
+    #define V_SET1(t)       _mm256_set1_epi32((int)(t))
+
+    const __m256i allOnes = _mm256_set1_epi32(-1);
+    const unsigned char* p[MD5_MULTI_BUFFER_LANES];
+    for (int nLane = 0; nLane < MD5_MULTI_BUFFER_LANES; nLane++) {
+        p[nLane] = pBlocks[nLane];
+    }
+
+    __m256i a = _mm256_loadu_si256((const __m256i*)nState[0]);
+    __m256i b = _mm256_loadu_si256((const __m256i*)nState[1]);
+    __m256i c = _mm256_loadu_si256((const __m256i*)nState[2]);
+    __m256i d = _mm256_loadu_si256((const __m256i*)nState[3]);
+
+    for (size_t nBlock = 0; nBlock < nBlocks; nBlock++) {
+        __m256i w[16];
+
+        // Eight words of each lane, transposed to a word of every lane.
+        for (int nWord = 0; nWord < 16; nWord += 8) {
+            __m256i r[MD5_MULTI_BUFFER_LANES];
+            for (int nLane = 0; nLane < MD5_MULTI_BUFFER_LANES; nLane++) {
+                r[nLane] = _mm256_loadu_si256((const __m256i*)(p[nLane] + (nWord * 4)));
+            }
+
+            __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+            __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+            __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+            __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+            __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+            __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+            __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+            __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+            __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+            __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+            __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+            __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            // Low halves hold the first four words, high halves the rest.
+            w[nWord]     = _mm256_permute2x128_si256(u0, u4, 0x20);
+            w[nWord + 1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+            w[nWord + 2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+            w[nWord + 3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+            w[nWord + 4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+            w[nWord + 5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+            w[nWord + 6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+            w[nWord + 7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+        }
+
+        __m256i aa = a, bb = b, cc = c, dd = d;
+        MD5_ALL_STEPS(a, b, c, d);
+        a = _mm256_add_epi32(a, aa); b = _mm256_add_epi32(b, bb);
+        c = _mm256_add_epi32(c, cc); d = _mm256_add_epi32(d, dd);
+
+        for (int nLane = 0; nLane < MD5_MULTI_BUFFER_LANES; nLane++) {
+            p[nLane] += 64;
+        }
+    }
+
+    _mm256_storeu_si256((__m256i*)nState[0], a);
+    _mm256_storeu_si256((__m256i*)nState[1], b);
+    _mm256_storeu_si256((__m256i*)nState[2], c);
+    _mm256_storeu_si256((__m256i*)nState[3], d);
+
+    #undef V_ADD
+    #undef V_XOR
+    #undef V_AND
+    #undef V_OR
+    #undef V_NOT
+    #undef V_ROTL
+    #undef V_SET1
+} // End CompileAvx2
+#endif // MD5_HAVE_AVX2
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Hash nBlocks blocks of every lane with the widest steps the
+//          CPU has.
+static void CompileLanes(Md5State_t nState[4], const unsigned char* pBlocks[], size_t nBlocks)
+{
+    #ifdef MD5_HAVE_AVX2
+        if (g_bAvx2) {
+            CompileAvx2(nState, pBlocks, nBlocks);
+            return;
+        }
+    #endif
+
+    #ifdef MD5_HAVE_SSE2
+        for (int nFirst = 0; nFirst < MD5_MULTI_BUFFER_LANES; nFirst += 4) {
+            CompileSse2(nState, pBlocks, nFirst, nBlocks);
+        }
+    #else
+        CompileScalar(nState, pBlocks, 0, MD5_MULTI_BUFFER_LANES, nBlocks);
+    #endif
+
+} // End CompileLanes
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Md5MultiBuffer constructor - every lane is free.
+Md5MultiBuffer::Md5MultiBuffer() : m_nActiveLanes(0)
+{
+    memset(m_listLanes, 0, sizeof(m_listLanes));
+    memset(m_nState, 0, sizeof(m_nState));
+
+} // End Md5MultiBuffer
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Start hashing a buffer in a free lane - the last partial
+//          block is copied with the padding, the rest is read in place.
+// Requires:
+//      nJob: returned with the buffer's digest
+//      pBuffer: data, left in place until the digest is returned
+//      nLength: number of bytes
+// Returns: true if a lane was free, false otherwise.
+bool Md5MultiBuffer::Add(int nJob, const unsigned char* pBuffer, size_t nLength)
+{
+    int nLane = 0;
+    for (; nLane < MD5_MULTI_BUFFER_LANES; nLane++) {
+        if (m_listLanes[nLane].bActive == false) {
+            break;
+        }
+    }
+
+    if (nLane == MD5_MULTI_BUFFER_LANES) {
+        return false;
+    }
+
+    Md5Lane& lane = m_listLanes[nLane];
+    lane.bActive = true;
+    lane.nJob = nJob;
+    lane.pData = pBuffer;
+    lane.nDataBlocks = nLength / 64;
+    lane.nBlocksDone = 0;
+    lane.bInTail = false;
+
+    size_t nRemainder = nLength % 64;
+    memset(lane.tail, 0, sizeof(lane.tail));
+    if (nRemainder > 0) {
+        memcpy(lane.tail, pBuffer + (lane.nDataBlocks * 64), nRemainder);
+    }
+    lane.tail[nRemainder] = 0x80;
+
+    // The length in bits, little endian, ends the last block.
+    lane.nTailBlocks = (nRemainder + 9 <= 64) ? 1 : 2;
+    unsigned char* pLength = lane.tail + (lane.nTailBlocks * 64) - 8;
+    UINT64 ul64Bits = (UINT64)nLength << 3;
+    for (int nByte = 0; nByte < 8; nByte++) {
+        pLength[nByte] = (unsigned char)(ul64Bits >> (nByte * 8));
+    }
+
+    m_nState[0][nLane] = 0x67452301;
+    m_nState[1][nLane] = 0xefcdab89;
+    m_nState[2][nLane] = 0x98badcfe;
+    m_nState[3][nLane] = 0x10325476;
+
+    m_nActiveLanes++;
+    return true;
+
+} // End Add
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Next block of a lane, and how many follow it contiguously.
+const unsigned char* Md5MultiBuffer::GetNextBlock(const Md5Lane& lane, size_t& nBlocksLeft) const
+{
+    if (lane.bInTail) {
+        nBlocksLeft = lane.nTailBlocks - lane.nBlocksDone;
+        return lane.tail + (lane.nBlocksDone * 64);
+    }
+
+    nBlocksLeft = lane.nDataBlocks - lane.nBlocksDone;
+    return lane.pData + (lane.nBlocksDone * 64);
+
+} // End GetNextBlock
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Step the lanes until at least one buffer finishes - each
+//          step runs as many blocks as every busy lane has in a row.
+// Requires:
+//      listResults: the finished buffers are appended to it.
+// Returns: nothing
+void Md5MultiBuffer::Run(std::vector<Md5MultiBufferResult>& listResults)
+{
+    bool bFinished = false;
+
+    while ( (bFinished == false) && (m_nActiveLanes > 0) ) {
+
+        const unsigned char* pBlocks[MD5_MULTI_BUFFER_LANES];
+        const unsigned char* pBusyBlock = NULL;
+        size_t nRunBlocks = 0;
+        bool bFirstBusy = true;
+
+        for (int nLane = 0; nLane < MD5_MULTI_BUFFER_LANES; nLane++) {
+            pBlocks[nLane] = NULL;
+            if (m_listLanes[nLane].bActive == false) {
+                continue;
+            }
+
+            size_t nBlocksLeft = 0;
+            pBlocks[nLane] = GetNextBlock(m_listLanes[nLane], nBlocksLeft);
+            if ( bFirstBusy || (nBlocksLeft < nRunBlocks) ) {
+                nRunBlocks = nBlocksLeft;
+                bFirstBusy = false;
+            }
+            pBusyBlock = pBlocks[nLane];
+        }
+
+        // Idle lanes repeat a busy lane's blocks - their results are
+        // never read.
+        for (int nLane = 0; nLane < MD5_MULTI_BUFFER_LANES; nLane++) {
+            if (pBlocks[nLane] == NULL) {
+                pBlocks[nLane] = pBusyBlock;
+            }
+        }
+
+        if (nRunBlocks > 0) {
+            CompileLanes(m_nState, pBlocks, nRunBlocks);
+        }
+
+        for (int nLane = 0; nLane < MD5_MULTI_BUFFER_LANES; nLane++) {
+            Md5Lane& lane = m_listLanes[nLane];
+            if (lane.bActive == false) {
+                continue;
+            }
+
+            lane.nBlocksDone += nRunBlocks;
+
+            if ( (lane.bInTail == false) && (lane.nBlocksDone == lane.nDataBlocks) ) {
+                lane.bInTail = true;
+                lane.nBlocksDone = 0;
+            }
+            else if ( lane.bInTail && (lane.nBlocksDone == (size_t)lane.nTailBlocks) ) {
+                Md5MultiBufferResult result;
+                result.nJob = lane.nJob;
+                for (int nByte = 0; nByte < MD5_MULTI_BUFFER_DIGEST_SIZE; nByte++) {
+                    result.digest[nByte] = (unsigned char)(m_nState[nByte / 4][nLane] >> ((nByte % 4) * 8));
+                }
+                listResults.push_back(result);
+
+                lane.bActive = false;
+                m_nActiveLanes--;
+                bFinished = true;
+            }
+        }
+    }
+
+} // End Run
+
+///////////////////////////////////////////////////////////////////////
+const char* Md5MultiBuffer::GetImplementation()
+{
+    #ifdef MD5_HAVE_AVX2
+        if (g_bAvx2) {
+            return "avx2";
+        }
+    #endif
+
+    #ifdef MD5_HAVE_SSE2
+        return "sse2";
+    #else
+        return "scalar";
+    #endif
+
+} // End GetImplementation
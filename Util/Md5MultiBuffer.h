@@ -0,0 +1,121 @@
+/*********************************************************************
+ *
+ *  file:  Md5MultiBuffer.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: MD5 of several independent buffers at once, one buffer per
+ *          SIMD lane - for hashing many small files.
+ *
+ *********************************************************************/
+
+#ifndef __MD5_MULTI_BUFFER_H__
+#define __MD5_MULTI_BUFFER_H__
+
+#include "Stdafx.h"
+
+#include <stddef.h>
+#include <vector>
+
+//---------------------------------------------------------------------
+// Buffers hashed side by side - one AVX2 register, or two SSE2
+// registers, of 32 bit words.
+//---------------------------------------------------------------------
+#define MD5_MULTI_BUFFER_LANES          8
+#define MD5_MULTI_BUFFER_DIGEST_SIZE    16
+
+//---------------------------------------------------------------------
+// Digest of a finished buffer, with the job number it was added with.
+//---------------------------------------------------------------------
+struct Md5MultiBufferResult
+{
+    int                         nJob;
+    unsigned char               digest[MD5_MULTI_BUFFER_DIGEST_SIZE];
+};
+
+///////////////////////////////////////////////////////////////////////
+// Md5MultiBuffer Class
+//
+// Usage:
+//      Md5MultiBuffer md5Lanes;
+//      std::vector<Md5MultiBufferResult> listResults;
+//
+//      while (more buffers) {
+//          while (md5Lanes.HasFreeLane() && (a buffer is ready)) {
+//              md5Lanes.Add(nJob, pBuffer, nLength);
+//          }
+//          md5Lanes.Run(listResults);      // until a buffer finishes
+//      }
+//      while (md5Lanes.IsIdle() == false) {
+//          md5Lanes.Run(listResults);
+//      }
+//
+// A buffer must stay in place until its result is returned.  The lanes
+// step through their buffers together, a block of each per step, so a
+// lane that finishes is best refilled before the next Run - a lane left
+// idle repeats another lane's work.
+//
+// The steps use AVX2 when the CPU has it, otherwise SSE2, otherwise a
+// lane at a time.
+
+class Md5MultiBuffer
+{
+private:
+    struct Md5Lane
+    {
+        bool                    bActive;
+        int                     nJob;
+        const unsigned char*    pData;
+        size_t                  nDataBlocks;        // Whole blocks of the buffer
+        size_t                  nBlocksDone;        // Of the data, then of the tail
+        bool                    bInTail;
+        int                     nTailBlocks;
+        unsigned char           tail[128];          // Last partial block and the padding
+    };
+
+    Md5Lane                     m_listLanes[MD5_MULTI_BUFFER_LANES];
+
+    //-----------------------------------------------------------------
+    // A, B, C and D of each lane - a row of lanes per word, as the
+    // SIMD steps load them.
+    //-----------------------------------------------------------------
+    unsigned int                m_nState[4][MD5_MULTI_BUFFER_LANES];
+    int                         m_nActiveLanes;
+
+public:
+    Md5MultiBuffer();
+    virtual ~Md5MultiBuffer() {}
+
+    //-----------------------------------------------------------------
+    // Start hashing the buffer in a free lane.
+    // Returns false if every lane is busy.
+    //-----------------------------------------------------------------
+    bool Add(int nJob, const unsigned char* pBuffer, size_t nLength);
+
+    //-----------------------------------------------------------------
+    // Step the lanes until at least one buffer finishes, appending the
+    // finished buffers' digests to listResults.
+    //-----------------------------------------------------------------
+    void Run(std::vector<Md5MultiBufferResult>& listResults);
+
+    bool HasFreeLane() const { return (m_nActiveLanes < MD5_MULTI_BUFFER_LANES); }
+    bool IsIdle() const { return (m_nActiveLanes == 0); }
+
+    //-----------------------------------------------------------------
+    // Name of the steps used - "avx2", "sse2" or "scalar".
+    //-----------------------------------------------------------------
+    static const char* GetImplementation();
+
+private:
+    // Not implemented
+    Md5MultiBuffer(const Md5MultiBuffer&);
+    Md5MultiBuffer& operator=(const Md5MultiBuffer&);
+
+    const unsigned char* GetNextBlock(const Md5Lane& lane, size_t& nBlocksLeft) const;
+};
+
+#endif // __MD5_MULTI_BUFFER_H__
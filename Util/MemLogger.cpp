@@ -15,42 +15,103 @@
 #include "Stdafx.h"
 #include "MemLogger.h"
 
+#include <string.h>
+
 using DIOMEDE_CRITICAL::CCriticalSection;
 using DIOMEDE_CRITICAL::Lock;
 
+//---------------------------------------------------------------------
+// Atomic helpers for the producer path.
+//---------------------------------------------------------------------
+#ifdef WIN32
+    #define MEMLOG_FETCH_AND_INC(p)         (InterlockedIncrement(p) - 1)
+    #define MEMLOG_CAS(p, lOld, lNew)       (InterlockedCompareExchange(p, lNew, lOld) == lOld)
+    #define MEMLOG_BARRIER()                MemoryBarrier()
+#else
+    #define MEMLOG_FETCH_AND_INC(p)         __sync_fetch_and_add(p, 1)
+    #define MEMLOG_CAS(p, lOld, lNew)       __sync_bool_compare_and_swap(p, lOld, lNew)
+    #define MEMLOG_BARRIER()                __sync_synchronize()
+#endif
+
 ///////////////////////////////////////////////////////////////////////
 CMemLogger::CMemLogger()
 {
+	m_pSlots = NULL;
+	m_ulSlots = 0;
+	m_ulSlotMask = 0;
+	m_lWriteTicket = 0;
 	m_ulCacheTime = 0;
 }
 
 //////////////////////////////////////////////////////////////////////
 CMemLogger::~CMemLogger()
 {
-    while (m_CircularBuffer.size() > 0) {
-        CLogMsg aLogMsg = (CLogMsg)m_CircularBuffer.front();
-        m_CircularBuffer.pop_front();
-
+    if (m_pSlots) {
+        delete [] m_pSlots;
+        m_pSlots = NULL;
     }
 }
 
 //////////////////////////////////////////////////////////////////////
-bool CMemLogger::Init( ULONG ulCacheTime)
+// Purpose:
+//      Setup the cache time and preallocate the ring buffer.
+// Requires:
+//      ulCacheTime: number of milliseconds a log line is retained
+//      ulSlots: maximum number of log lines retained - rounded up
+//               to the next power of 2.
+// Returns: true if successful, false otherwise
+// Note: the slots are reallocated only if the size changes, which
+//       must happen before the logger is registered as an observer.
+bool CMemLogger::Init( ULONG ulCacheTime, ULONG ulSlots)
 {
+	Lock<CCriticalSection> lock( m_lock);
+
 	m_ulCacheTime = ulCacheTime;
-	return true;
+	return AllocateSlots(ulSlots);
 
 } // End Init
 
 //////////////////////////////////////////////////////////////////////
-bool CMemLogger::IsIgnored( int nComponent, int nEvent)
+// Purpose:
+//      Allocate the ring buffer slots.
+// Requires:
+//      ulSlots: requested number of slots.
+// Returns: true if successful, false otherwise
+bool CMemLogger::AllocateSlots( ULONG ulSlots)
 {
-	return false;
+    ULONG ulSize = 1;
+    while (ulSize < ulSlots) {
+        ulSize <<= 1;
+    }
 
-} // End IsIgnored
+    if ( (m_pSlots != NULL) && (ulSize == m_ulSlots) ) {
+        return true;
+    }
+
+    CLogSlot* pSlots = new CLogSlot[ulSize];
+    if (pSlots == NULL) {
+        return false;
+    }
+
+    if (m_pSlots) {
+        delete [] m_pSlots;
+    }
+
+    m_pSlots = pSlots;
+    m_ulSlots = ulSize;
+    m_ulSlotMask = ulSize - 1;
+    m_lWriteTicket = 0;
+
+    return true;
+
+} // End AllocateSlots
 
 //////////////////////////////////////////////////////////////////////
-void CMemLogger::LogMessageCallback( const string& pMessage, int nLen)
+// Purpose:
+//      Returns the current tick count in milliseconds.
+// Requires: nothing
+// Returns: milliseconds
+ULONG CMemLogger::GetTimeNow()
 {
 	ULONG ulNow = 0;
 	#ifdef WIN32
@@ -61,40 +122,123 @@ void CMemLogger::LogMessageCallback( const string& pMessage, int nLen)
 	    ulNow = (tv.tv_usec / 1000) + (tv.tv_sec * 1000);
 	#endif
 
-	CLogMsg aLogMsg(pMessage, nLen);
+	return ulNow;
 
-	Lock<CCriticalSection> lock( m_lock);
-	m_CircularBuffer.push_back( aLogMsg);
+} // End GetTimeNow
+
+//////////////////////////////////////////////////////////////////////
+bool CMemLogger::IsIgnored( int nComponent, int nEvent)
+{
+	return false;
+
+} // End IsIgnored
 
-	/* For debugging
-	int nSize = (int)m_CircularBuffer.size();
-	*/
+//////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Copy the log line into the next slot of the ring.  Producers
+//      claim a slot with an atomic increment of the write ticket, so
+//      no lock is taken and no memory is allocated.  The oldest line
+//      is overwritten once the ring is full; lines older than the
+//      cache time are skipped when the cache is read.
+// Requires:
+//      pMessage: formatted log line
+//      nLen: length of the log line
+// Returns: nothing
+void CMemLogger::LogMessageCallback( const string& pMessage, int nLen)
+{
+    if (m_pSlots == NULL) {
+        return;
+    }
 
-	aLogMsg = m_CircularBuffer.front();
+	ULONG ulTicket = (ULONG)MEMLOG_FETCH_AND_INC(&m_lWriteTicket);
+	CLogSlot* pSlot = &m_pSlots[ulTicket & m_ulSlotMask];
 
-	// Remove all the old log events.
-	while ((ulNow - aLogMsg.m_ulTimeAdded) > m_ulCacheTime) {
-		    m_CircularBuffer.pop_front();
+	// If a producer that lapped the ring still owns this slot, drop
+	// the line rather than wait.
+	LONG lSequence = pSlot->m_lSequence;
+	if ( (lSequence == MEM_LOGGER_SLOT_BUSY) ||
+	     !MEMLOG_CAS(&pSlot->m_lSequence, lSequence, MEM_LOGGER_SLOT_BUSY) ) {
+	    return;
+	}
 
-		    if (m_CircularBuffer.size() == 0) {
-		        break;
-		    }
+	int nCopy = (int)pMessage.length();
+	if (nLen >= 0 && nLen < nCopy) {
+	    nCopy = nLen;
+	}
 
-		    aLogMsg = m_CircularBuffer.front();
+	if (nCopy > MEM_LOGGER_SLOT_SIZE - 1) {
+	    nCopy = MEM_LOGGER_SLOT_SIZE - 1;
+	    memcpy(pSlot->m_szLine, pMessage.data(), nCopy);
+	    pSlot->m_szLine[nCopy - 1] = '\n';
 	}
+	else {
+	    memcpy(pSlot->m_szLine, pMessage.data(), nCopy);
+	}
+
+	pSlot->m_szLine[nCopy] = '\0';
+	pSlot->m_nLen = nCopy;
+	pSlot->m_ulTimeAdded = GetTimeNow();
+
+	// Publish - the line must be visible before the sequence.
+	LONG lPublished = (LONG)(ulTicket + 1);
+	if (lPublished == MEM_LOGGER_SLOT_BUSY) {
+	    lPublished = 0;
+	}
+
+	MEMLOG_BARRIER();
+	pSlot->m_lSequence = lPublished;
 
 } // End LogMessageCallback
 
 //////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Returns the cached log lines, oldest first.  Slots that are
+//      being written, were overwritten during the copy, or have
+//      expired are skipped.
+// Requires: nothing
+// Returns: the cached log lines.
 string CMemLogger::GetCacheString()
 {
 	Lock<CCriticalSection> lock( m_lock);
 
 	string sRetVal;
-    LogMsgList::iterator lit;
-    for (lit = m_CircularBuffer.begin(); lit != m_CircularBuffer.end(); lit++) {
-       	CLogMsg aLogMsg = (*lit);
-		sRetVal += aLogMsg.m_sLine;
+	if (m_pSlots == NULL) {
+	    return sRetVal;
+	}
+
+	ULONG ulEnd = (ULONG)m_lWriteTicket;
+	ULONG ulCount = (ulEnd < m_ulSlots) ? ulEnd : m_ulSlots;
+	ULONG ulNow = GetTimeNow();
+
+	char szLine[MEM_LOGGER_SLOT_SIZE];
+
+	for (ULONG ulTicket = ulEnd - ulCount; ulTicket != ulEnd; ulTicket++) {
+	    CLogSlot* pSlot = &m_pSlots[ulTicket & m_ulSlotMask];
+
+	    LONG lSequence = pSlot->m_lSequence;
+	    if (lSequence != (LONG)(ulTicket + 1)) {
+	        continue;
+	    }
+
+	    MEMLOG_BARRIER();
+	    ULONG ulTimeAdded = pSlot->m_ulTimeAdded;
+	    int nLen = pSlot->m_nLen;
+	    if (nLen < 0 || nLen >= MEM_LOGGER_SLOT_SIZE) {
+	        continue;
+	    }
+	    memcpy(szLine, pSlot->m_szLine, nLen);
+	    MEMLOG_BARRIER();
+
+	    // Overwritten while we were copying.
+	    if (pSlot->m_lSequence != lSequence) {
+	        continue;
+	    }
+
+	    if ((ulNow - ulTimeAdded) > m_ulCacheTime) {
+	        continue;
+	    }
+
+		sRetVal.append(szLine, nLen);
 	}
 
 	return sRetVal;
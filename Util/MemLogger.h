@@ -28,26 +28,30 @@
 #include <sys/time.h>
 #endif
 
+//---------------------------------------------------------------------
+// Default ring size - the number of slots must be a power of 2 so
+// that a write ticket can be mapped to a slot with a mask.  Each
+// slot holds one formatted log line, truncated to the slot size.
+//---------------------------------------------------------------------
+#define MEM_LOGGER_DEFAULT_SLOTS    1024
+#define MEM_LOGGER_SLOT_SIZE        1024
+#define MEM_LOGGER_SLOT_BUSY        ((LONG)-1)
+
 /////////////////////////////////////////////////////////////////////////////
-class CLogMsg
+// A single preallocated entry in the ring.  m_lSequence is 0 while the
+// slot is empty, MEM_LOGGER_SLOT_BUSY while a producer is copying into it,
+// and (ticket + 1) once the line for that ticket has been published.
+class CLogSlot
 {
     public:
-	    string          m_sLine;
-	    ULONG           m_ulTimeAdded;
-
-	    CLogMsg( const string& sLine, int len)
-	    {
-	        m_sLine = sLine;
-	        
-		#ifdef WIN32
-	        m_ulTimeAdded = GetTickCount();
-		#else
-	        timeval tv;
-	        gettimeofday(&tv, NULL);
-	        m_ulTimeAdded = (tv.tv_usec / 1000) + (tv.tv_sec * 1000);
-	    #endif
-	    }
+        volatile LONG   m_lSequence;
+        ULONG           m_ulTimeAdded;
+        int             m_nLen;
+        char            m_szLine[MEM_LOGGER_SLOT_SIZE];
 
+        CLogSlot() : m_lSequence(0), m_ulTimeAdded(0), m_nLen(0) {
+            m_szLine[0] = '\0';
+        }
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -57,7 +61,7 @@ public:
 
 	CMemLogger();
 	virtual ~CMemLogger();
-	bool Init( ULONG ulCacheTime);
+	bool Init( ULONG ulCacheTime, ULONG ulSlots=MEM_LOGGER_DEFAULT_SLOTS);
 	string GetCacheString();
 
 	virtual bool IsIgnored( int nComponent, int nEvent);
@@ -70,10 +74,21 @@ public:
 
 protected:
 
-	typedef std::list<CLogMsg>      	LogMsgList;
-	LogMsgList                      	m_CircularBuffer;
+	static ULONG GetTimeNow();
+	bool AllocateSlots( ULONG ulSlots);
+
+	CLogSlot*                           m_pSlots;
+	ULONG                               m_ulSlots;
+	ULONG                               m_ulSlotMask;
+
+	// Monotonic write ticket - claimed by producers with an atomic
+	// increment, never reset while the logger is registered.
+	volatile LONG                       m_lWriteTicket;
 
 	ULONG                           	m_ulCacheTime;
+
+	// Serializes readers (GetCacheString) and Init only - producers
+	// never take this lock.
 	DIOMEDE_CRITICAL::CCriticalSection	m_lock;
 };
 
@@ -17,6 +17,9 @@
 //! \defgroup message_timer MessageTimer Methods
 //! @{
 #include "MessageTimer.h"
+#include "FormatBuffer.h"
+
+#include <string.h>
 
 ///////////////////////////////////////////////////////////////////////
 //! \brief Constructor  - default constructor.
@@ -143,26 +146,44 @@ bool MessageTimer::CheckPaused()
 //!                      max line length.
 void MessageTimer::PrintText(const std::string& szTimerText, int nTruncatePos /*0*/)
 {
-    std::string szPad = _T("");
+    PrintText(szTimerText.c_str(), (int)szTimerText.length(), nTruncatePos);
 
-    std::string szTempTimerText = szTimerText;
-    int nNewLength = (int)szTimerText.length();
+} // End PrintText
 
-    if ( (nTruncatePos > 0) && (nNewLength > MAX_LINE_LEN + 1) ) {
+///////////////////////////////////////////////////////////////////////
+//! \brief As above, for text already formatted into a buffer - the
+//!        truncated line and padding are written directly, without
+//!        building intermediate strings.
+//! \param szTimerText: text to output
+//! \param nLength: length of the text
+//! \param nTruncatePos: where the text can be truncated if it exceed o
+//!                      max line length.
+void MessageTimer::PrintText(const char* szTimerText, int nLength, int nTruncatePos /*0*/)
+{
+    // Text up to nHeadLength, then the text from nTailPos.
+    int nHeadLength = nLength;
+    int nTailPos = nLength;
+    int nPad = 0;
+
+    if ( (nTruncatePos > 0) && (nTruncatePos <= nLength) && (nLength > MAX_LINE_LEN + 1) ) {
         // Truncate the line left of the truncate position - which assumes
         // we want to keep the right most portion of the string.
-        int nDiffLength = nTruncatePos - (nNewLength - (MAX_LINE_LEN + 1));
-        szTempTimerText = szTimerText.substr(0, nDiffLength) + szTimerText.substr(nTruncatePos);
-
+        nHeadLength = nTruncatePos - (nLength - (MAX_LINE_LEN + 1));
+        if (nHeadLength < 0) {
+            nHeadLength = 0;
+        }
+        nTailPos = nTruncatePos;
     }
-    else if (nNewLength < m_nTextLength) {
-        szPad = GetPadStr(m_nTextLength - nNewLength );
+    else if (nLength < m_nTextLength) {
+        nPad = m_nTextLength - nLength;
     }
-    _tprintf(_T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
-    m_nTextLength = nNewLength;
+
+    _tprintf(_T("%.*s%s%*s"), nHeadLength, szTimerText, szTimerText + nTailPos, nPad, _T(""));
+    m_nTextLength = nLength;
 
     if (m_bConfigLogProgress) {
-        ClientLog(UI_COMP, LOG_STATUS, false, _T("%s%s"), szTempTimerText.c_str(), szPad.c_str());
+        ClientLog(UI_COMP, LOG_STATUS, false, _T("%.*s%s%*s"), nHeadLength, szTimerText,
+                  szTimerText + nTailPos, nPad, _T(""));
     }
 
 } // End PrintText
@@ -186,52 +207,47 @@ void MessageTimer::OutputEndStatus(time_duration elapsedTime,
         return;
     }
 
-    std::string szDuration = _T("");
-    std::string szDurationType = _T("");
-    std::string szTimerText = _T("");
+    FixedFormatBuffer<32> szDuration;
+    const char* szDurationType = _T("");
+    FixedFormatBuffer<MAX_TIMER_TEXT> szTimerText;
 
     FormatDuration(elapsedTime, szDuration, szDurationType, 3);
 
+    szTimerText << _T('\r') << m_szStartText;
+
     switch (endTimerType) {
-        case useSingleLine:
-            szTimerText = _format(_T("\r%s...Done: %s %s" ), m_szStartText.c_str(),
-                szDuration.c_str(), szDurationType.c_str());
-            break;
         case useNewLine:
-            szTimerText = _format(_T("\r%s...\n\r   Done: %s %s" ), m_szStartText.c_str(),
-                szDuration.c_str(), szDurationType.c_str());
+            szTimerText << _T("...\n\r   Done: ") << szDuration << _T(' ') << szDurationType;
             break;
         case useSingleLongLine:
-            {
-                // Format the line to fill the 79 columns, formatting so the "done"
-                // portion lines ups.  10 spaces are needed for the line
-                // spacing and "...Done:"
-                std::string szPad = GetPadStr(MAX_LINE_LEN - (int)m_szStartText.length() -
-                    (int)szDuration.length() - (int)szDurationType.length() - 10);
-                szTimerText = _format(_T("\r%s%s...Done: %s %s" ), m_szStartText.c_str(),
-                    szPad.c_str(), szDuration.c_str(), szDurationType.c_str());
-            }
+            // Format the line to fill the 79 columns, formatting so the "done"
+            // portion lines ups.  10 spaces are needed for the line
+            // spacing and "...Done:"
+            szTimerText.AppendRepeat(_T(' '), MAX_LINE_LEN - (int)m_szStartText.length() -
+                (int)szDuration.length() - (int)strlen(szDurationType) - 10);
+            szTimerText << _T("...Done: ") << szDuration << _T(' ') << szDurationType;
             break;
         case useNoTimeOrDone:
-            szTimerText = _format(_T("\r%s... " ), m_szStartText.c_str());
+            szTimerText << _T("... ");
             break;
         case useSessionExpired:
-            szTimerText = _format(_T("\r%s...session expired." ), m_szStartText.c_str());
+            szTimerText << _T("...session expired.");
             break;
         case useNetworkConnectionError:
-            szTimerText = _format(_T("\r%s...connection dropped." ), m_szStartText.c_str());
+            szTimerText << _T("...connection dropped.");
             break;
         case useGenericServiceError:
-            szTimerText = _format(_T("\r%s...an unknown error has occurred." ), m_szStartText.c_str());
+            szTimerText << _T("...an unknown error has occurred.");
             break;
+        case useSingleLine:
         default:
-            szTimerText = _format(_T("\r%s...Done: %s %s" ), m_szStartText.c_str(),
-                szDuration.c_str(), szDurationType.c_str());
+            szTimerText << _T("...Done: ") << szDuration << _T(' ') << szDurationType;
             break;
     }
 
-    int nTruncatePos = (int)szTimerText.find(_T("..."));
-    PrintText(szTimerText, nTruncatePos);
+    const char* pTruncate = strstr(szTimerText.c_str(), _T("..."));
+    int nTruncatePos = (pTruncate == NULL) ? -1 : (int)(pTruncate - szTimerText.c_str());
+    PrintText(szTimerText.c_str(), (int)szTimerText.length(), nTruncatePos);
 
     if (bAfterNewLine) {
         _tprintf(_T("\n\r"));
@@ -239,8 +255,9 @@ void MessageTimer::OutputEndStatus(time_duration elapsedTime,
     }
 
     if ( szOutputText.length() > 0 ) {
-        szTimerText = _format(_T("   %s\n\r"), szOutputText.c_str());
-        PrintText(szTimerText);
+        szTimerText.Reset();
+        szTimerText << _T("   ") << szOutputText << _T("\n\r");
+        PrintText(szTimerText.c_str(), (int)szTimerText.length());
     }
 
 } // End OutputEndStatus
@@ -357,7 +374,18 @@ void MessageTimer::Continue(std::string szOutputText)
 ///////////////////////////////////////////////////////////////////////
 //! \brief Continue timing showing the time duration
 //! \param szOutputText: optional timer output text.
-void MessageTimer::ContinueTime(std::string szOutputText /*_T("")*/)
+void MessageTimer::ContinueTime(const std::string& szOutputText /*_T("")*/)
+{
+    ContinueTime(szOutputText.c_str());
+
+} // End ContinueTime
+
+///////////////////////////////////////////////////////////////////////
+//! \brief Continue timing showing the time duration.  Called for each
+//!        progress callback - the duration is only formatted when the
+//!        wait period has passed, and is formatted without allocating.
+//! \param szOutputText: optional timer output text.
+void MessageTimer::ContinueTime(const char* szOutputText)
 {
     if (CheckStart() == false) {
         return;
@@ -371,32 +399,28 @@ void MessageTimer::ContinueTime(std::string szOutputText /*_T("")*/)
 
     m_mutex.Lock();
 
-    if (szOutputText.length() > 0) {
-        m_szStartText = szOutputText;
+    if ( (szOutputText != NULL) && (szOutputText[0] != '\0') ) {
+        m_szStartText.assign(szOutputText);
     }
 
     ptime tmNow = microsec_clock::local_time();
     time_duration elapsedTime = tmNow - m_tmLastStart;
 
-    time_duration totalElapsedTime = microsec_clock::local_time() - m_tmFirstStart + m_totalElapsedTime;
-
-    // Uncomment for debugging...
-    // double dblMicroseconds = static_cast<double>(totalElapsedTime.fractional_seconds());
-    // double dblMilliseconds = static_cast<double>(dblMicroseconds / m_l64Adjust);
-    // double dblSeconds =  static_cast<double>(totalElapsedTime.seconds()) + dblMilliseconds;
+    if (elapsedTime.total_milliseconds() >= m_nWaitPeriod) {
 
-    std::string szDuration = _T("");
-    std::string szDurationType = _T("");
+        if (m_bShowProgress) {
+            time_duration totalElapsedTime = tmNow - m_tmFirstStart + m_totalElapsedTime;
 
-    FormatDuration(totalElapsedTime, szDuration, szDurationType);
+            FixedFormatBuffer<MAX_TIMER_TEXT> szTimerText;
+            const char* szDurationType = _T("");
 
-    if (elapsedTime.total_milliseconds() >= m_nWaitPeriod) {
+            szTimerText << _T('\r') << m_szStartText << _T("... ");
+            FormatDuration(totalElapsedTime, szTimerText, szDurationType);
+            szTimerText << _T(' ') << szDurationType;
 
-        if (m_bShowProgress) {
-            std::string szTimerText = _format(_T("\r%s... %s %s"), m_szStartText.c_str(),
-                szDuration.c_str(), szDurationType.c_str());
-            int nTruncatePos = (int)szTimerText.find(_T("..."));
-            PrintText(szTimerText, nTruncatePos);
+            const char* pTruncate = strstr(szTimerText.c_str(), _T("..."));
+            int nTruncatePos = (pTruncate == NULL) ? -1 : (int)(pTruncate - szTimerText.c_str());
+            PrintText(szTimerText.c_str(), (int)szTimerText.length(), nTruncatePos);
         }
 
         m_tmLastStart = tmNow;
@@ -406,6 +430,43 @@ void MessageTimer::ContinueTime(std::string szOutputText /*_T("")*/)
 
 } // End ContinueTime
 
+///////////////////////////////////////////////////////////////////////
+//! \brief Show the progress text following the start text, with the
+//!        time duration.  Unlike ContinueTime, the start text is not
+//!        changed and a paused timer is left paused.
+//! \param szProgressText: progress text (e.g. 45% 1.20 MB/s)
+void MessageTimer::ShowProgress(const char* szProgressText)
+{
+    m_mutex.Lock();
+
+    if ( (CheckStart() == false) || (CheckPaused() == true) || (m_bShowProgress == false) ) {
+        m_mutex.Unlock();
+        return;
+    }
+
+    ptime tmNow = microsec_clock::local_time();
+    time_duration totalElapsedTime = tmNow - m_tmFirstStart + m_totalElapsedTime;
+
+    FixedFormatBuffer<MAX_TIMER_TEXT> szTimerText;
+    const char* szDurationType = _T("");
+
+    szTimerText << _T('\r') << m_szStartText << _T("... ");
+    if ( (szProgressText != NULL) && (szProgressText[0] != '\0') ) {
+        szTimerText << szProgressText << _T(' ');
+    }
+    FormatDuration(totalElapsedTime, szTimerText, szDurationType);
+    szTimerText << _T(' ') << szDurationType;
+
+    const char* pTruncate = strstr(szTimerText.c_str(), _T("..."));
+    int nTruncatePos = (pTruncate == NULL) ? -1 : (int)(pTruncate - szTimerText.c_str());
+    PrintText(szTimerText.c_str(), (int)szTimerText.length(), nTruncatePos);
+
+    m_tmLastStart = tmNow;
+
+    m_mutex.Unlock();
+
+} // End ShowProgress
+
 ///////////////////////////////////////////////////////////////////////
 //! \brief End the timing period, returning the elapsed time
 //! \return Returns the total elapsed time.
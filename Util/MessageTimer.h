@@ -42,6 +42,7 @@ const char* const resolution_names[] =
 
 static const int MAX_STATUS_LEN = 33;
 static const int MAX_LINE_LEN   = 79;
+static const int MAX_TIMER_TEXT = 1024;             // Formatted timer text (matches _format)
 
 ///////////////////////////////////////////////////////////////////////
 namespace EndTimerTypes {
@@ -120,6 +121,7 @@ private:
     // doesn't extend beyond the new line.
     //-----------------------------------------------------------------
 	void PrintText(const std::string& szTimerText, int nTruncatePos=0);
+	void PrintText(const char* szTimerText, int nLength, int nTruncatePos=0);
 
     //-----------------------------------------------------------------
     // Helper to output the "done" status text.
@@ -165,7 +167,15 @@ public:
     //-----------------------------------------------------------------
     // Continue timing showing the time duration
     //-----------------------------------------------------------------
-    void ContinueTime(std::string szOutputText=_T(""));
+    void ContinueTime(const std::string& szOutputText=_T(""));
+    void ContinueTime(const char* szOutputText);
+
+    //-----------------------------------------------------------------
+    // Show progress text (e.g. percent, rate) after the start text,
+    // followed by the time duration - used by the ProgressRenderer.
+    // Nothing is shown if the timer is stopped or paused.
+    //-----------------------------------------------------------------
+    void ShowProgress(const char* szProgressText);
 
     //-----------------------------------------------------------------
     // Simple end of the timing period, returning the elapsed time
@@ -0,0 +1,284 @@
+/*********************************************************************
+ *
+ *  file:  ProgressRenderer.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Draws transfer progress from a background thread at a
+ *          fixed refresh rate.
+ *
+ *********************************************************************/
+
+#include "Stdafx.h"
+#include "ProgressRenderer.h"
+#include "MessageTimer.h"
+#include "FormatBuffer.h"
+#include "StringUtil.h"
+#include "Thread.h"
+
+using namespace boost::posix_time;
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+//---------------------------------------------------------------------
+// Atomic helpers for the counters updated by the transfer callbacks.
+//---------------------------------------------------------------------
+#ifdef WIN32
+    #define PROGRESS_ATOMIC_SET(p, l64Value)    InterlockedExchange64((volatile LONGLONG*)(p), l64Value)
+    #define PROGRESS_ATOMIC_GET(p)              InterlockedCompareExchange64((volatile LONGLONG*)(p), 0, 0)
+#else
+    #define PROGRESS_ATOMIC_SET(p, l64Value)    __sync_lock_test_and_set(p, l64Value)
+    #define PROGRESS_ATOMIC_GET(p)              __sync_fetch_and_add(p, 0)
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// Interval driven thread used to redraw the progress.
+class ProgressRenderThread : public CThread
+{
+public:
+    ProgressRenderThread(ProgressRenderer* pRenderer) : m_pRenderer(pRenderer) {}
+    virtual ~ProgressRenderThread() {}
+
+    // Called when a time interval has elapsed.
+	virtual BOOL OnTask() {
+	    m_pRenderer->Render();
+	    return TRUE;
+	}
+
+private:
+    ProgressRenderer*   m_pRenderer;
+};
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Constructor
+// Requires:
+//      ulRefreshInterval: milliseconds between redraws.
+// Returns: nothing
+ProgressRenderer::ProgressRenderer(unsigned long ulRefreshInterval /*PROGRESS_REFRESH_INTERVAL*/)
+    : m_pRenderThread(NULL), m_ulRefreshInterval(ulRefreshInterval),
+      m_l64FileBytes(0), m_l64FileSize(0), m_pTimer(NULL), m_l64FileStartBytes(0),
+      m_l64SessionBytes(0), m_tmLastSample(not_a_date_time),
+      m_l64LastSampleBytes(0), m_dblRate(0)
+{
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Destructor - stops the render thread.
+// Requires: nothing
+// Returns: nothing
+ProgressRenderer::~ProgressRenderer()
+{
+    EndFile();
+    StopRenderThread();
+
+} // End destructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Stop and delete the render thread.  Must not be called
+//          with m_lock held - the thread may be waiting for it.
+// Requires: nothing
+// Returns: nothing
+void ProgressRenderer::StopRenderThread()
+{
+    if (m_pRenderThread) {
+        m_pRenderThread->Stop();
+        delete m_pRenderThread;
+        m_pRenderThread = NULL;
+    }
+
+} // End StopRenderThread
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Reset the session totals.
+// Requires: nothing
+// Returns: nothing
+void ProgressRenderer::BeginSession()
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    m_l64SessionBytes = 0;
+    m_tmLastSample = not_a_date_time;
+    m_l64LastSampleBytes = 0;
+    m_dblRate = 0;
+
+} // End BeginSession
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Start drawing the progress of a file.
+// Requires:
+//      pTimer: started timer - its start text leads the progress line.
+//      l64FileSize: size of the file, 0 if not yet known.
+//      l64StartBytes: bytes already transferred (resume).
+// Returns: true if successful, false if the render thread could not
+//          be created.
+bool ProgressRenderer::BeginFile(MessageTimer* pTimer, LONG64 l64FileSize,
+                                 LONG64 l64StartBytes /*0*/)
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if (m_pRenderThread == NULL) {
+        m_pRenderThread = new ProgressRenderThread(this);
+        if (m_pRenderThread->GetErrorFlags() != NO_ERRORS) {
+            delete m_pRenderThread;
+            m_pRenderThread = NULL;
+            return false;
+        }
+        m_pRenderThread->SetThreadType(ThreadTypeIntervalDriven, m_ulRefreshInterval);
+    }
+
+    // Bytes from the previous file are only counted once.
+    if (m_pTimer != NULL) {
+        m_l64SessionBytes = GetSessionBytes(PROGRESS_ATOMIC_GET(&m_l64FileBytes));
+    }
+
+    PROGRESS_ATOMIC_SET(&m_l64FileBytes, l64StartBytes);
+    PROGRESS_ATOMIC_SET(&m_l64FileSize, l64FileSize);
+    m_l64FileStartBytes = l64StartBytes;
+    m_pTimer = pTimer;
+
+    return true;
+
+} // End BeginFile
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Stop drawing the current file, adding its bytes to the
+//          session totals.
+// Requires: nothing
+// Returns: nothing
+void ProgressRenderer::EndFile()
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if (m_pTimer == NULL) {
+        return;
+    }
+
+    m_l64SessionBytes = GetSessionBytes(PROGRESS_ATOMIC_GET(&m_l64FileBytes));
+
+    PROGRESS_ATOMIC_SET(&m_l64FileBytes, 0);
+    PROGRESS_ATOMIC_SET(&m_l64FileSize, 0);
+    m_l64FileStartBytes = 0;
+    m_pTimer = NULL;
+
+} // End EndFile
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Update the bytes transferred for the current file.
+// Requires:
+//      l64CurrentBytes: total bytes of the file transferred so far.
+// Returns: nothing
+void ProgressRenderer::UpdateBytes(LONG64 l64CurrentBytes)
+{
+    PROGRESS_ATOMIC_SET(&m_l64FileBytes, l64CurrentBytes);
+
+} // End UpdateBytes
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Update the size of the current file (e.g. downloads, where
+//          the size is known once the transfer has started).
+// Requires:
+//      l64FileSize: file size
+// Returns: nothing
+void ProgressRenderer::UpdateFileSize(LONG64 l64FileSize)
+{
+    PROGRESS_ATOMIC_SET(&m_l64FileSize, l64FileSize);
+
+} // End UpdateFileSize
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Bytes transferred during the session, including the
+//          current file.  Requires m_lock.
+// Requires:
+//      l64FileBytes: current file bytes.
+// Returns: session bytes.
+LONG64 ProgressRenderer::GetSessionBytes(LONG64 l64FileBytes)
+{
+    LONG64 l64Bytes = m_l64SessionBytes;
+    if (l64FileBytes > m_l64FileStartBytes) {
+        l64Bytes += l64FileBytes - m_l64FileStartBytes;
+    }
+    return l64Bytes;
+
+} // End GetSessionBytes
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Redraw the progress of the current file - called from
+//          the render thread.
+// Requires: nothing
+// Returns: nothing
+void ProgressRenderer::Render()
+{
+    Lock<CCriticalSection> lock(m_lock);
+
+    if (m_pTimer == NULL) {
+        return;
+    }
+
+    LONG64 l64FileBytes = PROGRESS_ATOMIC_GET(&m_l64FileBytes);
+    LONG64 l64FileSize = PROGRESS_ATOMIC_GET(&m_l64FileSize);
+
+    //-----------------------------------------------------------------
+    // Throughput is smoothed across samples (and files) so the rate
+    // does not jump with each chunk.
+    //-----------------------------------------------------------------
+    ptime tmNow = microsec_clock::local_time();
+    LONG64 l64SessionBytes = GetSessionBytes(l64FileBytes);
+
+    if (m_tmLastSample.is_not_a_date_time() == false) {
+        LONG64 l64Milliseconds = (tmNow - m_tmLastSample).total_milliseconds();
+        if (l64Milliseconds > 0) {
+            double dblSample = (double)(l64SessionBytes - m_l64LastSampleBytes) * 1000 /
+                               (double)l64Milliseconds;
+            if (m_dblRate <= 0) {
+                m_dblRate = dblSample;
+            }
+            else {
+                m_dblRate = (PROGRESS_RATE_WEIGHT * dblSample) +
+                            ((1 - PROGRESS_RATE_WEIGHT) * m_dblRate);
+            }
+        }
+    }
+
+    m_tmLastSample = tmNow;
+    m_l64LastSampleBytes = l64SessionBytes;
+
+    //-----------------------------------------------------------------
+    // nn% rate ETA h:mm:ss
+    //-----------------------------------------------------------------
+    FixedFormatBuffer<128> szProgress;
+
+    if (l64FileSize > 0) {
+        int nPercent = (l64FileBytes >= l64FileSize) ? 100 :
+            (int)(((double)l64FileBytes / (double)l64FileSize) * 100);
+        szProgress << nPercent << _T('%');
+    }
+
+    if (m_dblRate >= 1) {
+        const char* szRateType = _T("");
+
+        szProgress << _T(' ');
+        StringUtil::FormatByteSize((LONG64)m_dblRate, szProgress, szRateType);
+        szProgress << _T(' ') << szRateType << _T("/s");
+
+        if (l64FileSize > l64FileBytes) {
+            LONG64 l64Seconds = (LONG64)(((double)(l64FileSize - l64FileBytes) / m_dblRate) + 0.5);
+
+            szProgress << _T(" ETA ");
+            if (l64Seconds >= 3600) {
+                szProgress.AppendInt(l64Seconds / 3600).Append(_T(':'));
+                szProgress.AppendInt((l64Seconds / 60) % 60, 2);
+            }
+            else {
+                szProgress.AppendInt(l64Seconds / 60);
+            }
+            szProgress.Append(_T(':')).AppendInt(l64Seconds % 60, 2);
+        }
+    }
+
+    m_pTimer->ShowProgress(szProgress.c_str());
+
+} // End Render
@@ -0,0 +1,121 @@
+/*********************************************************************
+ *
+ *  file:  ProgressRenderer.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Draws transfer progress from a background thread at a
+ *          fixed refresh rate.  Transfer callbacks only update
+ *          counters - no locking, formatting or output occurs on
+ *          the transfer path.
+ *
+ *********************************************************************/
+
+#ifndef __PROGRESS_RENDERER_H__
+#define __PROGRESS_RENDERER_H__
+
+#include "Stdafx.h"
+#include "types.h"
+#include "CriticalSection.h"
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+class MessageTimer;
+class ProgressRenderThread;
+
+//---------------------------------------------------------------------
+// Refresh interval (milliseconds) and the weight given to the most
+// recent throughput sample.
+//---------------------------------------------------------------------
+#define PROGRESS_REFRESH_INTERVAL       250
+#define PROGRESS_RATE_WEIGHT            0.3
+
+///////////////////////////////////////////////////////////////////////
+// ProgressRenderer Class
+//
+// Usage:
+//      msgTimer.Start(szFileLabel);
+//      renderer.BeginFile(&msgTimer, l64FileSize, l64ResumeBytes);
+//
+//      // Transfer callback:
+//      renderer.UpdateBytes(l64CurrentBytes);
+//
+//      renderer.EndFile();
+//      msgTimer.EndTime(...);
+//
+// Each refresh, the timer's start text is followed by the percent
+// complete, the throughput across all files of the session and the
+// estimated time remaining for the current file, e.g.
+//      test.doc (12.50 MB)... 45% 1.21 MB/s ETA 0:06 3.2 seconds
+
+class ProgressRenderer
+{
+private:
+    ProgressRenderThread*       m_pRenderThread;
+    unsigned long               m_ulRefreshInterval;
+
+    //-----------------------------------------------------------------
+    // Written by the transfer callbacks - atomic access only.
+    //-----------------------------------------------------------------
+    volatile LONG64             m_l64FileBytes;
+    volatile LONG64             m_l64FileSize;
+
+    //-----------------------------------------------------------------
+    // Guarded by m_lock - changed once per file and by the renderer.
+    //-----------------------------------------------------------------
+    MessageTimer*               m_pTimer;
+    LONG64                      m_l64FileStartBytes;        // Non-zero on resume
+
+    LONG64                      m_l64SessionBytes;          // Transferred, prior files
+    boost::posix_time::ptime    m_tmLastSample;
+    LONG64                      m_l64LastSampleBytes;
+    double                      m_dblRate;                  // Bytes per second
+
+    DIOMEDE_CRITICAL::CCriticalSection  m_lock;
+
+public:
+    ProgressRenderer(unsigned long ulRefreshInterval=PROGRESS_REFRESH_INTERVAL);
+    virtual ~ProgressRenderer();
+
+    //-----------------------------------------------------------------
+    // Reset the session totals (e.g. at the start of a command).
+    //-----------------------------------------------------------------
+    void BeginSession();
+
+    //-----------------------------------------------------------------
+    // Start drawing the progress of a file to the given (started)
+    // timer.  The render thread is created on first use.
+    //-----------------------------------------------------------------
+    bool BeginFile(MessageTimer* pTimer, LONG64 l64FileSize, LONG64 l64StartBytes=0);
+
+    //-----------------------------------------------------------------
+    // Stop drawing - once this returns, the timer is no longer used.
+    // Safe to call when no file is in progress.
+    //-----------------------------------------------------------------
+    void EndFile();
+
+    //-----------------------------------------------------------------
+    // Transfer callback path - atomic updates only.
+    //-----------------------------------------------------------------
+    void UpdateBytes(LONG64 l64CurrentBytes);
+    void UpdateFileSize(LONG64 l64FileSize);
+
+    //-----------------------------------------------------------------
+    // Called from the render thread each refresh interval.
+    //-----------------------------------------------------------------
+    void Render();
+
+private:
+    // Not implemented
+    ProgressRenderer(const ProgressRenderer&);
+    ProgressRenderer& operator=(const ProgressRenderer&);
+
+    void StopRenderThread();
+    LONG64 GetSessionBytes(LONG64 l64FileBytes);
+};
+
+#endif // __PROGRESS_RENDERER_H__
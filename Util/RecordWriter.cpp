@@ -0,0 +1,524 @@
+/*********************************************************************
+ *
+ *  file:  RecordWriter.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Buffered writer for machine readable command output -
+ *          tab separated values or JSON lines.
+ *
+ *********************************************************************/
+
+#include "RecordWriter.h"
+
+#include <string.h>
+
+using namespace RecordWriterTypes;
+
+//---------------------------------------------------------------------
+// Largest number of bytes a single escaped character, separator or
+// number can add to the buffer.
+//---------------------------------------------------------------------
+#define RECORD_WRITER_MAX_TOKEN     32
+
+static const char s_szHexDigits[] = "0123456789abcdef";
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Constructor
+// Requires:
+//      pFile: output stream, typically stdout.
+//      nFormat: RecordFormatType
+// Returns: nothing
+RecordWriter::RecordWriter(FILE* pFile, int nFormat)
+    : m_pFile(pFile), m_nFormat(nFormat), m_pszColumns(NULL), m_nColumns(0),
+      m_nField(0), m_bHeaderWritten(false), m_nBufferLen(0)
+{
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Destructor - writes out any remaining output.
+// Requires: nothing
+// Returns: nothing
+RecordWriter::~RecordWriter()
+{
+    Flush();
+
+} // End destructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Convert the /format argument value to a RecordFormatType.
+// Requires:
+//      szFormat: tsv or jsonl (case insensitive)
+// Returns: RecordFormatType, recordFormatInvalid if the format
+//          is not recognized.
+int RecordWriter::ParseFormat(const std::string& szFormat)
+{
+    if (0 == _stricmp(szFormat.c_str(), _T("tsv"))) {
+        return recordFormatTSV;
+    }
+    if ( (0 == _stricmp(szFormat.c_str(), _T("jsonl"))) ||
+         (0 == _stricmp(szFormat.c_str(), _T("json"))) ) {
+        return recordFormatJSONL;
+    }
+
+    return recordFormatInvalid;
+
+} // End ParseFormat
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Set the column names for the records that follow.  The
+//          names are not copied and must remain valid.
+// Requires:
+//      pszColumns: array of column names
+//      nColumns: number of column names
+// Returns: nothing
+void RecordWriter::SetColumns(const char* const* pszColumns, int nColumns)
+{
+    m_pszColumns = pszColumns;
+    m_nColumns = nColumns;
+    m_bHeaderWritten = false;
+
+} // End SetColumns
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Start a new record.  For TSV, the header line is written
+//          before the first record.
+// Requires: nothing
+// Returns: nothing
+void RecordWriter::BeginRecord()
+{
+    if ( (m_nFormat == recordFormatTSV) && (m_bHeaderWritten == false) ) {
+        WriteHeader();
+    }
+
+    m_bHeaderWritten = true;
+    m_nField = 0;
+
+    if (m_nFormat == recordFormatJSONL) {
+        Reserve(1);
+        Put('{');
+    }
+
+} // End BeginRecord
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: End the current record.
+// Requires: nothing
+// Returns: nothing
+void RecordWriter::EndRecord()
+{
+    Reserve(2);
+
+    if (m_nFormat == recordFormatJSONL) {
+        Put('}');
+    }
+    Put('\n');
+
+} // End EndRecord
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add a string field.
+// Requires:
+//      szValue: field value, NULL is written as a null value.
+// Returns: nothing
+void RecordWriter::AddString(const char* szValue)
+{
+    if (szValue == NULL) {
+        AddNull();
+        return;
+    }
+
+    BeginField(true);
+    PutEscaped(szValue, strlen(szValue));
+    EndField(true);
+
+} // End AddString
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add a string field.
+// Requires:
+//      szValue: field value
+// Returns: nothing
+void RecordWriter::AddString(const std::string& szValue)
+{
+    BeginField(true);
+    PutEscaped(szValue.data(), szValue.length());
+    EndField(true);
+
+} // End AddString
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add an integer field.
+// Requires:
+//      l64Value: field value
+// Returns: nothing
+void RecordWriter::AddInt64(LONG64 l64Value)
+{
+    BeginField(false);
+    Reserve(RECORD_WRITER_MAX_TOKEN);
+    PutDigits(l64Value);
+    EndField(false);
+
+} // End AddInt64
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add a boolean field, written as true or false.
+// Requires:
+//      bValue: field value
+// Returns: nothing
+void RecordWriter::AddBool(bool bValue)
+{
+    BeginField(false);
+    Reserve(5);
+
+    const char* szValue = bValue ? _T("true") : _T("false");
+    while (*szValue) {
+        Put(*szValue++);
+    }
+
+    EndField(false);
+
+} // End AddBool
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add a date field as UTC ISO 8601 (2010-01-31T23:59:59Z).
+//          The conversion is done here rather than with strftime
+//          to avoid the locale and allocation costs per row.
+// Requires:
+//      tmValue: seconds since the epoch, 0 is written as a null value.
+// Returns: nothing
+void RecordWriter::AddDateTime(time_t tmValue)
+{
+    if (tmValue == 0) {
+        AddNull();
+        return;
+    }
+
+    LONG64 l64Seconds = (LONG64)tmValue;
+    LONG64 l64Days = l64Seconds / 86400;
+    LONG64 l64SecondOfDay = l64Seconds % 86400;
+    if (l64SecondOfDay < 0) {
+        l64SecondOfDay += 86400;
+        l64Days --;
+    }
+
+    // Days since the epoch to year, month, day in the proleptic
+    // Gregorian calendar - eras are 400 year periods starting March 1.
+    LONG64 l64Z = l64Days + 719468;
+    LONG64 l64Era = (l64Z >= 0 ? l64Z : l64Z - 146096) / 146097;
+    LONG64 l64DayOfEra = l64Z - (l64Era * 146097);
+    LONG64 l64YearOfEra = (l64DayOfEra - (l64DayOfEra / 1460) + (l64DayOfEra / 36524)
+                           - (l64DayOfEra / 146096)) / 365;
+    LONG64 l64DayOfYear = l64DayOfEra - ((365 * l64YearOfEra) + (l64YearOfEra / 4)
+                           - (l64YearOfEra / 100));
+    LONG64 l64MonthIndex = ((5 * l64DayOfYear) + 2) / 153;
+
+    LONG64 l64Day = l64DayOfYear - (((153 * l64MonthIndex) + 2) / 5) + 1;
+    LONG64 l64Month = (l64MonthIndex < 10) ? l64MonthIndex + 3 : l64MonthIndex - 9;
+    LONG64 l64Year = l64YearOfEra + (l64Era * 400) + ((l64Month <= 2) ? 1 : 0);
+
+    BeginField(true);
+    Reserve(RECORD_WRITER_MAX_TOKEN);
+
+    PutDigits(l64Year, 4);
+    Put('-');
+    PutDigits(l64Month, 2);
+    Put('-');
+    PutDigits(l64Day, 2);
+    Put('T');
+    PutDigits(l64SecondOfDay / 3600, 2);
+    Put(':');
+    PutDigits((l64SecondOfDay / 60) % 60, 2);
+    Put(':');
+    PutDigits(l64SecondOfDay % 60, 2);
+    Put('Z');
+
+    EndField(true);
+
+} // End AddDateTime
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add a monetary amount.  The service sends amounts as
+//          integers scaled by 10^nPrecision, e.g. 91400 with a
+//          precision of 4 is written as 9.1400
+// Requires:
+//      l64Amount: scaled amount
+//      nPrecision: number of decimal digits (0 to 9)
+// Returns: nothing
+void RecordWriter::AddAmount(LONG64 l64Amount, int nPrecision)
+{
+    if (nPrecision < 0) {
+        nPrecision = 0;
+    }
+    else if (nPrecision > 9) {
+        nPrecision = 9;
+    }
+
+    LONG64 l64Scale = 1;
+    for (int nIndex = 0; nIndex < nPrecision; nIndex++) {
+        l64Scale *= 10;
+    }
+
+    bool bNegative = (l64Amount < 0);
+    if (bNegative) {
+        l64Amount = -l64Amount;
+    }
+
+    BeginField(false);
+    Reserve(RECORD_WRITER_MAX_TOKEN);
+
+    if (bNegative) {
+        Put('-');
+    }
+
+    PutDigits(l64Amount / l64Scale);
+    if (nPrecision > 0) {
+        Put('.');
+        PutDigits(l64Amount % l64Scale, nPrecision);
+    }
+
+    EndField(false);
+
+} // End AddAmount
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add an empty field - null for JSON lines.
+// Requires: nothing
+// Returns: nothing
+void RecordWriter::AddNull()
+{
+    BeginField(false);
+
+    if (m_nFormat == recordFormatJSONL) {
+        Reserve(4);
+        Put('n');
+        Put('u');
+        Put('l');
+        Put('l');
+    }
+
+    EndField(false);
+
+} // End AddNull
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Finish the output - for TSV, the header line is written
+//          even if there were no records.
+// Requires: nothing
+// Returns: true if successful, false otherwise.
+bool RecordWriter::Finish()
+{
+    if ( (m_nFormat == recordFormatTSV) && (m_bHeaderWritten == false) ) {
+        WriteHeader();
+        m_bHeaderWritten = true;
+    }
+
+    return Flush();
+
+} // End Finish
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Write the buffered output to the stream.
+// Requires: nothing
+// Returns: true if successful, false otherwise.
+bool RecordWriter::Flush()
+{
+    bool bReturn = true;
+
+    if ( (m_nBufferLen > 0) && (m_pFile != NULL) ) {
+        size_t nWritten = fwrite(m_szBuffer, 1, m_nBufferLen, m_pFile);
+        bReturn = (nWritten == (size_t)m_nBufferLen);
+    }
+
+    m_nBufferLen = 0;
+
+    if (m_pFile != NULL) {
+        fflush(m_pFile);
+    }
+
+    return bReturn;
+
+} // End Flush
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Make sure there's room for the given number of bytes,
+//          writing out the buffer if needed.
+// Requires:
+//      nBytes: number of bytes needed - no more than
+//              RECORD_WRITER_BUFFER_SIZE.
+// Returns: nothing
+void RecordWriter::Reserve(int nBytes)
+{
+    if ( (m_nBufferLen + nBytes) > RECORD_WRITER_BUFFER_SIZE) {
+        Flush();
+    }
+
+} // End Reserve
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Write the field separator, and for JSON lines, the key.
+// Requires:
+//      bQuoted: true if the value is a JSON string.
+// Returns: nothing
+void RecordWriter::BeginField(bool bQuoted)
+{
+    if (m_nFormat == recordFormatJSONL) {
+        const char* szName = _T("");
+        if ( (m_pszColumns != NULL) && (m_nField < m_nColumns) ) {
+            szName = m_pszColumns[m_nField];
+        }
+
+        Reserve(RECORD_WRITER_MAX_TOKEN);
+        if (m_nField > 0) {
+            Put(',');
+        }
+
+        Put('"');
+        PutEscaped(szName, strlen(szName));
+
+        Reserve(3);
+        Put('"');
+        Put(':');
+
+        if (bQuoted) {
+            Put('"');
+        }
+    }
+    else if (m_nField > 0) {
+        Reserve(1);
+        Put('\t');
+    }
+
+    m_nField++;
+
+} // End BeginField
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: End the current field.
+// Requires:
+//      bQuoted: true if the value is a JSON string.
+// Returns: nothing
+void RecordWriter::EndField(bool bQuoted)
+{
+    if ( bQuoted && (m_nFormat == recordFormatJSONL) ) {
+        Reserve(1);
+        Put('"');
+    }
+
+} // End EndField
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Write a string value.  For JSON, quotes, backslashes and
+//          control characters are escaped.  For TSV, tabs, new lines
+//          and backslashes are escaped so that each record is a
+//          single line.
+// Requires:
+//      szValue: value to write
+//      nLength: length of the value
+// Returns: nothing
+void RecordWriter::PutEscaped(const char* szValue, size_t nLength)
+{
+    bool bJSON = (m_nFormat == recordFormatJSONL);
+
+    for (size_t nIndex = 0; nIndex < nLength; nIndex++) {
+        unsigned char cValue = (unsigned char)szValue[nIndex];
+
+        if ( (m_nBufferLen + 6) > RECORD_WRITER_BUFFER_SIZE) {
+            Flush();
+        }
+
+        if ( (cValue >= 0x20) && (cValue != '\\') && ( (cValue != '"') || !bJSON ) ) {
+            Put((char)cValue);
+            continue;
+        }
+
+        Put('\\');
+
+        switch (cValue) {
+            case '\\':
+            case '"':
+                Put((char)cValue);
+                break;
+            case '\t':
+                Put('t');
+                break;
+            case '\n':
+                Put('n');
+                break;
+            case '\r':
+                Put('r');
+                break;
+            default:
+                if (bJSON) {
+                    Put('u');
+                    Put('0');
+                    Put('0');
+                    Put(s_szHexDigits[cValue >> 4]);
+                    Put(s_szHexDigits[cValue & 0x0F]);
+                }
+                else {
+                    // Other control characters are written as is for TSV -
+                    // undo the escape.
+                    m_szBuffer[m_nBufferLen - 1] = (char)cValue;
+                }
+                break;
+        }
+    }
+
+} // End PutEscaped
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Write an integer in decimal.  The caller must reserve
+//          RECORD_WRITER_MAX_TOKEN bytes.
+// Requires:
+//      l64Value: value to write
+//      nMinDigits: zero pad to this number of digits
+// Returns: nothing
+void RecordWriter::PutDigits(LONG64 l64Value, int nMinDigits /*1*/)
+{
+    char szDigits[24];
+    int nDigits = 0;
+
+    ULONG64 ul64Value = (ULONG64)l64Value;
+    if (l64Value < 0) {
+        Put('-');
+        ul64Value = (ULONG64)0 - ul64Value;
+    }
+
+    do {
+        szDigits[nDigits++] = (char)('0' + (int)(ul64Value % 10));
+        ul64Value /= 10;
+    } while ( (ul64Value > 0) && (nDigits < (int)sizeof(szDigits)) );
+
+    while ( (nDigits < nMinDigits) && (nDigits < (int)sizeof(szDigits)) ) {
+        szDigits[nDigits++] = '0';
+    }
+
+    while (nDigits > 0) {
+        Put(szDigits[--nDigits]);
+    }
+
+} // End PutDigits
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Write the TSV header line from the column names.
+// Requires: nothing
+// Returns: nothing
+void RecordWriter::WriteHeader()
+{
+    for (int nIndex = 0; nIndex < m_nColumns; nIndex++) {
+        if (nIndex > 0) {
+            Reserve(1);
+            Put('\t');
+        }
+        PutEscaped(m_pszColumns[nIndex], strlen(m_pszColumns[nIndex]));
+    }
+
+    Reserve(1);
+    Put('\n');
+
+} // End WriteHeader
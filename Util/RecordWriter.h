@@ -0,0 +1,129 @@
+/*********************************************************************
+ *
+ *  file:  RecordWriter.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Buffered writer for machine readable command output -
+ *          tab separated values or JSON lines.  Rows are formatted
+ *          directly into a fixed buffer so no memory is allocated
+ *          per row.
+ *
+ *********************************************************************/
+
+#ifndef __RECORD_WRITER_H__
+#define __RECORD_WRITER_H__
+
+#include "Stdafx.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+//---------------------------------------------------------------------
+// Output formats - recordFormatNone is the standard console output.
+//---------------------------------------------------------------------
+namespace RecordWriterTypes {
+    typedef enum RecordFormat {
+        recordFormatNone = 0,
+        recordFormatTSV,
+        recordFormatJSONL,
+        recordFormatInvalid
+    } RecordFormatType;
+}
+
+//---------------------------------------------------------------------
+// Size of the output buffer - the buffer is written out whenever
+// the next field may not fit.
+//---------------------------------------------------------------------
+#define RECORD_WRITER_BUFFER_SIZE       65536
+
+/////////////////////////////////////////////////////////////////////////////
+// RecordWriter Class
+//
+// Usage:
+//      static const char* const COLUMNS[] = { "file_id", "name" };
+//      RecordWriter writer(stdout, nFormat);
+//      writer.SetColumns(COLUMNS, 2);
+//      writer.BeginRecord();
+//      writer.AddInt64(l64FileID);
+//      writer.AddString(szFileName);
+//      writer.EndRecord();
+//
+// Fields must be added in column order.  For TSV, the column names
+// are written as a header line before the first record.  For JSON
+// lines, the column names are the keys of each object.
+
+class RecordWriter
+{
+private:
+    FILE*               m_pFile;
+    int                 m_nFormat;                  // RecordFormatType
+
+    const char* const*  m_pszColumns;
+    int                 m_nColumns;
+    int                 m_nField;                   // Next field of the current record
+    bool                m_bHeaderWritten;
+
+    int                 m_nBufferLen;
+    char                m_szBuffer[RECORD_WRITER_BUFFER_SIZE];
+
+public:
+    RecordWriter(FILE* pFile, int nFormat);
+    virtual ~RecordWriter();
+
+    //-----------------------------------------------------------------
+    // Returns the RecordFormatType for the given /format value
+    // (tsv or jsonl), recordFormatInvalid if not recognized.
+    //-----------------------------------------------------------------
+    static int ParseFormat(const std::string& szFormat);
+
+    void SetColumns(const char* const* pszColumns, int nColumns);
+
+    void BeginRecord();
+    void EndRecord();
+
+    //-----------------------------------------------------------------
+    // Field values - dates are written as UTC ISO 8601, a date of 0
+    // is written as an empty (null) value.  Amounts are the service's
+    // scaled integer amounts, written with nPrecision decimal digits.
+    //-----------------------------------------------------------------
+    void AddString(const char* szValue);
+    void AddString(const std::string& szValue);
+    void AddInt64(LONG64 l64Value);
+    void AddBool(bool bValue);
+    void AddDateTime(time_t tmValue);
+    void AddAmount(LONG64 l64Amount, int nPrecision);
+    void AddNull();
+
+    //-----------------------------------------------------------------
+    // Call when all records have been added - for TSV, writes the
+    // header if there were no records.  Flushes the output.
+    //-----------------------------------------------------------------
+    bool Finish();
+    bool Flush();
+
+private:
+    // Not implemented
+    RecordWriter(const RecordWriter&);
+    RecordWriter& operator=(const RecordWriter&);
+
+    void Reserve(int nBytes);
+    void BeginField(bool bQuoted);
+    void EndField(bool bQuoted);
+    void PutEscaped(const char* szValue, size_t nLength);
+    void PutDigits(LONG64 l64Value, int nMinDigits=1);
+
+    inline void Put(char cValue) {
+        m_szBuffer[m_nBufferLen++] = cValue;
+    }
+
+    void WriteHeader();
+};
+
+#endif // __RECORD_WRITER_H__
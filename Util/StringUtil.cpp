@@ -16,6 +16,8 @@
 #include "Stdafx.h"
 #include "StringUtil.h"
 #include "XString.h"
+#include "FormatBuffer.h"
+#include "FileReader.h"
 
 #include "Blowfish.h"
 
@@ -1189,15 +1191,9 @@ void StringUtil::InsertSeparator (double dwNumber, std::string& szFormattedNumbe
 // Returns: nothing
 void StringUtil::InsertSeparator (LONG64 l64Number, std::string& szFormattedNumber)
 {
-    #ifdef WIN32
-        szFormattedNumber = _format(_T("%I64d"), l64Number);
-    #else
-        szFormattedNumber = _format(_T("%lld"), l64Number);
-    #endif
-
-    for (int nIndex = (int)szFormattedNumber.length()-3; nIndex > 0; nIndex -= 3) {
-        szFormattedNumber.insert(nIndex, _T(","));
-    }
+    FixedFormatBuffer<32> szNumber;
+    szNumber.AppendGrouped(l64Number);
+    szFormattedNumber.assign(szNumber.c_str(), szNumber.length());
 
 } // End InsertSeparator
 
@@ -1216,6 +1212,33 @@ void StringUtil::InsertSeparator (LONG64 l64Number, std::string& szFormattedNumb
 // Returns: true if successful, false otherwise
 bool StringUtil::FormatByteSize(LONG64 l64ByteSize, std::string& szByteSize,
                                 std::string& szByteSizeType, int nMaxNumber /*0*/)
+{
+    FixedFormatBuffer<64> szNumber;
+    const char* szType = _T("");
+
+    bool bReturn = FormatByteSize(l64ByteSize, szNumber, szType, nMaxNumber);
+
+    szByteSize.assign(szNumber.c_str(), szNumber.length());
+    szByteSizeType = szType;
+
+    return bReturn;
+
+} // End FormatByteSize
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Formats the bytes as nnnnn.n (TB|B|GB|MB), appending to the
+//      given buffer.
+// Requires:
+//      l64ByteSize: input byte size
+//      szByteSize: buffer to append the formatted byte size to.
+//      szByteSizeType: returned byte size type (static string).
+//      nMaxNumber: max number within the category (e.g. if
+//                  nMaxNumber is 999, 1000 KB is converted
+//                  to 0.98 MB.
+// Returns: true if successful, false otherwise
+bool StringUtil::FormatByteSize(LONG64 l64ByteSize, FormatBuffer& szByteSize,
+                                const char*& szByteSizeType, int nMaxNumber /*0*/)
 {
     //-----------------------------------------------------------------
     //  kilo-   1000^1   1024^1 = 2^10 = 1,024
@@ -1234,146 +1257,40 @@ bool StringUtil::FormatByteSize(LONG64 l64ByteSize, std::string& szByteSize,
     static const LONG64 l64TB = 1024 * l64GB;   // Terabyte
     static const LONG64 l64PB = 1024 * l64TB;   // Petabyte
 
-    szByteSizeType = _T("");
-    szByteSize = _T("");
-
-    LONG64 l64Number, l64Remainder;
-    std::string szNumber = _T("");
-    std::string szRemainder = _T("");
-
-    bool bAddRemainder = true;
+    static const LONG64 l64Units[] = { l64KB, l64MB, l64GB, l64TB, l64PB };
+    static const char* const szUnitTypes[] = { _T("KB"), _T("MB"), _T("GB"), _T("TB"), _T("PB") };
 
     if (l64ByteSize < l64KB) {
-        InsertSeparator(l64ByteSize, szByteSize);
+        szByteSize.AppendGrouped(l64ByteSize);
         szByteSizeType = _T("B");
-        bAddRemainder = false;
+        return true;
     }
-    else {
-        if (l64ByteSize < l64MB) {
-            l64Number = l64ByteSize / l64KB;
-            l64Remainder = (l64ByteSize * 100 / l64KB) % 100;
-
-            // Max number dictates whether we use the bytes
-            // caculated or a fractional value in the next
-            // category.
-
-            if ( (nMaxNumber > 0) && (l64Number > nMaxNumber)) {
-                szNumber = _T("0");
-                l64Remainder = (l64ByteSize * 100 / l64MB) % 100;
-                szByteSizeType = _T("MB");
-            }
-            else {
-                l64Remainder = (l64ByteSize * 100 / l64KB) % 100;
-                InsertSeparator(l64Number, szNumber);
-                szByteSizeType = _T("KB");
-            }
 
-            #ifdef WIN32
-                szRemainder = _format(_T(".%02I64d"), l64Remainder);
-            #else
-                szRemainder = _format(_T(".%02lld"), l64Remainder);
-            #endif
-            szByteSize = szNumber + szRemainder;
-        }
-        else {
-            // Megabyte
-            if (l64ByteSize < l64GB) {
-                l64Number = l64ByteSize / l64MB;
-
-                // Max number dictates whether we use the bytes
-                // caculated or a fractional value in the next
-                // category.
-
-                if ( (nMaxNumber > 0) && (l64Number > nMaxNumber)) {
-                    szNumber = _T("0");
-                    l64Remainder = (l64ByteSize * 100 / l64GB) % 100;
-                    szByteSizeType = _T("GB");
-                }
-                else {
-                    l64Remainder = (l64ByteSize * 100 / l64MB) % 100;
-                    InsertSeparator(l64Number, szNumber);
-                    szByteSizeType = _T("MB");
-                }
-
-                #ifdef WIN32
-                    szRemainder = _format(_T(".%02I64d"), l64Remainder);
-                #else
-                    szRemainder = _format(_T(".%02lld"), l64Remainder);
-                #endif
-                szByteSize = szNumber + szRemainder;
-            }
-            else {
-                // Gigabyte
-                if (l64ByteSize < l64TB) {
-                    l64Number = l64ByteSize / l64GB;
-
-                    // Max number dictates whether we use the bytes
-                    // caculated or a fractional value in the next
-                    // category.
-
-                    if ( (nMaxNumber > 0) && (l64Number > nMaxNumber)) {
-                        szNumber = _T("0");
-                        l64Remainder = (l64ByteSize * 100 / l64TB) % 100;
-                        szByteSizeType = _T("TB");
-                    }
-                    else {
-                        l64Remainder = (l64ByteSize * 100 / l64GB) % 100;
-                        InsertSeparator(l64Number, szNumber);
-                        szByteSizeType = _T("GB");
-                    }
-
-                    #ifdef WIN32
-                        szRemainder = _format(_T(".%02I64d"), l64Remainder);
-                    #else
-                        szRemainder = _format(_T(".%02lld"), l64Remainder);
-                    #endif
-                    szByteSize = szNumber + szRemainder;
-                }
-                else {
-                    // Terabyte
-                    if (l64ByteSize >= l64TB) {
-                        l64Number = l64ByteSize / l64TB;
-
-                        // Max number dictates whether we use the bytes
-                        // caculated or a fractional value in the next
-                        // category.
-
-                        if ( (nMaxNumber > 0) && (l64Number > nMaxNumber)) {
-                            szNumber = _T("0");
-                            l64Remainder = (l64ByteSize * 100 / l64PB) % 100;
-                            szByteSizeType = _T("PB");
-                        }
-                        else {
-                            l64Remainder = (l64ByteSize * 100 / l64TB) % 100;
-                            InsertSeparator(l64Number, szNumber);
-                            szByteSizeType = _T("TB");
-                        }
-
-                        #ifdef WIN32
-                            szRemainder = _format(_T(".%02I64d"), l64Remainder);
-                        #else
-                            szRemainder = _format(_T(".%02lld"), l64Remainder);
-                        #endif
-                        szByteSize = szNumber + szRemainder;
-                    }
-                }
-            }
-        }
+    // Find the category - terabytes is the largest category shown
+    // other than for nMaxNumber.
+    int nUnit = 0;
+    while ( (nUnit < 3) && (l64ByteSize >= l64Units[nUnit + 1]) ) {
+        nUnit ++;
     }
 
-    // Display decimal points only if needed
-    // another alternative to this approach is to check before calling str.Format, and
-    // have separate cases depending on whether l64Remainder == 0 or not.
+    LONG64 l64Number = l64ByteSize / l64Units[nUnit];
+    LONG64 l64Remainder = 0;
 
-    if (bAddRemainder) {
-        // Remainder added in general, in cases except B(ytes)
-        return true;
+    // Max number dictates whether we use the bytes
+    // caculated or a fractional value in the next
+    // category.
+    if ( (nMaxNumber > 0) && (l64Number > nMaxNumber)) {
+        szByteSize.Append('0');
+        l64Remainder = (l64ByteSize * 100 / l64Units[nUnit + 1]) % 100;
+        szByteSizeType = szUnitTypes[nUnit + 1];
+    }
+    else {
+        szByteSize.AppendGrouped(l64Number);
+        l64Remainder = (l64ByteSize * 100 / l64Units[nUnit]) % 100;
+        szByteSizeType = szUnitTypes[nUnit];
     }
 
-    char szByteSizeBuffer[MAX_PATH];
-    strcpy(szByteSizeBuffer, szByteSize.c_str());
-    szByteSize = _tcsstrrem(szByteSizeBuffer, _T(".00"));
-
+    szByteSize.Append('.').AppendInt(l64Remainder, 2);
     return true;
 
 } // End FormatByteSize
@@ -1392,48 +1309,54 @@ bool StringUtil::FormatBandwidth(LONG64 l64ByteSize,
                                  std::string& szKiloBitsPerSec,
                                  std::string& szKiloBitsPerSecType)
 {
-   szKiloBitsPerSec = _T("0");
-   szKiloBitsPerSecType = _T("kbps");
+    FixedFormatBuffer<64> szNumber;
+    const char* szType = _T("");
 
-    if (l64ByteSize == 0) {
-       return false;
-    }
+    bool bReturn = FormatBandwidth(l64ByteSize, elapsedTime, szNumber, szType);
 
-    LONG64 l64Number = 0;
-    LONG64 l64Remainder = 0;
+    szKiloBitsPerSec.assign(szNumber.c_str(), szNumber.length());
+    szKiloBitsPerSecType = szType;
+
+    return bReturn;
 
-    std::string szNumber = _T("");
-    std::string szRemainder = _T("");
+} // End FormatBandwidth
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Formats the bytes into bandwidth speed (kps), appending to
+//      the given buffer.
+// Requires:
+//      l64ByteSize: input byte size
+//      elapsedTime: elapsed time
+//      szKiloBitsPerSec: buffer to append the formatted kbs to.
+//      szKiloBitsPerSecType: currently, always using kbs
+// Returns: true if successful, false otherwise
+bool StringUtil::FormatBandwidth(LONG64 l64ByteSize,
+                                 const boost::posix_time::time_duration& elapsedTime,
+                                 FormatBuffer& szKiloBitsPerSec,
+                                 const char*& szKiloBitsPerSecType)
+{
+    szKiloBitsPerSecType = _T("kbps");
 
     static const LONG64 l64KB = 1000;
 
     double dblTotalSeconds =  static_cast<double>(elapsedTime.total_milliseconds()) / 1000;
-    if (dblTotalSeconds == 0) {
-       return false;
+    if ( (l64ByteSize == 0) || (dblTotalSeconds == 0) ) {
+        szKiloBitsPerSec.Append('0');
+        return false;
     }
 
     double dblBitPerSec = (l64ByteSize * 8) / dblTotalSeconds;
 
-    l64Number = static_cast<LONG64>(dblBitPerSec / l64KB);
-    l64Remainder = (static_cast<LONG64>(dblBitPerSec) * 100 / l64KB) % 100;
+    LONG64 l64Number = static_cast<LONG64>(dblBitPerSec / l64KB);
+    LONG64 l64Remainder = (static_cast<LONG64>(dblBitPerSec) * 100 / l64KB) % 100;
 
-    InsertSeparator(l64Number, szNumber);
+    szKiloBitsPerSec.AppendGrouped(l64Number);
 
-    #ifdef WIN32
-        szRemainder = _format(_T(".%02I64d"), l64Remainder);
-    #else
-        szRemainder = _format(_T(".%02lld"), l64Remainder);
-    #endif
-    szKiloBitsPerSec = szNumber + szRemainder;
-    szKiloBitsPerSecType = _T("kbps");
-
-    // Display decimal points only if needed
-    // another alternative to this approach is to check before calling str.Format, and
-    // have separate cases depending on whether l64Remainder == 0 or not.
-
-    char szKiloBitsPerSecBuffer[MAX_PATH];
-    strcpy(szKiloBitsPerSecBuffer, szKiloBitsPerSec.c_str());
-    szKiloBitsPerSec = _tcsstrrem(szKiloBitsPerSecBuffer, _T(".00"));
+    // Display decimal points only if needed.
+    if (l64Remainder != 0) {
+        szKiloBitsPerSec.Append('.').AppendInt(l64Remainder, 2);
+    }
 
     return true;
 
@@ -1717,15 +1640,11 @@ bool StringUtil::FormatDateAndTime(time_t tmDateTime, std::string& szFormattedDa
         return false;
     }
 
-    szFormattedDate = _T("");
-    struct tm* pLocalTM = std::localtime(&tmDateTime);
-
-    const char* szDateBuffer = MakeFormatDate(_T("%Y-%m-%d %H:%M:%S"), pLocalTM);
-    szFormattedDate = std::string(szDateBuffer);
+    FixedFormatBuffer<64> szDate;
+    bool bReturn = FormatDateAndTime(tmDateTime, szDate);
 
-    free( (void*)szDateBuffer); 
-    szDateBuffer = NULL;
-    return true;
+    szFormattedDate.assign(szDate.c_str(), szDate.length());
+    return bReturn;
 
     #if 0
     // It would be delightful if this worked, but it doesn't and is not intended
@@ -1752,6 +1671,37 @@ bool StringUtil::FormatDateAndTime(time_t tmDateTime, std::string& szFormattedDa
 
 } // End FormatDateAndTime
 
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Formats the input date and time as yyyy-mm-dd hh:mm:ss (local
+//      time), appending to the given buffer.
+// Requires:
+//      tmDateTime: input date and time value
+//      szFormattedDate: buffer to append the formatted date to.
+// Returns: true if successful, false otherwise (date is 0 - "none"
+//          is appended).
+bool StringUtil::FormatDateAndTime(time_t tmDateTime, FormatBuffer& szFormattedDate)
+{
+    if (tmDateTime == 0) {
+        szFormattedDate.Append(_T("none"));
+        return false;
+    }
+
+    struct tm* pLocalTM = std::localtime(&tmDateTime);
+    if (pLocalTM == NULL) {
+        szFormattedDate.Append(_T("none"));
+        return false;
+    }
+
+    char szDateBuffer[32];
+    size_t nLength = std::strftime(szDateBuffer, sizeof(szDateBuffer),
+                                   _T("%Y-%m-%d %H:%M:%S"), pLocalTM);
+    szFormattedDate.Append(szDateBuffer, nLength);
+
+    return (nLength > 0);
+
+} // End FormatDateAndTime
+
 ///////////////////////////////////////////////////////////////////////
 // Purpose:
 //      Formats the input duration into HH::MM::SS.sss.
@@ -1764,9 +1714,31 @@ bool StringUtil::FormatDateAndTime(time_t tmDateTime, std::string& szFormattedDa
 bool StringUtil::FormatDuration(const boost::posix_time::time_duration& elapsedTime,
         std::string& szFormattedTime, std::string& szTimeType, int nPrecision /*1*/)
 {
-    szTimeType = _T("");
-    szFormattedTime = _T("");
+    FixedFormatBuffer<64> szTime;
+    const char* szType = _T("");
+
+    bool bReturn = FormatDuration(elapsedTime, szTime, szType, nPrecision);
 
+    szFormattedTime.assign(szTime.c_str(), szTime.length());
+    szTimeType = szType;
+
+    return bReturn;
+
+} // End FormatDuration
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Formats the input duration into HH::MM::SS.sss, appending to
+//      the given buffer.
+// Requires:
+//      elapsedTime: input duration value
+//      szFormattedTime: buffer to append the formatted time to.
+//      szTimeType: returned duration type (hours, minutes, seconds)
+//      nPrecision: timer output precision (e.g. 3.1, 3.11, etc.)
+// Returns: true if successful, false otherwise
+bool StringUtil::FormatDuration(const boost::posix_time::time_duration& elapsedTime,
+        FormatBuffer& szFormattedTime, const char*& szTimeType, int nPrecision /*1*/)
+{
     int nHours = elapsedTime.hours();
 
     LONG64 lMinutes = elapsedTime.minutes();
@@ -1777,27 +1749,18 @@ bool StringUtil::FormatDuration(const boost::posix_time::time_duration& elapsedT
     double dblSeconds =  static_cast<double>(elapsedTime.seconds()) + dblMilliseconds;
 
     if (nHours > 0) {
-        #ifdef WIN32
-            szFormattedTime = _format(_T("%d:%02I64d:%.*lf"), nHours, lMinutes, nPrecision, dblSeconds);
-        #else
-            szFormattedTime = _format(_T("%d:%02lld:%.*lf"), nHours, lMinutes, nPrecision, dblSeconds);
-        #endif
+        szFormattedTime.AppendInt(nHours).Append(':').AppendInt(lMinutes, 2).Append(':');
         szTimeType = _T("hours");
-
     }
     else if (lMinutes > 0) {
-        #ifdef WIN32
-            szFormattedTime = _format(_T("%I64d:%.*lf"), lMinutes, nPrecision, dblSeconds);
-        #else
-            szFormattedTime = _format(_T("%lld:%.*lf"), lMinutes, nPrecision, dblSeconds);
-        #endif
+        szFormattedTime.AppendInt(lMinutes).Append(':');
         szTimeType = _T("minutes");
     }
     else {
-        szFormattedTime = _format(_T("%.*lf"), nPrecision, dblSeconds);
         szTimeType = _T("seconds");
     }
 
+    szFormattedTime.AppendFixed(dblSeconds, nPrecision);
     return true;
 
 } // End FormatDuration
@@ -1873,25 +1836,28 @@ bool StringUtil::TrimFileName(int nMaxWidth, std::string szInFileName,
 // Requires:
 //      szFilePath: file (with path) to be hased
 //      pMD5Digest: returned digest for file
-// Returns: 0 if the file was found and could be opened,
+// Returns: 0 if the file was found and could be read,
 //          errno otherwise
 int StringUtil::MakeFileMd5Digest(char* szFilePath, unsigned char* pMD5Digest)
 {
     MD5_CTX state;
-    int cbRead;
-    FILE *pFile;
-    char szBuffer[1024*16];
+    FileReader fileReader;
 
-    pFile = fopen(szFilePath, "rb");
-    if (pFile == NULL) {
-        return errno;
+    // Very large files are read around the page cache.
+    if (fileReader.Open(szFilePath) == false) {
+        return fileReader.GetError();
     }
 
-    cbRead = (int)fread(szBuffer, 1, sizeof(szBuffer), pFile);
+    const unsigned char* pData = NULL;
+    size_t nLength = 0;
+
     MD5_Init(&state);
-    while (cbRead > 0) {
-        MD5_Update(&state, (const MD5_CTX *)szBuffer, cbRead);
-        cbRead = (int)fread(szBuffer, 1, sizeof(szBuffer), pFile);
+    while (fileReader.Next(pData, nLength) && (nLength > 0)) {
+        MD5_Update(&state, pData, nLength);
+    }
+
+    if (fileReader.GetError() != 0) {
+        return fileReader.GetError();
     }
 
     MD5_Final(pMD5Digest, &state);
@@ -39,6 +39,8 @@ using namespace boost::posix_time;
 using namespace boost::local_time;
 using namespace boost::gregorian;
 
+class FormatBuffer;
+
 namespace StringUtil
 {
     static const std::string WIDE_NULL				= _T("");
@@ -181,6 +183,17 @@ namespace StringUtil
                          std::string& szKiloBitsPerSec,
                          std::string& szKiloBitsPerSecType);
 
+    //--------------------------------------------------------------------
+    // As above, appending to a FormatBuffer - the type strings are
+    // static and are not copied.
+    //--------------------------------------------------------------------
+    bool FormatByteSize(LONG64 l64ByteSize, FormatBuffer& szByteSize,
+                        const char*& szByteSizeType, int nMaxNumber=0);
+    bool FormatBandwidth(LONG64 l64ByteSize,
+                         const boost::posix_time::time_duration& elapsedTime,
+                         FormatBuffer& szKiloBitsPerSec,
+                         const char*& szKiloBitsPerSecType);
+
     //--------------------------------------------------------------------
     // Formats the number with thousands separator.
     //--------------------------------------------------------------------
@@ -198,6 +211,10 @@ namespace StringUtil
     bool FormatDateAndTime(time_t tmDateTime, std::string& szFormattedDate);
     bool FormatDuration(const boost::posix_time::time_duration& elapsedTime,
         std::string& szFormattedTime, std::string& szTimeType, int nPrecision=1);
+
+    bool FormatDateAndTime(time_t tmDateTime, FormatBuffer& szFormattedDate);
+    bool FormatDuration(const boost::posix_time::time_duration& elapsedTime,
+        FormatBuffer& szFormattedTime, const char*& szTimeType, int nPrecision=1);
     const char* MakeFormatDate(const char* szFormat, const struct tm* pTM);
     
     //--------------------------------------------------------------------
@@ -225,6 +242,11 @@ namespace StringUtil
 	        return szOutPadStr;
 	    }
 
+	    if (szInPadStr.length() == 1) {
+	        szOutPadStr.assign(nNumPad, szInPadStr[0]);
+	        return szOutPadStr;
+	    }
+
 	    int nIndex = 0;
 
 	    for (nIndex = 0; nIndex < nNumPad; nIndex ++) {
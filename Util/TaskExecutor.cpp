@@ -0,0 +1,593 @@
+/*********************************************************************
+ *
+ *  file:  TaskExecutor.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Pool of worker threads running CTask objects, with work
+ *          stealing, continuations and cancellation.
+ *
+ *********************************************************************/
+
+#include "Stdafx.h"
+#include "TaskExecutor.h"
+
+#include <limits.h>
+
+#ifndef WINDOWS
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+using DIOMEDE_CRITICAL::CCriticalSection;
+using DIOMEDE_CRITICAL::Lock;
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Millisecond clock for the Wait timeout - only differences
+//          are used, so it may wrap.
+static DWORD GetMilliseconds()
+{
+#ifdef WINDOWS
+    return GetTickCount();
+#else
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    return (DWORD)((now.tv_sec * 1000) + (now.tv_usec / 1000));
+#endif
+
+} // End GetMilliseconds
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: TaskExecutor constructor - starts the workers.
+// Requires:
+//      nWorkers: number of worker threads, at most EXECUTOR_MAX_WORKERS.
+TaskExecutor::TaskExecutor(int nWorkers /*EXECUTOR_DEFAULT_WORKERS*/)
+    : m_jobSignal(UINT_MAX),
+      m_nOutstanding(0),
+      m_nNextQueue(0),
+      m_bShutdown(false)
+{
+#ifdef WINDOWS
+    InitializeCriticalSection(&m_completeLock);
+    m_hComplete = CreateEvent(NULL, TRUE, FALSE, NULL);
+#else
+    pthread_mutex_init(&m_completeLock, NULL);
+    pthread_cond_init(&m_condComplete, NULL);
+#endif
+
+    if (nWorkers < 1) {
+        nWorkers = 1;
+    }
+    else if (nWorkers > EXECUTOR_MAX_WORKERS) {
+        nWorkers = EXECUTOR_MAX_WORKERS;
+    }
+
+    // The queues are all in place before any worker can steal.
+    for (int nWorker = 0; nWorker < nWorkers; nWorker++) {
+        WorkerQueue* pQueue = new WorkerQueue();
+        pQueue->runningJob.pTask = NULL;
+        pQueue->runningJob.pCancelToken = NULL;
+        m_listQueues.push_back(pQueue);
+    }
+
+    for (int nWorker = 0; nWorker < nWorkers; nWorker++) {
+        Worker* pWorker = new Worker(this, nWorker);
+        pWorker->SetThreadType(ThreadTypeSpecialized);
+
+        if (pWorker->Event((LPVOID)pWorker) == FALSE) {
+            // The other workers steal its jobs.
+            pWorker->Stop();
+            delete pWorker;
+            continue;
+        }
+
+        m_listWorkers.push_back(pWorker);
+    }
+
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: TaskExecutor destructor
+TaskExecutor::~TaskExecutor()
+{
+    Shutdown();
+
+    for (int nQueue = 0; nQueue < (int)m_listQueues.size(); nQueue++) {
+        delete m_listQueues[nQueue];
+    }
+    m_listQueues.clear();
+
+#ifdef WINDOWS
+    if (m_hComplete != NULL) {
+        CloseHandle(m_hComplete);
+    }
+    DeleteCriticalSection(&m_completeLock);
+#else
+    pthread_cond_destroy(&m_condComplete);
+    pthread_mutex_destroy(&m_completeLock);
+#endif
+
+} // End destructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Queue a task.
+// Requires:
+//      pTask: task to run.
+//      pCancelToken: token of the task and its continuations, or NULL.
+// Returns: true if queued, false after Shutdown or without workers.
+bool TaskExecutor::Submit(CTask* pTask, CancelToken* pCancelToken /*NULL*/)
+{
+    if (pTask == NULL) {
+        return false;
+    }
+
+    int nQueue = CurrentWorker();
+
+    {
+        Lock<CCriticalSection> lock(m_lock);
+
+        if (m_bShutdown || m_listWorkers.empty()) {
+            return false;
+        }
+
+        if (nQueue < 0) {
+            nQueue = (int)(m_nNextQueue++ % m_listQueues.size());
+        }
+
+        // Counted with the check, so Shutdown waits for it.
+        m_nOutstanding++;
+    }
+
+    QueueJob(nQueue, pTask, pCancelToken);
+    return true;
+
+} // End Submit
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Register a task to queue when another succeeds.
+// Requires:
+//      pTask: task not yet submitted, or itself a continuation.
+//      pNext: task to queue after it.
+// Returns: nothing
+void TaskExecutor::Then(CTask* pTask, CTask* pNext)
+{
+    if ( (pTask == NULL) || (pNext == NULL) ) {
+        return;
+    }
+
+    pNext->SetTaskStatus(TaskStatusWaitingOnQueue);
+
+    Lock<CCriticalSection> lock(m_lock);
+    m_mapContinuations.insert(std::make_pair(pTask, pNext));
+
+} // End Then
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Cancel the tasks of a token.
+// Requires:
+//      pCancelToken: token given to Submit.
+// Returns: nothing
+void TaskExecutor::Cancel(CancelToken* pCancelToken)
+{
+    if (pCancelToken == NULL) {
+        return;
+    }
+
+    pCancelToken->Cancel();
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    for (int nQueue = 0; nQueue < (int)m_listQueues.size(); nQueue++) {
+        ExecutorJob& runningJob = m_listQueues[nQueue]->runningJob;
+        if ( (runningJob.pTask != NULL) && (runningJob.pCancelToken == pCancelToken) ) {
+            CancelRunningTask(runningJob.pTask);
+        }
+    }
+
+} // End Cancel
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait for a task to complete or be skipped.
+// Requires:
+//      pTask: submitted task, or a registered continuation.
+//      dwTimeout: milliseconds to wait.
+// Returns: true if the task ran, false otherwise.
+bool TaskExecutor::Wait(CTask* pTask, DWORD dwTimeout /*QUEUE_WAIT_INFINITE*/)
+{
+    bool bRan = false;
+    DWORD dwStart = GetMilliseconds();
+
+#ifdef WINDOWS
+    EnterCriticalSection(&m_completeLock);
+#else
+    pthread_mutex_lock(&m_completeLock);
+#endif
+
+    while (true) {
+        TaskStatus_t taskStatus = pTask->Status();
+
+        if (taskStatus == TaskStatusCompleted) {
+            bRan = true;
+            break;
+        }
+        if ( (taskStatus == TaskStatusCancelled) || (taskStatus == TaskStatusNotSubmitted) ) {
+            break;
+        }
+
+        // Other tasks complete too - wait out what's left.
+        DWORD dwWait = dwTimeout;
+        if (dwTimeout != QUEUE_WAIT_INFINITE) {
+            DWORD dwElapsed = GetMilliseconds() - dwStart;
+            dwWait = (dwElapsed < dwTimeout) ? (dwTimeout - dwElapsed) : 0;
+        }
+
+        if (dwWait == 0) {
+            break;
+        }
+
+        WaitComplete(dwWait);
+    }
+
+#ifdef WINDOWS
+    LeaveCriticalSection(&m_completeLock);
+#else
+    pthread_mutex_unlock(&m_completeLock);
+#endif
+
+    return bRan;
+
+} // End Wait
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait until no task is queued or running.
+// Requires: nothing
+// Returns: nothing
+void TaskExecutor::WaitAll()
+{
+#ifdef WINDOWS
+    EnterCriticalSection(&m_completeLock);
+#else
+    pthread_mutex_lock(&m_completeLock);
+#endif
+
+    while (GetOutstandingCount() > 0) {
+        WaitComplete(QUEUE_WAIT_INFINITE);
+    }
+
+#ifdef WINDOWS
+    LeaveCriticalSection(&m_completeLock);
+#else
+    pthread_mutex_unlock(&m_completeLock);
+#endif
+
+} // End WaitAll
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Finish the queued tasks and stop the workers - cancel the
+//          tokens first to skip them.
+// Requires: nothing
+// Returns: nothing
+void TaskExecutor::Shutdown()
+{
+    {
+        Lock<CCriticalSection> lock(m_lock);
+        if (m_bShutdown) {
+            return;
+        }
+        m_bShutdown = true;
+    }
+
+    // Continuations may still be queued by the running tasks.
+    WaitAll();
+
+    m_jobSignal.Close();
+
+    for (int nWorker = 0; nWorker < (int)m_listWorkers.size(); nWorker++) {
+        m_listWorkers[nWorker]->Stop();
+        delete m_listWorkers[nWorker];
+    }
+    m_listWorkers.clear();
+
+    Lock<CCriticalSection> lock(m_lock);
+    m_mapContinuations.clear();
+
+} // End Shutdown
+
+///////////////////////////////////////////////////////////////////////
+int TaskExecutor::GetOutstandingCount()
+{
+    Lock<CCriticalSection> lock(m_lock);
+    return m_nOutstanding;
+
+} // End GetOutstandingCount
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Worker thread event - runs the worker loop.
+BOOL TaskExecutor::Worker::OnTask(LPVOID lpvData)
+{
+    m_pExecutor->RunWorker(m_nWorker);
+    return TRUE;
+
+} // End OnTask
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Run jobs until the executor shuts down.
+// Requires:
+//      nWorker: index of the worker's queue.
+// Returns: nothing
+void TaskExecutor::RunWorker(int nWorker)
+{
+    LPVOID lpvSignal = NULL;
+
+    // Each signal is one job queued, and a job is queued before its
+    // signal - so a job is there for every signal taken, on one queue
+    // or another.
+    while (m_jobSignal.Pop(&lpvSignal, QUEUE_WAIT_INFINITE)) {
+        ExecutorJob job;
+
+        while (TakeJob(nWorker, job) == false) {
+            // Another worker took it between the looks - another is
+            // on its way.
+            Sleep(0);
+        }
+
+        RunJob(nWorker, job);
+    }
+
+} // End RunWorker
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Take the last job of the worker's own queue, or steal the
+//          first job of another's.
+// Requires:
+//      nWorker: index of the worker's queue.
+//      job: set to the job taken.
+// Returns: true if a job was taken, false otherwise.
+bool TaskExecutor::TakeJob(int nWorker, ExecutorJob& job)
+{
+    {
+        WorkerQueue* pQueue = m_listQueues[nWorker];
+        Lock<CCriticalSection> lock(pQueue->lock);
+
+        if (pQueue->listJobs.empty() == false) {
+            job = pQueue->listJobs.back();
+            pQueue->listJobs.pop_back();
+            return true;
+        }
+    }
+
+    int nQueues = (int)m_listQueues.size();
+
+    for (int nOffset = 1; nOffset < nQueues; nOffset++) {
+        WorkerQueue* pQueue = m_listQueues[(nWorker + nOffset) % nQueues];
+        Lock<CCriticalSection> lock(pQueue->lock);
+
+        if (pQueue->listJobs.empty() == false) {
+            job = pQueue->listJobs.front();
+            pQueue->listJobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+
+} // End TakeJob
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Run the job, then queue or skip its continuations.
+// Requires:
+//      nWorker: index of the worker's queue.
+//      job: job to run.
+// Returns: nothing
+void TaskExecutor::RunJob(int nWorker, ExecutorJob& job)
+{
+    CTask* pTask = job.pTask;
+    CancelToken* pCancelToken = job.pCancelToken;
+
+    std::vector<CTask*> listNext;
+
+    if ( (pCancelToken != NULL) && pCancelToken->IsCancelled() ) {
+        TakeContinuations(pTask, listNext);
+        for (int nIndex = 0; nIndex < (int)listNext.size(); nIndex++) {
+            SkipTask(listNext[nIndex]);
+        }
+
+        pTask->SetTaskStatus(TaskStatusCancelled);
+    }
+    else {
+        {
+            Lock<CCriticalSection> lock(m_lock);
+            m_listQueues[nWorker]->runningJob = job;
+        }
+
+        pTask->SetTaskStatus(TaskStatusBeingProcessed);
+        BOOL bReturn = pTask->Task();
+
+        {
+            Lock<CCriticalSection> lock(m_lock);
+            m_listQueues[nWorker]->runningJob.pTask = NULL;
+            m_listQueues[nWorker]->runningJob.pCancelToken = NULL;
+        }
+
+        bool bSucceeded = TaskSucceeded(pTask, bReturn) &&
+                          ( (pCancelToken == NULL) || (pCancelToken->IsCancelled() == false) );
+
+        // Queued before the task completes, so whoever waits on the
+        // task sees its continuations as pending.
+        TakeContinuations(pTask, listNext);
+        for (int nIndex = 0; nIndex < (int)listNext.size(); nIndex++) {
+            if (bSucceeded) {
+                // Counted while this job still is - Shutdown waits for
+                // the chain.
+                {
+                    Lock<CCriticalSection> lock(m_lock);
+                    m_nOutstanding++;
+                }
+
+                QueueJob(nWorker, listNext[nIndex], pCancelToken);
+            }
+            else {
+                SkipTask(listNext[nIndex]);
+            }
+        }
+
+        pTask->SetTaskStatus(TaskStatusCompleted);
+    }
+
+    // The task may be gone from here on.
+    {
+        Lock<CCriticalSection> lock(m_lock);
+        m_nOutstanding--;
+    }
+
+    SignalComplete();
+
+} // End RunJob
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Add a job to a worker's queue and signal it.
+// Requires:
+//      nQueue: index of the worker's queue.
+//      pTask: task to run, already counted in m_nOutstanding.
+//      pCancelToken: token of the task, or NULL.
+// Returns: nothing
+void TaskExecutor::QueueJob(int nQueue, CTask* pTask, CancelToken* pCancelToken)
+{
+    pTask->SetTaskStatus(TaskStatusWaitingOnQueue);
+
+    ExecutorJob job;
+    job.pTask = pTask;
+    job.pCancelToken = pCancelToken;
+
+    {
+        WorkerQueue* pQueue = m_listQueues[nQueue];
+        Lock<CCriticalSection> lock(pQueue->lock);
+        pQueue->listJobs.push_back(job);
+    }
+
+    // The signal holds no limit, and is closed only once nothing is
+    // outstanding.
+    m_jobSignal.Push((LPVOID)pTask, TaskPriorityNormal, QUEUE_WAIT_INFINITE);
+
+} // End QueueJob
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wake the threads in Wait and WaitAll - all of them, since
+//          each waits on its own task.
+// Requires: nothing
+// Returns: nothing
+void TaskExecutor::SignalComplete()
+{
+#ifdef WINDOWS
+    EnterCriticalSection(&m_completeLock);
+    SetEvent(m_hComplete);
+    LeaveCriticalSection(&m_completeLock);
+#else
+    pthread_mutex_lock(&m_completeLock);
+    pthread_cond_broadcast(&m_condComplete);
+    pthread_mutex_unlock(&m_completeLock);
+#endif
+
+} // End SignalComplete
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait, with m_completeLock held, for the next job to complete.
+// Requires:
+//      dwTimeout: milliseconds to wait, QUEUE_WAIT_INFINITE to wait as
+//                 long as it takes.
+// Returns: false if the time ran out, true otherwise.
+bool TaskExecutor::WaitComplete(DWORD dwTimeout)
+{
+#ifdef WINDOWS
+    // Reset while locked - a completion after this sets it again.
+    ResetEvent(m_hComplete);
+    LeaveCriticalSection(&m_completeLock);
+    DWORD dwResult = WaitForSingleObject(m_hComplete,
+        (dwTimeout == QUEUE_WAIT_INFINITE) ? INFINITE : dwTimeout);
+    EnterCriticalSection(&m_completeLock);
+
+    return (dwResult != WAIT_TIMEOUT);
+#else
+    if (dwTimeout == QUEUE_WAIT_INFINITE) {
+        pthread_cond_wait(&m_condComplete, &m_completeLock);
+        return true;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    struct timespec deadline;
+    deadline.tv_sec = now.tv_sec + (dwTimeout / 1000);
+    deadline.tv_nsec = (now.tv_usec * 1000) + ((dwTimeout % 1000) * 1000000);
+
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    return (pthread_cond_timedwait(&m_condComplete, &m_completeLock, &deadline) != ETIMEDOUT);
+#endif
+
+} // End WaitComplete
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Skip a continuation, and the continuations after it.
+// Requires:
+//      pTask: continuation not run.
+// Returns: nothing
+void TaskExecutor::SkipTask(CTask* pTask)
+{
+    std::vector<CTask*> listNext;
+    TakeContinuations(pTask, listNext);
+
+    for (int nIndex = 0; nIndex < (int)listNext.size(); nIndex++) {
+        SkipTask(listNext[nIndex]);
+    }
+
+    pTask->SetTaskStatus(TaskStatusCancelled);
+
+} // End SkipTask
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Remove the continuations registered for a task.
+// Requires:
+//      pTask: task run or skipped.
+//      listNext: set to its continuations, in the order registered.
+// Returns: nothing
+void TaskExecutor::TakeContinuations(CTask* pTask, std::vector<CTask*>& listNext)
+{
+    listNext.clear();
+
+    Lock<CCriticalSection> lock(m_lock);
+
+    std::pair<ContinuationMap::iterator, ContinuationMap::iterator> range =
+        m_mapContinuations.equal_range(pTask);
+
+    for (ContinuationMap::iterator iter = range.first; iter != range.second; iter++) {
+        listNext.push_back(iter->second);
+    }
+
+    m_mapContinuations.erase(range.first, range.second);
+
+} // End TakeContinuations
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Index of the worker calling, if any.
+// Requires: nothing
+// Returns: worker index, -1 if not called from a worker.
+int TaskExecutor::CurrentWorker()
+{
+    for (int nWorker = 0; nWorker < (int)m_listWorkers.size(); nWorker++) {
+        if (m_listWorkers[nWorker]->FromSameThread()) {
+            return m_listWorkers[nWorker]->m_nWorker;
+        }
+    }
+
+    return -1;
+
+} // End CurrentWorker
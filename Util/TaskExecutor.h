@@ -0,0 +1,214 @@
+/*********************************************************************
+ *
+ *  file:  TaskExecutor.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Pool of worker threads running CTask objects - each worker
+ *          has its own queue and steals from the others when it runs
+ *          dry.  Tasks can be chained, and a chain cancelled.
+ *
+ *********************************************************************/
+
+#ifndef __TASK_EXECUTOR_H__
+#define __TASK_EXECUTOR_H__
+
+#include "Stdafx.h"
+#include "Thread.h"
+#include "CriticalSection.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+//---------------------------------------------------------------------
+// Workers when none are given, and the most allowed.
+//---------------------------------------------------------------------
+#define EXECUTOR_DEFAULT_WORKERS        4
+#define EXECUTOR_MAX_WORKERS            16
+
+///////////////////////////////////////////////////////////////////////
+// CancelToken Class
+//
+// Shared by the tasks of a chain, or any group of tasks - once
+// cancelled, the tasks not yet started are skipped.  Tasks may check
+// it themselves to stop early.
+
+class CancelToken
+{
+private:
+    volatile bool               m_bCancelled;
+
+public:
+    CancelToken() : m_bCancelled(false) {};
+
+    void Cancel() { m_bCancelled = true; }
+    bool IsCancelled() const { return m_bCancelled; }
+    void Reset() { m_bCancelled = false; }
+};
+
+///////////////////////////////////////////////////////////////////////
+// TaskExecutor Class
+//
+// Usage:
+//      TaskExecutor executor(nWorkers);
+//      CancelToken cancelToken;
+//
+//      // Upload runs once CreateFile succeeds, SetMetaData once the
+//      // upload succeeds - register the chain before submitting it.
+//      executor.Then(pCreateFileTask, pUploadTask);
+//      executor.Then(pUploadTask, pSetMetaDataTask);
+//      executor.Submit(pCreateFileTask, &cancelToken);
+//      ...
+//      executor.Cancel(&cancelToken);          // CTRL+C
+//      executor.Wait(pSetMetaDataTask);
+//
+// A worker takes the task queued last on its own queue, so a chain
+// keeps to the worker that started it; an idle worker steals the task
+// queued first on another's queue.  The executor doesn't own the
+// tasks - a task must outlive its run, and those of its chain.
+//
+// A task that didn't succeed, or whose token was cancelled, skips its
+// continuations - their status is set to TaskStatusCancelled.  Derived
+// classes decide what success is, and how a running task is cancelled;
+// they must call Shutdown from their own destructor.
+
+class TaskExecutor
+{
+private:
+    //-----------------------------------------------------------------
+    // Worker thread - its one event runs the worker loop until the
+    // executor shuts down.
+    //-----------------------------------------------------------------
+    class Worker : public CThread
+    {
+    public:
+        TaskExecutor*           m_pExecutor;
+        int                     m_nWorker;
+
+        Worker(TaskExecutor* pExecutor, int nWorker)
+            : m_pExecutor(pExecutor), m_nWorker(nWorker) {};
+        virtual ~Worker() {};
+
+        virtual BOOL OnTask(LPVOID lpvData);
+        virtual BOOL OnTask() { return TRUE; }
+    };
+
+    struct ExecutorJob
+    {
+        CTask*                  pTask;
+        CancelToken*            pCancelToken;
+    };
+
+    //-----------------------------------------------------------------
+    // Jobs queued for a worker, guarded by its lock.  The running job
+    // is guarded by the executor's lock.
+    //-----------------------------------------------------------------
+    struct WorkerQueue
+    {
+        std::deque<ExecutorJob>             listJobs;
+        DIOMEDE_CRITICAL::CCriticalSection  lock;
+        ExecutorJob                         runningJob;
+    };
+
+    typedef std::multimap<CTask*, CTask*> ContinuationMap;
+
+    std::vector<Worker*>        m_listWorkers;
+    std::vector<WorkerQueue*>   m_listQueues;
+
+    // One entry per queued job - idle workers wait on it.
+    CTaskQueue                  m_jobSignal;
+
+    //-----------------------------------------------------------------
+    // Guarded by m_lock.
+    //-----------------------------------------------------------------
+    ContinuationMap             m_mapContinuations;
+    int                         m_nOutstanding;             // Queued or running
+    unsigned int                m_nNextQueue;               // Round robin for submits
+    bool                        m_bShutdown;
+
+    DIOMEDE_CRITICAL::CCriticalSection  m_lock;
+
+    //-----------------------------------------------------------------
+    // Signalled as each job completes or is skipped - Wait and WaitAll
+    // check the tasks with m_completeLock held, so a completion between
+    // the check and the wait isn't missed.
+    //-----------------------------------------------------------------
+#ifdef WINDOWS
+    CRITICAL_SECTION            m_completeLock;
+    HANDLE                      m_hComplete;                // Manual reset - reset under the lock
+#else
+    pthread_mutex_t             m_completeLock;
+    pthread_cond_t              m_condComplete;
+#endif
+
+public:
+    TaskExecutor(int nWorkers=EXECUTOR_DEFAULT_WORKERS);
+    virtual ~TaskExecutor();
+
+    //-----------------------------------------------------------------
+    // Queue the task - on the calling worker's own queue when called
+    // from a task.  Returns false after Shutdown.
+    //-----------------------------------------------------------------
+    bool Submit(CTask* pTask, CancelToken* pCancelToken=NULL);
+
+    //-----------------------------------------------------------------
+    // Queue pNext when pTask succeeds, with pTask's token - call before
+    // pTask is submitted.
+    //-----------------------------------------------------------------
+    void Then(CTask* pTask, CTask* pNext);
+
+    //-----------------------------------------------------------------
+    // Cancel the token - the tasks not yet started are skipped, and the
+    // running ones are asked to stop.
+    //-----------------------------------------------------------------
+    void Cancel(CancelToken* pCancelToken);
+
+    //-----------------------------------------------------------------
+    // Wait up to dwTimeout milliseconds for the task to complete.
+    // Returns true if it ran, false if skipped or still pending.
+    //-----------------------------------------------------------------
+    bool Wait(CTask* pTask, DWORD dwTimeout=QUEUE_WAIT_INFINITE);
+    void WaitAll();
+
+    //-----------------------------------------------------------------
+    // Wait for the queued tasks, then stop the workers.
+    //-----------------------------------------------------------------
+    void Shutdown();
+
+    int GetWorkerCount() { return (int)m_listWorkers.size(); }
+    int GetOutstandingCount();
+
+protected:
+    //-----------------------------------------------------------------
+    // Whether the task's continuations run - by default, when Task()
+    // returned TRUE.
+    //-----------------------------------------------------------------
+    virtual bool TaskSucceeded(CTask* pTask, BOOL bReturn) { return (bReturn == TRUE); }
+
+    //-----------------------------------------------------------------
+    // Ask a running task to stop - called with the executor locked.
+    //-----------------------------------------------------------------
+    virtual void CancelRunningTask(CTask* pTask) {}
+
+private:
+    // Not implemented
+    TaskExecutor(const TaskExecutor&);
+    TaskExecutor& operator=(const TaskExecutor&);
+
+    void RunWorker(int nWorker);
+    bool TakeJob(int nWorker, ExecutorJob& job);
+    void RunJob(int nWorker, ExecutorJob& job);
+    void QueueJob(int nQueue, CTask* pTask, CancelToken* pCancelToken);
+    void SignalComplete();
+    bool WaitComplete(DWORD dwTimeout);
+    void SkipTask(CTask* pTask);
+    void TakeContinuations(CTask* pTask, std::vector<CTask*>& listNext);
+    int CurrentWorker();
+};
+
+#endif // __TASK_EXECUTOR_H__
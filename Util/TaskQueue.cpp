@@ -0,0 +1,414 @@
+/*********************************************************************
+ *
+ *  file:  TaskQueue.cpp
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Bounded task queue of a CThread - first in, first out
+ *          within each priority lane, the higher lanes first.
+ *
+ *********************************************************************/
+
+#include "Stdafx.h"
+#include "Thread.h"
+
+#ifndef WINDOWS
+#include <sys/time.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: CTaskQueue constructor
+CTaskQueue::CTaskQueue(unsigned int nCapacity /*QUEUE_SIZE*/)
+    : m_nCount(0), m_nCapacity((nCapacity > 0) ? nCapacity : 1),
+      m_bInterrupted(FALSE), m_bClosed(FALSE), m_bCreated(TRUE)
+{
+#ifdef WINDOWS
+    InitializeCriticalSection(&m_lock);
+    m_hNotEmpty = CreateEvent(NULL, TRUE, FALSE, NULL);
+    m_hNotFull = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    if ( (m_hNotEmpty == NULL) || (m_hNotFull == NULL) ) {
+        m_bCreated = FALSE;
+    }
+#else
+    if ( (pthread_mutex_init(&m_lock, NULL) != 0) ||
+         (pthread_cond_init(&m_condNotEmpty, NULL) != 0) ||
+         (pthread_cond_init(&m_condNotFull, NULL) != 0) ) {
+        m_bCreated = FALSE;
+    }
+#endif
+
+} // End constructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: CTaskQueue destructor - the tasks left are not deleted, the
+//          queue doesn't own them.
+CTaskQueue::~CTaskQueue()
+{
+#ifdef WINDOWS
+    if (m_hNotEmpty != NULL) {
+        CloseHandle(m_hNotEmpty);
+    }
+    if (m_hNotFull != NULL) {
+        CloseHandle(m_hNotFull);
+    }
+    DeleteCriticalSection(&m_lock);
+#else
+    pthread_cond_destroy(&m_condNotFull);
+    pthread_cond_destroy(&m_condNotEmpty);
+    pthread_mutex_destroy(&m_lock);
+#endif
+
+} // End destructor
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Queue the task at the end of its lane.
+// Requires:
+//      lpv: task
+//      priority: lane of the task
+//      dwTimeout: milliseconds to wait for room, QUEUE_WAIT_INFINITE
+//                 to wait as long as it takes.
+// Returns: TRUE if queued, FALSE if the queue stayed full or is closed.
+BOOL CTaskQueue::Push(LPVOID lpv, TaskPriority_t priority /*TaskPriorityNormal*/,
+                      DWORD dwTimeout /*0*/)
+{
+    if ( (priority < TaskPriorityHigh) || (priority >= TaskPriorityLanes) ) {
+        priority = TaskPriorityNormal;
+    }
+
+    LockQueue();
+
+    if (FALSE == WaitNotFull(dwTimeout)) {
+        UnlockQueue();
+        return FALSE;
+    }
+
+    m_listLanes[priority].push_back(lpv);
+    m_nCount++;
+
+    SignalNotEmpty();
+    UnlockQueue();
+
+    return TRUE;
+
+} // End Push
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Take the oldest task of the highest lane.
+// Requires:
+//      lppv: set to the task
+//      dwTimeout: milliseconds to wait for a task.
+// Returns: TRUE if a task was taken, FALSE otherwise.
+BOOL CTaskQueue::Pop(LPVOID* lppv, DWORD dwTimeout /*0*/)
+{
+    LockQueue();
+
+    if (FALSE == WaitNotEmpty(dwTimeout, FALSE)) {
+        UnlockQueue();
+        return FALSE;
+    }
+
+    for (int nLane = TaskPriorityHigh; nLane < TaskPriorityLanes; nLane++) {
+        if (m_listLanes[nLane].empty() == false) {
+            *lppv = m_listLanes[nLane].front();
+            m_listLanes[nLane].pop_front();
+            break;
+        }
+    }
+
+    m_nCount--;
+
+    SignalNotFull();
+    UnlockQueue();
+
+    return TRUE;
+
+} // End Pop
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait for a task to be queued - the thread of a CThread waits
+//          here.  A task queued before the wait is seen by it, so no
+//          wake up is lost.
+// Requires:
+//      dwTimeout: milliseconds to wait.
+// Returns: TRUE if a task is queued, FALSE otherwise.
+BOOL CTaskQueue::Wait(DWORD dwTimeout /*QUEUE_WAIT_INFINITE*/)
+{
+    LockQueue();
+    BOOL bResult = WaitNotEmpty(dwTimeout, TRUE);
+    UnlockQueue();
+
+    return bResult;
+
+} // End Wait
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wake the thread in Wait - if none is waiting, the next call
+//          to Wait returns at once.
+// Requires: nothing
+// Returns: nothing
+void CTaskQueue::Interrupt()
+{
+    LockQueue();
+    m_bInterrupted = TRUE;
+    SignalNotEmpty();
+    UnlockQueue();
+
+} // End Interrupt
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Fail the pushes and wake every thread waiting on the queue.
+// Requires: nothing
+// Returns: nothing
+void CTaskQueue::Close()
+{
+    LockQueue();
+    m_bClosed = TRUE;
+    SignalNotEmpty();
+#ifdef WINDOWS
+    SetEvent(m_hNotFull);
+#else
+    pthread_cond_broadcast(&m_condNotFull);
+#endif
+    UnlockQueue();
+
+} // End Close
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Accept pushes again after Close.
+// Requires: nothing
+// Returns: nothing
+void CTaskQueue::Open()
+{
+    LockQueue();
+    m_bClosed = FALSE;
+    UnlockQueue();
+
+} // End Open
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Change the number of tasks the queue holds.
+// Requires:
+//      nCapacity: new capacity - not less than the tasks queued.
+// Returns: TRUE if successful, FALSE otherwise.
+BOOL CTaskQueue::SetCapacity(unsigned int nCapacity)
+{
+    LockQueue();
+
+    if ( (nCapacity == 0) || (nCapacity < m_nCount) ) {
+        UnlockQueue();
+        return FALSE;
+    }
+
+    m_nCapacity = nCapacity;
+
+    // More room for every waiting producer.
+#ifdef WINDOWS
+    SetEvent(m_hNotFull);
+#else
+    pthread_cond_broadcast(&m_condNotFull);
+#endif
+
+    UnlockQueue();
+    return TRUE;
+
+} // End SetCapacity
+
+///////////////////////////////////////////////////////////////////////
+unsigned int CTaskQueue::Capacity()
+{
+    LockQueue();
+    unsigned int nCapacity = m_nCapacity;
+    UnlockQueue();
+
+    return nCapacity;
+
+} // End Capacity
+
+///////////////////////////////////////////////////////////////////////
+unsigned int CTaskQueue::Size()
+{
+    LockQueue();
+    unsigned int nCount = m_nCount;
+    UnlockQueue();
+
+    return nCount;
+
+} // End Size
+
+///////////////////////////////////////////////////////////////////////
+void CTaskQueue::LockQueue()
+{
+#ifdef WINDOWS
+    EnterCriticalSection(&m_lock);
+#else
+    pthread_mutex_lock(&m_lock);
+#endif
+
+} // End LockQueue
+
+///////////////////////////////////////////////////////////////////////
+void CTaskQueue::UnlockQueue()
+{
+#ifdef WINDOWS
+    LeaveCriticalSection(&m_lock);
+#else
+    pthread_mutex_unlock(&m_lock);
+#endif
+
+} // End UnlockQueue
+
+#ifndef WINDOWS
+///////////////////////////////////////////////////////////////////////
+// Purpose: Absolute time of a timeout, as pthread_cond_timedwait needs.
+static void GetDeadline(DWORD dwTimeout, struct timespec& deadline)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    deadline.tv_sec = now.tv_sec + (dwTimeout / 1000);
+    deadline.tv_nsec = (now.tv_usec * 1000) + ((dwTimeout % 1000) * 1000000);
+
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+} // End GetDeadline
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait, with the queue locked, for a task to be queued.
+// Requires:
+//      dwTimeout: milliseconds to wait.
+//      bInterruptible: TRUE to return after Interrupt as well.
+// Returns: TRUE if a task is queued, FALSE otherwise.
+BOOL CTaskQueue::WaitNotEmpty(DWORD dwTimeout, BOOL bInterruptible)
+{
+#ifdef WINDOWS
+    DWORD dwStart = GetTickCount();
+#else
+    struct timespec deadline;
+    if ( (dwTimeout != 0) && (dwTimeout != QUEUE_WAIT_INFINITE) ) {
+        GetDeadline(dwTimeout, deadline);
+    }
+#endif
+
+    while ( (m_nCount == 0) && (m_bClosed == FALSE) &&
+            ( (bInterruptible == FALSE) || (m_bInterrupted == FALSE) ) ) {
+
+        if (dwTimeout == 0) {
+            break;
+        }
+
+#ifdef WINDOWS
+        DWORD dwWait = INFINITE;
+        if (dwTimeout != QUEUE_WAIT_INFINITE) {
+            DWORD dwElapsed = GetTickCount() - dwStart;
+            if (dwElapsed >= dwTimeout) {
+                break;
+            }
+            dwWait = dwTimeout - dwElapsed;
+        }
+
+        // Reset while locked - a push after this sets it again.
+        ResetEvent(m_hNotEmpty);
+        UnlockQueue();
+        WaitForSingleObject(m_hNotEmpty, dwWait);
+        LockQueue();
+#else
+        if (dwTimeout == QUEUE_WAIT_INFINITE) {
+            pthread_cond_wait(&m_condNotEmpty, &m_lock);
+        }
+        else if (pthread_cond_timedwait(&m_condNotEmpty, &m_lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+#endif
+    }
+
+    if (bInterruptible) {
+        m_bInterrupted = FALSE;
+    }
+
+    return (m_nCount > 0);
+
+} // End WaitNotEmpty
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wait, with the queue locked, for room for a task.
+// Requires:
+//      dwTimeout: milliseconds to wait.
+// Returns: TRUE if there is room, FALSE if still full or closed.
+BOOL CTaskQueue::WaitNotFull(DWORD dwTimeout)
+{
+#ifdef WINDOWS
+    DWORD dwStart = GetTickCount();
+#else
+    struct timespec deadline;
+    if ( (dwTimeout != 0) && (dwTimeout != QUEUE_WAIT_INFINITE) ) {
+        GetDeadline(dwTimeout, deadline);
+    }
+#endif
+
+    while ( (m_nCount >= m_nCapacity) && (m_bClosed == FALSE) ) {
+
+        if (dwTimeout == 0) {
+            break;
+        }
+
+#ifdef WINDOWS
+        DWORD dwWait = INFINITE;
+        if (dwTimeout != QUEUE_WAIT_INFINITE) {
+            DWORD dwElapsed = GetTickCount() - dwStart;
+            if (dwElapsed >= dwTimeout) {
+                break;
+            }
+            dwWait = dwTimeout - dwElapsed;
+        }
+
+        ResetEvent(m_hNotFull);
+        UnlockQueue();
+        WaitForSingleObject(m_hNotFull, dwWait);
+        LockQueue();
+#else
+        if (dwTimeout == QUEUE_WAIT_INFINITE) {
+            pthread_cond_wait(&m_condNotFull, &m_lock);
+        }
+        else if (pthread_cond_timedwait(&m_condNotFull, &m_lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+#endif
+    }
+
+    return ( (m_bClosed == FALSE) && (m_nCount < m_nCapacity) );
+
+} // End WaitNotFull
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wake the threads waiting for a task - all of them, since the
+//          thread in Wait leaves the task for a Pop.
+void CTaskQueue::SignalNotEmpty()
+{
+#ifdef WINDOWS
+    SetEvent(m_hNotEmpty);
+#else
+    pthread_cond_broadcast(&m_condNotEmpty);
+#endif
+
+} // End SignalNotEmpty
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Wake a producer waiting for room.
+void CTaskQueue::SignalNotFull()
+{
+#ifdef WINDOWS
+    SetEvent(m_hNotFull);
+#else
+    pthread_cond_signal(&m_condNotFull);
+#endif
+
+} // End SignalNotFull
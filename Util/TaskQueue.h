@@ -0,0 +1,111 @@
+/*********************************************************************
+ *
+ *  file:  TaskQueue.h
+ *
+ *  (C) Copyright 2010, Diomede Corporation
+ *  All rights reserved
+ *
+ *  Use, modification, and distribution is subject to
+ *  the New BSD License (See accompanying file LICENSE).
+ *
+ * Purpose: Bounded task queue of a CThread - first in, first out
+ *          within each priority lane, the higher lanes first.  Any
+ *          number of threads may push and pop; a push to a full queue
+ *          waits for room up to its timeout, so a producer is held to
+ *          the pace of the workers instead of losing tasks.
+ *
+ *          Include Thread.h rather than this file.
+ *
+ *********************************************************************/
+
+#ifndef __TASK_QUEUE_H__
+#define __TASK_QUEUE_H__
+
+// BOOL, DWORD, LPVOID and QUEUE_SIZE are those of Thread.h, which
+// includes this file.
+#include <deque>
+
+//---------------------------------------------------------------------
+// Timeout of a push or pop that waits as long as it takes.
+//---------------------------------------------------------------------
+#define QUEUE_WAIT_INFINITE     0xFFFFFFFF
+
+typedef enum {
+    TaskPriorityHigh,
+    TaskPriorityNormal,
+    TaskPriorityLow,
+    TaskPriorityLanes } TaskPriority_t;
+
+/////////////////////////////////////////////////////////////////////////////
+class CTaskQueue
+{
+private:
+    std::deque<LPVOID>  m_listLanes[TaskPriorityLanes];
+    unsigned int        m_nCount;               // Tasks in all lanes
+    unsigned int        m_nCapacity;
+    BOOL                m_bInterrupted;         // Wake the next Wait without a task
+    BOOL                m_bClosed;              // Fail pushes and waits until Open
+
+#ifdef WINDOWS
+    CRITICAL_SECTION    m_lock;
+    HANDLE              m_hNotEmpty;            // Manual reset - reset under the lock
+    HANDLE              m_hNotFull;
+#else
+    pthread_mutex_t     m_lock;
+    pthread_cond_t      m_condNotEmpty;
+    pthread_cond_t      m_condNotFull;
+#endif
+
+public:
+    BOOL                m_bCreated;
+
+    CTaskQueue(unsigned int nCapacity=QUEUE_SIZE);
+    ~CTaskQueue();
+
+    //  Name:       Push
+    //  Action:     Queue the task at the end of its lane - if the queue is
+    //              full, wait up to dwTimeout milliseconds for room.
+    //  Returns:    TRUE if queued, FALSE if still full or closed.
+    BOOL            Push(LPVOID lpv, TaskPriority_t priority=TaskPriorityNormal,
+                         DWORD dwTimeout=0);
+
+    //  Name:       Pop
+    //  Action:     Take the oldest task of the highest lane - if the queue
+    //              is empty, wait up to dwTimeout milliseconds for one.
+    //  Returns:    TRUE if a task was taken, FALSE otherwise.
+    BOOL            Pop(LPVOID* lppv, DWORD dwTimeout=0);
+
+    //  Name:       Wait
+    //  Action:     Wait for a task to be queued, leaving it queued - returns
+    //              early after Interrupt or Close.
+    //  Returns:    TRUE if a task is queued, FALSE otherwise.
+    BOOL            Wait(DWORD dwTimeout=QUEUE_WAIT_INFINITE);
+
+    //  Name:       Interrupt
+    //  Action:     Wake the thread in Wait, or the next one to call it.
+    void            Interrupt();
+
+    //  Name:       Close, Open
+    //  Action:     Close fails the pushes and wakes every waiting thread;
+    //              the queued tasks can still be popped.  Open undoes it.
+    void            Close();
+    void            Open();
+
+    BOOL            SetCapacity(unsigned int nCapacity);
+    unsigned int    Capacity();
+    unsigned int    Size();
+
+private:
+    // Not implemented
+    CTaskQueue(const CTaskQueue&);
+    CTaskQueue& operator=(const CTaskQueue&);
+
+    void            LockQueue();
+    void            UnlockQueue();
+    BOOL            WaitNotEmpty(DWORD dwTimeout, BOOL bInterruptible);
+    BOOL            WaitNotFull(DWORD dwTimeout);
+    void            SignalNotEmpty();
+    void            SignalNotFull();
+};
+
+#endif // __TASK_QUEUE_H__
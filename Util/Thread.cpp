@@ -101,6 +101,10 @@
 // Name: Walter E. Capers
 // Description: In THKernel, changed how events are released.  Events are now released right after
 //              They are recieved.
+//
+// Diomede: replaced the task stack and its event with CTaskQueue - tasks run first in,
+//          first out with priority lanes, a full queue can be waited on, and a task
+//          queued before the thread waits is no longer missed.
 
 #include "Stdafx.h"
 #include "Thread.h"
@@ -180,9 +184,8 @@ _THKERNEL( LPVOID lpvData /* CThread Object */
 			lastType == ThreadTypeSpecialized ||
 			lastType == ThreadTypeNotDefined )
 		{
-			if( ! pThread->m_event.Wait()  )    // wait for a message
-					break;
-			pThread->m_event.Reset();           // message recieved
+			// Diomede: returns on a task, on Stop or on a change of type.
+			pThread->m_queue.Wait(QUEUE_WAIT_INFINITE);
 		}
 
 		if( ! pThread->KernelProcess() )
@@ -288,7 +291,9 @@ CThread::OnTask()
  *
  **/
 BOOL
-CThread::Event(CTask *pvTask /* data to be processed by thread */
+CThread::Event(CTask *pvTask, /* data to be processed by thread */
+			   TaskPriority_t priority, /* queue lane */
+			   DWORD dwTimeout /* milli-seconds to wait on a full queue */
 			   )
 {
 	m_mutex.Lock();
@@ -339,11 +344,15 @@ CThread::Event(CTask *pvTask /* data to be processed by thread */
 		m_mutex.Unlock();
 
 		pvTask->SetId(&m_dwId);
-		if( ! Push((LPVOID)pvTask) )
-			return FALSE;
 
+		// Diomede: set before the push - the thread may complete the task
+		// before Push returns.
 		pvTask->SetTaskStatus(TaskStatusWaitingOnQueue);
-		m_event.Set();
+		if( ! Push((LPVOID)pvTask,priority,dwTimeout) )
+		{
+			pvTask->SetTaskStatus(TaskStatusNotSubmitted);
+			return FALSE;
+		}
 
 	}
 	catch (char *psz)
@@ -370,7 +379,9 @@ CThread::Event(CTask *pvTask /* data to be processed by thread */
  *
  **/
 BOOL
-CThread::Event(LPVOID lpvData /* data to be processed by thread */
+CThread::Event(LPVOID lpvData, /* data to be processed by thread */
+			   TaskPriority_t priority, /* queue lane */
+			   DWORD dwTimeout /* milli-seconds to wait on a full queue */
 			   )
 {
 
@@ -428,13 +439,11 @@ CThread::Event(LPVOID lpvData /* data to be processed by thread */
 	m_type = ThreadTypeSpecialized;
 
 	m_mutex.Unlock();
-	if( ! Push(lpvData) )
+	if( ! Push(lpvData,priority,dwTimeout) )
 	{
 		return FALSE;
 	}
 
-	m_event.Set();
-
 	return TRUE;
 }
 
@@ -479,9 +488,8 @@ CThread::KernelProcess()
 
 	if( !Empty() )
 	{
-		while( !Empty() )
+		while( Pop() )
 		{
-			Pop();
 			if( !OnTask(m_lpvProcessor) )
 			{
 				m_mutex.Lock();
@@ -495,6 +503,14 @@ CThread::KernelProcess()
 		m_lpvProcessor = NULL;
 		m_state = ThreadStateWaiting;
 	}
+	else if( m_type != ThreadTypeIntervalDriven )
+	{
+		// Diomede: woken without a task by a change of type - OnTask()
+		// is only for interval driven threads, and failing it here
+		// ended the thread.
+		m_mutex.Lock();
+		m_state = ThreadStateWaiting;
+	}
 	else {
 		if( !OnTask() )
 		{
@@ -525,9 +541,7 @@ CThread::GetEventsPending()
 {
 	unsigned int chEventsWaiting;
 
-	m_mutex.Lock();
-	  chEventsWaiting = m_queuePos;
-    m_mutex.Unlock();
+	chEventsWaiting = m_queue.Size();
 
 	return chEventsWaiting;
 }
@@ -547,9 +561,6 @@ CThread::CThread(void)
 ,m_thread(NULL)
 #endif
 ,m_dwId(0L)
-,m_lppvQueue(NULL)
-,m_chQueue(QUEUE_SIZE)
-,m_queuePos(0)
 ,m_lpvProcessor(NULL)
 ,m_state(ThreadStateDown)
 ,m_dwIdle(100)
@@ -560,15 +571,6 @@ CThread::CThread(void)
 	m_dwObjectCondition = NO_ERRORS;
 	m_szObjectCondition = _T("");
 
-	m_lppvQueue = new LPVOID [QUEUE_SIZE];
-
-	if( !m_lppvQueue )
-	{
-		m_dwObjectCondition |= MEMORY_FAULT;
-		m_state = ThreadStateFault;
-		return;
-	}
-
 	if( !m_mutex.m_bCreated )
 	{
 	    // Diomede: removing to provide output
@@ -580,7 +582,7 @@ CThread::CThread(void)
 	}
 
 
-	if( !m_event.m_bCreated )
+	if( !m_queue.m_bCreated )
 	{
 	    // Diomede: removing to provide output
 	    // via caller. 
@@ -607,9 +609,7 @@ float
 CThread::PercentCapacity()
 {
 	float fValue = 0;
-	m_mutex.Lock();
-		fValue = (float)m_queuePos/m_chQueue;
-	m_mutex.Unlock();
+	fValue = (float)m_queue.Size()/m_queue.Capacity();
 	return fValue;
 }
 
@@ -622,36 +622,16 @@ CThread::PercentCapacity()
 BOOL
 CThread::SetQueueSize( unsigned int ch )
 {
-	LPVOID * newQueue = NULL;
+	// Diomede: the queue keeps its tasks, in order.
+	if( !m_queue.SetCapacity(ch) )
+	{
+		cerr << "Warning CThread::SetQueueSize:\n\tthe new queue size is less than the number of tasks on a non-empty queue! Request ignored.\n";
+		return FALSE;
+	}
 
 	m_mutex.Lock();
-	    ASSERT(ch > m_queuePos);
-
-	    if( ch <= m_queuePos )
-		{
-			cerr << "Warning CThread::SetQueueSize:\n\tthe new queue size is less than the number of tasks on a non-empty queue! Request ignored.\n";
-			m_mutex.Unlock();
-			return FALSE;
-		}
-
-		newQueue = new LPVOID [ch];
-		if(  !newQueue )
-		{
-			cerr << "Warning CThread::SetQueueSize:\n\ta low memory, could not reallocate queue!\n";
-			m_mutex.Unlock();
-			return FALSE;
-		}
-
-		for( unsigned int i=0;i<m_queuePos; i++ )
-		{
-			newQueue[i] = m_lppvQueue[i];
-		}
-
-		delete [] m_lppvQueue;
-
-		m_chQueue = ch;
-		m_lppvQueue = newQueue;
-
+		if( m_queue.Size() < ch && (m_dwObjectCondition & STACK_FULL) )
+			m_dwObjectCondition = m_dwObjectCondition ^ STACK_FULL;
 	m_mutex.Unlock();
 
 	return TRUE;
@@ -669,13 +649,8 @@ CThread::SetQueueSize( unsigned int ch )
 BOOL
 CThread::Empty()
 {
-	m_mutex.Lock();
-	if( m_queuePos <= 0 )
-	{
-		m_mutex.Unlock();
+	if( m_queue.Size() == 0 )
 		return TRUE;
-	}
-	m_mutex.Unlock();
 	return FALSE;
 }
 
@@ -684,18 +659,24 @@ CThread::Empty()
 /**
  *
  * Push
- * place a data object in the threads que
+ * place a data object in the threads que, at the end of
+ * its priority lane.  If the que is full, wait up to
+ * dwTimeout milli-seconds for room.
  *
  **/
 BOOL
-CThread::Push( LPVOID lpv )
+CThread::Push( LPVOID lpv, TaskPriority_t priority, DWORD dwTimeout )
 {
 	if( !lpv ) return TRUE;
 
+	// Diomede: never wait on a full queue with the mutex held - the
+	// thread needs it to take the next task.
+	BOOL bPushed = m_queue.Push(lpv,priority,dwTimeout);
+
 	m_mutex.Lock();
 	m_szObjectCondition = _T("");
 
-	if( m_queuePos+1 >= m_chQueue ) {
+	if( !bPushed ) {
 		m_dwObjectCondition |= STACK_OVERFLOW;
 		m_szObjectCondition = _T("Thread stack overflow.");
 		m_mutex.Unlock();
@@ -707,8 +688,7 @@ CThread::Push( LPVOID lpv )
 	if( m_dwObjectCondition & STACK_OVERFLOW )
 		m_dwObjectCondition = m_dwObjectCondition ^ STACK_OVERFLOW;
 
-	m_lppvQueue[m_queuePos++] = lpv;
-	if( m_queuePos+1 >= m_chQueue )
+	if( m_queue.Size() >= m_queue.Capacity() )
 		m_dwObjectCondition |= STACK_FULL;
 
 	m_mutex.Unlock();
@@ -719,17 +699,18 @@ CThread::Push( LPVOID lpv )
 /**
  *
  * Pop
- * move an object from the input que to the processor
+ * move the next object from the input que to the processor
  *
  **/
 BOOL
 CThread::Pop()
 {
+	LPVOID lpv = NULL;
+	BOOL bPopped = m_queue.Pop(&lpv);
 
 	m_mutex.Lock();
-	if( m_queuePos-1 < 0 )
+	if( !bPopped )
 	{
-		m_queuePos = 0;
 		m_dwObjectCondition |= STACK_EMPTY;
 		m_mutex.Unlock();
 		return FALSE;
@@ -741,8 +722,7 @@ CThread::Pop()
 	if( m_dwObjectCondition & STACK_FULL )
 		m_dwObjectCondition = m_dwObjectCondition ^ STACK_FULL;
 
-	m_queuePos--;
-	m_lpvProcessor = m_lppvQueue[m_queuePos];
+	m_lpvProcessor = lpv;
 	m_mutex.Unlock();
 	return TRUE;
 }
@@ -791,7 +771,7 @@ CThread::SetThreadType(ThreadType_t typ,
 
 
 		m_mutex.Unlock();
-		m_event.Set();
+		m_queue.Interrupt();
 	}
 	catch (char *psz)
 	{
@@ -828,7 +808,7 @@ CThread::Stop()
 		m_mutex.Lock();
 		m_bRunning = FALSE;
 		m_mutex.Unlock();
-		m_event.Set();
+		m_queue.Close();
 
 		int ticks = (m_StopTimeout*1000)/100;
 
@@ -904,6 +884,8 @@ CThread::Start()
 
 		m_mutex.Unlock();
 
+		m_queue.Open();
+
 		if( m_dwObjectCondition & THREAD_CREATION )
 			m_dwObjectCondition = m_dwObjectCondition ^ THREAD_CREATION;
 
@@ -1071,9 +1053,6 @@ CThread::~CThread(void)
 	CloseHandle(m_thread);
 #endif
 
-	delete [] m_lppvQueue;
-	m_lppvQueue = NULL;
-
 }
 
 
@@ -82,6 +82,10 @@ typedef DWORD ThreadId_t;
 
 #define QUEUE_SIZE 100
 #define DEFAULT_STACK_SIZE 0
+
+// Diomede: tasks are queued first in, first out with priority lanes -
+// the old stack ran the last task queued first.
+#include "TaskQueue.h"
 #ifndef WINDOWS
 void Sleep( unsigned int mseconds);
 #endif
@@ -116,7 +120,8 @@ typedef enum {
 	TaskStatusNotSubmitted,
 	TaskStatusWaitingOnQueue,
 	TaskStatusBeingProcessed,
-	TaskStatusCompleted } TaskStatus_t;
+	TaskStatusCompleted,
+	TaskStatusCancelled } TaskStatus_t;   // Diomede: skipped by TaskExecutor
 
 class CTask
 {
@@ -197,7 +202,9 @@ class CThread
 class CThread
 {
 protected:
-	CEventClass   m_event;         // event controller
+	// Diomede: the queue wakes the thread - replaces m_event, which lost
+	// a wake up set before the thread waited on it.
+	CTaskQueue    m_queue;         // task queue
 	int           m_StopTimeout;   // specifies a timeout value for stop
 	                               // if a thread fails to stop within m_StopTimeout
 	                               // seconds an exception is thrown
@@ -209,9 +216,6 @@ protected:
 	pthread_t     m_thread;        // thread handle
 #endif
 	ThreadId_t	  m_dwId;          // id of this thread
-	LPVOID        *m_lppvQueue;    // task que
-	unsigned int  m_chQueue;       // que depth
-	unsigned int  m_queuePos;      // current que possition
 	LPVOID        m_lpvProcessor;  // data which is currently being processed
 	ThreadState_t m_state;         // current state of thread see thread state data
 	                               // structure.
@@ -233,7 +237,8 @@ protected:
 
 	DWORD         m_dwObjectCondition;
 	std::string   m_szObjectCondition;
-	BOOL		  Push(LPVOID lpv);
+	BOOL		  Push(LPVOID lpv, TaskPriority_t priority=TaskPriorityNormal,
+	                   DWORD dwTimeout=0);
 	BOOL		  Pop();
 	BOOL		  Empty();
 public:
@@ -262,8 +267,12 @@ public:
 	float		PercentCapacity();
 	void        WaitTillExit();
 	BOOL		KernelProcess();
-	BOOL		Event(LPVOID lpvData=NULL);
-	BOOL        Event(CTask *pvTask);
+	// Diomede: dwTimeout is the milliseconds to wait for room on a
+	// full queue, QUEUE_WAIT_INFINITE to wait as long as it takes.
+	BOOL		Event(LPVOID lpvData=NULL, TaskPriority_t priority=TaskPriorityNormal,
+	                  DWORD dwTimeout=0);
+	BOOL        Event(CTask *pvTask, TaskPriority_t priority=TaskPriorityNormal,
+	                  DWORD dwTimeout=0);
 	void		SetOnStopTimeout(int seconds ) { m_StopTimeout = seconds; }
     BOOL        SetQueueSize( unsigned int ch );
 	BOOL		Stop();
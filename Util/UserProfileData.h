@@ -149,6 +149,26 @@ using namespace std;
 #define GEN_ENABLE_LOGGING					    _T("EnableLogging")
 #define GEN_ENABLE_LOGGING_DF	    	        0
 
+// Buffered file logging - a buffer size of 0 writes each message
+// to the log file as it's logged.  The flush interval is in
+// milliseconds.
+#define GEN_LOG_BUFFER_SIZE   					_T("LogBufferSize")
+#define GEN_LOG_BUFFER_SIZE_DF	    	    	0
+
+#define GEN_LOG_FLUSH_INTERVAL 					_T("LogFlushInterval")
+#define GEN_LOG_FLUSH_INTERVAL_DF	    	    1000
+
+#define GEN_LOG_COMPRESS     					_T("LogCompress")
+#define GEN_LOG_COMPRESS_DF	    	    		0
+
+// Transfer metrics - per-chunk and per-file records are appended
+// to the metrics file when set.  Format is "jsonl" or "csv".
+#define GEN_METRICS_FILE     					_T("MetricsFile")
+#define GEN_METRICS_FILE_DF	    	    		_T("")
+
+#define GEN_METRICS_FORMAT   					_T("MetricsFormat")
+#define GEN_METRICS_FORMAT_DF	    	    	_T("jsonl")
+
 // Log timing to the log files.
 #define GEN_LOG_TIMING     					    _T("LogTiming")
 #define GEN_LOG_TIMING_DF	    	    		0
@@ -168,21 +188,72 @@ using namespace std;
 #define GEN_LOG_UPLOAD     					    _T("LogUpload")
 #define GEN_LOG_UPLOAD_DF	    	    		0
 
-// Customization of resume intervals.  Time is in seconds.
-#define GEN_RESUME_INTERVAL_1 				    _T("ResumeInterval1")
-#define GEN_RESUME_INTERVAL_1_DF   	    		5
+// Retry policy per error class: base delay, maximum delay (seconds),
+// jitter (percent of the delay), maximum attempts, circuit breaker
+// threshold (consecutive failures, 0 for none) and breaker open time
+// (seconds), separated by commas.
+#define GEN_RETRY_NETWORK 				        _T("RetryNetwork")
+#define GEN_RETRY_NETWORK_DF   	    		    _T("5,3600,50,10,8,60")
 
-#define GEN_RESUME_INTERVAL_2 				    _T("ResumeInterval2")
-#define GEN_RESUME_INTERVAL_2_DF   	    		30
+#define GEN_RETRY_SESSION 				        _T("RetrySession")
+#define GEN_RETRY_SESSION_DF   	    		    _T("1,30,50,3,0,0")
 
-#define GEN_RESUME_INTERVAL_3 				    _T("ResumeInterval3")
-#define GEN_RESUME_INTERVAL_3_DF   	    		300
+#define GEN_RETRY_SERVICE 				        _T("RetryService")
+#define GEN_RETRY_SERVICE_DF   	    		    _T("5,60,50,3,4,60")
 
+// Resume intervals (seconds) used before the retry policies - no longer
+// used.  Read once, when RetryNetwork is not set, to carry the first
+// and last intervals over as its base and maximum delay.
+#define GEN_RESUME_INTERVAL_1 				    _T("ResumeInterval1")
+#define GEN_RESUME_INTERVAL_2 				    _T("ResumeInterval2")
+#define GEN_RESUME_INTERVAL_3 				    _T("ResumeInterval3")
 #define GEN_RESUME_INTERVAL_4 				    _T("ResumeInterval4")
-#define GEN_RESUME_INTERVAL_4_DF   	    		600
-
 #define GEN_RESUME_INTERVAL_5 				    _T("ResumeInterval5")
-#define GEN_RESUME_INTERVAL_5_DF   	    		3600
+
+// Check of the uploaded part of a file before a resume continues:
+// none (last modified time only), sampled, or full.
+#define GEN_RESUME_VERIFY 				        _T("ResumeVerify")
+#define GEN_RESUME_VERIFY_DF   	    		    _T("sampled")
+
+// Bandwidth limits in KB per second, 0 for no limit - for all
+// transfers together, and for each transfer.
+#define GEN_BANDWIDTH_LIMIT                     _T("BandwidthLimit")
+#define GEN_BANDWIDTH_LIMIT_DF                  0
+
+#define GEN_TRANSFER_BANDWIDTH_LIMIT            _T("TransferBandwidthLimit")
+#define GEN_TRANSFER_BANDWIDTH_LIMIT_DF         0
+
+// Time of day limits, separated by commas: HH:MM-HH:MM=total[/transfer]
+// in KB per second, e.g. "08:00-18:00=512/128".  Outside the listed
+// times, the limits above apply.
+#define GEN_BANDWIDTH_SCHEDULE                  _T("BandwidthSchedule")
+#define GEN_BANDWIDTH_SCHEDULE_DF               _T("")
+
+// Local mock of the storage and transfer services, used to measure
+// client throughput offline - 1 to use the mock instead of the
+// service.  Files are kept in the mock directory (default: mock in
+// the application data directory).
+#define GEN_MOCK_SERVICE                        _T("MockService")
+#define GEN_MOCK_SERVICE_DF                     0
+
+#define GEN_MOCK_SERVICE_DIR                    _T("MockServiceDir")
+#define GEN_MOCK_SERVICE_DIR_DF                 _T("")
+
+// Mock latency in milliseconds per request and per chunk, and the
+// bandwidth of the mock link in KB per second (0 for no limit).
+#define GEN_MOCK_LATENCY                        _T("MockLatency")
+#define GEN_MOCK_LATENCY_DF                     0
+
+#define GEN_MOCK_BANDWIDTH                      _T("MockBandwidth")
+#define GEN_MOCK_BANDWIDTH_DF                   0
+
+// Percent of mock requests and chunks that fail, and the errors they
+// fail with, separated by commas - one is picked at random.
+#define GEN_MOCK_FAILURE_RATE                   _T("MockFailureRate")
+#define GEN_MOCK_FAILURE_RATE_DF                0
+
+#define GEN_MOCK_FAILURE_ERRORS                 _T("MockFailureErrors")
+#define GEN_MOCK_FAILURE_ERRORS_DF              _T("timeout,end of file or no input")
 
 #define GEN_SEND_TIMEOUT                        _T("SendTimeout")
 #define GEN_SEND_TIMEOUT_DF                     30
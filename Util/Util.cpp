@@ -30,12 +30,21 @@
 #include <stdio.h>
 #include <errno.h>
 #include <ShlObj.h>
+
+// For MakeFileSparse
+#include <winioctl.h>
 #endif
 
 #if defined(linux)
 #include <unistd.h>
 #endif
 
+#ifndef WIN32
+// For GetFileDataExtents and MakeFileSparse
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #ifndef WIN32
 #include <stdio.h>
 #include <stdlib.h>
@@ -1102,4 +1111,359 @@ int Util::CreateConfig( const std::string szFilePath, bool bPrependAppDir /*true
 
 } // End CreateConfig
 
+///////////////////////////////////////////////////////////////////////
+// Purpose: Adds a data region to the extent list, merging with the
+//          previous extent when adjacent.
+// Requires:
+//      listExtents: extent list
+//      l64Offset: start of the data region
+//      l64Length: length of the data region
+// Returns: nothing
+static void AddFileDataExtent(FileDataExtentList& listExtents, LONG64 l64Offset,
+                              LONG64 l64Length)
+{
+    if (l64Length <= 0) {
+        return;
+    }
+
+    if ( (listExtents.size() > 0) &&
+         (listExtents.back().m_l64Offset + listExtents.back().m_l64Length == l64Offset) ) {
+        listExtents.back().m_l64Length += l64Length;
+        return;
+    }
+
+    FileDataExtent extent;
+    extent.m_l64Offset = l64Offset;
+    extent.m_l64Length = l64Length;
+    listExtents.push_back(extent);
+
+} // End AddFileDataExtent
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Returns true if the buffer contains only zeros.
+// Requires:
+//      pBuffer: data
+//      nLength: data length
+// Returns: true if all zeros, false otherwise
+static bool IsZeroBlock(const char* pBuffer, int nLength)
+{
+    for (int nIndex = 0; nIndex < nLength; nIndex++) {
+        if (pBuffer[nIndex] != 0) {
+            return false;
+        }
+    }
+    return true;
+
+} // End IsZeroBlock
+
+///////////////////////////////////////////////////////////////////////
+// Purpose: Fallback for file systems without SEEK_DATA - reads the file
+//          and treats zero blocks as holes.
+// Requires:
+//      szFileName: input file
+//      listExtents: returned data extents
+// Returns: true if successful, false otherwise
+static bool ScanFileZeroBlocks(const char* szFileName, FileDataExtentList& listExtents)
+{
+    FILE* pFile = fopen(szFileName, _T("rb"));
+    if (pFile == NULL) {
+        return false;
+    }
+
+    std::vector<char> buffer(UTIL_SPARSE_BLOCK_SIZE * 256);
+    LONG64 l64Offset = 0;
+    size_t nRead = 0;
+
+    while ( (nRead = fread(&buffer[0], 1, buffer.size(), pFile)) > 0 ) {
+        for (size_t nBlock = 0; nBlock < nRead; nBlock += UTIL_SPARSE_BLOCK_SIZE) {
+            int nLength = (int)( (nRead - nBlock < UTIL_SPARSE_BLOCK_SIZE) ?
+                                 nRead - nBlock : UTIL_SPARSE_BLOCK_SIZE );
+            if (false == IsZeroBlock(&buffer[nBlock], nLength)) {
+                AddFileDataExtent(listExtents, l64Offset + nBlock, nLength);
+            }
+        }
+        l64Offset += nRead;
+    }
+
+    bool bSuccess = (ferror(pFile) == 0);
+    fclose(pFile);
+
+    return bSuccess;
+
+} // End ScanFileZeroBlocks
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Returns the data regions of a file, skipping holes.  Uses
+//      SEEK_DATA/SEEK_HOLE where supported, otherwise scans the file
+//      for zero blocks.
+// Requires:
+//      szFileName: input file
+//      listExtents: returned data extents in file order
+//      l64DataBytes: returned total bytes in the data extents
+//      bScanZeroBlocks: false to skip the scan - a file with every
+//                       block allocated is then returned as one
+//                       extent, and false is returned if the file
+//                       system can't report its holes.
+// Returns: true if successful, false otherwise
+bool Util::GetFileDataExtents(const char* szFileName, FileDataExtentList& listExtents,
+                              LONG64& l64DataBytes, bool bScanZeroBlocks /*true*/)
+{
+    listExtents.clear();
+    l64DataBytes = 0;
+
+    bool bSuccess = false;
+    bool bSeekData = false;
+
+    #ifndef WIN32
+        if (false == bScanZeroBlocks) {
+            struct stat theStats;
+            if (stat(szFileName, &theStats) != 0) {
+                return false;
+            }
+
+            // Every block is allocated - there are no holes to find.
+            if ((LONG64)theStats.st_blocks * 512 >= (LONG64)theStats.st_size) {
+                AddFileDataExtent(listExtents, 0, theStats.st_size);
+                l64DataBytes = theStats.st_size;
+                return true;
+            }
+        }
+    #endif
+
+    #if !defined(WIN32) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+        int nFile = open(szFileName, O_RDONLY);
+        if (nFile < 0) {
+            return false;
+        }
+
+        struct stat theStats;
+        if (fstat(nFile, &theStats) != 0) {
+            close(nFile);
+            return false;
+        }
+
+        LONG64 l64Size = theStats.st_size;
+        off_t nData = lseek(nFile, 0, SEEK_DATA);
+
+        // ENXIO: no data at all (the file is one hole).  EINVAL: the file
+        // system does not support SEEK_DATA - fall back to the scan.
+        if ( (nData >= 0) || (errno == ENXIO) ) {
+            bSeekData = true;
+            bSuccess = true;
+
+            while ( (nData >= 0) && (nData < l64Size) ) {
+                off_t nHole = lseek(nFile, nData, SEEK_HOLE);
+                if (nHole < 0) {
+                    nHole = (off_t)l64Size;
+                }
+
+                AddFileDataExtent(listExtents, nData, nHole - nData);
+                nData = lseek(nFile, nHole, SEEK_DATA);
+            }
+        }
+
+        close(nFile);
+    #endif
+
+    if (false == bSeekData) {
+        if (false == bScanZeroBlocks) {
+            return false;
+        }
+        bSuccess = ScanFileZeroBlocks(szFileName, listExtents);
+    }
+
+    for (int nIndex = 0; nIndex < (int)listExtents.size(); nIndex++) {
+        l64DataBytes += listExtents[nIndex].m_l64Length;
+    }
+
+    return bSuccess;
+
+} // End GetFileDataExtents
+
+#ifdef WIN32
+///////////////////////////////////////////////////////////////////////
+// Purpose: Releases the disk space of a range of a sparse file.
+// Requires:
+//      hFile: file, marked sparse and open for writing
+//      l64Start: start of the range
+//      l64End: end of the range
+// Returns: true if successful, false otherwise
+static bool SetFileZeroData(HANDLE hFile, LONG64 l64Start, LONG64 l64End)
+{
+    FILE_ZERO_DATA_INFORMATION zeroData;
+    zeroData.FileOffset.QuadPart = l64Start;
+    zeroData.BeyondFinalZero.QuadPart = l64End;
+
+    DWORD dwReturned = 0;
+    return (::DeviceIoControl(hFile, FSCTL_SET_ZERO_DATA, &zeroData, sizeof(zeroData),
+                              NULL, 0, &dwReturned, NULL) != FALSE);
+
+} // End SetFileZeroData
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// Purpose:
+//      Releases the disk space of zero blocks in a file, recreating a
+//      sparse file (e.g. following a download).
+// Requires:
+//      szFileName: input file
+//      l64HoleBytes: returned bytes released
+// Returns: true if successful, false if not supported or on error
+bool Util::MakeFileSparse(const char* szFileName, LONG64& l64HoleBytes)
+{
+    l64HoleBytes = 0;
+
+    #if defined(WIN32)
+        HANDLE hFile = ::CreateFileA(szFileName, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                                     OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        // Fails on file systems without sparse files (e.g. FAT).
+        DWORD dwReturned = 0;
+        if (::DeviceIoControl(hFile, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &dwReturned, NULL) == FALSE) {
+            ::CloseHandle(hFile);
+            return false;
+        }
+
+        std::vector<char> buffer(UTIL_SPARSE_BLOCK_SIZE * 256);
+        bool bSuccess = true;
+        LONG64 l64Offset = 0;
+        LONG64 l64ZeroStart = -1;
+
+        while (bSuccess) {
+            DWORD dwRead = 0;
+            if (::ReadFile(hFile, &buffer[0], (DWORD)buffer.size(), &dwRead, NULL) == FALSE) {
+                bSuccess = false;
+                break;
+            }
+            if (dwRead == 0) {
+                break;
+            }
+
+            // Only whole blocks are released - a short last block is data.
+            for (DWORD dwBlock = 0; dwBlock < dwRead; dwBlock += UTIL_SPARSE_BLOCK_SIZE) {
+                LONG64 l64BlockOffset = l64Offset + dwBlock;
+
+                if ( (dwRead - dwBlock >= UTIL_SPARSE_BLOCK_SIZE) &&
+                     IsZeroBlock(&buffer[dwBlock], UTIL_SPARSE_BLOCK_SIZE) ) {
+                    if (l64ZeroStart < 0) {
+                        l64ZeroStart = l64BlockOffset;
+                    }
+                    continue;
+                }
+
+                if (l64ZeroStart >= 0) {
+                    if (false == SetFileZeroData(hFile, l64ZeroStart, l64BlockOffset)) {
+                        bSuccess = false;
+                        break;
+                    }
+                    l64HoleBytes += l64BlockOffset - l64ZeroStart;
+                    l64ZeroStart = -1;
+                }
+            }
+
+            l64Offset += dwRead;
+        }
+
+        if ( bSuccess && (l64ZeroStart >= 0) ) {
+            if (false == SetFileZeroData(hFile, l64ZeroStart, l64Offset)) {
+                bSuccess = false;
+            }
+            else {
+                l64HoleBytes += l64Offset - l64ZeroStart;
+            }
+        }
+
+        ::CloseHandle(hFile);
+        return bSuccess;
+
+    #elif defined(linux) && defined(FALLOC_FL_PUNCH_HOLE)
+        // Only the data regions need checking - existing holes read back
+        // as zeros and are skipped.
+        FileDataExtentList listExtents;
+        LONG64 l64DataBytes = 0;
+
+        if (false == GetFileDataExtents(szFileName, listExtents, l64DataBytes)) {
+            return false;
+        }
+
+        int nFile = open(szFileName, O_RDWR);
+        if (nFile < 0) {
+            return false;
+        }
+
+        std::vector<char> buffer(UTIL_SPARSE_BLOCK_SIZE * 256);
+        bool bSuccess = true;
+
+        for (int nIndex = 0; (nIndex < (int)listExtents.size()) && bSuccess; nIndex++) {
+
+            // Only whole, aligned blocks can be released.
+            LONG64 l64Start = listExtents[nIndex].m_l64Offset;
+            LONG64 l64End = l64Start + listExtents[nIndex].m_l64Length;
+            l64Start = (l64Start + UTIL_SPARSE_BLOCK_SIZE - 1) & ~((LONG64)UTIL_SPARSE_BLOCK_SIZE - 1);
+            l64End = l64End & ~((LONG64)UTIL_SPARSE_BLOCK_SIZE - 1);
+
+            LONG64 l64ZeroStart = -1;
+
+            while (l64Start < l64End) {
+                size_t nWant = (size_t)( (l64End - l64Start < (LONG64)buffer.size()) ?
+                                         l64End - l64Start : (LONG64)buffer.size() );
+                ssize_t nRead = pread(nFile, &buffer[0], nWant, (off_t)l64Start);
+                if (nRead <= 0) {
+                    bSuccess = (nRead == 0);
+                    break;
+                }
+
+                for (ssize_t nBlock = 0; nBlock + UTIL_SPARSE_BLOCK_SIZE <= nRead;
+                     nBlock += UTIL_SPARSE_BLOCK_SIZE) {
+                    LONG64 l64BlockOffset = l64Start + nBlock;
+
+                    if (IsZeroBlock(&buffer[nBlock], UTIL_SPARSE_BLOCK_SIZE)) {
+                        if (l64ZeroStart < 0) {
+                            l64ZeroStart = l64BlockOffset;
+                        }
+                        continue;
+                    }
+
+                    if (l64ZeroStart >= 0) {
+                        if (fallocate(nFile, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                                      (off_t)l64ZeroStart, (off_t)(l64BlockOffset - l64ZeroStart)) != 0) {
+                            bSuccess = false;
+                            break;
+                        }
+                        l64HoleBytes += l64BlockOffset - l64ZeroStart;
+                        l64ZeroStart = -1;
+                    }
+                }
+
+                l64Start += (nRead & ~((ssize_t)UTIL_SPARSE_BLOCK_SIZE - 1));
+                if (nRead < (ssize_t)UTIL_SPARSE_BLOCK_SIZE) {
+                    break;
+                }
+            }
+
+            if ( bSuccess && (l64ZeroStart >= 0) && (l64Start > l64ZeroStart) ) {
+                if (fallocate(nFile, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                              (off_t)l64ZeroStart, (off_t)(l64Start - l64ZeroStart)) != 0) {
+                    bSuccess = false;
+                }
+                else {
+                    l64HoleBytes += l64Start - l64ZeroStart;
+                }
+            }
+        }
+
+        close(nFile);
+        return bSuccess;
+    #else
+        // No way to release blocks on this platform.
+        (void)szFileName;
+        return false;
+    #endif
+
+} // End MakeFileSparse
+
 /** @} */
@@ -20,6 +20,7 @@
 #include "Stdafx.h"
 
 #include <queue>
+#include <vector>
 #include <sys/stat.h>
 
 #ifdef WIN32
@@ -66,6 +67,20 @@ using namespace std;
     //-----------------------------------------------------------------
     //-----------------------------------------------------------------
 
+    //-----------------------------------------------------------------
+    // Data region of a (possibly sparse) file - the gaps between
+    // extents are holes or zero blocks.
+    //-----------------------------------------------------------------
+    typedef struct FileDataExtent {
+        LONG64  m_l64Offset;
+        LONG64  m_l64Length;
+    } FileDataExtent;
+
+    typedef std::vector<FileDataExtent> FileDataExtentList;
+
+    // Zero block granularity used when scanning for holes.
+    #define UTIL_SPARSE_BLOCK_SIZE      4096
+
 /////////////////////////////////////////////////////////////////////////////
 // Util Class
 
@@ -262,6 +277,31 @@ public:
         return -1;
     }
 
+    ///////////////////////////////////////////////////////////////////////
+    // Purpose:
+    //      Returns the data regions of a file, skipping holes.  Uses
+    //      SEEK_DATA/SEEK_HOLE where supported, otherwise scans the file
+    //      for zero blocks.
+    // Requires:
+    //      szFileName: input file
+    //      listExtents: returned data extents in file order
+    //      l64DataBytes: returned total bytes in the data extents
+    //      bScanZeroBlocks: false to return false rather than read the
+    //                       whole file when holes can't be found cheaply
+    // Returns: true if successful, false otherwise
+    static bool GetFileDataExtents(const char* szFileName, FileDataExtentList& listExtents,
+                                   LONG64& l64DataBytes, bool bScanZeroBlocks=true);
+
+    ///////////////////////////////////////////////////////////////////////
+    // Purpose:
+    //      Releases the disk space of zero blocks in a file, recreating a
+    //      sparse file (e.g. following a download).
+    // Requires:
+    //      szFileName: input file
+    //      l64HoleBytes: returned bytes released
+    // Returns: true if successful, false if not supported or on error
+    static bool MakeFileSparse(const char* szFileName, LONG64& l64HoleBytes);
+
     ///////////////////////////////////////////////////////////////////////
     // Purpose:
     //      Returns the last modified time for a file.